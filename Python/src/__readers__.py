@@ -2,6 +2,8 @@ from .__entro_plot__ import *
 from .__models__ import *
 import h5py
 import tqdm
+import json
+import glob
 import pandas as pd
 from numba import njit
 
@@ -705,4 +707,134 @@ From a given .h5 file extracts the eigenstates
 def get_eigenstates(directory : str, model_short : str, which = 'states_r'):
     eigs = read_h5_file(directory, model_short + '.h5', which)
     
-    return eigs
\ No newline at end of file
+    return eigs
+
+
+####################################################### COLUMNAR CONTAINER #######################################################
+
+'''
+Reader of the columnar containers (eth*.h5, written with -eth_col 1). Each realization is a single aligned chunk of the
+dataset (row r of the (realizations, Nh) array), the layout of all the datasets sits in the consolidated index (_meta).
+The scalars of a file (e.g. 'stat/gap_ratio') are the columns of its single packed dataset (e.g. 'stat/scalars').
+The uncompressed chunks are memory mapped - slicing a window of eigenstates touches only its pages, nothing else is read.
+The compressed ones fall back to h5py, which decompresses only the chunks of the selected realizations.
+- paths : file, list of files or the glob pattern (e.g. the shards: directory + 'eth_*.h5')
+'''
+class ColumnarContainer:
+    DTYPES = {'f8' : np.dtype('<f8'), 'c16' : np.dtype('<c16')}
+
+    def __init__(self, paths):
+        if isinstance(paths, str):
+            paths = sorted(glob.glob(paths)) if any(c in paths for c in '*?[') else [paths]
+        self.files  = []
+        self.maps   = []
+        self.meta   = {}
+        owner       = {}
+        for p in paths:
+            f   = h5py.File(p, 'r')
+            idx = len(self.files)
+            self.files.append(f)
+            self.maps.append(np.memmap(p, dtype = np.uint8, mode = 'r'))
+            meta = json.loads(ColumnarContainer._index(f['_meta']))
+            if meta.get('format') != 'qes-columnar':
+                raise ValueError(f"{p} is not a columnar container")
+            for k, v in meta['datasets'].items():
+                self.meta.setdefault(k, v)
+            # the later files (restarted shards) take over the same realizations
+            for row, r in enumerate(f['realizations'][:, 0].astype(int)):
+                owner[r] = (idx, row)
+        self.realizations   = np.array(sorted(owner.keys()), dtype = int)
+        self._owner         = [owner[r] for r in self.realizations]
+
+    '''
+    The index is the resizable array of the bytes of the JSON string (the fixed size string in the older files)
+    '''
+    @staticmethod
+    def _index(ds):
+        raw = ds[()]
+        return (raw.tobytes() if isinstance(raw, np.ndarray) else raw).decode()
+
+    '''
+    Packed dataset and the row of the scalar (e.g. 'stat/gap_ratio' lives in the row of 'stat/scalars'), None if not packed
+    '''
+    def _packed(self, key : str):
+        for k, v in self.meta.items():
+            if 'columns' in v and key.startswith(k[:-len('scalars')]):
+                name = key[len(k) - len('scalars'):]
+                if name in v['columns']:
+                    return k, v['columns'].index(name)
+        return None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        for f in self.files:
+            f.close()
+        self.files, self.maps = [], []
+
+    def keys(self):
+        out = []
+        for k, v in self.meta.items():
+            if k == 'realizations':
+                continue
+            if 'columns' in v:
+                out += [k[:-len('scalars')] + c for c in v['columns']]
+            else:
+                out.append(k)
+        return out
+
+    '''
+    Zero copy view of a single realization (the chunk in the memory map) or the decompressed row
+    - key : name of the dataset (e.g. 'stat/energy', 'diag/Sz/0')
+    - i : position of the realization in self.realizations
+    '''
+    def column(self, key : str, i : int):
+        fi, row = self._owner[i]
+        ds      = self.files[fi][key]
+        info    = self.meta.get(key, {})
+        if info.get('compression') is None and ds.chunks is not None:
+            try:
+                ch      = ds.id.get_chunk_info_by_coord((row, 0))
+                dtype   = ColumnarContainer.DTYPES[info.get('dtype', 'f8')]
+                return self.maps[fi][ch.byte_offset : ch.byte_offset + ch.size].view(dtype)[:ds.shape[1]]
+            except (KeyError, ValueError, AttributeError, RuntimeError):
+                pass
+        return ds[row, :]
+
+    '''
+    Values of the dataset for the selected realizations and rows - only the selection is materialized
+    - key : name of the dataset
+    - rows : slice (or index array) of the rows, e.g. the eigenstates
+    - reals : positions of the realizations (default all)
+    '''
+    def get(self, key : str, rows = slice(None), reals = None):
+        reals = range(len(self._owner)) if reals is None else reals
+        return np.stack([np.array(self.column(key, i)[rows]) for i in reals])
+
+    '''
+    Scalar of each realization (e.g. 'stat/mean_energy_index', 'stat/gap_ratio')
+    '''
+    def scalar(self, key : str):
+        packed = self._packed(key)
+        if packed is not None:
+            return self.get(packed[0], packed[1])
+        return self.get(key, 0)
+
+    '''
+    Window of the eigenstates around the center of each realization - by default the mean energy index (getEnAvIdx)
+    - key : name of the dataset (e.g. 'diag/Sz/0')
+    - half : half width of the window
+    - center : name of the scalar dataset with the center (or the array of the centers)
+    '''
+    def window(self, key : str, half : int, center = 'stat/mean_energy_index'):
+        centers = self.scalar(center) if isinstance(center, str) else np.asarray(center)
+        n       = self.meta[key]['shape'][1]
+        out     = []
+        for i, c in enumerate(centers.astype(int)):
+            lo  = max(0, min(c - half, n - 2 * half))
+            out.append(np.array(self.column(key, i)[lo : lo + 2 * half]))
+        return np.stack(out)
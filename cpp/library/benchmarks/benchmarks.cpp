@@ -0,0 +1,244 @@
+/***********************************
+* Benchmark suite of the main stages:
+* the Hilbert space mapping, the build
+* of the Hamiltonian (XYZ, Heisenberg,
+* QSM), the dense and Lanczos
+* diagonalization, a single NQS
+* iteration (RBM, RBM_PP), entropies
+* and the time evolution. The wall
+* times are written as JSON.
+*
+* qsolver_bench [-o file.json] [-r reps]
+*				[-t threads] [-f filter]
+*				[-q (small sizes)]
+***********************************/
+
+#include "../source/src/lin_alg.h"
+#include "../include/user_interface/user_interface.h"
+#include "../include/benchmark/benchmark.h"
+
+using Benchmark::Params;
+
+// ##########################################################################################################################################
+
+namespace
+{
+	struct BenchCfg
+	{
+		std::string out					= "benchmarks.json";
+		uint reps						= 5;
+		uint threads					= 1;
+		std::string filter				= "";
+		bool quick						= false;
+	};
+
+	/*
+	* @brief Square chain with the periodic boundary conditions
+	*/
+	inline std::shared_ptr<Lattice> chain(uint _L)
+	{
+		return std::make_shared<SquareLattice>(_L, 1, 1, 1, BoundaryConditions::PBC);
+	}
+
+	/*
+	* @brief Hilbert space of the chain - with the symmetries: k = 0, R = +1 and the half filling (U1)
+	*/
+	inline Hilbert::HilbertSpace<double> hilbert(std::shared_ptr<Lattice> _lat, bool _syms)
+	{
+		if (!_syms)
+			return Hilbert::HilbertSpace<double>(_lat);
+		v_1d<std::pair<Operators::SymGenerators, int>> _loc	= { { Operators::SymGenerators::T, 0 }, { Operators::SymGenerators::R, 1 } };
+		v_1d<GlobalSyms::GlobalSym> _glb					= { GlobalSyms::getU1Sym(_lat, _lat->get_Ns() / 2) };
+		return Hilbert::HilbertSpace<double>(_lat, _loc, _glb);
+	}
+
+	/*
+	* @brief XYZ chain - without the symmetries the fields and the anisotropy break all of them, with the symmetries the
+	* model conserves the magnetization. The Heisenberg chain is the isotropic point.
+	*/
+	inline std::shared_ptr<Hamiltonian<double>> xyz(std::shared_ptr<Lattice> _lat, bool _syms, bool _heisenberg, uint _thr)
+	{
+		std::shared_ptr<Hamiltonian<double>> _H;
+		if (_heisenberg)
+			_H = std::make_shared<XYZ<double>>(hilbert(_lat, _syms), 1.0, 0.0, 0.0, _syms ? 0.0 : 0.3, 1.0, 0.0, 0.0, 0.0, false);
+		else
+			_H = std::make_shared<XYZ<double>>(hilbert(_lat, _syms), 1.0, 0.5, _syms ? 0.0 : 0.2, _syms ? 0.0 : 0.3, 0.9, 0.9, _syms ? 0.0 : 0.5, _syms ? 0.0 : 0.5, false);
+		_H->setThreadNum(_thr);
+		return _H;
+	}
+
+	/*
+	* @brief Quantum sun model with the dot of 3 particles
+	*/
+	inline std::shared_ptr<Hamiltonian<double>> qsm(uint _L, uint _thr)
+	{
+		const size_t _N					= 3;
+		Hilbert::HilbertSpace<double> _hil(_L);
+		auto _H							= std::make_shared<QSM<double>>(std::move(_hil), _N, 1.0, 1.0,
+											v_1d<double>(_L - _N, 0.9), v_1d<double>(_L - _N, 1.0), v_1d<double>(_L - _N, 0.2));
+		_H->setThreadNum(_thr);
+		return _H;
+	}
+
+	inline Params params(uint _L, bool _syms)
+	{
+		return { { "L", STR(_L) }, { "syms", _syms ? "1" : "0" } };
+	}
+
+	// ##########################################################################################################################################
+
+	void benchHilbert(Benchmark::Suite& _s, const v_1d<uint>& _Ls)
+	{
+		for (auto _L : _Ls)
+			for (bool _syms : { false, true })
+			{
+				auto _lat				= chain(_L);
+				_s.run("hilbert/mapping", params(_L, _syms), []() {},
+					[&](Params& _e) { auto _h = hilbert(_lat, _syms); _e["Nh"] = STR(_h.getHilbertSize()); });
+			}
+	}
+
+	void benchBuild(Benchmark::Suite& _s, const v_1d<uint>& _Ls)
+	{
+		for (auto _L : _Ls)
+		{
+			for (bool _syms : { false, true })
+				for (bool _hei : { false, true })
+				{
+					auto _H				= xyz(chain(_L), _syms, _hei, _s.threads());
+					_s.run(_hei ? "build/heisenberg" : "build/xyz", params(_L, _syms), [&]() { _H->clearH(); },
+						[&](Params& _e) { _H->buildHamiltonian(); _e["Nh"] = STR(_H->getHilbertSize()); });
+				}
+			auto _H						= qsm(_L, _s.threads());
+			_s.run("build/qsm", params(_L, false), [&]() { _H->clearH(); },
+				[&](Params& _e) { _H->buildHamiltonian(); _e["Nh"] = STR(_H->getHilbertSize()); });
+		}
+	}
+
+	void benchDiag(Benchmark::Suite& _s, const v_1d<uint>& _LsDense, const v_1d<uint>& _LsLanczos)
+	{
+		for (auto _L : _LsDense)
+			for (bool _syms : { false, true })
+			{
+				auto _H					= xyz(chain(_L), _syms, false, _s.threads());
+				_H->buildHamiltonian();
+				_s.run("diag/dense", params(_L, _syms), [&]() { _H->clearEigVal(); },
+					[&](Params& _e) { _H->diagH(false); _e["Nh"] = STR(_H->getHilbertSize()); });
+			}
+		for (auto _L : _LsLanczos)
+		{
+			auto _H						= xyz(chain(_L), false, false, _s.threads());
+			_H->buildHamiltonian();
+			_s.run("diag/lanczos", params(_L, false), [&]() { _H->clearEigVal(); },
+				[&](Params& _e) { _H->diagH(false, 10, 0, 1000, 0, "lanczos"); _e["E0"] = STRP(_H->getEigVal(0), 10); });
+		}
+	}
+
+	/*
+	* @brief Single training iteration (sampling of the blocks, local energies and the SR step) of the NQS
+	*/
+	template <typename _N>
+	void benchNQS(Benchmark::Suite& _s, const std::string& _name, const v_1d<uint>& _Ls)
+	{
+		for (auto _L : _Ls)
+		{
+			auto _H						= xyz(chain(_L), false, false, _s.threads());
+			auto _nqs					= std::make_shared<_N>(_H, 2 * _L, 1e-3, _s.threads());
+			_nqs->setScheduler(0, 1e-3);
+			const NQS_train_t _par(1, 0, 100, 4, 1);
+			_s.run(_name, params(_L, false), []() {},
+				[&](Params& _e) { auto [_En, _std] = _nqs->train(_par, true); _e["E"] = STRP(algebra::real(_En(0)), 8); });
+		}
+	}
+
+	void benchEntropy(Benchmark::Suite& _s, const v_1d<uint>& _Ls)
+	{
+		for (auto _L : _Ls)
+			for (bool _syms : { false, true })
+			{
+				auto _H					= xyz(chain(_L), _syms, false, _s.threads());
+				_H->buildHamiltonian();
+				_H->diagH(false, 10, 0, 1000, 0, "lanczos");
+				_H->generateFullMap();
+				const arma::vec _gs		= _H->getEigVec(0);
+				_s.run("entropy/half", params(_L, _syms), []() {},
+					[&](Params& _e) { _e["S"] = STRP(Entropy::Entanglement::Bipartite::vonNeuman<double>(_gs, _L / 2, _H->hilbertSpace), 10); });
+			}
+	}
+
+	void benchTimeEvo(Benchmark::Suite& _s, const v_1d<uint>& _LsEig, const v_1d<uint>& _LsCheb)
+	{
+		// eigenbasis - a block of 256 times with a single product
+		for (auto _L : _LsEig)
+		{
+			auto _H						= xyz(chain(_L), false, false, _s.threads());
+			_H->buildHamiltonian();
+			_H->diagH(false);
+			const arma::vec _psi		= arma::normalise(arma::vec(_H->getHilbertSize(), arma::fill::randu));
+			const arma::vec _ov			= _H->getEigVec().t() * _psi;
+			const arma::vec _times		= arma::logspace(-2, 3, 256);
+			_s.run("time_evo/eigenbasis", params(_L, false), []() {},
+				[&](Params& _e)
+				{
+					auto _coeff			= SystemProperties::TimeEvolution::time_evo_coeff(_H->getEigVal(), _ov, _times);
+					auto _states		= SystemProperties::TimeEvolution::time_evo_block(_H->getEigVec(), _coeff);
+					_e["Nt"]			= STR(_states.n_cols);
+				});
+		}
+		// Chebyshev - a single step dt = 1 with the sparse matrix
+		for (auto _L : _LsCheb)
+		{
+			auto _H						= xyz(chain(_L), false, false, _s.threads());
+			_H->buildHamiltonian();
+			const arma::SpMat<double>& _M = _H->getHamiltonian().getSparse();
+			const arma::cx_vec _psi		= arma::normalise(arma::cx_vec(_H->getHilbertSize(), arma::fill::randu));
+			SystemProperties::TimeEvolution::ChebyshevPropagator<arma::SpMat<double>> _prop(_M);
+			_s.run("time_evo/chebyshev", params(_L, false), []() {},
+				[&](Params& _e) { auto _out = _prop.evolve(_psi, 1.0); _e["norm"] = STRP(arma::norm(_out), 10); });
+		}
+	}
+};
+
+// ##########################################################################################################################################
+
+int main(const int argc, char* argv[])
+{
+	arma::arma_rng::set_seed(arma::arma_rng::seed_type(1234));
+	SET_LOG_TIME();
+
+	BenchCfg _cfg;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string _a			= argv[i];
+		if (_a == "-q")
+			_cfg.quick					= true;
+		else if (i + 1 < argc && _a == "-o")
+			_cfg.out					= argv[++i];
+		else if (i + 1 < argc && _a == "-r")
+			_cfg.reps					= (uint)std::stoul(argv[++i]);
+		else if (i + 1 < argc && _a == "-t")
+			_cfg.threads				= (uint)std::stoul(argv[++i]);
+		else if (i + 1 < argc && _a == "-f")
+			_cfg.filter					= argv[++i];
+	}
+	omp_set_num_threads((int)_cfg.threads);
+
+	Benchmark::Suite _s(_cfg.reps, _cfg.threads, _cfg.filter);
+	const v_1d<uint> _Ls				= _cfg.quick ? v_1d<uint>{ 8, 10 } : v_1d<uint>{ 10, 12, 14, 16 };
+	const v_1d<uint> _LsDense			= _cfg.quick ? v_1d<uint>{ 8 } : v_1d<uint>{ 10, 12 };
+	const v_1d<uint> _LsSparse			= _cfg.quick ? v_1d<uint>{ 10 } : v_1d<uint>{ 14, 16 };
+	const v_1d<uint> _LsNQS				= _cfg.quick ? v_1d<uint>{ 8 } : v_1d<uint>{ 10, 16 };
+
+	benchHilbert(_s, _Ls);
+	benchBuild(_s, _Ls);
+	benchDiag(_s, _LsDense, _LsSparse);
+	benchNQS<RBM_S<2, double>>(_s, "nqs/rbm", _LsNQS);
+	benchNQS<RBM_PP_S<2, double>>(_s, "nqs/rbm_pp", _LsNQS);
+	benchEntropy(_s, _LsSparse);
+	benchTimeEvo(_s, _LsDense, _LsSparse);
+
+	std::ofstream _f(_cfg.out);
+	_s.json(_f);
+	LOGINFO("Benchmarks written to " + _cfg.out, LOG_TYPES::FINISH, 0);
+	return 0;
+}
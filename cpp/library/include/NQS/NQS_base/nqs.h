@@ -17,6 +17,7 @@
 
 // include all the definions
 #include "nqs_definitions_base.h"
+#include "nqs_config.h"
 #include "nqs_definitions_lower.tpp"
 
 /*
@@ -71,14 +72,24 @@ protected:
 	uint nFlip_							=		1;						// number of flips to be done in one step (each flip is a change in the state)
 	v_1d<uint> flipPlaces_;												// stores flip spots to be flipped during one sampling step
 	v_1d<_stateType> flipVals_;											// stores values before (!!!) the flip to be used for the gradients
+	int proposal_						=		NQS_PROP_FLIP;			// proposal kernel of the Metropolis sampler (see NQS_PROPOSAL)
+	bool nullMove_						=		false;					// the last proposal does not change the state (e.g. exchange of equal values)
+	v_1d<std::pair<uint, uint>> bonds_;									// nearest neighbour bonds of the lattice (exchange proposals)
+	v_2d<uint> neighbors_;												// nearest neighbours of each site (cluster proposals)
 	
 	NQSS curVec_;														// currently processed state vector for convenience
+	NQSConfig curBits_;													// bit-packed current state (follows the accepted flips)
 	u64 curState_						=		0;						// currently processed state - may or may not be used
 	
 	// temporary placeholders for the vectors
 	v_1d<NQSS> tmpVecs_;												// temporary vectors for the flips
 	u64 tmpState_						=		0;						// temporary state for the flips
 	NQSS tmpVec_;														// temporary vector for the flips (for the current state)
+
+	// ------------------------- C H A I N S ------------------------
+	uint nChains_						=		1;						// number of independent Markov chains advanced together
+	uint chainThreads_					=		1;						// number of threads used for the estimators of the chains
+	arma::Mat<_stateType> chains_;										// states of the chains stored as columns (nVis x nChains)
 	
 	// ------------------------ W E I G H T S -----------------------
 	NQSW derivatives_;													// store the variational derivatives F_k (nBlocks x fullSize), where nBlocks is the number of consecutive observations
@@ -91,8 +102,26 @@ protected:
 #else 
 	algebra::Solvers::Preconditioners::Preconditioner<_T, true>* precond_ 	= nullptr;	// preconditioner for the conjugate gradient
 	algebra::Solvers::General::Solver<_T, true>* solver_ 					= nullptr;	// solver for the Fisher matrix inversion
+	NQS_SRLazy<_T> srLazy_;												// matrix-free SR engine (see NQS_SR_MODE)
+	int srMode_							=		NQS_SR_SOLVER;			// how to solve the SR equation
+	NQSB srVec_;														// weights of the samples, such that F = O^H v (nBlocks)
 #endif
 public:
+#ifdef NQS_USESR_NOMAT_USED
+	/*
+	* @brief Sets the way the SR equation is solved (see NQS_SR_MODE)
+	* @param _mode solver mode
+	* @param _single store the derivatives in the single precision (the products accumulate in the double precision)
+	*/
+	void setSRMode(int _mode, bool _single = false)
+	{
+		this->srMode_ = _mode;
+		this->srLazy_.setSingle(_single);
+		this->srLazy_.setThreads(this->threads_.threadNum_);
+		if (_mode != NQS_SR_SOLVER)
+			LOGINFO("Using the matrix-free SR (mode " + STR(_mode) + (_single ? ", single precision derivatives)" : ")"), LOG_TYPES::CHOICE, 3);
+	};
+#endif
 	// preconditioner for solving the linear system
 	void setPreconditioner(int _pre) 									
 	{ 
@@ -120,6 +149,20 @@ public:
 		LOGINFO("Using ARMA solver", LOG_TYPES::CHOICE, 3); 
 	};
 
+	// ------------------------ D I S T R I B U T E D ------------------------
+	void setDistributed(bool _dist = true);
+	auto isDistributed()								const -> bool	{ return this->distributed_;										};
+protected:
+	bool distributed_					=		false;					// are the samples split over the MPI ranks (see nqs_mpi.h)?
+	virtual void bcastWeights()											{};	// broadcasts the weights from the root rank - implementation specific
+
+public:
+	// ---------------------------- D E V I C E ----------------------------
+	void setDevice(bool _dev = true, int _id = 0);
+	auto onDevice()										const -> bool	{ return this->device_;												};
+protected:
+	bool device_						=		false;					// chains and SR on the device (NQS_USE_GPU, see nqs_gpu.h)
+
 protected:
 	NQSB dF_;															// forces acting on the weights (F_k) - final gradient
 	NQSB F_;															// forces acting on the weights (F_k)
@@ -188,6 +231,8 @@ public:
 	// ratio when exact points are provided (used for the Hamiltonian probability ratio - when the Hamiltonian changes the state)
 	virtual auto pRatio(std::initializer_list<int> fP, 
 						std::initializer_list<double> fV)->_T			= 0;
+	// ratios for all the connections of the current state at once (e.g. all the states connected by the Hamiltonian)
+	virtual auto pRatioBatch(const ConnList& _conn)		->NQSB;
 	std::function<_T(const NQSS&)> pRatioFunc_;							// function for the probability ratio
 
 	// ----------------------- W E I G H T S -------------------------
@@ -201,6 +246,28 @@ public:
 	virtual bool saveWeights(std::string _path, std::string _file);
 	virtual bool setWeights(std::string _path, std::string _file);
 
+	// ---------------------- C H E C K P O I N T S ------------------
+	void setCheckpoint(bool _async, bool _resume = false);
+protected:
+	bool ckptAsync_						=		false;					// write the checkpoints with the background thread (see nqs_checkpoint.h)
+	bool ckptResume_					=		false;					// resume the training from the last checkpoint (if present)
+	uint64_t ckptSeed_					=		0;						// seed of the random generator set at the last checkpoint
+	uint64_t ckptStep_					=		0;						// step of the last checkpoint (0 - outside of the training)
+	const arma::Col<_T>* trainLoss_		=		nullptr;				// history of the loss of the current training
+	void checkpointState(size_t i);										// prepares the state of the checkpoint at the step i
+	auto resume(const NQS_train_t& _par, arma::Col<_T>& _meanEn) -> uint;	// restores the last checkpoint, returns the next step
+
+public:
+	// -------------------- S A M P L E   B U F F E R ----------------
+	void setSampleBuffer(uint _lastIters);
+	auto getSampleBuffer()						const -> const std::vector<NQSConfig>& { return this->sampleBuf_; };
+protected:
+	uint sampleBufIters_				=		0;						// training iterations kept in the buffer (0 - not buffered)
+	size_t sampleBufHead_				=		0;						// oldest sample (the buffer is a ring once full)
+	size_t sampleBufCap_				=		0;
+	std::vector<NQSConfig> sampleBuf_;									// configurations drawn in the last iterations of the training
+	void bufferSample(const NQSConfig& _s);
+
 protected:
 	// --------------------- T R A I N   E T C -----------------------
 	bool updateWeights_ = true;											// shall update the weights in current step?
@@ -228,12 +295,25 @@ protected:
 	auto pKernel(std::initializer_list<int>  fP,
 				 std::initializer_list<double> fV)		-> _T			{ return this->pRatio(fP, fV); };
 	std::function<_T(std::initializer_list<int>, std::initializer_list<double>)> pKernelFunc_;	// function for the probability ratio
+	bool useConn_						=		false;					// does the Hamiltonian emit the connections (allocation-free local energy)?
+	v_1d<LocEnBuffer> connBuf_;											// buffers for the connections - one for each worker
+	ConnList connAll_;													// connections of all the sites (batched ratios)
+	virtual auto locEnConn(const LocEnBuffer& _buf)		-> _T;			// local energy from the connections of the current state
+	virtual void locEnEmit(const NQSS& _v, uint _site,
+				LocEnBuffer& _buf)						{ this->H_->locEnergyConn(_v, _site, _buf);	};	// connections of the site (NQS_Pair - statically)
+	virtual auto locEnSite(uint _site, LocEnBuffer& _buf)	-> _T;		// connections and the ratios of a single site
+public:
+	static constexpr bool connInline	=		false;					// does locEnConn use the statically dispatched ratios of the ansatz?
+protected:
 
 	/* ------------------------------------------------------------ */
 protected:
 	_T locEnKernel();
+	_T locEnLower();													// energy addition of the lower states (excited state training)
+	virtual auto locEnKernelChain(uint _c)				-> _T;			// local energy of the chain _c
 #ifdef NQS_NOT_OMP_MT
-	virtual void locEnKernel(uint _start, uint _end, uint _threadNum);
+	template <typename _F>
+	void parallelFor(uint _n, _F&& _f);									// runs _f(task, worker) on the executor
 #endif
 
 	/* ------------------------------------------------------------ */
@@ -241,7 +321,8 @@ protected:
 public:
 	// ------------------------ S E T T E R S ------------------------
 	virtual void init()									=				0; 
-	virtual void setRandomState(bool _upd = true)						{ this->setState(this->ran_.template randomInt<u64>(0, this->info_p_.Nh_), _upd);	};
+	virtual void setRandomState(bool _upd = true)						{ this->setState(this->randomStateInt(), _upd);						};
+	virtual auto randomStateInt()										-> u64	{ return this->ran_.template randomInt<u64>(0, this->info_p_.Nh_);	};
 
 	// --------------------------------------------------------------- 
 	// training the excited states (if needed)
@@ -279,6 +360,24 @@ public:
 	// ----------------------- S A M P L I N G -----------------------
 	virtual void blockSample(uint _bSize, NQS_STATE_T _start, bool _therm = false);
 
+	// multiple chains
+	void setChains(uint _nChains, uint _threads = 0);
+	auto getChains()							const -> uint			{ return this->nChains_;				};
+
+	// proposals
+	void setProposal(int _proposal);
+	auto getProposal()							const -> int			{ return this->proposal_;				};
+	auto conservesMagnetization()				const -> bool			{ return this->proposal_ == NQS_PROP_EXCHANGE_NN || this->proposal_ == NQS_PROP_EXCHANGE_PAIR;	};
+protected:
+	virtual void setRandomChains();
+	virtual void setChainsTheta()										{};				// recalculates the cached quantities of the chains (e.g. angles)
+	virtual auto chainsParallel()				const -> bool			{ return false; };	// can the chains be processed concurrently?
+	virtual void blockSampleChains(uint _bSize);
+	virtual void gradChain(uint _c, uint _plc);
+	virtual auto locEnChainsBatch(uint _n, _T* _En)		-> bool			{ return false; };	// local energies of the first _n chains at once (if implemented)
+	void sampleChains(uint _bSize, uint _start, arma::Col<_T>& _En);
+public:
+
 	bool trainStop(size_t i, const NQS_train_t& _par, _T _currLoss, bool _quiet = false);	
 	virtual std::pair<arma::Col<_T>, arma::Col<_T>> train(const NQS_train_t& _par,
 								bool quiet			= false,			// shall talk? (default is false)
@@ -291,6 +390,11 @@ public:
 								  NQSAv::MeasurementNQS<_T>& _mes 	= {},
 								  bool _collectEn					= true,
 								  uint progPrc						= 25);
+	virtual arma::Col<_T> collectBuffered(const NQS_train_t& _par,
+										  NQSAv::MeasurementNQS<_T>& _mes,
+										  bool quiet				= false,
+										  clk::time_point _t		= NOW,
+										  bool _collectEn			= true);
 	virtual void collect(const NQS_train_t& _par, NQSAv::MeasurementNQS<_T>& _mes);
 	virtual void collect(const NQS_train_t& _par, 
 						 const Operators::OperatorNQS<_T>& _opG,
@@ -311,7 +415,10 @@ public:
 	NQS() = default;
 	NQS(const NQS& _n)
 		: info_p_(_n.info_p_), H_(_n.H_), info_(_n.info_), pBar_(_n.pBar_), 
-		ran_(_n.ran_), nFlip_(_n.nFlip_), flipPlaces_(_n.flipPlaces_), flipVals_(_n.flipVals_)
+		ran_(_n.ran_), nFlip_(_n.nFlip_), flipPlaces_(_n.flipPlaces_), flipVals_(_n.flipVals_),
+		proposal_(_n.proposal_), bonds_(_n.bonds_), neighbors_(_n.neighbors_),
+		nChains_(_n.nChains_), chainThreads_(_n.chainThreads_), chains_(_n.chains_),
+		distributed_(_n.distributed_), ckptAsync_(_n.ckptAsync_), ckptResume_(_n.ckptResume_)
 	{
 		this->threads_ 		= _n.threads_;
 		// initialize the information 
@@ -321,7 +428,10 @@ public:
 	}
 	NQS(NQS&& _n)
 		: info_p_(_n.info_p_), H_(_n.H_), info_(_n.info_), pBar_(_n.pBar_), 
-		ran_(_n.ran_), nFlip_(_n.nFlip_), flipPlaces_(_n.flipPlaces_), flipVals_(_n.flipVals_)
+		ran_(_n.ran_), nFlip_(_n.nFlip_), flipPlaces_(_n.flipPlaces_), flipVals_(_n.flipVals_),
+		proposal_(_n.proposal_), bonds_(_n.bonds_), neighbors_(_n.neighbors_),
+		nChains_(_n.nChains_), chainThreads_(_n.chainThreads_), chains_(_n.chains_),
+		distributed_(_n.distributed_), ckptAsync_(_n.ckptAsync_), ckptResume_(_n.ckptResume_)
 	{
 		this->threads_ 		= std::move(_n.threads_);
 		// initialize the information
@@ -339,6 +449,15 @@ public:
 		this->nFlip_				= _n.nFlip_;
 		this->flipPlaces_			= _n.flipPlaces_;
 		this->flipVals_				= _n.flipVals_;
+		this->proposal_				= _n.proposal_;
+		this->bonds_				= _n.bonds_;
+		this->neighbors_			= _n.neighbors_;
+		this->nChains_				= _n.nChains_;
+		this->chainThreads_			= _n.chainThreads_;
+		this->chains_				= _n.chains_;
+		this->distributed_			= _n.distributed_;
+		this->ckptAsync_			= _n.ckptAsync_;
+		this->ckptResume_			= _n.ckptResume_;
 		// initialize the information
 		this->info_p_				= _n.info_p_;
 		this->lower_states_			= _n.lower_states_;
@@ -357,6 +476,15 @@ public:
 		this->nFlip_				= _n.nFlip_;
 		this->flipPlaces_			= _n.flipPlaces_;
 		this->flipVals_				= _n.flipVals_;
+		this->proposal_				= _n.proposal_;
+		this->bonds_				= _n.bonds_;
+		this->neighbors_			= _n.neighbors_;
+		this->nChains_				= _n.nChains_;
+		this->chainThreads_			= _n.chainThreads_;
+		this->chains_				= _n.chains_;
+		this->distributed_			= _n.distributed_;
+		this->ckptAsync_			= _n.ckptAsync_;
+		this->ckptResume_			= _n.ckptResume_;
 		// initialize the information
 		this->info_p_				= std::move(_n.info_p_);
 		this->lower_states_			= std::move(_n.lower_states_);
@@ -386,24 +514,9 @@ bool NQS<_spinModes, _Ht, _T, _stateType>::initThreads(uint _threadNum)
 #	ifdef NQS_USE_OMP
 		omp_set_num_threads(this->threadNum_);   
 #	else
-		// initialize the threads
-		this->threads_.threads_.reserve(this->threads_.threadNum_);
-		this->threads_.kernels_	=			v_1d<CondVarKernel<_T>>(this->threads_.threadNum_);
-		
-		// calculate how many sites goes to one thread
-		uint _siteStep			=			std::ceil(this->info_p_.nSites_ / 1.0 / this->threads_.threadNum_);
-
-		// start the threads that calculate the energy with the local energy kernel function
-		// this function waits for the specific energy calculation to be ready on each thread
-		// this is handled through "flagThreadRun_" member
-		for (uint i = 0; i < this->threads_.threadNum_; i++)
-		{
-			std::function<void()> lambda = [this, i, _siteStep]() 
-				{ 
-					this->locEnKernel(i * _siteStep, std::min((i + 1) * _siteStep, this->info_p_.nSites_), i); 
-				};
-			this->threads_.threads_.emplace_back(std::thread(lambda));
-		}
+		// the persistent workers (shared with the process when the sizes match) - the local energy is split over the sites by the executor
+		this->threads_.pool_	=			Sched::Scheduler::get().pool(this->threads_.threadNum_ > 1 ? this->threads_.threadNum_ : 0);
+		this->threads_.partial_	=			std::vector<NQS_ExecPartial<_T>>(std::max(this->threads_.threadNum_, 1));
 #	endif
 #endif
 	return true;
@@ -416,18 +529,47 @@ bool NQS<_spinModes, _Ht, _T, _stateType>::initThreads(uint _threadNum)
 // ##########################################################################################################################################
 
 /*
-* @brief Attempting to save the weights as a vector to a given filename.
+* @brief Attempting to save the weights as a vector to a given filename. Within the training (at the checkpoint) the state
+* of the optimizer is stored as well - the snapshot is copied and, with the asynchronous checkpoints, handed to the background
+* writer, so that the training continues immediately.
 * @param _path folder for the weights to be saved onto
 * @param _file name of the file to save the weights onto
-* @returns whether the save has been successful
+* @returns whether the save has been successful (with the asynchronous checkpoints - whether it has been staged)
 */
 template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline bool NQS<_spinModes, _Ht, _T, _stateType>::saveWeights(std::string _path, std::string _file)
 {
+	if (this->ckptStep_ > 0)
+	{
+		NQS_Checkpoint<_T, _stateType> _snap;
+		_snap.dir_			= _path;
+		_snap.file_			= _file;
+		_snap.weights_		= this->F_;
+		_snap.dF_			= this->dF_;
+		_snap.seed_			= this->ckptSeed_;
+		_snap.step_			= this->ckptStep_;
+		_snap.state_		= this->curVec_;
+		if (this->nChains_ > 1)
+			_snap.chains_	= this->chains_;
+		if (this->trainLoss_ != nullptr && this->ckptStep_ <= this->trainLoss_->n_elem)
+			_snap.loss_		= this->trainLoss_->head(this->ckptStep_);
+#ifdef NQS_USESR_NOMAT_USED
+		_snap.x_			= this->srLazy_.solution();
+#endif
+		if (!this->ckptAsync_)
+			return _snap.write();
+		NQS_CheckpointWriter::get().submit(_path + _file, [_snap = std::move(_snap)]() { return _snap.write(); });
+		return true;
+	}
+
 	LOGINFO("Saving the checkpoint configuration.", LOG_TYPES::INFO, 2, '#');
 
 	// save the weights to a given path
-	auto _isSaved = saveAlgebraic(_path, _file, this->F_, "weights");
+	bool _isSaved = false;
+	{
+		PROF_SCOPE(H5_WRITE);
+		_isSaved = saveAlgebraic(_path, _file, this->F_, "weights");
+	}
 
 	// if not saved properly
 	if (!_isSaved && (_file != "weights.h5"))
@@ -483,6 +625,7 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::allocate()
 #endif
 	this->curVec_ = arma::ones(this->info_p_.nVis_);
 	this->tmpVec_ = arma::ones(this->info_p_.nVis_);
+	this->curBits_.fromVec(this->curVec_);
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -496,17 +639,8 @@ inline NQS<_spinModes, _Ht, _T, _stateType>::~NQS()
 {
 	DESTRUCTOR_CALL;
 #if defined NQS_NOT_OMP_MT
-	for (int _thread = 0; _thread < this->threads_.threadNum_; _thread++)
-	{
-		std::unique_lock<std::mutex> lock(this->threads_.kernels_[_thread].mutex);
-		this->threads_.kernels_[_thread].flagThreadKill_	= true;
-		this->threads_.kernels_[_thread].end_				= true;
-		this->threads_.kernels_[_thread].flagThreadRun_		= 1;
-		this->threads_.kernels_[_thread].cv.notify_all();
-	}
-	for (int _thread = 0; _thread < this->threads_.threadNum_; _thread++)
-		if (this->threads_.threads_[_thread].joinable())
-			this->threads_.threads_[_thread].join();
+	// join the workers (if this is the last owner of the pool)
+	this->threads_.pool_.reset();
 #endif
 	// ######################################################################################################################################
 	if (this->precond_ != nullptr) {
@@ -535,6 +669,7 @@ template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline void NQS<_spinModes, _Ht, _T, _stateType>::setState(const NQSS& _st)
 {
 	this->curVec_	= _st;
+	this->curBits_.fromVec(_st);
 #ifndef NQS_USE_VEC_ONLY
 	this->curState_ = BASE_TO_INT<u64>(_st, this->discVal_);
 #endif
@@ -553,6 +688,7 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::setState(u64 _st)
 	this->curState_ = _st;
 #endif
 	INT_TO_BASE(_st, this->curVec_, this->discVal_);
+	this->curBits_.fromVec(this->curVec_);
 }
 
 // ##########################################################################################################################################
@@ -603,6 +739,9 @@ inline NQS<_spinModes, _Ht, _T, _stateType>::NQS(std::shared_ptr<Hamiltonian<_Ht
 	this->ran_					=			_H->ran_;
 	// set threads
 	this->initThreads(_threadNum);
+	// connections for the local energy
+	this->useConn_				=			_H->hasLocEnergyConn();
+	this->connBuf_				=			v_1d<LocEnBuffer>(std::max(this->threads_.threadNum_, 1));
 
 	LOGINFO("Constructed the general NQS class", LOG_TYPES::TRACE, 2);
 };
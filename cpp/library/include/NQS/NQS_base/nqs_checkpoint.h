@@ -0,0 +1,206 @@
+#pragma once
+/***********************************
+* Defines the checkpoints of the NQS
+* training. The snapshot of the weights
+* and of the state of the optimizer is
+* written by a background thread under
+* a temporary name and moved in place,
+* so that the sampling never waits for
+* the disk and a crash never leaves a
+* partial file.
+***********************************/
+
+#ifndef NQS_CHECKPOINT_H
+#define NQS_CHECKPOINT_H
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <condition_variable>
+#include "../../quantities/profiler.h"
+
+/*
+* @brief Snapshot of the training - the weights (in the layout of F_, as read by setWeights) together with what is needed
+* to resume the training bit-exactly: the last update dF_, the warm start of the SR solver, the Markov chains, the seed of
+* the random generator (reseeded at the checkpoint), the step and the history of the loss (replayed by the schedulers).
+*/
+template <typename _T, typename _S>
+struct NQS_Checkpoint
+{
+	std::string dir_;																	// directory of the checkpoint
+	std::string file_;																	// name of the file
+	arma::Col<_T> weights_;																// weights in the layout of F_
+	arma::Col<_T> dF_;																	// last update of the weights
+	arma::Col<_T> x_;																	// warm start of the matrix-free SR
+	arma::Col<_T> loss_;																// history of the loss (steps 1 ... step_)
+	arma::Col<_S> state_;																// current state of the sampler
+	arma::Mat<_S> chains_;																// states of the Markov chains
+	uint64_t seed_						= 0;											// seed of the random generator after the checkpoint
+	uint64_t step_						= 0;											// last finished step
+
+	/*
+	* @brief Writes the snapshot to a temporary file and moves it in place (the rename is atomic within the directory)
+	* @returns whether the snapshot has been written
+	*/
+	auto write() const -> bool
+	{
+		PROF_SCOPE(H5_WRITE);
+		const std::string _file	= this->dir_ + this->file_;
+		const std::string _tmp	= _file + ".tmp";
+		try
+		{
+			std::filesystem::create_directories(this->dir_);
+			bool _ok			= this->weights_.save(arma::hdf5_name(_tmp, "weights"));
+			_ok					= _ok && arma::Col<uint64_t>({ this->seed_, this->step_ }).save(arma::hdf5_name(_tmp, "checkpoint/seed_step", arma::hdf5_opts::append));
+			if (!this->dF_.empty())
+				_ok				= _ok && this->dF_.save(arma::hdf5_name(_tmp, "checkpoint/dF", arma::hdf5_opts::append));
+			if (!this->x_.empty())
+				_ok				= _ok && this->x_.save(arma::hdf5_name(_tmp, "checkpoint/sr", arma::hdf5_opts::append));
+			if (!this->loss_.empty())
+				_ok				= _ok && this->loss_.save(arma::hdf5_name(_tmp, "checkpoint/loss", arma::hdf5_opts::append));
+			if (!this->state_.empty())
+				_ok				= _ok && this->state_.save(arma::hdf5_name(_tmp, "checkpoint/state", arma::hdf5_opts::append));
+			if (!this->chains_.empty())
+				_ok				= _ok && this->chains_.save(arma::hdf5_name(_tmp, "checkpoint/chains", arma::hdf5_opts::append));
+			if (!_ok)
+				return false;
+			std::filesystem::rename(_tmp, _file);
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+		return true;
+	}
+
+	/*
+	* @brief Reads the snapshot - the optional parts (e.g. written by the older versions) are left empty
+	* @returns whether the weights and the step have been read
+	*/
+	auto read(const std::string& _dir, const std::string& _file) -> bool
+	{
+		this->dir_				= _dir;
+		this->file_				= _file;
+		const std::string _f	= _dir + _file;
+		if (!std::filesystem::exists(_f))
+			return false;
+		arma::Col<uint64_t> _ss;
+		if (!this->weights_.load(arma::hdf5_name(_f, "weights")) || !_ss.load(arma::hdf5_name(_f, "checkpoint/seed_step")) || _ss.n_elem < 2)
+			return false;
+		this->seed_				= _ss(0);
+		this->step_				= _ss(1);
+		if (!this->dF_.load(arma::hdf5_name(_f, "checkpoint/dF")))			this->dF_.reset();
+		if (!this->x_.load(arma::hdf5_name(_f, "checkpoint/sr")))			this->x_.reset();
+		if (!this->loss_.load(arma::hdf5_name(_f, "checkpoint/loss")))		this->loss_.reset();
+		if (!this->state_.load(arma::hdf5_name(_f, "checkpoint/state")))	this->state_.reset();
+		if (!this->chains_.load(arma::hdf5_name(_f, "checkpoint/chains")))	this->chains_.reset();
+		return true;
+	}
+};
+
+// ##########################################################################################################################################
+
+/*
+* @brief Background writer of the checkpoints. The jobs are queued under the name of the file - a newer snapshot of the same
+* file replaces the one that is still waiting (only the latest checkpoint matters), therefore, at most one snapshot per file is
+* written and one is staged. A single I/O thread serves all the NQS (e.g. the consecutive excited states).
+*/
+class NQS_CheckpointWriter
+{
+protected:
+	std::thread io_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<std::pair<std::string, std::function<bool()>>> jobs_;					// staged jobs (one per file)
+	bool busy_							= false;										// is the job being written?
+	bool stop_							= false;										// shall the thread exit?
+	std::atomic<size_t> failures_		= 0;											// number of the failed writes
+
+	void loop()
+	{
+		std::unique_lock<std::mutex> _lock(this->mutex_);
+		while (true)
+		{
+			this->cv_.wait(_lock, [this]() { return this->stop_ || !this->jobs_.empty(); });
+			if (this->jobs_.empty())
+				return;
+			auto _job		= std::move(this->jobs_.front());
+			this->jobs_.pop_front();
+			this->busy_		= true;
+			_lock.unlock();
+			if (!_job.second())
+				this->failures_.fetch_add(1, std::memory_order_relaxed);
+			_lock.lock();
+			this->busy_		= false;
+			this->cv_.notify_all();
+		}
+	}
+
+	NQS_CheckpointWriter()												= default;
+public:
+	NQS_CheckpointWriter(const NQS_CheckpointWriter&)					= delete;
+	NQS_CheckpointWriter& operator=(const NQS_CheckpointWriter&)		= delete;
+	~NQS_CheckpointWriter()
+	{
+		{
+			std::lock_guard<std::mutex> _lock(this->mutex_);
+			this->stop_		= true;
+		}
+		this->cv_.notify_all();
+		if (this->io_.joinable())
+			this->io_.join();
+	}
+
+	/*
+	* @brief Returns the writer shared by all the NQS
+	*/
+	static auto get() -> NQS_CheckpointWriter&
+	{
+		static NQS_CheckpointWriter _writer;
+		return _writer;
+	}
+
+	auto failures()						const -> size_t					{ return this->failures_.load(std::memory_order_relaxed);	};
+
+	/*
+	* @brief Stages the job - replaces the waiting job of the same file. Starts the I/O thread on the first call.
+	* @param _key name of the file
+	* @param _job callable writing the snapshot, returns whether it succeeded
+	*/
+	void submit(const std::string& _key, std::function<bool()>&& _job)
+	{
+		{
+			std::lock_guard<std::mutex> _lock(this->mutex_);
+			if (!this->io_.joinable())
+				this->io_	= std::thread([this]() { this->loop(); });
+			bool _staged	= false;
+			for (auto& _j : this->jobs_)
+				if (_j.first == _key)
+				{
+					_j.second	= std::move(_job);
+					_staged		= true;
+					break;
+				}
+			if (!_staged)
+				this->jobs_.emplace_back(_key, std::move(_job));
+		}
+		this->cv_.notify_all();
+	}
+
+	/*
+	* @brief Waits until all the staged jobs are written
+	*/
+	void flush()
+	{
+		std::unique_lock<std::mutex> _lock(this->mutex_);
+		this->cv_.wait(_lock, [this]() { return this->jobs_.empty() && !this->busy_; });
+	}
+};
+
+#endif // !NQS_CHECKPOINT_H
@@ -0,0 +1,118 @@
+#pragma once
+/***********************************
+* Defines the bit-packed configuration
+* of the NQS sampler. A single bit per
+* visible unit (set - the "up" value)
+* in a fixed number of words, so that
+* the flips, the comparisons and the
+* hashing are a few word operations.
+* The dense vector is materialized
+* only where the products need it.
+***********************************/
+
+#ifndef NQS_CONFIG_H
+#define NQS_CONFIG_H
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+#include "armadillo"
+
+constexpr unsigned NQS_CONFIG_WORDS		= 8;											// maximal number of the words (512 visible units)
+
+/*
+* @brief Bit-packed configuration of the visible units
+*/
+class NQSConfig
+{
+protected:
+	std::array<uint64_t, NQS_CONFIG_WORDS> w_	= {};
+	unsigned n_									= 0;									// number of the visible units
+
+public:
+	NQSConfig()									= default;
+	explicit NQSConfig(unsigned _n)				{ this->resize(_n); };
+	explicit NQSConfig(const arma::Col<double>& _v)	{ this->fromVec(_v); };
+
+	void resize(unsigned _n)
+	{
+		if (_n > 64 * NQS_CONFIG_WORDS)
+			throw std::runtime_error(std::string("Too many visible units for the bit-packed configuration!"));
+		this->n_								= _n;
+		this->w_.fill(0);
+	}
+
+	// --------------------- G E T T E R S ---------------------
+	auto size()							const -> unsigned								{ return this->n_;											};
+	auto words()						const -> unsigned								{ return (this->n_ + 63) / 64;								};
+	auto word(unsigned _k)				const -> uint64_t								{ return this->w_[_k];										};
+	auto get(unsigned _i)				const -> bool									{ return (this->w_[_i >> 6] >> (_i & 63)) & 1ULL;			};
+	// integer key of the configuration - exact for up to 64 units
+	auto key()							const -> uint64_t								{ return this->w_[0];										};
+	auto fitsKey()						const -> bool									{ return this->n_ <= 64;									};
+
+	// --------------------- F L I P S -------------------------
+	void flip(unsigned _i)																{ this->w_[_i >> 6] ^= (1ULL << (_i & 63));				};
+	void set(unsigned _i, bool _up)
+	{
+		const uint64_t _m						= 1ULL << (_i & 63);
+		this->w_[_i >> 6]						= _up ? (this->w_[_i >> 6] | _m) : (this->w_[_i >> 6] & ~_m);
+	}
+
+	// --------------------- C O N V E R T ---------------------
+	/*
+	* @brief Packs the dense vector - the positive values are the "up" units (spins +1/2, occupied modes)
+	*/
+	void fromVec(const arma::Col<double>& _v)
+	{
+		this->resize((unsigned)_v.n_elem);
+		for (unsigned i = 0; i < this->n_; ++i)
+			this->w_[i >> 6]					|= (uint64_t)(_v(i) > 0) << (i & 63);
+	}
+
+	/*
+	* @brief Materializes the dense vector with the given values of the units
+	*/
+	void toVec(arma::Col<double>& _v, double _up, double _down) const
+	{
+		_v.set_size(this->n_);
+		for (unsigned i = 0; i < this->n_; ++i)
+			_v(i)								= this->get(i) ? _up : _down;
+	}
+
+	/*
+	* @brief Mixes all the words (splitmix64 finalizer) - for the hash maps of the configurations
+	*/
+	auto hash()							const -> size_t
+	{
+		uint64_t _h								= this->n_;
+		for (unsigned k = 0; k < this->words(); ++k)
+		{
+			uint64_t _z							= this->w_[k] + 0x9E3779B97F4A7C15ULL + (_h << 6) + (_h >> 2);
+			_z									= (_z ^ (_z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			_z									= (_z ^ (_z >> 27)) * 0x94D049BB133111EBULL;
+			_h									^= _z ^ (_z >> 31);
+		}
+		return (size_t)_h;
+	}
+
+	bool operator==(const NQSConfig& _o) const
+	{
+		if (this->n_ != _o.n_)
+			return false;
+		for (unsigned k = 0; k < this->words(); ++k)
+			if (this->w_[k] != _o.w_[k])
+				return false;
+		return true;
+	}
+	bool operator!=(const NQSConfig& _o) const											{ return !(*this == _o);									};
+};
+
+template <>
+struct std::hash<NQSConfig>
+{
+	size_t operator()(const NQSConfig& _c) const noexcept								{ return _c.hash();											};
+};
+
+#endif // !NQS_CONFIG_H
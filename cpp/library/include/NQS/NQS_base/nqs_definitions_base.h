@@ -14,7 +14,8 @@
 
 // ----------------------------------------------------------		
 
-//#define NQS_USE_GPU						
+// device backend next to the host one - the chains of the RBM and the SR (set by the NQS_USE_GPU option of CMake, see nqs_gpu.h)
+// #define NQS_USE_GPU
 #define NQS_USE_CPU							
 											
 #ifdef NQS_USE_CPU							
@@ -24,11 +25,13 @@
 # 	if defined NQS_USE_MULTITHREADING && not defined NQS_USE_OMP
 #		define NQS_NOT_OMP_MT 
 #	endif
-
-#elif defined NSQ_USE_GPU					
-// something !TODO								
 #endif		
 
+// ----------------------------------------------------------
+
+// distributed training - each MPI rank samples its own chains (set by the NQS_USE_MPI option of CMake)
+// #define NQS_USE_MPI
+
 // ----------------------------------------------------------					
 											
 // shall one update the angles or calculate them from scratch						
@@ -79,6 +82,16 @@ enum NQSTYPES					// #
 };								// #
 // #################################
 
+// ####### NQS PROPOSALS ###########
+enum NQS_PROPOSAL				// #
+{								// #
+	NQS_PROP_FLIP,				// # independent flips of nFlip random sites
+	NQS_PROP_EXCHANGE_NN,		// # exchange of the values on a nearest neighbour bond (conserves the magnetization)
+	NQS_PROP_EXCHANGE_PAIR,		// # exchange of the values on a random pair of sites (conserves the magnetization)
+	NQS_PROP_CLUSTER			// # flip of a connected cluster of nFlip sites
+};								// #
+// #################################
+
 // ##########################################################################################################################################
 
 // all the types that are to be used in each NQS implementation
@@ -93,23 +106,15 @@ enum NQSTYPES					// #
 //////////////////////////////////////////////////////////////////////////////////////////
 
 // Kernel for multithreading
+#include "nqs_executor.h"
+#include "../../algebra/task_scheduler.h"
+#include "nqs_mpi.h"
+#include "nqs_gpu.h"
+#include "nqs_sr_lazy.h"
+#include "nqs_checkpoint.h"
 #ifdef NQS_NOT_OMP_MT
 	#include <functional>
-	#include <condition_variable>
-	#include <future>
-/*
-* @brief structure with condition variables for the NQS to perfom multithread operations
-*/
-template <typename _T>
-struct CondVarKernel
-{
-	std::mutex mutex;
-	std::condition_variable cv;
-	std::atomic<bool> end_	= false;
-	bool flagThreadKill_	= false;
-	bool flagThreadRun_		= false;
-	_T kernelValue_			= 0.0;
-};
+	#include <memory>
 #endif 
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -205,8 +210,7 @@ struct NQS_thread_t
 	int threadNum_					=	1;						// number of threads to be used for the NQS
 	#ifdef NQS_NOT_OMP_MT
 		uint threadsNumLeft_		=	0;						// other threads that are left to be processed
-		std::vector<std::thread> threads_;
-		std::vector<CondVarKernel<_T>> kernels_;				// condition variables for the threads
-		std::mutex mutex;										// global mutex for the threads	
+		std::shared_ptr<NQS_Executor> pool_;					// persistent workers for the parallel kernels
+		std::vector<NQS_ExecPartial<_T>> partial_;				// per-worker partial sums of the kernels
 	#endif
 };
\ No newline at end of file
@@ -13,11 +13,16 @@
 #include <functional>
 #include <memory>
 #include <vector>
+#include <unordered_map>
+#include "nqs_config.h"
 #ifndef NQS_OPERATOR_H
 #	include "../nqs_operator.h"
 #endif
 /////////////////////////////////////////////////////////////
 
+// maximal number of the cached amplitudes of a single lower state (the cache is cleared when it is reached)
+constexpr size_t NQS_LOWER_CACHE_MAX			=		1ULL << 20;
+
 // forward declarations
 template <uint _spinModes, typename _Ht, typename _T, class _stateType>
 class NQS;
@@ -69,6 +74,18 @@ struct NQS_lower_t
     std::vector<arma::Col<_T>> ratios_lower_;                       // calculate this->ansatz(s) / \psi _wj(s) at each MC step (average in the lower states)
     std::vector<arma::Col<_T>> ratios_excited_;                     // calculate \psi _wj(s) / this->ansatz(s) at each MC step
 
+    // shared samples - the frozen lower states are sampled once per iteration, the energy and the gradient reuse them
+    std::vector<_T> meanLower_;                                     // <\psi _w(s') / \psi _wj(s')> over the samples of the lower state j
+    std::vector<_T> excRatio_;                                      // \psi _wj(s) / \psi _w(s) at the current excited state s
+    bool sharedReady_               =       false;                  // meanLower_ corresponds to the current weights of the excited state
+    _T sharedEnergy()               const;
+
+    // cache of the lower state amplitudes - the weights are fixed, log \psi _wj(s) is evaluated once per configuration
+    std::vector<std::unordered_map<NQSConfig, _T>> logCache_;
+    _T excLog_                      =       _T(0.0);                // log \psi _w(s) at the current excited state (shared by all j)
+    _T lowerLog(uint i, Operators::_OP_V_T_CR _v);
+    void setExcited(Operators::_OP_V_T_CR _current_exc_state);
+
     // ##########################################################################################################################################
     
     std::function<_T(Operators::_OP_V_T_CR)> exc_ratio_;            // set later
@@ -98,7 +115,10 @@ inline NQS_lower_t<_spinModes, _Ht, _T, _stateType>::NQS_lower_t(size_t _Ns,
     isSet_(!_f_lower.empty()),
     f_lower_size_(_f_lower.size()),
     f_lower(_f_lower),
-    f_lower_b_(_f_lower_b)    
+    f_lower_b_(_f_lower_b),
+    meanLower_(_f_lower.size(), _T(0.0)),
+    excRatio_(_f_lower.size(), _T(0.0)),
+    logCache_(_f_lower.size())
 {
     // keep empty
     if (!_nqs_exc)
@@ -185,18 +205,69 @@ inline void NQS_lower_t<_spinModes, _Ht, _T, _stateType>::collectLowerRatios(uin
 
     this->f_lower[i]->collect_ratio(this->train_lower_, this->nqs_exc_, this->ratios_lower_[i]);
     // this->f_lower[i]->collect_ratio(this->train_lower_, this->exc_ansatz_, this->ratios_lower_[i]);
+    this->meanLower_[i] = arma::mean(this->ratios_lower_[i]);
 }
 
 // ##########################################################################################################################################
 
+/*
+* @brief Logarithm of the amplitude of the lower state i - cached, since the lower states are frozen during the training.
+* Each lower state has its own map (keyed by the bit-packed configuration), so that the lower states may be processed concurrently.
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline _T NQS_lower_t<_spinModes, _Ht, _T, _stateType>::lowerLog(uint i, Operators::_OP_V_T_CR _v)
+{
+    const NQSConfig _k(_v);
+    auto& _cache = this->logCache_[i];
+    if (auto _it = _cache.find(_k); _it != _cache.end())
+        return _it->second;
+    if (_cache.size() >= NQS_LOWER_CACHE_MAX)
+        _cache.clear();
+    const _T _log = this->ansatzlog(_v, i);
+    _cache.emplace(_k, _log);
+    return _log;
+}
+
+/*
+* @brief Evaluates the excited state at the current configuration once for all the lower states (see collectExcitedRatios)
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS_lower_t<_spinModes, _Ht, _T, _stateType>::setExcited(Operators::_OP_V_T_CR _current_exc_state)
+{
+    if (this->f_lower_size_ != 0)
+        this->excLog_ = this->nqs_exc_->ansatzlog(_current_exc_state);
+}
+
+/*
+* @brief Energy addition of the lower states from the shared samples. The projector estimate factorizes as
+* \beta _j <s|f_j><f_j|psi_w> / <s|psi_w> = \beta _j [\psi _wj(s) / \psi _w(s)] <\psi _w(s') / \psi _wj(s')>_{s' ~ |f_j|^2},
+* so that the lower state samples of the iteration (collectLowerRatios) serve all the excited state configurations.
+* Requires collectExcitedRatios at the current configuration.
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline _T NQS_lower_t<_spinModes, _Ht, _T, _stateType>::sharedEnergy() const
+{
+    _T _en = 0.0;
+    for (uint i = 0; i < this->f_lower_size_; ++i)
+        _en += this->f_lower_b_[i] * this->excRatio_[i] * this->meanLower_[i];
+    return _en;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Ratio \psi _wj(s) / \psi _w(s) of the lower state j and the excited state at the current configuration s.
+* @note setExcited(s) shall be called before (once for all the lower states)
+*/
 template <uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline _T NQS_lower_t<_spinModes, _Ht, _T, _stateType>::collectExcitedRatios(uint i, Operators::_OP_V_T_CR _current_exc_state)
 {
     if (this->f_lower_size_ == 0)
         return _T(0.0);
     
-    // try an ansatz for both at the same time
-    return this->nqs_exc_->ansatz_ratio(_current_exc_state, this->f_lower[i].get());
+    // the excited state is evaluated once (setExcited), the lower state comes from the cache
+    this->excRatio_[i] = std::exp(this->lowerLog(i, _current_exc_state) - this->excLog_);
+    return this->excRatio_[i];
 
     // calculate the ansatz at the current state for the excited state
     // _T _bottom  = this->exc_ansatz_(_current_exc_state);
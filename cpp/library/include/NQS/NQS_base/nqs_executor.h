@@ -0,0 +1,182 @@
+#pragma once
+/***********************************
+* Defines the lightweight task executor
+* for the NQS kernels. The workers are
+* persistent and spin on an epoch counter,
+* the tasks are claimed with an atomic
+* counter, so that a single parallel call
+* does not touch any mutex.
+***********************************/
+
+#ifndef NQS_EXECUTOR_H
+#define NQS_EXECUTOR_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#	include <immintrin.h>
+#	define NQS_EXEC_RELAX() _mm_pause()
+#else
+#	define NQS_EXEC_RELAX() std::this_thread::yield()
+#endif
+
+constexpr unsigned NQS_EXEC_SPIN			= 1u << 14;										// number of spins before the worker falls asleep
+constexpr unsigned NQS_EXEC_CACHE_LINE		= 64;											// padding of the per-thread accumulators
+
+/*
+* @brief Persistent thread pool for the short parallel kernels of the NQS (local energy, lower states, measurements).
+* A call to run() publishes the task by incrementing the epoch, the workers claim the task indices with a single atomic
+* fetch_add and the caller waits on the counter of the unfinished workers. The workers spin for NQS_EXEC_SPIN iterations
+* (none when the machine is oversubscribed) and only then sleep on the epoch (std::atomic::wait), therefore, the notification
+* system call is only made when some of the workers are asleep. The calling thread does not execute the tasks - the workers keep their identities, which
+* allows the architectures to keep the per-thread buffers.
+* The executor is not reentrant - a nested or concurrent call is executed serially on the calling thread.
+*/
+class NQS_Executor
+{
+protected:
+	std::vector<std::thread> workers_;
+	alignas(NQS_EXEC_CACHE_LINE) std::atomic<uint64_t> epoch_	= 0;						// incremented with each published job
+	alignas(NQS_EXEC_CACHE_LINE) std::atomic<unsigned> next_	= 0;						// next task index to be claimed
+	alignas(NQS_EXEC_CACHE_LINE) std::atomic<unsigned> pending_	= 0;						// workers that did not finish the job
+	alignas(NQS_EXEC_CACHE_LINE) std::atomic<unsigned> sleepers_= 0;						// workers waiting on the epoch
+	std::atomic<bool> busy_										= false;					// is the job running?
+	std::atomic<bool> stop_										= false;					// shall the workers exit?
+	unsigned spin_												= NQS_EXEC_SPIN;			// spins before sleeping (no spinning when oversubscribed)
+
+	// currently published job
+	unsigned nTasks_											= 0;
+	void (*call_)(void*, unsigned, unsigned)					= nullptr;
+	void* ctx_													= nullptr;
+
+	/*
+	* @brief Claims and executes the tasks of the current job
+	* @param _id index of the worker
+	*/
+	void drain(unsigned _id)
+	{
+		for (unsigned t = this->next_.fetch_add(1, std::memory_order_relaxed); t < this->nTasks_; t = this->next_.fetch_add(1, std::memory_order_relaxed))
+			this->call_(this->ctx_, t, _id);
+	}
+
+	/*
+	* @brief Main loop of the worker - spins on the epoch, then sleeps
+	* @param _id index of the worker
+	*/
+	void loop(unsigned _id)
+	{
+		uint64_t _seen = 0;
+		while (true)
+		{
+			uint64_t _e = this->epoch_.load(std::memory_order_acquire);
+			for (unsigned s = 0; _e == _seen && s < this->spin_; ++s)
+			{
+				NQS_EXEC_RELAX();
+				_e = this->epoch_.load(std::memory_order_acquire);
+			}
+			if (_e == _seen)
+			{
+				this->sleepers_.fetch_add(1, std::memory_order_seq_cst);
+				this->epoch_.wait(_seen, std::memory_order_seq_cst);
+				this->sleepers_.fetch_sub(1, std::memory_order_relaxed);
+				continue;
+			}
+			_seen = _e;
+			if (this->stop_.load(std::memory_order_acquire))
+				return;
+			this->drain(_id);
+			this->pending_.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+
+public:
+	NQS_Executor()												= default;
+	NQS_Executor(const NQS_Executor&)							= delete;
+	NQS_Executor& operator=(const NQS_Executor&)				= delete;
+	explicit NQS_Executor(unsigned _threads)					{ this->start(_threads);				};
+	~NQS_Executor()												{ this->stop();							};
+
+	auto size()									const -> unsigned	{ return (unsigned)this->workers_.size();	};
+	auto threads()								const -> const std::vector<std::thread>& { return this->workers_;	};
+
+	/*
+	* @brief Starts the workers (stops the previous ones)
+	* @param _threads number of the workers
+	*/
+	void start(unsigned _threads)
+	{
+		this->stop();
+		this->stop_.store(false);
+		this->spin_				= (std::thread::hardware_concurrency() > _threads) ? NQS_EXEC_SPIN : 0;
+		this->workers_.reserve(_threads);
+		for (unsigned i = 0; i < _threads; ++i)
+			this->workers_.emplace_back([this, i]() { this->loop(i); });
+	}
+
+	/*
+	* @brief Stops and joins the workers
+	*/
+	void stop()
+	{
+		if (this->workers_.empty())
+			return;
+		this->stop_.store(true, std::memory_order_release);
+		this->epoch_.fetch_add(1, std::memory_order_seq_cst);
+		this->epoch_.notify_all();
+		for (auto& _w : this->workers_)
+			if (_w.joinable())
+				_w.join();
+		this->workers_.clear();
+	}
+
+	/*
+	* @brief Runs _f(task, worker) for the tasks [0, _nTasks) on the workers and waits for them to finish.
+	* @param _nTasks number of tasks
+	* @param _f callable with the signature void(unsigned task, unsigned worker)
+	*/
+	template <typename _F>
+	void run(unsigned _nTasks, _F&& _f)
+	{
+		bool _free = false;
+		if (this->workers_.empty() || _nTasks == 0 || !this->busy_.compare_exchange_strong(_free, true, std::memory_order_acquire))
+		{
+			for (unsigned t = 0; t < _nTasks; ++t)
+				_f(t, 0);
+			return;
+		}
+
+		// publish the job
+		using _Fn			= std::remove_reference_t<_F>;
+		this->ctx_			= (void*)&_f;
+		this->call_			= [](void* _c, unsigned _t, unsigned _id) { (*static_cast<_Fn*>(_c))(_t, _id); };
+		this->nTasks_		= _nTasks;
+		this->next_.store(0, std::memory_order_relaxed);
+		this->pending_.store((unsigned)this->workers_.size(), std::memory_order_relaxed);
+		this->epoch_.fetch_add(1, std::memory_order_seq_cst);
+		if (this->sleepers_.load(std::memory_order_seq_cst) != 0)
+			this->epoch_.notify_all();
+
+		// wait for the workers
+		for (unsigned s = 0; this->pending_.load(std::memory_order_acquire) != 0; ++s)
+			if (s < this->spin_)
+				NQS_EXEC_RELAX();
+			else
+				std::this_thread::yield();
+		this->busy_.store(false, std::memory_order_release);
+	}
+};
+
+/*
+* @brief Accumulator padded to the cache line - avoids the false sharing of the per-worker partial sums
+*/
+template <typename _T>
+struct alignas(NQS_EXEC_CACHE_LINE) NQS_ExecPartial
+{
+	_T value_ = _T(0.0);
+};
+
+#endif // !NQS_EXECUTOR_H
@@ -0,0 +1,136 @@
+#pragma once
+/***********************************
+* Defines the device backend of the
+* NQS (CUDA, set by the NQS_USE_GPU
+* option of CMake). The chains of the
+* RBM are advanced on the device, the
+* ratios of the connections of the
+* local energy are evaluated in a
+* batch and the SR equation is solved
+* with the derivatives kept on the
+* device (cuBLAS and cuSOLVER). The
+* host types stay the reference. The
+* interface holds only the opaque
+* device pointers - the kernels are in
+* src/nqs_gpu.cu.
+***********************************/
+
+#ifndef NQS_GPU_H
+#define NQS_GPU_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+namespace NQS_GPU
+{
+#ifdef NQS_USE_GPU
+	constexpr bool enabled					= true;
+#else
+	constexpr bool enabled					= false;
+#endif
+
+#ifdef NQS_USE_GPU
+	constexpr unsigned NQS_GPU_THREADS		= 256;										// threads of a single block (one chain or one connection)
+
+	auto devices()							-> int;										// number of the visible devices
+	void select(int _dev);																// device used by the calling thread
+
+	/*
+	* @brief Device storage of a single buffer (owned). The copy is empty - the device state is recreated with the next upload.
+	*/
+	class Buffer
+	{
+	protected:
+		void* ptr_							= nullptr;
+		size_t bytes_						= 0;
+	public:
+		Buffer()							= default;
+		Buffer(const Buffer&)											{};
+		Buffer& operator=(const Buffer&)								{ return *this; };
+		~Buffer();
+
+		void reserve(size_t _bytes);													// grows only
+		void upload(const void* _h, size_t _bytes);
+		void download(void* _h, size_t _bytes)	const;
+		auto get()							const -> void*								{ return this->ptr_;		};
+		auto bytes()						const -> size_t								{ return this->bytes_;		};
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Chains of the RBM on the device - the weights, the states and the angles of all the chains. Each chain is advanced
+	* by a single block of the threads (the threads split the hidden units), the random sites and numbers come from the host
+	* generator, so that the sampling is reproducible.
+	*/
+	template <typename _T>
+	class RBMChains
+	{
+	protected:
+		unsigned nV_						= 0;										// visible units
+		unsigned nH_						= 0;										// hidden units
+		unsigned nC_						= 0;										// chains
+		Buffer W_, bV_, bH_;															// weights (nH x nV), visible and hidden biases
+		Buffer S_, theta_;																// states (nV x nC) and angles (nH x nC)
+		Buffer sites_, rnd_;															// proposals of the block
+		Buffer conn_, ratios_;															// connections of the local energy and their ratios
+	public:
+		void setWeights(const _T* _W, const _T* _bV, const _T* _bH, unsigned _nV, unsigned _nH);
+		void setChains(const double* _S, const _T* _theta, unsigned _nC);
+		void getChains(double* _S, _T* _theta)		const;
+
+		/*
+		* @brief Advances all the chains by _bSize single flip Metropolis steps
+		* @param _sites proposed sites (bSize x nC, the chain is the fastest index)
+		* @param _rnd uniform numbers of the acceptance (the same layout)
+		* @param _spin spin convention of the update (-2v, otherwise 1-2v)
+		*/
+		void sample(unsigned _bSize, const unsigned* _sites, const float* _rnd, bool _spin);
+
+		/*
+		* @brief Ratios of the connections of all the chains at once
+		* @param _chain chain of each connection
+		* @param _fP flipped sites (_maxFlips per connection, -1 - unused)
+		* @param _d changes of the visible units (the same layout)
+		* @param _nConn number of the connections
+		* @param _maxFlips stride of _fP and _d
+		* @param _out ratios of the amplitudes
+		*/
+		void ratios(const int* _chain, const int* _fP, const double* _d, size_t _nConn, unsigned _maxFlips, _T* _out);
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief SR on the device - the centered derivatives O (N x P) are uploaded once per step and the solvers run without the
+	* transfers of the vectors of the parameters (only the solution is downloaded):
+	*	- CG	- Jacobi preconditioned conjugate gradient with (S + reg) x = O^H (O x) / N + reg x (cuBLAS),
+	*	- MinSR	- x = O^H (O O^H / N + reg)^{-1} v with the Cholesky factorization of the kernel (cuSOLVER).
+	*/
+	template <typename _T>
+	class SR
+	{
+	protected:
+		unsigned N_							= 0;										// samples
+		unsigned P_							= 0;										// parameters
+		double nSamples_					= 1.0;										// normalization of S
+		Buffer O_, work_, lwork_;														// derivatives, vectors of the solvers, workspace of cuSOLVER
+		void* blas_							= nullptr;									// cublasHandle_t
+		void* solver_						= nullptr;									// cusolverDnHandle_t
+		void handles();
+	public:
+		SR()								= default;
+		SR(const SR&)													{};
+		SR& operator=(const SR&)										{ return *this; };
+		~SR();
+
+		void set(const _T* _Oc, unsigned _N, unsigned _P, double _nSamples);
+		void force(const _T* _v, _T* _y);
+		auto solveCG(const _T* _F, const _T* _diag, double _reg, double _tol, unsigned _maxIter, _T* _x, unsigned& _iters) -> bool;
+		auto solveMinSR(const _T* _v, double _reg, _T* _x) -> bool;
+	};
+#endif // NQS_USE_GPU
+};
+
+#endif // !NQS_GPU_H
@@ -0,0 +1,182 @@
+#pragma once
+/***********************************
+* Defines the communication layer of
+* the distributed NQS training. Each
+* rank samples its own chains, only the
+* reductions of the estimators and the
+* broadcast of the weights are global.
+* Without NQS_USE_MPI all the calls are
+* the identities of a single rank.
+***********************************/
+
+#ifndef NQS_MPI_H
+#define NQS_MPI_H
+
+#include <complex>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef NQS_USE_MPI
+#	include <mpi.h>
+#endif
+
+constexpr uint64_t NQS_MPI_SEED_STRIDE		= 0x9E3779B97F4A7C15ull;						// offset of the seeds of the consecutive ranks
+
+namespace NQS_MPI
+{
+#ifdef NQS_USE_MPI
+	/*
+	* @brief Initializes MPI (once) - the threads of the executor never communicate, therefore, MPI_THREAD_FUNNELED suffices
+	*/
+	inline void init()
+	{
+		int _init = 0;
+		MPI_Initialized(&_init);
+		if (!_init)
+		{
+			int _provided = 0;
+			MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &_provided);
+		}
+	}
+
+	/*
+	* @brief Finalizes MPI (if it was initialized and is not finalized yet)
+	*/
+	inline void finalize()
+	{
+		int _init = 0, _fin = 0;
+		MPI_Initialized(&_init);
+		MPI_Finalized(&_fin);
+		if (_init && !_fin)
+			MPI_Finalize();
+	}
+
+	inline int rank()						{ init(); int _r = 0; MPI_Comm_rank(MPI_COMM_WORLD, &_r); return _r;	};
+	inline int size()						{ init(); int _s = 1; MPI_Comm_size(MPI_COMM_WORLD, &_s); return _s;	};
+
+	/*
+	* @brief MPI datatype of the element - the complex numbers are reduced as the pairs of the real ones
+	*/
+	template <typename _T>
+	inline MPI_Datatype type()
+	{
+		if constexpr (std::is_same_v<_T, std::complex<double>>)
+			return MPI_C_DOUBLE_COMPLEX;
+		else if constexpr (std::is_same_v<_T, std::complex<float>>)
+			return MPI_C_FLOAT_COMPLEX;
+		else if constexpr (std::is_same_v<_T, float>)
+			return MPI_FLOAT;
+		else if constexpr (std::is_same_v<_T, uint64_t>)
+			return MPI_UINT64_T;
+		else
+			return MPI_DOUBLE;
+	}
+
+	/*
+	* @brief In-place sum of the buffer over all the ranks
+	*/
+	template <typename _T>
+	inline void sum(_T* _x, size_t _n)
+	{
+		if (size() > 1 && _n > 0)
+			MPI_Allreduce(MPI_IN_PLACE, (void*)_x, (int)_n, type<_T>(), MPI_SUM, MPI_COMM_WORLD);
+	}
+
+	/*
+	* @brief Broadcasts the buffer from the root (rank 0)
+	*/
+	template <typename _T>
+	inline void bcast(_T* _x, size_t _n)
+	{
+		if (size() > 1 && _n > 0)
+			MPI_Bcast((void*)_x, (int)_n, type<_T>(), 0, MPI_COMM_WORLD);
+	}
+#else
+	inline void init()						{};
+	inline void finalize()					{};
+	inline int rank()						{ return 0;	};
+	inline int size()						{ return 1;	};
+
+	template <typename _T>
+	inline void sum(_T*, size_t)			{};
+	template <typename _T>
+	inline void bcast(_T*, size_t)			{};
+#endif
+
+	inline bool isRoot()					{ return rank() == 0;	};
+	inline bool distributed()				{ return size() > 1;	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Sum of the scalar over all the ranks
+	*/
+	template <typename _T>
+	inline _T sum(_T _x)
+	{
+		sum(&_x, 1);
+		return _x;
+	}
+
+	/*
+	* @brief In-place sum of the Armadillo object (vector or matrix, contiguous) over all the ranks
+	*/
+	template <typename _M>
+	inline void sumInPlace(_M& _x)
+	{
+		sum(_x.memptr(), (size_t)_x.n_elem);
+	}
+
+	/*
+	* @brief Broadcasts the Armadillo object from the root - the size shall already agree on all the ranks
+	*/
+	template <typename _M>
+	inline void bcastInPlace(_M& _x)
+	{
+		bcast(_x.memptr(), (size_t)_x.n_elem);
+	}
+
+	/*
+	* @brief Returns the mean over the samples of all the ranks
+	* @param _x samples of this rank
+	* @param _n number of the samples of all the ranks (see count)
+	*/
+	template <typename _V>
+	inline auto mean(const _V& _x, double _n) -> typename _V::elem_type
+	{
+		return sum<typename _V::elem_type>(arma::accu(_x)) / _n;
+	}
+
+	/*
+	* @brief Mean of the rows (samples) over all the ranks - e.g. the mean of the derivatives
+	*/
+	template <typename _M>
+	inline auto meanRows(const _M& _x, double _n) -> arma::Row<typename _M::elem_type>
+	{
+		arma::Row<typename _M::elem_type> _m = arma::sum(_x, 0);
+		sumInPlace(_m);
+		return _m / _n;
+	}
+
+	/*
+	* @brief Number of the samples of all the ranks
+	*/
+	inline double count(size_t _n)
+	{
+		return sum<double>((double)_n);
+	}
+
+	/*
+	* @brief Returns the seed of this rank - the root seed is broadcast and shifted by the rank, so that the chains
+	* of the different ranks are independent but the run is reproducible
+	* @param _seed seed proposed by this rank (only the root one is used)
+	*/
+	inline uint64_t seed(uint64_t _seed)
+	{
+		bcast(&_seed, 1);
+		return _seed + (uint64_t)rank() * NQS_MPI_SEED_STRIDE;
+	}
+};
+
+#endif // !NQS_MPI_H
@@ -23,17 +23,29 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::gradFinal(const NQSB& _energie
 {
 	// calculate current learning rate based on the scheduler
 	this->info_p_.lr_ = this->info_p_.lr(_step, algebra::real(_currLoss));
-	const _T _samples = static_cast<_T>(_energies.n_elem);
+	// when distributed, the samples of all the ranks count (the derivatives stay local)
+	const double _nGlobal = this->distributed_ ? NQS_MPI::count(_energies.n_elem) : (double)_energies.n_elem;
+	const _T _samples = static_cast<_T>(_nGlobal);
 	// calculate the derivatives 
 	{
 		// calculate the covariance derivatives <\Delta _k* E_{loc}> - <\Delta _k*><E_{loc}> 
 		// [+ sum_i ^{n-1} \beta _i <(Psi_W(i) / Psi_W - <Psi_W(i)/Psi>) \Delta _k*> <Psi _W/Psi_W(i)>] 
 		// - for the excited states, the derivatives are appe	
 		// calculate the centered derivatives
-		this->derivativesMean_ 			= arma::mean(this->derivatives_, 0);									// calculate the mean of the derivatives
+		if (this->distributed_)
+			this->derivativesMean_		= NQS_MPI::meanRows(this->derivatives_, _nGlobal);						// mean of the derivatives over all the ranks
+		else
+			this->derivativesMean_ 		= arma::mean(this->derivatives_, 0);									// calculate the mean of the derivatives
+#ifdef NQS_USESR_NOMAT_USED
+		if (this->srMode_ == NQS_SR_SOLVER)
+			this->derivativesCentered_ 	= this->derivatives_.each_row() - this->derivativesMean_;				// calculate the centered derivatives
+		// the weights of the samples - F = O^H v, the matrix-free engine needs v itself (MinSR)
+		this->srVec_					= (_energies - _currLoss) / _samples;
+#else
 		this->derivativesCentered_ 		= this->derivatives_.each_row() - this->derivativesMean_;				// calculate the centered derivatives
 		this->derivativesCenteredH_		= this->derivativesCentered_.t();										// calculate the transposed centered derivatives
 		this->F_						= this->derivativesCenteredH_ * ((_energies - _currLoss) / _samples);	// calculate the covariance vector for the gradient 
+#endif
 
 	// #pragma omp parallel for num_threads(this->threads_.threadNum_)
 		for (int _low = 0; _low < this->lower_states_.f_lower_size_; _low++)			// append with the lower states derivatives - if the lower states are used
@@ -42,10 +54,37 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::gradFinal(const NQSB& _energie
 			const auto& ratios_excited	= this->lower_states_.ratios_excited_[_low];	// <Psi_W_j / Psi_W> evaluated at W - column vector
 			const auto& ratios_lower 	= this->lower_states_.ratios_lower_[_low];		// <Psi_W / Psi_W_j> evaluated at W_j - column vector
 			const auto& f_lower_b 		= this->lower_states_.f_lower_b_[_low];			// penalty for the lower states 
-			const _T _meanLower 		= arma::mean(ratios_lower);						// mean of the ratios in the lower state
-			const _T _meanExcited 		= arma::mean(ratios_excited);					// mean of the ratios in the excited state
+			const _T _meanLower 		= this->distributed_ ? NQS_MPI::mean(ratios_lower, NQS_MPI::count(ratios_lower.n_elem)) 
+															 : arma::mean(ratios_lower);	// mean of the ratios in the lower state
+			const _T _meanExcited 		= this->distributed_ ? NQS_MPI::mean(ratios_excited, _nGlobal) 
+															 : arma::mean(ratios_excited);	// mean of the ratios in the excited state
+#ifdef NQS_USESR_NOMAT_USED
+			this->srVec_				+= (ratios_excited - _meanExcited) * (f_lower_b * _meanLower / _samples);
+#else
 			this->F_ 					+= this->derivativesCenteredH_ * ((ratios_excited - _meanExcited) * (f_lower_b * _meanLower / _samples));
+#endif
 		}
+
+#ifdef NQS_USESR_NOMAT_USED
+		if (this->srMode_ != NQS_SR_SOLVER)
+		{
+			// the centered derivatives are kept only once, in the engine (and possibly in the single precision) - O^H is never formed
+			this->srLazy_.set(this->derivatives_, this->derivativesMean_);
+			this->derivativesCentered_.reset();
+			this->derivativesCenteredH_.reset();
+			this->F_					= this->srLazy_.force(this->srVec_);
+		}
+		else
+		{
+			this->derivativesCenteredH_	= this->derivativesCentered_.t();										// calculate the transposed centered derivatives
+			this->F_					= this->derivativesCenteredH_ * this->srVec_;							// calculate the covariance vector for the gradient 
+			if (this->distributed_)
+				NQS_MPI::sumInPlace(this->F_);
+		}
+#else
+		if (this->distributed_)
+			NQS_MPI::sumInPlace(this->F_);																		// F = \sum _ranks O_r^H v_r
+#endif
 	}
 	// fix the NANs
 	// if (!arma::is_finite(this->F_)) {
@@ -58,6 +97,8 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::gradFinal(const NQSB& _energie
 	// update model by recalculating the gradient (applying the stochastic reconfiguration)
 	// this->S_ = arma::cov(this->derivativesC_, this->derivatives_, 1);
 	this->S_ = this->derivativesCenteredH_ * this->derivativesCentered_ / _samples;
+	if (this->distributed_)
+		NQS_MPI::sumInPlace(this->S_);																			// S = \sum _ranks O_r^H O_r / N
 	
 	// check the norm of the gradient and normalize it if needed
 	// if (auto gradNorm = arma::norm(this->F_); gradNorm > NQS_SREG_GRAD_NORM_THRESHOLD)
@@ -0,0 +1,61 @@
+#pragma once
+/***********************************
+* Defines the precision policies of
+* the NQS ansatze. The parameters, the
+* energies and the SR always stay in
+* the type of the network; the mixed
+* policy keeps the single precision
+* copies of the quantities read by the
+* hot kernels of the sampling.
+***********************************/
+
+#ifndef NQS_PRECISION_H
+#define NQS_PRECISION_H
+
+#include <complex>
+
+// store the copies used by the acceptance ratios of the sampling in a single precision (float / complex<float>)
+// #define NQS_MIXED_PRECISION
+
+namespace NQSPrecision
+{
+	template <typename _T>
+	struct Low										{ using type = _T;					};
+	template <>
+	struct Low<double>								{ using type = float;				};
+	template <>
+	struct Low<std::complex<double>>				{ using type = std::complex<float>;	};
+
+	/*
+	* @brief Full precision - the kernels read the parameters directly
+	*/
+	template <typename _T>
+	struct Full
+	{
+		using param_t								= _T;
+		using kernel_t								= _T;
+		static constexpr bool mixed					= false;
+	};
+
+	/*
+	* @brief Mixed precision - the kernels of the Metropolis acceptance read the single precision copies of the weights and
+	* the angles (half of the memory traffic, twice the SIMD width), the accumulations are carried in param_t
+	*/
+	template <typename _T>
+	struct Mixed
+	{
+		using param_t								= _T;
+		using kernel_t								= typename Low<_T>::type;
+		static constexpr bool mixed					= true;
+	};
+
+#ifdef NQS_MIXED_PRECISION
+	template <typename _T>
+	using Default									= Mixed<_T>;
+#else
+	template <typename _T>
+	using Default									= Full<_T>;
+#endif
+};
+
+#endif // !NQS_PRECISION_H
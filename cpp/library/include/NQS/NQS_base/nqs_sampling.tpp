@@ -16,6 +16,7 @@
 template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline void NQS<_spinModes, _Ht, _T, _stateType>::blockSample(uint _bSize, NQS_STATE_T _start, bool _therm)
 {
+	PROF_SCOPE(SAMPLE);
 	// check whether we should set a state again or thermalize the whole process (applies on integer state)
 	// Set state based on whether thermalization is required or _start differs from current state
 	if (_therm 
@@ -24,13 +25,21 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::blockSample(uint _bSize, NQS_S
 #endif
 		) this->setState(_start, _therm);
 
-	// set the temporary state - the vectors are usefull so set them accordingly
+#ifndef NQS_ANGLES_UPD
+	// set the temporary state - the ratio from scratch needs the flipped vector (the angles update works with the flips only)
 	this->tmpVec_ = this->curVec_;
+#endif
 
 	for (uint bStep = 0; bStep < _bSize; ++bStep) // go through each block step
 	{
 		this->chooseRandomFlips(); 	// set the random flip sites - it depends on a given implementation of the NQS
+		if (this->nullMove_)		// the proposal does not change the state - counts as the rejected step
+			continue;
+#ifndef NQS_ANGLES_UPD
 		this->applyFlipsT();		// flip the vector - use temporary vector tmpVec to store the flipped vector
+#endif
+		PROF_COUNT(PROPOSED, 1);
+		PROF_COUNT(PRATIO, 1);
 
 		// check the probability (choose to use the iterative update of presaved weights [the angles previously updated] or calculate ratio from scratch)
 #ifndef NQS_ANGLES_UPD
@@ -45,12 +54,15 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::blockSample(uint _bSize, NQS_S
 			this->applyFlipsC();
 			// update angles if needed
 			this->update(this->nFlip_);
+			PROF_COUNT(ACCEPTED, 1);
 		}
 		else
 		{
 			// set the vector back to normal (unflip)
 			this->unupdate();
+#ifndef NQS_ANGLES_UPD
 			this->unapplyFlipsT();
+#endif
 		}
 	}
 
@@ -67,10 +79,228 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::blockSample(uint _bSize, NQS_S
 
 // ##########################################################################################################################################
 
+// ########################################################## P R O P O S A L S #############################################################
+
+// ##########################################################################################################################################
+
+/*
+* @brief Sets the proposal kernel of the Metropolis sampler (see NQS_PROPOSAL). The exchange proposals conserve the magnetization,
+* therefore, the random states are then drawn from the zero magnetization sector. The exchange of equal values is a null move, so that
+* the proposal stays symmetric. The lattice proposals (nearest neighbour exchange and the clusters) need the lattice of the Hamiltonian -
+* without it the single flips are used.
+* @param _proposal proposal kernel
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setProposal(int _proposal)
+{
+	this->proposal_ = _proposal;
+	this->bonds_.clear();
+	this->neighbors_.clear();
+	if (_proposal == NQS_PROP_EXCHANGE_NN || _proposal == NQS_PROP_CLUSTER)
+	{
+		auto _lat = this->H_->getLat();
+		if (_lat)
+		{
+			this->neighbors_.resize(this->info_p_.nVis_);
+			for (uint _site = 0; _site < (uint)_lat->get_Ns(); ++_site)
+			{
+				for (uint nn = 0; nn < (uint)_lat->get_nn_ForwardNum(_site); ++nn)
+				{
+					uint N_NUMBER = _lat->get_nn_ForwardNum(_site, nn);
+					if (int nei = _lat->get_nn(_site, N_NUMBER); nei >= 0 && (uint)nei != _site)
+					{
+						this->bonds_.push_back(std::make_pair(_site, (uint)nei));
+						this->neighbors_[_site].push_back((uint)nei);
+						this->neighbors_[nei].push_back(_site);
+					}
+				}
+			}
+		}
+		if (this->bonds_.empty())
+		{
+			LOGINFO("The lattice proposals need the nearest neighbours. Using the single flips.", LOG_TYPES::WARNING, 3);
+			this->proposal_ = NQS_PROP_FLIP;
+		}
+	}
+	this->setRandomFlipNum(this->nFlip_);
+	LOGINFO("Using the proposal kernel: " + STR(this->proposal_) + " with " + STR(this->nFlip_) + " sites.", LOG_TYPES::CHOICE, 3);
+}
+
+// ##########################################################################################################################################
+
+// ############################################################## C H A I N S ###############################################################
+
+// ##########################################################################################################################################
+
+/*
+* @brief Sets the number of independent Markov chains that are advanced together during the training. Each chain provides
+* a single sample of the block, so that _nChains samples are produced with a single sampling sweep. The per-chain estimators
+* (gradient and local energy) are then evaluated concurrently when the architecture allows it (see chainsParallel).
+* @param _nChains number of chains (1 - standard single chain sampling)
+* @param _threads number of threads used for the per-chain estimators (0 - the same as for the local energy)
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setChains(uint _nChains, uint _threads)
+{
+	if (_nChains > 1 && this->lower_states_.f_lower_size_ != 0)
+	{
+		LOGINFO("Multiple chains are not supported with the excited states. Using a single chain.", LOG_TYPES::WARNING, 3);
+		_nChains = 1;
+	}
+	this->nChains_		= std::max(_nChains, (uint)1);
+	this->chainThreads_	= _threads == 0 ? (uint)this->threads_.threadNum_ : _threads;
+	if (this->nChains_ > 1)
+	{
+		this->setRandomChains();
+		LOGINFO("Using " + STR(this->nChains_) + " Markov chains with " + STR(this->chainThreads_) + " threads.", LOG_TYPES::CHOICE, 3);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Sets random states for all the chains.
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setRandomChains()
+{
+	this->chains_.set_size(this->info_p_.nVis_, this->nChains_);
+	NQSS _tmp(this->info_p_.nVis_);
+	for (uint c = 0; c < this->nChains_; ++c)
+	{
+		INT_TO_BASE(this->randomStateInt(), _tmp, this->discVal_);
+		this->chains_.col(c) = _tmp;
+	}
+	this->setChainsTheta();
+}
+
+///////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Advances all the chains by _bSize Metropolis steps. The general version loads each chain to the current state and
+* uses the single chain sampler - architectures override it with the vectorised update of all the chains at once.
+* @param _bSize number of Metropolis steps for each chain
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::blockSampleChains(uint _bSize)
+{
+	for (uint c = 0; c < this->nChains_; ++c)
+	{
+		this->setState(NQSS(this->chains_.col(c)), true);
+		this->blockSample(_bSize, NQS_STATE, false);
+		this->chains_.col(c) = this->curVec_;
+	}
+	this->setChainsTheta();
+}
+
+///////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the variational derivatives for the chain _c (general version - loads the chain to the current state).
+* @param _c index of the chain
+* @param _plc row at which to store the derivatives
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::gradChain(uint _c, uint _plc)
+{
+	this->setState(NQSS(this->chains_.col(_c)), true);
+	this->grad(this->curVec_, _plc);
+}
+
+///////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the local energy for the chain _c (general version - loads the chain to the current state).
+* @param _c index of the chain
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnKernelChain(uint _c)
+{
+	this->setState(NQSS(this->chains_.col(_c)), true);
+	return this->locEnKernel();
+}
+
+///////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Samples the chains and stores the gradients and the local energies of the samples
+* [_start, _start + min(nChains, size(_En) - _start)). The chains are advanced together and the estimators are evaluated
+* in parallel over the chains when this is possible - this gives nChains items of work instead of the nSites of the local energy kernel.
+* @param _bSize number of Metropolis steps for each chain
+* @param _start first row of the derivatives (and element of _En) to be filled
+* @param _En container for the local energies
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::sampleChains(uint _bSize, uint _start, arma::Col<_T>& _En)
+{
+	const int _n = (int)std::min<uint>(this->nChains_, (uint)_En.n_elem - _start);
+	this->blockSampleChains(_bSize);
+
+	// the architectures may evaluate the local energies of all the chains in a single batch (e.g. on the device)
+	const bool _batch = this->locEnChainsBatch((uint)_n, _En.memptr() + _start);
+
+	if (this->chainsParallel())
+	{
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->chainThreads_)
+#endif
+		for (int c = 0; c < _n; ++c)
+		{
+			this->gradChain(c, _start + c);
+			if (!_batch)
+				_En(_start + c) = this->locEnKernelChain(c);
+		}
+	}
+	else
+	{
+		for (int c = 0; c < _n; ++c)
+		{
+			this->gradChain(c, _start + c);
+			if (!_batch)
+				_En(_start + c) = this->locEnKernelChain(c);
+		}
+	}
+}
+
+// ##########################################################################################################################################
+
 // ########################################################## L O C   E N E R G Y ###########################################################
 
 // ##########################################################################################################################################
 
+/*
+* @brief Energy addition of the lower states at the current configuration. During the training the lower states are sampled once
+* per iteration and the addition follows from the cached ratios (see NQS_lower_t::sharedEnergy), otherwise the projectors are
+* estimated with the samples of each lower state.
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnLower()
+{
+	if (this->lower_states_.sharedReady_)
+		return this->lower_states_.sharedEnergy();
+
+	// set new projector (\sum _{s'} <s|psi_wl><psi_wl|s'>) = \sum _{s'} \frac{\psi _w(s')}{\psi _w(s)} \times \frac{\psi _wl(s)}{\psi _wl(s')} \times proba_wl(s', s)
+	this->lower_states_.setProjector(NQS_STATE);
+	_T energy = 0.0;
+#ifdef NQS_NOT_OMP_MT
+	auto& _partial = this->threads_.partial_;
+	for (auto& _p : _partial)
+		_p.value_ = 0.0;
+	this->parallelFor(this->lower_states_.f_lower_size_, [&](uint _low, uint _worker)
+		{
+			_partial[_worker].value_ += this->lower_states_.collectLowerEnergy(_low);
+		});
+	for (const auto& _p : _partial)
+		energy += _p.value_;
+#else
+	for (uint _low = 0; _low < this->lower_states_.f_lower_size_; ++_low)
+		energy += this->lower_states_.collectLowerEnergy(_low);
+#endif
+	return energy;
+}
+
+// ##########################################################################################################################################
+
 /*
 * @brief Calculate the local energy depending on the given Hamiltonian - kernel with OpenMP is used
 * when the omp pragma NQS_USE_OMP is set or multithreading is not used, otherwise threadpool is used
@@ -79,6 +309,7 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::blockSample(uint _bSize, NQS_S
 template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnKernel()
 {	
+	PROF_SCOPE(LOCEN);
 #ifdef NQS_USE_OMP
 	{
 		double energyR	= 0.0;
@@ -102,38 +333,46 @@ inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnKernel()
 	}
 #else
 	{
-		_T energy = 0.0;
-		for (int _thread = 0; _thread < this->threads_.threadNum_; _thread++) // run all threads
+		// without the workers gather the connections of all the sites and calculate the ratios in a single batch
+		if (this->useConn_ && (!this->threads_.pool_ || this->threads_.pool_->size() == 0))
 		{
-			std::lock_guard<std::mutex> lock(this->threads_.kernels_[_thread].mutex);
-			this->threads_.kernels_[_thread].flagThreadRun_	= true;
-			this->threads_.kernels_[_thread].end_			= false;
-			this->threads_.kernels_[_thread].cv.notify_one();
-		}
+			auto& _buf		= this->connBuf_[0];
+			this->connAll_.clear();
 
-		for (int _thread = 0; _thread < this->threads_.threadNum_; _thread++) // wait for all threads
-		{
+			// the diagonal part is evaluated once for the whole configuration (if the model provides it)
+			const bool _diag = this->H_->hasDiagonal();
+			_buf.setOffDiagOnly(_diag);
+			for (uint _site = 0; _site < this->info_p_.nSites_; ++_site)
 			{
-				std::unique_lock<std::mutex> lock(this->threads_.kernels_[_thread].mutex);
-				this->threads_.kernels_[_thread].cv.wait(lock, [this, _thread] { return !this->threads_.kernels_[_thread].flagThreadRun_; });
+				this->locEnEmit(NQS_STATE, _site, _buf);
+				this->connAll_.append(_buf);
 			}
-			energy += this->threads_.kernels_[_thread].kernelValue_;
+			_buf.setOffDiagOnly(false);
+			if (_diag)
+				this->connAll_.addDiag(this->H_->diagonal(NQS_STATE));
+			PROF_COUNT(PRATIO, this->connAll_.size());
+			const _T _en	= algebra::cast<_T>(this->connAll_.contract(this->pRatioBatch(this->connAll_)));
+			return this->lower_states_.f_lower_size_ != 0 ? _en + this->locEnLower() : _en;
 		}
 
+		// split the sites over the workers, each worker accumulates into its own padded slot
+		auto& _partial = this->threads_.partial_;
+		for (auto& _p : _partial)
+			_p.value_ = 0.0;
+		this->parallelFor(this->info_p_.nSites_, [&](uint _site, uint _worker) 
+			{
+				if (this->useConn_)
+					_partial[_worker].value_	+= this->locEnSite(_site, this->connBuf_[_worker]);
+				else
+					_partial[_worker].value_	+= algebra::cast<_T>(this->H_->locEnergy(NQS_STATE, _site, this->pKernelFunc_));
+			});
+		_T energy = 0.0;
+		for (const auto& _p : _partial)
+			energy += _p.value_;
+
 		// for the lower states - only if the lower states are used
 		if (this->lower_states_.f_lower_size_ != 0) 
-		{
-			// set new projector (\sum _{s'} <s|psi_wl><psi_wl|s'>) = \sum _{s'} \frac{\psi _w(s')}{\psi _w(s)} \times \frac{\psi _wl(s)}{\psi _wl(s')} \times proba_wl(s', s)
-			this->lower_states_.setProjector(NQS_STATE);
-
-			_T _elower = 0.0;
-#ifndef _DEBUG 
-# 	pragma omp parallel for num_threads(this->threads_.threadNum_)
-#endif
-			for (int _low = 0; _low < this->lower_states_.f_lower.size(); _low++)
-				_elower += this->lower_states_.collectLowerEnergy(_low);
-			energy += _elower;
-		}
+			energy += this->locEnLower();
 
 		return energy;
 	}
@@ -142,53 +381,72 @@ inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnKernel()
 
 ///////////////////////////////////////////////////////////////////////
 
-#ifdef NQS_NOT_OMP_MT
 /*
-* @brief Allows to run a thread pool based on the condition that all threads wait for a mutex to further run the program.
-* The threads are killed when the program is finished. The function calculates the local energy for a given thread.
-* @param _start starting site for a given thread
-* @param _end ending site for a given thread
-* @param _threadNum number of the thread currently run
+* @brief Calculates the local energy contribution from the connections of a single site (general version - uses the probability
+* ratio with the flips provided). The architectures override it with the statically dispatched ratios.
+* @param _buf connections emitted by the Hamiltonian for the current state
 */
 template<uint _spinModes, typename _Ht, typename _T, class _stateType>
-inline void NQS<_spinModes, _Ht, _T, _stateType>::locEnKernel(uint _start, uint _end, uint _threadNum)
+inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnConn(const LocEnBuffer& _buf)
 {
-	while (!this->threads_.kernels_[_threadNum].flagThreadKill_)	// does not go in if the simulation is finished
-	{
-		// wait for the lock to end
+	return algebra::cast<_T>(_buf.evaluate([this](const LocEnConn& _c) -> cpx 
 		{
-			// aquire mutex lock as required by condition variable
-			std::unique_lock<std::mutex> lock(this->threads_.kernels_[_threadNum].mutex);	
-			// thread will suspend here and release the lock if the expression does not return true
-			this->threads_.kernels_[_threadNum].cv.wait(lock, [this, _threadNum] { return this->threads_.kernels_[_threadNum].flagThreadRun_; });	
+			return (_c.n_ == 1) ? this->pRatio({ _c.fP_[0] }, { _c.fV_[0] }) : this->pRatio({ _c.fP_[0], _c.fP_[1] }, { _c.fV_[0], _c.fV_[1] });
+		}));
+}
 
-			if (this->threads_.kernels_[_threadNum].flagThreadKill_)
-			{
-				this->threads_.kernels_[_threadNum].end_ = true;
-				break;
-			}
-		}
+///////////////////////////////////////////////////////////////////////
 
-		// Process the work
-		this->threads_.kernels_[_threadNum].kernelValue_ = 0.0;
-		for (auto site = _start; site < _end; ++site)
-		{
-			// this->threads_.kernels_[_threadNum].kernelValue_ += algebra::cast<_T>(this->H_->locEnergy(NQS_STATE,
-			// 																				site, 
-			// 																				std::bind(&NQS<_spinModes, _Ht, _T, _stateType>::pKernel,
-			// 																				this,
-			// 																				std::placeholders::_1,
-			// 																				std::placeholders::_2)));
-			this->threads_.kernels_[_threadNum].kernelValue_ += algebra::cast<_T>(this->H_->locEnergy(NQS_STATE, site, this->pKernelFunc_));
-		}
+/*
+* @brief Local energy contribution of a single site - the connections of the Hamiltonian contracted with the ratios. Both
+* calls are virtual here, the pairs of NQS_Pair resolve them at compile time.
+* @param _site site of the connections
+* @param _buf buffer of the calling worker
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline _T NQS<_spinModes, _Ht, _T, _stateType>::locEnSite(uint _site, LocEnBuffer& _buf)
+{
+	this->H_->locEnergyConn(NQS_STATE, _site, _buf);
+	return this->locEnConn(_buf);
+}
 
-		// lock again
-		{
-			std::lock_guard<std::mutex> lock(this->threads_.kernels_[_threadNum].mutex);
-			this->threads_.kernels_[_threadNum].flagThreadRun_	= false;
-			this->threads_.kernels_[_threadNum].end_				= true; 
-		}
-		this->threads_.kernels_[_threadNum].cv.notify_one(); // Notify waiting threads if needed
+///////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the probability ratios for all the connections of the current state (general version - one call
+* of the probability ratio for each connection). The architectures override it with a single batched update.
+* @param _conn list of the connections (one or two flips each)
+* @returns ratios in the order of the connections
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline typename NQS<_spinModes, _Ht, _T, _stateType>::NQSB NQS<_spinModes, _Ht, _T, _stateType>::pRatioBatch(const ConnList& _conn)
+{
+	NQSB _out(_conn.size());
+	for (size_t k = 0; k < _conn.size(); ++k)
+	{
+		const auto& _c	= _conn[k];
+		_out(k)			= (_c.n_ == 1) ? this->pRatio({ _c.fP_[0] }, { _c.fV_[0] }) : this->pRatio({ _c.fP_[0], _c.fP_[1] }, { _c.fV_[0], _c.fV_[1] });
 	}
+	return _out;
+}
+
+///////////////////////////////////////////////////////////////////////
+
+#ifdef NQS_NOT_OMP_MT
+/*
+* @brief Runs the tasks [0, _n) on the persistent workers of the NQS (see NQS_Executor). The callable receives the index
+* of the task and the index of the worker, the latter can be used to address the per-worker accumulators (threads_.partial_).
+* @param _n number of tasks
+* @param _f callable void(uint task, uint worker)
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+template<typename _F>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::parallelFor(uint _n, _F&& _f)
+{
+	if (this->threads_.pool_)
+		this->threads_.pool_->run(_n, std::forward<_F>(_f));
+	else
+		for (uint t = 0; t < _n; ++t)
+			_f(t, 0);
 }
 #endif
\ No newline at end of file
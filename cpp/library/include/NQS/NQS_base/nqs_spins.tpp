@@ -25,10 +25,13 @@ public:
 protected:
 	// -------------------------- F L I P S --------------------------
 	virtual void chooseRandomFlips()			override;
+	void chooseExchange(uint _i, uint _j);
+	void chooseCluster();
+	virtual auto randomStateInt()				-> u64 override;
 
 	// apply flips to the temporary vector or the current vector according the template
 	virtual void applyFlipsT()					override { for (auto& i : this->flipPlaces_) flip(this->tmpVec_, i, 0, this->discVal_);	};
-	virtual void applyFlipsC()					override { for (auto& i : this->flipPlaces_) flip(this->curVec_, i, 0, this->discVal_);	};
+	virtual void applyFlipsC()					override { for (auto& i : this->flipPlaces_) { flip(this->curVec_, i, 0, this->discVal_); this->curBits_.flip(i); } };
 	virtual void setRandomFlipNum(uint _nFlips) override;
 };
 
@@ -40,6 +43,26 @@ protected:
 template<typename _Ht, typename _T, class _stateType>
 inline void NQS_S<2, _Ht, _T, _stateType>::chooseRandomFlips()
 {
+	this->nullMove_ = false;
+	switch (this->proposal_)
+	{
+	case NQS_PROP_EXCHANGE_NN:
+	{
+		const auto& _bond	= this->bonds_[this->ran_.template randomInt<uint>(0, (uint)this->bonds_.size())];
+		return this->chooseExchange(_bond.first, _bond.second);
+	}
+	case NQS_PROP_EXCHANGE_PAIR:
+	{
+		const uint _i		= this->ran_.template randomInt<uint>(0, this->info_p_.nVis_);
+		uint _j				= this->ran_.template randomInt<uint>(0, this->info_p_.nVis_ - 1);
+		return this->chooseExchange(_i, _j >= _i ? _j + 1 : _j);
+	}
+	case NQS_PROP_CLUSTER:
+		return this->chooseCluster();
+	default:
+		break;
+	}
+
 	// go through the vector elements
 	for (auto i = 0; i < this->flipPlaces_.size(); ++i)
 	{
@@ -47,20 +70,95 @@ inline void NQS_S<2, _Ht, _T, _stateType>::chooseRandomFlips()
 		// choose the flip place of the vector
 		this->flipPlaces_[i]	= fP;
 		// save the element of a vector before the flip
-		this->flipVals_[i]		= this->tmpVec_(fP);
+		this->flipVals_[i]		= this->curVec_(fP);
+	}
+}
+
+//////////////////////////////////////////////////
+
+/*
+* @brief Exchanges the values on two sites - equivalent to flipping both of them when the values differ, otherwise it is a null move.
+* @param _i, _j sites to be exchanged
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline void NQS_S<2, _Ht, _T, _stateType>::chooseExchange(uint _i, uint _j)
+{
+	this->flipPlaces_[0]	= _i;
+	this->flipPlaces_[1]	= _j;
+	this->flipVals_[0]		= this->curVec_(_i);
+	this->flipVals_[1]		= this->curVec_(_j);
+	this->nullMove_			= this->flipVals_[0] == this->flipVals_[1];
+}
+
+//////////////////////////////////////////////////
+
+/*
+* @brief Chooses a connected cluster of nFlip sites - grows it from a random seed along the nearest neighbour bonds. The choice does not
+* depend on the state, therefore, the proposal is symmetric. When the cluster cannot grow (e.g. a small lattice), it is filled with random sites.
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline void NQS_S<2, _Ht, _T, _stateType>::chooseCluster()
+{
+	const uint _n			= this->nFlip_;
+	auto _begin				= this->flipPlaces_.begin();
+	uint _size				= 1;
+	this->flipPlaces_[0]	= this->ran_.template randomInt<uint>(0, this->info_p_.nVis_);
+
+	for (uint _try = 0; _size < _n && _try < 8 * _n; ++_try)
+	{
+		const auto& _nn		= this->neighbors_[this->flipPlaces_[this->ran_.template randomInt<uint>(0, _size)]];
+		if (_nn.empty())
+			continue;
+		const uint _s		= _nn[this->ran_.template randomInt<uint>(0, (uint)_nn.size())];
+		if (std::find(_begin, _begin + _size, _s) == _begin + _size)
+			this->flipPlaces_[_size++] = _s;
+	}
+	while (_size < _n)
+	{
+		const uint _s		= this->ran_.template randomInt<uint>(0, this->info_p_.nVis_);
+		if (std::find(_begin, _begin + _size, _s) == _begin + _size)
+			this->flipPlaces_[_size++] = _s;
+	}
+
+	for (uint i = 0; i < _n; ++i)
+		this->flipVals_[i]	= this->curVec_(this->flipPlaces_[i]);
+}
+
+//////////////////////////////////////////////////
+
+/*
+* @brief Draws the random state. For the proposals conserving the magnetization the state is drawn from the zero magnetization sector
+* (half of the sites occupied), otherwise from the whole Hilbert space.
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline u64 NQS_S<2, _Ht, _T, _stateType>::randomStateInt()
+{
+	if (!this->conservesMagnetization())
+		return NQS<2, _Ht, _T, _stateType>::randomStateInt();
+
+	// random half of the sites with the partial Fisher-Yates shuffle
+	v_1d<uint> _sites(this->info_p_.nVis_);
+	std::iota(_sites.begin(), _sites.end(), 0);
+	u64 _st = 0;
+	for (uint i = 0; i < this->info_p_.nVis_ / 2; ++i)
+	{
+		const uint _k	= i + this->ran_.template randomInt<uint>(0, this->info_p_.nVis_ - i);
+		std::swap(_sites[i], _sites[_k]);
+		_st				|= u64(1) << _sites[i];
 	}
+	return _st;
 }
 
 //////////////////////////////////////////////////
 
 /*
-* @brief Set the number of random flips.
+* @brief Set the number of random flips. The exchange proposals always change two sites.
 * @param _nFlips number of flips to be used
 */
 template<typename _Ht, typename _T, class _stateType>
 inline void NQS_S<2, _Ht, _T, _stateType>::setRandomFlipNum(uint _nFlips)
 {
-	this->nFlip_ = _nFlips;
+	this->nFlip_ = this->conservesMagnetization() ? 2 : std::min(std::max(_nFlips, (uint)1), this->info_p_.nVis_);
 	if (this->flipPlaces_.size() != this->nFlip_)
 		this->flipPlaces_.resize(this->nFlip_);
 	if (this->flipVals_.size() != this->nFlip_)
@@ -17,9 +17,10 @@
 template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline void NQS<_spinModes, _Ht, _T, _stateType>::gradSR(uint step, _T _currLoss)
 {
+	PROF_SCOPE(SR_SOLVE);
 	bool _inversionSuccess 		= false;
 	if (this->info_p_.sreg_ > 0) 
-		this->covMatrixReg(step);
+		this->covMatrixReg(step, _currLoss);
 
 #ifdef NQS_USESR_MAT_USED
 	{
@@ -56,6 +57,19 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>::gradSR(uint step, _T _currLoss
 		}
 	}
 #else
+	if (this->srMode_ != NQS_SR_SOLVER)
+	{
+		// matrix-free engine - MinSR when the samples are fewer than the parameters (or when chosen explicitly)
+		const bool _minSR		= this->srMode_ == NQS_SR_MINSR || (this->srMode_ == NQS_SR_AUTO && this->srLazy_.samples() < this->srLazy_.params());
+		const double _reg		= this->info_p_.sreg_ > 0 ? this->info_p_.sreg_ : 1e-7;
+		const auto& _x			= _minSR ? this->srLazy_.solveMinSR(this->srVec_, _reg)
+										 : this->srLazy_.solveCG(this->F_, _reg, this->info_p_.tol_, this->info_p_.maxIter_);
+		_inversionSuccess		= this->srLazy_.converged();
+		PROF_COUNT(SR_ITERS, this->srLazy_.iterations());
+		this->dF_				= this->info_p_.lr_ * _x;
+		this->updateWeights_	= _inversionSuccess;
+		return;
+	}
 
 	if (this->precond_ != nullptr)
 		this->precond_->set(this->derivativesCenteredH_, this->derivativesCentered_, this->info_p_.sreg_);
@@ -0,0 +1,356 @@
+#pragma once
+/***********************************
+* Defines the matrix-free stochastic
+* reconfiguration engine. The Fisher
+* matrix S = O^H O / N is never formed,
+* it is applied as two threaded
+* products with the (optionally single
+* precision) centered derivatives.
+***********************************/
+
+#ifndef NQS_SR_LAZY_H
+#define NQS_SR_LAZY_H
+
+#include <complex>
+#include <type_traits>
+#include "nqs_mpi.h"
+#include "nqs_gpu.h"
+
+constexpr unsigned NQS_SR_BLOCK				= 1024;										// number of parameters in a single block of the O^H u product
+constexpr double NQS_SR_MINSR_DIST_TOL		= 1e-8;										// tolerance of the conjugate gradient replacing the distributed MinSR
+constexpr unsigned NQS_SR_MINSR_DIST_ITER	= 1000;										// iterations of the conjugate gradient replacing the distributed MinSR
+
+// ######### NQS SR MODES ##########
+enum NQS_SR_MODE				// #
+{								// #
+	NQS_SR_SOLVER,				// # solver chosen with setSolver (derivatives in the full precision)
+	NQS_SR_LAZY,				// # conjugate gradient with the lazily applied Fisher matrix
+	NQS_SR_MINSR,				// # kernel trick - inversion in the space of the samples (samples << parameters)
+	NQS_SR_AUTO					// # MinSR when there are less samples than parameters, lazy otherwise
+};								// #
+// #################################
+
+/*
+* @brief Single precision counterpart of the type used for the storage of the derivatives
+*/
+template <typename _T>
+struct NQS_SRLowPrecision											{ using type = float;				};
+template <>
+struct NQS_SRLowPrecision<std::complex<double>>						{ using type = std::complex<float>;	};
+
+/*
+* @brief Matrix-free stochastic reconfiguration. Stores the transposed centered derivatives O^T (P x N, the column is a single sample,
+* hence contiguous) either in the full or in the single precision. All the products accumulate in the full precision:
+*	- u = O x		- parallel over the samples, each one is a dot product of a contiguous column,
+*	- y = O^H u		- parallel over the blocks of the parameters, each thread owns its part of y (no reduction).
+* The system (S + reg) x = F is solved with the Jacobi preconditioned conjugate gradient or, when the number of the samples is
+* much smaller than the number of the parameters, with the kernel trick (MinSR):
+*	x = (O^H O / N + reg)^{-1} O^H v = O^H (O O^H / N + reg)^{-1} v, with F = O^H v.
+* When distributed, each rank keeps only the rows of O of its own samples - O^H u is summed over the ranks, the vectors
+* in the space of the parameters (and the conjugate gradient itself) are replicated.
+* With NQS_USE_GPU the derivatives may be kept on the device instead (setDevice) - the products, the conjugate gradient and
+* the factorization of the MinSR kernel run there (single rank only, the precision is the full one).
+*/
+template <typename _T>
+class NQS_SRLazy
+{
+public:
+	using _S = typename NQS_SRLowPrecision<_T>::type;
+protected:
+	bool single_							= false;									// store the derivatives in the single precision?
+	bool distributed_						= false;									// are the samples split over the MPI ranks?
+	uint threads_							= 1;										// number of threads for the products
+	double nSamples_						= 1.0;										// number of the samples (normalization of S)
+	arma::Mat<_S> OTs_;																	// transposed centered derivatives - single precision
+	arma::Mat<_T> OTd_;																	// transposed centered derivatives - full precision
+	arma::Col<_T> diag_;																// diagonal of S (Jacobi preconditioner)
+	arma::Col<_T> x_;																	// last solution (warm start)
+	bool converged_							= false;
+	uint iter_								= 0;
+	uint nParams_							= 0;
+#ifdef NQS_USE_GPU
+	bool device_							= false;									// keep the derivatives on the device
+	NQS_GPU::SR<_T> dev_;
+#endif
+
+	template <typename _X>
+	static auto cj(const _X& _x) -> _X
+	{
+		if constexpr (std::is_floating_point_v<_X>)
+			return _x;
+		else
+			return std::conj(_x);
+	}
+
+	/*
+	* @brief u = O x
+	*/
+	template <typename _M>
+	void mulO(const _M& _OT, const arma::Col<_T>& _x, arma::Col<_T>& _u) const
+	{
+		const arma::uword _P	= _OT.n_rows;
+		const _T* _xp			= _x.memptr();
+		_u.set_size(_OT.n_cols);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threads_)
+#endif
+		for (int i = 0; i < (int)_OT.n_cols; ++i)
+		{
+			const auto* _c		= _OT.colptr(i);
+			_T _acc				= 0.0;
+			for (arma::uword p = 0; p < _P; ++p)
+				_acc			+= _T(_c[p]) * _xp[p];
+			_u(i)				= _acc;
+		}
+	}
+
+	/*
+	* @brief y = O^H u
+	*/
+	template <typename _M>
+	void mulOH(const _M& _OT, const arma::Col<_T>& _u, arma::Col<_T>& _y) const
+	{
+		const arma::uword _P	= _OT.n_rows;
+		const int _nB			= (int)((_P + NQS_SR_BLOCK - 1) / NQS_SR_BLOCK);
+		_y.zeros(_P);
+		_T* _yp					= _y.memptr();
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threads_)
+#endif
+		for (int b = 0; b < _nB; ++b)
+		{
+			const arma::uword _p0	= (arma::uword)b * NQS_SR_BLOCK;
+			const arma::uword _p1	= std::min<arma::uword>(_p0 + NQS_SR_BLOCK, _P);
+			for (arma::uword i = 0; i < _OT.n_cols; ++i)
+			{
+				const auto* _c	= _OT.colptr(i);
+				const _T _ui	= _u(i);
+				for (arma::uword p = _p0; p < _p1; ++p)
+					_yp[p]		+= cj(_T(_c[p])) * _ui;
+			}
+		}
+	}
+
+	/*
+	* @brief T = O O^H / N in the full precision - the blocks of the parameters are converted on the fly
+	*/
+	template <typename _M>
+	auto kernel(const _M& _OT) const -> arma::Mat<_T>
+	{
+		arma::Mat<_T> _K(_OT.n_cols, _OT.n_cols, arma::fill::zeros);
+		for (arma::uword _p0 = 0; _p0 < _OT.n_rows; _p0 += NQS_SR_BLOCK)
+		{
+			const arma::uword _p1	= std::min<arma::uword>(_p0 + NQS_SR_BLOCK, _OT.n_rows) - 1;
+			const arma::Mat<_T> _blk= arma::conv_to<arma::Mat<_T>>::from(_OT.rows(_p0, _p1));
+			_K						+= _blk.st() * arma::conj(_blk);
+		}
+		return _K / this->nSamples_;
+	}
+
+	/*
+	* @brief Centers the derivatives and stores them transposed in the chosen precision - this is the only copy of the centered
+	* derivatives, no full precision N x P intermediate is formed (the diagonal of S accumulates in the full precision)
+	* @param _O derivatives (N x P)
+	* @param _mean mean of the derivatives over the samples (of all the ranks when distributed)
+	*/
+	template <typename _M>
+	void center(const arma::Mat<_T>& _O, const arma::Row<_T>& _mean, _M& _OT)
+	{
+		const arma::uword _N	= _O.n_rows;
+		_OT.set_size(_O.n_cols, _N);
+		this->diag_.set_size(_O.n_cols);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threads_)
+#endif
+		for (int p = 0; p < (int)_O.n_cols; ++p)
+		{
+			const _T* _c		= _O.colptr(p);
+			const _T _m			= _mean(p);
+			double _d			= 0.0;
+			for (arma::uword i = 0; i < _N; ++i)
+			{
+				const _T _v		= _c[i] - _m;
+				_OT(p, i)		= static_cast<typename _M::elem_type>(_v);
+				_d				+= std::norm(_v);
+			}
+			this->diag_(p)		= _d;
+		}
+	}
+
+public:
+	auto isSingle()							const -> bool								{ return this->single_;					};
+	auto converged()						const -> bool								{ return this->converged_;				};
+	auto iterations()						const -> uint								{ return this->iter_;					};
+	auto samples()							const -> uint								{ return (uint)this->nSamples_;			};
+	auto params()							const -> uint								{ return this->nParams_;				};
+	void setThreads(uint _threads)																	{ this->threads_ = std::max(_threads, (uint)1);	};
+	void setSingle(bool _single)																	{ this->single_ = _single;				};
+	void setDistributed(bool _dist)																	{ this->distributed_ = _dist;			};
+	auto solution()							const -> const arma::Col<_T>&				{ return this->x_;						};
+	void setSolution(const arma::Col<_T>& _x)														{ this->x_ = _x;						};
+	auto isDistributed()					const -> bool								{ return this->distributed_;			};
+#ifdef NQS_USE_GPU
+	void setDevice(bool _dev)																		{ this->device_ = _dev;					};
+	auto onDevice()							const -> bool								{ return this->device_ && !this->distributed_; };
+#else
+	auto onDevice()							const -> bool								{ return false;							};
+#endif
+
+	/*
+	* @brief Stores the centered derivatives
+	* @param _O derivatives (N x P), not centered
+	* @param _mean mean of the derivatives over the samples
+	*/
+	void set(const arma::Mat<_T>& _O, const arma::Row<_T>& _mean)
+	{
+		this->nSamples_	= this->distributed_ ? NQS_MPI::count(_O.n_rows) : (double)_O.n_rows;
+		this->nParams_	= (uint)_O.n_cols;
+#ifdef NQS_USE_GPU
+		if (this->onDevice())
+		{
+			const arma::Mat<_T> _Oc = _O.each_row() - _mean;
+			this->dev_.set(_Oc.memptr(), (unsigned)_Oc.n_rows, (unsigned)_Oc.n_cols, this->nSamples_);
+			this->diag_	= arma::conv_to<arma::Col<_T>>::from(arma::sum(arma::square(arma::abs(_Oc)), 0).st());
+			this->OTs_.reset();
+			this->OTd_.reset();
+		}
+		else
+#endif
+		if (this->single_)
+		{
+			this->center(_O, _mean, this->OTs_);
+			this->OTd_.reset();
+		}
+		else
+		{
+			this->center(_O, _mean, this->OTd_);
+			this->OTs_.reset();
+		}
+		if (this->distributed_)
+			NQS_MPI::sumInPlace(this->diag_);
+		this->diag_		/= this->nSamples_;
+		if (this->x_.n_elem != _O.n_cols)
+			this->x_.zeros(_O.n_cols);
+	}
+
+	/*
+	* @brief Returns O^H v (e.g. the force with v = (E_loc - <E>) / N)
+	*/
+	auto force(const arma::Col<_T>& _v) -> arma::Col<_T>
+	{
+		arma::Col<_T> _y;
+#ifdef NQS_USE_GPU
+		if (this->onDevice())
+		{
+			_y.set_size(this->nParams_);
+			this->dev_.force(_v.memptr(), _y.memptr());
+			return _y;
+		}
+#endif
+		if (this->single_)
+			this->mulOH(this->OTs_, _v, _y);
+		else
+			this->mulOH(this->OTd_, _v, _y);
+		if (this->distributed_)
+			NQS_MPI::sumInPlace(_y);
+		return _y;
+	}
+
+	/*
+	* @brief Returns (S + reg) x without forming S
+	*/
+	auto apply(const arma::Col<_T>& _x, double _reg) const -> arma::Col<_T>
+	{
+		arma::Col<_T> _u, _y;
+		if (this->single_)
+		{
+			this->mulO(this->OTs_, _x, _u);
+			this->mulOH(this->OTs_, _u, _y);
+		}
+		else
+		{
+			this->mulO(this->OTd_, _x, _u);
+			this->mulOH(this->OTd_, _u, _y);
+		}
+		if (this->distributed_)
+			NQS_MPI::sumInPlace(_y);
+		return _y / this->nSamples_ + _reg * _x;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Solves (S + reg) x = F with the Jacobi preconditioned conjugate gradient (warm started from the last solution)
+	* @param _F force vector
+	* @param _reg diagonal regularization
+	* @param _tol relative tolerance of the residual
+	* @param _maxIter maximal number of the iterations
+	*/
+	auto solveCG(const arma::Col<_T>& _F, double _reg, double _tol, uint _maxIter) -> const arma::Col<_T>&
+	{
+#ifdef NQS_USE_GPU
+		if (this->onDevice())
+		{
+			unsigned _it			= 0;
+			this->converged_		= this->dev_.solveCG(_F.memptr(), this->diag_.memptr(), _reg, _tol, _maxIter, this->x_.memptr(), _it);
+			this->iter_				= _it;
+			return this->x_;
+		}
+#endif
+		const arma::Col<_T> _M	= 1.0 / (this->diag_ + _reg);
+		const double _bNorm		= std::max(arma::norm(_F), 1e-300);
+		arma::Col<_T> _r		= _F - this->apply(this->x_, _reg);
+		arma::Col<_T> _z		= _M % _r;
+		arma::Col<_T> _p		= _z;
+		double _rz				= std::real(arma::cdot(_r, _z));
+		this->converged_		= arma::norm(_r) <= _tol * _bNorm;
+		for (this->iter_ = 0; !this->converged_ && this->iter_ < _maxIter; ++this->iter_)
+		{
+			const arma::Col<_T> _Ap	= this->apply(_p, _reg);
+			const _T _alpha		= _rz / std::real(arma::cdot(_p, _Ap));
+			this->x_			+= _alpha * _p;
+			_r					-= _alpha * _Ap;
+			if (arma::norm(_r) <= _tol * _bNorm)
+			{
+				this->converged_ = true;
+				break;
+			}
+			_z					= _M % _r;
+			const double _rzNew	= std::real(arma::cdot(_r, _z));
+			_p					= _z + (_rzNew / _rz) * _p;
+			_rz					= _rzNew;
+		}
+		return this->x_;
+	}
+
+	/*
+	* @brief Solves the SR equation with the kernel trick - x = O^H (O O^H / N + reg)^{-1} v. Costs O(N^2 P + N^3) instead of the
+	* iterations in the space of the parameters. The kernel couples the samples of all the ranks, therefore, the distributed
+	* engine resorts to the conjugate gradient (with F = O^H v).
+	* @param _v vector of the sample weights, such that F = O^H v
+	* @param _reg diagonal regularization
+	*/
+	auto solveMinSR(const arma::Col<_T>& _v, double _reg) -> const arma::Col<_T>&
+	{
+		if (this->distributed_)
+			return this->solveCG(this->force(_v), _reg, NQS_SR_MINSR_DIST_TOL, NQS_SR_MINSR_DIST_ITER);
+#ifdef NQS_USE_GPU
+		if (this->onDevice())
+		{
+			this->iter_				= 0;
+			this->converged_		= this->dev_.solveMinSR(_v.memptr(), _reg, this->x_.memptr());
+			return this->x_;
+		}
+#endif
+		arma::Mat<_T> _K		= this->single_ ? this->kernel(this->OTs_) : this->kernel(this->OTd_);
+		_K.diag()				+= _reg;
+		arma::Col<_T> _a;
+		this->converged_		= arma::solve(_a, _K, _v, arma::solve_opts::likely_sympd);
+		this->iter_				= 0;
+		if (this->converged_)
+			this->x_			= this->force(_a);
+		return this->x_;
+	}
+};
+
+#endif // !NQS_SR_LAZY_H
@@ -25,12 +25,17 @@ inline bool NQS<_spinModes, _Ht, _T, _stateType>::trainStop(size_t i, const NQS_
 	// update the progress bar
 	auto best 				= this->info_p_.best();
 	const std::string _prog = "PROGRESS NQS: E(" + STR(i - 1) + "/" + STR(_par.MC_sam_) + ")=" + STRPS(_currLoss, 4) + ". " + VEQPS(best, 4) + ". eta=" + STRPS(this->info_p_.lr_, 4) + ". reg=" + STRPS(this->info_p_.sreg_, 4);
-	PROGRESS_UPD_Q(i, this->pBar_, _prog, !_quiet);
+	PROGRESS_UPD_Q(i, this->pBar_, _prog, !_quiet && NQS_MPI::isRoot());
 	
 	this->updateWeights_ 	= !this->info_p_.stop(i, _currLoss) && this->updateWeights_;
 #ifdef NQS_SAVE_WEIGHTS
-	if (i % this->pBar_.percentageSteps == 0 || !this->updateWeights_)  
-		this->saveWeights(_par.dir + NQS_SAVE_DIR, "weights_" + STR(this->lower_states_.f_lower_size_) + ".h5");
+	if (i % this->pBar_.percentageSteps == 0 || !this->updateWeights_)
+	{
+		this->checkpointState(i);
+		// the weights are the same on all the ranks - only the root writes them
+		if (!this->distributed_ || NQS_MPI::isRoot())
+			this->saveWeights(_par.dir + NQS_SAVE_DIR, "weights_" + STR(this->lower_states_.f_lower_size_) + ".h5");
+	}
 #endif	
 	if (!this->updateWeights_) {
 		LOGINFO("Stopping at " + STR(i) + " iteration with last value: " + STRPS(_currLoss, 4), LOG_TYPES::WARNING, 1);
@@ -41,6 +46,196 @@ inline bool NQS<_spinModes, _Ht, _T, _stateType>::trainStop(size_t i, const NQS_
 
 // ##########################################################################################################################################
 
+/*
+* @brief Sets the way the checkpoints of the training are written
+* @param _async write the checkpoints in the background (the training does not wait for the disk)
+* @param _resume start the training from the last checkpoint in the directory of the weights (if present)
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setCheckpoint(bool _async, bool _resume)
+{
+	this->ckptAsync_	= _async;
+	this->ckptResume_	= _resume;
+	if (_async)
+		LOGINFO("Using the asynchronous checkpoints.", LOG_TYPES::CHOICE, 3);
+	if (_resume)
+		LOGINFO("Resuming the training from the last checkpoint.", LOG_TYPES::CHOICE, 3);
+}
+
+/*
+* @brief Keeps the configurations drawn in the last iterations of the training, so that the observables are measured with them
+* (see collectBuffered) instead of a separate sampling phase.
+* @param _lastIters number of the last training iterations kept (0 - no buffer)
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setSampleBuffer(uint _lastIters)
+{
+	this->sampleBufIters_	= _lastIters;
+	this->sampleBufHead_	= 0;
+	this->sampleBufCap_		= 0;
+	this->sampleBuf_.clear();
+	if (_lastIters > 0)
+		LOGINFO("Buffering the samples of the last " + STR(_lastIters) + " training iterations.", LOG_TYPES::CHOICE, 3);
+}
+
+/*
+* @brief Stores the sample - once the buffer is full the oldest sample is replaced (the training may stop early)
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::bufferSample(const NQSConfig& _s)
+{
+	if (this->sampleBuf_.size() < this->sampleBufCap_)
+		this->sampleBuf_.push_back(_s);
+	else
+	{
+		this->sampleBuf_[this->sampleBufHead_]	= _s;
+		this->sampleBufHead_					= (this->sampleBufHead_ + 1) % this->sampleBufCap_;
+	}
+}
+
+/*
+* @brief Prepares the checkpoint at the step i - the random generator is reseeded with a seed drawn from itself, which is then
+* stored, so that the resumed training continues with exactly the same random numbers (as the generator state is opaque).
+* All the ranks reseed (with their offsets), only the root writes.
+* @param i finished step of the training
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::checkpointState(size_t i)
+{
+	this->ckptStep_		= i;
+	this->ckptSeed_		= NQS_MPI::seed(this->ran_.template randomInt<u64>(0, NQS_MPI_SEED_STRIDE));
+	this->ran_.newSeed(this->ckptSeed_);
+}
+
+/*
+* @brief Restores the last checkpoint of this state (the file written by trainStop) - the weights, the last update, the warm start
+* of the SR, the configuration of the sampler and the random generator. The learning rate, the regularization and the early stopping
+* are restored by replaying the saved history of the loss through the schedulers, so that their inner state is also the same.
+* The continuation is bit-exact when the chains are reinitialized at each step (MC_th_ > 0), otherwise the angles are recalculated
+* from the saved configuration.
+* @param _par parameters of the training
+* @param _meanEn history of the loss - filled with the saved part
+* @returns the next step of the training (1 when there is nothing to resume)
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline uint NQS<_spinModes, _Ht, _T, _stateType>::resume(const NQS_train_t& _par, arma::Col<_T>& _meanEn)
+{
+	const std::string _dir	= _par.dir + NQS_SAVE_DIR;
+	const std::string _file	= "weights_" + STR(this->lower_states_.f_lower_size_) + ".h5";
+	NQS_Checkpoint<_T, _stateType> _ck;
+	if (!_ck.read(_dir, _file) || _ck.step_ == 0 || _ck.step_ >= _par.MC_sam_ || _ck.loss_.n_elem != _ck.step_ || !this->setWeights(_dir, _file))
+	{
+		LOGINFO("No checkpoint to resume from in: " + _dir + _file + ". Starting from scratch.", LOG_TYPES::WARNING, 3);
+		return 1;
+	}
+
+	// optimizer
+	if (_ck.dF_.n_elem == this->info_p_.fullSize_)
+		this->dF_			= _ck.dF_;
+#ifdef NQS_USESR_NOMAT_USED
+	if (_ck.x_.n_elem == this->info_p_.fullSize_)
+		this->srLazy_.setSolution(_ck.x_);
+#endif
+	for (uint k = 1; k <= _ck.step_; ++k)
+	{
+		const _T _loss		= _ck.loss_(k - 1);
+		this->info_p_.lr_	= this->info_p_.lr(k, algebra::real(_loss));
+#ifdef NQS_USESR
+		if (this->info_p_.sreg_ > 0)
+			this->info_p_.sreg_ = this->info_p_.sreg(k, algebra::real(_loss));
+#endif
+		this->info_p_.stop(k, _loss);
+		_meanEn(k - 1)		= _loss;
+	}
+
+	// sampler
+	this->ran_.newSeed(NQS_MPI::seed(_ck.seed_));
+	if (_ck.state_.n_elem == this->info_p_.nVis_)
+		this->setState(_ck.state_, true);
+	else
+		this->setRandomState();
+	if (this->nChains_ > 1 && _ck.chains_.n_rows == this->chains_.n_rows && _ck.chains_.n_cols == this->chains_.n_cols)
+	{
+		this->chains_		= _ck.chains_;
+		this->setChainsTheta();
+	}
+	LOGINFO("Resumed the training at step " + STR(_ck.step_ + 1) + " from: " + _dir + _file, LOG_TYPES::CHOICE, 3);
+	return (uint)_ck.step_ + 1;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Distributes the training over the MPI ranks. Each rank samples its own chains (with the seed shifted by the rank),
+* the estimators (energy, forces, S x) are summed over the ranks and the weights are broadcast from the root after each update.
+* The SR solvers working on the local matrices are replaced by the matrix-free engine, which reduces O^H u over the ranks.
+* Without MPI (or with a single rank) the call does nothing.
+* @param _dist shall the training be distributed?
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setDistributed(bool _dist)
+{
+	this->distributed_ = _dist && NQS_MPI::distributed();
+	if (_dist && !this->distributed_)
+		LOGINFO("Distributed training requested with a single process (or without NQS_USE_MPI) - running locally.", LOG_TYPES::WARNING, 3);
+	if (!this->distributed_)
+		return;
+
+	// independent chains on each rank
+	this->ran_.newSeed(NQS_MPI::seed(this->ran_.template randomInt<u64>(0, NQS_MPI_SEED_STRIDE)));
+
+#ifdef NQS_USESR_NOMAT_USED
+	if (this->srMode_ == NQS_SR_SOLVER)
+	{
+		this->srMode_ = NQS_SR_LAZY;
+		this->srLazy_.setThreads(this->threads_.threadNum_);
+	}
+	this->srLazy_.setDistributed(true);
+#endif
+	// start from the same weights
+	this->bcastWeights();
+	LOGINFO("Distributed training over " + STR(NQS_MPI::size()) + " ranks (rank " + STR(NQS_MPI::rank()) + ").", LOG_TYPES::CHOICE, 3);
+}
+
+/*
+* @brief Moves the chains (the architectures that implement them on the device) and the SR to the device. The SR is then
+* solved by the matrix-free engine with the derivatives kept on the device. Without NQS_USE_GPU (or without a device)
+* the host types are used.
+* @param _dev use the device
+* @param _id device of this process (e.g. the rank modulo the number of the devices of the node)
+*/
+template <uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void NQS<_spinModes, _Ht, _T, _stateType>::setDevice(bool _dev, int _id)
+{
+	this->device_ = false;
+	if (!_dev)
+		return;
+#ifdef NQS_USE_GPU
+	const int _n = NQS_GPU::devices();
+	if (_n == 0)
+	{
+		LOGINFO("No device found - running on the host.", LOG_TYPES::WARNING, 3);
+		return;
+	}
+	NQS_GPU::select(_id % _n);
+	this->device_ = true;
+#	ifdef NQS_USESR_NOMAT_USED
+	if (this->srMode_ == NQS_SR_SOLVER)
+	{
+		// the explicit solver needs the S matrix on the host - the derivatives stay on the device instead
+		LOGINFO("The explicit SR solver is not available on the device - switching to the matrix-free SR (auto).", LOG_TYPES::WARNING, 3);
+		this->srMode_ = NQS_SR_AUTO;
+	}
+	this->srLazy_.setDevice(true);
+#	endif
+	LOGINFO("Using the device " + STR(_id % _n) + " of " + STR(_n) + ".", LOG_TYPES::CHOICE, 3);
+#else
+	LOGINFO("Device requested without NQS_USE_GPU - running on the host.", LOG_TYPES::WARNING, 3);
+#endif
+}
+
+// ##########################################################################################################################################
+
 /*
 * @brief Perform single training of the NQS.
 * @param mcSteps Monte Carlo steps to be used in the training - this is an outer loop for the training (number of iterations)
@@ -70,6 +265,12 @@ inline std::pair<arma::Col<_T>, arma::Col<_T>> NQS<_spinModes, _Ht, _T, _stateTy
 
 		// set the size of the containers for the lower states
 		this->lower_states_.setDerivContSize(_par.nblck_);
+
+		// the buffer of the samples starts empty for each training
+		this->sampleBufCap_	= (size_t)this->sampleBufIters_ * _par.nblck_;
+		this->sampleBufHead_	= 0;
+		this->sampleBuf_.clear();
+		this->sampleBuf_.reserve(this->sampleBufCap_);
 	}
 	TIMER_CREATE(_timer);
 
@@ -78,62 +279,124 @@ inline std::pair<arma::Col<_T>, arma::Col<_T>> NQS<_spinModes, _Ht, _T, _stateTy
 	arma::Col<_T> stdEn(_par.MC_sam_, arma::fill::zeros);
 	// history of energies (for given weights) - here we save the local energies at each block
 	arma::Col<_T> En(_par.nblck_, arma::fill::zeros);
-	// set the random state at the begining and the number of flips
+	// set the random state at the begining and the number of flips (or continue from the checkpoint)
+	const uint _start = this->ckptResume_ ? this->resume(_par, meanEn) : 1;
 	{
-		this->setRandomState();
+		if (_start == 1)
+			this->setRandomState();
 		this->setRandomFlipNum(_par.nFlip);
 	}
+	this->trainLoss_ = &meanEn;
 
 	// go through the Monte Carlo steps
 	uint i = 1;
-	for (i = 1; i <= _par.MC_sam_; ++i)
+	for (i = _start; i <= _par.MC_sam_; ++i)
 	{
-		// set the random state at the begining
-		if (_par.MC_th_ > 0)
-			this->setRandomState();
+		// sample the lower states once - the weights are fixed within the iteration, so that the same samples serve
+		// the energy of all the blocks and the gradient (see NQS_lower_t::sharedEnergy)
+		if (this->lower_states_.f_lower_size_ != 0)
+		{
+#ifdef NQS_NOT_OMP_MT
+			this->parallelFor(this->lower_states_.f_lower_size_, [&](uint _low, uint) { this->lower_states_.collectLowerRatios(_low); });
+#else
+#	ifndef _DEBUG 
+# 	pragma omp parallel for num_threads(this->threads_.threadNum_)
+#	endif
+			for (int _low = 0; _low < this->lower_states_.f_lower_size_; _low++) 
+				this->lower_states_.collectLowerRatios(_low);
+#endif
+			this->lower_states_.sharedReady_ = true;
+		}
 
-		// thermalize
-		this->blockSample(_par.MC_th_, NQS_STATE, false);
+		// multiple chains - each chain gives a single sample of the block
+		if (this->nChains_ > 1)
+		{
+			if (_par.MC_th_ > 0)
+				this->setRandomChains();
+			this->blockSampleChains(_par.MC_th_);
+
+			for (uint _taken = 0; _taken < _par.nblck_; _taken += this->nChains_)
+			{
+				this->sampleChains(_par.bsize_, _taken, En);
+				if (this->sampleBufCap_ > 0)
+					for (uint c = 0; c < std::min<uint>(this->nChains_, _par.nblck_ - _taken); ++c)
+						this->bufferSample(NQSConfig(NQSS(this->chains_.col(c))));
+			}
+		}
+		else
+		{
+			// set the random state at the begining
+			if (_par.MC_th_ > 0)
+				this->setRandomState();
 
-		// iterate blocks - this ensures the calculation of a stochastic gradient constructed within the block
-		for (uint _taken = 0; _taken < _par.nblck_; ++_taken) {
+			// thermalize
+			this->blockSample(_par.MC_th_, NQS_STATE, false);
 
-			// sample them!
-			this->blockSample(_par.bsize_, NQS_STATE, false);
+			// iterate blocks - this ensures the calculation of a stochastic gradient constructed within the block
+			for (uint _taken = 0; _taken < _par.nblck_; ++_taken) {
 
-			// calculate the gradient at each point of the iteration! - this is implementation specific!!!
-			this->grad(this->curVec_, _taken);
+				// sample them!
+				this->blockSample(_par.bsize_, NQS_STATE, false);
 
-			// local energy - stored at each point within the estimation of the gradient (stochastic)
-			En(_taken) = this->locEnKernel();
+				// calculate the gradient at each point of the iteration! - this is implementation specific!!!
+				this->grad(this->curVec_, _taken);
 
-			// calculate the excited states overlaps for the gradient - if used
-#ifndef _DEBUG 
+				// calculate the excited states overlaps for the gradient - if used (the local energy reuses them)
+				this->lower_states_.setExcited(NQS_STATE);
+#ifdef NQS_NOT_OMP_MT
+				this->parallelFor(this->lower_states_.f_lower_size_, [&](uint _low, uint) 
+					{ this->lower_states_.ratios_excited_[_low](_taken) = this->lower_states_.collectExcitedRatios(_low, NQS_STATE); });
+#else
+#	ifndef _DEBUG 
 # 	pragma omp parallel for num_threads(this->threads_.threadNum_)
+#	endif
+				for (int _low = 0; _low < this->lower_states_.f_lower_size_; _low++)
+					this->lower_states_.ratios_excited_[_low](_taken) = this->lower_states_.collectExcitedRatios(_low, NQS_STATE);
 #endif
-			for (int _low = 0; _low < this->lower_states_.f_lower_size_; _low++)
-				this->lower_states_.ratios_excited_[_low](_taken) = this->lower_states_.collectExcitedRatios(_low, NQS_STATE);
-		}
 
-		// collect the average for the lower states and collect the same for the lower states with this ansatz - for the gradient calculation
-#ifndef _DEBUG 
-# 	pragma omp parallel for num_threads(this->threads_.threadNum_)
-#endif
-		for (int _low = 0; _low < this->lower_states_.f_lower_size_; _low++) 
-			this->lower_states_.collectLowerRatios(_low);
+				// local energy - stored at each point within the estimation of the gradient (stochastic)
+				En(_taken) = this->locEnKernel();
+
+				if (this->sampleBufCap_ > 0)
+					this->bufferSample(this->curBits_);
+			}
+		}
+		// the weights change with the update - the shared samples are no longer valid
+		this->lower_states_.sharedReady_ = false;
 		
 		MonteCarlo::blockmean(En, _par.bsize_, &meanEn(i - 1), &stdEn(i - 1));			// save the mean energy
+		if (this->distributed_)
+		{
+			// the ranks have the same number of the blocks - the mean is the average of the means, the errors are independent
+			meanEn(i - 1)	= NQS_MPI::sum(meanEn(i - 1)) / (double)NQS_MPI::size();
+			stdEn(i - 1)	= std::sqrt(NQS_MPI::sum(stdEn(i - 1) * stdEn(i - 1))) / (double)NQS_MPI::size();
+		}
 
 		// calculate the final update vector - either use the stochastic reconfiguration or the standard gradient descent !TODO: implement optimizers
 		TIMER_START_MEASURE(this->gradFinal(En, i, meanEn(i - 1)), (i % this->pBar_.percentageSteps == 0), _timer, STR(i));
 		// LOGINFO(_t, VEQ(i-1) + " --- " + VEQP(meanEn(i-1), 4), 3);
 
 		if (this->updateWeights_)
+		{
+			PROF_SCOPE(WEIGHTS);
 			this->updateWeights(); // finally, update the weights with the calculated gradient (force) [can be done with the stochastic reconfiguration or the standard gradient descent] - implementation specific!!!
+			if (this->distributed_)
+				this->bcastWeights(); // the update is replicated - the broadcast removes the round-off drift between the ranks
+		}
+		PROF_ITERATION(i);
 
 		if (this->trainStop(i, _par, meanEn(i - 1), quiet))
 			break;
 	}
+	if (!_par.dir.empty() && NQS_MPI::isRoot())
+		PROF_SAVE(_par.dir, "profile_" + STR(this->lower_states_.f_lower_size_));
+	else
+		PROF_CLEAR();
+	// the last checkpoint shall be on the disk before the weights are used elsewhere
+	if (this->ckptAsync_)
+		NQS_CheckpointWriter::get().flush();
+	this->trainLoss_ = nullptr;
+	this->ckptStep_	 = 0;
 	LOGINFO(_t, "NQS_EQ_" + STR(this->lower_states_.f_lower_size_), 1);
 	if (i > 2) 
 		return std::make_pair(meanEn.subvec(0, i - 2), stdEn.subvec(0, i - 2));
@@ -160,6 +423,9 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>:: collect(const NQS_train_t& _p
 
 	// allows to calculate the probability of the operator (for operator measurements)
 	// std::function<_T(const NQSS& _v)> opFun = [&](const NQSS& v) { return this->pRatio(v); };
+#ifdef NQS_NOT_OMP_MT
+	_meas.setExecutor(this->threads_.pool_.get());
+#endif
 	
 	// go through the number of samples to be collected
 	for (uint i = 1; i <= _par.MC_sam_; ++i)
@@ -183,6 +449,7 @@ inline void NQS<_spinModes, _Ht, _T, _stateType>:: collect(const NQS_train_t& _p
 		// normalize the measurements - this also creates a new block of measurements
 		_meas.normalize(_par.nblck_);												
 	}
+	_meas.setExecutor(nullptr);
 }
 
 /*
@@ -257,6 +524,9 @@ inline arma::Col<_T> NQS<_spinModes, _Ht, _T, _stateType>::collect(	const NQS_tr
 
 	// set the random state at the begining
 	this->setRandomFlipNum(_par.nFlip);
+#ifdef NQS_NOT_OMP_MT
+	_meas.setExecutor(this->threads_.pool_.get());
+#endif
 
 	// go through the number of samples to be collected
 	for (uint i = 1; i <= _par.MC_sam_; ++i)
@@ -288,10 +558,100 @@ inline arma::Col<_T> NQS<_spinModes, _Ht, _T, _stateType>::collect(	const NQS_tr
 		PROGRESS_UPD_Q(i, this->pBar_, "PROGRESS NQS", !quiet); 					// update the progress bar
 
 	}
+	_meas.setExecutor(nullptr);
+	if (this->distributed_)
+	{
+		// the ranks have the same number of the blocks - the estimators are the averages over the ranks
+		if (_collectEn)
+		{
+			NQS_MPI::sumInPlace(meanEn);
+			meanEn /= (double)NQS_MPI::size();
+		}
+		_meas.reduceRanks();
+	}
 	LOGINFO(_t, "NQS_COLLECTION", 1);
 	return meanEn;
 }
 
+/*
+* @brief Measures the observables with the configurations buffered during the last iterations of the training (see setSampleBuffer),
+* without a separate sampling phase. Each group of _par.nblck_ consecutive samples forms a block of the measurements. The ratios
+* are evaluated with the current (final) weights, so the only difference with the separate phase is that the earliest samples
+* were drawn under the weights of a few iterations before. All the operators at a given sample share the ratios of the
+* connected configurations (see MeasurementNQS::measureShared).
+* @param _par parameters of the collection - only the number of the blocks is used (the number of groups is at most MC_sam_)
+* @param _meas measurement object to store the measurements
+* @param quiet wanna talk? (default is false)
+* @param _t timepoint for timestamping
+* @param _collectEn collect the energy as well
+* @returns the mean energy of each group
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline arma::Col<_T> NQS<_spinModes, _Ht, _T, _stateType>::collectBuffered(const NQS_train_t& _par,
+																			NQSAv::MeasurementNQS<_T>& _meas,
+																			bool quiet,
+																			clk::time_point _t,
+																			bool _collectEn)
+{
+	const size_t _nBuf	= this->sampleBuf_.size();
+	const uint _groups	= (uint)std::min<size_t>(_par.MC_sam_, _nBuf / std::max<uint>(_par.nblck_, 1));
+	if (_groups == 0)
+	{
+		LOGINFO("No buffered samples to measure with - use collect instead.", LOG_TYPES::WARNING, 3);
+		return arma::Col<_T>();
+	}
+	if (_groups < _par.MC_sam_)
+		LOGINFO("Only " + STR(_groups) + " of " + STR(_par.MC_sam_) + " groups of the samples are buffered.", LOG_TYPES::WARNING, 3);
+
+	arma::Col<_T> meanEn, En;
+	if (_collectEn) {
+		meanEn 	= arma::Col<_T>(_groups, arma::fill::zeros);
+		En 		= arma::Col<_T>(_par.nblck_, arma::fill::zeros);
+	}
+	this->pBar_	= pBar(25, _groups);
+#ifdef NQS_NOT_OMP_MT
+	_meas.setExecutor(this->threads_.pool_.get());
+#endif
+#ifdef SPIN
+	const double _up = this->discVal_, _down = -this->discVal_;
+#else
+	const double _up = 1.0, _down = 0.0;
+#endif
+
+	// the newest samples are used (oldest first)
+	NQSS _v;
+	const size_t _first	= _nBuf - (size_t)_groups * _par.nblck_;
+	for (uint i = 1; i <= _groups; ++i)
+	{
+		for (uint _taken = 0; _taken < _par.nblck_; ++_taken)
+		{
+			const size_t _k = (this->sampleBufHead_ + _first + (size_t)(i - 1) * _par.nblck_ + _taken) % _nBuf;
+			this->sampleBuf_[_k].toVec(_v, _up, _down);
+			this->setState(_v, true);
+
+			if (_collectEn) En(_taken) = this->locEnKernel();
+			_meas.measureShared(NQS_STATE, this->pRatioFunc_);
+		}
+		_meas.normalize(_par.nblck_);
+		if (_collectEn)
+			MonteCarlo::blockmean(En, _par.nblck_, &meanEn(i - 1));
+		PROGRESS_UPD_Q(i, this->pBar_, "PROGRESS NQS", !quiet);
+	}
+	_meas.setExecutor(nullptr);
+	if (this->distributed_)
+	{
+		// the buffers of the ranks are filled by the same iterations - the same number of the groups on each rank
+		if (_collectEn)
+		{
+			NQS_MPI::sumInPlace(meanEn);
+			meanEn /= (double)NQS_MPI::size();
+		}
+		_meas.reduceRanks();
+	}
+	LOGINFO(_t, "NQS_COLLECTION_BUFFERED", 1);
+	return meanEn;
+}
+
 // ##########################################################################################################################################
 
 template <uint _spinModes, typename _Ht, typename _T, class _stateType>
@@ -20,6 +20,7 @@
 #endif // !NQS_H
 
 #define NQS_RBM_PP_USE_PFAFFIAN_UPDATE
+#include "../../algebra/pfaffian_lowrank.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -53,6 +54,7 @@ protected:
 	NQSW Xinv_;													// for stroing the matrix inverse for Pfaffian calculation at each step
 	NQSW XinvSkew_;												// for stroing the matrix inverse for Pfaffian calculation at each step
 	NQSW Xnew_;													// for stroing the matrix for Pfaffian calculation at each step - new candidate
+	algebra::PfaffianLowRank::Update<_T> lowRank_;				// intermediates of the rank-k update of the candidate (multiple flips)
 	
 // for calculating the Pfaffian probabilities from the Hamiltonian
 #if defined NQS_USE_MULTITHREADING && not defined NQS_USE_OMP 
@@ -84,6 +86,7 @@ protected:
 					const NQSS& _v2)		-> _T				override final;
 	auto pRatio(std::initializer_list<int> fP,
 				std::initializer_list<double> fV) -> _T			override final;
+	auto pRatioBatch(const ConnList& _conn)	-> NQSB				override final;
 
 	// ------------------------ W E I G H T S ------------------------
 public:
@@ -92,6 +95,7 @@ public:
 
 protected:
 	void updateWeights()										override final;
+	void bcastWeights()											override final { RBM_S<_spinModes, _Ht, _T, _stateType>::bcastWeights(); NQS_MPI::bcastInPlace(this->Fpp_); };
 	// updates
 #ifdef NQS_ANGLES_UPD
 	void update(uint nFlips)									override final;
@@ -102,6 +106,19 @@ protected:
 	// ---------------------------- T R A I N ----------------------------	
 	void grad(const NQSS& _v, uint _plc)						override final;
 
+	// ---------------------------- C H A I N S --------------------------
+	// the Pfaffian is not updated within the vectorised RBM sampler - use the general per-chain sampler
+	auto chainsParallel()					const -> bool		override final { return false;											};
+	void setChainsTheta()										override final {};
+	void blockSampleChains(uint _bSize)							override final { NQS<_spinModes, _Ht, _T, _stateType>::blockSampleChains(_bSize);	};
+	void gradChain(uint _c, uint _plc)							override final { NQS<_spinModes, _Ht, _T, _stateType>::gradChain(_c, _plc);		};
+	auto locEnKernelChain(uint _c)			-> _T				override final { return NQS<_spinModes, _Ht, _T, _stateType>::locEnKernelChain(_c); };
+	auto locEnChainsBatch(uint, _T*)		-> bool				override final { return false; };
+	auto locEnConn(const LocEnBuffer& _buf)	-> _T				override final { return NQS<_spinModes, _Ht, _T, _stateType>::locEnConn(_buf);	};
+public:
+	static constexpr bool connInline							= false;	// the Pfaffian ratios go through pRatio
+protected:
+
 	// --------------------------- A N S A T Z ---------------------------
 	virtual void updFPP_C(uint fP, float fV)					= 0;
 	virtual void updFPP_C(std::initializer_list<int> fP,
@@ -147,6 +164,10 @@ public:
 	void updatePfaffian(uint _row, _T& _pfaffian);
 	void updatePfaffian(uint _row, _T& _pfaffian, const arma::Mat<_T>& _X);
 	void updatePfaffian_C(uint _row);
+	// rank-k updates for multiple flips at once
+	auto flipRows(uint nFlips)				const -> arma::uvec;
+	void updatePfaffianLowRank_C(uint nFlips);
+	void updateXInvLowRank(uint nFlips);
 #endif
 
 	// --------------------- G E T T E R S ---------------------
@@ -299,8 +320,10 @@ inline void RBM_PP<_spinModes, _Ht, _T, _stateType>::update(uint nFlips)
 	// as the candidate pfaffian shall be already updated, use it instead of calculating everything all the time (probably not as efficient)
 	// replace updating the pfaffian back
 #ifdef NQS_RBM_PP_USE_PFAFFIAN_UPDATE
-	for(uint i = 0; i < nFlips; i++)
-		this->Xinv_	= algebra::scherman_morrison_skew(this->Xinv_, this->flipPlaces_[i], this->Xnew_.row(this->flipPlaces_[i]));
+	if (nFlips == 1)
+		this->Xinv_	= algebra::scherman_morrison_skew(this->Xinv_, this->flipPlaces_[0], this->Xnew_.row(this->flipPlaces_[0]));
+	else
+		this->updateXInvLowRank(nFlips);
 #endif
 	this->X_		= this->Xnew_;
 	this->pfaffian_ = this->pfaffianNew_;
@@ -343,8 +366,10 @@ inline void RBM_PP<_spinModes, _Ht, _T, _stateType>::update(const NQSS& v, uint
 	//	this->updFPP(fP, v(fP));
 	//}
 #ifdef NQS_RBM_PP_USE_PFAFFIAN_UPDATE
-	for(uint i = 0; i < nFlips; i++)
-		this->Xinv_	= algebra::scherman_morrison_skew(this->Xinv_, this->flipPlaces_[i], this->Xnew_.row(this->flipPlaces_[i]));
+	if (nFlips == 1)
+		this->Xinv_	= algebra::scherman_morrison_skew(this->Xinv_, this->flipPlaces_[0], this->Xnew_.row(this->flipPlaces_[0]));
+	else
+		this->updateXInvLowRank(nFlips);
 #endif
 	this->X_		= this->Xnew_;
 	this->pfaffian_ = this->pfaffianNew_;
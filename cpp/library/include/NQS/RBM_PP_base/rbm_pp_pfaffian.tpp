@@ -59,4 +59,45 @@ inline void RBM_PP<_spinModes, _Ht, _T, _stateType>::updateXInv_C(uint _row)
 	this->Xinv_ = algebra::scherman_morrison_skew(this->Xinv_, _row, this->Xnew_.row(_row));
 }
 
+// ##########################################################################################################################################
+
+/*
+* @brief Returns the rows of the Pfaffian matrix changed by the stored flips
+* @param nFlips number of flips to be used
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline arma::uvec RBM_PP<_spinModes, _Ht, _T, _stateType>::flipRows(uint nFlips) const
+{
+	arma::uvec _rows(nFlips);
+	for (uint i = 0; i < nFlips; ++i)
+		_rows(i) = this->flipPlaces_[i];
+	return _rows;
+}
+
+/*
+* @brief Calculates the candidate Pfaffian for multiple flips at once with the rank-k update. The intermediates are
+* stored, so that the inverse is updated only if the move is accepted (the rejected move does not touch Xinv_).
+* @param nFlips number of flips to be used (the candidate matrix Xnew_ shall be already set)
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void RBM_PP<_spinModes, _Ht, _T, _stateType>::updatePfaffianLowRank_C(uint nFlips)
+{
+	this->pfaffianNew_ = this->pfaffian_ * algebra::PfaffianLowRank::prepare(this->Xinv_, this->X_, this->Xnew_, this->flipRows(nFlips), this->lowRank_);
+}
+
+/*
+* @brief Updates the X matrix inverse after the accepted multiple flips - reuses the intermediates of the candidate Pfaffian
+* when they correspond to the same rows, otherwise prepares them from scratch.
+* @param nFlips number of flips to be used
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void RBM_PP<_spinModes, _Ht, _T, _stateType>::updateXInvLowRank(uint nFlips)
+{
+	const arma::uvec _rows = this->flipRows(nFlips);
+	if (this->lowRank_.rows_.n_elem != nFlips || arma::any(this->lowRank_.rows_ != _rows))
+		algebra::PfaffianLowRank::prepare(this->Xinv_, this->X_, this->Xnew_, _rows, this->lowRank_);
+	algebra::PfaffianLowRank::apply(this->Xinv_, this->lowRank_);
+	this->lowRank_.rows_.reset();
+}
+
 #endif
\ No newline at end of file
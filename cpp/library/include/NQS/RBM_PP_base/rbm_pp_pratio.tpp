@@ -42,14 +42,16 @@ template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline _T RBM_PP<_spinModes, _Ht, _T, _stateType>::pRatio(uint nFlips)
 {
 	// update pfaffian candidate matrix and its corresponding value
-	for (auto i = 0; i < nFlips; ++i)
-		this->updFPP_C(this->flipPlaces_[i], this->flipVals_[i]);
+	if (nFlips == 2)
+		this->updFPP_C({ (int)this->flipPlaces_[0], (int)this->flipPlaces_[1] }, { this->flipVals_[0], this->flipVals_[1] });
+	else
+		for (auto i = 0; i < nFlips; ++i)
+			this->updFPP_C(this->flipPlaces_[i], this->flipVals_[i]);
 #ifdef NQS_RBM_PP_USE_PFAFFIAN_UPDATE
-	for (auto i = 0; i < nFlips; ++i)
-		this->updatePfaffian_C(this->flipPlaces_[i]);
-	//LOG_DEBUG(VEQP(this->pfaffianNew_, 10), "Pfaffian from update");
-	//this->setPfaffian_C();
-	//LOG_DEBUG(VEQP(this->pfaffianNew_, 10), "Pfaffian from scratch");
+	if (nFlips == 1)
+		this->updatePfaffian_C(this->flipPlaces_[0]);
+	else
+		this->updatePfaffianLowRank_C(nFlips);
 #else
 	this->setPfaffian_C();
 #endif
@@ -91,7 +93,7 @@ inline _T RBM_PP<_spinModes, _Ht, _T, _stateType>::pRatio(std::initializer_list<
 		for(const auto& _row: fP)
 			this->updatePfaffian(_row, _pfaffian, this->XTmp_[thId]);
 	else
-		_pfaffian		= this->getPfaffian(this->XTmp_[thId]);
+		_pfaffian		*= algebra::PfaffianLowRank::ratio(this->Xinv_, this->X_, this->XTmp_[thId], arma::conv_to<arma::uvec>::from(std::vector<int>(fP)));
 #else
 	auto _pfaffian		= this->getPfaffian(this->XTmp_[thId]);
 #endif
@@ -104,4 +106,51 @@ inline _T RBM_PP<_spinModes, _Ht, _T, _stateType>::pRatio(std::initializer_list<
 	return RBM_S<_spinModes, _Ht, _T, _stateType>::pRatio(fP, fV) * _pfaffian / this->pfaffian_;
 }
 
-// ##########################################################################################################################################
\ No newline at end of file
+// ##########################################################################################################################################
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%% B A T C H %%%%%%%%%%%%%%%%%%%%%%%%%%
+
+/*
+* @brief Calculates the probability ratios for all the connections of the current state. The RBM part is obtained
+* in a single batch, the Pfaffian part is updated for each connection - for a single flip with the row update using Xinv_.
+* @param _conn list of the connections (one or two flips each)
+* @returns ratios in the order of the connections
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline typename RBM_PP<_spinModes, _Ht, _T, _stateType>::NQSB RBM_PP<_spinModes, _Ht, _T, _stateType>::pRatioBatch(const ConnList& _conn)
+{
+#ifdef NQS_ANGLES_UPD
+	NQSB _out			= RBM_S<_spinModes, _Ht, _T, _stateType>::pRatioBatch(_conn);
+	NQSW _XTmp;
+	for (size_t k = 0; k < _conn.size(); ++k)
+	{
+		const auto& _c	= _conn[k];
+		_XTmp			= this->X_;
+		auto _pfaffian	= this->pfaffian_;
+		if (_c.n_ == 1)
+		{
+			this->updFPP_F({ _c.fP_[0] }, { _c.fV_[0] }, _XTmp);
+#ifdef NQS_RBM_PP_USE_PFAFFIAN_UPDATE
+			this->updatePfaffian(_c.fP_[0], _pfaffian, _XTmp);
+#else
+			_pfaffian	= this->getPfaffian(_XTmp);
+#endif
+		}
+		else
+		{
+			this->updFPP_F({ _c.fP_[0], _c.fP_[1] }, { _c.fV_[0], _c.fV_[1] }, _XTmp);
+#ifdef NQS_RBM_PP_USE_PFAFFIAN_UPDATE
+			_pfaffian	*= algebra::PfaffianLowRank::ratio(this->Xinv_, this->X_, _XTmp, arma::uvec({ (arma::uword)_c.fP_[0], (arma::uword)_c.fP_[1] }));
+#else
+			_pfaffian	= this->getPfaffian(_XTmp);
+#endif
+		}
+		_out(k)			*= _pfaffian / this->pfaffian_;
+	}
+	return _out;
+#else
+	return NQS<_spinModes, _Ht, _T, _stateType>::pRatioBatch(_conn);
+#endif
+}
+
+// ##########################################################################################################################################
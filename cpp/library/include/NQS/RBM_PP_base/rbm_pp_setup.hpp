@@ -88,8 +88,9 @@ inline void RBM_PP<_spinModes, _Ht, _T, _stateType>::allocate()
 
 #if defined NQS_USE_MULTITHREADING && not defined NQS_USE_OMP
 	// allocate the vector for using it in the RBM
-	for (int _thread = 0; _thread < this->threads_.threadNum_; _thread++)
-		this->XTmp_[this->threads_.threads_[_thread].get_id()] = NQSW(this->info_p_.nParticles_, this->info_p_.nParticles_, arma::fill::zeros);
+	for (const auto& _thread : this->threads_.pool_->threads())
+		this->XTmp_[_thread.get_id()] = NQSW(this->info_p_.nParticles_, this->info_p_.nParticles_, arma::fill::zeros);
+	this->XTmp_[std::this_thread::get_id()] = NQSW(this->info_p_.nParticles_, this->info_p_.nParticles_, arma::fill::zeros);
 #endif
 
 	// allocate the weights themselves !TODO - make this symmetric? 
@@ -151,7 +151,7 @@ void RBM_PP_S<2, _Ht, _T, _stateType>::updFPP_C(uint fP, float fV)
 			continue;
 
 		// check the bit on the i'th place to know in which place you'll end up
-		bool spin_next	= checkBit(this->curVec_, i);
+		bool spin_next	= this->curBits_.get(i);
 
 		// F_{ri,rj}^{\\sigma_i, \\sigma_j} - find the index corresponding to those particles in F
 		auto posLeft	= this->getFPPIndex(fVV, spin_next, fP, i);
@@ -187,7 +187,7 @@ void RBM_PP_S<2, _Ht, _T, _stateType>::updFPP(uint fP, float fV)
 			continue;
 
 		// check the bit on the i'th place to know in which place you'll end up
-		bool spin_next	= checkBit(this->curVec_, i);
+		bool spin_next	= this->curBits_.get(i);
 
 		// F_{ri,rj}^{\\sigma_i, \\sigma_j} - find the index corresponding to those particles in F
 		auto posLeft	= this->getFPPIndex(fV < 0, spin_next, fP, i);
@@ -218,7 +218,7 @@ void RBM_PP_S<2, _Ht, _T, _stateType>::updFPP_F(std::initializer_list<int> fP, s
 	v_1d<bool> _state(this->curVec_.size());
 
 	for (auto i = 0; i < this->info_p_.nParticles_; ++i)
-		_state[i] = checkBit(this->curVec_, i);
+		_state[i] = this->curBits_.get(i);
 
 	for (auto fPi = 0; fPi < fP.size(); ++fPi)
 		_state[*(fP.begin() + fPi)] = (*(fV.begin() + fPi) < 0);
@@ -5,6 +5,8 @@
 #ifndef NQS_H
 	#include "../nqs_final.hpp"
 #endif // !NQS_H
+#include "rbm_kernels.h"
+#include "../NQS_base/nqs_precision.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -39,6 +41,18 @@ protected:
 	// ------------------------- A N G L E S -------------------------
 	NQSB theta_;
 	NQSB thetaCOSH_;
+	_T thetaLCS_					=						0.0;			// \sum _h log cosh(theta_h) of the current state
+	// ----------------------- P R E C I S I O N ---------------------
+	using Prec						=						NQSPrecision::Default<_T>;
+	using kernT						=						typename Prec::kernel_t;
+	arma::Mat<kernT> Wk_;									// copy of the weights for the acceptance kernels (mixed precision only)
+	arma::Col<kernT> thetaK_;								// copy of the angles for the acceptance kernels (mixed precision only)
+	_T thetaLCSK_					=						0.0;			// \sum _h log cosh of the copied angles, accumulated in _T (mixed precision only)
+	bool kStale_					=						true;			// the weights changed since Wk_ was copied
+	void weightsChanged()									{ this->kStale_ = true; };
+	void setThetaK();
+	auto kTheta()					const -> const kernT*	{ if constexpr (Prec::mixed) return this->thetaK_.memptr(); else return this->theta_.memptr();	};
+	auto kW(uint _col)				const -> const kernT*	{ if constexpr (Prec::mixed) return this->Wk_.colptr(_col); else return this->W_.colptr(_col);	};
 	// calculate the hiperbolic cosine of the function to obtain the ansatz
 	auto coshF(const NQSS& _v)		const -> NQSB			{ return arma::cosh(this->bH_ + this->W_ * _v);		};
 	auto coshF()					const -> NQSB			{ return arma::cosh(this->theta_);					};
@@ -49,6 +63,10 @@ protected:
 #else
 	NQSB thetaTmp_;
 #endif
+	// -------------------------- C H A I N S ------------------------
+	NQSW thetaChains_;										// angles of all the chains (nHid x nChains)
+	NQSW thetaChainsCOSH_;									// hyperbolic cosines of the angles of the chains
+	virtual void setChainsTheta()							override;
 	
 	/* ------------------------------------------------------------ */
 protected:
@@ -82,6 +100,7 @@ public:
 							std::string _file)				override;
 protected:
 	virtual void updateWeights()							override;
+	virtual void bcastWeights()								override	{ NQS_MPI::bcastInPlace(this->bV_); NQS_MPI::bcastInPlace(this->bH_); NQS_MPI::bcastInPlace(this->W_); this->weightsChanged(); };
 	// set the angles for the RBM to be updated
 	void setTheta()											{ this->setTheta(this->curVec_); };
 	void setTheta(const NQSS& v);
@@ -93,6 +112,8 @@ protected:
 
 	// ------------------------- T R A I N ------------------------------	
 	virtual void grad(const NQSS& _v, uint _plc)			override;
+	virtual void gradChain(uint _c, uint _plc)				override;
+	void gradTheta(const NQSS& _v, const NQSB& _theta, uint _plc);
 
 	// -------------------------------------------------------------------
 public:
@@ -172,7 +193,45 @@ template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline void RBM<_spinModes, _Ht, _T, _stateType>::setTheta(const NQSS& v)
 {
 	this->theta_		= this->bH_ + this->W_ * v;
-	this->thetaCOSH_	= this->coshF();
+	this->thetaCOSH_.set_size(this->nHid_);
+	this->thetaLCS_		= RBMKernels::refresh(this->theta_.memptr(), this->thetaCOSH_.memptr(), this->nHid_);
+	// the single precision weights are copied only after the weights changed (update, load, broadcast)
+	if constexpr (Prec::mixed)
+	{
+		if (this->kStale_)
+		{
+			this->Wk_	= arma::conv_to<arma::Mat<kernT>>::from(this->W_);
+			this->kStale_ = false;
+		}
+		this->setThetaK();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Copies the angles for the acceptance kernels - theta_ stays the only store that is updated, so that the copy never
+* drifts from it. The reference \sum _h log cosh is taken from the same copy (accumulated in _T), hence the ratio of the
+* kernels carries no bias between the precisions.
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void RBM<_spinModes, _Ht, _T, _stateType>::setThetaK()
+{
+	this->thetaK_		= arma::conv_to<arma::Col<kernT>>::from(this->theta_);
+	this->thetaLCSK_	= RBMKernels::logCoshSum<kernT, _T>(this->thetaK_.memptr(), this->nHid_);
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+/*
+* @brief sets the angles of all the chains at once - single matrix product W * S, where S stores the chains as columns
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void RBM<_spinModes, _Ht, _T, _stateType>::setChainsTheta()
+{
+	this->thetaChains_		= this->W_ * arma::conv_to<NQSW>::from(this->chains_);
+	this->thetaChains_.each_col() += this->bH_;
+	this->thetaChainsCOSH_	= arma::cosh(this->thetaChains_);
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -188,6 +247,7 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::updateWeights()
 	this->bH_	-= this->dF_.subvec(this->info_p_.nVis_, this->info_p_.nVis_ + this->nHid_ - 1);
 	this->W_	-= arma::reshape(this->dF_.subvec(this->info_p_.nVis_ + this->nHid_, this->rbmSize_ - 1),
 								this->W_.n_rows, this->W_.n_cols);
+	this->weightsChanged();
 }
 
 // ##########################################################################################################################################
@@ -204,19 +264,45 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::updateWeights()
 template<uint _spinModes, typename _Ht, typename _T, class _stateType>
 inline void RBM<_spinModes, _Ht, _T, _stateType>::grad(const NQSS& _v, uint _plc)
 {
-	// get the subviews
-	auto _currDerivative	= this->derivatives_.row(_plc);
-	auto _hiddDerivative	= _currDerivative.subvec(this->info_p_.nVis_, this->info_p_.nVis_ + this->nHid_ - 1);
-	auto _weightsDerivative = _currDerivative.subvec(this->info_p_.nVis_ + this->nHid_, this->rbmSize_ - 1);
-
 	// update the angles if it is necessary
 #ifndef NQS_ANGLES_UPD
 	this->setTheta(_v);
 #endif
+	this->gradTheta(_v, this->theta_, _plc);
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the variational derivatives for the chain _c using its stored angles.
+* @param _c index of the chain
+* @param _plc row at which to store the derivatives
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void RBM<_spinModes, _Ht, _T, _stateType>::gradChain(uint _c, uint _plc)
+{
+	this->gradTheta(NQSS(this->chains_.col(_c)), NQSB(this->thetaChains_.col(_c)), _plc);
+}
+
+////////////////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the variational derivatives for the given state and its angles.
+* @param _v vector to calculate the derivatives for
+* @param _theta angles corresponding to the vector
+* @param _plc row at which to store the derivatives
+*/
+template<uint _spinModes, typename _Ht, typename _T, class _stateType>
+inline void RBM<_spinModes, _Ht, _T, _stateType>::gradTheta(const NQSS& _v, const NQSB& _theta, uint _plc)
+{
+	// get the subviews
+	auto _currDerivative	= this->derivatives_.row(_plc);
+	auto _hiddDerivative	= _currDerivative.subvec(this->info_p_.nVis_, this->info_p_.nVis_ + this->nHid_ - 1);
+	auto _weightsDerivative = _currDerivative.subvec(this->info_p_.nVis_ + this->nHid_, this->rbmSize_ - 1);
 
 	// calculate the flattened part
 	_currDerivative.head(this->info_p_.nVis_) 	= arma::conv_to<arma::Row<_T>>::from(_v);
-	_hiddDerivative								= arma::tanh(this->theta_).as_row();
+	_hiddDerivative								= arma::tanh(_theta).as_row();
 
 // #ifndef _DEBUG
 // #pragma omp parallel for
@@ -244,12 +330,16 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::update(uint nFlips)
 	for (uint i = 0; i < nFlips; ++i)
 	{
 #ifdef SPIN
-		this->theta_	-=	(2.0 * this->flipVals_[i]) * this->W_.col(this->flipPlaces_[i]);
+		const double _d	=	-2.0 * this->flipVals_[i];
 #else
-		this->theta_	+=	(1.0 - 2.0 * this->flipVals_[i]) * this->W.col(flipPlaces_[i]);
+		const double _d	=	1.0 - 2.0 * this->flipVals_[i];
 #endif
+		RBMKernels::shift(this->theta_.memptr(), this->W_.colptr(this->flipPlaces_[i]), _d, this->nHid_);
 	}
-	this->thetaCOSH_	=	this->coshF();
+	this->thetaLCS_		=	RBMKernels::refresh(this->theta_.memptr(), this->thetaCOSH_.memptr(), this->nHid_);
+	// the energies and the gradients use the full precision angles, the acceptance their copy
+	if constexpr (Prec::mixed)
+		this->setThetaK();
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -267,12 +357,15 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::update(const NQSS& v, uint nFl
 	{
 		const auto fP	=	this->flipPlaces_[i];
 #ifdef SPIN
-		this->theta_	-=	(2.0 * v(fP)) * this->W_.col(fP);
+		const double _d	=	-2.0 * v(fP);
 #else
-		this->theta_	+=	(1.0 - 2.0 * v(fP)) * this->W.col(fP);
+		const double _d	=	1.0 - 2.0 * v(fP);
 #endif
+		RBMKernels::shift(this->theta_.memptr(), this->W_.colptr(fP), _d, this->nHid_);
 	}
-	this->thetaCOSH_	=	this->coshF();
+	this->thetaLCS_		=	RBMKernels::refresh(this->theta_.memptr(), this->thetaCOSH_.memptr(), this->nHid_);
+	if constexpr (Prec::mixed)
+		this->setThetaK();
 
 }
 #endif
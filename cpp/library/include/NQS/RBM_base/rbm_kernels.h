@@ -0,0 +1,170 @@
+#pragma once
+/***********************************
+* Defines the fused kernels for the
+* angles of the RBM. The probability
+* ratio is evaluated in the log-space
+* as a single pass over the hidden
+* units without the temporaries.
+***********************************/
+
+#ifndef RBM_KERNELS_H
+#define RBM_KERNELS_H
+
+#include <cmath>
+#include <complex>
+#include <type_traits>
+
+constexpr unsigned RBM_KERNEL_MAX_FLIPS	= 8;											// maximal number of flips handled by the fused kernels
+constexpr double RBM_KERNEL_LN2			= 0.693147180559945309417;						// log(2)
+
+namespace RBMKernels
+{
+	/*
+	* @brief Stable log(cosh(x)) = |x| + log(1 + exp(-2|x|)) - log(2), does not overflow for large angles
+	*/
+	inline double logcosh(double _x)
+	{
+		const double _a = std::abs(_x);
+		return _a + std::log1p(std::exp(-2.0 * _a)) - RBM_KERNEL_LN2;
+	}
+
+	/*
+	* @brief Stable log(cosh(z)) for the complex angles - cosh is even, therefore, the branch with the
+	* non-negative real part is taken and |exp(-2z)| <= 1. The imaginary part is defined modulo 2pi, which
+	* is irrelevant after the exponentiation of the ratio.
+	*/
+	inline std::complex<double> logcosh(std::complex<double> _z)
+	{
+		if (_z.real() < 0.0)
+			_z = -_z;
+		return _z + std::log(1.0 + std::exp(-2.0 * _z)) - RBM_KERNEL_LN2;
+	}
+
+	/*
+	* @brief Single precision versions (mixed precision kernels)
+	*/
+	inline float logcosh(float _x)
+	{
+		const float _a = std::abs(_x);
+		return _a + std::log1p(std::exp(-2.0f * _a)) - (float)RBM_KERNEL_LN2;
+	}
+
+	inline std::complex<float> logcosh(std::complex<float> _z)
+	{
+		if (_z.real() < 0.0f)
+			_z = -_z;
+		return _z + std::log(1.0f + std::exp(-2.0f * _z)) - (float)RBM_KERNEL_LN2;
+	}
+
+	// real type of the scalar (the changes of the visible units multiply the weights in their precision)
+	template <typename _T>
+	using real_t = decltype(std::real(_T{}));
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Returns \sum _h log cosh(theta_h)
+	* @param _theta angles
+	* @param _n number of hidden units
+	* @tparam _A type of the accumulator
+	*/
+	template <typename _T, typename _A = _T>
+	inline _A logCoshSum(const _T* _theta, unsigned _n)
+	{
+		if constexpr (std::is_floating_point_v<_T>)
+		{
+			_A _acc = 0.0;
+#pragma omp simd reduction(+ : _acc)
+			for (unsigned h = 0; h < _n; ++h)
+				_acc += (_A)logcosh(_theta[h]);
+			return _acc;
+		}
+		else
+		{
+			_A _acc = 0.0;
+			for (unsigned h = 0; h < _n; ++h)
+				_acc += (_A)logcosh(_theta[h]);
+			return _acc;
+		}
+	}
+
+	/*
+	* @brief Returns \sum _h log cosh(theta_h + \sum _f d_f W_{h, f}) for the flipped state - a single pass over the hidden units
+	* @param _theta angles of the current state
+	* @param _w columns of the weights for the flipped visible units
+	* @param _d changes of the visible units
+	* @param _k number of the flips (<= RBM_KERNEL_MAX_FLIPS)
+	* @param _n number of hidden units
+	* @tparam _T type of the angles and the weights (single precision in the mixed precision mode)
+	* @tparam _A type of the accumulator
+	*/
+	template <typename _T, typename _A = _T>
+	inline _A logCoshShift(const _T* _theta, const _T* const* _w, const double* _d, unsigned _k, unsigned _n)
+	{
+		using _R = real_t<_T>;
+		_A _acc = 0.0;
+		if (_k == 1)
+		{
+			const _T* _w0	= _w[0];
+			const _R _d0	= (_R)_d[0];
+			if constexpr (std::is_floating_point_v<_T>)
+			{
+#pragma omp simd reduction(+ : _acc)
+				for (unsigned h = 0; h < _n; ++h)
+					_acc += (_A)logcosh(_theta[h] + _d0 * _w0[h]);
+			}
+			else
+			{
+				for (unsigned h = 0; h < _n; ++h)
+					_acc += (_A)logcosh(_theta[h] + _d0 * _w0[h]);
+			}
+			return _acc;
+		}
+		for (unsigned h = 0; h < _n; ++h)
+		{
+			_T _th = _theta[h];
+			for (unsigned f = 0; f < _k; ++f)
+				_th += (_R)_d[f] * _w[f][h];
+			_acc += (_A)logcosh(_th);
+		}
+		return _acc;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Updates the angles after the flip: theta_h += d W_h
+	* @param _theta angles (modified)
+	* @param _w column of the weights for the flipped visible unit
+	* @param _d change of the visible unit
+	* @param _n number of hidden units
+	*/
+	template <typename _T>
+	inline void shift(_T* _theta, const _T* _w, double _d, unsigned _n)
+	{
+		const real_t<_T> _dr = (real_t<_T>)_d;
+#pragma omp simd
+		for (unsigned h = 0; h < _n; ++h)
+			_theta[h] += _dr * _w[h];
+	}
+
+	/*
+	* @brief Recalculates the hyperbolic cosines of the angles and returns \sum _h log cosh(theta_h) in the same pass
+	* @param _theta angles
+	* @param _cosh cosines (modified)
+	* @param _n number of hidden units
+	*/
+	template <typename _T>
+	inline _T refresh(const _T* _theta, _T* _cosh, unsigned _n)
+	{
+		_T _acc = 0.0;
+		for (unsigned h = 0; h < _n; ++h)
+		{
+			_cosh[h]	= std::cosh(_theta[h]);
+			_acc		+= logcosh(_theta[h]);
+		}
+		return _acc;
+	}
+};
+
+#endif // !RBM_KERNELS_H
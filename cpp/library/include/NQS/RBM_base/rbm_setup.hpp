@@ -39,11 +39,13 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::allocate()
 	this->theta_.resize(this->nHid_);
 	this->thetaCOSH_.resize(this->nHid_);
 	this->W_.resize(this->nHid_, this->info_p_.nVis_);
+	this->weightsChanged();
 	// create thread map
 #if defined NQS_USE_MULTITHREADING && not defined NQS_USE_OMP
 	// allocate the vector for using it in the RBM
-	for (int _thread = 0; _thread < this->threads_.threadNum_; _thread++)
-		this->thetaTmp_[this->threads_.threads_[_thread].get_id()] = NQSB(this->nHid_);
+	for (const auto& _thread : this->threads_.pool_->threads())
+		this->thetaTmp_[_thread.get_id()] = NQSB(this->nHid_);
+	this->thetaTmp_[std::this_thread::get_id()] = NQSB(this->nHid_);
 #else
 	this->thetaTmp_ = NQSB(this->nHid_);
 #endif
@@ -81,6 +83,7 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::init()
 			this->W_(i, j) = algebra::cast<_T>(this->ran_.template randomNormal<double>(0.0, stddev) + I * this->ran_.template randomNormal<double>(0.0, stddev));
 		}
 	}
+	this->weightsChanged();
 	// initialize with a random state
 	this->setRandomState();
 }
@@ -150,6 +153,7 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::setWeights(const NQSW& _W, con
 	this->W_	= _W;
 	this->bV_	= _bV;
 	this->bH_	= _bH;
+	this->weightsChanged();
 }
 
 template <uint _spinModes, typename _Ht, typename _T, class _stateType>
@@ -159,6 +163,7 @@ inline void RBM<_spinModes, _Ht, _T, _stateType>::setWeights(std::shared_ptr<RBM
     this->W_	= _rbm->getWeights();
     this->bV_	= _rbm->getVisibleBias();
     this->bH_	= _rbm->getHiddenBias();
+	this->weightsChanged();
 }
 
 /*
@@ -179,6 +184,7 @@ inline bool RBM<_spinModes, _Ht, _T, _stateType>::setWeights(std::string _path,
 		this->bH_	= this->F_.subvec(this->info_p_.nVis_, this->info_p_.nVis_ + this->nHid_ - 1);
 		this->W_	= arma::reshape(this->F_.subvec(this->info_p_.nVis_ + this->nHid_, this->info_p_.nVis_ + this->nHid_ + this->W_.n_rows * this->W_.n_cols - 1),
 									this->W_.n_rows, this->W_.n_cols);
+		this->weightsChanged();
 	}
 	END_CATCH_HANDLER("Couldn't set the weights for the RBM NQS...", return false);
 	return true;
@@ -21,6 +21,8 @@ class RBM_S<2, _Ht, _T, _stateType> : public RBM<2, _Ht, _T, _stateType>
 {
 	NQS_PUBLIC_TYPES(_T, _stateType);
 	using NQSLS_p =	typename RBM<2, _Ht, _T, _stateType>::NQSLS_p;
+	using Prec	  =	typename RBM<2, _Ht, _T, _stateType>::Prec;
+	using kernT	  =	typename RBM<2, _Ht, _T, _stateType>::kernT;
 public:
 	RBM_S(std::shared_ptr<Hamiltonian<_Ht>>& _H, uint _nHid, double _lr,
 	 uint _threadNum = 1, int _nParticles = -1, const NQSLS_p& _lower = {}, const std::vector<double>& _beta = {})
@@ -40,6 +42,32 @@ protected:
 	virtual auto pRatio(const NQSS& _v1)			-> _T	override;
 	virtual auto pRatio(std::initializer_list<int> fP,		
 				std::initializer_list<double> fV)	-> _T	override;
+#ifdef NQS_ANGLES_UPD
+	virtual auto pRatioBatch(const ConnList& _conn)	-> NQSB	override;
+#endif
+	
+	// ------------------------- C H A I N S ------------------------
+	auto pRatioChain(uint _c, std::initializer_list<int> fP,
+				std::initializer_list<double> fV)	-> _T;
+	virtual auto chainsParallel()			const -> bool	override { return true; };
+	virtual void blockSampleChains(uint _bSize)		override;
+	virtual auto locEnKernelChain(uint _c)			-> _T	override;
+#ifdef NQS_USE_GPU
+	NQS_GPU::RBMChains<_T> devChains_;								// chains on the device (see NQS::setDevice)
+	void blockSampleChainsDevice(uint _bSize);
+	virtual auto locEnChainsBatch(uint _n, _T* _En)	-> bool	override;
+#endif
+
+	// ------------------- C O N N E C T I O N S --------------------
+	auto connRatio(const LocEnConn& _c, const _T* _theta,
+				_T _lcs)						const -> _T;
+	auto connEnergy(const LocEnBuffer& _buf, const _T* _theta,
+				_T _lcs)						const -> _T;
+#ifdef NQS_ANGLES_UPD
+	virtual auto locEnConn(const LocEnBuffer& _buf)	-> _T	override { return this->connEnergy(_buf, this->theta_.memptr(), this->thetaLCS_); };
+public:
+	static constexpr bool connInline			= true;
+#endif
 };
 
 // !!!!!!!!!!!!!!!!!!! P R O B A B I L I T Y !!!!!!!!!!!!!!!!!!!
@@ -62,7 +90,9 @@ inline _T RBM_S<2, _Ht, _T, _stateType>::pRatio(uint fP, float fV)
 #ifdef NQS_ANGLES_UPD
 	//val				=	val * this->bV_(fP) + arma::sum(arma::log(arma::cosh(this->theta_ + val * this->W_.col(fP)) / this->thetaCOSH_));
 	//val				=	val * this->bV_(fP) + arma::sum(arma::log(arma::cosh(this->theta_ + val * this->W_.col(fP)) / arma::cosh(this->theta_)));
-	val				=	std::exp(val * this->bV_(fP)) * arma::prod(arma::cosh(this->theta_ + val * this->W_.col(fP)) / this->thetaCOSH_);
+	const _T* _w[1]	=	{ this->W_.colptr(fP) };
+	const double _d[1]=	{ RBM_SPIN_UPD(fV) };
+	val				=	std::exp(val * this->bV_(fP) + RBMKernels::logCoshShift(this->theta_.memptr(), _w, _d, 1, this->nHid_) - this->thetaLCS_);
 #else
 	// flip the temporary vector
 	this->tmpVec_	=	this->curVec_;
@@ -85,11 +115,45 @@ inline _T RBM_S<2, _Ht, _T, _stateType>::pRatio(uint fP, float fV)
 template<typename _Ht, typename _T, class _stateType>
 inline _T RBM_S<2, _Ht, _T, _stateType>::pRatio(uint nFlips)
 {
+#ifdef NQS_ANGLES_UPD
+	// mixed precision - the acceptance ratio of the sampling reads the single precision copies, accumulates in _T
+	if constexpr (Prec::mixed)
+	{
+		if (nFlips <= RBM_KERNEL_MAX_FLIPS)
+		{
+			const kernT* _w[RBM_KERNEL_MAX_FLIPS];
+			double _d[RBM_KERNEL_MAX_FLIPS];
+			_T val			=	0;
+			for (uint i = 0; i < nFlips; ++i)
+			{
+				_w[i]		=	this->kW(this->flipPlaces_[i]);
+				_d[i]		=	RBM_SPIN_UPD(this->flipVals_[i]);
+				val			+=	_d[i] * this->bV_(this->flipPlaces_[i]);
+			}
+			return std::exp(val + RBMKernels::logCoshShift<kernT, _T>(this->kTheta(), _w, _d, nFlips, this->nHid_) - this->thetaLCSK_);
+		}
+	}
+#endif
 	// you know what to do after one flip
 	if (nFlips == 1)
 		return RBM_S<2, _Ht, _T, _stateType>::pRatio(this->flipPlaces_[0], this->flipVals_[0]);
 	// set the starting point
 	_T val				=	0;
+#ifdef NQS_ANGLES_UPD
+	// fused kernel - single pass over the hidden units without the temporary angles
+	if (nFlips <= RBM_KERNEL_MAX_FLIPS)
+	{
+		const _T* _w[RBM_KERNEL_MAX_FLIPS];
+		double _d[RBM_KERNEL_MAX_FLIPS];
+		for (uint i = 0; i < nFlips; ++i)
+		{
+			_w[i]		=	this->W_.colptr(this->flipPlaces_[i]);
+			_d[i]		=	RBM_SPIN_UPD(this->flipVals_[i]);
+			val			+=	_d[i] * this->bV_(this->flipPlaces_[i]);
+		}
+		return std::exp(val + RBMKernels::logCoshShift(this->theta_.memptr(), _w, _d, nFlips, this->nHid_) - this->thetaLCS_);
+	}
+#endif
 	// save the temporary angles
 #ifdef NQS_NOT_OMP_MT
 	auto thId				= std::this_thread::get_id();
@@ -183,6 +247,23 @@ inline _T RBM_S<2, _Ht, _T, _stateType>::pRatio(std::initializer_list<int> fP, s
 	// set the starting point
 	_T val			= 0;
 	auto currVal	= 0.0;
+#ifdef NQS_ANGLES_UPD
+	// fused kernel - single pass over the hidden units without the temporary angles
+	if (nFlips <= RBM_KERNEL_MAX_FLIPS)
+	{
+		const _T* _w[RBM_KERNEL_MAX_FLIPS];
+		double _d[RBM_KERNEL_MAX_FLIPS];
+		auto _fP		= fP.begin();
+		auto _fV		= fV.begin();
+		for (uint i = 0; i < nFlips; ++i, ++_fP, ++_fV)
+		{
+			_w[i]		= this->W_.colptr(*_fP);
+			_d[i]		= RBM_SPIN_UPD(*_fV);
+			val			+= _d[i] * this->bV_(*_fP);
+		}
+		return std::exp(val + RBMKernels::logCoshShift(this->theta_.memptr(), _w, _d, (uint)nFlips, this->nHid_) - this->thetaLCS_);
+	}
+#endif
 	// make temporary angles vector
 #ifdef NQS_NOT_OMP_MT
 	this->thetaTmp_[thId] = this->theta_;
@@ -217,6 +298,303 @@ inline _T RBM_S<2, _Ht, _T, _stateType>::pRatio(std::initializer_list<int> fP, s
 	return val;
 }
 
+// %%%%%%%%%%%%%%%%%%%%%%%%%% B A T C H %%%%%%%%%%%%%%%%%%%%%%%%%%
+
+#ifdef NQS_ANGLES_UPD
+/*
+* @brief Calculates the probability ratios for all the connections of the current state at once. The changes of the visible
+* variables form a sparse matrix D (nVis x nConn, at most two nonzeros in a column), therefore, the angles of all the connected
+* states are obtained with a single product theta + W * D. The ratios are evaluated in the log-space as
+* exp(bV^T D + \sum _h log cosh(theta'_h) - \sum _h log cosh(theta_h)), which does not overflow for wide hidden layers.
+* @param _conn list of the connections (one or two flips each)
+* @returns ratios in the order of the connections
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline typename RBM_S<2, _Ht, _T, _stateType>::NQSB RBM_S<2, _Ht, _T, _stateType>::pRatioBatch(const ConnList& _conn)
+{
+	const uint _n		= (uint)_conn.size();
+	NQSB _out(_n, arma::fill::zeros);
+	if (_n == 0)
+		return _out;
+
+	uint _nnz			= 0;
+	for (uint k = 0; k < _n; ++k)
+		_nnz			+= _conn[k].n_;
+
+	// changes of the visible variables (and the visible bias part of the ratio)
+	arma::umat _loc(2, _nnz);
+	arma::Col<_T> _val(_nnz);
+	for (uint k = 0, i = 0; k < _n; ++k)
+	{
+		const auto& _c	= _conn[k];
+		for (uint f = 0; f < _c.n_; ++f, ++i)
+		{
+			const double _d	= RBM_SPIN_UPD(_c.fV_[f]);
+			_loc(0, i)		= _c.fP_[f];
+			_loc(1, i)		= k;
+			_val(i)			= _d;
+			_out(k)			+= _d * this->bV_(_c.fP_[f]);
+		}
+	}
+	const arma::SpMat<_T> _D(true, _loc, _val, this->info_p_.nVis_, _n);
+
+	// angles of all the connected states
+	NQSW _theta			= this->W_ * _D;
+	_theta.each_col()	+= this->theta_;
+	for (uint k = 0; k < _n; ++k)
+		_out(k)			+= RBMKernels::logCoshSum(_theta.colptr(k), this->nHid_) - this->thetaLCS_;
+	return arma::exp(_out);
+}
+#endif
+
+// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!! C H A I N S !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+
+/*
+* @brief Calculates the probability ratio for the chain _c when the flips are provided from the outside (e.g. the Hamiltonian).
+* Uses only the local copy of the angles, therefore, it can be called concurrently for different chains.
+* @param _c index of the chain
+* @param fP flip places to be used
+* @param fV flip values to be used (before the flip)
+* @returns probability ratio for a given ansatz based on the state of the chain
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline _T RBM_S<2, _Ht, _T, _stateType>::pRatioChain(uint _c, std::initializer_list<int> fP, std::initializer_list<double> fV)
+{
+	const size_t nFlips = std::min(fP.size(), fV.size());
+	if (nFlips == 0)
+		return 1.0;
+
+	_T val			= 0;
+	NQSB _theta		= this->thetaChains_.col(_c);
+	auto _fP		= fP.begin();
+	auto _fV		= fV.begin();
+	for (size_t i = 0; i < nFlips; ++i, ++_fP, ++_fV)
+	{
+		const double currVal	= RBM_SPIN_UPD(*_fV);
+		_theta					+= currVal * this->W_.col(*_fP);
+		val						+= currVal * this->bV_(*_fP);
+	}
+	return std::exp(val) * arma::prod(arma::cosh(_theta) / this->thetaChainsCOSH_.col(_c));
+}
+
+////////////////////////////////////////////////////////////////
+
+/*
+* @brief Advances all the chains with single flip proposals. In each step every chain proposes a flip at a random site,
+* the new angles of all the chains are obtained at once from the chosen columns of W and the acceptance is decided for each
+* chain separately. For more flips in a single step (or other proposals) the general per-chain sampler is used.
+* @param _bSize number of Metropolis steps for each chain
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline void RBM_S<2, _Ht, _T, _stateType>::blockSampleChains(uint _bSize)
+{
+	if (this->nFlip_ != 1 || this->proposal_ != NQS_PROP_FLIP)
+		return RBM<2, _Ht, _T, _stateType>::blockSampleChains(_bSize);
+#ifdef NQS_USE_GPU
+	if (this->device_)
+		return this->blockSampleChainsDevice(_bSize);
+#endif
+
+	// weights may have changed since the last call
+	this->setChainsTheta();
+
+	const uint _nC				= this->nChains_;
+	arma::uvec _sites(_nC);
+	arma::Row<double> _dv(_nC);
+	NQSW _thetaNew, _coshNew;
+	arma::Row<_T> _ratio;
+
+	for (uint bStep = 0; bStep < _bSize; ++bStep)
+	{
+		// propose a single flip in each of the chains
+		for (uint c = 0; c < _nC; ++c)
+		{
+			_sites(c)			= this->ran_.template randomInt<uint>(0, this->info_p_.nVis_);
+			_dv(c)				= RBM_SPIN_UPD(this->chains_(_sites(c), c));
+		}
+
+		// new angles - column of W for each chain scaled by the change of the visible variable
+		_thetaNew				= this->W_.cols(_sites);
+		_thetaNew.each_row()	%= arma::conv_to<arma::Row<_T>>::from(_dv);
+		_thetaNew				+= this->thetaChains_;
+		_coshNew				= arma::cosh(_thetaNew);
+		_ratio					= arma::exp(arma::conv_to<arma::Row<_T>>::from(_dv) % this->bV_.elem(_sites).st()) % arma::prod(_coshNew / this->thetaChainsCOSH_, 0);
+
+		// accept or reject for each chain separately
+		for (uint c = 0; c < _nC; ++c)
+		{
+			if (this->ran_.template random<float>() < std::norm(_ratio(c)))
+			{
+				this->chains_(_sites(c), c)		+= _dv(c);
+				this->thetaChains_.col(c)		= _thetaNew.col(c);
+				this->thetaChainsCOSH_.col(c)	= _coshNew.col(c);
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the local energy for the chain _c without touching the current state of the NQS.
+* @param _c index of the chain
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline _T RBM_S<2, _Ht, _T, _stateType>::locEnKernelChain(uint _c)
+{
+	const NQSS _v	= this->chains_.col(_c);
+	_T energy		= 0.0;
+	if (this->useConn_)
+	{
+		thread_local LocEnBuffer _buf;
+		const _T _lcs	= RBMKernels::logCoshSum(this->thetaChains_.colptr(_c), this->nHid_);
+		for (uint site = 0; site < this->info_p_.nSites_; ++site)
+		{
+			this->locEnEmit(_v, site, _buf);
+			energy	+= this->connEnergy(_buf, this->thetaChains_.colptr(_c), _lcs);
+		}
+		return energy;
+	}
+
+	std::function<_T(std::initializer_list<int>, std::initializer_list<double>)> _f = 
+		[this, _c](std::initializer_list<int> fP, std::initializer_list<double> fV) { return this->pRatioChain(_c, fP, fV); };
+
+	for (uint site = 0; site < this->info_p_.nSites_; ++site)
+		energy		+= algebra::cast<_T>(this->H_->locEnergy(_v, site, _f));
+	return energy;
+}
+
+#ifdef NQS_USE_GPU
+/*
+* @brief Advances all the chains on the device - the same single flip Metropolis steps as blockSampleChains, each chain is
+* advanced by its own block of the threads. The proposals and the uniforms are drawn from the host generator in the order
+* of the host sampler, the states and the angles are brought back for the gradients.
+* @param _bSize number of Metropolis steps for each chain
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline void RBM_S<2, _Ht, _T, _stateType>::blockSampleChainsDevice(uint _bSize)
+{
+	static_assert(std::is_same_v<_stateType, double>, "The device chains store the states in the double precision.");
+	const uint _nC				= this->nChains_;
+
+	// weights may have changed since the last call - the angles of the chains are uploaded with them
+	this->setChainsTheta();
+
+	// the weights change once per iteration - uploading them with each block costs O(nHid nVis), much less than the block
+	this->devChains_.setWeights(this->W_.memptr(), this->bV_.memptr(), this->bH_.memptr(), this->info_p_.nVis_, this->nHid_);
+	this->devChains_.setChains(this->chains_.memptr(), this->thetaChains_.memptr(), _nC);
+
+	// the draws follow the host sampler - in each step the sites of all the chains and then their uniforms
+	std::vector<unsigned> _sites((size_t)_bSize * _nC);
+	std::vector<float> _rnd((size_t)_bSize * _nC);
+	for (uint bStep = 0; bStep < _bSize; ++bStep)
+	{
+		for (uint c = 0; c < _nC; ++c)
+			_sites[(size_t)bStep * _nC + c] = this->ran_.template randomInt<uint>(0, this->info_p_.nVis_);
+		for (uint c = 0; c < _nC; ++c)
+			_rnd[(size_t)bStep * _nC + c]	= this->ran_.template random<float>();
+	}
+#ifdef SPIN
+	this->devChains_.sample(_bSize, _sites.data(), _rnd.data(), true);
+#else
+	this->devChains_.sample(_bSize, _sites.data(), _rnd.data(), false);
+#endif
+
+	this->devChains_.getChains(this->chains_.memptr(), this->thetaChains_.memptr());
+	this->thetaChainsCOSH_		= arma::cosh(this->thetaChains_);
+}
+
+////////////////////////////////////////////////////////////////
+
+/*
+* @brief Local energies of the first _n chains with a single batch of the ratios on the device - the connections of all the
+* chains are enumerated on the host and evaluated with the angles kept on the device after the sampling.
+* @param _n number of the chains
+* @param _En output (n)
+* @returns whether the batch was used (otherwise the per-chain kernel is)
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline auto RBM_S<2, _Ht, _T, _stateType>::locEnChainsBatch(uint _n, _T* _En) -> bool
+{
+	// the device angles are current only after the device sampler
+	if (!this->device_ || !this->useConn_ || this->nFlip_ != 1 || this->proposal_ != NQS_PROP_FLIP)
+		return false;
+
+	LocEnBuffer _buf;
+	std::vector<int> _chain, _fP;
+	std::vector<double> _d;
+	std::vector<cpx> _coef;
+	std::vector<cpx> _diag(_n, 0.0);
+	for (uint c = 0; c < _n; ++c)
+	{
+		const NQSS _v	= this->chains_.col(c);
+		for (uint site = 0; site < this->info_p_.nSites_; ++site)
+		{
+			this->H_->locEnergyConn(_v, site, _buf);
+			_diag[c]	+= _buf.diag();
+			for (size_t k = 0; k < _buf.size(); ++k)
+			{
+				const auto& _c	= _buf[k];
+				_chain.push_back((int)c);
+				_coef.push_back(_c.c_);
+				for (uint f = 0; f < LOCEN_MAX_FLIPS; ++f)
+				{
+					_fP.push_back(f < _c.n_ ? _c.fP_[f] : -1);
+					_d.push_back(f < _c.n_ ? RBM_SPIN_UPD(_c.fV_[f]) : 0.0);
+				}
+			}
+		}
+	}
+
+	std::vector<_T> _ratios(_chain.size());
+	this->devChains_.ratios(_chain.data(), _fP.data(), _d.data(), _chain.size(), LOCEN_MAX_FLIPS, _ratios.data());
+	for (uint c = 0; c < _n; ++c)
+		_En[c]			= algebra::cast<_T>(_diag[c]);
+	for (size_t k = 0; k < _chain.size(); ++k)
+		_En[_chain[k]]	+= algebra::cast<_T>(_coef[k] * cpx(_ratios[k]));
+	return true;
+}
+#endif
+
+// !!!!!!!!!!!!!!!!!!!!!!!!!!!! C O N N E C T I O N S !!!!!!!!!!!!!!!!!!!!!!!!!!!!
+
+/*
+* @brief Calculates the probability ratio for a single connection emitted by the Hamiltonian. It is a single fused pass
+* over the hidden units in the log-space - no temporary vectors are created, therefore, it is safe to call it concurrently.
+* @param _c connection (one or two flips)
+* @param _theta angles of the state (nHid)
+* @param _lcs \sum _h log cosh(theta_h) of the state
+* @returns probability ratio for the connected state
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline _T RBM_S<2, _Ht, _T, _stateType>::connRatio(const LocEnConn& _c, const _T* _theta, _T _lcs) const
+{
+	const _T* _w[LOCEN_MAX_FLIPS];
+	double _d[LOCEN_MAX_FLIPS];
+	_T _val				= 0.0;
+	for (uint f = 0; f < _c.n_; ++f)
+	{
+		_w[f]			= this->W_.colptr(_c.fP_[f]);
+		_d[f]			= RBM_SPIN_UPD(_c.fV_[f]);
+		_val			+= _d[f] * this->bV_(_c.fP_[f]);
+	}
+	return std::exp(_val + RBMKernels::logCoshShift(_theta, _w, _d, _c.n_, this->nHid_) - _lcs);
+}
+
+////////////////////////////////////////////////////////////////
+
+/*
+* @brief Calculates the local energy contribution of a single site from the connections emitted by the Hamiltonian.
+* @param _buf connections of the site
+* @param _theta angles of the state (nHid)
+* @param _lcs \sum _h log cosh(theta_h) of the state
+*/
+template<typename _Ht, typename _T, class _stateType>
+inline _T RBM_S<2, _Ht, _T, _stateType>::connEnergy(const LocEnBuffer& _buf, const _T* _theta, _T _lcs) const
+{
+	return algebra::cast<_T>(_buf.evaluate([&](const LocEnConn& _c) -> cpx { return this->connRatio(_c, _theta, _lcs); }));
+}
+
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
 #endif
\ No newline at end of file
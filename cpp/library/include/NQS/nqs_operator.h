@@ -9,8 +9,12 @@
 
 // #################################
 #include "./NQS_base/nqs_definitions_base.h"
+#include "./NQS_base/nqs_config.h"
+#include "../quantities/profiler.h"
 #include <initializer_list>
+#include <unordered_map>
 #include <utility>
+#include <mutex>
 #ifndef HAMIL_H
 #	include "../hamil.h"
 #endif
@@ -183,6 +187,7 @@ namespace NQSAv
 	protected:
 		std::string dir_	= "";
 		uint threads_		= 1;
+		NQS_Executor* exec_	= nullptr;							// workers of the NQS used for the local and correlation operators (not owned)
 
 		// lattice (if needed)
 		std::shared_ptr<Lattice> lat_;
@@ -194,6 +199,10 @@ namespace NQSAv
 		OPL opL_;
 		// correlation operators
 		OPC opC_;
+		// Pauli strings - estimated in batch from their masks (see Operators::Fused::estimators)
+		v_1d<Operators::Fused::PauliMask> opP_;
+		strVec opPN_;
+		v_1d<v_1d<size_t>> opPG_;								// strings grouped by the X mask (one probability ratio per group)
 
 		// -----------------------------------------------------------------------------
 
@@ -201,6 +210,7 @@ namespace NQSAv
 		std::vector<Operators::Containers::OperatorContainer<_T>> containersG_;
 		std::vector<Operators::Containers::OperatorContainer<_T>> containersL_;
 		std::vector<Operators::Containers::OperatorContainer<_T>> containersC_;	
+		Operators::Containers::OperatorContainer<_T> containerP_;						// all the Pauli strings in a single column
 
 		// -----------------------------------------------------------------------------
 
@@ -226,7 +236,12 @@ namespace NQSAv
 			this->opC_ = _m.opC_;
 			this->opG_ = _m.opG_;
 			this->opL_ = _m.opL_;
+			this->opP_ = _m.opP_;
+			this->opPN_ = _m.opPN_;
+			this->opPG_ = _m.opPG_;
+			this->containerP_ = _m.containerP_;
 			this->threads_ = _m.threads_;
+			this->exec_ = _m.exec_;
 		}
 		MeasurementNQS(MeasurementNQS&& _m)
 		{
@@ -239,7 +254,12 @@ namespace NQSAv
 			this->opC_ = std::move(_m.opC_);
 			this->opG_ = std::move(_m.opG_);
 			this->opL_ = std::move(_m.opL_);
+			this->opP_ = std::move(_m.opP_);
+			this->opPN_ = std::move(_m.opPN_);
+			this->opPG_ = std::move(_m.opPG_);
+			this->containerP_ = std::move(_m.containerP_);
 			this->threads_ = std::move(_m.threads_);
+			this->exec_ = _m.exec_;
 		}
 
 		// copy and move operators
@@ -254,7 +274,12 @@ namespace NQSAv
 			this->opC_ = _m.opC_;
 			this->opG_ = _m.opG_;
 			this->opL_ = _m.opL_;
+			this->opP_ = _m.opP_;
+			this->opPN_ = _m.opPN_;
+			this->opPG_ = _m.opPG_;
+			this->containerP_ = _m.containerP_;
 			this->threads_ = _m.threads_;
+			this->exec_ = _m.exec_;
 			return *this;
 		}
 
@@ -269,7 +294,12 @@ namespace NQSAv
 			this->opC_ = std::move(_m.opC_);
 			this->opG_ = std::move(_m.opG_);
 			this->opL_ = std::move(_m.opL_);
+			this->opP_ = std::move(_m.opP_);
+			this->opPN_ = std::move(_m.opPN_);
+			this->opPG_ = std::move(_m.opPG_);
+			this->containerP_ = std::move(_m.containerP_);
 			this->threads_ = std::move(_m.threads_);
+			this->exec_ = _m.exec_;
 			return *this;
 		}
 
@@ -299,8 +329,11 @@ namespace NQSAv
 
 		void measure(u64 s, NQSFunCol _fun);
 		void measure(Operators::_OP_V_T_CR, NQSFunCol _fun);
+		void measureParallel(Operators::_OP_V_T_CR, NQSFunCol _fun);
+		void measureShared(Operators::_OP_V_T_CR, NQSFunCol _fun);
 		void measure(const arma::Col<_T>& state, const Hilbert::HilbertSpace<_T>&);
 		void normalize(uint _nBlck);
+		void reduceRanks();
 		void save(const strVec& _ext = { ".h5" });
 
 		// ---- MEASUREMENT ---- (STATIC)
@@ -339,6 +372,7 @@ namespace NQSAv
 		auto getOpG()				const		->		const OPG& { return this->opG_; };
 		auto getOpL()				const		->		const OPL& { return this->opL_; };
 		auto getOpC()				const		->		const OPC& { return this->opC_; };
+		auto getOpP()				const		->		const v_1d<Operators::Fused::PauliMask>& { return this->opP_; };
 		auto getDir()				const		->		const std::string& { return this->dir_; };
 
 		// values from the containers
@@ -347,11 +381,13 @@ namespace NQSAv
 		// ---- SETTERS ----
 		void setDir(const std::string& _dir)			{ this->dir_ = _dir; };
 		void setThreads(uint _threads)					{ this->threads_ = _threads; };
+		void setExecutor(NQS_Executor* _exec)			{ this->exec_ = _exec; };
 		void setLat(std::shared_ptr<Lattice> _lat) 		{ this->lat_ = _lat; this->Ns_ = _lat->get_Ns(); };
 		void setLat(size_t _Ns) 						{ this->Ns_ = _Ns; this->lat_ = nullptr; };
 		void setOP_G(const OPG& _opG)					{ this->opG_ = _opG; };
 		void setOP_L(const OPL& _opL)					{ this->opL_ = _opL; };
 		void setOP_C(const OPC& _opC)					{ this->opC_ = _opC; };
+		void setOP_P(const v_1d<Operators::Fused::PauliMask>& _opP, const strVec& _names = {});
 
 		void resetContainers();
 		void reset();
@@ -391,6 +427,9 @@ namespace NQSAv
 		this->opG_.clear();
 		this->opL_.clear();
 		this->opC_.clear();
+		this->opP_.clear();
+		this->opPN_.clear();
+		this->opPG_.clear();
 		this->resetContainers();
 	}
 	
@@ -433,6 +472,27 @@ namespace NQSAv
 			// add to the list
 			this->containersC_.push_back(_cont);
 		}
+
+		// Pauli strings - the column of all the strings
+		this->containerP_ = Operators::Containers::OperatorContainer<_T>(std::max<size_t>(1, this->opP_.size()));
+		this->containerP_.template decideSize<uint>();
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+
+	/*
+	* @brief Sets the Pauli strings to be estimated - they are grouped by the X mask, so that the probability ratio is
+	* evaluated once per group (the diagonal strings, like all the sigma_z correlators, need none)
+	* @param _opP the strings (see Operators::Fused::mask and Operators::Fused::correlationStrings)
+	* @param _names names of the strings (optional)
+	*/
+	template <typename _T>
+	inline void NQSAv::MeasurementNQS<_T>::setOP_P(const v_1d<Operators::Fused::PauliMask>& _opP, const strVec& _names)
+	{
+		this->opP_	= _opP;
+		this->opPN_	= _names;
+		this->opPG_	= Operators::Fused::groups(_opP);
+		this->createContainers();
 	}
 
 	////////////////////////////////////////////////////////////////////////////
@@ -502,6 +562,20 @@ namespace NQSAv
 		}
 		END_CATCH_HANDLER("Problem in the measurement of global operators.", ;);
 
+		BEGIN_CATCH_HANDLER
+		{
+			// measure the Pauli strings
+			if (!this->opP_.empty())
+			{
+				NQSS _v(this->Ns_);
+				INT_TO_BASE(s, _v, Operators::_SPIN_RBM);
+				const arma::Col<_T> _vals = Operators::Fused::estimators<_T>(_v, this->Ns_, this->opP_, this->opPG_, _fun);
+				for (uint i = 0; i < _vals.n_elem; ++i)
+					this->containerP_.updCurrent(_vals(i), i);
+			}
+		}
+		END_CATCH_HANDLER("Problem in the measurement of Pauli strings.", ;);
+
 		BEGIN_CATCH_HANDLER
 		{
 			// measure local
@@ -557,6 +631,22 @@ namespace NQSAv
 		}
 		END_CATCH_HANDLER("Problem in the measurement of global operators.", ;);
 
+		BEGIN_CATCH_HANDLER
+		{
+			// measure the Pauli strings
+			if (!this->opP_.empty())
+			{
+				const arma::Col<_T> _vals = Operators::Fused::estimators<_T>(s, this->Ns_, this->opP_, this->opPG_, _fun);
+				for (uint i = 0; i < _vals.n_elem; ++i)
+					this->containerP_.updCurrent(_vals(i), i);
+			}
+		}
+		END_CATCH_HANDLER("Problem in the measurement of Pauli strings.", ;);
+
+		// with the executor the values are computed in parallel and the containers are updated afterwards (they are not thread-safe)
+		if (this->exec_ != nullptr && this->exec_->size() > 1)
+			return this->measureParallel(s, _fun);
+
 		BEGIN_CATCH_HANDLER
 		{
 			// measure local
@@ -596,6 +686,83 @@ namespace NQSAv
 
 	////////////////////////////////////////////////////////////////////////////
 
+	/*
+	* @brief Measures the local and correlation operators on the workers of the executor. Each task evaluates a single site
+	* (a row of the correlation matrix) into the buffer and the containers are updated serially afterwards.
+	* @param s state to measure the operators for
+	* @param _fun probability ratio function (must be thread-safe)
+	*/
+	template<typename _T>
+	inline void MeasurementNQS<_T>::measureParallel(Operators::_OP_V_T_CR s, NQSFunCol _fun)
+	{
+		BEGIN_CATCH_HANDLER
+		{
+			// measure local
+			arma::Col<_T> _vals(this->Ns_);
+			for (int i = 0; i < this->opL_.size(); ++i)
+			{
+				auto& _op 	= this->opL_[i];
+				this->exec_->run(this->Ns_, [&](unsigned j, unsigned) { _vals(j) = algebra::cast<_T>(_op->operator()(s, _fun, j)); });
+				for (auto j = 0; j < this->Ns_; ++j)
+					this->containersL_[i].updCurrent(_vals(j), j);
+			}
+		}
+		END_CATCH_HANDLER("Problem in the measurement of local operators.", ;);
+
+		BEGIN_CATCH_HANDLER
+		{
+			// measure correlation
+			arma::Mat<_T> _vals(this->Ns_, this->Ns_);
+			for (int k = 0; k < this->opC_.size(); ++k)
+			{
+				auto& _op = this->opC_[k];
+				this->exec_->run(this->Ns_, [&](unsigned i, unsigned) 
+					{
+						for (auto j = 0; j < this->Ns_; ++j)
+							_vals(i, j) = algebra::cast<_T>(_op->operator()(s, _fun, i, j));
+					});
+				for (auto i = 0; i < this->Ns_; ++i)
+					for (auto j = 0; j < this->Ns_; ++j)
+						this->containersC_[k].updCurrent(_vals(i, j), i, j);
+			}
+		}
+		END_CATCH_HANDLER("Problem in the measurement of correlation operators.", ;);
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+
+	/*
+	* @brief Measures all the operators at the state in a single pass, in which the probability ratio of each connected
+	* configuration is evaluated once - the global, local and correlation operators often reach the same configurations
+	* (e.g. sigma_x^i in the local and the correlation operators). For the buffered samples of the training.
+	* @param s state to measure the operators for
+	* @param _fun probability ratio function
+	*/
+	template<typename _T>
+	inline void MeasurementNQS<_T>::measureShared(Operators::_OP_V_T_CR s, NQSFunCol _fun)
+	{
+		std::unordered_map<NQSConfig, cpx> _ratios;
+		std::mutex _mutex;														// the local and correlation operators may run on the executor
+		_ratios.reserve(2 * ((size_t)this->Ns_ * this->Ns_ + 1));
+		NQSFunCol _shared = [&](const NQSS& _v) -> cpx
+			{
+				const NQSConfig _key(_v);
+				{
+					std::lock_guard<std::mutex> _lock(_mutex);
+					auto _it = _ratios.find(_key);
+					if (_it != _ratios.end())
+						return _it->second;
+				}
+				const cpx _val = _fun(_v);
+				std::lock_guard<std::mutex> _lock(_mutex);
+				_ratios.emplace(_key, _val);
+				return _val;
+			};
+		this->measure(s, _shared);
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+
 	/*
 	* @brief Measure the operators for the given state - uses the operator representation acting on 
 	* the state in a full Hilbert space. Therefore, one needs to provide the Hilbert space and the state.
@@ -624,6 +791,19 @@ namespace NQSAv
 		}
 		END_CATCH_HANDLER("Problem in the measurement of global operators.", ;);
 
+		BEGIN_CATCH_HANDLER
+		{
+			// measure the Pauli strings - streaming passes over the state (the index is the basis state only without the symmetries)
+			if (!this->opP_.empty() && _H.getHilbertSize() == _H.getFullHilbertSize())
+			{
+				this->containerP_.resetMB();
+				const arma::Col<_T> _vals = Operators::Fused::expectation<_T>(_state, this->opP_);
+				for (uint i = 0; i < _vals.n_elem; ++i)
+					this->containerP_.setManyBodyVal(_vals(i), i);
+			}
+		}
+		END_CATCH_HANDLER("Problem in the measurement of Pauli strings.", ;);
+
 		BEGIN_CATCH_HANDLER
 		{
 			// measure local
@@ -708,15 +888,48 @@ namespace NQSAv
 			// measure correlation
 			for (auto& _cont : this->containersC_)
 				_cont.normalize(_nsamples);
+			if (!this->opP_.empty())
+				this->containerP_.normalize(_nsamples);
 		}
 		END_CATCH_HANDLER("Problem in the normalization of correlation operators.", ;);
 	}
 
 	////////////////////////////////////////////////////////////////////////////
 
+	/*
+	* @brief Averages the blocks of the measurements over the ranks of the distributed NQS - each rank has the same number of the
+	* blocks of the same size, so the block means of all the chains are the averages of the blocks of the ranks (collective)
+	*/
+	template<typename _T>
+	inline void NQSAv::MeasurementNQS<_T>::reduceRanks()
+	{
+		if (!NQS_MPI::distributed())
+			return;
+		const double _n = (double)NQS_MPI::size();
+		auto _reduce = [_n](Operators::Containers::OperatorContainer<_T>& _cont)
+			{
+				for (auto& _s : _cont.samples_)
+				{
+					NQS_MPI::sumInPlace(_s);
+					_s /= _n;
+				}
+			};
+		for (auto& _cont : this->containersG_)
+			_reduce(_cont);
+		for (auto& _cont : this->containersL_)
+			_reduce(_cont);
+		for (auto& _cont : this->containersC_)
+			_reduce(_cont);
+		if (!this->opP_.empty())
+			_reduce(this->containerP_);
+	}
+
+	////////////////////////////////////////////////////////////////////////////
+
 	template<typename _T>
 	inline void NQSAv::MeasurementNQS<_T>::save(const strVec& _ext)
 	{
+		PROF_SCOPE(H5_WRITE);
 		BEGIN_CATCH_HANDLER
 		{
 			// save global
@@ -797,6 +1010,22 @@ namespace NQSAv
 			}
 		}
 		END_CATCH_HANDLER("Problem in the measurement of correlation operators.", ;);
+
+		BEGIN_CATCH_HANDLER
+		{
+			// save the Pauli strings - a single column in the order of opP_
+			if (!this->opP_.empty())
+			{
+				auto M = this->containerP_.template mean<cpx>();
+				for (const auto& ext : _ext)
+					saveAlgebraic(dir_, "NQS_OP_P" + ext, M, "pauli");
+				const arma::Mat<_T>& Mb = this->containerP_.mbval();
+				if (Mb.size() != 0)
+					for (const auto& ext : _ext)
+						saveAlgebraic(dir_, "ED_OP_P" + ext, Mb, "pauli");
+			}
+		}
+		END_CATCH_HANDLER("Problem in the measurement of Pauli strings.", ;);
 	}
 
 	////////////////////////////////////////////////////////////////////////////
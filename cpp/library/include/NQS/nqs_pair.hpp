@@ -0,0 +1,80 @@
+#pragma once
+/***********************************
+* Defines the statically dispatched
+* pairs of the Hamiltonian and the NQS
+* ansatz. The pair knows the concrete
+* type of the model, so that the
+* connections of the local energy are
+* emitted and contracted with the ratios
+* of the ansatz without the virtual
+* calls - both are inlined into a single
+* loop for each site. The general path
+* of the NQS (virtual Hamiltonian) stays
+* for all the other combinations.
+***********************************/
+
+#ifndef NQS_PAIR_H
+#define NQS_PAIR_H
+
+#include <memory>
+#include <stdexcept>
+
+/*
+* @brief NQS ansatz with the type of the Hamiltonian fixed at compile time.
+* @tparam _Ansatz architecture of the NQS (e.g. RBM_S, RBM_PP_S)
+* @tparam _Model model emitting the connections (e.g. XYZ, IsingModel, HeisenbergKitaev)
+*/
+template <template <uint, typename, typename, class> class _Ansatz,
+		template <typename> class _Model,
+		uint _spinModes,
+		typename _Ht,
+		typename _T			= _Ht,
+		class _stateType	= double>
+class NQS_Pair final : public _Ansatz<_spinModes, _Ht, _T, _stateType>
+{
+	NQS_PUBLIC_TYPES(_T, _stateType);
+	using _Net		= _Ansatz<_spinModes, _Ht, _T, _stateType>;
+	using _Ham		= _Model<_Ht>;
+	using NQSLS_p	= typename _Net::NQSLS_p;
+
+protected:
+	_Ham* model_	= nullptr;													// concrete model (owned by H_)
+
+public:
+	NQS_Pair(std::shared_ptr<Hamiltonian<_Ht>>& _H, uint _nHid, double _lr,
+		uint _threadNum = 1, int _nParticles = -1, const NQSLS_p& _lower = {}, const std::vector<double>& _beta = {})
+		: _Net(_H, _nHid, _lr, _threadNum, _nParticles, _lower, _beta)
+	{
+		this->model_ = dynamic_cast<_Ham*>(this->H_.get());
+		if (!this->model_ || !this->useConn_)
+			throw std::invalid_argument("The model of the NQS pair does not match the Hamiltonian or does not emit the connections!");
+	};
+
+	/* ------------------------------------------------------------ */
+protected:
+	/*
+	* @brief Connections of the site _site for the state _v - direct call of the model
+	*/
+	void locEnEmit(const NQSS& _v, uint _site, LocEnBuffer& _buf)	override final
+	{
+		this->model_->_Ham::locEnergyConn(_v, _site, _buf);
+	}
+
+	/*
+	* @brief Local energy of the site _site of the current state - the connections and the ratios of the ansatz are both
+	* resolved at compile time (the angles of the RBM are used directly whenever the ansatz provides it).
+	*/
+	auto locEnSite(uint _site, LocEnBuffer& _buf)	-> _T			override final
+	{
+		this->model_->_Ham::locEnergyConn(NQS_STATE, _site, _buf);
+		if constexpr (_Net::connInline)
+			return this->_Net::locEnConn(_buf);
+		else
+			return algebra::cast<_T>(_buf.evaluate([this](const LocEnConn& _c) -> cpx
+				{
+					return (_c.n_ == 1) ? this->_Net::pRatio({ _c.fP_[0] }, { _c.fV_[0] }) : this->_Net::pRatio({ _c.fP_[0], _c.fP_[1] }, { _c.fV_[0], _c.fV_[1] });
+				}));
+	}
+};
+
+#endif // !NQS_PAIR_H
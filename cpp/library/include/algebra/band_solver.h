@@ -0,0 +1,116 @@
+#pragma once
+/***********************************
+* Defines the eigensolver of the
+* Hermitian band matrices stored in
+* the LAPACK band format (upper, ldab =
+* kd + 1). The band is reduced to the
+* tridiagonal form directly (dsbevd /
+* zhbevd), so that the dense matrix is
+* never formed.
+***********************************/
+
+#ifndef BAND_SOLVER_H
+#define BAND_SOLVER_H
+
+#include <complex>
+#include <stdexcept>
+#include <type_traits>
+
+extern "C"
+{
+	void dsbevd_(const char* jobz, const char* uplo, const arma::blas_int* n, const arma::blas_int* kd, double* ab, const arma::blas_int* ldab,
+				 double* w, double* z, const arma::blas_int* ldz, double* work, const arma::blas_int* lwork, arma::blas_int* iwork,
+				 const arma::blas_int* liwork, arma::blas_int* info);
+	void zhbevd_(const char* jobz, const char* uplo, const arma::blas_int* n, const arma::blas_int* kd, std::complex<double>* ab, const arma::blas_int* ldab,
+				 double* w, std::complex<double>* z, const arma::blas_int* ldz, std::complex<double>* work, const arma::blas_int* lwork, double* rwork,
+				 const arma::blas_int* lrwork, arma::blas_int* iwork, const arma::blas_int* liwork, arma::blas_int* info);
+};
+
+namespace BandSolver
+{
+	/*
+	* @brief Element (i, j), i <= j <= i + kd, of the upper band storage: AB(kd + i - j, j) = A(i, j)
+	*/
+	template <typename _T>
+	inline _T& at(arma::Mat<_T>& _AB, u64 _kd, u64 i, u64 j)										{ return _AB(_kd + i - j, j);	};
+
+	/*
+	* @brief Densifies the band matrix (for the checks of the small systems)
+	*/
+	template <typename _T>
+	inline arma::Mat<_T> dense(const arma::Mat<_T>& _AB, u64 _kd)
+	{
+		const u64 _n = _AB.n_cols;
+		arma::Mat<_T> _M(_n, _n, arma::fill::zeros);
+		for (u64 j = 0; j < _n; ++j)
+			for (u64 i = (j > _kd ? j - _kd : 0); i <= j; ++i)
+			{
+				_M(i, j) = _AB(_kd + i - j, j);
+				_M(j, i) = algebra::conjugate(_M(i, j));
+			}
+		return _M;
+	}
+
+	/*
+	* @brief Full spectrum of the Hermitian band matrix (divide and conquer on the reduced tridiagonal matrix)
+	* @param _AB upper band storage (kd + 1) x n - destroyed on exit
+	* @param _kd number of the superdiagonals
+	* @param _vals eigenvalues in the ascending order
+	* @param _vecs eigenvectors (nullptr - not computed)
+	*/
+	template <typename _T>
+	inline void eig(arma::Mat<_T>& _AB, u64 _kd, arma::vec& _vals, arma::Mat<_T>* _vecs = nullptr)
+	{
+		const arma::blas_int _n		= (arma::blas_int)_AB.n_cols;
+		const arma::blas_int _k		= (arma::blas_int)_kd;
+		const arma::blas_int _ldab	= (arma::blas_int)_AB.n_rows;
+		const char _jobz			= _vecs ? 'V' : 'N';
+		const char _uplo			= 'U';
+		if (_AB.n_rows != _kd + 1)
+			throw std::invalid_argument("BandSolver: wrong leading dimension of the band, " + VEQ(_AB.n_rows) + "," + VEQ(_kd));
+
+		_vals.set_size(_n);
+		arma::Mat<_T> _Z;
+		if (_vecs)
+			_Z.set_size(_n, _n);
+		else
+			_Z.set_size(1, 1);
+		const arma::blas_int _ldz	= (arma::blas_int)_Z.n_rows;
+
+		// workspace query
+		arma::blas_int _info		= 0;
+		arma::blas_int _lwork		= -1;
+		arma::blas_int _liwork		= -1;
+		arma::blas_int _iworkQ		= 0;
+		if constexpr (std::is_same_v<_T, double>)
+		{
+			double _workQ			= 0.0;
+			dsbevd_(&_jobz, &_uplo, &_n, &_k, _AB.memptr(), &_ldab, _vals.memptr(), _Z.memptr(), &_ldz, &_workQ, &_lwork, &_iworkQ, &_liwork, &_info);
+			_lwork					= (arma::blas_int)_workQ;
+			_liwork					= _iworkQ;
+			arma::vec _work(std::max<arma::blas_int>(_lwork, 1));
+			arma::Col<arma::blas_int> _iwork(std::max<arma::blas_int>(_liwork, 1));
+			dsbevd_(&_jobz, &_uplo, &_n, &_k, _AB.memptr(), &_ldab, _vals.memptr(), _Z.memptr(), &_ldz, _work.memptr(), &_lwork, _iwork.memptr(), &_liwork, &_info);
+		}
+		else
+		{
+			std::complex<double> _workQ = 0.0;
+			double _rworkQ			= 0.0;
+			arma::blas_int _lrwork	= -1;
+			zhbevd_(&_jobz, &_uplo, &_n, &_k, _AB.memptr(), &_ldab, _vals.memptr(), _Z.memptr(), &_ldz, &_workQ, &_lwork, &_rworkQ, &_lrwork, &_iworkQ, &_liwork, &_info);
+			_lwork					= (arma::blas_int)std::real(_workQ);
+			_lrwork					= (arma::blas_int)_rworkQ;
+			_liwork					= _iworkQ;
+			arma::cx_vec _work(std::max<arma::blas_int>(_lwork, 1));
+			arma::vec _rwork(std::max<arma::blas_int>(_lrwork, 1));
+			arma::Col<arma::blas_int> _iwork(std::max<arma::blas_int>(_liwork, 1));
+			zhbevd_(&_jobz, &_uplo, &_n, &_k, _AB.memptr(), &_ldab, _vals.memptr(), _Z.memptr(), &_ldz, _work.memptr(), &_lwork, _rwork.memptr(), &_lrwork, _iwork.memptr(), &_liwork, &_info);
+		}
+		if (_info != 0)
+			throw std::runtime_error("BandSolver: the band eigensolver failed, " + VEQ(_info));
+		if (_vecs)
+			*_vecs = std::move(_Z);
+	}
+};
+
+#endif // !BAND_SOLVER_H
@@ -0,0 +1,155 @@
+#pragma once
+/***********************************
+* Defines the precompiled tables of the
+* couplings of the lattice models. The
+* lattice neighbors and the disordered
+* parameters are fetched once, the local
+* energy kernels iterate the flat arrays
+* (struct of arrays, grouped by the
+* first site of the bond).
+***********************************/
+
+#ifndef BOND_TABLE_H
+#define BOND_TABLE_H
+
+#include <bit>
+#include <vector>
+#include <cstdint>
+
+constexpr double BONDS_SPIN				= 0.5;										// eigenvalue of S^z on the set bit (as Operators::_SPIN)
+
+namespace Bonds
+{
+	/*
+	* @brief Couplings of a single bond (i, j): Jz S^z_i S^z_j + Jx S^x_i S^x_j + Jy S^y_i S^y_j
+	*/
+	struct Coupling
+	{
+		double Jz							= 0.0;
+		double Jx							= 0.0;
+		double Jy							= 0.0;
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Table of the bonds and the on-site fields. The bonds of the site i are [start(i), start(i + 1)), for each of them
+	* the second site, its bitmask in the integer representation of the state and the couplings are stored in separate arrays.
+	* The bitmasks follow the convention of the u64 kernels (the site i is the bit Ns - i - 1).
+	*/
+	class Table
+	{
+	protected:
+		uint Ns_							= 0;
+		v_1d<uint> start_;																	// Ns + 1 offsets of the bonds of each site
+		v_1d<u64> siteMask_;																// bitmask of each site
+		v_1d<double> hz_, hx_;																// on-site fields
+
+		// bonds
+		v_1d<uint> j_;																		// second site
+		v_1d<u64> mask_;																	// bitmask of the second site
+		v_1d<u64> pair_;																	// bitmask of both sites (for the popcount parity)
+		v_1d<double> Jz_, Jx_, Jy_;															// couplings
+
+	public:
+		Table()								= default;
+
+		auto Ns()							const -> uint									{ return this->Ns_;									};
+		auto size()							const -> u64									{ return this->j_.size();							};
+		auto empty()						const -> bool									{ return this->start_.empty();						};
+		auto begin(uint i)					const -> uint									{ return this->start_[i];							};
+		auto end(uint i)					const -> uint									{ return this->start_[i + 1];						};
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		auto siteMask(uint i)				const -> u64									{ return this->siteMask_[i];						};
+		auto hz(uint i)						const -> double									{ return this->hz_[i];								};
+		auto hx(uint i)						const -> double									{ return this->hx_[i];								};
+		auto j(uint b)						const -> uint									{ return this->j_[b];								};
+		auto mask(uint b)					const -> u64									{ return this->mask_[b];							};
+		auto pair(uint b)					const -> u64									{ return this->pair_[b];							};
+		auto Jz(uint b)						const -> double									{ return this->Jz_[b];								};
+		auto Jx(uint b)						const -> double									{ return this->Jx_[b];								};
+		auto Jy(uint b)						const -> double									{ return this->Jy_[b];								};
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		/*
+		* @brief Compiles the table from the lattice
+		* @param _lat lattice (the forward neighbors are used)
+		* @param _Ns number of the sites
+		* @param _nnn use the next nearest neighbors instead of the nearest ones
+		* @param _fields function (site) -> (hz, hx)
+		* @param _bond function (site, neighbor, neighbor number) -> Coupling
+		*/
+		template <typename _L, typename _FF, typename _FB>
+		void compile(const _L& _lat, uint _Ns, bool _nnn, _FF&& _fields, _FB&& _bond)
+		{
+			this->Ns_						= _Ns;
+			this->start_.assign(_Ns + 1, 0);
+			this->siteMask_.resize(_Ns);
+			this->hz_.resize(_Ns);
+			this->hx_.resize(_Ns);
+			this->j_.clear(); this->mask_.clear(); this->pair_.clear();
+			this->Jz_.clear(); this->Jx_.clear(); this->Jy_.clear();
+
+			for (uint i = 0; i < _Ns; ++i)
+			{
+				this->start_[i]				= (uint)this->j_.size();
+				this->siteMask_[i]			= ULLPOW(_Ns - i - 1);
+				std::tie(this->hz_[i], this->hx_[i]) = _fields(i);
+
+				const uint _num				= _nnn ? (uint)_lat->get_nnn_ForwardNum(i) : (uint)_lat->get_nn_ForwardNum(i);
+				for (uint n = 0; n < _num; ++n)
+				{
+					const uint N_NUMBER		= _nnn ? (uint)_lat->get_nnn_ForwardNum(i, n) : (uint)_lat->get_nn_ForwardNum(i, n);
+					const int nei			= _nnn ? _lat->get_nnn(i, N_NUMBER) : _lat->get_nn(i, N_NUMBER);
+					if (nei < 0)
+						continue;
+					const Coupling _c		= _bond(i, (uint)nei, N_NUMBER);
+					this->j_.push_back((uint)nei);
+					this->mask_.push_back(ULLPOW(_Ns - nei - 1));
+					this->pair_.push_back(this->mask_.back() | this->siteMask_[i]);
+					this->Jz_.push_back(_c.Jz);
+					this->Jx_.push_back(_c.Jx);
+					this->Jy_.push_back(_c.Jy);
+				}
+			}
+			this->start_[_Ns]				= (uint)this->j_.size();
+		}
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		/*
+		* @brief Diagonal part of the table for the state in the integer representation: sum_i hz_i S^z_i + sum_b Jz_b S^z_i S^z_j.
+		* The bond term only depends on the parity of popcount(s & pair) - branchless loops over the flat arrays.
+		* @param _s state
+		* @param _fields include the on-site fields
+		*/
+		auto diagonal(u64 _s, bool _fields = true) const -> double
+		{
+			double _e						= 0.0;
+			if (_fields)
+				for (uint i = 0; i < this->Ns_; ++i)
+					_e						+= this->hz_[i] * (((_s & this->siteMask_[i]) != 0) ? BONDS_SPIN : -BONDS_SPIN);
+			const u64 _n					= this->j_.size();
+			for (u64 b = 0; b < _n; ++b)
+				_e							+= this->Jz_[b] * ((std::popcount(_s & this->pair_[b]) & 1) ? -BONDS_SPIN * BONDS_SPIN : BONDS_SPIN * BONDS_SPIN);
+			return _e;
+		}
+
+		/*
+		* @brief Integer representation of the vector state (the value at the site > 0 - the set bit)
+		*/
+		auto state(const arma::Col<double>& _v) const -> u64
+		{
+			u64 _s							= 0;
+			for (uint i = 0; i < this->Ns_; ++i)
+				if (_v(i) > 0)
+					_s						|= this->siteMask_[i];
+			return _s;
+		}
+	};
+};
+
+#endif // !BOND_TABLE_H
@@ -0,0 +1,430 @@
+#pragma once
+/***********************************
+* Defines the distributed dense
+* eigensolver of the Hamiltonian
+* (ScaLAPACK or ELPA, set by the options
+* HAMIL_USE_SCALAPACK, HAMIL_USE_ELPA of
+* CMake). The matrix is assembled in the
+* 2D block-cyclic layout directly from
+* the built Hamiltonian (each rank keeps
+* only its own blocks), the eigenvectors
+* stay distributed and the quantities of
+* the states are reduced over the blocks.
+* Without the option only the interface
+* of a single rank is defined.
+***********************************/
+
+#ifndef DIST_EIGENSOLVER_H
+#define DIST_EIGENSOLVER_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <complex>
+#include <stdexcept>
+#include <type_traits>
+#include "armadillo"
+
+#ifdef HAMIL_USE_SCALAPACK
+#	include <mpi.h>
+#	ifdef HAMIL_USE_ELPA
+#		include <elpa/elpa.h>
+#	endif
+
+extern "C"
+{
+	void Cblacs_pinfo(int* _me, int* _np);
+	void Cblacs_get(int _ctx, int _what, int* _val);
+	void Cblacs_gridinit(int* _ctx, const char* _order, int _nprow, int _npcol);
+	void Cblacs_gridinfo(int _ctx, int* _nprow, int* _npcol, int* _myrow, int* _mycol);
+	void Cblacs_gridexit(int _ctx);
+	int numroc_(const int* _n, const int* _nb, const int* _iproc, const int* _isrc, const int* _nprocs);
+	void descinit_(int* _desc, const int* _m, const int* _n, const int* _mb, const int* _nb, const int* _irsrc, const int* _icsrc,
+					const int* _ctx, const int* _lld, int* _info);
+	void pdsyevd_(const char* _jobz, const char* _uplo, const int* _n, double* _a, const int* _ia, const int* _ja, const int* _desca,
+					double* _w, double* _z, const int* _iz, const int* _jz, const int* _descz, double* _work, const int* _lwork,
+					int* _iwork, const int* _liwork, int* _info);
+	void pzheevd_(const char* _jobz, const char* _uplo, const int* _n, std::complex<double>* _a, const int* _ia, const int* _ja, const int* _desca,
+					double* _w, std::complex<double>* _z, const int* _iz, const int* _jz, const int* _descz, std::complex<double>* _work, const int* _lwork,
+					double* _rwork, const int* _lrwork, int* _iwork, const int* _liwork, int* _info);
+	void pdgemm_(const char* _ta, const char* _tb, const int* _m, const int* _n, const int* _k, const double* _alpha,
+					const double* _a, const int* _ia, const int* _ja, const int* _desca, const double* _b, const int* _ib, const int* _jb, const int* _descb,
+					const double* _beta, double* _c, const int* _ic, const int* _jc, const int* _descc);
+	void pzgemm_(const char* _ta, const char* _tb, const int* _m, const int* _n, const int* _k, const std::complex<double>* _alpha,
+					const std::complex<double>* _a, const int* _ia, const int* _ja, const int* _desca, const std::complex<double>* _b, const int* _ib, const int* _jb, const int* _descb,
+					const std::complex<double>* _beta, std::complex<double>* _c, const int* _ic, const int* _jc, const int* _descc);
+}
+#endif
+
+namespace DistEig
+{
+	constexpr int DIST_EIG_NB					= 64;											// size of the square blocks of the block-cyclic layout
+	constexpr unsigned long long DIST_EIG_MIN	= 1ULL << 12;									// smallest Hilbert space worth the distribution
+
+#ifdef HAMIL_USE_SCALAPACK
+	constexpr bool enabled						= true;
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief BLACS process grid over all the ranks (as square as the number of the ranks allows, row-major)
+	*/
+	class Grid
+	{
+	protected:
+		int ctx_								= -1;
+		int nprow_								= 1;
+		int npcol_								= 1;
+		int myrow_								= 0;
+		int mycol_								= 0;
+		int rank_								= 0;
+		int size_								= 1;
+		bool ownMPI_							= false;						// MPI initialized (and finalized) by the grid
+
+		Grid()
+		{
+			int _init = 0;
+			MPI_Initialized(&_init);
+			if (!_init)
+			{
+				int _provided = 0;
+				MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &_provided);
+				this->ownMPI_					= true;
+			}
+			Cblacs_pinfo(&this->rank_, &this->size_);
+			this->nprow_						= (int)std::sqrt((double)this->size_);
+			while (this->size_ % this->nprow_ != 0)
+				--this->nprow_;
+			this->npcol_						= this->size_ / this->nprow_;
+			Cblacs_get(-1, 0, &this->ctx_);
+			Cblacs_gridinit(&this->ctx_, "Row", this->nprow_, this->npcol_);
+			Cblacs_gridinfo(this->ctx_, &this->nprow_, &this->npcol_, &this->myrow_, &this->mycol_);
+		}
+	public:
+		Grid(const Grid&)						= delete;
+		Grid& operator=(const Grid&)			= delete;
+		~Grid()
+		{
+			if (this->ctx_ >= 0)
+				Cblacs_gridexit(this->ctx_);
+			if (this->ownMPI_)
+				MPI_Finalize();
+		}
+
+		static auto get() -> Grid&				{ static Grid _g; return _g;		};
+
+		auto ctx()								const -> int					{ return this->ctx_;		};
+		auto nprow()							const -> int					{ return this->nprow_;		};
+		auto npcol()							const -> int					{ return this->npcol_;		};
+		auto myrow()							const -> int					{ return this->myrow_;		};
+		auto mycol()							const -> int					{ return this->mycol_;		};
+		auto rank()								const -> int					{ return this->rank_;		};
+		auto size()								const -> int					{ return this->size_;		};
+	};
+
+	inline auto rank() -> int					{ return Grid::get().rank();		};
+	inline auto size() -> int					{ return Grid::get().size();		};
+	inline auto root() -> bool					{ return rank() == 0;				};
+
+	/*
+	* @brief Sum of the buffer over all the ranks (in place)
+	*/
+	template <typename _T>
+	inline void allSum(_T* _x, size_t _n)
+	{
+		MPI_Allreduce(MPI_IN_PLACE, _x, (int)_n, std::is_same_v<_T, std::complex<double>> ? MPI_C_DOUBLE_COMPLEX : MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	}
+
+	/*
+	* @brief Broadcast of the buffer (trivially copyable elements) from the root to all the ranks (in place)
+	*/
+	template <typename _T>
+	inline void bcast(_T* _x, size_t _n)
+	{
+		MPI_Bcast(_x, (int)(_n * sizeof(_T)), MPI_BYTE, 0, MPI_COMM_WORLD);
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Square matrix in the 2D block-cyclic layout of the grid (the blocks DIST_EIG_NB x DIST_EIG_NB, the source at (0, 0)).
+	* Each rank holds the local matrix locR x locC in the column-major order (the leading dimension locR).
+	*/
+	template <typename _T>
+	class DistMatrix
+	{
+	protected:
+		int N_									= 0;
+		int nb_									= DIST_EIG_NB;
+		int locR_								= 0;
+		int locC_								= 0;
+		int desc_[9]							= {};
+		arma::Mat<_T> A_;
+
+	public:
+		DistMatrix()							= default;
+		explicit DistMatrix(int _N)				{ this->resize(_N);					};
+
+		void resize(int _N)
+		{
+			const auto& _g						= Grid::get();
+			const int _zero						= 0;
+			const int _myrow					= _g.myrow(), _mycol = _g.mycol();
+			const int _nprow					= _g.nprow(), _npcol = _g.npcol();
+			int _info							= 0;
+			this->N_							= _N;
+			this->nb_							= std::min(DIST_EIG_NB, std::max(_N, 1));
+			this->locR_							= numroc_(&this->N_, &this->nb_, &_myrow, &_zero, &_nprow);
+			this->locC_							= numroc_(&this->N_, &this->nb_, &_mycol, &_zero, &_npcol);
+			const int _lld						= std::max(this->locR_, 1);
+			const int _ctx						= _g.ctx();
+			descinit_(this->desc_, &this->N_, &this->N_, &this->nb_, &this->nb_, &_zero, &_zero, &_ctx, &_lld, &_info);
+			if (_info != 0)
+				throw std::runtime_error("descinit failed: " + std::to_string(_info));
+			this->A_.zeros(this->locR_, this->locC_);
+		}
+
+		// --------------------- G E T T E R S ---------------------
+		auto size()								const -> int					{ return this->N_;			};
+		auto locRows()							const -> int					{ return this->locR_;		};
+		auto locCols()							const -> int					{ return this->locC_;		};
+		auto desc()								const -> const int*				{ return this->desc_;		};
+		auto local()									-> arma::Mat<_T>&		{ return this->A_;			};
+		auto local()							const -> const arma::Mat<_T>&	{ return this->A_;			};
+		auto memory()							const -> size_t					{ return this->A_.n_elem * sizeof(_T);	};
+
+		// --------------------- L A Y O U T -----------------------
+		auto ownsRow(int _i)					const -> bool					{ return (_i / this->nb_) % Grid::get().nprow() == Grid::get().myrow();	};
+		auto ownsCol(int _j)					const -> bool					{ return (_j / this->nb_) % Grid::get().npcol() == Grid::get().mycol();	};
+		auto g2lRow(int _i)						const -> int					{ return (_i / (this->nb_ * Grid::get().nprow())) * this->nb_ + _i % this->nb_;	};
+		auto g2lCol(int _j)						const -> int					{ return (_j / (this->nb_ * Grid::get().npcol())) * this->nb_ + _j % this->nb_;	};
+		auto l2gRow(int _li)					const -> int					{ return ((_li / this->nb_) * Grid::get().nprow() + Grid::get().myrow()) * this->nb_ + _li % this->nb_;	};
+		auto l2gCol(int _lj)					const -> int					{ return ((_lj / this->nb_) * Grid::get().npcol() + Grid::get().mycol()) * this->nb_ + _lj % this->nb_;	};
+
+		// --------------------- A S S E M B L E -------------------
+		/*
+		* @brief Takes the local blocks of the sparse matrix (the other elements are never stored)
+		*/
+		template <typename _Tin>
+		void assemble(const arma::SpMat<_Tin>& _M)
+		{
+			this->resize((int)_M.n_rows);
+			for (auto _it = _M.begin(); _it != _M.end(); ++_it)
+				if (this->ownsRow((int)_it.row()) && this->ownsCol((int)_it.col()))
+					this->A_(this->g2lRow((int)_it.row()), this->g2lCol((int)_it.col())) = algebra::cast<_T>(*_it);
+		}
+
+		/*
+		* @brief Takes the local blocks of the dense matrix
+		*/
+		template <typename _Tin>
+		void assemble(const arma::Mat<_Tin>& _M)
+		{
+			this->resize((int)_M.n_rows);
+			for (int lj = 0; lj < this->locC_; ++lj)
+				for (int li = 0; li < this->locR_; ++li)
+					this->A_(li, lj) = algebra::cast<_T>(_M(this->l2gRow(li), this->l2gCol(lj)));
+		}
+
+		/*
+		* @brief Fills the local blocks with the elements _f(i, j) of the global matrix - only the owned elements are evaluated
+		* @param _N dimension of the matrix
+		* @param _f element of the global matrix
+		* @param _threads number of the threads
+		*/
+		template <typename _F>
+		void fill(int _N, _F&& _f, int _threads = 1)
+		{
+			this->resize(_N);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(1, _threads)) schedule(static)
+#endif
+			for (int lj = 0; lj < this->locC_; ++lj)
+				for (int li = 0; li < this->locR_; ++li)
+					this->A_(li, lj) = algebra::cast<_T>(_f((u64)this->l2gRow(li), (u64)this->l2gCol(lj)));
+		}
+
+		// --------------------- G A T H E R -----------------------
+		/*
+		* @brief Columns [_j0, _j0 + _n) on all the ranks (collective)
+		*/
+		auto cols(int _j0, int _n)				const -> arma::Mat<_T>
+		{
+			arma::Mat<_T> _out(this->N_, _n, arma::fill::zeros);
+			for (int lj = 0; lj < this->locC_; ++lj)
+			{
+				const int _j = this->l2gCol(lj);
+				if (_j < _j0 || _j >= _j0 + _n)
+					continue;
+				for (int li = 0; li < this->locR_; ++li)
+					_out(this->l2gRow(li), _j - _j0) = this->A_(li, lj);
+			}
+			allSum(_out.memptr(), _out.n_elem);
+			return _out;
+		}
+		auto col(int _j)						const -> arma::Col<_T>			{ return arma::Col<_T>(this->cols(_j, 1));	};
+
+		/*
+		* @brief Reduction over the rows of each column - out(j) = sum_i _f(A(i, j)) (collective)
+		*/
+		template <typename _F>
+		auto colReduce(_F&& _f)					const -> arma::Col<double>
+		{
+			arma::Col<double> _out(this->N_, arma::fill::zeros);
+			for (int lj = 0; lj < this->locC_; ++lj)
+			{
+				double _s = 0.0;
+				for (int li = 0; li < this->locR_; ++li)
+					_s += _f(this->A_(li, lj));
+				_out(this->l2gCol(lj)) += _s;
+			}
+			allSum(_out.memptr(), _out.n_elem);
+			return _out;
+		}
+
+		// --------------------- P R O D U C T S -------------------
+		/*
+		* @brief C = op(A) * B for the distributed matrices of the same layout (op - 'N', 'T' or 'C')
+		*/
+		static void gemm(char _ta, const DistMatrix& _A, const DistMatrix& _B, DistMatrix& _C)
+		{
+			const int _one	= 1;
+			const _T _alpha	= 1.0;
+			const _T _beta	= 0.0;
+			const char _tb	= 'N';
+			if (_C.size() != _A.size())
+				_C.resize(_A.size());
+			if constexpr (std::is_same_v<_T, double>)
+				pdgemm_(&_ta, &_tb, &_A.N_, &_A.N_, &_A.N_, &_alpha, _A.A_.memptr(), &_one, &_one, _A.desc_, _B.A_.memptr(), &_one, &_one, _B.desc_,
+						&_beta, _C.A_.memptr(), &_one, &_one, _C.desc_);
+			else
+				pzgemm_(&_ta, &_tb, &_A.N_, &_A.N_, &_A.N_, &_alpha, _A.A_.memptr(), &_one, &_one, _A.desc_, _B.A_.memptr(), &_one, &_one, _B.desc_,
+						&_beta, _C.A_.memptr(), &_one, &_one, _C.desc_);
+		}
+
+		/*
+		* @brief Diagonal of V^+ O V in the eigenbasis V (this) - W = O V is distributed as V, the diagonal is reduced over the
+		* rows of the local blocks (collective)
+		*/
+		template <typename _Tin, template <typename> class _M>
+		auto transformDiag(const _M<_Tin>& _O)	const -> arma::Col<_T>
+		{
+			DistMatrix _Od, _W;
+			_Od.assemble(_O);
+			gemm('N', _Od, *this, _W);
+			arma::Col<_T> _out(this->N_, arma::fill::zeros);
+			for (int lj = 0; lj < this->locC_; ++lj)
+			{
+				_T _s = 0.0;
+				for (int li = 0; li < this->locR_; ++li)
+					_s += algebra::conjugate(this->A_(li, lj)) * _W.A_(li, lj);
+				_out(this->l2gCol(lj)) += _s;
+			}
+			allSum(_out.memptr(), _out.n_elem);
+			return _out;
+		}
+
+		/*
+		* @brief V^+ O V in the eigenbasis V (this) - stays distributed
+		*/
+		template <typename _Tin, template <typename> class _M>
+		auto transform(const _M<_Tin>& _O)		const -> DistMatrix
+		{
+			DistMatrix _Od, _W, _R;
+			_Od.assemble(_O);
+			gemm('N', _Od, *this, _W);
+			gemm(std::is_same_v<_T, double> ? 'T' : 'C', *this, _W, _R);
+			return _R;
+		}
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Full spectrum of the Hermitian matrix H (destroyed), the eigenvectors in V (the same layout). ELPA (two-stage) is
+	* used when available, the divide and conquer of ScaLAPACK otherwise. The eigenvalues are replicated on all the ranks.
+	*/
+	template <typename _T>
+	inline void eigh(DistMatrix<_T>& _H, arma::Col<double>& _eigVal, DistMatrix<_T>& _V)
+	{
+		const int _N		= _H.size();
+		_eigVal.set_size(_N);
+		_V.resize(_N);
+#ifdef HAMIL_USE_ELPA
+		int _err			= 0;
+		if (elpa_init(20171201) != ELPA_OK)
+			throw std::runtime_error("ELPA API version not supported!");
+		elpa_t _e			= elpa_allocate(&_err);
+		const auto& _g		= Grid::get();
+		elpa_set(_e, "na", _N, &_err);
+		elpa_set(_e, "nev", _N, &_err);
+		elpa_set(_e, "local_nrows", _H.locRows(), &_err);
+		elpa_set(_e, "local_ncols", _H.locCols(), &_err);
+		elpa_set(_e, "nblk", std::min(DIST_EIG_NB, std::max(_N, 1)), &_err);
+		elpa_set(_e, "mpi_comm_parent", (int)MPI_Comm_c2f(MPI_COMM_WORLD), &_err);
+		elpa_set(_e, "process_row", _g.myrow(), &_err);
+		elpa_set(_e, "process_col", _g.mycol(), &_err);
+		if (elpa_setup(_e) != ELPA_OK)
+			throw std::runtime_error("ELPA setup failed!");
+		elpa_set(_e, "solver", ELPA_SOLVER_2STAGE, &_err);
+		elpa_eigenvectors(_e, _H.local().memptr(), _eigVal.memptr(), _V.local().memptr(), &_err);
+		elpa_deallocate(_e, &_err);
+		elpa_uninit(&_err);
+		if (_err != ELPA_OK)
+			throw std::runtime_error("ELPA eigenvectors failed: " + std::to_string(_err));
+#else
+		const int _one		= 1;
+		const char _jobz	= 'V';
+		const char _uplo	= 'L';
+		int _info			= 0;
+		int _lwork			= -1, _liwork = -1, _lrwork = -1;
+		int _iworkQ			= 0;
+		if constexpr (std::is_same_v<_T, double>)
+		{
+			double _workQ	= 0.0;
+			pdsyevd_(&_jobz, &_uplo, &_N, _H.local().memptr(), &_one, &_one, _H.desc(), _eigVal.memptr(), _V.local().memptr(), &_one, &_one, _V.desc(),
+					&_workQ, &_lwork, &_iworkQ, &_liwork, &_info);
+			_lwork			= (int)_workQ;
+			_liwork			= std::max(_iworkQ, 1);
+			std::vector<double> _work(_lwork);
+			std::vector<int> _iwork(_liwork);
+			pdsyevd_(&_jobz, &_uplo, &_N, _H.local().memptr(), &_one, &_one, _H.desc(), _eigVal.memptr(), _V.local().memptr(), &_one, &_one, _V.desc(),
+					_work.data(), &_lwork, _iwork.data(), &_liwork, &_info);
+		}
+		else
+		{
+			std::complex<double> _workQ	= 0.0;
+			double _rworkQ				= 0.0;
+			pzheevd_(&_jobz, &_uplo, &_N, _H.local().memptr(), &_one, &_one, _H.desc(), _eigVal.memptr(), _V.local().memptr(), &_one, &_one, _V.desc(),
+					&_workQ, &_lwork, &_rworkQ, &_lrwork, &_iworkQ, &_liwork, &_info);
+			_lwork			= (int)_workQ.real();
+			_lrwork			= (int)_rworkQ;
+			_liwork			= std::max(_iworkQ, 1);
+			std::vector<std::complex<double>> _work(_lwork);
+			std::vector<double> _rwork(_lrwork);
+			std::vector<int> _iwork(_liwork);
+			pzheevd_(&_jobz, &_uplo, &_N, _H.local().memptr(), &_one, &_one, _H.desc(), _eigVal.memptr(), _V.local().memptr(), &_one, &_one, _V.desc(),
+					_work.data(), &_lwork, _rwork.data(), &_lrwork, _iwork.data(), &_liwork, &_info);
+		}
+		if (_info != 0)
+			throw std::runtime_error("ScaLAPACK eigensolver failed: " + std::to_string(_info));
+#endif
+	}
+
+#else
+	constexpr bool enabled						= false;
+
+	inline auto rank() -> int					{ return 0;							};
+	inline auto size() -> int					{ return 1;							};
+	inline auto root() -> bool					{ return true;						};
+	template <typename _T>
+	inline void bcast(_T*, size_t)				{};
+
+	// the distributed matrix is only the handle of a single rank build
+	template <typename _T>
+	class DistMatrix {};
+#endif // HAMIL_USE_SCALAPACK
+};
+
+#endif // !DIST_EIGENSOLVER_H
@@ -0,0 +1,198 @@
+#pragma once
+/***********************************
+* Defines the out-of-core storage of
+* the eigenvectors. The columns are
+* written straight to a binary file
+* after the diagonalization and paged
+* in on demand with the LRU cache of
+* column blocks.
+***********************************/
+
+#ifndef EIGVEC_STORE_H
+#define EIGVEC_STORE_H
+
+#include <fstream>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+constexpr u64 EIGVEC_STORE_MAGIC		= 0x45494756454353ULL;								// "EIGVECS" - header of the file
+constexpr u64 EIGVEC_STORE_BLOCK		= 64;												// default number of columns in a single block
+constexpr u64 EIGVEC_STORE_NBLOCKS		= 16;												// default number of blocks kept in the cache
+
+/*
+* @brief Out-of-core storage of the eigenvector matrix. The file is a header [magic, Nh, nCols, sizeof(_T)] followed
+* by the columns in the column-major order, so that a block of consecutive eigenvectors is a single contiguous read.
+* The access is thread-safe - the cache is guarded with the mutex, as the ETH loops request the states from OpenMP threads.
+* The memory footprint is Nh * blockCols * maxBlocks elements instead of Nh^2.
+*/
+template <typename _T>
+class EigVecStore
+{
+protected:
+	std::string file_							= "";										// path to the file with the columns
+	bool keep_									= false;									// shall keep the file after destruction?
+	u64 Nh_										= 0;										// number of rows
+	u64 nCols_									= 0;										// number of eigenvectors
+	u64 blockCols_								= EIGVEC_STORE_BLOCK;						// columns in the block
+	size_t maxBlocks_							= EIGVEC_STORE_NBLOCKS;						// blocks in the cache
+
+	// cache
+	mutable std::mutex mutex_;
+	mutable std::ifstream in_;
+	mutable std::list<u64> order_				= {};										// most recently used at the front
+	mutable std::unordered_map<u64, std::pair<arma::Mat<_T>, std::list<u64>::iterator>> cache_;
+
+	static constexpr std::streamoff headerSize_	= 4 * sizeof(u64);
+
+	/*
+	* @brief Returns the block from the cache, reads it from the file if necessary (must be called under the lock)
+	* @param _b index of the block
+	*/
+	auto block(u64 _b)							const -> const arma::Mat<_T>&
+	{
+		auto _it = this->cache_.find(_b);
+		if (_it != this->cache_.end())
+		{
+			this->order_.splice(this->order_.begin(), this->order_, _it->second.second);
+			return _it->second.first;
+		}
+
+		// evict the least recently used
+		if (this->cache_.size() >= this->maxBlocks_)
+		{
+			this->cache_.erase(this->order_.back());
+			this->order_.pop_back();
+		}
+
+		// read the block
+		const u64 _start	= _b * this->blockCols_;
+		const u64 _n		= std::min(this->blockCols_, this->nCols_ - _start);
+		arma::Mat<_T> _blk(this->Nh_, _n);
+		this->in_.seekg(headerSize_ + std::streamoff(_start * this->Nh_ * sizeof(_T)));
+		this->in_.read(reinterpret_cast<char*>(_blk.memptr()), std::streamsize(_n * this->Nh_ * sizeof(_T)));
+		if (!this->in_)
+			throw std::runtime_error("Failed to read the eigenvectors from: " + this->file_);
+
+		this->order_.push_front(_b);
+		auto& _ret			= this->cache_[_b];
+		_ret				= std::make_pair(std::move(_blk), this->order_.begin());
+		return _ret.first;
+	}
+
+public:
+	EigVecStore(const std::string& _file, u64 _blockCols = EIGVEC_STORE_BLOCK, size_t _maxBlocks = EIGVEC_STORE_NBLOCKS, bool _keep = false)
+		: file_(_file), keep_(_keep), blockCols_(std::max<u64>(_blockCols, 1)), maxBlocks_(std::max<size_t>(_maxBlocks, 1))	{};
+	~EigVecStore()
+	{
+		this->close();
+		if (!this->keep_ && !this->file_.empty())
+		{
+			std::error_code _ec;
+			std::filesystem::remove(this->file_, _ec);
+		}
+	}
+	EigVecStore(const EigVecStore&)				= delete;
+	EigVecStore& operator=(const EigVecStore&)	= delete;
+
+	// ------------------------------------------------------------------------------------------------------
+
+	auto empty()								const -> bool								{ return this->nCols_ == 0;											};
+	auto size()									const -> u64								{ return this->nCols_;												};
+	auto rows()									const -> u64								{ return this->Nh_;													};
+	auto file()									const -> const std::string&					{ return this->file_;												};
+	auto memory()								const -> u64								{ return this->Nh_ * this->blockCols_ * this->maxBlocks_ * sizeof(_T);	};
+
+	/*
+	* @brief Drops the cache and closes the file
+	*/
+	auto close()								-> void
+	{
+		std::lock_guard<std::mutex> _lock(this->mutex_);
+		this->cache_.clear();
+		this->order_.clear();
+		if (this->in_.is_open())
+			this->in_.close();
+	}
+
+	// ------------------------------------------------------------------------------------------------------
+
+	/*
+	* @brief Writes the eigenvectors to the file, overwriting the previous content
+	* @param _V matrix with the eigenvectors as columns
+	*/
+	auto write(const arma::Mat<_T>& _V)			-> void
+	{
+		this->close();
+		std::lock_guard<std::mutex> _lock(this->mutex_);
+		{
+			std::ofstream _out(this->file_, std::ios::binary | std::ios::trunc);
+			if (!_out)
+				throw std::runtime_error("Cannot open the eigenvector file: " + this->file_);
+			const u64 _header[4] = { EIGVEC_STORE_MAGIC, _V.n_rows, _V.n_cols, sizeof(_T) };
+			_out.write(reinterpret_cast<const char*>(_header), sizeof(_header));
+			_out.write(reinterpret_cast<const char*>(_V.memptr()), std::streamsize(_V.n_elem * sizeof(_T)));
+			if (!_out)
+				throw std::runtime_error("Failed to write the eigenvectors to: " + this->file_);
+		}
+		this->Nh_		= _V.n_rows;
+		this->nCols_	= _V.n_cols;
+		this->in_.open(this->file_, std::ios::binary);
+		if (!this->in_)
+			throw std::runtime_error("Cannot reopen the eigenvector file: " + this->file_);
+	}
+
+	// ------------------------------------------------------------------------------------------------------
+
+	/*
+	* @brief Returns the copy of the column (eigenvector)
+	* @param _idx index of the eigenvector
+	*/
+	auto col(u64 _idx)							const -> arma::Col<_T>
+	{
+		if (_idx >= this->nCols_)
+			throw std::runtime_error("Eigenvector index out of range: " + STR(_idx));
+		std::lock_guard<std::mutex> _lock(this->mutex_);
+		return this->block(_idx / this->blockCols_).col(_idx % this->blockCols_);
+	}
+
+	/*
+	* @brief Returns the consecutive eigenvectors [_start, _start + _n)
+	* @param _start first eigenvector
+	* @param _n number of eigenvectors
+	*/
+	auto cols(u64 _start, u64 _n)				const -> arma::Mat<_T>
+	{
+		if (_start + _n > this->nCols_)
+			throw std::runtime_error("Eigenvector block out of range: " + STR(_start + _n));
+		arma::Mat<_T> _out(this->Nh_, _n);
+		std::lock_guard<std::mutex> _lock(this->mutex_);
+		for (u64 i = 0; i < _n;)
+		{
+			const u64 _b		= (_start + i) / this->blockCols_;
+			const u64 _in		= (_start + i) % this->blockCols_;
+			const auto& _blk	= this->block(_b);
+			const u64 _take		= std::min<u64>(_blk.n_cols - _in, _n - i);
+			_out.cols(i, i + _take - 1) = _blk.cols(_in, _in + _take - 1);
+			i					+= _take;
+		}
+		return _out;
+	}
+
+	/*
+	* @brief Reads all of the eigenvectors (bypasses the cache)
+	*/
+	auto all()									const -> arma::Mat<_T>
+	{
+		std::lock_guard<std::mutex> _lock(this->mutex_);
+		arma::Mat<_T> _out(this->Nh_, this->nCols_);
+		this->in_.seekg(headerSize_);
+		this->in_.read(reinterpret_cast<char*>(_out.memptr()), std::streamsize(_out.n_elem * sizeof(_T)));
+		if (!this->in_)
+			throw std::runtime_error("Failed to read the eigenvectors from: " + this->file_);
+		return _out;
+	}
+};
+
+#endif // !EIGVEC_STORE_H
@@ -25,6 +25,8 @@
 #include "operator_algebra.h"
 #endif
 
+#include "operator_builder.h"
+
 // ################################################################ FORWARD DECLARATIONS ########################################################################
 
 namespace Hilbert {
@@ -181,6 +183,7 @@ namespace Operators {
 		u64 acton_											=			0;					// check on states the operator acts, this is stored as a number and the bitmask is applied! For many body
 		SymGenerators name_									=			SymGenerators::E;   // name of the operator
 		std::string nameS_									=			"E";				// name of the operator in the string
+		std::string pauli_									=			"";					// factors of the Pauli kernel (e.g. "zz", see Fused::correlation), empty for the general operator
 
 		// ====================================================================================================
 
@@ -481,7 +484,8 @@ namespace Operators {
 			isQuadratic_(std::move(o.isQuadratic_)),
 			acton_(std::move(o.acton_)),
 			name_(std::move(o.name_)),
-			nameS_(std::move(o.nameS_)) 
+			nameS_(std::move(o.nameS_)),
+			pauli_(std::move(o.pauli_))
 		{
 			this->init();
 			this->fun_ = std::move(o.fun_);
@@ -498,7 +502,8 @@ namespace Operators {
 			isQuadratic_(o.isQuadratic_),
 			acton_(o.acton_),
 			name_(o.name_),
-			nameS_(o.nameS_) 
+			nameS_(o.nameS_),
+			pauli_(o.pauli_)
 		{
 			this->init();
 			this->fun_ = o.fun_;
@@ -521,6 +526,7 @@ namespace Operators {
 				this->acton_		=		_other.acton_;
 				this->name_			=		_other.name_;
 				this->nameS_		=		_other.nameS_;
+				this->pauli_		=		_other.pauli_;
 				this->overridenMatFun_ =	_other.overridenMatFun_;
 				// copy the functions
 				this->fun_			=		_other.fun_;
@@ -543,6 +549,7 @@ namespace Operators {
 				this->acton_		=		std::move(_other.acton_);
 				this->name_			=		std::move(_other.name_);
 				this->nameS_		=		std::move(_other.nameS_);
+				this->pauli_		=		std::move(_other.pauli_);
 				this->overridenMatFun_ =	std::move(_other.overridenMatFun_);
 
 				// copy the functions
@@ -566,6 +573,7 @@ namespace Operators {
 		// names
 		auto setName(SymGenerators _name)				-> void							{ this->name_ = _name;									}; 
 		auto setNameS(const std::string& _name)			-> void							{ this->nameS_ = _name;									};
+		auto setPauli(const std::string& _pauli)		-> void							{ this->pauli_ = _pauli;								};
 
 		auto setVal(_T _val)							-> void							{ this->eigVal_ = _val;									};
 		auto setNs(size_t Ns)							-> void							{ this->Ns_ = Ns;										};
@@ -592,6 +600,7 @@ namespace Operators {
 		auto getName()									const -> SymGenerators			{ return this->name_;									};
 		auto getNameG()									const -> std::string			{ return SSTR(getSTR_SymGenerators(this->name_));		};
 		auto getNameS()									const -> std::string			{ return this->nameS_;									};
+		auto getPauli()									const -> const std::string&		{ return this->pauli_;									};
 		// functions
 		auto getFun()									const -> repType				{ return this->fun_;									};
 		auto getFunV()									const -> repTypeV				{ return this->funV_;									};
@@ -980,23 +989,19 @@ namespace Operators {
 		LOGINFO("Creating operator matrix: " + VEQ(this->nameS_), LOG_TYPES::INFO, 3);
 	#endif
 
-		_MatType<_TinMat> op(_dim, _dim);
+		_MatType<_TinMat> op;
 
 		// check whether the operator has an overriden matrix function
 		if (this->overridenMatFun_)
 			op = GeneralOperator<_T, repType, repTypeV, _Ts...>::template generateMat<_standarize, _TinMat, _MatType>(_dim, _arg...);
 		else
 		{
-			// otherwise create the operator matrix
-#ifndef _DEBUG
-		#pragma omp parallel for
-#endif
-			for (u64 _base = 0; _base < _dim; ++_base) 
-			{
-				auto [_idx, _val]	=	this->operator()(_base, _arg...);
-				op(_idx, _base)		+=	_val;
-			}
-
+			// otherwise create the operator matrix - each column comes from a single basis state (threaded, see Builder)
+			op = Builder::build<_MatType<_TinMat>>(_dim, _dim, [&](u64 _base, auto& _col)
+				{
+					auto [_idx, _val]	=	this->operator()(_base, _arg...);
+					_col.emplace_back(_idx, _val);
+				});
 		}
 		return GeneralOperator<_T, repType, repTypeV, _Ts...>::template standaridizeMatrix<_standarize, _TinMat, _MatType>(op);
 	}
@@ -1024,18 +1029,26 @@ namespace Operators {
 		// check whether the operator has an overriden matrix function
 		if (this->overridenMatFun_ && this->isQuadratic_)
 			op = GeneralOperator<_T, repType, repTypeV, _Ts...>::template generateMat<_standarize, _TinMat, _MatType>(_dim, _arg...);
+		else if (op.isSparse())
+		{
+			// sparse storage - per-thread triplets merged into CSC by column (the insertion is neither thread safe nor cheap)
+			op.setSparse(Builder::sparse<_TinMat>(_dim, _dim, [&](u64 _base, auto& _col)
+				{
+					auto [_idx, _val]	=	this->operator()(_base, _arg...);
+					_col.emplace_back(_idx, _val);
+				}));
+		}
 		else
 		{
-			// otherwise create the operator matrix
+			// dense storage - the iterations write disjoint columns
 #ifndef _DEBUG
-	#pragma omp parallel for
+	#pragma omp parallel for num_threads(Builder::threads(_dim))
 #endif
-			for (u64 _base = 0; _base < _dim; ++_base) 
+			for (long long _base = 0; _base < (long long)_dim; ++_base) 
 			{
 				auto [_idx, _val]	=	this->operator()(_base, _arg...);
 				op.add(_idx, _base, _val);
 			}
-
 		}
 
 		return GeneralOperator<_T, repType, repTypeV, _Ts...>::template standaridizeMatrix<_standarize, _TinMat, _MatType>(op);
@@ -1056,24 +1069,22 @@ namespace Operators {
 	{
 		using res_typ	=	typename std::common_type<_T1, _TinMat>::type;
 		u64 Nh			=	_Hil.getHilbertSize();
-		_MatType<res_typ> op(Nh, Nh);
-
-		for (u64 _idx = 0; _idx < Nh; _idx++)
-		{
-			auto [_newState, _val]		=	this->operator()(_Hil.getMapping(_idx), _arg...);
+		_MatType<res_typ> op = Builder::build<_MatType<res_typ>>(Nh, Nh, [&](u64 _idx, auto& _col)
+			{
+				auto [_newState, _val]		=	this->operator()(_Hil.getMapping(_idx), _arg...);
 
-			// why even bother?
-			[[unlikely]] if (EQP(std::abs(_val), 0.0, 1e-14))
-				continue;
+				// why even bother?
+				[[unlikely]] if (EQP(std::abs(_val), 0.0, 1e-14))
+					return;
 
-			// looking for the representative
-			auto [_newIdx, _eigval]		=	_Hil.findRep(_newState, _Hil.getNorm(_idx));
+				// looking for the representative
+				auto [_newIdx, _eigval]		=	_Hil.findRep(_newState, _Hil.getNorm(_idx));
 
-			// go to it manually
-			[[likely]]
-			if(_newIdx < Nh)
-				op(_newIdx, _idx)		+=	_val * _eigval;
-		}
+				// go to it manually
+				[[likely]]
+				if(_newIdx < Nh)
+					_col.emplace_back(_newIdx, _val * _eigval);
+			});
 		// standarize the operator
 		//if(_standarize)
 		//	Operators::standarizeOperator(op);
@@ -1095,24 +1106,22 @@ namespace Operators {
 		// using res_typ		=	typename std::common_type<_T1, _T, _T2>::type;
 		u64 NhA				=	_Hil1.getHilbertSize();
 		u64 NhB				=	_Hil2.getHilbertSize();
-		arma::SpMat<_TinMat> op(NhA, NhB);
-
-		for (u64 _idxB = 0; _idxB < NhB; _idxB++) 
-		{
-			// act with an operator on beta sector (right)
-			auto [_newStateB, _valB]				=	this->operator()(_Hil2.getMapping(_idxB), _arg...);
+		arma::SpMat<_TinMat> op = Builder::sparse<_TinMat>(NhA, NhB, [&](u64 _idxB, auto& _col)
+			{
+				// act with an operator on beta sector (right)
+				auto [_newStateB, _valB]				=	this->operator()(_Hil2.getMapping(_idxB), _arg...);
 
-			// why even bother?
-			[[unlikely]] if (EQP(std::abs(_valB), 0.0, 1e-14))
-				continue;
+				// why even bother?
+				[[unlikely]] if (EQP(std::abs(_valB), 0.0, 1e-14))
+					return;
 
-			// find the corresponding index and value in the A sector (left)
-			auto [newIdxA, symValA]					=	_Hil1.findRep(_newStateB, _Hil2.getNorm(_idxB));
+				// find the corresponding index and value in the A sector (left)
+				auto [newIdxA, symValA]					=	_Hil1.findRep(_newStateB, _Hil2.getNorm(_idxB));
 
-			// check if the state is there
-			if (newIdxA < NhA)
-				op(newIdxA, _idxB)					+=	_valB * algebra::conjugate(symValA);
-		}
+				// check if the state is there
+				if (newIdxA < NhA)
+					_col.emplace_back(newIdxA, _valB * algebra::conjugate(symValA));
+			});
 		// standarize the operator
 		if(_standarize)
 			return standarizeOperator(op);
@@ -1384,18 +1393,18 @@ namespace Operators {
 		LOGINFO("Creating operator matrix: " + VEQ(this->nameS_), LOG_TYPES::INFO, 3);
 	#endif
 	
-		_MatType<_TinMat> op(_dim, _dim);
+		_MatType<_TinMat> op;
 
 		// check whether the operator has an overriden matrix function
 		if (this->overridenMatFun_)
 			op = GeneralOperator<_T, repType, repTypeV, _Ts...>::template generateMat<_standarize, _TinMat, _MatType>(_dim, _arg...);
 		else
 		{
-			for (u64 _base = 0; _base < _dim; ++_base) 
-			{
-				for (const auto [_idx, _val] : this->operator()(_base, _arg...))
-					op(_idx, _base)		+=	_val;
-			}
+			op = Builder::build<_MatType<_TinMat>>(_dim, _dim, [&](u64 _base, auto& _col)
+				{
+					for (const auto [_idx, _val] : this->operator()(_base, _arg...))
+						_col.emplace_back(_idx, _val);
+				});
 		}
 
 		return GeneralOperator<_T, repType, repTypeV, _Ts...>::template standaridizeMatrix<_standarize, _TinMat, _MatType>(op);
@@ -1417,9 +1426,20 @@ namespace Operators {
 		// check whether the operator has an overriden matrix function
 		if (this->overridenMatFun_ && this->isQuadratic_)
 			op = GeneralOperator<_T, repType, repTypeV, _Ts...>::template generateMat<_standarize, _TinMat, _MatType>(_dim, _arg...);
+		else if (op.isSparse())
+		{
+			op.setSparse(Builder::sparse<_TinMat>(_dim, _dim, [&](u64 _base, auto& _col)
+				{
+					for (const auto [_idx, _val] : this->operator()(_base, _arg...))
+						_col.emplace_back(_idx, _val);
+				}));
+		}
 		else
 		{
-			for (u64 _base = 0; _base < _dim; ++_base) 
+#ifndef _DEBUG
+	#pragma omp parallel for num_threads(Builder::threads(_dim))
+#endif
+			for (long long _base = 0; _base < (long long)_dim; ++_base) 
 			{
 				for (const auto [_idx, _val] : this->operator()(_base, _arg...))
 					op.add(_idx, _base, _val);
@@ -2127,12 +2147,15 @@ namespace Operators {
 		Operators::OperatorExt<_T, _Ts...>::generateMat(_InT _dim, _Ts ..._arg) const
 	{
 
-		_MatType<_TinMat> op(_dim, _dim);
-		for (auto& _op : *this)
-		{
-			_MatType<_TinMat> _opMat = _op.template generateMat<_TinMat, _MatType, _InT, false>(_dim, _arg...);
-			op += _opMat;
-		}
+		// all the operators act on the same column at once - a single threaded pass instead of a matrix per operator
+		_MatType<_TinMat> op = Builder::build<_MatType<_TinMat>>(_dim, _dim, [&](u64 _base, auto& _col)
+			{
+				for (const auto& _op : *this)
+				{
+					auto [_idx, _val]	=	_op(_base, _arg...);
+					_col.emplace_back(_idx, _val);
+				}
+			});
 
 		// standarize the operator
 		if(_standarize)
@@ -2157,10 +2180,28 @@ namespace Operators {
 
 		GeneralizedMatrix<_TinMat> op(_dim);
 
-		for (auto& _op : *this)
+		// all the operators act on the same column at once (see Builder)
+		if (op.isSparse())
+			op.setSparse(Builder::sparse<_TinMat>(_dim, _dim, [&](u64 _base, auto& _col)
+				{
+					for (const auto& _op : *this)
+					{
+						auto [_idx, _val]	=	_op(_base, _arg...);
+						_col.emplace_back(_idx, _val);
+					}
+				}));
+		else
 		{
-			auto _opMat = _op.template generateMat<_TinMat, _InT, false>(_dim, _arg...);
-			op += _opMat;
+			// dense storage - the iterations write disjoint columns
+#ifndef _DEBUG
+	#pragma omp parallel for num_threads(Builder::threads(_dim))
+#endif
+			for (long long _base = 0; _base < (long long)_dim; ++_base)
+				for (const auto& _op : *this)
+				{
+					auto [_idx, _val]	=	_op(_base, _arg...);
+					op.add(_idx, _base, _val);
+				}
 		}
 
 		// standarize the operator
@@ -2184,13 +2225,19 @@ namespace Operators {
 	{
 		using res_typ	=	typename std::common_type<_T1, _TinMat>::type;
 		u64 Nh			=	_Hil.getHilbertSize();
-		_MatType<res_typ> op(Nh, Nh);
-
-		for(auto& _op : *this)
-		{
-			_MatType<res_typ> _opMat = _op.template generateMat<_TinMat, _MatType, _T1, _spinModes, false>(_Hil, _arg...);
-			op += _opMat;
-		}
+		_MatType<res_typ> op = Builder::build<_MatType<res_typ>>(Nh, Nh, [&](u64 _idx, auto& _col)
+			{
+				const u64 _state			=	_Hil.getMapping(_idx);
+				for (const auto& _op : *this)
+				{
+					auto [_newState, _val]	=	_op(_state, _arg...);
+					if (EQP(std::abs(_val), 0.0, 1e-14))
+						continue;
+					auto [_newIdx, _eigval]	=	_Hil.findRep(_newState, _Hil.getNorm(_idx));
+					if (_newIdx < Nh)
+						_col.emplace_back(_newIdx, _val * _eigval);
+				}
+			});
 
 		// standarize the operator
 		if(_standarize)
@@ -2213,13 +2260,19 @@ namespace Operators {
 		// using res_typ		=	typename std::common_type<_T1, _T, _T2>::type;
 		u64 NhA				=	_Hil1.getHilbertSize();
 		u64 NhB				=	_Hil2.getHilbertSize();
-		arma::SpMat<_TinMat> op(NhA, NhB);
-
-		for(auto& _op : *this)
-		{
-			_MatType<_TinMat> _opMat = _op.template generateMat<_TinMat, _MatType, _T1, _T2, _spinModes, false>(_Hil1, _Hil2, _arg...);
-			op += _opMat;
-		}
+		arma::SpMat<_TinMat> op = Builder::sparse<_TinMat>(NhA, NhB, [&](u64 _idxB, auto& _col)
+			{
+				const u64 _stateB				=	_Hil2.getMapping(_idxB);
+				for (auto& _op : *this)
+				{
+					auto [_newStateB, _valB]	=	_op(_stateB, _arg...);
+					if (EQP(std::abs(_valB), 0.0, 1e-14))
+						continue;
+					auto [newIdxA, symValA]		=	_Hil1.findRep(_newStateB, _Hil2.getNorm(_idxB));
+					if (newIdxA < NhA)
+						_col.emplace_back(newIdxA, _valB * algebra::conjugate(symValA));
+				}
+			});
 
 		// standarize the operator
 		if(_standarize)
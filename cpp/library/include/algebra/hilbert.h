@@ -15,9 +15,20 @@
 #ifndef GLOBALSYM_H
 	#include "global_symmetries.h"
 #endif
+#ifndef SYMMETRY_KERNEL_H
+	#include "symmetry_kernel.h"
+#endif
+#ifndef RANK_INDEX_H
+	#include "rank_index.h"
+#endif
+#ifndef TASK_SCHEDULER_H
+	#include "task_scheduler.h"
+#endif
 
 #include <mutex>
 #include <cstdint>
+#include <fstream>
+#include <filesystem>
 #include <shared_mutex>
 
 // ##########################################################################################################################################
@@ -72,13 +83,23 @@ namespace Hilbert
 		GSymV symGroupGlobal_;													// stores the global symmetry group representatives
 		SymOpV symGroup_;														// stores the local symmetry group representatives
 		SymGV symGroupSec_;														// stores the local symmetry group and their sectors for convenience
+		SymGroupKernel<_T> symKernel_;											// bit-parallel form of the local symmetry group (if applicable)
 
 		// ------------------------ NORM AND MAPPING  ------------------------
 		v_1d<_T> normalization_								= {};				// stores the representative normalization
 		v_1d<u64> mapping_									= {};				// stores the symmetry representative mapping
 		v_1d<u64> fullMap_									= {};				// stores the map of the representatives to a Hilbert space without the global syms
 		RPairV reprMap_										= {};				// stores the map from the Hilbert space to the corresponding representative index and value of return (optional)
+		RankIndex rankIdx_;														// O(1) index of the mapping over the full Hilbert space (optional)
+		inline static bool useRankIdx_						= true;				// shall the rank index be created?
 
+		// ----------------------------- CACHE -------------------------------
+		inline static std::string cacheDir_					= "";				// directory with the cached mappings (empty - no caching)
+		
+		auto getCacheKey()								const -> std::string;	// key identifying the sector
+		auto getCacheFile()								const -> std::string;	// file name (without extension) for the sector
+		bool loadCache(bool _repr);												// loads the mapping (and representatives) from the cache
+		void saveCache()								const;					// saves the mapping (and representatives) to the cache
 
 	public:
 		// -------------------------- CONSTRUCTORS ---------------------------
@@ -122,8 +143,10 @@ namespace Hilbert
 				this->symGroupGlobal_	= _H.symGroupGlobal_;
 				this->normalization_	= _H.normalization_;
 				this->symGroup_			= _H.symGroup_;
+				this->symKernel_		= _H.symKernel_;
 				this->fullMap_			= _H.fullMap_;
 				this->mapping_			= _H.mapping_;
+				this->rankIdx_			= _H.rankIdx_;
 				this->t_				= _H.t_;
 			}
 			return *this;
@@ -147,14 +170,17 @@ namespace Hilbert
 				this->symGroupGlobal_	= std::move(_H.symGroupGlobal_);
 				this->normalization_	= std::move(_H.normalization_);
 				this->symGroup_			= std::move(_H.symGroup_);
+				this->symKernel_		= std::move(_H.symKernel_);
 				this->fullMap_			= std::move(_H.fullMap_);
 				this->mapping_			= std::move(_H.mapping_);
+				this->rankIdx_			= std::move(_H.rankIdx_);
 				this->t_				= std::move(_H.t_);
 			}
 			return *this;
 		}
 		
 		// ------------------------- MAP INITIALIZERS -------------------------
+		static void setCacheDir(const std::string& _dir)						{ cacheDir_ = _dir; if (!cacheDir_.empty() && cacheDir_.back() != kPS[0]) cacheDir_ += kPS; };
 		void hi();
 		void init();
 		void initMapping(SymGV _gen							= {},
@@ -165,6 +191,8 @@ namespace Hilbert
 		void generateSymGroup(const v_1d<std::pair<Operators::SymGenerators, int>>& g);	// generates symmetry groups taking the comutation into account
 		void generateMapping();																// generates mapping from reduced hilbert space to original
 		void generateFullMap();																// generates full map if a global symmetry is present
+		void generateRankIndex();															// generates the O(1) index of the mapping
+		static void setRankIndex(bool _use)													{ useRankIdx_ = _use; };
 
 		std::pair<u64, _T> findRep(u64 baseIdx)			const;					// returns the representative index and symmetry return eigval
 		std::pair<u64, _T> findRep(u64 baseIdx, _T nB)	const;					// returns the representative and symmetry eigval taking the second symmetry sector beta
@@ -174,6 +202,7 @@ namespace Hilbert
 		arma::Col<_T> castToFull(const arma::Col<_T>& _s);
 
 		// ----------------------------- GETTERS ------------------------------
+		auto findIdx(u64 _state)								const -> u64			{ return this->rankIdx_.empty() ? binarySearch(this->mapping_, 0, static_cast<ull>(this->Nh) - 1, _state) : this->rankIdx_.find(_state); };
 		BoundaryConditions getBC()								const					{ return this->lat->get_BC();																};
 		std::shared_ptr<Lattice> getLattice()					const					{ return this->lat;																			};
 		auto getNs()											const -> uint			{ return this->Ns;																			};
@@ -309,8 +338,8 @@ namespace Hilbert
 	HilbertSpace<_T, _spinModes>::HilbertSpace(const HilbertSpace<_T, _spinModes>& _H)
 		: Nhl(_H.Nhl), t_(_H.t_), threadNum(_H.threadNum), Ns(_H.Ns), Nint(_H.Nint), 
 		Nh(_H.Nh), NhFull(_H.NhFull), lat(_H.lat), symGroupGlobal_(_H.symGroupGlobal_), 
-		symGroup_(_H.symGroup_), symGroupSec_(_H.symGroupSec_), normalization_(_H.normalization_), 
-		mapping_(_H.mapping_), fullMap_(_H.fullMap_), reprMap_(_H.reprMap_)
+		symGroup_(_H.symGroup_), symGroupSec_(_H.symGroupSec_), symKernel_(_H.symKernel_), normalization_(_H.normalization_), 
+		mapping_(_H.mapping_), fullMap_(_H.fullMap_), reprMap_(_H.reprMap_), rankIdx_(_H.rankIdx_)
 	{
 		WriteLock lhs_lk(this->Mutex, std::defer_lock);
 		ReadLock  rhs_lk(_H.Mutex	, std::defer_lock);
@@ -333,10 +362,12 @@ namespace Hilbert
 		symGroupGlobal_(std::move(_H.symGroupGlobal_)),
 		symGroup_(std::move(_H.symGroup_)),
 		symGroupSec_(std::move(_H.symGroupSec_)),
+		symKernel_(std::move(_H.symKernel_)),
 		normalization_(std::move(_H.normalization_)),
 		mapping_(std::move(_H.mapping_)),
 		fullMap_(std::move(_H.fullMap_)),
-		reprMap_(std::move(_H.reprMap_)) 
+		reprMap_(std::move(_H.reprMap_)),
+		rankIdx_(std::move(_H.rankIdx_))
 	{
 		WriteLock lhs_lk(this->Mutex, std::defer_lock);
 		ReadLock  rhs_lk(_H.Mutex, std::defer_lock);
@@ -397,8 +428,10 @@ namespace Hilbert
 		this->NhFull			=				(u64)std::pow(this->Nhl, this->Ns * this->Nint);
 		this->normalization_	=				v_1d<_T>();
 		this->symGroup_			=				v_1d<Operators::Operator<_T>>();
+		this->symKernel_.reset();
 		this->mapping_			=				v_1d<u64>();
 		this->reprMap_			=				v_1d<std::pair<u64, _T>>();
+		this->rankIdx_.reset();
 	}
 
 	// ##########################################################################################################################################
@@ -413,7 +446,22 @@ namespace Hilbert
 		this->generateSymGroup(_gen);
 		if(_gen.size() != 0)
 			LOGINFO(_t, "Symmetry group generator: " + this->getSymInfo(), 4);
+		// try the bit-parallel form of the group
+		if constexpr (_spinModes == 2)
+		{
+			if (this->symKernel_.build(this->symGroup_, this->Ns * this->Nint))
+				LOGINFO("Using bit-parallel symmetry group kernel: " + VEQ(this->symKernel_.size()), LOG_TYPES::INFO, 3);
+		}
+		// try the cache first
+		if (this->loadCache(_genereateRepresentativesMap))
+		{
+			this->generateRankIndex();
+			LOGINFO(_t, "Mapping loaded from the cache: " + this->getSymInfo(), 4);
+			LOGINFO(_t, "Hilbert Space Creator: " + this->getSymInfo(), 3);
+			return;
+		}
 		this->generateMapping();
+		this->generateRankIndex();
 		if(_gen.size() != 0)
 			LOGINFO(_t, "Mapping generator: " + this->getSymInfo(), 4);
 		if (_genereateRepresentativesMap)
@@ -421,6 +469,7 @@ namespace Hilbert
 			this->mappingKernelRepr();
 			LOGINFO(_t, "Representatives generator: " + this->getSymInfo(), 4);
 		}
+		this->saveCache();
 		LOGINFO(_t, "Hilbert Space Creator: " + this->getSymInfo(), 3);
 	}
 	
@@ -641,6 +690,10 @@ namespace Hilbert
 		if (!this->reprMap_.empty())
 			return this->reprMap_[baseIdx];
 
+		// use the lookup tables if available
+		if (this->symKernel_.isValid())
+			return this->symKernel_.findRep(baseIdx);
+
 		// start with a biggest value possible
 		u64 SEC = INT64_MAX;
 		// setup starting symmetry eigenvalue - nothing needs to be done
@@ -686,14 +739,14 @@ namespace Hilbert
 		}
 
 		// find representative already in the mapping (can be that the matrix element already changes the state to the representative)
-		u64 idx = binarySearch(this->mapping_, 0, static_cast<ull>(this->Nh) - 1, baseIdx);
+		u64 idx = this->findIdx(baseIdx);
 
 		// if is in range (so has been found in the mapping)
 		if (idx < this->mapping_.size()) return std::make_pair(idx, this->normalization_[idx] / nB);
 
 		// need to find the representative by acting
 		auto [min, symEig] = this->findRep(baseIdx);
-		idx = binarySearch(this->mapping_, 0, static_cast<ull>(this->Nh) - 1, min);
+		idx = this->findIdx(min);
 
 		// if is in range
 		if (idx < this->mapping_.size()) return std::make_pair(idx, this->normalization_[idx] / nB * algebra::conjugate(symEig));
@@ -719,6 +772,9 @@ namespace Hilbert
 	template<typename _T, uint _spinModes>
 	inline _T Hilbert::HilbertSpace<_T, _spinModes>::getSymNorm(u64 baseIdx) const
 	{
+		if (this->symKernel_.isValid())
+			return std::sqrt(this->symKernel_.stabilizer(baseIdx));
+
 		_T norm = 0.0;
 		for (auto& G : this->symGroup_) {
 			// if we return to the same state by acting with symmetry group operators
@@ -882,7 +938,7 @@ namespace Hilbert
 				continue;
 			}
 			// already in the map
-			idx							= binarySearch(this->mapping_, 0, static_cast<ull>(this->Nh) - 1, (u64)j);
+			idx							= this->findIdx((u64)j);
 			if (idx < this->mapping_.size())
 			{
 				this->reprMap_.push_back(std::make_pair(idx, 1.0));
@@ -891,7 +947,7 @@ namespace Hilbert
 
 			// otherwise check the representative
 			const auto [SEC, symEig]	= this->findRep(j);
-			idx							= binarySearch<u64>(this->mapping_, 0, static_cast<ull>(this->Nh) - 1, SEC);
+			idx							= this->findIdx(SEC);
 
 			// if is in range
 			if (idx < this->mapping_.size()) 
@@ -930,23 +986,14 @@ namespace Hilbert
 			//Threaded
 			v_2d<u64> mapThreaded(numThreads);
 			v_2d<_T> normThreaded(numThreads);
-			v_1d<std::thread> threads;
-
-			// -------- reserve threads --------
-			threads.reserve(numThreads);
-			for (auto t = 0; t < numThreads; t++) 
-			{
-				start	= (u64)(powNs / (double)numThreads * t);
-				stop	= ((t + 1) == numThreads ? powNs : u64(powNs / (double)numThreads * (double)(t + 1)));
-
-				mapThreaded[t]	= v_1d<u64>();
-				normThreaded[t] = v_1d<_T>();
-				threads.emplace_back(&HilbertSpace<_T>::mappingKernel, this, start, stop, std::ref(mapThreaded[t]), std::ref(normThreaded[t]), t);
-			}
 
-			// -------- join the threads together --------
-			for (auto& thread : threads)
-				thread.join();
+			// -------- the ranges on the shared workers (a nested call runs serially) --------
+			Sched::Scheduler::get().run((unsigned)numThreads, [&](unsigned t, unsigned) 
+				{
+					const u64 _start	= (u64)(powNs / (double)numThreads * t);
+					const u64 _stop		= ((t + 1) == (unsigned)numThreads ? powNs : u64(powNs / (double)numThreads * (double)(t + 1)));
+					this->mappingKernel(_start, _stop, mapThreaded[t], normThreaded[t], (int)t);
+				});
 
 			for (auto& t : mapThreaded)
 				this->mapping_.insert(this->mapping_.end(), std::make_move_iterator(t.begin()), std::make_move_iterator(t.end()));
@@ -963,6 +1010,150 @@ namespace Hilbert
 
 	// ##########################################################################################################################################
 
+	/*
+	* @brief Creates the rank index over the full Hilbert space, so that the representative lookups in findRep are O(1).
+	* Skipped when there is no mapping or the full Hilbert space exceeds RANK_INDEX_MAX_BITS - then the binary search is used.
+	*/
+	template<typename _T, uint _spinModes>
+	inline void HilbertSpace<_T, _spinModes>::generateRankIndex()
+	{
+		if (!useRankIdx_ || this->mapping_.empty())
+			return;
+		if (this->rankIdx_.build(this->mapping_, this->NhFull))
+			LOGINFO("Created the rank index of the mapping: " + STRP(this->rankIdx_.memory() / 1e6, 3) + "MB", LOG_TYPES::INFO, 3);
+	}
+
+	// ##########################################################################################################################################
+
+	// ############################################################### C A C H E ################################################################
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Creates the key that uniquely identifies the symmetry sector - the number of sites, the lattice, 
+	* the local generators with their sectors and the global symmetries with their values.
+	*/
+	template<typename _T, uint _spinModes>
+	inline std::string HilbertSpace<_T, _spinModes>::getCacheKey() const
+	{
+		std::string _key	= "Ns=" + STR(this->Ns) + ",Nint=" + STR(this->Nint) + ",Nhl=" + STR(this->Nhl);
+		_key				+= std::is_same_v<_T, cpx> ? ",cpx" : ",real";
+		if (this->lat)
+			_key			+= "," + this->lat->get_info();
+		_key				+= this->getSymInfo();
+		return _key;
+	}
+
+	/*
+	* @brief File name for the cache of a given sector. The hash is only used to shorten the name, the key itself 
+	* is stored alongside the data and checked on load.
+	*/
+	template<typename _T, uint _spinModes>
+	inline std::string HilbertSpace<_T, _spinModes>::getCacheFile() const
+	{
+		std::stringstream _ss;
+		_ss << std::hex << std::hash<std::string>{}(this->getCacheKey());
+		return cacheDir_ + "hilbert_" + _ss.str();
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Loads the mapping and the normalization from the cache directory (if set). 
+	* @param _repr shall the map of representatives be loaded as well? If it is not stored, nothing is loaded.
+	* @returns true if the sector has been found in the cache
+	*/
+	template<typename _T, uint _spinModes>
+	inline bool HilbertSpace<_T, _spinModes>::loadCache(bool _repr)
+	{
+		if (cacheDir_.empty() || (this->symGroupGlobal_.empty() && this->symGroup_.empty()))
+			return false;
+
+		const std::string _file = this->getCacheFile();
+		if (!std::filesystem::exists(_file + ".h5") || !std::filesystem::exists(_file + ".key"))
+			return false;
+
+		BEGIN_CATCH_HANDLER
+		{
+			// check the key
+			std::ifstream _keyFile(_file + ".key");
+			std::string _key;
+			std::getline(_keyFile, _key);
+			if (_key != this->getCacheKey())
+			{
+				LOGINFO("Hilbert cache collision, recalculating: " + _file, LOG_TYPES::WARNING, 3);
+				return false;
+			}
+
+			arma::uvec _map;
+			arma::Col<_T> _norm;
+			if (!_map.load(arma::hdf5_name(_file + ".h5", "mapping")) || !_norm.load(arma::hdf5_name(_file + ".h5", "norm")))
+				return false;
+
+			arma::uvec _reprIdx;
+			arma::Col<_T> _reprVal;
+			if (_repr && (!_reprIdx.load(arma::hdf5_name(_file + ".h5", "repr_idx")) || !_reprVal.load(arma::hdf5_name(_file + ".h5", "repr_val"))))
+				return false;
+
+			// set the values
+			this->mapping_			= v_1d<u64>(_map.begin(), _map.end());
+			this->normalization_	= arma::conv_to<v_1d<_T>>::from(_norm);
+			this->Nh				= this->mapping_.size();
+			if (_repr)
+			{
+				this->reprMap_.resize(_reprIdx.n_elem);
+				for (u64 i = 0; i < _reprIdx.n_elem; ++i)
+					this->reprMap_[i] = std::make_pair((u64)_reprIdx(i), _reprVal(i));
+			}
+		}
+		END_CATCH_HANDLER("Exception in reading the Hilbert cache: " + _file, return false;);
+		return true;
+	}
+
+	/*
+	* @brief Saves the mapping, the normalization and (if present) the map of representatives to the cache directory.
+	* The file is written under a temporary name and moved in place, so that the parallel realizations never read partial files.
+	*/
+	template<typename _T, uint _spinModes>
+	inline void HilbertSpace<_T, _spinModes>::saveCache() const
+	{
+		if (cacheDir_.empty() || this->mapping_.empty())
+			return;
+
+		const std::string _file = this->getCacheFile();
+		const std::string _tmp	= _file + "." + STR(clk::now().time_since_epoch().count()) + ".tmp";
+		BEGIN_CATCH_HANDLER
+		{
+			std::filesystem::create_directories(cacheDir_);
+
+			arma::uvec _map(this->mapping_.size());
+			for (u64 i = 0; i < this->mapping_.size(); ++i)
+				_map(i) = this->mapping_[i];
+			_map.save(arma::hdf5_name(_tmp + ".h5", "mapping"));
+			arma::Col<_T>(this->normalization_).save(arma::hdf5_name(_tmp + ".h5", "norm", arma::hdf5_opts::append));
+			if (!this->reprMap_.empty())
+			{
+				arma::uvec _reprIdx(this->reprMap_.size());
+				arma::Col<_T> _reprVal(this->reprMap_.size());
+				for (u64 i = 0; i < this->reprMap_.size(); ++i)
+				{
+					_reprIdx(i) = this->reprMap_[i].first;
+					_reprVal(i) = this->reprMap_[i].second;
+				}
+				_reprIdx.save(arma::hdf5_name(_tmp + ".h5", "repr_idx", arma::hdf5_opts::append));
+				_reprVal.save(arma::hdf5_name(_tmp + ".h5", "repr_val", arma::hdf5_opts::append));
+			}
+			std::ofstream(_tmp + ".key") << this->getCacheKey() << EL;
+
+			std::filesystem::rename(_tmp + ".h5", _file + ".h5");
+			std::filesystem::rename(_tmp + ".key", _file + ".key");
+			LOGINFO("Saved the Hilbert space to the cache: " + _file, LOG_TYPES::INFO, 3);
+		}
+		END_CATCH_HANDLER("Exception in saving the Hilbert cache: " + _file, ;);
+	}
+
+	// ##########################################################################################################################################
+
 	// ############################################################ F U L L  M A P ##############################################################
 
 	// ##########################################################################################################################################
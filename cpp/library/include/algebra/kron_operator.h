@@ -0,0 +1,273 @@
+#pragma once
+/***********************************
+* Defines the structured operator of
+* the form S + sum_t c_t (+)_l A_l (x) I_R
+* (the direct sum over the diagonal
+* blocks of the Kronecker products with
+* the identity) used by the random dot
+* models. The factors are kept small,
+* the action on a vector is a GEMM per
+* block and the assembly writes only
+* the nonzero blocks of the matrix.
+***********************************/
+
+#ifndef KRON_OPERATOR_H
+#define KRON_OPERATOR_H
+
+#include <vector>
+#include <stdexcept>
+#include "operator_builder.h"
+
+namespace Operators
+{
+	namespace Kron
+	{
+		/*
+		* @brief Single term c * (+)_{l < L} (A_{l} (x) I_R). The index of the basis state reads l * (dA * R) + a * R + r.
+		* With a single factor, the same A is repeated in all L blocks - for L = 1 the term is the plain kron(A, EYE(R)),
+		* with R = 1 the term is block-diagonal with the (possibly independent) blocks A_l.
+		*/
+		template <typename _T>
+		struct Term
+		{
+			v_1d<arma::Mat<_T>> A_;																	// factors (one or L)
+			u64 R_						= 1;														// dimension of the identity on the right
+			u64 L_						= 1;														// number of the diagonal blocks
+			_T c_						= 1.0;														// prefactor
+
+			auto dA()					const -> u64												{ return this->A_.empty() ? 0 : this->A_[0].n_rows;	};
+			auto block()				const -> u64												{ return this->dA() * this->R_;						};
+			auto factor(u64 l)			const -> const arma::Mat<_T>&								{ return this->A_[this->A_.size() == 1 ? 0 : l];	};
+		};
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Structured operator - the sparse part and the Kronecker terms. The whole matrix is never formed
+		* unless requested by dense() / sparse() (or added to the existing matrix with addTo).
+		*/
+		template <typename _T>
+		class KronOperator
+		{
+		protected:
+			u64 N_						= 0;														// dimension of the operator
+			arma::SpMat<_T> S_;																		// sparse part (spin flips, fields)
+			v_1d<Term<_T>> terms_;																	// Kronecker terms
+
+		public:
+			KronOperator()				= default;
+			KronOperator(u64 _N) : N_(_N), S_(_N, _N)												{};
+
+			// ---------------------------------------------------------------------------------------------------------------------------------
+
+			auto size()					const -> u64												{ return this->N_;									};
+			auto terms()				const -> const v_1d<Term<_T>>&								{ return this->terms_;								};
+			auto getSparse()			const -> const arma::SpMat<_T>&								{ return this->S_;									};
+			auto memory()				const -> u64;
+			auto trace()				const -> _T;
+
+			// ---------------------------------------------------------------------------------------------------------------------------------
+
+			/*
+			* @brief Sets the sparse part of the operator
+			*/
+			void setSparse(const arma::SpMat<_T>& _S)
+			{
+				if (_S.n_rows != this->N_ || _S.n_cols != this->N_)
+					throw std::invalid_argument("KronOperator: wrong size of the sparse part, " + VEQ(_S.n_rows) + "," + VEQ(this->N_));
+				this->S_				= _S;
+			}
+
+			/*
+			* @brief Adds the term c * kron(_A, EYE(_R)) repeated along the diagonal (the blocks of the size dim(_A) * _R)
+			*/
+			void addKron(const arma::Mat<_T>& _A, u64 _R, _T _c = 1.0)
+			{
+				this->addBlocks(v_1d<arma::Mat<_T>>({ _A }), _R, _c);
+			}
+
+			/*
+			* @brief Adds the term c * (+)_l (A_l (x) I_R). Either a single factor (repeated) or one per block.
+			*/
+			void addBlocks(v_1d<arma::Mat<_T>>&& _A, u64 _R, _T _c = 1.0)
+			{
+				if (_A.empty())
+					return;
+				Term<_T> _t;
+				_t.A_					= std::move(_A);
+				_t.R_					= std::max<u64>(_R, 1);
+				_t.c_					= _c;
+				const u64 _block		= _t.block();
+				if (_block == 0 || this->N_ % _block != 0)
+					throw std::invalid_argument("KronOperator: the blocks do not tile the operator, " + VEQ(_block) + "," + VEQ(this->N_));
+				_t.L_					= this->N_ / _block;
+				if (_t.A_.size() != 1 && _t.A_.size() != _t.L_)
+					throw std::invalid_argument("KronOperator: wrong number of the blocks, " + VEQ(_t.A_.size()) + "," + VEQ(_t.L_));
+				for (const auto& _a : _t.A_)
+					if (_a.n_rows != _t.dA() || _a.n_cols != _t.dA())
+						throw std::invalid_argument("KronOperator: the factors must be square and of the same size");
+				this->terms_.push_back(std::move(_t));
+			}
+
+			// ---------------------------------------------------------------------------------------------------------------------------------
+
+			void apply(const arma::Col<_T>& _x, arma::Col<_T>& _y, bool _add = false)	const;
+			void apply(const arma::Mat<_T>& _X, arma::Mat<_T>& _Y)						const;
+			void addTo(arma::Mat<_T>& _M)												const;
+			auto dense()																const -> arma::Mat<_T>;
+			auto sparse()																const -> arma::SpMat<_T>;
+		};
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Number of the stored elements (the sparse part and the factors)
+		*/
+		template <typename _T>
+		inline u64 KronOperator<_T>::memory() const
+		{
+			u64 _mem = this->S_.n_nonzero;
+			for (const auto& _t : this->terms_)
+				_mem += _t.A_.size() * _t.dA() * _t.dA();
+			return _mem;
+		}
+
+		/*
+		* @brief Trace of the operator - Tr(A (x) I_R) = R * Tr(A)
+		*/
+		template <typename _T>
+		inline _T KronOperator<_T>::trace() const
+		{
+			_T _tr = arma::trace(this->S_);
+			for (const auto& _t : this->terms_)
+				for (u64 l = 0; l < _t.L_; ++l)
+					_tr += _t.c_ * (double)_t.R_ * arma::trace(_t.factor(l));
+			return _tr;
+		}
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Action on the vector y (+)= O x. Each block of the vector is viewed as the R x dA matrix X (the identity index
+		* runs fastest), for which (A (x) I_R) x = vec(X A^T) - a single GEMM with the small factor, without any temporary of the size
+		* of the operator.
+		* @param _x input vector
+		* @param _y output vector (resized)
+		* @param _add accumulate into _y instead of overwriting it
+		*/
+		template <typename _T>
+		inline void KronOperator<_T>::apply(const arma::Col<_T>& _x, arma::Col<_T>& _y, bool _add) const
+		{
+			if (_x.n_elem != this->N_)
+				throw std::invalid_argument("KronOperator: wrong size of the vector, " + VEQ(_x.n_elem) + "," + VEQ(this->N_));
+			if (!_add || _y.n_elem != this->N_)
+				_y.zeros(this->N_);
+
+			if (this->S_.n_nonzero > 0)
+				_y += this->S_ * _x;
+
+			for (const auto& _t : this->terms_)
+			{
+				const u64 _dA		= _t.dA();
+				const u64 _block	= _t.block();
+#ifndef _DEBUG
+#	pragma omp parallel for schedule(static) if(_t.L_ > 1)
+#endif
+				for (long long l = 0; l < (long long)_t.L_; ++l)
+				{
+					const arma::Mat<_T> _X(const_cast<_T*>(_x.memptr()) + l * _block, _t.R_, _dA, false, true);
+					arma::Mat<_T> _Y(_y.memptr() + l * _block, _t.R_, _dA, false, true);
+					_Y += _t.c_ * (_X * _t.factor(l).st());
+				}
+			}
+		}
+
+		/*
+		* @brief Action on the block of vectors (columns) Y = O X
+		*/
+		template <typename _T>
+		inline void KronOperator<_T>::apply(const arma::Mat<_T>& _X, arma::Mat<_T>& _Y) const
+		{
+			_Y.set_size(this->N_, _X.n_cols);
+			for (arma::uword c = 0; c < _X.n_cols; ++c)
+			{
+				const arma::Col<_T> _x(const_cast<_T*>(_X.colptr(c)), this->N_, false, true);
+				arma::Col<_T> _y(_Y.colptr(c), this->N_, false, true);
+				this->apply(_x, _y);
+			}
+		}
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Adds the operator to the dense matrix. Only the nonzero elements of the blocks are visited (N * dA per term),
+		* each column is written by a single thread.
+		*/
+		template <typename _T>
+		inline void KronOperator<_T>::addTo(arma::Mat<_T>& _M) const
+		{
+			if (_M.n_rows != this->N_ || _M.n_cols != this->N_)
+				throw std::invalid_argument("KronOperator: wrong size of the matrix, " + VEQ(_M.n_rows) + "," + VEQ(this->N_));
+
+			for (auto _it = this->S_.begin(); _it != this->S_.end(); ++_it)
+				_M(_it.row(), _it.col()) += *_it;
+
+			for (const auto& _t : this->terms_)
+			{
+				const u64 _dA		= _t.dA();
+				const u64 _block	= _t.block();
+#ifndef _DEBUG
+#	pragma omp parallel for schedule(static)
+#endif
+				for (long long _col = 0; _col < (long long)this->N_; ++_col)
+				{
+					const u64 l		= (u64)_col / _block;
+					const u64 _off	= l * _block;
+					const u64 b		= ((u64)_col - _off) / _t.R_;
+					const u64 r		= ((u64)_col - _off) % _t.R_;
+					const auto& _A	= _t.factor(l);
+					for (u64 a = 0; a < _dA; ++a)
+						_M(_off + a * _t.R_ + r, _col) += _t.c_ * _A(a, b);
+				}
+			}
+		}
+
+		/*
+		* @brief Dense matrix of the operator
+		*/
+		template <typename _T>
+		inline arma::Mat<_T> KronOperator<_T>::dense() const
+		{
+			arma::Mat<_T> _M(this->N_, this->N_, arma::fill::zeros);
+			this->addTo(_M);
+			return _M;
+		}
+
+		/*
+		* @brief Sparse matrix of the operator - built column by column with the threaded builder
+		*/
+		template <typename _T>
+		inline arma::SpMat<_T> KronOperator<_T>::sparse() const
+		{
+			return Builder::sparse<_T>(this->N_, this->N_, [&](u64 _col, std::vector<std::pair<u64, _T>>& _out)
+				{
+					for (auto _it = this->S_.begin_col(_col); _it != this->S_.end_col(_col); ++_it)
+						_out.emplace_back(_it.row(), *_it);
+					for (const auto& _t : this->terms_)
+					{
+						const u64 _block	= _t.block();
+						const u64 l			= _col / _block;
+						const u64 _off		= l * _block;
+						const u64 b			= (_col - _off) / _t.R_;
+						const u64 r			= (_col - _off) % _t.R_;
+						const auto& _A		= _t.factor(l);
+						for (u64 a = 0; a < _t.dA(); ++a)
+							if (_A(a, b) != _T(0.0))
+								_out.emplace_back(_off + a * _t.R_ + r, _t.c_ * _A(a, b));
+					}
+				});
+		}
+	};
+};
+
+#endif // !KRON_OPERATOR_H
@@ -0,0 +1,136 @@
+#pragma once
+/***********************************
+* Defines the buffer of the local
+* connections of a single lattice site
+* emitted by the Hamiltonian for the
+* variational Monte Carlo. Allows to
+* evaluate the local energy without
+* type-erased callbacks.
+***********************************/
+
+#ifndef LOCAL_CONNECTIONS_H
+#define LOCAL_CONNECTIONS_H
+
+#include <vector>
+#include <complex>
+
+constexpr unsigned LOCEN_MAX_FLIPS	= 2;											// maximal number of flips in a single connection
+constexpr unsigned LOCEN_RESERVE	= 16;											// initial capacity of the buffer
+
+/*
+* @brief Single off-diagonal connection <s'|H|s> = c_, where s' is obtained from s by flipping n_ sites fP_
+* (with the values before the flip fV_).
+*/
+struct LocEnConn
+{
+	unsigned n_							= 0;										// number of the flips
+	int fP_[LOCEN_MAX_FLIPS]			= {};										// flipped sites
+	double fV_[LOCEN_MAX_FLIPS]			= {};										// values at the sites before the flip
+	std::complex<double> c_				= 0.0;										// matrix element
+};
+
+/*
+* @brief Buffer of the connections of a single site - the diagonal part and the list of the flips. The storage only grows,
+* therefore, after the first few calls no allocation takes place. Each thread shall own its buffer.
+*/
+class LocEnBuffer
+{
+protected:
+	std::complex<double> diag_			= 0.0;										// diagonal part of the local energy
+	std::vector<LocEnConn> conn_;													// storage of the connections
+	size_t size_						= 0;										// number of the used connections
+	bool offDiag_						= false;									// only the flips are requested (the diagonal is evaluated once per configuration)
+
+	auto next()							-> LocEnConn&
+	{
+		if (this->size_ == this->conn_.size())
+			this->conn_.emplace_back();
+		return this->conn_[this->size_++];
+	}
+
+public:
+	LocEnBuffer()														{ this->conn_.reserve(LOCEN_RESERVE);	};
+
+	auto clear()						-> void							{ this->diag_ = 0.0; this->size_ = 0;	};
+	auto size()							const -> size_t					{ return this->size_;					};
+	auto diag()							const -> std::complex<double>	{ return this->diag_;					};
+	auto operator[](size_t i)			const -> const LocEnConn&		{ return this->conn_[i];				};
+	auto addDiag(std::complex<double> _v) -> void						{ this->diag_ += _v;					};
+	auto offDiagOnly()					const -> bool					{ return this->offDiag_;				};
+	auto setOffDiagOnly(bool _o)		-> void							{ this->offDiag_ = _o;					};
+
+	/*
+	* @brief Adds the connection with a single flip
+	* @param _i flipped site
+	* @param _vi value at the site before the flip
+	* @param _c matrix element
+	*/
+	auto add(int _i, double _vi, std::complex<double> _c) -> void
+	{
+		auto& _conn		= this->next();
+		_conn.n_		= 1;
+		_conn.fP_[0]	= _i;
+		_conn.fV_[0]	= _vi;
+		_conn.c_		= _c;
+	}
+
+	/*
+	* @brief Adds the connection with two flips
+	* @param _i, _j flipped sites
+	* @param _vi, _vj values at the sites before the flip
+	* @param _c matrix element
+	*/
+	auto add(int _i, int _j, double _vi, double _vj, std::complex<double> _c) -> void
+	{
+		auto& _conn		= this->next();
+		_conn.n_		= 2;
+		_conn.fP_[0]	= _i;
+		_conn.fP_[1]	= _j;
+		_conn.fV_[0]	= _vi;
+		_conn.fV_[1]	= _vj;
+		_conn.c_		= _c;
+	}
+
+	/*
+	* @brief Appends the connections (and the diagonal part) of the other buffer - allows to gather the connections
+	* of all the sites into a single list
+	* @param _other buffer to be appended
+	*/
+	auto append(const LocEnBuffer& _other) -> void
+	{
+		this->diag_ += _other.diag_;
+		for (size_t k = 0; k < _other.size_; ++k)
+			this->next() = _other.conn_[k];
+	}
+
+	/*
+	* @brief Evaluates diag + \sum _k c_k r_k with the ratios already calculated (e.g. in a batch)
+	* @param _ratios container with the ratios in the order of the connections
+	*/
+	template <typename _V>
+	auto contract(const _V& _ratios)	const -> std::complex<double>
+	{
+		std::complex<double> _en = this->diag_;
+		for (size_t k = 0; k < this->size_; ++k)
+			_en += this->conn_[k].c_ * std::complex<double>(_ratios[k]);
+		return _en;
+	}
+
+	/*
+	* @brief Evaluates diag + \sum _k c_k r(k), where r is the ratio of the amplitudes for the connection
+	* @param _ratio callable returning the ratio for the connection
+	*/
+	template <typename _R>
+	auto evaluate(_R&& _ratio)			const -> std::complex<double>
+	{
+		std::complex<double> _en = this->diag_;
+		for (size_t k = 0; k < this->size_; ++k)
+			_en += this->conn_[k].c_ * _ratio(this->conn_[k]);
+		return _en;
+	}
+};
+
+// list of the connections of many sites (the same storage)
+using ConnList = LocEnBuffer;
+
+#endif // !LOCAL_CONNECTIONS_H
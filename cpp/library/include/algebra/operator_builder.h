@@ -0,0 +1,173 @@
+#pragma once
+/***********************************
+* Defines the threaded builder of the
+* operator matrices. The columns are
+* produced independently (each one by
+* the action on a single basis state),
+* collected into the per-chunk triplet
+* buffers and merged into CSC by column.
+***********************************/
+
+#ifndef OPERATOR_BUILDER_H
+#define OPERATOR_BUILDER_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <omp.h>
+
+constexpr u64 OPERATOR_BUILD_PARALLEL_MIN				= 0x1000;					// minimal number of the columns for the threaded build
+constexpr unsigned OPERATOR_BUILD_CHUNKS				= 8;						// number of the column chunks per thread (load balance)
+
+namespace Operators
+{
+	namespace Builder
+	{
+		/*
+		* @brief Sorts the column by the rows, sums the repeating rows and removes the elements that cancelled out
+		* @param _col column (row, value) - modified
+		*/
+		template <typename _T>
+		inline void mergeColumn(std::vector<std::pair<u64, _T>>& _col)
+		{
+			if (_col.size() > 1)
+			{
+				std::sort(_col.begin(), _col.end(), [](const auto& _a, const auto& _b) { return _a.first < _b.first; });
+				size_t _last = 0;
+				for (size_t i = 1; i < _col.size(); ++i)
+				{
+					if (_col[i].first == _col[_last].first)
+						_col[_last].second += _col[i].second;
+					else
+						_col[++_last] = _col[i];
+				}
+				_col.resize(_last + 1);
+			}
+			_col.erase(std::remove_if(_col.begin(), _col.end(), [](const auto& _e) { return _e.second == _T(0.0); }), _col.end());
+		}
+
+		/*
+		* @brief Number of the threads used for the build of _nCols columns
+		*/
+		inline int threads(u64 _nCols)
+		{
+			return _nCols < OPERATOR_BUILD_PARALLEL_MIN ? 1 : omp_get_max_threads();
+		}
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Builds the sparse matrix column by column. The columns are split into contiguous chunks claimed dynamically by
+		* the threads, each chunk collects its (already column ordered) triplets into its own buffer, therefore, the merge
+		* is a prefix sum of the column counts and a parallel copy of the buffers - no locking and no shared insertion.
+		* @param _nRows number of the rows
+		* @param _nCols number of the columns
+		* @param _colFun callable (u64 col, std::vector<std::pair<u64, _T>>& out) appending the elements of the column (in any order, may repeat)
+		* @returns the sparse matrix in the CSC format
+		*/
+		template <typename _T, typename _F>
+		inline arma::SpMat<_T> sparse(u64 _nRows, u64 _nCols, _F&& _colFun)
+		{
+			using _el			= std::pair<u64, _T>;
+			const int _thr		= threads(_nCols);
+			const u64 _nChunks	= std::max<u64>(1, std::min<u64>(_nCols, (u64)_thr * OPERATOR_BUILD_CHUNKS));
+			const u64 _chunk	= (_nCols + _nChunks - 1) / std::max<u64>(_nChunks, 1);
+
+			arma::uvec _colPtr(_nCols + 1, arma::fill::zeros);
+			std::vector<std::vector<arma::uword>> _rows(_nChunks);
+			std::vector<std::vector<_T>> _vals(_nChunks);
+
+			// ---------------- collect the chunks ----------------
+#ifndef _DEBUG
+#	pragma omp parallel num_threads(_thr)
+#endif
+			{
+				std::vector<_el> _col;
+#ifndef _DEBUG
+#	pragma omp for schedule(dynamic, 1)
+#endif
+				for (long long c = 0; c < (long long)_nChunks; ++c)
+				{
+					const u64 _c0	= (u64)c * _chunk;
+					const u64 _c1	= std::min<u64>(_c0 + _chunk, _nCols);
+					for (u64 k = _c0; k < _c1; ++k)
+					{
+						_col.clear();
+						_colFun(k, _col);
+						mergeColumn(_col);
+						_colPtr(k + 1)	= _col.size();
+						for (const auto& [_row, _val] : _col)
+						{
+							_rows[c].push_back((arma::uword)_row);
+							_vals[c].push_back(_val);
+						}
+					}
+				}
+			}
+
+			// ---------------- merge into CSC --------------------
+			for (u64 k = 0; k < _nCols; ++k)
+				_colPtr(k + 1) += _colPtr(k);
+			const u64 _nnz		= _colPtr(_nCols);
+			arma::uvec _rowInd(_nnz);
+			arma::Col<_T> _values(_nnz);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_thr)
+#endif
+			for (long long c = 0; c < (long long)_nChunks; ++c)
+			{
+				const u64 _c0	= std::min<u64>((u64)c * _chunk, _nCols);
+				const u64 _off	= _colPtr(_c0);
+				std::copy(_rows[c].begin(), _rows[c].end(), _rowInd.begin() + _off);
+				std::copy(_vals[c].begin(), _vals[c].end(), _values.begin() + _off);
+			}
+			return arma::SpMat<_T>(_rowInd, _colPtr, _values, _nRows, _nCols, false);
+		}
+
+		/*
+		* @brief Fills the dense matrix column by column - each column is written by a single thread
+		* @param _M matrix (already allocated and zeroed)
+		* @param _colFun callable as in sparse
+		*/
+		template <typename _T, typename _F>
+		inline void dense(arma::Mat<_T>& _M, _F&& _colFun)
+		{
+			const int _thr		= threads(_M.n_cols);
+#ifndef _DEBUG
+#	pragma omp parallel num_threads(_thr)
+#endif
+			{
+				std::vector<std::pair<u64, _T>> _col;
+#ifndef _DEBUG
+#	pragma omp for schedule(dynamic, 256)
+#endif
+				for (long long k = 0; k < (long long)_M.n_cols; ++k)
+				{
+					_col.clear();
+					_colFun((u64)k, _col);
+					for (const auto& [_row, _val] : _col)
+						_M(_row, k) += _val;
+				}
+			}
+		}
+
+		/*
+		* @brief Builds the matrix of the requested type (arma::Mat or arma::SpMat)
+		*/
+		template <typename _MatT, typename _F>
+		inline _MatT build(u64 _nRows, u64 _nCols, _F&& _colFun)
+		{
+			using _T = typename _MatT::elem_type;
+			if constexpr (std::is_same_v<_MatT, arma::SpMat<_T>>)
+				return sparse<_T>(_nRows, _nCols, std::forward<_F>(_colFun));
+			else
+			{
+				_MatT _M(_nRows, _nCols, arma::fill::zeros);
+				dense(_M, std::forward<_F>(_colFun));
+				return _M;
+			}
+		}
+	};
+};
+
+#endif // !OPERATOR_BUILDER_H
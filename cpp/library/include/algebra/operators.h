@@ -59,6 +59,7 @@ namespace Operators
 
 #include "operators/operator_spins.hpp"
 #include "operators/operator_quadratic.hpp"
+#include "operators/operator_fused.hpp"
 
 namespace Operators
 {
@@ -134,15 +135,107 @@ namespace Operators
 		return _eigvecs.t() * (_mat * _eigvecs);
 	}
 
+	/*
+	* @brief Applies the overlap between all the states in the matrix. The sparse operator acts first (O V costs nnz(O) * Nh), 
+	* so that only a single dense product V^+ (O V) is left. For the real operator and complex states, the real and imaginary 
+	* parts of V are multiplied separately, which avoids the complex copy of the operator.
+	* @param _eigvecs the eigenvectors matrix
+	* @param _mat the many body matrix
+	* @returns the overlap matrix
+	*/
 	template<typename _T, typename _T2>
 	inline arma::Mat<_T> applyOverlapMat(const arma::Mat<_T>& _eigvecs, const GeneralizedMatrix<_T2>& _mat)
 	{
+		auto _apply = [&](const auto& _M) -> arma::Mat<_T>
+			{
+				if constexpr (std::is_same_v<_T, _T2>)
+					return _M * _eigvecs;
+				else
+					return arma::Mat<_T>(_M * arma::real(_eigvecs), _M * arma::imag(_eigvecs));
+			};
 		if (_mat.isSparse())
-			return _eigvecs.t() * (arma::SpMat<_T2>(_mat.getSparse()) * _eigvecs);
+			return _eigvecs.t() * _apply(_mat.getSparse());
 		else
-			return _eigvecs.t() * (_mat.getDense() * _eigvecs);
+			return _eigvecs.t() * _apply(_mat.getDense());
 	}
 
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Cache of the operators transformed to the eigenbasis V^+OV for a single realization. The measurements of the 
+	* same realization that read the operator more than once (the diagonal ensemble and the time evolution) ask the cache instead of 
+	* transforming the operator on their own. When all of the operators do not fit in the memory budget, the slot is freed 
+	* after the caller releases it - then the cache only ensures that the transformation is done once per use.
+	* Different slots may be requested from different threads concurrently (each slot is owned by a single operator).
+	*/
+	template <typename _T>
+	class OverlapCache
+	{
+	protected:
+		u64 tag_									= UINT64_MAX;								// realization the cache is valid for
+		bool keep_									= true;										// shall keep the matrices after the release?
+		v_1d<arma::Mat<_T>> mats_					= {};
+		v_1d<uint8_t> done_							= {};
+	public:
+		/*
+		* @brief Invalidates the cache when the realization changes
+		* @param _n number of operators
+		* @param _Nh dimension of the eigenbasis
+		* @param _tag identifier of the realization (eigenbasis)
+		* @param _budget memory budget for keeping all of the matrices [bytes]
+		*/
+		auto reset(size_t _n, u64 _Nh, u64 _tag, u64 _budget = u64(1) << 32) -> void
+		{
+			if (_tag == this->tag_ && _n == this->mats_.size())
+				return;
+			this->tag_								= _tag;
+			this->keep_								= _n * _Nh * _Nh * sizeof(_T) <= _budget;
+			this->mats_								= v_1d<arma::Mat<_T>>(_n);
+			this->done_								= v_1d<uint8_t>(_n, 0);
+		}
+
+		/*
+		* @brief Returns the operator in the eigenbasis, transforms it if not yet done
+		* @param i index of the operator
+		* @param _eigvecs eigenvectors as columns
+		* @param _mat operator matrix
+		*/
+		template <typename _M>
+		auto get(size_t i, const arma::Mat<_T>& _eigvecs, const _M& _mat) -> const arma::Mat<_T>&
+		{
+			if (!this->done_[i])
+			{
+				this->mats_[i]						= applyOverlapMat(_eigvecs, _mat);
+				this->done_[i]						= 1;
+			}
+			return this->mats_[i];
+		}
+
+		/*
+		* @brief Releases the slot - frees the memory unless all of the matrices fit in the budget
+		*/
+		auto release(size_t i) -> void
+		{
+			if (this->keep_)
+				return;
+			this->mats_[i].reset();
+			this->done_[i]							= 0;
+		}
+
+		/*
+		* @brief Frees all of the slots once the realization is done (the next reset transforms them again)
+		*/
+		auto clear() -> void
+		{
+			this->tag_								= UINT64_MAX;
+			this->mats_.clear();
+			this->done_.clear();
+		}
+
+		auto has(size_t i)							const -> bool								{ return i < this->done_.size() && this->done_[i];	};
+		auto isKept()								const -> bool								{ return this->keep_;								};
+	};
+
 	// _____________________________________________________________________________________________________________________________
 
 	template<typename _M, typename _Ct>
@@ -0,0 +1,146 @@
+#pragma once
+
+/***********************************
+* Defines the process-wide cache of the
+* operator matrices. The operators created
+* from the parsed strings never depend on
+* the disorder, therefore, their matrices
+* are built once per (operator, Hilbert
+* space sector) and reused by all the
+* realizations and stages of the run
+* (e.g. the parameters of the sweeps).
+* The cache and the measurements share
+* the same matrix, nothing is copied.
+***********************************/
+
+#ifndef OPERATOR_CACHE_H
+#define OPERATOR_CACHE_H
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+
+namespace Operators
+{
+	namespace Cache
+	{
+		constexpr size_t OPERATOR_CACHE_MAX_BYTES	= 1ULL << 32;							// memory budget of the cached matrices (oldest evicted first)
+
+		/*
+		* @brief Memory of the matrix (the sparse one - values and the row indices)
+		*/
+		template <typename _T>
+		inline auto bytes(const GeneralizedMatrix<_T>& _M) -> size_t
+		{
+			if (_M.isSparse())
+				return (size_t)_M.getSparse().n_nonzero * (sizeof(_T) + sizeof(arma::uword));
+			return (size_t)_M.getDense().n_elem * sizeof(_T);
+		}
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Matrices of the operators keyed by their signature (see OperatorNameParser::signature) and the sector of the Hilbert space.
+		* The matrices are immutable and shared with the callers, the eviction only drops the reference of the cache. The matrix is built
+		* outside of the lock, so the first call of a given key may build it twice when run concurrently - the result is the same.
+		*/
+		template <typename _T>
+		class MatrixCache
+		{
+		public:
+			using MatrixPtr							= std::shared_ptr<const GeneralizedMatrix<_T>>;
+
+		private:
+			mutable std::mutex mutex_;
+			std::map<std::string, MatrixPtr> mats_;
+			std::deque<std::string> order_;											// insertion order for the eviction
+			size_t bytes_							= 0;
+			size_t budget_							= OPERATOR_CACHE_MAX_BYTES;
+			size_t hits_							= 0;
+			size_t misses_							= 0;
+
+			MatrixCache()							= default;
+
+			auto evict() -> void
+			{
+				while (this->bytes_ > this->budget_ && !this->order_.empty())
+				{
+					auto _it						= this->mats_.find(this->order_.front());
+					this->bytes_					-= bytes(*_it->second);
+					this->mats_.erase(_it);
+					this->order_.pop_front();
+				}
+			}
+
+		public:
+			MatrixCache(const MatrixCache&)			= delete;
+			MatrixCache& operator=(const MatrixCache&) = delete;
+
+			static auto instance() -> MatrixCache&	{ static MatrixCache _cache; return _cache; };
+
+			/*
+			* @brief Returns the cached matrix or builds it with _build (the empty key disables the cache)
+			* @param _key signature of the operator and the sector of the Hilbert space
+			* @param _build builder of the matrix, called on the miss only
+			* @returns the shared matrix
+			*/
+			template <typename _F>
+			auto get(const std::string& _key, _F&& _build) -> MatrixPtr
+			{
+				if (_key.empty())
+					return std::make_shared<const GeneralizedMatrix<_T>>(_build());
+				{
+					std::lock_guard<std::mutex> _lock(this->mutex_);
+					if (auto _it = this->mats_.find(_key); _it != this->mats_.end())
+					{
+						this->hits_++;
+						return _it->second;
+					}
+					this->misses_++;
+				}
+
+				MatrixPtr _M						= std::make_shared<const GeneralizedMatrix<_T>>(_build());
+				std::lock_guard<std::mutex> _lock(this->mutex_);
+				if (auto _it = this->mats_.find(_key); _it != this->mats_.end())
+					return _it->second;
+				if (bytes(*_M) <= this->budget_)
+				{
+					this->bytes_					+= bytes(*_M);
+					this->mats_.emplace(_key, _M);
+					this->order_.push_back(_key);
+					this->evict();
+				}
+				return _M;
+			}
+
+			auto clear() -> void
+			{
+				std::lock_guard<std::mutex> _lock(this->mutex_);
+				this->mats_.clear();
+				this->order_.clear();
+				this->bytes_						= 0;
+			}
+
+			auto setBudget(size_t _bytes) -> void
+			{
+				std::lock_guard<std::mutex> _lock(this->mutex_);
+				this->budget_						= _bytes;
+				this->evict();
+			}
+
+			// ############ GETTERS ############
+
+			auto size()								const -> size_t						{ std::lock_guard<std::mutex> _lock(this->mutex_); return this->mats_.size();	};
+			auto memory()							const -> size_t						{ std::lock_guard<std::mutex> _lock(this->mutex_); return this->bytes_;			};
+			auto hits()								const -> size_t						{ std::lock_guard<std::mutex> _lock(this->mutex_); return this->hits_;			};
+			auto misses()							const -> size_t						{ std::lock_guard<std::mutex> _lock(this->mutex_); return this->misses_;		};
+		};
+
+		template <typename _T>
+		inline auto matrices() -> MatrixCache<_T>&									{ return MatrixCache<_T>::instance(); };
+	};
+};
+
+#endif // !OPERATOR_CACHE_H
@@ -0,0 +1,389 @@
+/***********************************
+* Defines the fused kernels of the
+* Pauli string operators. A product of
+* the Pauli matrices is stored as the
+* X and Z bitmasks with a phase, so its
+* action on a basis state is a single
+* XOR and a parity of the popcount,
+* instead of the chain of std::function
+* calls - one per factor.
+***********************************/
+
+#ifndef OPERATOR_FUSED_H
+#define OPERATOR_FUSED_H
+
+#include <bit>
+#include <map>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Operators
+{
+	namespace Fused
+	{
+		/*
+		* @brief Product of the Pauli matrices P = c * i^k * X^x Z^z, with X^x (Z^z) the product of sigma_x (sigma_z) on the set bits of x (z).
+		* The bits are counted from the left as everywhere in the operators - site i lives on the bit Ns - 1 - i. As sigma_y = i sigma_x sigma_z,
+		* the string is closed under the multiplication and its action on |s> reads
+		*					P|s> = c * i^k * (-1)^{popcount(z & ~s)} |s ^ x>,
+		* where the sigma_z eigenvalue is +1 on the set bit (as in SpinOperators::sig_z).
+		*/
+		struct PauliMask
+		{
+			u64 x_						= 0;												// flipped bits
+			u64 z_						= 0;												// bits measured by sigma_z
+			uint k_						= 0;												// phase i^k (mod 4)
+			double c_					= 1.0;												// prefactor (spin normalization of the factors)
+
+			// ---------------------------------------------------------------------------------------------------------------------------------
+
+			/*
+			* @brief Multiplies the string from the right by the single-site factor - P <- P * sigma_a(pos)
+			* @param _a type of the factor ('x', 'y', 'z' or 'i' for the identity)
+			* @param _pos bit position of the factor
+			* @param _c prefactor of the factor (e.g. the spin 1/2)
+			*/
+			constexpr auto mul(char _a, uint _pos, double _c = 1.0) -> PauliMask&
+			{
+				const u64 _b		= 1ULL << _pos;
+				switch (_a)
+				{
+				case 'x': case 'X':
+					this->k_		+= (this->z_ & _b) ? 2 : 0;
+					this->x_		^= _b;
+					break;
+				case 'y': case 'Y':
+					this->k_		+= (this->z_ & _b) ? 3 : 1;
+					this->x_		^= _b;
+					this->z_		^= _b;
+					break;
+				case 'z': case 'Z':
+					this->z_		^= _b;
+					break;
+				default:
+					return *this;
+				}
+				this->k_			&= 3;
+				this->c_			*= _c;
+				return *this;
+			}
+
+			// ---------------------------------------------------------------------------------------------------------------------------------
+
+			constexpr auto isReal()					const -> bool			{ return (this->k_ & 1) == 0;								};
+			constexpr auto isDiagonal()				const -> bool			{ return this->x_ == 0;										};
+			constexpr auto actOn()					const -> u64			{ return this->x_ | this->z_;								};
+
+			/*
+			* @brief Sign (-1)^{popcount(z & ~s)} of the string on the basis state
+			*/
+			constexpr auto sign(u64 _s)				const -> double			{ return (std::popcount(this->z_ & ~_s) & 1) ? -1.0 : 1.0;	};
+
+			/*
+			* @brief Phase i^k times the prefactor - complex for the odd number of the sigma_y (throws for such a string under the real type)
+			*/
+			template <typename _T>
+			constexpr auto phase()					const -> _T
+			{
+				if constexpr (std::is_same_v<_T, cpx>)
+				{
+					constexpr cpx _ik[4] = { cpx(1.0, 0.0), cpx(0.0, 1.0), cpx(-1.0, 0.0), cpx(0.0, -1.0) };
+					return this->c_ * _ik[this->k_];
+				}
+				else
+				{
+					if (!this->isReal())
+						throw std::invalid_argument("The Pauli string is imaginary - use the complex operator.");
+					return this->c_ * ((this->k_ & 2) ? -1.0 : 1.0);
+				}
+			}
+
+			/*
+			* @brief Action on the basis state - one XOR and one popcount
+			* @param _s basis state
+			* @param _phase phase of the string (see phase), precomputed once
+			*/
+			template <typename _T>
+			constexpr auto apply(u64 _s, _T _phase)	const -> std::pair<u64, _T> { return std::make_pair(_s ^ this->x_, this->sign(_s) * _phase); };
+
+			/*
+			* @brief Sign of the string on the vector state - only the sites measured by sigma_z are touched
+			* @param _s vector state
+			* @param _Ns number of the sites
+			*/
+			auto sign(_OP_V_T_CR _s, size_t _Ns)	const -> double
+			{
+				double _sgn			= 1.0;
+				for (u64 _m = this->z_; _m; _m &= _m - 1)
+					if (!Binary::check(_s, (uint)(_Ns - 1 - std::countr_zero(_m))))
+						_sgn		= -_sgn;
+				return _sgn;
+			}
+
+			/*
+			* @brief Vector state with the bits of x flipped
+			*/
+			auto flipped(_OP_V_T_CR _s, size_t _Ns)	const -> _OP_V_T
+			{
+				_OP_V_T _out		= _s;
+				for (u64 _m = this->x_; _m; _m &= _m - 1)
+					flip(_out, (uint)(_Ns - 1 - std::countr_zero(_m)), Operators::_SPIN);
+				return _out;
+			}
+
+			/*
+			* @brief Action on the vector state - only the sites of the string are touched
+			* @param _s vector state
+			* @param _Ns number of the sites
+			* @param _phase phase of the string (see phase)
+			*/
+			template <typename _T>
+			auto apply(_OP_V_T_CR _s, size_t _Ns, _T _phase) const -> std::pair<_OP_V_T, _T> { return std::make_pair(this->flipped(_s, _Ns), this->sign(_s, _Ns) * _phase); };
+		};
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Builds the string at runtime (e.g. for the operators created by the parser)
+		* @param _Ns number of the sites
+		* @param _types types of the factors ("xzy..."), one per site
+		* @param _sites sites of the factors (in the order of the multiplication)
+		* @param _c prefactor of each factor
+		*/
+		inline auto mask(size_t _Ns, const std::string& _types, const v_1d<uint>& _sites, double _c = Operators::_SPIN) -> PauliMask
+		{
+			if (_types.size() != 1 && _types.size() != _sites.size())
+				throw std::invalid_argument("The number of the Pauli factors does not match the number of the sites.");
+			PauliMask _out;
+			for (size_t i = 0; i < _sites.size(); ++i)
+				_out.mul(_types.size() == 1 ? _types[0] : _types[i], (uint)(_Ns - 1 - _sites[i]), _c);
+			return _out;
+		}
+
+		/*
+		* @brief Compile-time pattern of the Pauli string (e.g. Pattern<'z', 'z'> for sigma_z_i sigma_z_j). The factors are expanded by the
+		* fold expression, so the masks at given sites are built inline in the kernel itself (a few shifts) and no call is made per factor.
+		*/
+		template <char... _P>
+		struct Pattern
+		{
+			static_assert(sizeof...(_P) > 0, "The Pauli string shall have at least one factor.");
+			static_assert(((_P == 'x' || _P == 'y' || _P == 'z' || _P == 'i') && ...), "Unknown Pauli factor.");
+			static constexpr size_t N	= sizeof...(_P);
+			static constexpr uint NY	= ((_P == 'y' ? 1u : 0u) + ...);
+
+			/*
+			* @brief String at the given sites
+			*/
+			template <typename... _Sites>
+			static constexpr auto mask(size_t _Ns, _Sites... _s) -> PauliMask
+			{
+				static_assert(sizeof...(_Sites) == N, "One site per Pauli factor.");
+				PauliMask _out;
+				(_out.mul(_P, (uint)(_Ns - 1 - _s), Operators::_SPIN), ...);
+				return _out;
+			}
+
+			/*
+			* @brief Fused kernel - the masks are built in registers and the string is applied at once
+			*/
+			template <typename _T, typename... _Sites>
+			static constexpr auto apply(u64 _st, size_t _Ns, _Sites... _s) -> std::pair<u64, _T>
+			{
+				const PauliMask _m = mask(_Ns, _s...);
+				return _m.apply<_T>(_st, _m.phase<_T>());
+			}
+		};
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Checks whether the string can be represented in the type of the operator (the odd number of sigma_y is purely imaginary)
+		*/
+		template <typename _T>
+		inline void checkType(const PauliMask& _m)
+		{
+			if constexpr (!std::is_same_v<_T, cpx>)
+				if (!_m.isReal())
+					throw std::invalid_argument("The Pauli string is imaginary - use the complex operator.");
+		}
+
+		/*
+		* @brief Creates the global operator from the (runtime) string - a single call per basis state
+		* @param _Ns number of the sites
+		* @param _m the string
+		* @param _name name of the generator
+		*/
+		template <typename _T>
+		inline Operators::Operator<_T> make(size_t _Ns, const PauliMask& _m, SymGenerators _name = SymGenerators::OTHER)
+		{
+			checkType<_T>(_m);
+			const _T _phase		= _m.phase<_T>();
+			_GLB<_T> fun_		= [_m, _phase](u64 _s) { return _m.apply<_T>(_s, _phase); };
+			_GLB_V<_T> funV_	= [_m, _phase, _Ns](_OP_V_T_CR _s) { return _m.apply<_T>(_s, _Ns, _phase); };
+			Operator<_T> _op(_Ns, 1.0, fun_, funV_, _name);
+			_op.setActOn(_m.actOn());
+			return _op;
+		}
+
+		/*
+		* @brief Creates the local operator sigma_a(i) with the site as the argument
+		*/
+		template <typename _T, char _P>
+		inline Operators::Operator<_T, uint> local(size_t _Ns, SymGenerators _name = SymGenerators::OTHER)
+		{
+			using _Pat			= Pattern<_P>;
+			static_assert(std::is_same_v<_T, cpx> || _Pat::NY % 2 == 0, "The Pauli string is imaginary - use the complex operator.");
+			_LOC<_T> fun_		= [_Ns](u64 _s, uint _i) { return _Pat::template apply<_T>(_s, _Ns, _i); };
+			_LOC_V<_T> funV_	= [_Ns](_OP_V_T_CR _s, uint _i) { const PauliMask _m = _Pat::mask(_Ns, _i); return _m.apply<_T>(_s, _Ns, _m.phase<_T>()); };
+			Operator<_T, uint> _op(_Ns, 1.0, fun_, funV_, _name);
+			_op.setPauli(std::string{ _P });
+			return _op;
+		}
+
+		/*
+		* @brief Creates the correlation operator sigma_a(i) sigma_b(j) with the sites as the arguments - the kernel of the
+		* correlation matrices over all the pairs (i, j), each element costs a single XOR and a popcount
+		*/
+		template <typename _T, char _P1, char _P2>
+		inline Operators::Operator<_T, uint, uint> correlation(size_t _Ns, SymGenerators _name = SymGenerators::OTHER)
+		{
+			using _Pat			= Pattern<_P1, _P2>;
+			static_assert(std::is_same_v<_T, cpx> || _Pat::NY % 2 == 0, "The Pauli string is imaginary - use the complex operator.");
+			_INP<_T, uint, uint> fun_		= [_Ns](u64 _s, uint _i, uint _j) { return _Pat::template apply<_T>(_s, _Ns, _i, _j); };
+			_INP_V<_T, uint, uint> funV_	= [_Ns](_OP_V_T_CR _s, uint _i, uint _j) { const PauliMask _m = _Pat::mask(_Ns, _i, _j); return _m.apply<_T>(_s, _Ns, _m.phase<_T>()); };
+			Operator<_T, uint, uint> _op(_Ns, 1.0, fun_, funV_, _name);
+			_op.setPauli(std::string{ _P1, _P2 });
+			return _op;
+		}
+
+		/*
+		* @brief Creates the global operator from the compile-time pattern at the given sites
+		*/
+		template <typename _T, char... _P, typename... _Sites>
+		inline Operators::Operator<_T> global(size_t _Ns, _Sites... _s)
+		{
+			static_assert(std::is_same_v<_T, cpx> || Pattern<_P...>::NY % 2 == 0, "The Pauli string is imaginary - use the complex operator.");
+			return make<_T>(_Ns, Pattern<_P...>::mask(_Ns, (uint)_s...));
+		}
+
+		// ##########################################################################################################################################
+
+		// ############################################################# B A T C H E D ##############################################################
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Strings of the correlation matrix sigma_a(i) sigma_b(j) for all the pairs - stored column-wise (i + Ns * j, as arma::Mat)
+		*/
+		inline auto correlationStrings(size_t _Ns, char _a, char _b) -> v_1d<PauliMask>
+		{
+			v_1d<PauliMask> _out;
+			_out.reserve(_Ns * _Ns);
+			for (uint j = 0; j < _Ns; ++j)
+				for (uint i = 0; i < _Ns; ++i)
+				{
+					PauliMask _m;
+					_m.mul(_a, (uint)(_Ns - 1 - i), Operators::_SPIN).mul(_b, (uint)(_Ns - 1 - j), Operators::_SPIN);
+					_out.push_back(_m);
+				}
+			return _out;
+		}
+
+		/*
+		* @brief Groups the strings by their X mask - the strings of a group connect the same pairs of the basis states, therefore,
+		* they are evaluated from the same amplitudes (all the diagonal strings form a single group)
+		* @returns the indices of the strings, one vector per distinct X mask
+		*/
+		inline auto groups(const v_1d<PauliMask>& _P) -> v_1d<v_1d<size_t>>
+		{
+			std::map<u64, v_1d<size_t>> _g;
+			for (size_t i = 0; i < _P.size(); ++i)
+				_g[_P[i].x_].push_back(i);
+			v_1d<v_1d<size_t>> _out;
+			_out.reserve(_g.size());
+			for (auto& [_, _idx] : _g)
+				_out.push_back(std::move(_idx));
+			return _out;
+		}
+
+		/*
+		* @brief Expectation values <L|P|R> of many strings at once, without the matrices of the operators. Each group (see groups) is a single
+		* streaming pass over the basis: <L|P|R> = phase * sum_k conj(L(k ^ x)) R(k) (-1)^{popcount(z & ~k)}. The index of the vector is the
+		* basis state itself, i.e., the state shall live in the full Hilbert space.
+		* @param _psiL left state
+		* @param _psiR right state
+		* @param _P the strings
+		* @returns the expectation values in the order of _P
+		*/
+		template <typename _R, typename _C>
+		inline auto expectation(const _C& _psiL, const _C& _psiR, const v_1d<PauliMask>& _P) -> arma::Col<_R>
+		{
+			arma::Col<_R> _out(_P.size(), arma::fill::zeros);
+			const u64 _Nh		= _psiR.n_elem;
+			const int _thr		= Builder::threads(_Nh);
+
+			for (const auto& _g : groups(_P))
+			{
+				const u64 _x	= _P[_g[0]].x_;
+				arma::Col<_R> _acc(_g.size(), arma::fill::zeros);
+#ifndef _DEBUG
+#	pragma omp parallel num_threads(_thr)
+#endif
+				{
+					arma::Col<_R> _loc(_g.size(), arma::fill::zeros);
+#ifndef _DEBUG
+#	pragma omp for schedule(static)
+#endif
+					for (long long k = 0; k < (long long)_Nh; ++k)
+					{
+						const u64 _kx	= (u64)k ^ _x;
+						if (_kx >= _Nh)
+							continue;
+						const _R _a		= algebra::cast<_R>(algebra::conjugate(_psiL(_kx)) * _psiR(k));
+						for (size_t m = 0; m < _g.size(); ++m)
+							_loc(m)		+= _P[_g[m]].sign((u64)k) * _a;
+					}
+#ifndef _DEBUG
+#	pragma omp critical
+#endif
+					_acc		+= _loc;
+				}
+				for (size_t m = 0; m < _g.size(); ++m)
+					_out(_g[m])	= _acc(m) * _P[_g[m]].template phase<_R>();
+			}
+			return _out;
+		}
+
+		template <typename _R, typename _C>
+		inline auto expectation(const _C& _psi, const v_1d<PauliMask>& _P) -> arma::Col<_R> { return expectation<_R>(_psi, _psi, _P); };
+
+		/*
+		* @brief Local estimators of the strings in the NQS - sum_s' <s|P|s'> psi(s') / psi(s) = sign * phase * ratio(s ^ x). The probability
+		* ratio is evaluated once per group, the diagonal strings need no ratio at all.
+		* @param _s sampled (vector) state
+		* @param _Ns number of the sites
+		* @param _P the strings
+		* @param _groups groups of the strings (see groups)
+		* @param _ratio probability ratio psi(s') / psi(s) for the flipped state
+		* @returns the local estimators in the order of _P
+		*/
+		template <typename _R, typename _F>
+		inline auto estimators(_OP_V_T_CR _s, size_t _Ns, const v_1d<PauliMask>& _P, const v_1d<v_1d<size_t>>& _groups, _F&& _ratio) -> arma::Col<_R>
+		{
+			arma::Col<_R> _out(_P.size(), arma::fill::zeros);
+			for (const auto& _g : _groups)
+			{
+				const PauliMask& _m0	= _P[_g[0]];
+				const _R _r				= _m0.isDiagonal() ? _R(1.0) : algebra::cast<_R>(_ratio(_m0.flipped(_s, _Ns)));
+				for (auto i : _g)
+					_out(i)				= _P[i].sign(_s, _Ns) * _P[i].template phase<_R>() * _r;
+			}
+			return _out;
+		}
+	};
+};
+
+#endif // !OPERATOR_FUSED_H
@@ -82,6 +82,37 @@ namespace Operators
 
 	// ##########################################################################################################################################
 
+	/*
+	* @brief Intermediate form of the parsed operator string (e.g. Sz/0-1). The spin operators are kept as the Pauli string, which
+	* is compiled once into the fused kernel (see Fused::make), the quadratic ones as the list of their sites (bonds). The operators
+	* that do not involve any random coefficients have the signature, that keys their matrices in Cache::MatrixCache.
+	*/
+	struct CompiledOperator
+	{
+		OperatorTypes::OperatorsAvailable type_	= OperatorTypes::OperatorsAvailable::E;
+		std::string name_						= "";							// parsed (canonical) string
+		v_1d<long double> sites_				= { 0 };						// sites, momenta or the Hilbert space indices
+		bool usesHilbert_						= false;						// quadratic - acts on the single particle space
+		bool random_							= false;						// contains the random sites
+		bool isPauli_							= false;
+		Fused::PauliMask pauli_;												// string of the spin operators
+
+		// the operator does not depend on the random coefficients
+		auto cacheable()						const -> bool
+		{
+			switch (this->type_)
+			{
+			case OperatorTypes::OperatorsAvailable::SzR:
+			case OperatorTypes::OperatorsAvailable::SzRV:
+			case OperatorTypes::OperatorsAvailable::nr:
+				return false;
+			default:
+				return !this->random_;
+			}
+		}
+	};
+
+	// ##########################################################################################################################################
 
 	class OperatorNameParser
 	{
@@ -166,57 +197,45 @@ namespace Operators
 		// --------------------------------------------------------------------------------------------
 	public:
 
+		// compile the parsed string into the intermediate form
+		bool compile(const std::string& _input, CompiledOperator& _ir);
+
+		// signature of the operator matrix (empty if the operator cannot be cached)
+		std::string signature(const std::string& _input);
+
+		strVec signatures(const strVec& _inputs);
+
+		// --------------------------------------------------------------------------------------------
+
 		/*
-		* @brief Creates a global operator from the input string - this allows for its further usage in the calculations.
-		* (creating matrices, acting on states, etc.)
-		* @param _input the input string
+		* @brief Creates the operator from its compiled form
+		* @param _ir the compiled operator (see compile)
 		* @param _operator the operator to create
+		* @param _rgen random generator for the random operators
 		* @returns true if the operator was created successfully
 		*/
 		template <typename _T>
-		bool createGlobalOperator(const std::string& _input, std::shared_ptr<Operator<_T>>& _operator,
-				bool _usesRealAllowed 		= true,
-				bool _useHilbertAllowed 	= false,
-				randomGen* _rgen 			= nullptr)
+		bool build(const CompiledOperator& _ir, std::shared_ptr<Operator<_T>>& _operator, randomGen* _rgen = nullptr)
 		{
-			// resolve the operator and the sites based on the input
-			auto [op, sites] 		= this->resolveOperatorSeparator(_input);
-			
-			// check if the operator is known
-			if (!this->operator_map_.contains(op))
-				return false;
-
-			// check if the operator uses the Hilbert space or the lattice size
-			bool _usesHilbert 		= OperatorTypes::needsHilbertSpaceDim(this->operator_map_[op]);
-			
 			// get the dimension - either the Hilbert space or the lattice size (depending on the character of the operator)
-			size_t _dimension 		= _usesHilbert ? this->Nh_ : this->L_;
-
-			// check if the sites contain the correlation or random operator
-			v_1d<long double> _sites 	= { 0 };
-			bool _containsRandom 		= false;
-			if (_containsRandom = sites.find(OPERATOR_SEP_RANDOM) != std::string::npos; !_containsRandom)
-				_sites = this->resolveSites(splitStr(sites, OPERATOR_SEP_CORR), _usesHilbert);
+			const size_t _dimension 	= _ir.usesHilbert_ ? this->Nh_ : this->L_;
+			const auto& _sites			= _ir.sites_;
 
-			// filter the operators
-			if (!_useHilbertAllowed && (_usesHilbert || _containsRandom))
-				return false;
-			else if (!_usesRealAllowed && !_usesHilbert)
-				return false;
+			// the Pauli strings go to the single fused kernel
+			if (_ir.isPauli_)
+			{
+				if (!std::is_same_v<_T, cpx> && !_ir.pauli_.isReal())
+					return false;
+				const SymGenerators _gen	= _ir.type_ == OperatorTypes::OperatorsAvailable::Sx ? SymGenerators::SX :
+											  (_ir.type_ == OperatorTypes::OperatorsAvailable::Sz ? SymGenerators::SZ : SymGenerators::OTHER);
+				_operator = std::make_shared<Operator<_T>>(Fused::make<_T>(_dimension, _ir.pauli_, _gen));
+				return true;
+			}
 
 			// create the operator
-			switch (operator_map_[op])
+			switch (_ir.type_)
 			{
 			// !!!!! SPIN OPERATORS !!!!!
-			case OperatorTypes::OperatorsAvailable::Sx: 
-				_operator = std::make_shared<Operator<_T>>(Operators::SpinOperators::sig_x<double>(_dimension, Vectors::convert<uint>(_sites)));
-				break;
-			case OperatorTypes::OperatorsAvailable::Sy:
-				// return Operators::SpinOperators::sig_y(this->L_, _sites);
-				break;
-			case OperatorTypes::OperatorsAvailable::Sz:
-				_operator = std::make_shared<Operator<_T>>(Operators::SpinOperators::sig_z<double>(_dimension, Vectors::convert<uint>(_sites)));
-				break;
 			case OperatorTypes::OperatorsAvailable::SzR:
 				_operator = std::make_shared<Operator<_T>>(Operators::SpinOperators::RandomSuperposition::sig_z(_dimension));
 				break;
@@ -262,6 +281,32 @@ namespace Operators
 			return true;
 		}
 
+		/*
+		* @brief Creates a global operator from the input string - this allows for its further usage in the calculations.
+		* (creating matrices, acting on states, etc.)
+		* @param _input the input string
+		* @param _operator the operator to create
+		* @returns true if the operator was created successfully
+		*/
+		template <typename _T>
+		bool createGlobalOperator(const std::string& _input, std::shared_ptr<Operator<_T>>& _operator,
+				bool _usesRealAllowed 		= true,
+				bool _useHilbertAllowed 	= false,
+				randomGen* _rgen 			= nullptr)
+		{
+			CompiledOperator _ir;
+			if (!this->compile(_input, _ir))
+				return false;
+
+			// filter the operators
+			if (!_useHilbertAllowed && (_ir.usesHilbert_ || _ir.random_))
+				return false;
+			else if (!_usesRealAllowed && !_ir.usesHilbert_)
+				return false;
+
+			return this->build<_T>(_ir, _operator, _rgen);
+		}
+
 		/*
 		* @brief Creates a global operator from the input string - this allows for its further usage in the calculations.
 		* (creating matrices, acting on states, etc.)
@@ -0,0 +1,205 @@
+#pragma once
+/***********************************
+* Defines the compact storage of the
+* combinations of the single particle
+* orbitals (many body product states).
+* The combinations are kept in a single
+* flat buffer (N indices per column),
+* the occupations form the sparse
+* Ns x M matrix - the many body energies
+* follow from a single product with the
+* single particle spectrum.
+***********************************/
+
+#ifndef ORBITAL_COMBINATIONS_H
+#define ORBITAL_COMBINATIONS_H
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include "random_streams.h"
+
+namespace Orbitals
+{
+	/*
+	* @brief Combinations of N out of Ns orbitals. The i-th combination is the i-th column of the N x M matrix of the indices
+	* (sorted within the column) - a single allocation instead of the vector of vectors.
+	*/
+	class Combinations
+	{
+	protected:
+		uint Ns_							= 0;											// number of the single particle orbitals
+		uint N_								= 0;											// number of the occupied orbitals
+		arma::Mat<arma::uword> idx_;														// N x M indices of the occupied orbitals
+
+	public:
+		Combinations()						= default;
+		Combinations(uint _Ns, uint _N, u64 _M = 0)
+			: Ns_(_Ns), N_(_N), idx_(_N, _M, arma::fill::zeros)								{};
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		auto size()							const -> u64									{ return this->idx_.n_cols;							};
+		auto Ns()							const -> uint									{ return this->Ns_;									};
+		auto N()							const -> uint									{ return this->N_;									};
+		auto memory()						const -> u64									{ return this->idx_.n_elem * sizeof(arma::uword);	};
+		auto indices()						const -> const arma::Mat<arma::uword>&			{ return this->idx_;								};
+		auto col(u64 i)						const -> const arma::uword*						{ return this->idx_.colptr(i);						};
+		auto operator()(u64 i, uint j)		const -> arma::uword							{ return this->idx_(j, i);							};
+
+		/*
+		* @brief Combination as the vector (for the routines working on the single combinations)
+		*/
+		auto get(u64 i)						const -> v_1d<uint>
+		{
+			return v_1d<uint>(this->idx_.colptr(i), this->idx_.colptr(i) + this->N_);
+		}
+
+		/*
+		* @brief Occupation bitmask of the combination (Ns <= 64 only)
+		*/
+		auto mask(u64 i)					const -> u64
+		{
+			u64 _m = 0;
+			for (uint j = 0; j < this->N_; ++j)
+				_m |= ULLPOW(this->idx_(j, i));
+			return _m;
+		}
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		/*
+		* @brief Sparse Ns x M occupation matrix - the indices are used directly as the row indices of the CSC storage
+		*/
+		auto occupation()					const -> arma::SpMat<double>
+		{
+			arma::uvec _colptr				= arma::regspace<arma::uvec>(0, this->N_, (arma::uword)(this->N_ * this->size()));
+			const arma::uvec _rows(const_cast<arma::uword*>(this->idx_.memptr()), this->idx_.n_elem, false, true);
+			return arma::SpMat<double>(_rows, _colptr, arma::vec(this->idx_.n_elem, arma::fill::ones), this->Ns_, this->size());
+		}
+
+		/*
+		* @brief Sums of the single particle quantities over the occupied orbitals (the many body energies for _e = spectrum),
+		* a single sparse x dense product
+		* @param _e single particle values (Ns)
+		* @returns M sums
+		*/
+		auto sum(const arma::vec& _e)		const -> arma::vec
+		{
+			if (_e.n_elem != this->Ns_)
+				throw std::invalid_argument("Combinations: wrong number of the single particle values, " + VEQ(_e.n_elem) + "," + VEQ(this->Ns_));
+			return arma::vec((_e.t() * this->occupation()).t());
+		}
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		/*
+		* @brief Permutes the combinations
+		*/
+		template <typename _G>
+		void shuffle(_G& _gen)
+		{
+			v_1d<arma::uword> _p(this->size());
+			std::iota(_p.begin(), _p.end(), 0);
+			std::shuffle(_p.begin(), _p.end(), _gen);
+			this->idx_						= this->idx_.cols(arma::uvec(_p));
+		}
+
+		/*
+		* @brief Removes the repeating combinations - the first occurrence of each is kept and the order of the remaining
+		* ones is preserved (the random draws stay in the order of the stream)
+		*/
+		void unique()
+		{
+			if (this->size() < 2)
+				return;
+			v_1d<arma::uword> _p(this->size());
+			std::iota(_p.begin(), _p.end(), 0);
+			auto _less = [&](arma::uword a, arma::uword b)
+				{
+					return std::lexicographical_compare(this->col(a), this->col(a) + this->N_, this->col(b), this->col(b) + this->N_);
+				};
+			auto _same = [&](arma::uword a, arma::uword b)
+				{
+					return std::equal(this->col(a), this->col(a) + this->N_, this->col(b));
+				};
+			// the stable sort puts the first occurrence at the front of each group of the same combinations
+			std::stable_sort(_p.begin(), _p.end(), _less);
+			v_1d<arma::uword> _keep;
+			_keep.reserve(_p.size());
+			for (size_t k = 0; k < _p.size(); ++k)
+				if (k == 0 || !_same(_p[k - 1], _p[k]))
+					_keep.push_back(_p[k]);
+			std::sort(_keep.begin(), _keep.end());
+			this->idx_						= this->idx_.cols(arma::uvec(_keep));
+		}
+
+		// ---------------------------------------------------------------------------------------------------------------------------------
+
+		/*
+		* @brief All the combinations of N out of _orbitals in the lexicographic order (written directly into the flat buffer)
+		* @param _orbitals orbitals to choose from
+		* @param _N number of the occupied orbitals
+		*/
+		static Combinations all(const v_1d<uint>& _orbitals, uint _N)
+		{
+			const uint _n					= (uint)_orbitals.size();
+			if (_N > _n)
+				return Combinations(_n, _N, 0);
+			// binomial coefficient (exact for the sizes that can be stored)
+			u64 _M							= 1;
+			for (uint k = 1; k <= _N; ++k)
+				_M							= _M * (_n - _N + k) / k;
+
+			Combinations _c(_n, _N, _M);
+			v_1d<uint> _pos(_N);
+			std::iota(_pos.begin(), _pos.end(), 0);
+			for (u64 i = 0; i < _M; ++i)
+			{
+				for (uint j = 0; j < _N; ++j)
+					_c.idx_(j, i)			= _orbitals[_pos[j]];
+				std::sort(_c.idx_.colptr(i), _c.idx_.colptr(i) + _N);
+
+				// next combination of the positions
+				int j						= (int)_N - 1;
+				while (j >= 0 && _pos[j] == _n - _N + j)
+					--j;
+				if (j < 0)
+					break;
+				++_pos[j];
+				for (uint k = j + 1; k < _N; ++k)
+					_pos[k]					= _pos[k - 1] + 1;
+			}
+			return _c;
+		}
+
+		/*
+		* @brief Random combinations of N out of _orbitals - each draw uses its own part of the stream (threaded, reproducible),
+		* the repeating ones are removed afterwards (the first draw is kept, the order of the draws is preserved)
+		* @param _orbitals orbitals to choose from
+		* @param _N number of the occupied orbitals
+		* @param _M number of the draws
+		* @param _s stream
+		* @param _threads number of the threads
+		*/
+		static Combinations random(const v_1d<uint>& _orbitals, uint _N, u64 _M, const RandomStreams::Stream& _s, int _threads = 1)
+		{
+			Combinations _c((uint)_orbitals.size(), _N, _M);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(1, _threads))
+#endif
+			for (long long i = 0; i < (long long)_M; ++i)
+			{
+				const auto _draw			= RandomStreams::choice(_orbitals, _N, _s, (u64)i);
+				for (uint j = 0; j < _N; ++j)
+					_c.idx_(j, i)			= _draw[j];
+				std::sort(_c.idx_.colptr(i), _c.idx_.colptr(i) + _N);
+			}
+			_c.unique();
+			return _c;
+		}
+	};
+};
+
+#endif // !ORBITAL_COMBINATIONS_H
@@ -0,0 +1,101 @@
+#pragma once
+/***********************************
+* Defines the rank-k updates of the
+* skew-symmetric matrix, its inverse
+* and the Pfaffian for k rows (and the
+* corresponding columns) changed at
+* once - e.g. the exchange moves of
+* the pair-product states.
+***********************************/
+
+#ifndef PFAFFIAN_LOWRANK_H
+#define PFAFFIAN_LOWRANK_H
+
+namespace algebra
+{
+	namespace PfaffianLowRank
+	{
+		/*
+		* @brief Intermediate objects of the rank-k update - allow to obtain the Pfaffian ratio first and to update
+		* the inverse only when the move is accepted, without repeating the O(N^2 k) part.
+		*/
+		template <typename _T>
+		struct Update
+		{
+			arma::uvec rows_;													// changed rows (and columns)
+			arma::Mat<_T> P_;													// X^{-1} W (N x 2k)
+			arma::Mat<_T> M_;													// (-J) + W^T X^{-1} W (2k x 2k, skew-symmetric)
+			_T ratio_				= 1.0;										// Pf(X') / Pf(X)
+		};
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Prepares the rank-k update for the change of the rows R (and the columns, by the skew symmetry) X -> X'.
+		* The change is written as X' - X = E D - D^T E^T = W J W^T, where E selects the rows R, D = (X' - X)_{R,:} with the
+		* (R, R) block halved, W = [E, D^T] and J = [[0, I], [-I, 0]]. Then
+		*	Pf(X') / Pf(X) = Pf(M) / Pf(-J),	M = -J + W^T X^{-1} W,
+		*	X'^{-1} = X^{-1} + P M^{-1} P^T,	P = X^{-1} W,
+		* which replaces k rank-1 passes by a single product with N x 2k matrices. The inverse is not touched.
+		* @param _Xinv inverse of the current matrix
+		* @param _X current matrix
+		* @param _Xnew candidate matrix (differs only in the rows and columns R)
+		* @param _rows changed rows R (distinct)
+		* @param _upd stores the intermediates for the later update of the inverse
+		* @returns Pfaffian ratio Pf(X') / Pf(X)
+		*/
+		template <typename _T>
+		inline _T prepare(const arma::Mat<_T>& _Xinv, const arma::Mat<_T>& _X, const arma::Mat<_T>& _Xnew, const arma::uvec& _rows, Update<_T>& _upd)
+		{
+			const arma::uword _k	= _rows.n_elem;
+			_upd.rows_				= _rows;
+
+			// change of the rows with the (R, R) block counted once
+			arma::Mat<_T> _D		= _Xnew.rows(_rows) - _X.rows(_rows);
+			_D.cols(_rows)			*= 0.5;
+
+			// P = X^{-1} [E, D^T]
+			_upd.P_.set_size(_Xinv.n_rows, 2 * _k);
+			_upd.P_.head_cols(_k)	= _Xinv.cols(_rows);
+			_upd.P_.tail_cols(_k)	= _Xinv * _D.st();
+
+			// M = -J + W^T P = -J + [P_{R,:}; D P]
+			_upd.M_.set_size(2 * _k, 2 * _k);
+			_upd.M_.head_rows(_k)	= _upd.P_.rows(_rows);
+			_upd.M_.tail_rows(_k)	= _D * _upd.P_;
+			for (arma::uword a = 0; a < _k; ++a)
+			{
+				_upd.M_(a, _k + a)	-= 1.0;
+				_upd.M_(_k + a, a)	+= 1.0;
+			}
+
+			// Pf(-J) = (-1)^{k(k+1)/2}
+			const double _sign		= ((_k * (_k + 1) / 2) % 2) ? -1.0 : 1.0;
+			_upd.ratio_				= _sign * algebra::Pfaffian::pfaffian<_T>(_upd.M_, _upd.M_.n_rows);
+			return _upd.ratio_;
+		}
+
+		/*
+		* @brief Returns only the Pfaffian ratio of the rank-k change X -> X' (see prepare)
+		*/
+		template <typename _T>
+		inline _T ratio(const arma::Mat<_T>& _Xinv, const arma::Mat<_T>& _X, const arma::Mat<_T>& _Xnew, const arma::uvec& _rows)
+		{
+			Update<_T> _upd;
+			return prepare(_Xinv, _X, _Xnew, _rows, _upd);
+		}
+
+		/*
+		* @brief Updates the inverse after the accepted change with the intermediates from prepare
+		* @param _Xinv inverse of the current matrix - becomes the inverse of the candidate
+		* @param _upd intermediates of the update
+		*/
+		template <typename _T>
+		inline void apply(arma::Mat<_T>& _Xinv, const Update<_T>& _upd)
+		{
+			_Xinv					+= _upd.P_ * arma::solve(_upd.M_, _upd.P_.st());
+		}
+	};
+};
+
+#endif // !PFAFFIAN_LOWRANK_H
@@ -11,6 +11,8 @@
 #	include "../hilbert.h"
 #endif // !HILBERT_H
 
+#include <bit>
+
 
 /*
 * @brief Enables one to construct density matrices of quantum states.
@@ -28,6 +30,79 @@ namespace DensityMatrix
 
 	// ###############################################################
 
+	/*
+	* @brief Reinterprets the state as the _dA x _dB matrix (column-major) without copying - the matrix aliases the memory
+	* of the state, therefore, the state must outlive it and shall not be modified through it
+	* @param _s state
+	* @param _dA number of the rows
+	* @param _dB number of the columns
+	*/
+	template<typename _TV>
+	inline arma::Mat<_TV> schmidtView(const arma::Col<_TV>& _s, u64 _dA, u64 _dB)
+	{
+		return arma::Mat<_TV>(const_cast<_TV*>(_s.memptr()), _dA, _dB, false, true);
+	}
+
+	// ###############################################################
+
+	/*
+	* @brief Gather of the basis state bits into the (A, B) indices of the Schmidt matrix for the arbitrary mask of the
+	* subsystem A. The bits of the state are split into two halves and the gathered indices are tabulated for each half,
+	* so that each index costs two lookups and an OR (instead of the loop over the bits of the mask).
+	*/
+	struct SchmidtGather
+	{
+		uint h_								= 0;										// number of the bits in the lower half
+		u64 lo_								= 0;										// mask of the lower half
+		std::vector<u64> aLo_, aHi_, bLo_, bHi_;										// tabulated indices
+
+		/*
+		* @brief Compresses the bits of _x selected by _m into the lowest bits (in their order)
+		*/
+		static u64 pext(u64 _x, u64 _m)
+		{
+			u64 _out	= 0;
+			uint _k		= 0;
+			for (; _m; _m &= _m - 1, ++_k)
+				if (_x & (_m & (~_m + 1)))
+					_out |= (1ULL << _k);
+			return _out;
+		}
+
+		/*
+		* @param _maskA mask of the subsystem A
+		* @param _size number of the bits of the state
+		*/
+		SchmidtGather(u64 _maskA, size_t _size)
+			: h_((uint)_size / 2), lo_(ULLPOW(_size / 2) - 1)
+		{
+			const u64 _maskB	= (ULLPOW(_size) - 1) & ~_maskA;
+			const u64 _nLo		= ULLPOW(this->h_);
+			const u64 _nHi		= ULLPOW(_size - this->h_);
+			const uint _shA		= (uint)std::popcount(_maskA & this->lo_);
+			const uint _shB		= (uint)std::popcount(_maskB & this->lo_);
+			this->aLo_.resize(_nLo);
+			this->bLo_.resize(_nLo);
+			this->aHi_.resize(_nHi);
+			this->bHi_.resize(_nHi);
+			for (u64 i = 0; i < _nLo; ++i)
+			{
+				this->aLo_[i]	= pext(i, _maskA & this->lo_);
+				this->bLo_[i]	= pext(i, _maskB & this->lo_);
+			}
+			for (u64 i = 0; i < _nHi; ++i)
+			{
+				this->aHi_[i]	= pext(i, _maskA >> this->h_) << _shA;
+				this->bHi_[i]	= pext(i, _maskB >> this->h_) << _shB;
+			}
+		}
+
+		auto a(u64 _st)						const -> u64						{ return this->aLo_[_st & this->lo_] | this->aHi_[_st >> this->h_]; };
+		auto b(u64 _st)						const -> u64						{ return this->bLo_[_st & this->lo_] | this->bHi_[_st >> this->h_]; };
+	};
+
+	// ###############################################################
+
 	/*
 	* @brief Calculates the bipartite reduced density matrix of the system via the state mixing
 	* @param _s state to construct the density matrix from
@@ -45,35 +120,11 @@ namespace DensityMatrix
 		auto powB		= bitNum * (_Ns - _sizeA);
 		const u64 dimA	= ULLPOW(powA);
 		const u64 dimB	= ULLPOW(powB);
-		const u64 Nh	= dimA * dimB;
-		// get the masks for the bit manipulation
-		// const u64 maskA = (dimA - 1) << powB;
-		const u64 maskB = dimB - 1;
 
-		arma::Mat<_T> rho(dimA, dimA, arma::fill::zeros);
-
-		//u64 _startingM	= 0;
-		// loop over configurational basis
-		for (u64 n = 0; n < Nh; n++) 
-		{
-			// u64 counter = 0;
-			// find index of state in A, with same B-sides (by dividing the last bits are discarded). 
-			// The same is done by shifting the bits to the right.
-			// u64 idx	= n / dimB; bit shift should be faster
-			u64 idx		= n >> powB;
-			_T _sn_c    = algebra::conjugate(_s(n));
-			// pick out state with same B side (last L-A_size bits) (should be faster than modulo)
-			//for (u64 m = (n & maskA); m < Nh; m += dimB)
-			////for (u64 m = n % dimB; m < Nh; m += dimB) 
-			////for (u64 m = _startingM; m < Nh; m += dimB)
-			//{
-			//	rho(idx, counter) += _sn_c * _s(m);
-			//	// increase counter to move along reduced basis
-			//	counter++;
-			//}
-			rho.row(idx) += _sn_c * _s.elem(arma::regspace<arma::uvec>(n & maskB, dimB, Nh - 1));
-		}
-		return rho;
+		// the index n = idxA * dimB + idxB, therefore, the state read column-wise is the dimB x dimA matrix Psi_{BA}
+		// and rho_A = Psi^\dagger Psi is a single GEMM (no gathers of the B-side on each amplitude)
+		const arma::Mat<_T> _psi = schmidtView(_s, dimB, dimA);
+		return _psi.t() * _psi;
 	};
 
 	// ###############################################################
@@ -142,12 +193,91 @@ namespace DensityMatrix
 		return arma::reshape(_s, dimA, dimB);
 	}
 
+	// ###############################################################
+
+	/*
+	* @brief Schmidt decomposition of the state given in the symmetry reduced basis, without unfolding it to the full Hilbert
+	* space. Each representative is expanded by the group action (as in getSymRot) and its amplitudes land directly in the
+	* Schmidt matrix. With the U(1) symmetry the Schmidt matrix is block diagonal in the charge of A, n_A = popcount(a), and each
+	* block is indexed by the colex ranks of the configurations of A and B - the blocks hold C(L, N) elements altogether
+	* instead of 2^L. The bipartition is as in redDensMatSchmidt (A - the lowest bits of the state).
+	* @param _s state in the reduced basis
+	* @param _sizeA subsystem size
+	* @param _hilb used Hilbert space - contains the mapping, the normalization and the symmetry group
+	* @returns the blocks of the Schmidt matrix (one per charge of A, a single block without the U(1) symmetry)
+	*/
+	template<typename _T, typename _Ht>
+	inline v_1d<arma::Mat<_T>> schmidtSym(const arma::Col<_T>& _s, uint _sizeA, const Hilbert::HilbertSpace<_Ht>& _hilb)
+	{
+		const uint bitNum	= (uint)std::log2(_hilb.getLocalHilbertSize());
+		const uint LA		= bitNum * _sizeA;
+		const uint LB		= bitNum * (_hilb.getLatticeSize() - _sizeA);
+		const u64 maskA		= ULLPOW(LA) - 1;
+		const bool _u1		= _hilb.checkU1();
+		const int N			= _u1 ? _hilb.checkU1Val() : 0;
+
+		// binomials and the colex rank of the configuration among those with the same number of the set bits
+		v_1d<v_1d<u64>> _binom(LA + LB + 1, v_1d<u64>(LA + LB + 2, 0));
+		for (uint n = 0; n <= LA + LB; ++n)
+		{
+			_binom[n][0] = 1;
+			for (uint k = 1; k <= n; ++k)
+				_binom[n][k] = _binom[n - 1][k - 1] + (k <= n - 1 ? _binom[n - 1][k] : 0);
+		}
+		auto _rank = [&](u64 _x) -> u64
+			{
+				u64 _r = 0;
+				for (uint j = 1; _x; _x &= _x - 1, ++j)
+					_r += _binom[std::countr_zero(_x)][j];
+				return _r;
+			};
+
+		// blocks of the Schmidt matrix
+		v_1d<arma::Mat<_T>> _psi;
+		if (_u1)
+			for (int q = 0; q <= (int)LA; ++q)
+				_psi.push_back(arma::Mat<_T>((N - q >= 0 && N - q <= (int)LB) ? _binom[LA][q] : 0, (N - q >= 0 && N - q <= (int)LB) ? _binom[LB][N - q] : 0, arma::fill::zeros));
+		else
+			_psi.push_back(arma::Mat<_T>(ULLPOW(LA), ULLPOW(LB), arma::fill::zeros));
+
+		auto _add = [&](u64 _state, _T _val)
+			{
+				const u64 _a	= _state & maskA;
+				const u64 _b	= _state >> LA;
+				if (_u1)
+					_psi[std::popcount(_a)](_rank(_a), _rank(_b)) += _val;
+				else
+					_psi[0](_a, _b) += _val;
+			};
+
+		// expand the representatives
+		const auto& _G		= _hilb.getSymGroup();
+		const double _gSize	= (double)_G.size();
+		for (u64 k = 0; k < _hilb.getHilbertSize(); ++k)
+		{
+			if (_G.empty())
+			{
+				_add(_hilb.getMapping(k), _s(k));
+				continue;
+			}
+			const u64 _rep	= _hilb.getMapping(k);
+			const _Ht _norm	= _hilb.getNorm(k) * std::sqrt(_gSize);
+			for (const auto& G : _G)
+			{
+				auto [_idx, _val] = G(_rep);
+				_add(_idx, algebra::cast<_T>(algebra::conjugate(_val / _norm)) * _s(k));
+			}
+		}
+		return _psi;
+	}
+
 	// ##############################################################################################################################
 
 	// ##############################################################################################################################
 
 	/*
-	* @brief Using reshape method to calculate the reduced density matrix
+	* @brief Using reshape method to calculate the reduced density matrix - the returned Schmidt matrix owns its memory (the
+	* callers that consume it at once, like schmidtToRho below, read the state in place with schmidtView instead)
 	* @param _s state to construct the density matrix from
 	* @param _sizeA subsystem size
 	* @param _Ns number of lattice sites
@@ -186,24 +316,32 @@ namespace DensityMatrix
 		const u64 dA	= ULLPOW(bitNum * _sizeA);
 		const u64 dB	= ULLPOW(bitNum * (_size - _sizeA));
 
-		// create second part of the mask
-		const _T _maskB = Binary::flipAll(_maskA, _size);
+		// the permutation gather into the (A, B) layout
+		const SchmidtGather _g((u64)_maskA, _size);
 
 		// create the reduced density matrix
 		arma::Mat<_TV> _psi(dA, dB, arma::fill::zeros);
 
-		// loop over the state
+		// loop over the state (each basis state lands in a distinct element)
 		for(u64 _st = 0; _st < _s.size(); ++_st)
-		{
-			// get the index of the state in the reduced basis
-			u64 _idxA	= Binary::extract(_st, _maskA);
-			u64 _idxB	= Binary::extract(_st, _maskB);
-			_psi(_idxA, _idxB) += _s(_st);
-		}
+			_psi.at(_g.a(_st), _g.b(_st)) = _s(_st);
+
 		// return the new Schmidt decomposed matrix
 		return _psi;
 	}
 
+	// ###############################################################
+
+	/*
+	* @brief Reduced density matrix of the subsystem A from its Schmidt matrix - a single GEMM, rho_A = Psi Psi^\dagger
+	* @param _psi Schmidt matrix (dA x dB)
+	*/
+	template<typename _TV>
+	inline arma::Mat<_TV> schmidtToRho(const arma::Mat<_TV>& _psi)
+	{
+		return _psi * _psi.t();
+	}
+
 	// ##############################################################################################################################
 	
 	// ##############################################################################################################################
@@ -249,11 +387,11 @@ namespace DensityMatrix
 		switch (_ch) 
 		{
 		case RHO_METHODS::STANDARD:
-			return arma::Mat<_T>();
-			break;
 		case RHO_METHODS::STANDARD_CAST:
-			return arma::Mat<_T>();
-			break;
+		{
+			const uint bitNum	= (uint)std::log2(_locHilbert);
+			return schmidtToRho(schmidtView(_s, ULLPOW(bitNum * _sizeA), ULLPOW(bitNum * (_Ns - _sizeA))));
+		}
 		case RHO_METHODS::SCHMIDT:
 			return schmidt(_s, _sizeA, _Ns, _locHilbert);
 			break;
@@ -277,10 +415,8 @@ namespace DensityMatrix
 		switch (_ch) 
 		{
 		case RHO_METHODS::STANDARD:
-			return arma::Mat<_TV>();
-			break;
 		case RHO_METHODS::STANDARD_CAST:
-			return arma::Mat<_TV>();
+			return schmidtToRho(schmidt(_s, _sizeA, _size, _maskA, _locHilbert));
 			break;
 		case RHO_METHODS::SCHMIDT:
 			return schmidt(_s, _sizeA, _size, _maskA, _locHilbert);
@@ -295,12 +431,25 @@ namespace DensityMatrix
 
 	namespace Values
 	{	
+		/*
+		* @brief Squared Schmidt values of the rectangular Schmidt matrix from the Gram matrix of its smaller side - one GEMM and
+		* a small Hermitian eigenproblem instead of the SVD. Sorted descending (as from the SVD).
+		* @param _psi Schmidt matrix
+		*/
+		template <typename _T>
+		inline arma::vec schmidt_v(const arma::Mat<_T>& _psi)
+		{
+			const arma::Mat<_T> _gram	= _psi.n_rows <= _psi.n_cols ? arma::Mat<_T>(_psi * _psi.t()) : arma::Mat<_T>(_psi.t() * _psi);
+			arma::vec _vals				= arma::reverse(arma::eig_sym(_gram));
+			return arma::clamp(_vals, 0.0, arma::datum::inf);
+		}
+
 		template <typename _T>
 		inline arma::vec redDensMat_v(const arma::Mat<_T>& _rho, 
 									  RHO_METHODS _ch = RHO_METHODS::SCHMIDT)
 		{
 			if (_ch == RHO_METHODS::SCHMIDT)
-				return arma::square(arma::svd(_rho));
+				return _rho.n_rows != _rho.n_cols ? schmidt_v(_rho) : arma::vec(arma::square(arma::svd(_rho)));
 			else
 				return arma::eig_sym(_rho);
 		}
@@ -330,6 +479,26 @@ namespace DensityMatrix
 
 		// ##############################################################################################################################
 
+		/*
+		* @brief Squared Schmidt values of the state given in the symmetry reduced basis - collected from the charge blocks
+		* of schmidtSym (sorted descending)
+		* @param _s state in the reduced basis
+		* @param _sizeA subsystem size
+		* @param _hilb used Hilbert space
+		*/
+		template <typename _T, typename _Ht>
+		inline arma::vec redDensMatSym_v(const arma::Col<_T>& _s, uint _sizeA, const Hilbert::HilbertSpace<_Ht>& _hilb)
+		{
+			const auto _blocks	= schmidtSym<_T, _Ht>(_s, _sizeA, _hilb);
+			arma::vec _vals;
+			for (const auto& _psi : _blocks)
+				if (!_psi.is_empty())
+					_vals		= arma::join_cols(_vals, redDensMat_v(_psi, RHO_METHODS::SCHMIDT));
+			return arma::sort(_vals, "descend");
+		}
+
+		// ##############################################################################################################################
+
 		/*
 		* @brief Calculates the reduced density matrix with one of the methods and returns the eigenvalues
 		* @param _s state to construct the density matrix from
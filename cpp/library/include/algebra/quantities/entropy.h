@@ -13,6 +13,7 @@
 #	include "density_matrix.h"
 #endif
 #include <cmath>
+#include <memory>
 
 // ##########################################################################################################################################
 // ##########################################################################################################################################
@@ -100,6 +101,25 @@ namespace Entropy
 
 			// ##########################################################################################################################################
 
+			/*
+			* @brief Calculates the von Neuman entropy of the state in the symmetry reduced basis - resolved in the charge blocks
+			* of the Schmidt matrix, without the rotation to the full Hilbert space
+			* @param _s state in the reduced basis
+			* @param _sizeA subsystem size
+			* @param _hilb used Hilbert space - contains the mapping and the symmetry group
+			* @returns the bipartite entanglement entropy
+			*/
+			template <typename _T, typename _Ht>
+			[[nodiscard]]
+			double vonNeumanSym(const arma::Col<_T>& _s,
+								uint _sizeA,
+								const Hilbert::HilbertSpace<_Ht>& _hilb)
+			{
+				return vonNeuman(DensityMatrix::Values::redDensMatSym_v<_T, _Ht>(_s, _sizeA, _hilb));
+			};
+
+			// ##########################################################################################################################################
+
 			/*
 			* @brief Calculates the von Neuman entropy
 			* @param _s			state to construct the density matrix from
@@ -188,6 +208,105 @@ namespace Entropy
 				// ##########################################################################################################################################
 			};
 
+			// ##########################################################################################################################################
+
+			// ############################################################# B A T C H E D ##############################################################
+
+			// ##########################################################################################################################################
+
+			/*
+			* @brief Entanglement of many states (eigenstates, time points) and many cuts in a single pass. The states come as
+			* the columns of one matrix, each cut is the mask of the subsystem A (the contiguous cut of sizeA sites is the mask
+			* ULLPOW(sizeA) - 1, as in DensityMatrix::schmidt). The contiguous cuts read the columns in place as the Schmidt
+			* matrices, the others go through the tabulated gather. The squared Schmidt values follow from the Gram matrix of the
+			* smaller side, and each thread reuses its own workspace for all of its states, so nothing is allocated per state.
+			*/
+			namespace Batched
+			{
+				struct Result
+				{
+					arma::mat vn_;																		// von Neumann entropies (state x cut)
+					v_1d<arma::mat> renyi_;																// Renyi entropies (state x cut) for each q
+					arma::mat gap_;																		// Schmidt gaps lambda_0 - lambda_1 (state x cut)
+				};
+
+				/*
+				* @brief Calculates the entropies of all the states for all the cuts
+				* @param _states states in the columns (in the full Hilbert space of _Ns spins)
+				* @param _Ns number of lattice sites
+				* @param _masks masks of the subsystems A
+				* @param _q exponents of the Renyi entropies
+				* @param _out result (resized)
+				* @param _threads number of the threads
+				*/
+				template <typename _T>
+				inline void entropies(const arma::Mat<_T>& _states, 
+									  uint _Ns, 
+									  const v_1d<u64>& _masks, 
+									  const v_1d<double>& _q, 
+									  Result& _out, 
+									  int _threads = 1)
+				{
+					const size_t _nS	= _states.n_cols;
+					const size_t _nC	= _masks.size();
+					_out.vn_.zeros(_nS, _nC);
+					_out.gap_.zeros(_nS, _nC);
+					_out.renyi_.assign(_q.size(), arma::mat(_nS, _nC, arma::fill::zeros));
+
+					// the cuts - dimensions and (for the non-contiguous ones) the gathers, built once for all the states
+					v_1d<u64> _dA(_nC), _dB(_nC);
+					v_1d<std::shared_ptr<DensityMatrix::SchmidtGather>> _g(_nC);
+					for (size_t c = 0; c < _nC; ++c)
+					{
+						const uint _sizeA	= (uint)std::popcount(_masks[c]);
+						_dA[c]				= ULLPOW(_sizeA);
+						_dB[c]				= ULLPOW(_Ns - _sizeA);
+						if (_masks[c] != _dA[c] - 1)
+							_g[c]			= std::make_shared<DensityMatrix::SchmidtGather>(_masks[c], _Ns);
+					}
+
+#ifndef _DEBUG
+#	pragma omp parallel num_threads(std::max(1, _threads))
+#endif
+					{
+						arma::Mat<_T> _psi, _gram;
+						arma::vec _vals;
+#ifndef _DEBUG
+#	pragma omp for schedule(dynamic)
+#endif
+						for (long long k = 0; k < (long long)_nS; ++k)
+						{
+							const _T* _col = _states.colptr(k);
+							for (size_t c = 0; c < _nC; ++c)
+							{
+								// Schmidt matrix - in place or gathered into the reused buffer
+								const arma::Mat<_T> _view(const_cast<_T*>(_col), _g[c] ? 0 : _dA[c], _g[c] ? 0 : _dB[c], false, true);
+								if (_g[c])
+								{
+									_psi.set_size(_dA[c], _dB[c]);
+									for (u64 _st = 0; _st < _states.n_rows; ++_st)
+										_psi.at(_g[c]->a(_st), _g[c]->b(_st)) = _col[_st];
+								}
+								const arma::Mat<_T>& _m = _g[c] ? _psi : _view;
+
+								// squared Schmidt values (descending)
+								if (_dA[c] <= _dB[c])
+									_gram	= _m * _m.t();
+								else
+									_gram	= _m.t() * _m;
+								arma::eig_sym(_vals, _gram);
+								_vals		= arma::clamp(arma::reverse(_vals), 0.0, arma::datum::inf);
+
+								_out.vn_(k, c)				= vonNeuman(_vals);
+								_out.gap_(k, c)				= _vals.n_elem > 1 ? _vals(0) - _vals(1) : 0.0;
+								for (size_t iq = 0; iq < _q.size(); ++iq)
+									_out.renyi_[iq](k, c)	= Renyi::renyi(_vals, _q[iq]);
+							}
+						}
+					}
+				}
+			};
+
 			// ##########################################################################################################################################
 			
 			// ###################################################### S I N G L E   P A R T I C L E #####################################################
@@ -220,6 +339,65 @@ namespace Entropy
 					}
 					return -0.5 * S;
 				}
+
+				// ##########################################################################################################################################
+
+				/*
+				* @brief Entropy of the Gaussian state from the occupations of the restricted correlation matrix <c^+_i c_j>_A, n in [0, 1]
+				* @param _n eigenvalues of the correlation matrix
+				* @returns the von Neuman entropy
+				*/
+				inline double vonNeumanOcc(const arma::vec& _n)
+				{
+					double S = 0.0;
+					for (const auto& n : _n)
+						if (n > 0.0 && n < 1.0)
+							S -= n * std::log(n) + (1.0 - n) * std::log1p(-n);
+					return S;
+				}
+
+				/*
+				* @brief Entropy of the Slater determinant of the orbitals _orbs without the many body state. The restricted correlation
+				* matrix reads C_A = M^+ M with M = _W_A.rows(_orbs), so that its nonzero spectrum is the one of the smaller Gram matrix
+				* (N x N or L_A x L_A). The matrix is Hermitian - the symmetric solver is used instead of the general one.
+				* @param _W_A transformation matrix reduced to the subsystem A (orbital x site in A)
+				* @param _orbs occupied single particle orbitals
+				* @returns the von Neuman entropy
+				*/
+				template<typename _T, typename _V>
+				inline double vonNeumanSlater(const arma::Mat<_T>& _W_A, const _V& _orbs)
+				{
+					arma::uvec _o(_orbs.size());
+					for (arma::uword j = 0; j < _o.n_elem; ++j)
+						_o(j) = (arma::uword)_orbs[j];
+
+					const arma::Mat<_T> _M	= _W_A.rows(_o);
+					const arma::Mat<_T> _G	= (_M.n_rows <= _M.n_cols) ? arma::Mat<_T>(_M * _M.t()) : arma::Mat<_T>(_M.t() * _M);
+					arma::vec _n;
+					arma::eig_sym(_n, _G);
+					return vonNeumanOcc(_n);
+				}
+
+				/*
+				* @brief Entropies of many Slater determinants at once (each row of _orbs is a single combination of the orbitals).
+				* The combinations are distributed over the threads, the memory is O(N * L_A) per thread - nothing of the size
+				* of the many body Hilbert space is created.
+				* @param _W_A transformation matrix reduced to the subsystem A (orbital x site in A)
+				* @param _orbs combinations of the occupied orbitals
+				* @param _threads number of the threads
+				* @returns the von Neuman entropies of the combinations
+				*/
+				template<typename _T, typename _V>
+				inline arma::vec vonNeumanBatch(const arma::Mat<_T>& _W_A, const std::vector<_V>& _orbs, int _threads = 1)
+				{
+					arma::vec _S(_orbs.size(), arma::fill::zeros);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(1, _threads)) schedule(dynamic)
+#endif
+					for (long long i = 0; i < (long long)_orbs.size(); ++i)
+						_S(i) = vonNeumanSlater(_W_A, _orbs[i]);
+					return _S;
+				}
 			}
 		};
 	};
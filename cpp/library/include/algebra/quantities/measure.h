@@ -5,6 +5,9 @@
 #endif
 
 #include "../../quantities/statistics.h"
+#include "../operators/operator_cache.hpp"
+
+constexpr long long MEASURE_LAZY_CHUNK		= 0x400;					// basis states per chunk of the matrix-free measurement
 
 /*
 * @brief Class that stores the measurements is able to save them.
@@ -15,6 +18,7 @@ class Measurement
 {
 private:
 	bool matInitialized_= false;
+	bool lazy_			= false;										// apply the operators on the fly instead of storing their matrices
 
 	using MeasureGlobal = std::vector<_T>;
 	using MeasureLocal	= std::vector<arma::Col<_T>>;
@@ -25,10 +29,11 @@ private:
 	std::vector<arma::Col<_T>> valL_;
 	std::vector<arma::Mat<_T>> valC_;
 
-	// store the many body operator matrices
+	// store the many body operator matrices (the global ones are shared with Operators::Cache)
 	using MatrixType	= GeneralizedMatrix<_T>;
+	using MatrixPtr		= std::shared_ptr<const MatrixType>;
 
-	v_1d<MatrixType> MG_;
+	v_1d<MatrixPtr> MG_;
 	v_2d<MatrixType> ML_;
 	v_3d<MatrixType> MC_;
 
@@ -51,12 +56,19 @@ protected:
 	// global operators
 	OPG opG_;
 	strVec opGN_;
+	strVec opGK_;														// signatures of the global matrices in Operators::Cache (empty - not cached)
+	std::string opGS_;													// sector of the Hilbert space of the cached matrices (see HilbertSpace::getCacheKey)
 	// local operators
 	OPL opL_;
 	strVec opLN_;
 	// correlation operators
 	OPC opC_;
 	strVec opCN_;
+	auto sites()					const noexcept -> size_t						{ return this->lat_ ? this->lat_->get_Ns() : this->Ns_; };
+	auto needsMatrix(const Operators::Operator<_T>& _op) const noexcept -> bool		{ return _op.getIsQuadratic() || (bool)_op.overridenMatFun_; };
+
+	template<typename _C>
+	MeasureTuple measureLazy(const _C& _stateL, const _C& _stateR, int _cut = -1);
 public:
 	~Measurement();
 	Measurement(size_t _Ns,	const strVec& _operators, u64 _initial = 0);
@@ -130,9 +142,10 @@ public:
 	auto getNs()					const noexcept -> size_t						{ return Ns_;			};
 	auto getDir()					const noexcept -> std::string					{ return dir_;			};
 	auto getThreads()				const noexcept -> uint							{ return threads_;		};
+	auto isLazy()					const noexcept -> bool							{ return lazy_;			};
 	auto getOpG()					const noexcept -> OPG							{ return opG_;			};
-	auto getOpG_mat()				const noexcept -> const v_1d<MatrixType>&		{ return MG_;			};
-	auto getOpG_mat(uint i)			const noexcept -> const MatrixType&				{ return MG_.at(i);		};
+	auto getOpG_mat()				const noexcept -> const v_1d<MatrixPtr>&		{ return MG_;			};
+	auto getOpG_mat(uint i)			const -> const MatrixType&						{ return *MG_.at(i);	};
 	auto getOpGN(uint i)			const noexcept -> std::string					{ return opG_[i]->getNameS(); };
 	auto getOpL()					const noexcept -> OPL							{ return opL_;			};
 	auto getOpLN(uint i)			const noexcept -> std::string					{ return opL_[i]->getNameS(); };
@@ -146,6 +159,10 @@ public:
 	// ############ SETTERS ############
 
 	auto setNs(size_t _Ns)					noexcept -> void						{ Ns_ = _Ns;			};
+	// the matrix-free mode (placeholders in getOpG_mat) - with _dim > 0 the stored matrices are rebuilt (dropped) at once
+	auto setLazy(bool _lazy, u64 _dim, u64 _fullDim)		-> void;
+	// the signatures of the global operators (see OperatorNameParser::signatures) and the sector - their matrices are shared through Operators::Cache
+	auto setCacheKeys(const strVec& _keys, const std::string& _sector, u64 _dim = 0) -> void	{ opGK_ = _keys; opGS_ = _sector; if (_dim > 0) this->initializeMatrices(_dim); };
 	auto setDir(const std::string& _dir)	noexcept -> void						{ dir_ = _dir;			};
 	auto setThreads(uint _threads)			noexcept -> void						{ threads_ = _threads;	};
 	auto setOpG(const OPG& _opG)			noexcept -> void						{ opG_ = _opG;			};
@@ -271,6 +288,28 @@ inline auto Measurement<_T>::clear() -> void
 
 // ############################################################################################################################################################
 
+/*
+* @brief Sets the matrix-free mode of the measurement. The operators act on the basis states, so that the index of the measured
+* vector shall be the basis state itself - in the reduced (symmetry) sectors the matrices are kept instead.
+* @param _lazy apply the operators on the fly
+* @param _dim dimension of the Hilbert space (if > 0, the matrices are rebuilt at once)
+* @param _fullDim dimension of the full Hilbert space
+*/
+template<typename _T>
+inline auto Measurement<_T>::setLazy(bool _lazy, u64 _dim, u64 _fullDim) -> void
+{
+	if (_lazy && _dim != _fullDim)
+	{
+		LOGINFO("The matrix-free measurement requires the full Hilbert space: " + VEQ(_dim) + "," + VEQ(_fullDim) + ". Keeping the matrices.", LOG_TYPES::WARNING, 3);
+		_lazy			= false;
+	}
+	this->lazy_			= _lazy;
+	if (_dim > 0)
+		this->initializeMatrices(_dim);
+}
+
+// ############################################################################################################################################################
+
 /*
 * @brief Initialize the matrices for the measurement. The matrices are stored in the measurement object.
 * @param _dim The dimension of the system.
@@ -284,29 +323,28 @@ inline void Measurement<_T>::initializeMatrices(u64 _dim)
 	{
 
 		// measure global
-		for (std::shared_ptr<Operators::Operator<_T>> _op : this->opG_)
+		auto& _cache = Operators::Cache::matrices<_T>();
+		for (size_t i = 0; i < this->opG_.size(); ++i)
 		{
+			std::shared_ptr<Operators::Operator<_T>> _op = this->opG_[i];
 			// check if the operator is quadratic
 			bool _isquadratic = _op->getIsQuadratic();
-			if (_isquadratic)
+			// the matrices of the signed operators are built once per process and sector (the same for all the realizations)
+			const std::string _key = (i < this->opGK_.size() && !this->opGK_[i].empty()) ? this->opGK_[i] + ";dim=" + STR(_dim) + ";sec=" + this->opGS_ + (_isquadratic ? ";std" : "") : "";
+			if (this->lazy_ && !this->needsMatrix(*_op))
 			{
-				// inner matrix
-				GeneralizedMatrix<_T> _Min = _op->template generateMat<true, _T, GeneralizedMatrix>(_dim);
-				// push the operator
-				this->MG_.push_back(_Min);
+				// applied on the fly in measureLazy - only the placeholder is stored
+				this->MG_.push_back(std::make_shared<const MatrixType>());
 			}
+			else if (_isquadratic)
+				this->MG_.push_back(_cache.get(_key, [&]() { return _op->template generateMat<true, _T, GeneralizedMatrix>(_dim); }));
 			else
-			{
-				// inner matrix
-				GeneralizedMatrix<_T> _Min = _op->template generateMat<false, _T, GeneralizedMatrix>(_dim);
-				// push the operator
-				this->MG_.push_back(_Min);
-			}
+				this->MG_.push_back(_cache.get(_key, [&]() { return _op->template generateMat<false, _T, GeneralizedMatrix>(_dim); }));
 		}
 
 	}
 	END_CATCH_HANDLER("Problem in the measurement of global operators.", ;);
-	LOGINFO("Initialized the measurement matrices.", LOG_TYPES::TRACE, 3);
+	LOGINFO(this->lazy_ ? "Initialized the measurement (matrix-free)." : "Initialized the measurement matrices.", LOG_TYPES::TRACE, 3);
 
 	//BEGIN_CATCH_HANDLER
 	//{
@@ -351,6 +389,9 @@ template<typename _T>
 template<typename _C>
 inline std::vector<_T> Measurement<_T>::measureG(const _C & _state, int _cut)
 {
+	if (this->lazy_)
+		return std::get<0>(this->measureLazy(_state, _state, _cut));
+
 	BEGIN_CATCH_HANDLER
 	{
 		// save into column
@@ -364,7 +405,7 @@ inline std::vector<_T> Measurement<_T>::measureG(const _C & _state, int _cut)
 		{
 			if (_cut > 0 && (int)i >= _cut)
 				continue;
-			_valG[i] = Operators::applyOverlap(_state, this->MG_[i]);
+			_valG[i] = Operators::applyOverlap(_state, *this->MG_[i]);
 		}
 
 		return _valG;
@@ -377,6 +418,9 @@ template<typename _T>
 template<typename _C>
 inline std::tuple<std::vector<_T>, std::vector<arma::Col<_T>>, std::vector<arma::Mat<_T>>> Measurement<_T>::measureS(const _C & _state)
 {
+	if (this->lazy_)
+		return this->measureLazy(_state, _state);
+
 	v_1d<_T> _valG			  = this->measureG(_state);
 
 	v_1d<arma::Col<_T>> _valL = v_1d<arma::Col<_T>>(this->Ns_, arma::Col<_T>(this->opL_.size(), arma::fill::zeros));
@@ -419,6 +463,9 @@ template<typename _T>
 template<typename _C>
 inline std::vector<_T> Measurement<_T>::measureG(const _C & _stateL, const _C & _stateR, int _cut)
 {
+	if (this->lazy_)
+		return std::get<0>(this->measureLazy(_stateL, _stateR, _cut));
+
 	BEGIN_CATCH_HANDLER
 	{
 		// save into column
@@ -432,7 +479,7 @@ inline std::vector<_T> Measurement<_T>::measureG(const _C & _stateL, const _C &
 		{
 			if (_cut > 0 && (int)i >= _cut)
 				continue;
-			_valG[i] = Operators::applyOverlap(_stateL, _stateR, this->MG_[i]);
+			_valG[i] = Operators::applyOverlap(_stateL, _stateR, *this->MG_[i]);
 		}
 		return _valG;
 	}
@@ -444,6 +491,9 @@ template<typename _T>
 template<typename _C>
 inline std::tuple<std::vector<_T>, std::vector<arma::Col<_T>>, std::vector<arma::Mat<_T>>> Measurement<_T>::measureS(const _C & _stateL, const _C & _stateR)
 {
+	if (this->lazy_)
+		return this->measureLazy(_stateL, _stateR);
+
 	auto _valG = this->measureG(_stateL, _stateR);
 	auto _valL = v_1d<arma::Col<_T>>(this->Ns_, arma::Col<_T>(this->opL_.size(), arma::fill::zeros));
 	BEGIN_CATCH_HANDLER
@@ -480,6 +530,144 @@ inline void Measurement<_T>::measure(const _C & _stateL, const _C & _stateR)
 	this->valC_ = _valC;
 }
 
+// ############################################################################################################################################################
+
+/*
+* @brief Matrix-free measurement <L|O|R> of all the operators - the global, local (each site) and correlation (each pair) ones.
+* The basis is split into chunks processed in parallel, each chunk of R is read once and every operator is applied on the fly
+* from its functional form, accumulating conj(L(O k)) O(k) R(k) into the per-thread sums. The local and correlation operators
+* with the Pauli kernels (see Fused::local, Fused::correlation) are not called per site - their Ns (Ns x Ns) strings are evaluated
+* together in the grouped passes of Fused::expectation. Only the operators that cannot act on the basis states (quadratic or
+* with the overriden matrix) use their matrices from initializeMatrices.
+* @param _stateL left state (in the full basis - the index is the basis state)
+* @param _stateR right state
+* @param _cut number of the global operators to measure (all if negative)
+* @returns the global, local and correlation values
+*/
+template<typename _T>
+template<typename _C>
+inline typename Measurement<_T>::MeasureTuple Measurement<_T>::measureLazy(const _C& _stateL, const _C& _stateR, int _cut)
+{
+	const size_t _Ns	= this->sites();
+	const size_t _nG	= _cut >= 0 ? std::min<size_t>(_cut, this->opG_.size()) : this->opG_.size();
+	const size_t _nL	= this->opL_.size();
+	const size_t _nC	= this->opC_.size();
+	const long long _Nh	= (long long)_stateR.n_elem;
+
+	// which global operators are applied on the fly
+	v_1d<bool> _fly(_nG, true);
+	for (size_t i = 0; i < _nG; ++i)
+		_fly[i]			= !this->needsMatrix(*this->opG_[i]);
+
+	// the Pauli kernels of the local and correlation operators - the strings of all the sites (pairs) at once
+	v_1d<Operators::Fused::PauliMask> _strings;
+	v_1d<long long> _stringL(_nL, -1), _stringC(_nC, -1);
+	for (size_t i = 0; i < _nL; ++i)
+		if (const auto& _p = this->opL_[i]->getPauli(); _p.size() == 1)
+		{
+			_stringL[i]	= (long long)_strings.size();
+			for (uint j = 0; j < _Ns; ++j)
+				_strings.push_back(Operators::Fused::mask(_Ns, _p, { j }));
+		}
+	for (size_t i = 0; i < _nC; ++i)
+		if (const auto& _p = this->opC_[i]->getPauli(); _p.size() == 2)
+		{
+			_stringC[i]	= (long long)_strings.size();
+			const auto _c = Operators::Fused::correlationStrings(_Ns, _p[0], _p[1]);
+			_strings.insert(_strings.end(), _c.begin(), _c.end());
+		}
+
+	v_1d<_T> _valG(_nG, _T(0.0));
+	arma::Mat<_T> _valL(_Ns, _nL, arma::fill::zeros);
+	arma::Cube<_T> _valC(_Ns, _Ns, _nC, arma::fill::zeros);
+
+	BEGIN_CATCH_HANDLER
+	{
+#ifndef _DEBUG
+#	pragma omp parallel num_threads(std::max<uint>(1, this->threads_))
+#endif
+		{
+			v_1d<_T> _locG(_nG, _T(0.0));
+			arma::Mat<_T> _locL(_Ns, _nL, arma::fill::zeros);
+			arma::Cube<_T> _locC(_Ns, _Ns, _nC, arma::fill::zeros);
+			auto _amp = [&](u64 _k2, auto _v, auto _r) -> _T { return algebra::cast<_T>(algebra::conjugate(_stateL(_k2)) * _v * _r); };
+
+#ifndef _DEBUG
+#	pragma omp for schedule(dynamic, MEASURE_LAZY_CHUNK)
+#endif
+			for (long long k = 0; k < _Nh; ++k)
+			{
+				const auto _r	= _stateR(k);
+				// global
+				for (size_t i = 0; i < _nG; ++i)
+					if (_fly[i])
+					{
+						auto [_k2, _v]	= this->opG_[i]->operator()((u64)k);
+						_locG[i]		+= _amp(_k2, _v, _r);
+					}
+				// local (the general kernels only)
+				for (size_t i = 0; i < _nL; ++i)
+				{
+					if (_stringL[i] >= 0)
+						continue;
+					for (uint j = 0; j < _Ns; ++j)
+					{
+						auto [_k2, _v]	= this->opL_[i]->operator()((u64)k, j);
+						_locL(j, i)		+= _amp(_k2, _v, _r);
+					}
+				}
+				// correlation (the general kernels only)
+				for (size_t i = 0; i < _nC; ++i)
+				{
+					if (_stringC[i] >= 0)
+						continue;
+					for (uint a = 0; a < _Ns; ++a)
+						for (uint b = 0; b < _Ns; ++b)
+						{
+							auto [_k2, _v]	= this->opC_[i]->operator()((u64)k, a, b);
+							_locC(a, b, i)	+= _amp(_k2, _v, _r);
+						}
+				}
+			}
+#ifndef _DEBUG
+#	pragma omp critical
+#endif
+			{
+				for (size_t i = 0; i < _nG; ++i)
+					_valG[i]	+= _locG[i];
+				_valL			+= _locL;
+				_valC			+= _locC;
+			}
+		}
+
+		// the Pauli kernels (the correlation strings are stored column-wise, as _valC)
+		if (!_strings.empty())
+		{
+			const arma::Col<_T> _vals = Operators::Fused::expectation<_T>(_stateL, _stateR, _strings);
+			for (size_t i = 0; i < _nL; ++i)
+				if (_stringL[i] >= 0)
+					_valL.col(i)		= _vals.subvec(_stringL[i], _stringL[i] + _Ns - 1);
+			for (size_t i = 0; i < _nC; ++i)
+				if (_stringC[i] >= 0)
+					_valC.slice(i)		= arma::reshape(_vals.subvec(_stringC[i], _stringC[i] + _Ns * _Ns - 1), _Ns, _Ns);
+		}
+
+		// the operators that need their matrices
+		for (size_t i = 0; i < _nG; ++i)
+			if (!_fly[i] && i < this->MG_.size())
+				_valG[i]		= Operators::applyOverlap(_stateL, _stateR, *this->MG_[i]);
+	}
+	END_CATCH_HANDLER("Problem in the matrix-free measurement.", ;);
+
+	v_1d<arma::Col<_T>> _outL(_nL);
+	for (size_t i = 0; i < _nL; ++i)
+		_outL[i]				= _valL.col(i);
+	v_1d<arma::Mat<_T>> _outC(_nC);
+	for (size_t i = 0; i < _nC; ++i)
+		_outC[i]				= _valC.slice(i);
+	return std::make_tuple(_valG, _outL, _outC);
+}
+
 // #############
 
 /*
@@ -495,9 +683,9 @@ inline bool Measurement<_T>::checkG_mat(const _C& _ev) const noexcept
 	{
 		auto _name				= this->opG_[i].getNameS();
 		// check the norm
-		auto _op_transformed	= SystemProperties::transform_operator(arma::Mat<_T>(this->MG_[i]), arma::Mat<_T>(_ev));
+		auto _op_transformed	= Operators::applyOverlapMat(arma::Mat<_T>(_ev), *this->MG_[i]);
 		auto _op_norm			= SystemProperties::hilber_schmidt_norm(_op_transformed);
-		auto _op_norm_nt		= SystemProperties::hilber_schmidt_norm(arma::Mat<_T>(this->MG_[i]));
+		auto _op_norm_nt		= SystemProperties::hilber_schmidt_norm(arma::Mat<_T>(*this->MG_[i]));
 		LOGINFO("[" + _name + "]" + VEQ(_op_norm), LOG_TYPES::TRACE, 1);
 		LOGINFO("[" + _name + "]" + VEQ(_op_norm_nt), LOG_TYPES::TRACE, 2);
 	}
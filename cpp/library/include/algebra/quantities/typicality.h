@@ -0,0 +1,274 @@
+#pragma once
+
+/*********************************
+* Contains the thermal averages from
+* the quantum typicality. The random
+* vectors are evolved in the imaginary
+* time with the Chebyshev expansion of
+* exp(-tau H) (sparse products only),
+* so that Z(beta), <H>, C_V and the
+* operator averages are obtained on a
+* grid of beta without the spectrum.
+* The error bars are the jackknife
+* over the random vectors.
+* Ref: Jin et al., JPSJ 90, 012001 (2021)
+*********************************/
+
+#include "armadillo"
+#ifndef TYPICALITY_H
+#define TYPICALITY_H
+
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include "../random_streams.h"
+
+// ##########################################################################################################################################
+// ##########################################################################################################################################
+// ######################################################### T Y P I C A L I T Y ############################################################
+// ##########################################################################################################################################
+// ##########################################################################################################################################
+
+namespace Typicality
+{
+	constexpr double TYP_STEP_X				= 20.0;											// largest a * dtau of a single Chebyshev step (e^-x I_k(x) stays accurate)
+	constexpr double TYP_TOL				= 1e-14;										// truncation of the expansion
+	constexpr uint TYP_BLOCK				= 8;											// random vectors evolved together (one sparse-dense product per order)
+
+	using cpxMat							= arma::Mat<std::complex<double>>;
+
+	/*
+	* @brief Thermal curves on the grid of beta (the errors - jackknife over the random vectors)
+	*/
+	struct Result
+	{
+		arma::Col<double> betas_;
+		arma::Col<double> logZ_;													// log Z(beta) (the shift of the ground state bound included)
+		arma::Col<double> E_, EErr_;												// <H>
+		arma::Col<double> C_, CErr_;												// C_V = beta^2 (<H^2> - <H>^2)
+		arma::Mat<double> O_, OErr_;												// <O_i> (n_beta x n_ops)
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Imaginary time propagator exp(-tau (H - e0)), e0 = b - a is the lower bound of the spectrum (b, a must enclose the whole
+	* spectrum - e.g. the Gershgorin bound of KPM::bounds), therefore, the norms never grow. exp(-x (H' + 1)) = e^-x [I_0(x) + 2 sum_k (-1)^k I_k(x) T_k(H')], x = a tau, H' = (H - b) / a. Long steps are split so
+	* that x <= TYP_STEP_X.
+	*/
+	template <typename _M>
+	class ImagPropagator
+	{
+	protected:
+		const _M& H_;
+		double a_							= 1.0;
+		double b_							= 0.0;
+
+		auto apply(const cpxMat& _V)		const -> cpxMat			{ return (SystemProperties::TimeEvolution::apply_block(this->H_, _V) - this->b_ * _V) / this->a_;	};
+
+	public:
+		ImagPropagator(const _M& _H, double _a, double _b)
+			: H_(_H), a_(_a), b_(_b)										{};
+
+		auto e0()							const -> double			{ return this->b_ - this->a_;		};
+
+		/*
+		* @brief Evolves the block of the vectors by the imaginary time _tau
+		*/
+		auto evolve(const cpxMat& _V, double _tau) const -> cpxMat
+		{
+			if (_tau <= 0.0)
+				return _V;
+			const double _xTot				= this->a_ * _tau;
+			const uint _steps				= (uint)std::ceil(_xTot / TYP_STEP_X);
+			const double _x					= _xTot / _steps;
+			const uint _maxOrder			= (uint)(_x + 20.0 * std::cbrt(_x) + 30.0);
+			cpxMat _ret						= _V;
+			for (uint s = 0; s < _steps; ++s)
+			{
+				cpxMat _t0					= _ret;
+				cpxMat _t1					= this->apply(_t0);
+				const double _ex			= std::exp(-_x);
+				_ret						= (_ex * std::cyl_bessel_i(0.0, _x)) * _t0 - (2.0 * _ex * std::cyl_bessel_i(1.0, _x)) * _t1;
+				double _sgn					= -1.0;
+				for (uint k = 2; k < _maxOrder; ++k)
+				{
+					const double _ck		= _ex * std::cyl_bessel_i((double)k, _x);
+					cpxMat _t2				= 2.0 * this->apply(_t1) - _t0;
+					_sgn					= -_sgn;
+					_ret					+= (2.0 * _sgn * _ck) * _t2;
+					_t0						= std::move(_t1);
+					_t1						= std::move(_t2);
+					if (k > _x && _ck < TYP_TOL)
+						break;
+				}
+			}
+			return _ret;
+		}
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Leave-one-out ratios sum_r w_r x_r / sum_r w_r for the jackknife
+	*/
+	inline auto looRatio(const arma::Col<double>& _w, const arma::Col<double>& _x) -> arma::Col<double>
+	{
+		const double _sw					= arma::sum(_w);
+		const double _swx					= arma::dot(_w, _x);
+		if (_w.n_elem < 2)
+			return arma::Col<double>({ _swx / _sw });
+		return (_swx - _w % _x) / (_sw - _w);
+	}
+
+	/*
+	* @brief Jackknife error of the leave-one-out estimates
+	*/
+	inline auto looError(const arma::Col<double>& _loo) -> double
+	{
+		const double _n						= (double)_loo.n_elem;
+		if (_loo.n_elem < 2)
+			return 0.0;
+		return std::sqrt((_n - 1.0) / _n * arma::accu(arma::square(_loo - arma::mean(_loo))));
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Thermal averages from _R random phase vectors |r> (|r|^2 = Nh, the r-th substream of _stream). Each vector goes through
+	* the sorted grid of beta with |beta> = exp(-beta H / 2)|r>, Z ~ <beta|beta>, <A> = sum_r <beta_r|A|beta_r> / sum_r <beta_r|beta_r>.
+	* The blocks of TYP_BLOCK vectors run on the threads, the per vector values are merged in the order of the vectors.
+	* @param _H Hamiltonian (sparse or dense)
+	* @param _a, _b rescaling of the spectrum (the half width and the center, a proven bound, e.g. KPM::bounds)
+	* @param _betas grid of the inverse temperatures (ascending)
+	* @param _R number of the random vectors
+	* @param _nO number of the operators
+	* @param _eval averages of the operators on the block of the normalized vectors, _eval(V) -> (_nO x n_vectors) matrix of <v|O|v>
+	*/
+	template <typename _M, typename _F>
+	inline auto thermalWith(const _M& _H, double _a, double _b, const arma::Col<double>& _betas, uint _R,
+							const RandomStreams::Stream& _stream, uint _nO, _F&& _eval, uint _threads = 1) -> Result
+	{
+		const u64 _Nh						= _H.n_rows;
+		const uint _nB						= (uint)_betas.n_elem;
+		ImagPropagator<_M> _prop(_H, _a, _b);
+
+		// per vector: log of the weight, <H>, <H^2> and the operators (normalized states)
+		arma::Mat<double> _lw(_nB, _R), _h(_nB, _R), _h2(_nB, _R);
+		arma::Cube<double> _o(_nB, _R, std::max(_nO, 1u), arma::fill::zeros);
+
+		const long long _nBlocks			= (long long)((_R + TYP_BLOCK - 1) / TYP_BLOCK);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(_threads, 1u)) schedule(dynamic)
+#endif
+		for (long long blk = 0; blk < _nBlocks; ++blk)
+		{
+			const uint _r0					= (uint)blk * TYP_BLOCK;
+			const uint _n					= std::min<uint>(TYP_BLOCK, _R - _r0);
+			cpxMat _V(_Nh, _n);
+			for (uint c = 0; c < _n; ++c)
+			{
+				const auto _sub				= _stream.sub(_r0 + c);
+				for (u64 i = 0; i < _Nh; ++i)
+					_V(i, c)				= std::polar(1.0, TWOPI * _sub.uniform(i));
+			}
+			arma::Row<double> _logw(_n);
+			_logw.fill(std::log((double)_Nh));
+			_V								= arma::normalise(_V, 2, 0);
+
+			double _bPrev					= 0.0;
+			for (uint j = 0; j < _nB; ++j)
+			{
+				_V							= _prop.evolve(_V, 0.5 * (_betas(j) - _bPrev));
+				_bPrev						= _betas(j);
+
+				// renormalize, the norms go to the weights
+				const arma::Row<double> _nrm	= arma::sqrt(arma::real(arma::sum(arma::conj(_V) % _V, 0)));
+				_logw						+= 2.0 * arma::log(_nrm);
+				_V.each_row()				/= arma::conv_to<arma::Row<std::complex<double>>>::from(_nrm);
+
+				const cpxMat _HV			= SystemProperties::TimeEvolution::apply_block(_H, _V);
+				const arma::Row<double> _eh	= arma::real(arma::sum(arma::conj(_V) % _HV, 0));
+				const arma::Row<double> _eh2= arma::real(arma::sum(arma::conj(_HV) % _HV, 0));
+				for (uint c = 0; c < _n; ++c)
+				{
+					_lw(j, _r0 + c)			= _logw(c);
+					_h(j, _r0 + c)			= _eh(c);
+					_h2(j, _r0 + c)			= _eh2(c);
+				}
+				if (_nO > 0)
+				{
+					const arma::Mat<double> _eo	= _eval(_V);
+					for (uint k = 0; k < _nO; ++k)
+						for (uint c = 0; c < _n; ++c)
+							_o(j, _r0 + c, k)	= _eo(k, c);
+				}
+			}
+		}
+
+		// combine the vectors
+		Result _res;
+		_res.betas_							= _betas;
+		_res.logZ_.zeros(_nB);
+		_res.E_.zeros(_nB);		_res.EErr_.zeros(_nB);
+		_res.C_.zeros(_nB);		_res.CErr_.zeros(_nB);
+		_res.O_.zeros(_nB, _nO);	_res.OErr_.zeros(_nB, _nO);
+		const double _e0					= _prop.e0();
+		for (uint j = 0; j < _nB; ++j)
+		{
+			const arma::Col<double> _lwj	= _lw.row(j).t();
+			const double _lmax				= _lwj.max();
+			const arma::Col<double> _w		= arma::exp(_lwj - _lmax);
+			const double _beta				= _betas(j);
+			_res.logZ_(j)					= _lmax + std::log(arma::mean(_w)) - _beta * _e0;
+
+			const arma::Col<double> _hj		= _h.row(j).t();
+			const arma::Col<double> _h2j	= _h2.row(j).t();
+			const double _E					= arma::dot(_w, _hj) / arma::sum(_w);
+			const double _E2				= arma::dot(_w, _h2j) / arma::sum(_w);
+			const arma::Col<double> _Eloo	= looRatio(_w, _hj);
+			const arma::Col<double> _E2loo	= looRatio(_w, _h2j);
+			_res.E_(j)						= _E;
+			_res.EErr_(j)					= looError(_Eloo);
+			_res.C_(j)						= _beta * _beta * (_E2 - _E * _E);
+			_res.CErr_(j)					= looError(_beta * _beta * (_E2loo - arma::square(_Eloo)));
+			for (uint k = 0; k < _nO; ++k)
+			{
+				const arma::Col<double> _ok	= arma::Col<double>(_o.slice(k).row(j).t());
+				_res.O_(j, k)				= arma::dot(_w, _ok) / arma::sum(_w);
+				_res.OErr_(j, k)			= looError(looRatio(_w, _ok));
+			}
+		}
+		return _res;
+	}
+
+	/*
+	* @brief The matrix of the operator itself or the one pointed to (e.g. the shared matrices of Measurement::getOpG_mat)
+	*/
+	template <typename _Mo>
+	inline auto deref(const _Mo& _o) -> const _Mo&									{ return _o;  };
+	template <typename _Mo>
+	inline auto deref(const std::shared_ptr<_Mo>& _o) -> const _Mo&					{ return *_o; };
+
+	/*
+	* @brief Thermal averages from _R random phase vectors (see thermalWith) with the operators given by their matrices
+	* @param _ops operators for the thermal averages (any matrix accepted by apply_block, or the shared pointers to them)
+	*/
+	template <typename _M, typename _Mo>
+	inline auto thermal(const _M& _H, double _a, double _b, const arma::Col<double>& _betas, uint _R,
+						const RandomStreams::Stream& _stream, const std::vector<_Mo>& _ops = {}, uint _threads = 1) -> Result
+	{
+		auto _eval = [&](const cpxMat& _V) -> arma::Mat<double>
+			{
+				arma::Mat<double> _out(_ops.size(), _V.n_cols);
+				for (uint k = 0; k < _ops.size(); ++k)
+					_out.row(k)				= arma::real(arma::sum(arma::conj(_V) % SystemProperties::TimeEvolution::apply_block(deref(_ops[k]), _V), 0));
+				return _out;
+			};
+		return thermalWith(_H, _a, _b, _betas, _R, _stream, (uint)_ops.size(), _eval, _threads);
+	}
+};
+
+#endif // !TYPICALITY_H
@@ -0,0 +1,269 @@
+#pragma once
+/***********************************
+* Defines the counter-based random
+* streams (Philox4x32-10). A number is
+* a pure function of the key (seed)
+* and the counter (realization, stream,
+* index), therefore, the random matrices
+* and the disorder can be filled by any
+* number of threads in any order and the
+* result is always the same.
+***********************************/
+
+#ifndef RANDOM_STREAMS_H
+#define RANDOM_STREAMS_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <complex>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
+
+namespace RandomStreams
+{
+	constexpr uint32_t PHILOX_M0			= 0xD2511F53;
+	constexpr uint32_t PHILOX_M1			= 0xCD9E8D57;
+	constexpr uint32_t PHILOX_W0			= 0x9E3779B9;
+	constexpr uint32_t PHILOX_W1			= 0xBB67AE85;
+	constexpr uint32_t PHILOX_ROUNDS		= 10;
+	constexpr double PHILOX_2M53			= 1.0 / 9007199254740992.0;						// 2^-53
+	constexpr u64 STREAMS_PARALLEL_MIN		= 0x10000;										// minimal number of the elements for the threaded fill
+
+	using Block								= std::array<uint32_t, 4>;
+
+	/*
+	* @brief Philox4x32-10 bijection of the counter under the key
+	* @param _ctr counter (4 words)
+	* @param _key key (2 words)
+	* @returns 4 random words
+	*/
+	inline Block philox(Block _ctr, std::array<uint32_t, 2> _key)
+	{
+		for (uint32_t _r = 0; _r < PHILOX_ROUNDS; ++_r)
+		{
+			const uint64_t _p0	= (uint64_t)PHILOX_M0 * _ctr[0];
+			const uint64_t _p1	= (uint64_t)PHILOX_M1 * _ctr[2];
+			_ctr				= { (uint32_t)(_p1 >> 32) ^ _ctr[1] ^ _key[0], (uint32_t)_p1, (uint32_t)(_p0 >> 32) ^ _ctr[3] ^ _key[1], (uint32_t)_p0 };
+			_key[0]				+= PHILOX_W0;
+			_key[1]				+= PHILOX_W1;
+		}
+		return _ctr;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Stream of the random numbers keyed by (seed, realization, stream). The i-th block gives two uniform numbers
+	* with 53 random bits or two normal numbers (Box-Muller), so the k-th number of the sequence is independent of the
+	* order in which the numbers are requested.
+	*/
+	class Stream
+	{
+	protected:
+		u64 seed_							= 0;
+		u64 real_							= 0;
+		u64 stream_							= 0;
+
+	public:
+		Stream()							= default;
+		Stream(u64 _seed, u64 _real, u64 _stream)
+			: seed_(_seed), real_(_real), stream_(_stream)									{};
+
+		auto seed()							const -> u64									{ return this->seed_;		};
+		auto realization()					const -> u64									{ return this->real_;		};
+		auto stream()						const -> u64									{ return this->stream_;		};
+		auto sub(u64 _id)					const -> Stream									{ return Stream(this->seed_ ^ (0x9E3779B97F4A7C15ULL * (_id + 1)), this->real_, this->stream_); };
+
+		/*
+		* @brief Random words of the i-th block
+		*/
+		auto block(u64 _i)					const -> Block
+		{
+			const Block _ctr				= { (uint32_t)_i, (uint32_t)(_i >> 32), (uint32_t)this->real_, (uint32_t)this->stream_ };
+			const std::array<uint32_t, 2> _key = { (uint32_t)this->seed_ ^ (uint32_t)(this->real_ >> 32), (uint32_t)(this->seed_ >> 32) ^ (uint32_t)(this->stream_ >> 32) };
+			return philox(_ctr, _key);
+		}
+
+		/*
+		* @brief Two uniform numbers in [0, 1) of the i-th block
+		*/
+		auto uniform2(u64 _i)				const -> std::pair<double, double>
+		{
+			const Block _b					= this->block(_i);
+			const u64 _u0					= (((u64)_b[0] << 32) | _b[1]) >> 11;
+			const u64 _u1					= (((u64)_b[2] << 32) | _b[3]) >> 11;
+			return { _u0 * PHILOX_2M53, _u1 * PHILOX_2M53 };
+		}
+
+		/*
+		* @brief Two independent standard normal numbers of the i-th block (Box-Muller)
+		*/
+		auto normal2(u64 _i)				const -> std::pair<double, double>
+		{
+			const auto [_u0, _u1]			= this->uniform2(_i);
+			const double _r					= std::sqrt(-2.0 * std::log(1.0 - _u0));
+			const double _phi				= TWOPI * _u1;
+			return { _r * std::cos(_phi), _r * std::sin(_phi) };
+		}
+
+		auto uniform(u64 _k)				const -> double									{ auto _p = this->uniform2(_k >> 1); return (_k & 1) ? _p.second : _p.first;	};
+		auto normal(u64 _k)					const -> double									{ auto _p = this->normal2(_k >> 1); return (_k & 1) ? _p.second : _p.first;		};
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Fills the array with the uniform numbers in [_a, _b) - the k-th element is the k-th number of the stream
+	*/
+	inline void uniform(const Stream& _s, double* _out, u64 _n, double _a = 0.0, double _b = 1.0, int _threads = 1)
+	{
+		const long long _nb = (long long)((_n + 1) / 2);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(1, _threads)) schedule(static) if(_n >= STREAMS_PARALLEL_MIN)
+#endif
+		for (long long i = 0; i < _nb; ++i)
+		{
+			const auto [_u0, _u1]	= _s.uniform2((u64)i);
+			_out[2 * i]				= _a + (_b - _a) * _u0;
+			if ((u64)(2 * i + 1) < _n)
+				_out[2 * i + 1]		= _a + (_b - _a) * _u1;
+		}
+	}
+
+	/*
+	* @brief Fills the array with the normal numbers N(_mean, _std^2) - the k-th element is the k-th number of the stream
+	*/
+	inline void normal(const Stream& _s, double* _out, u64 _n, double _mean = 0.0, double _std = 1.0, int _threads = 1)
+	{
+		const long long _nb = (long long)((_n + 1) / 2);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(1, _threads)) schedule(static) if(_n >= STREAMS_PARALLEL_MIN)
+#endif
+		for (long long i = 0; i < _nb; ++i)
+		{
+			const auto [_g0, _g1]	= _s.normal2((u64)i);
+			_out[2 * i]				= _mean + _std * _g0;
+			if ((u64)(2 * i + 1) < _n)
+				_out[2 * i + 1]		= _mean + _std * _g1;
+		}
+	}
+
+	/*
+	* @brief Vector (arma::Col or std::vector) of the uniform numbers in [_a, _b)
+	*/
+	template <typename _V>
+	inline _V uniform(const Stream& _s, u64 _n, double _a = 0.0, double _b = 1.0, int _threads = 1)
+	{
+		_V _v(_n);
+		uniform(_s, &_v[0], _n, _a, _b, _threads);
+		return _v;
+	}
+
+	/*
+	* @brief Vector (arma::Col or std::vector) of the normal numbers N(_mean, _std^2)
+	*/
+	template <typename _V>
+	inline _V normal(const Stream& _s, u64 _n, double _mean = 0.0, double _std = 1.0, int _threads = 1)
+	{
+		_V _v(_n);
+		normal(_s, &_v[0], _n, _mean, _std, _threads);
+		return _v;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Gaussian random matrix H = (A + A^dag) / 2 with the elements of A from N(0, 1) (the real and imaginary parts
+	* from N(0, 1/2) for the complex type) - GOE for the real and GUE for the complex type. The matrix element (i, j) of A is
+	* the (j * n + i)-th number of the stream, so the columns are filled in parallel.
+	* @param _s stream
+	* @param _n dimension
+	* @param _threads number of the threads
+	*/
+	template <typename _T>
+	inline arma::Mat<_T> gaussian(const Stream& _s, u64 _n, int _threads = 1)
+	{
+		arma::Mat<_T> _A(_n, _n);
+		if constexpr (std::is_same_v<_T, double>)
+			normal(_s, _A.memptr(), _n * _n, 0.0, 1.0, _threads);
+		else
+			normal(_s, reinterpret_cast<double*>(_A.memptr()), 2 * _n * _n, 0.0, 1.0 / std::sqrt(2.0), _threads);
+
+		// symmetrize in place (upper triangle from the lower one)
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(1, _threads)) schedule(dynamic, 64) if(_n * _n >= STREAMS_PARALLEL_MIN)
+#endif
+		for (long long j = 0; j < (long long)_n; ++j)
+		{
+			if constexpr (!std::is_same_v<_T, double>)
+				_A(j, j)			= std::real(_A(j, j));
+			for (u64 i = j + 1; i < _n; ++i)
+			{
+				const _T _h			= 0.5 * (_A(i, j) + algebra::conjugate(_A(j, i)));
+				_A(i, j)			= _h;
+				_A(j, i)			= algebra::conjugate(_h);
+			}
+		}
+		return _A;
+	}
+
+	/*
+	* @brief Single element (i, j) of the matrix from gaussian(_s, _n) - the same numbers of the stream, so any block of the
+	* matrix can be generated without the others (e.g., the local blocks of the distributed matrix)
+	* @param _s stream
+	* @param _n dimension
+	* @param _i row
+	* @param _j column
+	*/
+	template <typename _T>
+	inline _T gaussian(const Stream& _s, u64 _n, u64 _i, u64 _j)
+	{
+		auto _a = [&](u64 _r, u64 _c) -> _T
+			{
+				const u64 _k		= _c * _n + _r;
+				if constexpr (std::is_same_v<_T, double>)
+					return _s.normal(_k);
+				else
+					return _T(_s.normal(2 * _k), _s.normal(2 * _k + 1)) / std::sqrt(2.0);
+			};
+		if (_i == _j)
+			return std::real(_a(_i, _i));
+		if (_i > _j)
+			return 0.5 * (_a(_i, _j) + algebra::conjugate(_a(_j, _i)));
+		return algebra::conjugate(_T(0.5 * (_a(_j, _i) + algebra::conjugate(_a(_i, _j)))));
+	}
+
+	template <typename _T>
+	inline arma::Mat<_T> GOE(const Stream& _s, u64 _n, int _threads = 1)						{ return gaussian<_T>(_s, _n, _threads);	};
+	template <typename _T>
+	inline arma::Mat<_T> GUE(const Stream& _s, u64 _n, int _threads = 1)						{ return gaussian<_T>(_s, _n, _threads);	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Random choice of _k distinct elements (partial Fisher-Yates shuffle). The _draw-th choice uses its own part of the
+	* stream, so the draws can be made by different threads.
+	* @param _v elements to choose from
+	* @param _k number of the elements
+	* @param _s stream
+	* @param _draw index of the draw
+	*/
+	template <typename _VT>
+	inline _VT choice(const _VT& _v, size_t _k, const Stream& _s, u64 _draw)
+	{
+		_VT _out		= _v;
+		const size_t _n	= _out.size();
+		_k				= std::min(_k, _n);
+		for (size_t j = 0; j < _k; ++j)
+		{
+			const size_t _p = j + std::min<size_t>(_n - j - 1, (size_t)(_s.uniform(_draw * _n + j) * (_n - j)));
+			std::swap(_out[j], _out[_p]);
+		}
+		_out.resize(_k);
+		return _out;
+	}
+};
+
+#endif // !RANDOM_STREAMS_H
@@ -0,0 +1,87 @@
+#pragma once
+/***********************************
+* Defines the succinct rank index over
+* the full Hilbert space. It allows to
+* find the position of a representative
+* in the sorted mapping in O(1) instead
+* of the binary search.
+***********************************/
+
+#ifndef RANK_INDEX_H
+#define RANK_INDEX_H
+
+#include <bit>
+#include <vector>
+#include <cstdint>
+
+namespace Hilbert
+{
+	constexpr u64 RANK_INDEX_MAX_BITS	= u64(1) << 34;									// maximal size of the indexed space (2GB of bits)
+	constexpr u64 RANK_INDEX_NOT_FOUND	= UINT64_MAX;									// returned when the state is not in the index
+
+	/*
+	* @brief Bitvector over the full Hilbert space with a set bit for each element of the (sorted) mapping, together with the
+	* cumulative count of the set bits before each 64-bit word. The position of a state in the mapping is then
+	* rank(s) = cum[s / 64] + popcount(word[s / 64] & mask), which costs two memory reads.
+	* The memory is NhFull / 8 bytes for the bits and NhFull / 16 bytes for the ranks - much less than the 16 bytes per state
+	* of the full map of representatives.
+	*/
+	class RankIndex
+	{
+	protected:
+		u64 size_								= 0;									// number of indexed bits (full Hilbert space)
+		std::vector<uint64_t> words_			= {};									// bitvector
+		std::vector<uint32_t> ranks_			= {};									// cumulative number of set bits before each word
+	public:
+		RankIndex()								= default;
+
+		auto empty()							const -> bool							{ return this->words_.empty();							};
+		auto reset()							-> void									{ this->size_ = 0; this->words_ = {}; this->ranks_ = {}; };
+		auto memory()							const -> u64							{ return this->words_.size() * sizeof(uint64_t) + this->ranks_.size() * sizeof(uint32_t); };
+
+		/*
+		* @brief Checks if the state is set in the index
+		*/
+		auto contains(u64 s)					const -> bool							{ return s < this->size_ && ((this->words_[s >> 6] >> (s & 63)) & 1);	};
+
+		/*
+		* @brief Returns the position of the state in the indexed (sorted) mapping or RANK_INDEX_NOT_FOUND.
+		*/
+		auto find(u64 s)						const -> u64
+		{
+			if (!this->contains(s))
+				return RANK_INDEX_NOT_FOUND;
+			const u64 _w = s >> 6;
+			return (u64)this->ranks_[_w] + (u64)std::popcount(this->words_[_w] & ((uint64_t(1) << (s & 63)) - 1));
+		}
+
+		/*
+		* @brief Builds the index from the sorted mapping
+		* @param _map sorted vector of the states
+		* @param _size size of the full space
+		* @returns true if the index was built
+		*/
+		template <typename _Vec>
+		auto build(const _Vec& _map, u64 _size) -> bool
+		{
+			this->reset();
+			if (_map.empty() || _size > RANK_INDEX_MAX_BITS || _map.size() > UINT32_MAX)
+				return false;
+			this->size_		= _size;
+			this->words_.assign((_size + 63) / 64, 0);
+			this->ranks_.assign(this->words_.size(), 0);
+			for (const auto& s : _map)
+				this->words_[s >> 6] |= uint64_t(1) << (s & 63);
+
+			uint32_t _cum	= 0;
+			for (size_t w = 0; w < this->words_.size(); ++w)
+			{
+				this->ranks_[w] = _cum;
+				_cum			+= (uint32_t)std::popcount(this->words_[w]);
+			}
+			return true;
+		}
+	};
+};
+
+#endif // !RANK_INDEX_H
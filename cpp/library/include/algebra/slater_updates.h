@@ -0,0 +1,181 @@
+#pragma once
+/***********************************
+* Defines the enumeration of the Slater
+* determinant amplitudes of a product
+* of the single particle orbitals over
+* all the occupations of N particles.
+* The occupations come in the revolving
+* door order (the weight-N subsequence
+* of the reflected Gray code), so that
+* two consecutive Slater matrices differ
+* by a single row and the determinant
+* is updated by the rank-1 formula.
+***********************************/
+
+#ifndef SLATER_UPDATES_H
+#define SLATER_UPDATES_H
+
+#include <bit>
+#include <vector>
+#include <cmath>
+
+constexpr uint SLATER_REFRESH					= 64;						// number of the rank-1 updates between the full refreshes of the inverse
+constexpr double SLATER_RATIO_TOL				= 1e-8;						// determinant ratio below which the update is replaced by the refresh
+
+namespace SlaterUpdates
+{
+	/*
+	* @brief Engine of the determinant updates. The Slater matrix A(k, j) = U(orb_j, site_k) has the rows in the order of the
+	* slots (not sorted by the site), the sign of the permutation sorting the slots is tracked separately. After the replacement of
+	* the row k with the row v, det(A') = det(A) * v^T A^{-1}[:, k] and the inverse follows from the Sherman-Morrison formula
+	* at O(N^2) per state instead of O(N^3).
+	*/
+	template <typename _T>
+	class Engine
+	{
+	protected:
+		arma::Mat<_T> R_;																// rows of the Slater matrix for each site (site x particle)
+		uint Ns_							= 0;
+		uint N_								= 0;
+		v_1d<uint> slots_;																// site in each of the slots (rows of A)
+		v_1d<uint> siteOfBit_;															// site represented by the bit of the state
+		arma::Mat<_T> A_, Ainv_;
+		_T det_								= 0.0;
+		bool valid_							= false;								// is the inverse available?
+		uint updates_						= 0;									// updates since the last refresh
+
+		/*
+		* @brief Row of the Slater matrix for the given site
+		*/
+		auto row(uint _site)				const -> arma::Row<_T>					{ return this->R_.row(_site);	};
+
+		/*
+		* @brief Sign of the permutation that sorts the slots by the site
+		*/
+		auto sign()							const -> double
+		{
+			uint _inv = 0;
+			for (uint i = 0; i < this->N_; ++i)
+				for (uint j = i + 1; j < this->N_; ++j)
+					_inv += this->slots_[i] > this->slots_[j];
+			return (_inv & 1) ? -1.0 : 1.0;
+		}
+
+		/*
+		* @brief Recomputes the determinant (with the sign of the slots) and the inverse from scratch
+		*/
+		void refresh()
+		{
+			this->det_						= arma::det(this->A_) * this->sign();
+			this->valid_					= std::abs(this->det_) > 0.0 && arma::inv(this->Ainv_, this->A_);
+			this->updates_					= 0;
+		}
+
+	public:
+		Engine(const arma::Mat<_T>& _U, const arma::uvec& _orbs, uint _Ns, const v_1d<uint>& _siteOfBit)
+			: R_(arma::Mat<_T>(_U.rows(_orbs)).st()), Ns_(_Ns), N_((uint)_orbs.n_elem), siteOfBit_(_siteOfBit)	{};
+
+		auto det()							const -> _T								{ return this->det_;		};
+
+		/*
+		* @brief Sets the occupation from scratch
+		*/
+		void set(u64 _state)
+		{
+			this->slots_.clear();
+			for (uint b = 0; b < this->Ns_; ++b)
+				if ((_state >> b) & 1ULL)
+					this->slots_.push_back(this->siteOfBit_[b]);
+			this->A_.set_size(this->N_, this->N_);
+			for (uint k = 0; k < this->N_; ++k)
+				this->A_.row(k)				= this->row(this->slots_[k]);
+			this->refresh();
+		}
+
+		/*
+		* @brief Moves the particle from the site _from to the site _to (a single row of A is replaced)
+		*/
+		void move(uint _from, uint _to)
+		{
+			uint k = 0;
+			while (this->slots_[k] != _from)
+				++k;
+
+			// the sorted position of the particle changes by the number of the particles in between
+			uint _between					= 0;
+			const uint _lo					= std::min(_from, _to);
+			const uint _hi					= std::max(_from, _to);
+			for (uint i = 0; i < this->N_; ++i)
+				_between					+= (this->slots_[i] > _lo && this->slots_[i] < _hi);
+			const double _sgn				= (_between & 1) ? -1.0 : 1.0;
+
+			const arma::Row<_T> _v			= this->row(_to);
+			this->slots_[k]					= _to;
+
+			if (this->valid_ && this->updates_ < SLATER_REFRESH)
+			{
+				const _T _ratio				= arma::as_scalar(_v * this->Ainv_.col(k));
+				if (std::abs(_ratio) > SLATER_RATIO_TOL)
+				{
+					// Sherman-Morrison: A'^{-1} = A^{-1} - A^{-1}[:, k] (v^T A^{-1} - e_k^T) / ratio
+					arma::Row<_T> _w		= _v * this->Ainv_;
+					_w(k)					-= 1.0;
+					const arma::Col<_T> _u	= this->Ainv_.col(k);
+					this->Ainv_				-= (_u * _w) / _ratio;
+					this->A_.row(k)			= _v;
+					this->det_				*= _ratio * _sgn;
+					++this->updates_;
+					return;
+				}
+			}
+			this->A_.row(k)					= _v;
+			this->refresh();
+		}
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Calls _f(state, amplitude) for all the states of N = |_orbs| particles on _Ns sites - the amplitude is the Slater determinant
+	* with the rows ordered by the site (as in QuadraticHamiltonian::getSlater). The states are streamed, nothing of the size of the
+	* Hilbert space is stored.
+	* @param _U single particle orbitals (orbital x site)
+	* @param _orbs occupied orbitals
+	* @param _Ns number of the sites
+	* @param _siteOfBit site of each bit of the state (the convention of checkBit)
+	* @param _f callback (u64 state, _T amplitude)
+	*/
+	template <typename _T, typename _F>
+	inline void forEach(const arma::Mat<_T>& _U, const arma::uvec& _orbs, uint _Ns, const v_1d<uint>& _siteOfBit, _F&& _f)
+	{
+		const uint _N		= (uint)_orbs.n_elem;
+		if (_N == 0 || _N > _Ns)
+			return;
+		Engine<_T> _engine(_U, _orbs, _Ns, _siteOfBit);
+		u64 _prev			= 0;
+		bool _first			= true;
+		for (u64 g = 0; g < ULLPOW(_Ns); ++g)
+		{
+			const u64 _state = g ^ (g >> 1);
+			if ((uint)std::popcount(_state) != _N)
+				continue;
+			if (_first)
+			{
+				_engine.set(_state);
+				_first		= false;
+			}
+			else
+			{
+				// exactly one bit removed and one added
+				const u64 _diff	= _prev ^ _state;
+				const u64 _rem	= _diff & _prev;
+				const u64 _add	= _diff & _state;
+				_engine.move(_siteOfBit[std::countr_zero(_rem)], _siteOfBit[std::countr_zero(_add)]);
+			}
+			_f(_state, _engine.det());
+			_prev			= _state;
+		}
+	}
+};
+
+#endif // !SLATER_UPDATES_H
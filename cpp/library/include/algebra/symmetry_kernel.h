@@ -0,0 +1,219 @@
+#pragma once
+/***********************************
+* Defines the bit-parallel kernel for
+* the local symmetry group acting on
+* spin-1/2 states. Each group element
+* is stored as a bit permutation with
+* a flip mask, which allows to skip the
+* type-erased operator calls when
+* looking for the representatives.
+***********************************/
+
+#ifndef SYMMETRY_KERNEL_H
+#define SYMMETRY_KERNEL_H
+
+#ifndef HILBERTSYM_H
+	#include "../hilbert_sym.h"
+#endif
+
+#include <bit>
+#include <random>
+
+namespace Hilbert
+{
+	constexpr uint SYM_KERNEL_CHUNK			= 8;										// number of bits in a single lookup chunk
+	constexpr uint SYM_KERNEL_CHUNK_SIZE	= 1 << SYM_KERNEL_CHUNK;					// number of entries in a single lookup table
+	constexpr uint SYM_KERNEL_MAX_NS		= 64;										// maximal number of sites the kernel can handle
+	constexpr uint SYM_KERNEL_NCHECK		= 256;										// number of random states used for the validation
+	constexpr double SYM_KERNEL_TOL			= 1e-12;									// tolerance for the validation of the eigenvalues
+
+	/*
+	* @brief Bit-parallel representation of the local symmetry group. Each element g of the group is assumed to act as
+	* g|s> = v_g * (+-1)^{|s|} |pi_g(s) ^ f_g>, where pi_g is a permutation of the bits, f_g is a flip mask and |s| is the number
+	* of set bits. This covers the translations, reflections, parities (\\sigma^x, \\sigma^y, \\sigma^z) and their combinations.
+	* The permutation is applied with precomputed lookup tables of SYM_KERNEL_CHUNK bits each.
+	* The structure is discovered by probing the operators and validated on random states - if any of the elements
+	* does not follow the form, the kernel is marked invalid and the standard operators shall be used.
+	*/
+	template <typename _T>
+	class SymGroupKernel
+	{
+	protected:
+		uint Ns_											= 0;						// number of bits in the state
+		uint nChunks_										= 0;						// number of lookup chunks
+		size_t size_										= 0;						// number of group elements
+		bool valid_											= false;					// can the kernel be used?
+
+		v_1d<u64> flip_										= {};						// flip masks of the elements
+		v_1d<_T> val0_										= {};						// eigenvalues when acting on the vacuum
+		v_1d<uint8_t> zPar_									= {};						// does the eigenvalue depend on the parity of the state?
+		v_1d<u64> table_									= {};						// lookup tables [element][chunk][byte]
+
+	public:
+		SymGroupKernel()									= default;
+
+		// ------------------------------------------------------------------------------------------------------
+
+		auto isValid()										const -> bool				{ return this->valid_;										};
+		auto size()											const -> size_t				{ return this->size_;										};
+		auto reset()										-> void						{ *this = SymGroupKernel<_T>();								};
+
+		/*
+		* @brief Acts with the g-th group element on the state (without the eigenvalue)
+		* @param g index of the group element
+		* @param s state to be acted upon
+		* @returns transformed state
+		*/
+		auto act(size_t g, u64 s)							const -> u64
+		{
+			const u64* _tab = this->table_.data() + g * this->nChunks_ * SYM_KERNEL_CHUNK_SIZE;
+			u64 _out		= 0;
+			for (uint c = 0; c < this->nChunks_; ++c, _tab += SYM_KERNEL_CHUNK_SIZE)
+				_out		|= _tab[(s >> (c * SYM_KERNEL_CHUNK)) & (SYM_KERNEL_CHUNK_SIZE - 1)];
+			return _out ^ this->flip_[g];
+		}
+
+		/*
+		* @brief Eigenvalue of the g-th group element acting on the state
+		* @param g index of the group element
+		* @param s state to be acted upon
+		*/
+		auto val(size_t g, u64 s)							const -> _T					{ return (this->zPar_[g] && (std::popcount(s) & 1)) ? -this->val0_[g] : this->val0_[g]; };
+
+		// ------------------------------------------------------------------------------------------------------
+
+		/*
+		* @brief Finds the smallest state in the orbit of the state s and the eigenvalue connected to reaching it
+		* @param s state to be acted upon
+		* @returns pair of the representative and the eigenvalue
+		*/
+		auto findRep(u64 s)									const -> std::pair<u64, _T>
+		{
+			u64 _min		= INT64_MAX;
+			size_t _gMin	= 0;
+			for (size_t g = 0; g < this->size_; ++g)
+			{
+				const u64 _new = this->act(g, s);
+				if (_new < _min)
+				{
+					_min	= _new;
+					_gMin	= g;
+				}
+			}
+			return std::make_pair(_min, this->val(_gMin, s));
+		}
+
+		/*
+		* @brief Sums the eigenvalues of the group elements that leave the state invariant
+		* @param s state to be acted upon
+		*/
+		auto stabilizer(u64 s)								const -> _T
+		{
+			_T _norm		= 0.0;
+			for (size_t g = 0; g < this->size_; ++g)
+				if (this->act(g, s) == s)
+					_norm	+= this->val(g, s);
+			return _norm;
+		}
+
+		// ------------------------------------------------------------------------------------------------------
+
+		auto build(const v_1d<Operators::Operator<_T>>& _G, uint _Ns) -> bool;
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Builds the lookup tables from the symmetry group operators. The flip mask is obtained from the action on the vacuum,
+	* while the permutation from the action on single bits. The result is validated on random states.
+	* @param _G symmetry group operators
+	* @param _Ns number of bits in the state
+	* @returns true if the kernel can be used instead of the operators
+	*/
+	template <typename _T>
+	inline bool SymGroupKernel<_T>::build(const v_1d<Operators::Operator<_T>>& _G, uint _Ns)
+	{
+		this->reset();
+		if (_G.empty() || _Ns == 0 || _Ns > SYM_KERNEL_MAX_NS)
+			return false;
+
+		this->Ns_			= _Ns;
+		this->nChunks_		= (_Ns + SYM_KERNEL_CHUNK - 1) / SYM_KERNEL_CHUNK;
+		this->size_			= _G.size();
+		const u64 _mask		= (_Ns == 64) ? ~u64(0) : ((u64(1) << _Ns) - 1);
+
+		this->flip_.resize(this->size_);
+		this->val0_.resize(this->size_);
+		this->zPar_.resize(this->size_);
+		this->table_.assign(this->size_ * this->nChunks_ * SYM_KERNEL_CHUNK_SIZE, 0);
+
+		v_1d<uint> _perm(_Ns);
+		for (size_t g = 0; g < this->size_; ++g)
+		{
+			const auto& _op			= _G[g];
+
+			// vacuum gives the flip mask and the bare eigenvalue
+			auto [_f, _v0]			= _op(u64(0));
+			if ((_f & ~_mask) != 0 || std::abs(_v0) < SYM_KERNEL_TOL)
+				return false;
+			this->flip_[g]			= _f;
+			this->val0_[g]			= _v0;
+
+			// single bits give the permutation
+			for (uint i = 0; i < _Ns; ++i)
+			{
+				auto [_s, _v]		= _op(u64(1) << i);
+				const u64 _b		= _s ^ _f;
+				if (std::popcount(_b) != 1 || (_b & ~_mask) != 0)
+					return false;
+				_perm[i]			= (uint)std::countr_zero(_b);
+
+				// the eigenvalue may only change its sign with the parity
+				if (i == 0)
+				{
+					if (std::abs(_v - _v0) < SYM_KERNEL_TOL)
+						this->zPar_[g] = 0;
+					else if (std::abs(_v + _v0) < SYM_KERNEL_TOL)
+						this->zPar_[g] = 1;
+					else
+						return false;
+				}
+			}
+
+			// fill the lookup tables
+			u64* _tab				= this->table_.data() + g * this->nChunks_ * SYM_KERNEL_CHUNK_SIZE;
+			for (uint c = 0; c < this->nChunks_; ++c, _tab += SYM_KERNEL_CHUNK_SIZE)
+				for (uint b = 0; b < SYM_KERNEL_CHUNK_SIZE; ++b)
+				{
+					u64 _out		= 0;
+					for (uint j = 0; j < SYM_KERNEL_CHUNK; ++j)
+					{
+						const uint _bit = c * SYM_KERNEL_CHUNK + j;
+						if (_bit < _Ns && ((b >> j) & 1))
+							_out	|= u64(1) << _perm[_bit];
+					}
+					_tab[b]			= _out;
+				}
+		}
+
+		// validate on random states
+		std::mt19937_64 _gen(_Ns * 0x9E3779B97F4A7C15ULL + this->size_);
+		for (uint n = 0; n < SYM_KERNEL_NCHECK; ++n)
+		{
+			const u64 _s			= (n == 0) ? _mask : (_gen() & _mask);
+			for (size_t g = 0; g < this->size_; ++g)
+			{
+				auto [_sG, _vG]		= _G[g](_s);
+				if (_sG != this->act(g, _s) || std::abs(_vG - this->val(g, _s)) > SYM_KERNEL_TOL)
+				{
+					this->reset();
+					return false;
+				}
+			}
+		}
+		this->valid_				= true;
+		return true;
+	}
+};
+
+#endif // !SYMMETRY_KERNEL_H
@@ -0,0 +1,243 @@
+#pragma once
+/***********************************
+* Defines the process-wide scheduler
+* of the tasks. A single persistent pool
+* of the workers (owned by the UI, sized
+* with the number of threads) is shared
+* by the Hilbert space, the NQS and the
+* measurements, the workers can be pinned
+* to the cores spread over the NUMA nodes.
+* The number of the BLAS threads is set
+* per stage, so that the OpenMP loops
+* calling the threaded BLAS do not
+* oversubscribe the machine.
+***********************************/
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include "../NQS/NQS_base/nqs_executor.h"
+
+#if defined(__linux__)
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+#if defined(__has_include)
+#	if __has_include(<mkl_service.h>)
+#		include <mkl_service.h>
+#		define SCHED_BLAS_MKL
+#	endif
+#endif
+// threaded OpenBLAS (the threads are set with openblas_set_num_threads)
+// #define SCHED_BLAS_OPENBLAS
+#if defined(SCHED_BLAS_OPENBLAS) && !defined(SCHED_BLAS_MKL)
+extern "C" void openblas_set_num_threads(int);
+extern "C" int openblas_get_num_threads(void);
+#endif
+
+namespace Sched
+{
+	constexpr unsigned SCHED_MAX_NODES			= 64;											// maximal number of the NUMA nodes read from the system
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Number of the threads of the BLAS (1 when it is not known to the scheduler)
+	*/
+	inline auto blasThreads() -> int
+	{
+#if defined(SCHED_BLAS_MKL)
+		return mkl_get_max_threads();
+#elif defined(SCHED_BLAS_OPENBLAS)
+		return openblas_get_num_threads();
+#else
+		return 1;
+#endif
+	}
+
+	/*
+	* @brief Sets the number of the threads of the BLAS (all the threads of the process)
+	*/
+	inline void setBlasThreads(int _n)
+	{
+		_n = std::max(_n, 1);
+#if defined(SCHED_BLAS_MKL)
+		mkl_set_num_threads(_n);
+#elif defined(SCHED_BLAS_OPENBLAS)
+		openblas_set_num_threads(_n);
+#else
+		(void)_n;
+#endif
+	}
+
+	/*
+	* @brief Stage with a fixed number of the BLAS threads - restores the previous number on exit. The OpenMP loops calling
+	* the BLAS kernels inside use BlasStage _s(1), the single large products in between use all the threads.
+	*/
+	class BlasStage
+	{
+		int prev_;
+	public:
+		explicit BlasStage(int _n) : prev_(blasThreads())							{ setBlasThreads(_n);			};
+		~BlasStage()																{ setBlasThreads(this->prev_);	};
+		BlasStage(const BlasStage&)									= delete;
+		BlasStage& operator=(const BlasStage&)						= delete;
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Cores of the NUMA nodes (/sys/devices/system/node/nodeX/cpulist), a single node with all the cores otherwise
+	*/
+	inline auto numaCores() -> std::vector<std::vector<unsigned>>
+	{
+		std::vector<std::vector<unsigned>> _nodes;
+#if defined(__linux__)
+		for (unsigned n = 0; n < SCHED_MAX_NODES; ++n)
+		{
+			std::ifstream _f("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+			if (!_f.is_open())
+				continue;
+			std::string _list, _range;
+			std::getline(_f, _list);
+			std::stringstream _ss(_list);
+			std::vector<unsigned> _cores;
+			while (std::getline(_ss, _range, ','))
+			{
+				if (_range.empty())
+					continue;
+				const auto _dash	= _range.find('-');
+				const unsigned _a	= (unsigned)std::stoul(_range.substr(0, _dash));
+				const unsigned _b	= _dash == std::string::npos ? _a : (unsigned)std::stoul(_range.substr(_dash + 1));
+				for (unsigned c = _a; c <= _b; ++c)
+					_cores.push_back(c);
+			}
+			if (!_cores.empty())
+				_nodes.push_back(std::move(_cores));
+		}
+#endif
+		if (_nodes.empty())
+		{
+			_nodes.emplace_back(std::max(std::thread::hardware_concurrency(), 1u));
+			for (unsigned c = 0; c < _nodes[0].size(); ++c)
+				_nodes[0][c] = c;
+		}
+		return _nodes;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Process-wide scheduler of the tasks. The UI configures it once with the number of the threads, the modules take
+	* the shared pool instead of spawning their own threads. The pool is not reentrant - a nested or a concurrent call runs
+	* serially on the calling thread (see NQS_Executor), therefore, the stages sharing it never oversubscribe the cores.
+	*/
+	class Scheduler
+	{
+	protected:
+		std::shared_ptr<NQS_Executor> pool_;
+		unsigned threads_											= 1;
+		bool pinned_												= false;
+		int blas_													= 1;			// BLAS threads outside of the parallel loops
+		mutable std::mutex mtx_;
+
+		Scheduler()													= default;
+
+		/*
+		* @brief Pins the workers round-robin over the NUMA nodes (worker i - node i % nNodes), so that the memory bandwidth
+		* of all the nodes is used and a worker never migrates
+		*/
+		void pin()
+		{
+#if defined(__linux__)
+			const auto _nodes	= numaCores();
+			const auto& _w		= this->pool_->threads();
+			for (size_t i = 0; i < _w.size(); ++i)
+			{
+				const auto& _cores	= _nodes[i % _nodes.size()];
+				const unsigned _c	= _cores[(i / _nodes.size()) % _cores.size()];
+				cpu_set_t _set;
+				CPU_ZERO(&_set);
+				CPU_SET(_c, &_set);
+				pthread_setaffinity_np(const_cast<std::thread&>(_w[i]).native_handle(), sizeof(cpu_set_t), &_set);
+			}
+			this->pinned_		= true;
+#endif
+		}
+
+	public:
+		Scheduler(const Scheduler&)									= delete;
+		Scheduler& operator=(const Scheduler&)						= delete;
+
+		static auto get() -> Scheduler&
+		{
+			static Scheduler _s;
+			return _s;
+		}
+
+		/*
+		* @brief Starts the shared workers
+		* @param _threads number of the threads of the process
+		* @param _pin pin the workers to the cores (NUMA aware)
+		*/
+		void configure(unsigned _threads, bool _pin = false)
+		{
+			std::lock_guard<std::mutex> _lock(this->mtx_);
+			this->threads_	= std::max(_threads, 1u);
+			this->pool_		= std::make_shared<NQS_Executor>(this->threads_ > 1 ? this->threads_ : 0);
+			this->pinned_	= false;
+			if (_pin && this->threads_ > 1)
+				this->pin();
+			this->blas_		= (int)this->threads_;
+			setBlasThreads(this->blas_);
+		}
+
+		// --------------------- G E T T E R S ---------------------
+		auto threads()							const -> unsigned					{ return this->threads_;		};
+		auto pinned()							const -> bool						{ return this->pinned_;			};
+		auto blas()								const -> int						{ return this->blas_;			};
+
+		/*
+		* @brief Shared pool when it has exactly _threads workers (the per-worker buffers of the caller are sized with it),
+		* otherwise a private pool of the caller
+		*/
+		auto pool(unsigned _threads) -> std::shared_ptr<NQS_Executor>
+		{
+			std::lock_guard<std::mutex> _lock(this->mtx_);
+			if (this->pool_ && this->threads_ > 1 && this->pool_->size() == _threads)
+				return this->pool_;
+			return std::make_shared<NQS_Executor>(_threads > 1 ? _threads : 0);
+		}
+
+		/*
+		* @brief Runs _f(task, worker) for the tasks [0, _nTasks) on the shared workers (serially when not configured). The pool
+		* is taken under the lock and held by the call, so a concurrent configure() does not destroy it while running.
+		*/
+		template <typename _F>
+		void run(unsigned _nTasks, _F&& _f)
+		{
+			std::shared_ptr<NQS_Executor> _pool;
+			{
+				std::lock_guard<std::mutex> _lock(this->mtx_);
+				_pool			= this->pool_;
+			}
+			if (!_pool)
+			{
+				for (unsigned t = 0; t < _nTasks; ++t)
+					_f(t, 0);
+				return;
+			}
+			_pool->run(_nTasks, std::forward<_F>(_f));
+		}
+	};
+};
+
+#endif // !TASK_SCHEDULER_H
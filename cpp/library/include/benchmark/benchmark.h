@@ -0,0 +1,163 @@
+#pragma once
+/***********************************
+* Defines the minimal harness of the
+* benchmark suite. Each case is run
+* once to warm up and then repeated,
+* the statistics of the wall times
+* (min, median, mean, std) and the
+* case parameters are written as JSON
+* so that the versions can be compared.
+***********************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <map>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+
+#ifndef QES_BENCH_VERSION
+#	define QES_BENCH_VERSION "unknown"
+#endif
+
+namespace Benchmark
+{
+	using Params = std::map<std::string, std::string>;
+
+	/*
+	* @brief Result of a single case - the wall times of the repetitions [s] and the derived statistics
+	*/
+	struct Result
+	{
+		std::string name;
+		Params params;
+		Params extra;																	// quantities reported by the case (e.g. nnz, Hilbert size)
+		std::vector<double> times;
+
+		auto min()							const -> double									{ return *std::min_element(this->times.begin(), this->times.end());	};
+		auto mean()							const -> double									{ return std::accumulate(this->times.begin(), this->times.end(), 0.0) / this->times.size(); };
+		auto median()						const -> double
+		{
+			std::vector<double> _t			= this->times;
+			std::sort(_t.begin(), _t.end());
+			const size_t _n					= _t.size();
+			return (_n % 2) ? _t[_n / 2] : 0.5 * (_t[_n / 2 - 1] + _t[_n / 2]);
+		}
+		auto std()							const -> double
+		{
+			const double _m					= this->mean();
+			double _s						= 0.0;
+			for (auto _t : this->times)
+				_s							+= (_t - _m) * (_t - _m);
+			return this->times.size() > 1 ? std::sqrt(_s / (this->times.size() - 1)) : 0.0;
+		}
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Collection of the cases. The case is the pair (setup, run) - only the run is timed, the setup prepares a fresh state
+	* before each repetition (e.g. clears the matrix). The run may fill the extra quantities of the result.
+	*/
+	class Suite
+	{
+	protected:
+		std::string filter_					= "";											// only the cases whose names contain it are run
+		uint reps_							= 5;											// timed repetitions of each case
+		uint threads_						= 1;
+		std::vector<Result> results_;
+
+		static auto escape(const std::string& _s) -> std::string
+		{
+			std::string _o;
+			for (char c : _s)
+			{
+				if (c == '"' || c == '\\')
+					_o						+= '\\';
+				_o							+= c;
+			}
+			return _o;
+		}
+
+		static void writeParams(std::ostream& _o, const Params& _p)
+		{
+			_o << "{";
+			bool _first						= true;
+			for (const auto& [_k, _v] : _p)
+			{
+				_o << (_first ? "" : ", ") << "\"" << escape(_k) << "\": \"" << escape(_v) << "\"";
+				_first						= false;
+			}
+			_o << "}";
+		}
+
+	public:
+		Suite(uint _reps = 5, uint _threads = 1, const std::string& _filter = "")
+			: filter_(_filter), reps_(std::max(_reps, 1u)), threads_(std::max(_threads, 1u))		{};
+
+		auto results()						const -> const std::vector<Result>&				{ return this->results_;							};
+		auto threads()						const -> uint									{ return this->threads_;							};
+		auto selected(const std::string& _name) const -> bool							{ return this->filter_.empty() || _name.find(this->filter_) != std::string::npos; };
+
+		/*
+		* @brief Runs the case - a single untimed warm-up, then the timed repetitions
+		* @param _name name of the case (stage/model)
+		* @param _params parameters of the case (lattice size, symmetries...)
+		* @param _setup called before each run (untimed)
+		* @param _run timed part, it may fill the extra quantities
+		*/
+		void run(const std::string& _name, const Params& _params, const std::function<void()>& _setup, const std::function<void(Params&)>& _run)
+		{
+			if (!this->selected(_name))
+				return;
+			Result _r;
+			_r.name							= _name;
+			_r.params						= _params;
+			_setup();
+			_run(_r.extra);
+			for (uint i = 0; i < this->reps_; ++i)
+			{
+				_setup();
+				const auto _t0				= std::chrono::steady_clock::now();
+				_run(_r.extra);
+				_r.times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - _t0).count());
+			}
+			LOGINFO(_name + " " + VEQP(_r.median(), 6) + "s", LOG_TYPES::TRACE, 1);
+			this->results_.push_back(std::move(_r));
+		}
+
+		/*
+		* @brief Writes all the results as a single JSON document
+		*/
+		void json(std::ostream& _o) const
+		{
+			_o << "{\n  \"version\": \"" << escape(QES_BENCH_VERSION) << "\",\n";
+			_o << "  \"threads\": " << this->threads_ << ",\n";
+			_o << "  \"repetitions\": " << this->reps_ << ",\n";
+			_o << "  \"cases\": [\n";
+			for (size_t i = 0; i < this->results_.size(); ++i)
+			{
+				const auto& _r				= this->results_[i];
+				_o << "    {\"name\": \"" << escape(_r.name) << "\", \"params\": ";
+				writeParams(_o, _r.params);
+				_o << ", \"extra\": ";
+				writeParams(_o, _r.extra);
+				_o.precision(9);
+				_o << ", \"min\": " << _r.min() << ", \"median\": " << _r.median() << ", \"mean\": " << _r.mean() << ", \"std\": " << _r.std();
+				_o << ", \"times\": [";
+				for (size_t j = 0; j < _r.times.size(); ++j)
+					_o << (j ? ", " : "") << _r.times[j];
+				_o << "]}" << (i + 1 < this->results_.size() ? "," : "") << "\n";
+			}
+			_o << "  ]\n}\n";
+		}
+	};
+};
+
+#endif // !BENCHMARK_H
@@ -12,12 +12,30 @@
 
 // include statistics
 #include "quantities/statistics.h"
+// out-of-core eigenvectors
+#include "algebra/eigvec_store.h"
+// distributed dense eigensolver (HAMIL_USE_SCALAPACK)
+#include "algebra/dist_eigensolver.h"
+// connections for the local energy (VQMC)
+#include "algebra/local_connections.h"
+// structured (Kronecker) operators
+#include "algebra/kron_operator.h"
+// counter-based random streams
+#include "algebra/random_streams.h"
+// precompiled bond tables of the lattice models
+#include "algebra/bond_table.h"
+// flags shared by the builder threads
+#include <atomic>
+#include <utility>
+// scoped timers of the hot paths (QES_PROFILE)
+#include "quantities/profiler.h"
 
 // --- ED
 constexpr u64 UI_LIMITS_MAXFULLED								= 0x40000;
 constexpr u64 UI_LIMITS_MAXPRINT								= 0x8;
 constexpr u64 UI_LIMITS_SI_STATENUM								= 100;
 constexpr u64 UI_LIMITS_MIDDLE_SPEC_STATENUM					= 200;
+constexpr u64 UI_LIMITS_PARALLEL_BUILD							= 0x1000;			// minimal Hilbert space size for the threaded build
 
 // ############################ EXISTING MODELS ############################
 enum MY_MODELS 															// #
@@ -137,9 +155,54 @@ protected:
 	
 	// matrices
 	GeneralizedMatrix<_T> H_;							// the Hamiltonian
-	arma::Mat<_T> eigVec_;								// matrix of the eigenvectors in increasing order
+	arma::Mat<_T> eigVec_;								// matrix of the eigenvectors in increasing order (empty when streamed or distributed)
 	arma::Mat<_T> K_;									// the Krylov Vectors (if needed)
 	arma::vec eigVal_;									// eigenvalues vector
+
+	// threaded build
+	uint threadNum_										= 1;						// number of threads used for building the matrix
+	bool colBufOn_										= false;					// redirects setHElem to the column buffers
+	v_1d<v_1d<std::pair<u64, _T>>> colBuf_;											// thread local buffers (row, value) collecting a single column
+
+	// values-only reassembly (the nonzero pattern of the first build is kept for the next realizations)
+	bool reuseStruct_									= false;					// keep and reuse the CSC structure
+	arma::uvec structColPtr_;														// column pointers of the kept structure
+	arma::uvec structRowInd_;														// row indices of the kept structure
+	auto keepStructure(const arma::SpMat<_T>& _S)		-> void;					// stores the pattern of the sparse matrix
+	auto reassembleValues(arma::SpMat<_T>& _S)			-> bool;					// refills the values of the kept pattern
+
+	// diagonal pass (the models with the precompiled bond tables)
+	bool diagPass_										= false;					// the ED kernels skip the diagonal terms, those are taken from diag_
+	arma::vec diag_;																// diagonal of H in the (reduced) basis
+	auto buildDiagonal()								-> void;					// computes diag_ for all the basis states at once
+
+	// out-of-core eigenvectors
+	std::string eigStreamDir_							= "";						// directory for the eigenvector files (empty - kept in memory)
+	u64 eigStreamBlock_									= EIGVEC_STORE_BLOCK;		// columns in a single cached block
+	size_t eigStreamCache_								= EIGVEC_STORE_NBLOCKS;		// number of cached blocks
+	std::shared_ptr<EigVecStore<_T>> eigStore_;										// the store (shared between the copies)
+	auto streamEigVec()									-> void;					// moves the eigenvectors to the store
+
+	// distributed eigenvectors (block-cyclic over the ranks)
+	bool distDiag_										= false;					// full diagonalization over all the ranks (ScaLAPACK/ELPA)
+	std::shared_ptr<DistEig::DistMatrix<_T>> eigVecDist_;							// local blocks of the eigenvectors (shared between the copies)
+	auto diagHDist(bool woEigVec)						-> void;					// distributed full diagonalization
+	auto useDistDiag()									const -> bool { return this->distDiag_ && DistEig::size() > 1 && this->Nh >= DistEig::DIST_EIG_MIN; };
+	bool localBlocks_									= false;					// H_ is not built - each rank generates its blocks in diagHDist
+	virtual auto hasLocalBlocks()						const -> bool { return this->Hkron_ == nullptr && this->checkMatrixFree(); };
+#ifdef HAMIL_USE_SCALAPACK
+	virtual auto hamiltonianBlocks(DistEig::DistMatrix<_T>& _Hd) -> void;						// local blocks of H without the full matrix
+#endif
+
+	// structured representation (the models built from the Kronecker products)
+	std::shared_ptr<Operators::Kron::KronOperator<_T>> Hkron_;						// sparse part and the Kronecker factors (if provided by the model)
+
+	// counter-based random streams (seed, realization, stream)
+	u64 ranSeed_										= 0;						// key of the streams (0 - drawn from ran_ on the first use)
+	u64 ranReal_										= 0;						// realization of the disorder
+	u64 ranStream_										= 0;						// next stream within the realization
+	auto hamiltonianLocal()								-> arma::SpMat<_T>;			// sparse matrix of the locEnergy kernels (threaded build)
+	auto setStructured(std::shared_ptr<Operators::Kron::KronOperator<_T>> _H)	-> void;	// sets the structured representation and assembles H_
 public:
 	randomGen ran_;										// consistent quick random number generator
 	std::string info_;									// information about the model
@@ -167,7 +230,7 @@ public:
 	template <template <typename> class _V, typename _TV = _T>
 	static void prettyPrint(	std::ostream& output,	const _V<_TV>& state, uint Ns, double _tol = 5e-2);	
 	
-	void print(u64 _id)									const										{ this->eigVec_.col(_id).print("|"+STR(_id)+">\n");								};
+	void print(u64 _id)									const										{ this->getEigVecCol(_id).print("|"+STR(_id)+">\n");							};
 	void print()										const										{ this->H_.print("H=\n");														};
 																																												
 	// --------------------------------------------- INFO -----------------------------------------------------
@@ -192,8 +255,8 @@ public:
 	auto getHilbertSpace()								const -> const Hilbert::HilbertSpace<_T>&	{ return this->hilbertSpace;													};							
 	// energy
 	virtual auto getMeanLevelSpacing()					const -> double								{ return arma::mean(arma::diff(this->eigVal_));									};
-	virtual auto getBandwidth()							const -> double								{ return this->eigVal_(this->Nh_ - 1) - this->eigVal_(0);						};
-	virtual auto getEnergyWidth()						const -> double								{ return algebra::cast<double>(this->H_.getEnergyWidth());						};
+	virtual auto getBandwidth()							const -> double								{ return this->eigVal_(this->eigVal_.n_elem - 1) - this->eigVal_(0);				};
+	virtual auto getEnergyWidth()						const -> double								{ return this->localBlocks_ ? arma::var(this->eigVal_, 1) : algebra::cast<double>(this->H_.getEnergyWidth()); };
 	// hamiltonian
 	auto getHamiltonian()								-> const GeneralizedMatrix<_T>&				{ return this->H_;																};
 	auto getHamiltonian()								const -> GeneralizedMatrix<_T>				{ return this->H_;																};
@@ -202,10 +265,16 @@ public:
 	virtual auto getHamiltonianSize()					const -> double								{ return this->H_.size() * sizeof(this->H_.get(0, 0));							};								
 	virtual auto getHamiltonianSizeH()					const -> double								{ return std::pow(this->hilbertSpace.getHilbertSize(), 2) * sizeof(_T); };
 	auto getSymRot()									const -> arma::SpMat<_T>					{ return this->hilbertSpace.getSymRot();										};
+	auto getStructured()								const -> std::shared_ptr<Operators::Kron::KronOperator<_T>>	{ return this->Hkron_;						};
 	// eigenvectors
-	auto getEigVec()									const -> const arma::Mat<_T>&				{ return this->eigVec_;															};							
-	auto getEigVec(u64 idx)								const -> arma::subview_col<_T>				{ return this->eigVec_.col(idx);												};			
-	auto getEigVecCol(u64 idx)							const -> arma::Col<_T>						{ return this->eigVec_.col(idx);												};
+	auto getEigVec()									const -> const arma::Mat<_T>&;
+	auto loadEigVec()									-> const arma::Mat<_T>&;					// the full matrix in the memory (paged in or gathered)
+	auto getEigVec(u64 idx)								const -> arma::Col<_T>						{ return this->getEigVecCol(idx);												};			
+	auto getEigVecCol(u64 idx)							const -> arma::Col<_T>;
+	auto getEigVecBlock(u64 _start, u64 _n)				const -> arma::Mat<_T>;
+	auto isEigVecStreamed()								const -> bool								{ return this->eigStore_ && !this->eigStore_->empty() && this->eigVec_.empty();	};
+	auto isEigVecDistributed()							const -> bool								{ return DistEig::enabled && this->eigVecDist_ && this->eigVec_.empty();		};
+	auto getEigVecDist()								const -> const std::shared_ptr<DistEig::DistMatrix<_T>>&	{ return this->eigVecDist_;							};
 	auto getEigVec(u64 idx, u64 elem)					const -> _T									{ return this->eigVal_(elem, idx);												};				
 	auto getEigVec(std::string _dir, u64 _mid, 
 		HAM_SAVE_EXT _typ, bool _app = false)			const -> void;
@@ -230,11 +299,21 @@ public:
 
 	// ------------------------------------------- SETTERS -----------------------------------------------------
 	
-	auto setSeed(u64 seed)								-> void										{ this->ran_.newSeed(seed);														};
+	auto setSeed(u64 seed)								-> void										{ this->ran_.newSeed(seed); this->ranSeed_ = seed; this->ranStream_ = 0;		};
+	auto setRealization(u64 _r)							-> void										{ this->ranReal_ = _r; this->ranStream_ = 0;									};
+	auto ranStream()									-> RandomStreams::Stream;					// next counter-based stream of the realization
+	auto setThreadNum(uint _thr)						-> void										{ this->threadNum_ = std::max(_thr, 1u);										};
+	auto setEigVecStream(const std::string& _dir,
+						 u64 _block		= EIGVEC_STORE_BLOCK,
+						 size_t _cache	= EIGVEC_STORE_NBLOCKS)	-> void								{ this->eigStreamDir_ = _dir; this->eigStreamBlock_ = _block; this->eigStreamCache_ = _cache; };
+	auto setDistributedDiag(bool _on)					-> void										{ this->distDiag_ = _on && DistEig::enabled;									};
+	auto setReuseStructure(bool _on)					-> void										{ this->reuseStruct_ = _on; this->structColPtr_.reset(); this->structRowInd_.reset(); };
 
 	// ----------------------------------------- HAMILTONIAN ---------------------------------------------------
 protected:
 	virtual void hamiltonian();
+	auto hamiltonianThreaded()							-> void;									// two-pass threaded CSC build of the sparse matrix
+	auto collectColumn(u64 k, v_1d<std::pair<u64, _T>>& _col)	-> void;							// collects and merges the elements of the k-th column
 	virtual auto checkQuadratic()						-> void										{ this->isQuadratic_ = false;													};
 	virtual auto setHElem(u64 k, _T val, u64 newIdx)	-> void;									// sets the Hamiltonian elements in a virtual way
 	auto calcAvEn()										-> void;									// calculate the average energy
@@ -251,6 +330,26 @@ public:
 			   uint maxiter = 1000,
 			   double tol = 0, 
 			   std::string form = "sm")					-> void;									// diagonalize the Hamiltonian using Lanczos' method
+	// matrix-free
+	virtual auto checkMatrixFree()						const -> bool;								// can the action of H be computed from locEnergy only?
+	auto applyH(const arma::Col<_T>& _x, 
+				arma::Col<_T>& _y)						-> void;									// y = H x without storing the matrix
+	auto diagHMatrixFree(bool woEigVec,
+						 uint k,
+						 uint maxiter = 1000,
+						 double tol = 1e-10)			-> void;									// Lanczos' method with the matrix-free action of H
+	// middle of the spectrum
+	auto getEnInf()										const -> double;							// infinite temperature energy Tr(H)/Nh
+	auto diagHMiddle(bool woEigVec,
+					 uint k,
+					 double sigma = NAN,
+					 uint maxiter = 20,
+					 double tol = 1e-8)					-> void;									// k eigenpairs closest to sigma (shift-invert or polynomial filter)
+	auto diagHFilter(bool woEigVec,
+					 uint k,
+					 double sigma,
+					 uint maxiter = 20,
+					 double tol = 1e-8)					-> void;									// k eigenpairs closest to sigma with the Chebyshev filter
 
 public:
 	// ------------------------------------------ LOCAL ENERGY -------------------------------------------------
@@ -261,6 +360,20 @@ public:
 	virtual cpx locEnergy(const arma::Col<double>& v, 
 						  uint site,
 						  NQSFun f1)					{ return 0; };								// returns the local energy for VQMC purposes
+	// connection enumeration - the diagonal part and the flips with their matrix elements are written to the buffer
+	virtual auto hasLocEnergyConn()						const -> bool	{ return false; };			// are the connections implemented?
+	virtual void locEnergyConn(const arma::Col<double>& v,
+							   uint site,
+							   LocEnBuffer& _buf)					{ _buf.clear(); };
+	auto locEnergyFromConn(const arma::Col<double>& v,
+						   uint site,
+						   const NQSFun& f1)				-> cpx;								// evaluates the connections with the callback
+	// diagonal part of the whole configuration (all the sites at once)
+	virtual auto hasDiagonal()							const -> bool	{ return false; };			// is the diagonal pass implemented?
+	virtual auto diagonal(u64 _state)					const -> double	{ return 0.0;	};			// <s|H|s> for the state of the full basis
+	virtual auto diagonal(const arma::Col<double>& v)	const -> double	{ return 0.0;	};			// diagonal part of the local energy (VQMC)
+	virtual auto shareBonds(const Hamiltonian<_T, _spinModes>&)	-> bool	{ return false;	};	// takes the compiled bond tables of the same model (other sector)
+	auto getDiagonal()									-> const arma::vec&;					// diagonal of H, e.g. for the preconditioning
 	
 	// ----------------------------------------- FOR OTHER TYPES -----------------------------------------------
 	virtual void updateInfo()							= 0;
@@ -269,10 +382,10 @@ public:
 	void generateFullMap()								{ this->hilbertSpace.generateFullMap();		}; // generates the full Hilbert space map
 
 	// --------------------------------------------- CLEAR -----------------------------------------------------
-	void clearEigVec()									{ this->eigVec_.reset();					}; // resets the eigenvectors memory to 0
+	void clearEigVec()									{ this->eigVec_.reset(); this->eigStore_.reset(); this->eigVecDist_.reset();	}; // resets the eigenvectors memory to 0 (and removes the stream)
 	void clearEigVal()									{ this->eigVal_.reset();					}; // resets the energy memory to 0
 	void clearKrylov()									{ this->K_.reset();							}; // resets the Krylov memory to 0
-	virtual void clearH()								{ this->H_.reset();							}; // resets the hamiltonian memory to 0
+	virtual void clearH()								{ this->H_.reset(); this->localBlocks_ = false; }; // resets the hamiltonian memory to 0
 	void clear();
 
 	// --------------------------------------------- OTHER -----------------------------------------------------
@@ -364,6 +477,18 @@ inline Hamiltonian<_T, _spinModes>& Hamiltonian<_T, _spinModes>::operator=(const
 		this->eigVal_		= _other.eigVal_;
 		this->ran_			= _other.ran_;
 		this->info_			= _other.info_;
+		this->threadNum_	= _other.threadNum_;
+		this->reuseStruct_	= _other.reuseStruct_;
+		this->eigStreamDir_	= _other.eigStreamDir_;
+		this->eigStreamBlock_= _other.eigStreamBlock_;
+		this->eigStreamCache_= _other.eigStreamCache_;
+		this->eigStore_		= _other.eigStore_;
+		this->distDiag_		= _other.distDiag_;
+		this->eigVecDist_	= _other.eigVecDist_;
+		this->Hkron_		= _other.Hkron_;
+		this->ranSeed_		= _other.ranSeed_;
+		this->ranReal_		= _other.ranReal_;
+		this->ranStream_	= _other.ranStream_;
 	}
 	return *this;
 }
@@ -393,6 +518,18 @@ inline Hamiltonian<_T,_spinModes>& Hamiltonian<_T, _spinModes>::operator=(Hamilt
 		this->eigVal_ = std::move(_other.eigVal_);
 		this->ran_ = std::move(_other.ran_);
 		this->info_ = std::move(_other.info_);
+		this->threadNum_ = _other.threadNum_;
+		this->reuseStruct_ = _other.reuseStruct_;
+		this->eigStreamDir_ = std::move(_other.eigStreamDir_);
+		this->eigStreamBlock_ = _other.eigStreamBlock_;
+		this->eigStreamCache_ = _other.eigStreamCache_;
+		this->eigStore_ = std::move(_other.eigStore_);
+		this->distDiag_ = _other.distDiag_;
+		this->eigVecDist_ = std::move(_other.eigVecDist_);
+		this->Hkron_ = std::move(_other.Hkron_);
+		this->ranSeed_ = _other.ranSeed_;
+		this->ranReal_ = _other.ranReal_;
+		this->ranStream_ = _other.ranStream_;
 		// Optional: nullify or reset _other's members if needed
 		_other.lat_ = nullptr;
 		_other.H_ = GeneralizedMatrix<_T>();
@@ -426,7 +563,19 @@ inline Hamiltonian<_T, _spinModes>::Hamiltonian(const Hamiltonian<_T,_spinModes>
 	H_(_other.H_), 
 	eigVec_(_other.eigVec_),
 	K_(_other.K_), 
-	eigVal_(_other.eigVal_)
+	eigVal_(_other.eigVal_),
+	threadNum_(_other.threadNum_),
+	reuseStruct_(_other.reuseStruct_),
+	eigStreamDir_(_other.eigStreamDir_),
+	eigStreamBlock_(_other.eigStreamBlock_),
+	eigStreamCache_(_other.eigStreamCache_),
+	eigStore_(_other.eigStore_),
+	distDiag_(_other.distDiag_),
+	eigVecDist_(_other.eigVecDist_),
+	Hkron_(_other.Hkron_),
+	ranSeed_(_other.ranSeed_),
+	ranReal_(_other.ranReal_),
+	ranStream_(_other.ranStream_)
 {
 	CONSTRUCTOR_CALL;
 }
@@ -452,7 +601,19 @@ inline Hamiltonian<_T, _spinModes>::Hamiltonian(Hamiltonian<_T,_spinModes>&& _ot
 	H_(std::move(_other.H_)),
 	eigVec_(std::move(_other.eigVec_)),
 	K_(std::move(_other.K_)),
-	eigVal_(std::move(_other.eigVal_))
+	eigVal_(std::move(_other.eigVal_)),
+	threadNum_(_other.threadNum_),
+	reuseStruct_(_other.reuseStruct_),
+	eigStreamDir_(std::move(_other.eigStreamDir_)),
+	eigStreamBlock_(_other.eigStreamBlock_),
+	eigStreamCache_(_other.eigStreamCache_),
+	eigStore_(std::move(_other.eigStore_)),
+	distDiag_(_other.distDiag_),
+	eigVecDist_(std::move(_other.eigVecDist_)),
+	Hkron_(std::move(_other.Hkron_)),
+	ranSeed_(_other.ranSeed_),
+	ranReal_(_other.ranReal_),
+	ranStream_(_other.ranStream_)
 {
 	CONSTRUCTOR_CALL;
 }
@@ -510,13 +671,318 @@ void Hamiltonian<_T, _spinModes>::hamiltonian()
 		LOGINFOG("Empty Hilbert, not building anything.", LOG_TYPES::INFO, 1);
 		return;
 	}
+	// use the threaded builder for large sparse matrices (and whenever the structure is reused)
+	if (this->isSparse_ && ((this->threadNum_ > 1 && this->Nh >= UI_LIMITS_PARALLEL_BUILD) || this->reuseStruct_))
+	{
+		this->hamiltonianThreaded();
+		return;
+	}
+
 	this->init();
+	this->buildDiagonal();
 	for (u64 k = 0; k < this->Nh; ++k)
 	{
 		u64 kMap = this->hilbertSpace.getMapping(k);
 		for (uint site_ = 0; site_ <= this->Ns - 1; ++site_)
 			this->locEnergy(k, kMap, site_);
 	}
+	// the diagonal from the single pass
+	if (this->diagPass_)
+		for (u64 k = 0; k < this->Nh; ++k)
+			this->H_.add(k, k, algebra::cast<_T>(this->diag_(k)));
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Computes the diagonal of H for all the basis states in a single threaded pass over the tight (popcount) kernels of the model.
+* Afterwards, the ED kernels only emit the off-diagonal elements. The diagonal terms commute with the symmetries, so the element of the
+* symmetric state is the one of its representative.
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::buildDiagonal()
+{
+	this->diagPass_		= false;
+	if (!this->hasDiagonal() || this->Ns > 64)
+	{
+		this->diag_.reset();
+		return;
+	}
+	this->diag_.set_size(this->Nh);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threadNum_) schedule(static)
+#endif
+	for (long long k = 0; k < (long long)this->Nh; ++k)
+		this->diag_(k)	= this->diagonal(this->hilbertSpace.getMapping(k));
+	this->diagPass_		= true;
+}
+
+/*
+* @brief Diagonal of the Hamiltonian in the (reduced) basis - from the diagonal pass or, without it, from the matrix
+*/
+template<typename _T, uint _spinModes>
+inline const arma::vec& Hamiltonian<_T, _spinModes>::getDiagonal()
+{
+	if (this->diag_.n_elem == this->Nh)
+		return this->diag_;
+	this->buildDiagonal();
+	if (!this->diagPass_ && this->H_.size() > 0)
+	{
+		this->diag_.set_size(this->Nh);
+		for (u64 k = 0; k < this->Nh; ++k)
+			this->diag_(k) = algebra::real(this->H_(k, k));
+	}
+	return this->diag_;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Collects all the elements of the k-th column of the Hamiltonian. As setHElem always writes to the column
+* of the state acted upon, the whole column is produced by the local energies of the k-th basis state only.
+* The rows are sorted and the repeating ones are summed so that the column is ready for the CSC format.
+* @param k index of the basis state (column)
+* @param _col buffer of the calling thread (row, value), it is set by setHElem and overwritten with the merged column
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::collectColumn(u64 k, v_1d<std::pair<u64, _T>>& _col)
+{
+	_col.clear();
+	u64 kMap = this->hilbertSpace.getMapping(k);
+	for (uint site_ = 0; site_ <= this->Ns - 1; ++site_)
+		this->locEnergy(k, kMap, site_);
+	if (this->diagPass_)
+		_col.emplace_back(k, algebra::cast<_T>(this->diag_(k)));
+
+	// sort by rows and merge the duplicates
+	std::sort(_col.begin(), _col.end(), [](const auto& _a, const auto& _b) { return _a.first < _b.first; });
+	size_t _last = 0;
+	for (size_t i = 1; i < _col.size(); ++i)
+	{
+		if (_col[i].first == _col[_last].first)
+			_col[_last].second += _col[i].second;
+		else
+			_col[++_last] = _col[i];
+	}
+	if (!_col.empty())
+		_col.resize(_last + 1);
+
+	// remove the elements that cancelled out
+	_col.erase(std::remove_if(_col.begin(), _col.end(), [](const auto& _e) { return EQP(std::abs(_e.second), 0.0, 1e-15); }), _col.end());
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Builds the sparse Hamiltonian using multiple threads in two passes. First pass counts the nonzero 
+* elements in each column, then the column pointers are obtained via the prefix sum. Second pass fills the 
+* preallocated CSC arrays - each column is written by a single thread so no locking is needed.
+* The memory overhead is the single column buffer per thread.
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::hamiltonianThreaded()
+{
+	const u64 _Nh	= this->Nh;
+	const int _thr	= (int)this->threadNum_;
+	LOGINFO("Building the sparse Hamiltonian with #THREADS=" + STR(_thr), LOG_TYPES::TRACE, 3);
+
+	BEGIN_CATCH_HANDLER
+	{
+		this->buildDiagonal();
+
+		// the same pattern as in the previous build - a single pass over the kernels
+		arma::SpMat<_T> _S;
+		if (this->reassembleValues(_S))
+		{
+			this->H_ = GeneralizedMatrix<_T>(_Nh, true);
+			this->H_.setSparse(std::move(_S));
+			return;
+		}
+
+		this->colBuf_	= v_1d<v_1d<std::pair<u64, _T>>>(_thr);
+		this->colBufOn_	= true;
+
+		// ---------------- first pass - count ----------------
+		arma::uvec _colPtr(_Nh + 1, arma::fill::zeros);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_thr) schedule(dynamic, 256)
+#endif
+		for (long long k = 0; k < (long long)_Nh; ++k)
+		{
+			auto& _col		= this->colBuf_[omp_get_thread_num()];
+			this->collectColumn(k, _col);
+			_colPtr(k + 1)	= _col.size();
+		}
+
+		// prefix sum of the counts
+		for (u64 k = 0; k < _Nh; ++k)
+			_colPtr(k + 1) += _colPtr(k);
+		const u64 _nnz = _colPtr(_Nh);
+
+		// ---------------- second pass - fill ----------------
+		arma::uvec _rowInd(_nnz);
+		arma::Col<_T> _values(_nnz);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_thr) schedule(dynamic, 256)
+#endif
+		for (long long k = 0; k < (long long)_Nh; ++k)
+		{
+			auto& _col		= this->colBuf_[omp_get_thread_num()];
+			this->collectColumn(k, _col);
+			u64 _pos		= _colPtr(k);
+			for (const auto& [_row, _val] : _col)
+			{
+				_rowInd(_pos)	= _row;
+				_values(_pos)	= _val;
+				++_pos;
+			}
+		}
+		this->colBufOn_ = false;
+		this->colBuf_.clear();
+
+		// set the matrix - the arrays are already sorted within the columns
+		this->H_ = GeneralizedMatrix<_T>(_Nh, true);
+		this->H_.setSparse(arma::SpMat<_T>(_rowInd, _colPtr, _values, _Nh, _Nh, false));
+		if (this->reuseStruct_)
+		{
+			this->structColPtr_	= std::move(_colPtr);
+			this->structRowInd_	= std::move(_rowInd);
+		}
+		LOGINFO("Sparse Hamiltonian built: " + VEQ(_nnz), LOG_TYPES::TRACE, 3);
+	}
+	END_CATCH_HANDLER("Memory exceeded", std::runtime_error("Memory for the threaded Hamiltonian setting exceeded"););
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Collects the matrix of the locEnergy kernels into the sparse matrix with the threaded column builder - used by the models
+* that keep the local (spin-flip) part separately from the structured one.
+* @returns the sparse matrix of the local part
+*/
+template<typename _T, uint _spinModes>
+inline arma::SpMat<_T> Hamiltonian<_T, _spinModes>::hamiltonianLocal()
+{
+	this->buildDiagonal();
+	arma::SpMat<_T> _R;
+	if (this->reassembleValues(_R))
+		return _R;
+	this->colBuf_	= v_1d<v_1d<std::pair<u64, _T>>>(omp_get_max_threads());
+	this->colBufOn_	= true;
+	auto _S			= Operators::Builder::sparse<_T>(this->Nh, this->Nh, [&](u64 k, std::vector<std::pair<u64, _T>>& _out)
+		{
+			auto& _col	= this->colBuf_[omp_get_thread_num()];
+			this->collectColumn(k, _col);
+			_out.insert(_out.end(), _col.begin(), _col.end());
+		});
+	this->colBufOn_	= false;
+	this->colBuf_.clear();
+	this->keepStructure(_S);
+	return _S;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Stores the nonzero pattern (CSC column pointers and row indices) of the sparse matrix for the values-only reassembly
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::keepStructure(const arma::SpMat<_T>& _S)
+{
+	if (!this->reuseStruct_)
+		return;
+	_S.sync();
+	this->structColPtr_	= arma::uvec(_S.col_ptrs, _S.n_cols + 1);
+	this->structRowInd_	= arma::uvec(_S.row_indices, _S.n_nonzero);
+}
+
+/*
+* @brief Values-only reassembly - with new disorder only the values change, so the kernels are evaluated in a single pass
+* and each merged column is written directly into the slots of the kept pattern (both are sorted by the rows). Counting,
+* the prefix sum and the allocation of the structure are skipped. An element outside of the pattern (different
+* connectivity) invalidates the kept structure and the full build takes over.
+* @param _S sparse matrix with the kept pattern and the new values
+* @returns whether the pattern has been reused
+*/
+template<typename _T, uint _spinModes>
+inline bool Hamiltonian<_T, _spinModes>::reassembleValues(arma::SpMat<_T>& _S)
+{
+	if (!this->reuseStruct_ || this->structColPtr_.n_elem != this->Nh + 1)
+		return false;
+
+	const int _thr		= (int)this->threadNum_;
+	std::atomic<bool> _ok(true);
+	arma::Col<_T> _values(this->structRowInd_.n_elem, arma::fill::zeros);
+	this->colBuf_		= v_1d<v_1d<std::pair<u64, _T>>>(_thr);
+	this->colBufOn_		= true;
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_thr) schedule(dynamic, 256)
+#endif
+	for (long long k = 0; k < (long long)this->Nh; ++k)
+	{
+		if (!_ok.load(std::memory_order_relaxed))
+			continue;
+		auto& _col		= this->colBuf_[omp_get_thread_num()];
+		this->collectColumn(k, _col);
+		u64 _pos		= this->structColPtr_(k);
+		const u64 _end	= this->structColPtr_(k + 1);
+		for (const auto& [_row, _val] : _col)
+		{
+			while (_pos < _end && this->structRowInd_(_pos) < _row)
+				++_pos;
+			if (_pos == _end || this->structRowInd_(_pos) != _row)
+			{
+				_ok.store(false, std::memory_order_relaxed);
+				break;
+			}
+			_values(_pos++) = _val;
+		}
+	}
+	this->colBufOn_		= false;
+	this->colBuf_.clear();
+
+	if (!_ok)
+	{
+		LOGINFO("The nonzero pattern has changed - full build.", LOG_TYPES::TRACE, 3);
+		this->structColPtr_.reset();
+		this->structRowInd_.reset();
+		return false;
+	}
+	_S					= arma::SpMat<_T>(this->structRowInd_, this->structColPtr_, _values, this->Nh, this->Nh);
+	LOGINFO("Sparse Hamiltonian reassembled (values only): " + VEQ(_values.n_elem), LOG_TYPES::TRACE, 3);
+	return true;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Sets the structured representation of the Hamiltonian. It is added to the already initialized H_ - the dense matrix is 
+* filled block by block and the sparse one is merged by the columns, so that no Kronecker product of the full size is formed.
+* @param _H structured operator (the sparse part and the Kronecker terms)
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::setStructured(std::shared_ptr<Operators::Kron::KronOperator<_T>> _H)
+{
+	this->Hkron_	= std::move(_H);
+	if (this->H_.isSparse())
+		this->H_.setSparse(arma::SpMat<_T>(this->H_.getSparse() + this->Hkron_->sparse()));
+	else
+		this->Hkron_->addTo(this->H_.getDense());
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Returns the next counter-based stream of the current realization. The streams are handed out in the order of the
+* requests (serially), while the numbers within a stream can be generated by any number of threads - the random matrices
+* depend on (seed, realization, stream) only. Without the seed set explicitly, the key is drawn once from ran_.
+*/
+template<typename _T, uint _spinModes>
+inline RandomStreams::Stream Hamiltonian<_T, _spinModes>::ranStream()
+{
+	if (this->ranSeed_ == 0)
+		this->ranSeed_ = this->ran_.template randomInt<u64>(1, UINT32_MAX) << 32 | this->ran_.template randomInt<u64>(0, UINT32_MAX);
+	return RandomStreams::Stream(this->ranSeed_, this->ranReal_, this->ranStream_++);
 }
 
 // ##########################################################################################################################################
@@ -543,8 +1009,16 @@ void Hamiltonian<_T, _spinModes>::init()
 template<typename _T, uint _spinModes>
 inline void Hamiltonian<_T, _spinModes>::buildHamiltonian()
 {
+	PROF_SCOPE(H_BUILD);
 	auto _t = NOW;
 	LOGINFO("Started buiding Hamiltonian" + this->getInfo(), LOG_TYPES::TRACE, 2);
+	// the distributed diagonalization generates only the local blocks of each rank
+	this->localBlocks_ = DistEig::enabled && this->useDistDiag() && this->hasLocalBlocks();
+	if (this->localBlocks_)
+	{
+		LOGINFO("The local blocks are generated by each rank in the diagonalization" + this->getInfo(), LOG_TYPES::TRACE, 2);
+		return;
+	}
 	this->hamiltonian();
 	LOGINFO("Finished buiding Hamiltonian" + this->getInfo(), LOG_TYPES::TRACE, 2);
 	LOGINFO(_t, "Hamiltonian: " + this->getInfo(), 3);
@@ -604,7 +1078,7 @@ inline u64 Hamiltonian<_T, _spinModes>::calcEnIdx(double _E)
 template<typename _T, uint _spinModes>
 inline std::pair<u64, u64> Hamiltonian<_T, _spinModes>::getEnArndAvIdx(long long _l, long long _r) const
 {
-	return SystemProperties::hs_fraction_around_idx(_l, _r, this->avEnIdx, this->Nh);
+	return SystemProperties::hs_fraction_around_idx(_l, _r, this->avEnIdx, this->eigVal_.n_elem);
 }
 
 // ##########################################################################################################################################
@@ -733,9 +1207,14 @@ inline void Hamiltonian<_T, _spinModes>::setHElem(u64 k, _T val, u64 newIdx)
 		{
 			auto [idx, symEig] = this->hilbertSpace.findRep(newIdx, this->hilbertSpace.getNorm(k));
 			// set Hamiltonian element. If map is empty, returns the same element as wanted - the symmetry is None
-			this->H_.add(idx, k, val * symEig);
+			if (this->colBufOn_)
+				this->colBuf_[omp_get_thread_num()].emplace_back(idx, val * symEig);
+			else
+				this->H_.add(idx, k, val * symEig);
 			//this->H_(idx, k) += val * symEig;
 		}
+		else if (this->colBufOn_)
+			this->colBuf_[omp_get_thread_num()].emplace_back(k, val);
 		else
 			this->H_.add(k, k, val);
 			//this->H_(k, k) += val;
@@ -756,6 +1235,12 @@ inline void Hamiltonian<_T, _spinModes>::setHElem(u64 k, _T val, u64 newIdx)
 template <typename _T, uint _spinModes>
 inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec)
 {
+	PROF_SCOPE(DIAG);
+	if (this->useDistDiag())
+	{
+		this->diagHDist(woEigVec);
+		return;
+	}
 	if (woEigVec)
 	{
 		if (this->isSparse_)
@@ -773,7 +1258,85 @@ inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec)
 
 	}
 	this->calcAvEn();
+	this->streamEigVec();
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Full diagonalization over all the ranks. Each rank generates only its blocks of the block-cyclic layout (see hamiltonianBlocks)
+* or, for the models without those, takes them from the built Hamiltonian. The eigenvalues are replicated and the eigenvectors stay
+* distributed (see getEigVecCol, DistEig::DistMatrix). All the ranks must share the seed (see setSeed), so that each builds the same matrix.
+* Without HAMIL_USE_SCALAPACK, the single node diagonalization is used.
+* @param woEigVec the eigenvectors are released after the diagonalization
+*/
+template <typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::diagHDist(bool woEigVec)
+{
+#ifdef HAMIL_USE_SCALAPACK
+	BEGIN_CATCH_HANDLER
+	{
+		auto _t				= NOW;
+		auto _V				= std::make_shared<DistEig::DistMatrix<_T>>();
+		{
+			DistEig::DistMatrix<_T> _Hd;
+			if (this->localBlocks_)
+				this->hamiltonianBlocks(_Hd);
+			else
+			{
+				if (DistEig::root())
+					LOGINFO("The model has no local blocks - the full Hamiltonian is built on each rank", LOG_TYPES::WARNING, 3);
+				if (this->isSparse_)
+					_Hd.assemble(this->H_.getSparse());
+				else
+					_Hd.assemble(this->H_.getDense());
+			}
+			DistEig::eigh(_Hd, this->eigVal_, *_V);
+		}
+		this->eigVec_.reset();
+		this->eigVecDist_	= woEigVec ? nullptr : _V;
+		LOGINFO(_t, "Distributed diagonalization over " + STR(DistEig::size()) + " ranks, local blocks " + STRP(_V->memory() / 1e9, 3) + "GB", 3);
+	}
+	END_CATCH_HANDLER("Exception in the distributed diagonalization: ", exit(-1););
+	this->calcAvEn();
+#else
+	this->distDiag_ = false;
+	this->diagH(woEigVec);
+#endif
+}
+
+// ##########################################################################################################################################
+
+#ifdef HAMIL_USE_SCALAPACK
+/*
+* @brief Local blocks of the Hamiltonian of the rank - the owned columns are produced by the locEnergy kernels (see collectColumn)
+* and only the owned rows are kept, so the full matrix is never stored. The models with other representations override this.
+* @param _Hd distributed matrix (resized to the Hilbert space)
+*/
+template <typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::hamiltonianBlocks(DistEig::DistMatrix<_T>& _Hd)
+{
+	PROF_SCOPE(H_BUILD);
+	this->buildDiagonal();
+	_Hd.resize((int)this->Nh);
+	const int _thr	= (int)this->threadNum_;
+	this->colBuf_	= v_1d<v_1d<std::pair<u64, _T>>>(_thr);
+	this->colBufOn_	= true;
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_thr) schedule(dynamic)
+#endif
+	for (int lj = 0; lj < _Hd.locCols(); ++lj)
+	{
+		auto& _col	= this->colBuf_[omp_get_thread_num()];
+		this->collectColumn((u64)_Hd.l2gCol(lj), _col);
+		for (const auto& [_row, _val] : _col)
+			if (_Hd.ownsRow((int)_row))
+				_Hd.local()(_Hd.g2lRow((int)_row), lj) = _val;
+	}
+	this->colBufOn_	= false;
+	this->colBuf_.clear();
 }
+#endif
 
 // ##########################################################################################################################################
 
@@ -787,6 +1350,8 @@ inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec)
 			- lm - largest magnitude
 *		Mine:
 *			- lanczos - Lanczos method
+*			- lanczos_mf - Lanczos method without storing the Hamiltonian (see diagHMatrixFree)
+*			- sg - k eigenpairs around the infinite temperature energy (see diagHMiddle)
 * @param woEigVec does not compute eigenvectors to save memory potentially
 * @param k number of eigenvalues to be computed
 * @param subdim dimension of the subspace to be used in the Lanczos method
@@ -797,6 +1362,7 @@ inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec)
 template <typename _T, uint _spinModes>
 inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec, uint k, uint subdim, uint maxiter, double tol, std::string form) 
 {
+	PROF_SCOPE(DIAG);
 	BEGIN_CATCH_HANDLER
 	{
 		arma::eigs_opts opts;
@@ -807,8 +1373,12 @@ inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec, uint k, uint subdi
 		if (form == "sg")
 		{
 			LOGINFO("Diagonalizing Hamiltonian. Using: S&I", LOG_TYPES::INFO, 3);
-			//if (woEigVec)		arma::eigs_sym(this->eigVal_, this->H_, arma::uword(k), 0.0, opts);
-			//else					arma::eigs_sym(this->eigVal_, this->eigVec_, this->H_, arma::uword(k), 0.0, opts);
+			this->diagHMiddle(woEigVec, k, NAN, maxiter, tol > 0 ? tol : 1e-8);
+		}
+		else if (form == "lanczos_mf")
+		{
+			LOGINFO("Diagonalizing Hamiltonian. Using: matrix-free Lanczos", LOG_TYPES::INFO, 3);
+			this->diagHMatrixFree(woEigVec, k, maxiter, tol);
 		}
 		else if (form == "lanczos")
 		{
@@ -827,9 +1397,395 @@ inline void Hamiltonian<_T, _spinModes>::diagH(bool woEigVec, uint k, uint subdi
 		}
 	}
 	END_CATCH_HANDLER("Memory exceeded. DIM(H)=" + STR(this->H_.size() * sizeof(this->H_(0, 0))) + " bytes", ;);
+	this->streamEigVec();
 }
 
 
+// ##########################################################################################################################################
+
+// ####################################################### M A T R I X   F R E E ############################################################
+
+// ##########################################################################################################################################
+
+/*
+* @brief Calculates the local energy from the connections of the site using the callback for the probability ratios.
+* Allows the models to keep a single implementation of the local energy (locEnergyConn) - the connections are stored
+* in the thread-local buffer, so that no allocation takes place.
+* @param v current state
+* @param site lattice site
+* @param f1 function returning the ratio of the amplitudes after the flips
+*/
+template<typename _T, uint _spinModes>
+inline cpx Hamiltonian<_T, _spinModes>::locEnergyFromConn(const arma::Col<double>& v, uint site, const NQSFun& f1)
+{
+	thread_local LocEnBuffer _buf;
+	this->locEnergyConn(v, site, _buf);
+	return _buf.evaluate([&](const LocEnConn& _c) -> cpx
+		{ 
+			return (_c.n_ == 1) ? f1({ _c.fP_[0] }, { _c.fV_[0] }) : f1({ _c.fP_[0], _c.fP_[1] }, { _c.fV_[0], _c.fV_[1] });
+		});
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Checks whether the whole Hamiltonian is generated by the locEnergy kernels from the base hamiltonian() loop.
+* The models that add random matrices or override the build on their own (RP, quadratic) cannot be applied that way, unless they
+* provide the structured representation (QSM, ultrametric) - then the factors are used instead.
+* @returns true if the matrix-free action is available
+*/
+template<typename _T, uint _spinModes>
+inline bool Hamiltonian<_T, _spinModes>::checkMatrixFree() const
+{
+	return	this->Hkron_ != nullptr				||
+			this->type_ == MY_MODELS::ISING_M	|| 
+			this->type_ == MY_MODELS::XYZ_M		|| 
+			this->type_ == MY_MODELS::HEI_KIT_M;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Computes y = H x without storing the Hamiltonian. The k-th column of H is obtained from the local energies 
+* of the k-th basis state (together with the symmetry mapping through findRep). As H is Hermitian, the k-th element 
+* of the result is y_k = sum_j conj(H_{jk}) x_j - each thread only gathers, so no element is written twice.
+* @param _x vector to be acted upon (in the reduced basis of the Hilbert space)
+* @param _y resulting vector (resized if needed)
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::applyH(const arma::Col<_T>& _x, arma::Col<_T>& _y)
+{
+	if (_x.n_elem != this->Nh)
+		throw std::runtime_error("Matrix-free H x: wrong size of the vector, " + VEQ(_x.n_elem) + "," + VEQ(this->Nh));
+	if (_y.n_elem != this->Nh)
+		_y.set_size(this->Nh);
+
+	// the structured models act with the factors
+	if (this->Hkron_)
+	{
+		this->Hkron_->apply(_x, _y);
+		return;
+	}
+
+	const int _thr		= (int)this->threadNum_;
+	if (this->diag_.n_elem != this->Nh)
+		this->buildDiagonal();
+	this->colBuf_		= v_1d<v_1d<std::pair<u64, _T>>>(_thr);
+	this->colBufOn_		= true;
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_thr) schedule(dynamic, 256)
+#endif
+	for (long long k = 0; k < (long long)this->Nh; ++k)
+	{
+		auto& _col		= this->colBuf_[omp_get_thread_num()];
+		this->collectColumn(k, _col);
+		_T _val			= 0.0;
+		for (const auto& [_row, _elem] : _col)
+			_val		+= algebra::conjugate(_elem) * _x(_row);
+		_y(k)			= _val;
+	}
+	this->colBufOn_		= false;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Lanczos' method that only keeps three Krylov vectors in memory and uses the matrix-free action of the Hamiltonian.
+* The tridiagonal matrix is diagonalized every few iterations and the procedure stops when the k lowest Ritz values converge. 
+* No reorthogonalization is performed, therefore spurious copies of converged states may appear far in the iterations - the 
+* method is meant for the lowest part of the spectrum. If the eigenvectors are requested, the Krylov vectors are regenerated 
+* from the same starting vector and the Ritz vectors are accumulated on the fly (k + 3 vectors in memory).
+* @param woEigVec does not compute eigenvectors
+* @param k number of eigenvalues to be computed
+* @param maxiter maximum number of Lanczos steps
+* @param tol tolerance for the Ritz values
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::diagHMatrixFree(bool woEigVec, uint k, uint maxiter, double tol)
+{
+	if (!this->checkMatrixFree())
+		throw std::runtime_error("Matrix-free Lanczos is not available for the model: " + this->getType());
+	
+	const u64 _Nh			= this->Nh;
+	const uint _M			= (uint)std::min<u64>(std::max(maxiter, k + 1), _Nh);
+	tol						= (tol <= 0) ? 1e-10 : tol;
+	k						= std::min<uint>(std::max(k, 1u), _M);
+
+	// starting vector
+	const arma::Col<_T> _v0 = arma::normalise(algebra::cast<_T>(this->ran_.template createRanVec<double>(_Nh, 1.0)));
+
+	// tridiagonal matrix from the Lanczos coefficients
+	v_1d<double> _alpha, _beta;
+	auto _tridiag = [&](uint _n) -> arma::mat
+		{
+			arma::mat _Tmat(_n, _n, arma::fill::zeros);
+			for (uint i = 0; i < _n; ++i)
+			{
+				_Tmat(i, i)			= _alpha[i];
+				if (i + 1 < _n)
+				{
+					_Tmat(i, i + 1) = _beta[i];
+					_Tmat(i + 1, i) = _beta[i];
+				}
+			}
+			return _Tmat;
+		};
+
+	// Lanczos recursion, calls _fun(j, v_j) for every Krylov vector
+	auto _lanczos = [&](uint _steps, bool _check, auto&& _fun) -> uint
+		{
+			arma::Col<_T> _vPrev(_Nh, arma::fill::zeros), _v = _v0, _w(_Nh);
+			arma::vec _ritzPrev;
+			for (uint j = 0; j < _steps; ++j)
+			{
+				_fun(j, _v);
+				this->applyH(_v, _w);
+				const double _a	= _check ? algebra::real(arma::cdot(_v, _w)) : _alpha[j];
+				_w				-= _a * _v;
+				if (j > 0)
+					_w			-= _beta[j - 1] * _vPrev;
+				const double _b	= arma::norm(_w);
+				if (_check)
+					_alpha.push_back(_a);
+
+				// invariant subspace found or the end reached
+				if (_b < tol || j + 1 == _steps)
+					return j + 1;
+
+				// check the convergence of the Ritz values
+				if (_check && j + 1 >= k && (j + 1) % 10 == 0)
+				{
+					arma::vec _ritz = arma::eig_sym(_tridiag(j + 1));
+					if (_ritzPrev.n_elem >= k && arma::max(arma::abs(_ritz.head(k) - _ritzPrev.head(k))) < tol)
+						return j + 1;
+					_ritzPrev	= _ritz;
+				}
+				if (_check)
+					_beta.push_back(_b);
+				_vPrev			= _v;
+				_v				= _w / _beta[j];
+			}
+			return _steps;
+		};
+
+	auto _t					= NOW;
+	const uint _steps		= _lanczos(_M, true, [](uint, const arma::Col<_T>&) {});
+
+	// diagonalize the tridiagonal matrix
+	arma::vec _ritz;
+	arma::mat _ritzVec;
+	arma::eig_sym(_ritz, _ritzVec, _tridiag(_steps));
+	k						= std::min<uint>(k, _steps);
+	this->eigVal_			= _ritz.head(k);
+	LOGINFO(_t, "Matrix-free Lanczos: " + VEQ(_steps), 3);
+
+	// regenerate the Krylov vectors to get the eigenvectors
+	if (!woEigVec)
+	{
+		this->eigVec_		= arma::Mat<_T>(_Nh, k, arma::fill::zeros);
+		_lanczos(_steps, false, [&](uint j, const arma::Col<_T>& _v)
+			{
+				for (uint i = 0; i < k; ++i)
+					this->eigVec_.col(i) += _ritzVec(j, i) * _v;
+			});
+		this->eigVec_		= arma::normalise(this->eigVec_);
+	}
+}
+
+// ##########################################################################################################################################
+
+// ################################################### M I D D L E   O F   S P E C T R U M ##################################################
+
+// ##########################################################################################################################################
+
+/*
+* @brief Infinite temperature energy of the Hamiltonian - the center of the many-body density of states
+*/
+template<typename _T, uint _spinModes>
+inline double Hamiltonian<_T, _spinModes>::getEnInf() const
+{
+	if (this->H_.isSparse())
+		return algebra::real(arma::trace(this->H_.getSparse())) / (double)this->Nh;
+	return algebra::real(arma::trace(this->H_.getDense())) / (double)this->Nh;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Finds k eigenpairs closest to sigma (by default the infinite temperature energy) without the full diagonalization.
+* For real sparse matrices with SuperLU available, the shift-invert mode of ARPACK is used. Otherwise (complex Hamiltonians, 
+* no SuperLU) the Chebyshev polynomial filter is applied (see diagHFilter). The eigenvalues are sorted and avEn, avEnIdx are
+* set with respect to the found part of the spectrum.
+* @param woEigVec does not compute eigenvectors
+* @param k number of eigenpairs
+* @param sigma target energy (NAN - Tr(H)/Nh)
+* @param maxiter maximal number of iterations
+* @param tol tolerance of the eigenpairs
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::diagHMiddle(bool woEigVec, uint k, double sigma, uint maxiter, double tol)
+{
+	if (std::isnan(sigma))
+		sigma				= this->getEnInf();
+	k						= (uint)std::min<u64>(std::max(k, 1u), this->Nh);
+
+	// small matrices are handled fully
+	if (this->Nh <= 2 * k || !this->isSparse_)
+	{
+		// the full set stays in memory until sliced - only the window is streamed (at the end of diagH)
+		const std::string _stream	= std::exchange(this->eigStreamDir_, std::string());
+		this->diagH(woEigVec);
+		this->eigStreamDir_	= _stream;
+		const u64 _idx		= this->calcEnIdx(sigma);
+		const u64 _min		= _idx > k / 2 ? _idx - k / 2 : 0;
+		const u64 _max		= std::min<u64>(_min + k, this->Nh);
+		this->eigVal_		= arma::vec(this->eigVal_.subvec(_min, _max - 1));
+		if (!woEigVec)
+			this->eigVec_	= arma::Mat<_T>(this->eigVec_.cols(_min, _max - 1));
+	}
+	else
+	{
+		auto _t				= NOW;
+		bool _done			= false;
+#ifdef ARMA_USE_SUPERLU
+		if constexpr (std::is_same_v<_T, double>)
+		{
+			arma::eigs_opts opts;
+			opts.tol		= tol;
+			opts.maxiter	= std::max(maxiter, 1000u);
+			if (woEigVec)
+			{
+				arma::mat _vec;
+				_done		= arma::eigs_sym(this->eigVal_, _vec, this->H_.getSparse(), arma::uword(k), sigma, opts);
+			}
+			else
+				_done		= arma::eigs_sym(this->eigVal_, this->eigVec_, this->H_.getSparse(), arma::uword(k), sigma, opts);
+			if (_done)
+				LOGINFO(_t, "Shift-invert: " + VEQP(sigma, 5), 3);
+		}
+#endif
+		if (!_done)
+			this->diagHFilter(woEigVec, k, sigma, maxiter, tol);
+
+		// sort the eigenpairs
+		const arma::uvec _sort	= arma::sort_index(this->eigVal_);
+		this->eigVal_			= arma::vec(this->eigVal_.elem(_sort));
+		if (!woEigVec)
+			this->eigVec_		= arma::Mat<_T>(this->eigVec_.cols(_sort));
+	}
+
+	// set the energies in the found window
+	this->avEn					= sigma;
+	this->avEnIdx				= arma::abs(this->eigVal_ - sigma).index_min();
+	this->minEn					= this->eigVal_(0);
+	this->maxEn					= this->eigVal_(this->eigVal_.n_elem - 1);
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Polynomial filtered subspace iteration. The block of m = 2k vectors is acted upon with the Chebyshev expansion of 
+* the delta function delta(H - sigma) with the Jackson kernel, which amplifies the eigenvectors in the window around sigma. 
+* The filtered block is orthonormalized and the Rayleigh-Ritz procedure gives the eigenpairs closest to sigma. The iteration is 
+* repeated on the Ritz vectors until the residuals are below tol.
+* The spectral bounds come from the Gershgorin estimate, while the window width from the Gaussian approximation of the many-body 
+* density of states with the width sqrt(Tr(H^2)/Nh - (Tr(H)/Nh)^2).
+* @param woEigVec does not store eigenvectors
+* @param k number of eigenpairs
+* @param sigma target energy
+* @param maxiter maximal number of outer iterations
+* @param tol tolerance of the residuals (relative to the spectral radius)
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::diagHFilter(bool woEigVec, uint k, double sigma, uint maxiter, double tol)
+{
+	if (!this->H_.isSparse())
+		throw std::runtime_error("Chebyshev filter is only implemented for sparse matrices.");
+	const arma::SpMat<_T>& _H	= this->H_.getSparse();
+	const u64 _Nh				= this->Nh;
+	const uint _m				= (uint)std::min<u64>(2 * k + 10, _Nh);
+
+	// spectral bounds (Gershgorin, symmetric around zero) and the density of states width
+	const double _rad			= arma::norm(_H, 1);
+	const double _e				= 1.01 * _rad;
+	const double _Eav			= this->getEnInf();
+	const double _Fro			= arma::norm(_H, "fro");
+	const double _sigE			= std::sqrt(std::max(_Fro * _Fro / _Nh - _Eav * _Eav, 1e-12));
+	const double _dens			= _Nh / (std::sqrt(TWOPI) * _sigE) * std::exp(-0.5 * std::pow((sigma - _Eav) / _sigE, 2));
+	const double _delta			= std::max(2.0 * _m / std::max(_dens, 1e-12), 1e-10);
+
+	// degree of the polynomial from the width of the window
+	const uint _deg				= (uint)std::clamp(std::ceil(PI * _e / _delta), 10.0, 50000.0);
+	const double _x0			= sigma / _e;
+	arma::vec _coef(_deg + 1);
+	{
+		const double _a			= PI / (_deg + 2.0);
+		const double _th		= std::acos(std::clamp(_x0, -1.0, 1.0));
+		for (uint n = 0; n <= _deg; ++n)
+		{
+			const double _g		= ((_deg - n + 2) * std::cos(n * _a) + std::sin(n * _a) / std::tan(_a)) / (_deg + 2);
+			_coef(n)			= (n == 0 ? 1.0 : 2.0) * _g * std::cos(n * _th);
+		}
+	}
+	LOGINFO("Chebyshev filter: " + VEQP(sigma, 5) + "," + VEQ(_deg) + "," + VEQ(_m) + "," + VEQP(_delta, 5), LOG_TYPES::INFO, 3);
+
+	// filter acting on the block
+	auto _filter = [&](const arma::Mat<_T>& _Y) -> arma::Mat<_T>
+		{
+			arma::Mat<_T> _T0	= _Y;
+			arma::Mat<_T> _T1	= (_H * _Y) / _e;
+			arma::Mat<_T> _out	= _coef(0) * _T0 + _coef(1) * _T1;
+			for (uint n = 2; n <= _deg; ++n)
+			{
+				arma::Mat<_T> _T2	= 2.0 * (_H * _T1) / _e - _T0;
+				_out			+= _coef(n) * _T2;
+				_T0				= std::move(_T1);
+				_T1				= std::move(_T2);
+			}
+			return _out;
+		};
+
+	auto _t						= NOW;
+	// the start block from the stream of the realization - the same window in every run
+	arma::Mat<_T> _X(_Nh, _m);
+	if constexpr (std::is_same_v<_T, double>)
+		RandomStreams::normal(this->ranStream(), _X.memptr(), _X.n_elem, 0.0, 1.0, (int)this->threadNum_);
+	else
+		RandomStreams::normal(this->ranStream(), reinterpret_cast<double*>(_X.memptr()), 2 * _X.n_elem, 0.0, 1.0 / std::sqrt(2.0), (int)this->threadNum_);
+	arma::vec _ritz;
+	arma::Mat<_T> _W, _Q, _R;
+	for (uint _it = 0; _it < std::max(maxiter, 1u); ++_it)
+	{
+		// filter and orthonormalize
+		arma::qr_econ(_Q, _R, _filter(_X));
+
+		// Rayleigh-Ritz
+		arma::Mat<_T> _Hq		= _Q.t() * (_H * _Q);
+		_Hq						= 0.5 * (_Hq + _Hq.t());
+		arma::eig_sym(_ritz, _W, _Hq);
+		_X						= _Q * _W;
+
+		// residuals of the k closest
+		const arma::uvec _close = arma::sort_index(arma::abs(_ritz - sigma));
+		double _res				= 0.0;
+		for (uint i = 0; i < k; ++i)
+		{
+			const auto _j		= _close(i);
+			_res				= std::max(_res, (double)arma::norm(_H * _X.col(_j) - _ritz(_j) * _X.col(_j)));
+		}
+		LOGINFO("Chebyshev filter iteration: " + VEQ(_it) + "," + VEQP(_res, 5), LOG_TYPES::TRACE, 4);
+		if (_res < tol * _rad || _it + 1 == std::max(maxiter, 1u))
+		{
+			const arma::uvec _sel	= _close.head(k);
+			this->eigVal_			= _ritz.elem(_sel);
+			if (!woEigVec)
+				this->eigVec_		= _X.cols(_sel);
+			break;
+		}
+	}
+	LOGINFO(_t, "Chebyshev filter", 3);
+}
+
 // ##########################################################################################################################################
 
 /*
@@ -903,6 +1859,103 @@ inline auto Hamiltonian<_T, _spinModes>::getEigVal(std::string _dir, HAM_SAVE_EX
 
 // ##########################################################################################################################################
 
+/*
+* @brief Moves the eigenvectors from the memory to the out-of-core store (if the stream directory is set). Afterwards, 
+* the memory of eigVec_ is released and the states are paged in on demand by getEigVec(idx) with the LRU block cache.
+*/
+template<typename _T, uint _spinModes>
+inline void Hamiltonian<_T, _spinModes>::streamEigVec()
+{
+	// quadratic Hamiltonians use the single particle matrix directly
+	if (this->eigStreamDir_.empty() || this->eigVec_.empty() || this->isQuadratic_)
+		return;
+	BEGIN_CATCH_HANDLER
+	{
+		auto _t					= NOW;
+		std::filesystem::create_directories(this->eigStreamDir_);
+		std::stringstream _name;
+		_name << std::hex << std::hash<std::string>{}(this->getInfo()) << "_" << (u64)this;
+		this->eigStore_			= std::make_shared<EigVecStore<_T>>(this->eigStreamDir_ + kPS + "eigvec_" + _name.str() + ".bin",
+																		this->eigStreamBlock_, this->eigStreamCache_);
+		this->eigStore_->write(this->eigVec_);
+		this->eigVec_.reset();
+		LOGINFO(_t, "Eigenvectors streamed to: " + this->eigStore_->file() + ", cache " + STRP(this->eigStore_->memory() / 1e9, 3) + "GB", 3);
+	}
+	END_CATCH_HANDLER("Exception in streaming the eigenvectors, keeping them in memory: ", this->eigStore_.reset(););
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Returns the matrix of the eigenvectors kept in the memory. The streamed or distributed eigenvectors are never paged in
+* here - use getEigVec(idx), getEigVecBlock or the explicit loadEigVec.
+*/
+template<typename _T, uint _spinModes>
+inline auto Hamiltonian<_T, _spinModes>::getEigVec() const -> const arma::Mat<_T>&
+{
+	if (this->isEigVecStreamed() || this->isEigVecDistributed())
+		throw std::runtime_error("The eigenvectors are not in the memory - use getEigVecBlock or loadEigVec!");
+	return this->eigVec_;
+}
+
+/*
+* @brief Brings the full matrix of the eigenvectors into the memory. The streamed eigenvectors are read from the store and the
+* distributed ones are gathered from the ranks (collective), which negates the memory savings of both - the matrix is kept
+* until the next diagonalization.
+*/
+template<typename _T, uint _spinModes>
+inline auto Hamiltonian<_T, _spinModes>::loadEigVec() -> const arma::Mat<_T>&
+{
+	if (this->isEigVecStreamed())
+	{
+		LOGINFO("Reading the full eigenvector matrix from the stream: " + this->eigStore_->file(), LOG_TYPES::WARNING, 3);
+		this->eigVec_ = this->eigStore_->all();
+	}
+#ifdef HAMIL_USE_SCALAPACK
+	else if (this->isEigVecDistributed())
+	{
+		LOGINFO("Gathering the full eigenvector matrix from the ranks (collective)", LOG_TYPES::WARNING, 3);
+		this->eigVec_ = this->eigVecDist_->cols(0, (int)this->Nh);
+	}
+#endif
+	return this->eigVec_;
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Single eigenvector - from the memory, the out-of-core store or gathered from the ranks (collective in the distributed mode,
+* all the ranks shall call it with the same index).
+*/
+template<typename _T, uint _spinModes>
+inline auto Hamiltonian<_T, _spinModes>::getEigVecCol(u64 idx) const -> arma::Col<_T>
+{
+	if (this->isEigVecStreamed())
+		return this->eigStore_->col(idx);
+#ifdef HAMIL_USE_SCALAPACK
+	if (this->isEigVecDistributed())
+		return this->eigVecDist_->col((int)idx);
+#endif
+	return arma::Col<_T>(this->eigVec_.col(idx));
+}
+
+/*
+* @brief Block of the eigenvectors [_start, _start + _n) - the same sources as getEigVecCol (collective in the distributed mode).
+*/
+template<typename _T, uint _spinModes>
+inline auto Hamiltonian<_T, _spinModes>::getEigVecBlock(u64 _start, u64 _n) const -> arma::Mat<_T>
+{
+	if (this->isEigVecStreamed())
+		return this->eigStore_->cols(_start, _n);
+#ifdef HAMIL_USE_SCALAPACK
+	if (this->isEigVecDistributed())
+		return this->eigVecDist_->cols((int)_start, (int)_n);
+#endif
+	return arma::Mat<_T>(this->eigVec_.cols(_start, _start + _n - 1));
+}
+
+// ##########################################################################################################################################
+
 /*
 * @brief Prints the eigenvectors into some file "energies" in some directory
 * @param _dir directory to be saved onto
@@ -918,7 +1971,7 @@ inline auto Hamiltonian<_T, _spinModes>::getEigVec(std::string _dir, u64 _mid, H
 
 	BEGIN_CATCH_HANDLER
 	{
-		const arma::Mat<_T> states	= (_mid == this->Nh) ? this->eigVec_ : this->eigVec_.submat(0, inLeft, this->Nh - 1, inRight);
+		const arma::Mat<_T> states	= (_mid == this->Nh) ? this->getEigVecBlock(0, this->Nh) : this->getEigVecBlock(inLeft, inRight - inLeft + 1);
 		std::string extension		= "." + SSTR(getSTR_HAM_SAVE_EXT(_typ));
 		switch (_typ)
 		{
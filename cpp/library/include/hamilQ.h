@@ -9,6 +9,10 @@
 
 #ifndef HAMIL_H
 #include "hamil.h"
+// rank-1 updates of the Slater determinants
+#include "algebra/slater_updates.h"
+// compact combinations of the orbitals
+#include "algebra/orbital_combinations.h"
 #endif
 
 #ifndef HAMIL_QUADRATIC_H
@@ -86,6 +90,10 @@ public:
 	void getManyBodyOrbitals(uint N, v_1d<uint> _orbitals, v_1d<v_1d<uint>>& manyBodyOrbitals);
 	void getManyBodyOrbitals(uint N, v_1d<uint> _orbitals, v_1d<v_1d<uint>>& manyBodyOrbitals, uint _num, uint _threadNum = 1);
 	void getManyBodyEnergies(v_1d<double>& manyBodySpectrum, const v_1d<v_1d<uint>>& manyBodyOrbitals, uint _threadNum = 1);
+	// ------------------ compact combinations
+	void getManyBodyOrbitals(uint N, const v_1d<uint>& _orbitals, Orbitals::Combinations& manyBodyOrbitals);
+	void getManyBodyOrbitals(uint N, const v_1d<uint>& _orbitals, Orbitals::Combinations& manyBodyOrbitals, uint _num, uint _threadNum = 1);
+	void getManyBodyEnergies(arma::vec& manyBodySpectrum, const Orbitals::Combinations& manyBodyOrbitals);
 
 	// ------------------ energy
 	template<typename _T2, typename _A, typename = typename std::enable_if<std::is_arithmetic<_T2>::value, _T2>::type>
@@ -118,6 +126,10 @@ public:
 	template<typename _T1, typename _T2>
 	arma::Col<_T> getManyBodyState(const _T1& _singlePartOrbs, const u64 _hilbertSize, arma::Mat<_T2>& _slater);
 
+	// ------------------ amplitudes from orbitals (streamed, rank-1 updates)
+	template<typename _T1, typename _F>
+	void forManyBodyAmplitudes(const _T1& _singlePartOrbs, _F&& _f);
+
 	// --------------- C O N S T R U C T O R S ---------------
 	virtual ~QuadraticHamiltonian()	= default;
 	QuadraticHamiltonian()			= default;
@@ -338,10 +350,11 @@ inline void QuadraticHamiltonian<_T>::getManyBodyOrbitals(uint N, v_1d<uint> _or
 	manyBodyOrbitals.clear();
 	manyBodyOrbitals.resize(_num);
 
-	// go through random iterations
+	// go through random iterations - each draw uses its own part of the counter-based stream (no shared state between the threads)
+	const auto _stream = this->ranStream();
 #pragma omp parallel for num_threads(_threadNum)
 	for (int i = 0; i < _num; ++i)
-		manyBodyOrbitals[i] = this->ran_.choice(_orbitals, N);
+		manyBodyOrbitals[i] = RandomStreams::choice(_orbitals, N, _stream, (u64)i);
 }
 
 // ##################################################################################################################################
@@ -369,6 +382,53 @@ inline void QuadraticHamiltonian<_T>::getManyBodyEnergies(v_1d<double>& manyBody
 
 // ##################################################################################################################################
 
+/*
+* @brief Create all the combinations of quasiparticle orbitals in the compact form (a single buffer of N x M indices).
+* @param N number of particles out of the single particle sectors
+* @param _orbitals set of many single particle states selection
+* @param manyBodyOrbitals save the many body orbitals there
+*/
+template<typename _T>
+inline void QuadraticHamiltonian<_T>::getManyBodyOrbitals(uint N, const v_1d<uint>& _orbitals, Orbitals::Combinations& manyBodyOrbitals)
+{
+	if (this->Ns != _orbitals.size())
+		throw std::runtime_error(std::string("Wrong number of orbitals given!"));
+	manyBodyOrbitals = Orbitals::Combinations::all(_orbitals, N);
+}
+
+/*
+* @brief Create the random unique combinations of quasiparticle orbitals in the compact form.
+* @param N number of particles out of the single particle sectors
+* @param _orbitals set of many single particle states selection
+* @param manyBodyOrbitals save the many body orbitals there
+* @param _num number of draws (the repeating combinations are removed)
+* @param _threadNum number of threads
+*/
+template<typename _T>
+inline void QuadraticHamiltonian<_T>::getManyBodyOrbitals(uint N, const v_1d<uint>& _orbitals, Orbitals::Combinations& manyBodyOrbitals, uint _num, uint _threadNum)
+{
+	if (this->Ns != _orbitals.size())
+		throw std::runtime_error(std::string("Wrong number of orbitals given!"));
+	manyBodyOrbitals = Orbitals::Combinations::random(_orbitals, N, _num, this->ranStream(), _threadNum);
+}
+
+/*
+* @brief Many body energies of the compact combinations - a single product of the occupation matrix with the 
+* single particle spectrum (or with the pair energies of the Bogolubov quasiparticles).
+* @param manyBodySpectrum save the many body energies here!
+* @param manyBodyOrbitals combinations of the orbitals
+*/
+template<typename _T>
+inline void QuadraticHamiltonian<_T>::getManyBodyEnergies(arma::vec& manyBodySpectrum, const Orbitals::Combinations& manyBodyOrbitals)
+{
+	arma::vec _e(this->Ns);
+	for (uint i = 0; i < this->Ns; ++i)
+		_e(i) = this->particleConverving_ ? this->eigVal_(i) : (this->eigVal_(this->Ns - 1 + i) + this->eigVal_(this->Ns - 1 - i));
+	manyBodySpectrum = manyBodyOrbitals.sum(_e);
+}
+
+// ##################################################################################################################################
+
 /*
 * @brief Sets the slater determinant in order to create a single coefficient of a state.
 * @param _singlePartOrbs single particle orbitals that are occupied
@@ -582,6 +642,13 @@ inline arma::Col<_T> QuadraticHamiltonian<_T>::getManyBodyState(const _T1& _sing
 	// save the state 
 	arma::Col<_T> _stateOut(_hilbertSize, arma::fill::zeros);
 
+	// the full Hilbert space - the determinants are updated along the Gray code
+	if (_hilbertSize == ULLPOW(this->Ns))
+	{
+		this->forManyBodyAmplitudes(_singlePartOrbs, [&](u64 _state, _T _amp) { _stateOut(_state) = _amp; });
+		return _stateOut;
+	}
+
 	// go through the Hilbert space basis
 	for (u64 _state = 0; _state < _hilbertSize; ++_state)
 	{
@@ -593,4 +660,34 @@ inline arma::Col<_T> QuadraticHamiltonian<_T>::getManyBodyState(const _T1& _sing
 	}
 	return _stateOut;}
 
+// -----------------------------------------------------------------------------------------------------------------------------------
+
+/*
+* @brief Streams the amplitudes of the product of the single particle orbitals over all the Fock states with the same number of particles.
+* Consecutive states differ by a single hop, so that each Slater determinant follows from the previous one by the rank-1 update - O(N^2)
+* per state instead of the O(N^3) decomposition. Nothing of the size of the Hilbert space is allocated.
+* @param _singlePartOrbs set of indices indicating taken single particle orbitals
+* @param _f callback (u64 state, _T amplitude) - the amplitude is the Slater determinant as in getManyBodyState
+*/
+template<typename _T>
+template<typename _T1, typename _F>
+inline void QuadraticHamiltonian<_T>::forManyBodyAmplitudes(const _T1& _singlePartOrbs, _F&& _f)
+{
+	if (!this->particleConverving_)
+		throw std::runtime_error("This Hamiltonian does not have the eigenstates in Slater determinant form!");
+
+	arma::uvec _orbs(_singlePartOrbs.size());
+	for (u64 j = 0; j < _orbs.n_elem; ++j)
+		_orbs(j) = (arma::uword)_singlePartOrbs[j];
+
+	// site of each bit of the state (the convention of checkBit as in getSlater)
+	v_1d<uint> _siteOfBit(this->Ns, 0);
+	for (uint b = 0; b < this->Ns; ++b)
+		for (uint i = 0; i < this->Ns; ++i)
+			if (checkBit(ULLPOW(b), i))
+				_siteOfBit[b] = i;
+
+	SlaterUpdates::forEach<_T>(this->eigVec_, _orbs, this->Ns, _siteOfBit, std::forward<_F>(_f));
+}
+
 #endif
\ No newline at end of file
@@ -31,6 +31,11 @@ protected:
 	DISORDER_EQUIV(double, eB);
 	bool parityBreak_											= false;
 
+	// precompiled couplings (the lattice and the disorder are resolved once)
+	Bonds::Table nn_;
+	Bonds::Table nnn_;
+	void compileBonds();
+
 public:
 	// ######################################## Constructors ########################################
 	~XYZ()														{ LOGINFO(this->info() + " - destructor called.", LOG_TYPES::INFO, 3); };
@@ -77,7 +82,16 @@ public:
 				NQSFun f1)						override final;
 	cpx locEnergy(const DCOL& v,
 				uint site,
-				NQSFun f1)						override final;
+				NQSFun f1)						override final	{ return this->locEnergyFromConn(v, site, f1); };
+	bool hasLocEnergyConn()				const	override final	{ return true; };
+	void locEnergyConn(const DCOL& v,
+				uint site,
+				LocEnBuffer& _buf)				override final;
+	// ------------------------------------------- DIAGONAL PASS ---------------------------------------------
+	bool hasDiagonal()					const	override final	{ return true; };
+	double diagonal(u64 _state)			const	override final;
+	double diagonal(const DCOL& v)		const	override final;
+	bool shareBonds(const Hamiltonian<_T, 2>& _other)	override final;
 
 	// ############################################ Info #############################################
 
@@ -139,6 +153,7 @@ inline XYZ<_T>::XYZ(const Hilbert::HilbertSpace<_T>& hilbert, double _Ja, double
 	//change info
 	this->info_ = this->info();
 	this->updateInfo();
+	this->compileBonds();
 }
 
 // ##########################################################################################################################################
@@ -162,6 +177,7 @@ inline XYZ<_T>::XYZ(Hilbert::HilbertSpace<_T>&& hilbert, double _Ja, double _Jb,
 	//change info
 	this->info_ = this->info();
 	this->updateInfo();
+	this->compileBonds();
 }
 
 // ##########################################################################################################################################
@@ -196,6 +212,7 @@ inline XYZ<_T>::XYZ(const Hilbert::HilbertSpace<_T>& hilbert,	double _Ja, double
 	LOGINFOG(VEQ(Jx) + "," + VEQ(Jy) + "," + VEQ(Jz), LOG_TYPES::CHOICE, 1);
 	auto SUSY	= Jx * Jy + Jy * Jz + Jx * Jz;
 	LOGINFOG(VEQ(SUSY), LOG_TYPES::CHOICE, 1);
+	this->compileBonds();
 };
 
 // ##########################################################################################################################################
@@ -230,6 +247,7 @@ inline XYZ<_T>::XYZ(Hilbert::HilbertSpace<_T>&& hilbert,			double _Ja, double _J
 	LOGINFOG(VEQ(Jx) + "," + VEQ(Jy) + "," + VEQ(Jz), LOG_TYPES::CHOICE, 1);
 	auto SUSY	= Jx * Jy + Jy * Jz + Jx * Jz;
 	LOGINFOG(VEQ(SUSY), LOG_TYPES::CHOICE, 1);
+	this->compileBonds();
 };
 
 // ##########################################################################################################################################
@@ -238,6 +256,45 @@ inline XYZ<_T>::XYZ(Hilbert::HilbertSpace<_T>&& hilbert,			double _Ja, double _J
 // ##########################################################################################################################################
 // ##########################################################################################################################################
 
+/*
+* @brief Compiles the couplings of the nearest and the next nearest neighbors into the bond tables. Called whenever the
+* parameters or the disorder change (the constructors).
+*/
+template <typename _T>
+inline void XYZ<_T>::compileBonds()
+{
+	if (!this->lat_)
+		return;
+	this->nn_.compile(this->lat_, this->Ns, false,
+		[&](uint i) { return std::make_pair(PARAM_W_DISORDER(hz, i), PARAM_W_DISORDER(hx, i)); },
+		[&](uint i, uint, uint) { return Bonds::Coupling{ PARAM_W_DISORDER(dA, i) * PARAM_W_DISORDER(Ja, i),
+														  PARAM_W_DISORDER(Ja, i) * (1.0 - PARAM_W_DISORDER(eA, i)),
+														  PARAM_W_DISORDER(Ja, i) * (1.0 + PARAM_W_DISORDER(eA, i)) }; });
+	this->nnn_.compile(this->lat_, this->Ns, true,
+		[](uint) { return std::make_pair(0.0, 0.0); },
+		[&](uint i, uint, uint) { return Bonds::Coupling{ PARAM_W_DISORDER(dB, i) * PARAM_W_DISORDER(Jb, i),
+														  PARAM_W_DISORDER(Jb, i) * (1.0 - PARAM_W_DISORDER(eB, i)),
+														  PARAM_W_DISORDER(Jb, i) * (1.0 + PARAM_W_DISORDER(eB, i)) }; });
+}
+
+/*
+* @brief Takes the bond tables of the other XYZ model on the same lattice (e.g. other symmetry sector) - the lattice is not
+* traversed again and all the sectors see the same disorder realization.
+* @returns whether the tables have been taken
+*/
+template <typename _T>
+inline bool XYZ<_T>::shareBonds(const Hamiltonian<_T, 2>& _other)
+{
+	auto _o = dynamic_cast<const XYZ<_T>*>(&_other);
+	if (!_o || _o->Ns != this->Ns || _o->nn_.empty())
+		return false;
+	this->nn_	= _o->nn_;
+	this->nnn_	= _o->nnn_;
+	return true;
+}
+
+// ##########################################################################################################################################
+
 /*
 * Calculate the local energy end return the corresponding vectors with the value
 * @param _id base state index
@@ -249,66 +306,42 @@ cpx XYZ<_T>::locEnergy(u64 _cur, uint _site, XYZ<_T>::NQSFun _fun)
 	double localVal	= 0.0;
 	cpx changedVal	= 0.0;
 
-	// get number of forward nn
-	uint NUM_OF_NN	=	(uint)this->lat_->get_nn_ForwardNum(_site);
-	uint NUM_OF_NNN	=	(uint)this->lat_->get_nnn_ForwardNum(_site);
-
 	// -------------- perpendicular field --------------
-	const double si	=	checkBit(_cur, this->Ns - _site - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-	localVal		+=	PARAM_W_DISORDER(hz, _site) * si;
+	const double si	=	(_cur & this->nn_.siteMask(_site)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+	localVal		+=	this->nn_.hz(_site) * si;
 
 	// ---------------- transverse field ---------------
 	if (!EQP(this->hx, 0.0, 1e-9)) 
-		changedVal		+= _fun({ (int)_site }, { si }) * Operators::_SPIN_RBM * PARAM_W_DISORDER(hx, _site);
+		changedVal		+= _fun({ (int)_site }, { si }) * Operators::_SPIN_RBM * this->nn_.hx(_site);
 
-	// ------------------- CHECK NN --------------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++) 
-	{
-		uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0) 
+	// the same kernel for the NN and the NNN bonds
+	auto _bonds = [&](const Bonds::Table& _t)
 		{
-			// SZiSZj
-			const double sj		=	checkBit(_cur, this->Ns - nei - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-			localVal			+=	PARAM_W_DISORDER(dA, _site) * PARAM_W_DISORDER(Ja, _site) * si * sj;
-
-			// SYiSYj
-			auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto changedIn		=	siY * sjY * PARAM_W_DISORDER(Ja, _site) * (1.0 + PARAM_W_DISORDER(eA, _site));
-
-			// SXiSXj
-			changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * PARAM_W_DISORDER(Ja, _site) * (1.0 - PARAM_W_DISORDER(eA, _site));
-			
-			// apply change
-			changedVal			+=	_fun({ (int)_site, nei }, { si, sj }) * changedIn; 
-		}
-	}
-
-	// ------------------- CHECK NNN --------------------
-	if (!EQP(this->Jb, 0.0, 1e-9))
-	{
-		for (uint nnn = 0; nnn < NUM_OF_NNN; nnn++) 
-		{
-			uint N_NUMBER = this->lat_->get_nnn_ForwardNum(_site, nnn);
-			if (int nei = this->lat_->get_nnn(_site, N_NUMBER); nei >= 0) 
+			for (uint b = _t.begin(_site); b < _t.end(_site); ++b)
 			{
 				// SZiSZj
-				const double sj	=	checkBit(_cur, this->Ns - nei - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-				localVal				+= PARAM_W_DISORDER(dB, _site) * PARAM_W_DISORDER(Jb, _site) * si * sj;
+				const double sj		=	(_cur & _t.mask(b)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+				localVal			+=	_t.Jz(b) * si * sj;
 
 				// SYiSYj
-				auto siY				=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-				auto sjY				=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-				auto changedIn		=  siY * sjY * PARAM_W_DISORDER(Jb, _site) * (1.0 + PARAM_W_DISORDER(eB, _site));
+				auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+				auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+				auto changedIn		=	siY * sjY * _t.Jy(b);
 
 				// SXiSXj
-				changedIn			+= Operators::_SPIN_RBM * Operators::_SPIN_RBM * PARAM_W_DISORDER(Jb, _site) * (1.0 - PARAM_W_DISORDER(eB, _site));
-			
+				changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * _t.Jx(b);
+
 				// apply change
-				changedVal			+= _fun({ (int)_site, nei }, { si, sj }) * changedIn; 
+				changedVal			+=	_fun({ (int)_site, (int)_t.j(b) }, { si, sj }) * changedIn; 
 			}
-		}
-	}
+		};
+
+	// ------------------- CHECK NN --------------------
+	_bonds(this->nn_);
+
+	// ------------------- CHECK NNN --------------------
+	if (!EQP(this->Jb, 0.0, 1e-9))
+		_bonds(this->nnn_);
 	
 	// return
 	return changedVal + localVal;
@@ -317,81 +350,83 @@ cpx XYZ<_T>::locEnergy(u64 _cur, uint _site, XYZ<_T>::NQSFun _fun)
 // ##########################################################################################################################################
 
 /*
-* Calculate the local energy end return the corresponding vectors with the value
-* @param _v base state
+* Emits the connections of the local energy for the given site
+* @param _cur base state
 * @param _site lattice site
-* @param _fun function for Neural Network Quantum State whenever the state changes (after potential flip) - nondiagonal
+* @param _buf buffer for the diagonal part and the flips with their matrix elements (nondiagonal)
 */
 template <typename _T>
-cpx XYZ<_T>::locEnergy(const DCOL& _cur, uint _site, XYZ<_T>::NQSFun _fun)
+void XYZ<_T>::locEnergyConn(const DCOL& _cur, uint _site, LocEnBuffer& _buf)
 {
 	// value that does not change
 	double localVal	= 0.0;
-	cpx changedVal	= 0.0;
-
-	// get number of forward nn
-	uint NUM_OF_NN	=	(uint)this->lat_->get_nn_ForwardNum(_site);
-	uint NUM_OF_NNN	=	(uint)this->lat_->get_nnn_ForwardNum(_site);
+	_buf.clear();
 
 	// -------------- perpendicular field --------------
 	const double si	=	checkBit(_cur, _site) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-	localVal		+=	PARAM_W_DISORDER(hz, _site) * si;
+	localVal		+=	this->nn_.hz(_site) * si;
 
 	// ---------------- transverse field ---------------
 	if (!EQP(this->hx, 0.0, 1e-9)) 
-		changedVal		+= _fun({ (int)_site }, { si }) * Operators::_SPIN_RBM * PARAM_W_DISORDER(hx, _site);
-
-	// ------------------- CHECK NN --------------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++) 
-	{
-		uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0) 
-		{
-			// SZiSZj
-			const double sj		=	checkBit(_cur, nei) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-			localVal			+=	PARAM_W_DISORDER(dA, _site) * PARAM_W_DISORDER(Ja, _site) * si * sj;
-
-			// SYiSYj
-			auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto changedIn		=	siY * sjY * PARAM_W_DISORDER(Ja, _site) * (1.0 + PARAM_W_DISORDER(eA, _site));
-
-			// SXiSXj
-			changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * PARAM_W_DISORDER(Ja, _site) * (1.0 - PARAM_W_DISORDER(eA, _site));
-			
-			// apply change
-			changedVal			+=	_fun({ (int)_site, nei }, { si, sj }) * changedIn; 
-		}
-	}
+		_buf.add((int)_site, si, Operators::_SPIN_RBM * this->nn_.hx(_site));
 
-	// ------------------- CHECK NNN --------------------
-	if (!EQP(this->Jb, 0.0, 1e-9))
-	{
-		for (uint nnn = 0; nnn < NUM_OF_NNN; nnn++) 
+	// the same kernel for the NN and the NNN bonds
+	auto _bonds = [&](const Bonds::Table& _t)
 		{
-			uint N_NUMBER = this->lat_->get_nnn_ForwardNum(_site, nnn);
-			if (int nei = this->lat_->get_nnn(_site, N_NUMBER); nei >= 0) 
+			for (uint b = _t.begin(_site); b < _t.end(_site); ++b)
 			{
+				const int nei		=	(int)_t.j(b);
+
 				// SZiSZj
-				const double sj			=	checkBit(_cur, nei) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-				localVal				+=	PARAM_W_DISORDER(dB, _site) * PARAM_W_DISORDER(Jb, _site) * si * sj;
+				const double sj		=	checkBit(_cur, nei) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+				localVal			+=	_t.Jz(b) * si * sj;
 
 				// SYiSYj
-				auto siY				=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-				auto sjY				=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-				auto changedIn			=	siY * sjY * PARAM_W_DISORDER(Jb, _site) * (1.0 + PARAM_W_DISORDER(eB, _site));
+				auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+				auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+				auto changedIn		=	siY * sjY * _t.Jy(b);
 
 				// SXiSXj
-				changedIn				+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * PARAM_W_DISORDER(Jb, _site) * (1.0 - PARAM_W_DISORDER(eB, _site));
-			
+				changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * _t.Jx(b);
+
 				// apply change
-				changedVal				+=	_fun({ (int)_site, nei }, { si, sj }) * changedIn; 
+				_buf.add((int)_site, nei, si, sj, changedIn);
 			}
-		}
-	}
+		};
+
+	// ------------------- CHECK NN --------------------
+	_bonds(this->nn_);
+
+	// ------------------- CHECK NNN --------------------
+	if (!EQP(this->Jb, 0.0, 1e-9))
+		_bonds(this->nnn_);
 	
-	// return
-	return changedVal + localVal;
+	if (!_buf.offDiagOnly())
+		_buf.addDiag(localVal);
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Diagonal element of the state of the full basis - the fields, the SzSz bonds and the parity breaking term
+*/
+template <typename _T>
+inline double XYZ<_T>::diagonal(u64 _state) const
+{
+	double _e = this->nn_.diagonal(_state) + this->nnn_.diagonal(_state, false);
+	if (this->parityBreak_)
+		_e += (this->Ns > 1) ? 2.0 : 1.0;
+	return _e;
+}
+
+/*
+* @brief Diagonal part of the local energy of the configuration (as in locEnergyConn summed over the sites)
+*/
+template <typename _T>
+inline double XYZ<_T>::diagonal(const DCOL& v) const
+{
+	const u64 _s = this->nn_.state(v);
+	return this->nn_.diagonal(_s) + (EQP(this->Jb, 0.0, 1e-9) ? 0.0 : this->nnn_.diagonal(_s, false));
 }
 
 // ##########################################################################################################################################
@@ -402,74 +437,54 @@ cpx XYZ<_T>::locEnergy(const DCOL& _cur, uint _site, XYZ<_T>::NQSFun _fun)
 template<typename _T>
 inline void XYZ<_T>::locEnergy(u64 _elemId, u64 _elem, uint _site)
 {
-	// get number of forward nn
-	uint NUM_OF_NN		= (uint)this->lat_->get_nn_ForwardNum(_site);
-	uint NUM_OF_NNN		= (uint)this->lat_->get_nnn_ForwardNum(_site);
 	u64 newIdx			= 0;
 	_T newVal			= 0;
 
 	// -------------- perpendicular field --------------
-	std::tie(newIdx, newVal) = Operators::sigma_z<_T>(_elem, this->Ns, { _site });
-	this->setHElem(_elemId, PARAM_W_DISORDER(hz, _site) * newVal, newIdx);
+	if (!this->diagPass_)
+	{
+		std::tie(newIdx, newVal) = Operators::sigma_z<_T>(_elem, this->Ns, { _site });
+		this->setHElem(_elemId, this->nn_.hz(_site) * newVal, newIdx);
 
-	if (this->parityBreak_ && (_site == 0 || _site == this->Ns - 1))
-		this->setHElem(_elemId, 1.0, newIdx);
+		if (this->parityBreak_ && (_site == 0 || _site == this->Ns - 1))
+			this->setHElem(_elemId, 1.0, newIdx);
+	}
 
 	// -------------- transverse field --------------
 	if (!EQP(this->hx, 0.0, 1e-9)) {
 		std::tie(newIdx, newVal) = Operators::sigma_x(_elem, this->Ns, { _site });
-		this->setHElem(_elemId, PARAM_W_DISORDER(hx, _site) * newVal, newIdx);
+		this->setHElem(_elemId, this->nn_.hx(_site) * newVal, newIdx);
 	}
 
+	// the same kernel for the NN and the NNN bonds
+	auto _bonds = [&](const Bonds::Table& _t)
+		{
+			for (uint b = _t.begin(_site); b < _t.end(_site); ++b)
+			{
+				const uint nei			= _t.j(b);
+				// SZiSZj (unless taken from the diagonal pass)
+				if (!this->diagPass_)
+				{
+					auto [idx_z, val_z]		= Operators::sigma_z<_T>(_elem, this->Ns,	{ _site });
+					auto [idx_z2, val_z2]	= Operators::sigma_z<_T>(idx_z, this->Ns,	{ nei });
+					this->setHElem(_elemId, _t.Jz(b) * (val_z * val_z2), idx_z2);
+				}
+				// SYiSYj
+				auto [idx_y, val_y]		= Operators::sigma_y(_elem, this->Ns,	{ _site });
+				auto [idx_y2, val_y2]	= Operators::sigma_y(idx_y, this->Ns,	{ nei });
+				this->setHElem(_elemId, _t.Jy(b) * std::real(val_y * val_y2), idx_y2);
+				// SXiSXj
+				auto [idx_x, val_x]		= Operators::sigma_x(_elem, this->Ns,	{ _site });
+				auto [idx_x2, val_x2]	= Operators::sigma_x(idx_x, this->Ns,	{ nei });
+				this->setHElem(_elemId, _t.Jx(b) * val_x * val_x2, idx_x2);
+			}
+		};
+
 	// -------------------------------------------------------- CHECK NN ---------------------------------------------------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++) {
-		uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0) {
-			// SZiSZj
-			auto [idx_z, val_z]		= Operators::sigma_z<_T>(_elem, this->Ns,	{ _site });
-			auto [idx_z2, val_z2]	= Operators::sigma_z<_T>(idx_z, this->Ns,	{ (uint)nei });
-			this->setHElem(_elemId, 
-							PARAM_W_DISORDER(dA, _site) * PARAM_W_DISORDER(Ja, _site) * (val_z * val_z2),
-							idx_z2);
-			// SYiSYj
-			auto [idx_y, val_y]		= Operators::sigma_y(_elem, this->Ns,	{ _site });
-			auto [idx_y2, val_y2]	= Operators::sigma_y(idx_y, this->Ns,	{ (uint)nei });
-			this->setHElem(_elemId, 
-							PARAM_W_DISORDER(Ja, _site) * (1.0 + PARAM_W_DISORDER(eA, _site)) * std::real(val_y * val_y2),
-							idx_y2);
-			// SXiSXj
-			auto [idx_x, val_x]		= Operators::sigma_x(_elem, this->Ns,	{ _site });
-			auto [idx_x2, val_x2]	= Operators::sigma_x(idx_x, this->Ns,	{ (uint)nei });
-			this->setHElem(_elemId,
-							PARAM_W_DISORDER(Ja, _site) * (1.0 - PARAM_W_DISORDER(eA, _site)) * val_x * val_x2,
-							idx_x2);
-		}
-	}
+	_bonds(this->nn_);
 
 	// -------------------------------------------------------- CHECK NNN ---------------------------------------------------------
-	for (uint nnn = 0; nnn < NUM_OF_NNN; nnn++) {
-		uint N_NUMBER = this->lat_->get_nnn_ForwardNum(_site, nnn);
-		if (int nei = this->lat_->get_nnn(_site, N_NUMBER); nei >= 0) {
-			// SZiSZj
-			auto [idx_z, val_z]		= Operators::sigma_z<_T>(_elem, this->Ns,	{ _site });
-			auto [idx_z2, val_z2]	= Operators::sigma_z<_T>(idx_z, this->Ns,	{ (uint)nei });
-			this->setHElem(_elemId,
-							PARAM_W_DISORDER(dB, _site) * PARAM_W_DISORDER(Jb, _site) * (val_z * val_z2),
-							idx_z2);
-			// SYiSYj
-			auto [idx_y, val_y]		= Operators::sigma_y(_elem, this->Ns,	{ _site });
-			auto [idx_y2, val_y2]	= Operators::sigma_y(idx_y, this->Ns,	{ (uint)nei });
-			this->setHElem(_elemId,
-							PARAM_W_DISORDER(Jb, _site) * (1.0 + PARAM_W_DISORDER(eB, _site)) * std::real(val_y * val_y2),
-							idx_y2);
-			// SXiSXj
-			auto [idx_x, val_x]		= Operators::sigma_x(_elem, this->Ns,	{ _site });
-			auto [idx_x2, val_x2]	= Operators::sigma_x(idx_x, this->Ns,	{ (uint)nei });
-			this->setHElem(_elemId,
-							PARAM_W_DISORDER(Jb, _site) * (1.0 - PARAM_W_DISORDER(eB, _site)) * val_x * val_x2,
-							idx_x2);
-		}
-	}
+	_bonds(this->nnn_);
 }
 
 // ##########################################################################################################################################
@@ -29,6 +29,10 @@ protected:
 	v_1d<double> hz;
 	v_1d<double> hx;
 
+	// precompiled couplings (the Heisenberg and the Kitaev parts of each bond are summed once)
+	Bonds::Table nn_;
+	void compileBonds();
+
 public:
 	// ######################################## Constructors ########################################
 	~HeisenbergKitaev()						{ LOGINFO(this->info() + " - destructor called.", LOG_TYPES::INFO, 3); };
@@ -60,7 +64,23 @@ public:
 
 	cpx locEnergy(const arma::Col<double>& _id,
 						uint site,
-						NQSFun f1)				override final;
+						NQSFun f1)				override final	{ return this->locEnergyFromConn(_id, site, f1); };
+	bool hasLocEnergyConn()				const	override final	{ return true; };
+	void locEnergyConn(const arma::Col<double>& _id,
+						uint site,
+						LocEnBuffer& _buf)		override final;
+	// ------------------------------------------- DIAGONAL PASS ---------------------------------------------
+	bool hasDiagonal()					const	override final	{ return true; };
+	double diagonal(u64 _state)			const	override final	{ return this->nn_.diagonal(_state);					};
+	double diagonal(const arma::Col<double>& v) const override final { return this->nn_.diagonal(this->nn_.state(v));	};
+	bool shareBonds(const Hamiltonian<_T, 2>& _other) override final
+	{
+		auto _o = dynamic_cast<const HeisenbergKitaev<_T>*>(&_other);
+		if (!_o || _o->Ns != this->Ns || _o->nn_.empty())
+			return false;
+		this->nn_ = _o->nn_;
+		return true;
+	};
 
 	// ############################################ Info #############################################
 
@@ -140,6 +160,7 @@ inline HeisenbergKitaev<_T>::HeisenbergKitaev(const Hilbert::HilbertSpace<_T>& h
 	//change info
 	this->info_ = this->info();
 	this->updateInfo();
+	this->compileBonds();
 }
 
 template<typename _T>
@@ -171,6 +192,7 @@ inline HeisenbergKitaev<_T>::HeisenbergKitaev(Hilbert::HilbertSpace<_T>&& hilber
 	//change info
 	this->info_ = this->info();
 	this->updateInfo();
+	this->compileBonds();
 }
 
 // ##########################################################################################################################################
@@ -179,6 +201,32 @@ inline HeisenbergKitaev<_T>::HeisenbergKitaev(Hilbert::HilbertSpace<_T>&& hilber
 
 // ##########################################################################################################################################
 
+/*
+* @brief Compiles the couplings into the bond table. The Kitaev coupling of the bond follows from the neighbor number
+* (z - 0, y - 1, x - 2) and is added to the Heisenberg one of the same component.
+*/
+template <typename _T>
+inline void HeisenbergKitaev<_T>::compileBonds()
+{
+	if (!this->lat_)
+		return;
+	this->nn_.compile(this->lat_, this->Ns, false,
+		[&](uint i) { return std::make_pair(this->hz[i], this->hx[i]); },
+		[&](uint i, uint, uint N_NUMBER)
+		{
+			Bonds::Coupling _c{ this->J[i] * this->delta[i], this->J[i], this->J[i] };
+			if (N_NUMBER == 0)			// z_bond
+				_c.Jz	+= this->Kz[i];
+			else if (N_NUMBER == 1)		// y_bond
+				_c.Jy	+= this->Ky[i];
+			else if (N_NUMBER == 2)		// x_bond
+				_c.Jx	+= this->Kx[i];
+			return _c;
+		});
+}
+
+// ##########################################################################################################################################
+
 /*
 * Calculate the local energy end return the corresponding vectors with the value
 * @param _cur base state index
@@ -192,50 +240,31 @@ cpx HeisenbergKitaev<_T>::locEnergy(u64 _cur, uint _site, HeisenbergKitaev<_T>::
 	double localVal		= 0.0;
 	cpx changedVal		= 0.0;
 
-	// get number of forward nn
-	uint NUM_OF_NN		= (uint)this->lat_->get_nn_ForwardNum(_site);
-
 	// -------------- perpendicular field --------------
-	const double si		=	checkBit(_cur, this->Ns - _site - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-	localVal			+= hz[_site] * si;
+	const double si		=	(_cur & this->nn_.siteMask(_site)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+	localVal			+= this->nn_.hz(_site) * si;
 
 	// ---------------- transverse field ---------------
-	if (!EQP(this->hx[_site], 0.0, 1e-9))
-		changedVal += _fun({ (int)_site }, { si }) * Operators::_SPIN_RBM * hx[_site];
+	if (!EQP(this->nn_.hx(_site), 0.0, 1e-9))
+		changedVal += _fun({ (int)_site }, { si }) * Operators::_SPIN_RBM * this->nn_.hx(_site);
 
 	// ------------------- CHECK NN --------------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++)
+	for (uint b = this->nn_.begin(_site); b < this->nn_.end(_site); ++b)
 	{
-		uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0)
-		{
-			// --------------------- HEISENBERG ---------------------
-			// SZiSZj
-			const double sj		=	checkBit(_cur, this->Ns - nei - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-			localVal			+= J[_site] * delta[_site] * si * sj;
-
-			// SYiSYj
-			auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto changedIn		=	siY * sjY * J[_site];
-
-			// SXiSXj
-			changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * J[_site];
-
-			// ----------------------- KITAEV -----------------------
-			// z_bond
-			if (N_NUMBER == 0)
-				localVal		+= this->Kz[_site] * si * sj;
-			// y_bond
-			else if (N_NUMBER == 1)
-				changedIn		+= siY * sjY * Ky[_site];
-			// x_bond
-			else if (N_NUMBER == 2)
-				changedIn		+= Operators::_SPIN_RBM * Operators::_SPIN_RBM * Kx[_site];
-
-			// apply change
-			changedVal			+= _fun({ (int)_site, nei }, { si, sj }) * changedIn;
-		}
+		// SZiSZj (Heisenberg and the Kitaev z_bond)
+		const double sj		=	(_cur & this->nn_.mask(b)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+		localVal			+= this->nn_.Jz(b) * si * sj;
+
+		// SYiSYj
+		auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+		auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+		auto changedIn		=	siY * sjY * this->nn_.Jy(b);
+
+		// SXiSXj
+		changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * this->nn_.Jx(b);
+
+		// apply change
+		changedVal			+= _fun({ (int)_site, (int)this->nn_.j(b) }, { si, sj }) * changedIn;
 	}
 	// return all
 	return changedVal + localVal;
@@ -243,59 +272,50 @@ cpx HeisenbergKitaev<_T>::locEnergy(u64 _cur, uint _site, HeisenbergKitaev<_T>::
 
 // ##########################################################################################################################################
 
+/*
+* @brief Emits the connections of the local energy for the given site
+* @param _cur base state
+* @param _site lattice site
+* @param _buf buffer for the diagonal part and the flips with their matrix elements
+*/
 template<typename _T>
-inline cpx HeisenbergKitaev<_T>::locEnergy(const arma::Col<double>& _cur, uint _site, NQSFun _fun)
+inline void HeisenbergKitaev<_T>::locEnergyConn(const arma::Col<double>& _cur, uint _site, LocEnBuffer& _buf)
 {
 	// value that does not change
 	double localVal		= 	0.0;
-	cpx changedVal		= 	0.0;
-
-	// get number of forward nn
-	const uint NUM_OF_NN= (uint)this->lat_->get_nn_ForwardNum(_site);
+	_buf.clear();
 
 	// -------------- perpendicular field --------------
 	const double si		=	Binary::check(_cur, _site) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-	if (!EQP(this->hz[_site], 0.0, 1e-9))
-		localVal		+= 	this->hz[_site] * si;
+	if (!EQP(this->nn_.hz(_site), 0.0, 1e-9))
+		localVal		+= 	this->nn_.hz(_site) * si;
 
 	// ---------------- transverse field ---------------
-	if (!EQP(this->hx[_site], 0.0, 1e-9))
-		changedVal 		+= 	_fun({ (int)_site }, { si }) * Operators::_SPIN_RBM * hx[_site];
+	if (!EQP(this->nn_.hx(_site), 0.0, 1e-9))
+		_buf.add((int)_site, si, Operators::_SPIN_RBM * this->nn_.hx(_site));
 
 	// ------------------- CHECK NN --------------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++)
+	for (uint b = this->nn_.begin(_site); b < this->nn_.end(_site); ++b)
 	{
-		const uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
+		const int nei		=	(int)this->nn_.j(b);
 
-		// get the nearest neighbor
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0)
-		{
-			// --------------------- HEISENBERG ---------------------
-			// SZiSZj
-			const double sj		= 	Binary::check(_cur, nei) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-			localVal			+= 	this->J[_site] * this->delta[_site] * si * sj;
-
-			// SYiSYj
-			auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
-			auto changedIn		=	siY * sjY * this->J[_site];
-
-			// SXiSXj
-			changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * this->J[_site];
-
-			// ----------------------- KITAEV -----------------------
-			if (N_NUMBER == 0) 		// z_bond
-				localVal		+= this->Kz[_site] * si * sj;
-			else if (N_NUMBER == 1) // y_bond
-				changedIn		+= siY * sjY * Ky[_site];
-			else if (N_NUMBER == 2) // x_bond
-				changedIn		+= Operators::_SPIN_RBM * Operators::_SPIN_RBM * Kx[_site];
-
-			// apply change
-			changedVal			+= _fun({ (int)_site, nei }, { si, sj }) * changedIn;
-		}
+		// SZiSZj (Heisenberg and the Kitaev z_bond)
+		const double sj		= 	Binary::check(_cur, nei) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+		localVal			+= 	this->nn_.Jz(b) * si * sj;
+
+		// SYiSYj
+		auto siY			=	si > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+		auto sjY			=	sj > 0 ? I * Operators::_SPIN_RBM : -I * Operators::_SPIN_RBM;
+		auto changedIn		=	siY * sjY * this->nn_.Jy(b);
+
+		// SXiSXj
+		changedIn			+=	Operators::_SPIN_RBM * Operators::_SPIN_RBM * this->nn_.Jx(b);
+
+		// apply change
+		_buf.add((int)_site, nei, si, sj, changedIn);
 	}
-	return changedVal + localVal;
+	if (!_buf.offDiagOnly())
+		_buf.addDiag(localVal);
 }
 
 // ##########################################################################################################################################
@@ -306,57 +326,44 @@ inline cpx HeisenbergKitaev<_T>::locEnergy(const arma::Col<double>& _cur, uint _
 template<typename _T>
 inline void HeisenbergKitaev<_T>::locEnergy(u64 _elemId, u64 _elem, uint _site)
 {
-	uint NUM_OF_NN		= (uint)this->lat_->get_nn_ForwardNum(_site);			// get number of forward nn at a given site _site 
 	u64 newIdx			= 0;													// new index (for the operators)		
 	_T newVal			= 0;													// new value (for the operators)
 
 	// -------------- perpendicular field --------------
-	if (!EQP(this->hz[_site], 0.0, 1e-9)) {
+	if (!this->diagPass_ && !EQP(this->nn_.hz(_site), 0.0, 1e-9)) {
 		std::tie(newIdx, newVal) = Operators::SpinOperators::sig_z<_T>(_elem, this->Ns_, { _site });
-		this->setHElem(_elemId, hz[_site] * newVal, newIdx);
+		this->setHElem(_elemId, this->nn_.hz(_site) * newVal, newIdx);
 	}
 
 	// -------------- transverse field --------------
-	if (!EQP(this->hx[_site], 0.0, 1e-9)) {
+	if (!EQP(this->nn_.hx(_site), 0.0, 1e-9)) {
 		std::tie(newIdx, newVal) = Operators::SpinOperators::sig_x<_T>(_elem, this->Ns_, { _site });
-		this->setHElem(_elemId, hx[_site] * newVal, newIdx);
+		this->setHElem(_elemId, this->nn_.hx(_site) * newVal, newIdx);
 	}
 
 	// ------------------- CHECK NN --------------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++)
+	for (uint b = this->nn_.begin(_site); b < this->nn_.end(_site); ++b)
 	{
-		const uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
+		const uint nei			= this->nn_.j(b);
 
-		// get the nearest neighbor
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0) 
+		// SZiSZj (diagonal elements, unless taken from the diagonal pass)
+		if (!this->diagPass_)
 		{
-			// --------------------- HEISENBERG ---------------------
-			// SZiSZj (diagonal elements)
 			auto [idx_z, val_z]		= Operators::SpinOperators::sig_z<_T>(_elem, this->Ns_, { _site });
-			auto [idx_z2, val_z2]	= Operators::SpinOperators::sig_z<_T>(idx_z, this->Ns_, { (uint)nei });
-			this->setHElem(_elemId,	J[_site] * delta[_site] * (val_z * val_z2), idx_z2);
-
-			// SYiSYj
-			auto [idx_y, val_y]		= Operators::sigma_y(_elem, this->Ns, { _site });
-			auto [idx_y2, val_y2]	= Operators::sigma_y(idx_y, this->Ns, { (uint)nei });
-			this->setHElem(_elemId, J[_site] * algebra::real(val_y * val_y2), idx_y2);
-
-			// SXiSXj
-			auto [idx_x, val_x]		= Operators::SpinOperators::sig_x<_T>(_elem, this->Ns, { _site });
-			auto [idx_x2, val_x2]	= Operators::SpinOperators::sig_x<_T>(idx_x, this->Ns, { (uint)nei });
-			this->setHElem(_elemId,	J[_site] * val_x * val_x2,	idx_x2);
-
-			// ----------------------- KITAEV -----------------------
-			if (N_NUMBER == 0) 		// z_bond
-				this->setHElem(_elemId, this->Kz[_site] * algebra::real(val_z * val_z2), idx_z2);
-			else if (N_NUMBER == 1) // y_bond
-				this->setHElem(_elemId, this->Ky[_site] * algebra::real(val_y * val_y2), idx_y2);
-			else if (N_NUMBER == 2) // x_bond
-				this->setHElem(_elemId, this->Kx[_site] * algebra::real(val_x * val_x2), idx_x2);
+			auto [idx_z2, val_z2]	= Operators::SpinOperators::sig_z<_T>(idx_z, this->Ns_, { nei });
+			this->setHElem(_elemId,	this->nn_.Jz(b) * (val_z * val_z2), idx_z2);
 		}
-	}
-}
 
+		// SYiSYj
+		auto [idx_y, val_y]		= Operators::sigma_y(_elem, this->Ns, { _site });
+		auto [idx_y2, val_y2]	= Operators::sigma_y(idx_y, this->Ns, { nei });
+		this->setHElem(_elemId, this->nn_.Jy(b) * algebra::real(val_y * val_y2), idx_y2);
 
+		// SXiSXj
+		auto [idx_x, val_x]		= Operators::SpinOperators::sig_x<_T>(_elem, this->Ns, { _site });
+		auto [idx_x2, val_x2]	= Operators::SpinOperators::sig_x<_T>(idx_x, this->Ns, { nei });
+		this->setHElem(_elemId,	this->nn_.Jx(b) * val_x * val_x2,	idx_x2);
+	}
+}
 
 #endif
\ No newline at end of file
@@ -21,6 +21,10 @@ protected:
 	DISORDER_EQUIV(double, g);
 	DISORDER_EQUIV(double, h);
 
+	// precompiled couplings (the lattice and the disorder are resolved once)
+	Bonds::Table nn_;
+	void compileBonds();
+
 	//arma::vec tmp_vec;
 	//vec tmp_vec2;
 
@@ -43,7 +47,23 @@ public:
 	cpx locEnergy(u64 _id, uint site, NQSFun f1)		override final;
 	cpx locEnergy(const arma::Col<double>& v,
 				  uint site,
-				  NQSFun f1)							override final;
+				  NQSFun f1)							override final	{ return this->locEnergyFromConn(v, site, f1); };
+	bool hasLocEnergyConn()						const	override final	{ return true; };
+	void locEnergyConn(const arma::Col<double>& v,
+				  uint site,
+				  LocEnBuffer& _buf)					override final;
+	// ------------------------------------------- DIAGONAL PASS ---------------------------------------------
+	bool hasDiagonal()					const	override final	{ return true; };
+	double diagonal(u64 _state)			const	override final	{ return this->nn_.diagonal(_state);					};
+	double diagonal(const arma::Col<double>& v) const override final { return this->nn_.diagonal(this->nn_.state(v));	};
+	bool shareBonds(const Hamiltonian<_T, 2>& _other) override final
+	{
+		auto _o = dynamic_cast<const IsingModel<_T>*>(&_other);
+		if (!_o || _o->Ns != this->Ns || _o->nn_.empty())
+			return false;
+		this->nn_ = _o->nn_;
+		return true;
+	};
 
 	// ------------------------------------------- 				 Info				  -------------------------------------------
 
@@ -88,6 +108,7 @@ IsingModel<_T>::IsingModel(const Hilbert::HilbertSpace<_T>& hilbert, double J, d
 	//change info
 	this->info_			=			this->info();
 	this->updateInfo();
+	this->compileBonds();
 	LOGINFOG("I am Transverse Field Ising: " + this->info_, LOG_TYPES::CHOICE, 2);
 }
 
@@ -105,62 +126,57 @@ IsingModel<_T>::IsingModel(Hilbert::HilbertSpace<_T>&&hilbert, double J, double
 	//change info
 	this->info_			=			this->info();
 	this->updateInfo();
+	this->compileBonds();
 	LOGINFOG("I am Transverse Field Ising: " + this->info_, LOG_TYPES::CHOICE, 2);
 }
 
 // ----------------------------------------------------------------------------- LOCAL ENERGY -------------------------------------------------------------------------------------
 
+/*
+* @brief Compiles the couplings into the bond table - the perpendicular (h) and the transverse (g) fields are the on-site part.
+*/
+template<typename _T>
+inline void IsingModel<_T>::compileBonds()
+{
+	if (!this->lat_)
+		return;
+	this->nn_.compile(this->lat_, this->Ns, false,
+		[&](uint i) { return std::make_pair(PARAM_W_DISORDER(h, i), PARAM_W_DISORDER(g, i)); },
+		[&](uint i, uint, uint) { return Bonds::Coupling{ PARAM_W_DISORDER(J, i), 0.0, 0.0 }; });
+}
+
+// -----------------------------------------------------------------------------
+
 /*
 * @brief body of setting up of the Hamiltonian
 */
 template<typename _T>
 inline void IsingModel<_T>::locEnergy(u64 _elemId, u64 _elem, uint _site)
 {
-	// get number of forward nn
-	uint NUM_OF_NN	= (uint)this->lat_->get_nn_ForwardNum(_site);
 	u64 newIdx		= 0;
 	_T newVal		= 0;
 
-	//stout << EL << "____________________________" << EL;
-	//stout << VEQ(_elemId) << EL;
-	//stout << VEQ(_site) << EL;
-	//stout << VEQ(_elem) << EL;
-	//arma::Col<int> tmp(4, arma::fill::zeros);
-	//intToBase(_elem, tmp);
-	//stout << tmp.t() << EL << EL;
-
 	// -------------- perpendicular field --------------
-	std::tie(newIdx, newVal) = Operators::sigma_z<_T>(_elem, this->Ns, { _site });
-	//stout << "Z:" << newIdx << ":" << newVal << EL;
-	//intToBase(newIdx, tmp);
-	//stout << tmp.t() << EL << EL;
-	this->setHElem(_elemId, PARAM_W_DISORDER(h, _site) * newVal, newIdx);
+	if (!this->diagPass_) {
+		std::tie(newIdx, newVal) = Operators::sigma_z<_T>(_elem, this->Ns, { _site });
+		this->setHElem(_elemId, this->nn_.hz(_site) * newVal, newIdx);
+	}
 
 	// -------------- transverse field --------------
 	if (!EQP(this->g, 0.0, 1e-9)) {
 		std::tie(newIdx, newVal) = Operators::sigma_x(_elem, this->Ns, { _site });
-		//stout << "X:" << newIdx << ":" << newVal << EL;
-		//intToBase(newIdx, tmp);
-		//stout << tmp.t() << EL << EL;
-		this->setHElem(_elemId, PARAM_W_DISORDER(g, _site) * newVal, newIdx);
+		this->setHElem(_elemId, this->nn_.hx(_site) * newVal, newIdx);
 	}
 
 	// -------------- CHECK NN ---------------
-	for (uint nn = 0; nn < NUM_OF_NN; nn++) {
-		uint N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
-		if (int nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0) {
-			// Ising-like spin correlation
-			auto [idx_z, val_z]			=		Operators::sigma_z<_T>(_elem, this->Ns, { _site });
-			auto [idx_z2, val_z2]		=		Operators::sigma_z<_T>(idx_z, this->Ns, { (uint)nei });
-			//stout << "NEI:" << idx_z2 << ":" << val_z2 * val_z << EL;
-			//intToBase(idx_z2, tmp);
-			//stout << tmp.t() << EL << EL;
-			this->setHElem(_elemId, 
-								PARAM_W_DISORDER(J, _site) * (val_z * val_z2), 
-								idx_z2);
-		}
+	if (this->diagPass_)
+		return;
+	for (uint b = this->nn_.begin(_site); b < this->nn_.end(_site); ++b) {
+		// Ising-like spin correlation
+		auto [idx_z, val_z]			=		Operators::sigma_z<_T>(_elem, this->Ns, { _site });
+		auto [idx_z2, val_z2]		=		Operators::sigma_z<_T>(idx_z, this->Ns, { this->nn_.j(b) });
+		this->setHElem(_elemId, this->nn_.Jz(b) * (val_z * val_z2), idx_z2);
 	}
-	//stout << "____________________________" << EL << EL;
 }
 
 // -----------------------------------------------------------------------------
@@ -174,60 +190,55 @@ inline cpx IsingModel<_T>::locEnergy(u64 _id, uint site, NQSFun f1)
 	double _locVal		=	0.0;			// unchanged state value
 	cpx _changedVal		=	0.0;			// changed state value			
 
-	// get number of forward nn
-	uint NUM_OF_NN		=	(uint)this->lat_->get_nn_ForwardNum(site);
-
 	// check spin at a given site
-	double _Si			=	checkBit(_id, this->Ns - site - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+	double _Si			=	(_id & this->nn_.siteMask(site)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
 
 	// add to a local value
-	_locVal				+=	PARAM_W_DISORDER(h, site) * _Si;
+	_locVal				+=	this->nn_.hz(site) * _Si;
 
 	// check the S_i^z * S_{i+1}^z
-	for (uint nn = 0; nn < NUM_OF_NN; nn++) {
-		auto N_NUMBER = this->lat_->get_nn_ForwardNum(site, nn);
-		if (auto nei = this->lat_->get_nn(site, N_NUMBER); nei >= 0) {
-			double _Sj	=	checkBit(_id, this->Ns - nei - 1) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-			_locVal		+=	PARAM_W_DISORDER(J, site) * _Si * _Sj;
-		}
+	for (uint b = this->nn_.begin(site); b < this->nn_.end(site); ++b) {
+		double _Sj		=	(_id & this->nn_.mask(b)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+		_locVal			+=	this->nn_.Jz(b) * _Si * _Sj;
 	}
 	// -----------------------------------------------------------
 	_changedVal			+=	f1(std::initializer_list<int>({ (int)site }),
-							   std::initializer_list<double>({ _Si })) * PARAM_W_DISORDER(g, site) * Operators::_SPIN_RBM;
+							   std::initializer_list<double>({ _Si })) * this->nn_.hx(site) * Operators::_SPIN_RBM;
 
 	// -----------------------------------------------------------
 	return _changedVal + _locVal;
 }
 
+/*
+* @brief Emits the connections of the local energy for the given site
+* @param v base state
+* @param _site lattice site
+* @param _buf buffer for the diagonal part and the flips with their matrix elements
+*/
 template<typename _T>
-inline cpx IsingModel<_T>::locEnergy(const arma::Col<double>& v, uint _site, NQSFun f1)
+inline void IsingModel<_T>::locEnergyConn(const arma::Col<double>& v, uint _site, LocEnBuffer& _buf)
 {
 	double _locVal		=	0.0;			// unchanged state value
-	cpx _changedVal		=	0.0;			// changed state value			
+	_buf.clear();
 
 	// check spin at a given site
 	double _Si			=	Binary::check(v, _site) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
 
 	// add to a local value
-	_locVal				+=	PARAM_W_DISORDER(h, _site) * _Si;
+	_locVal				+=	this->nn_.hz(_site) * _Si;
 
 	// check the S_i^z * S_{i+1}^z
-	for (uint nn = 0; nn < (uint)this->lat_->get_nn_ForwardNum(_site); ++nn) 
+	for (uint b = this->nn_.begin(_site); b < this->nn_.end(_site); ++b) 
 	{
-		auto N_NUMBER = this->lat_->get_nn_ForwardNum(_site, nn);
-		if (auto nei = this->lat_->get_nn(_site, N_NUMBER); nei >= 0) 
-		{
-			double _Sj	=	Binary::check(v, nei) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
-			_locVal		+=	PARAM_W_DISORDER(J, _site) * _Si * _Sj;
-		}
+		double _Sj		=	Binary::check(v, this->nn_.j(b)) ? Operators::_SPIN_RBM : -Operators::_SPIN_RBM;
+		_locVal			+=	this->nn_.Jz(b) * _Si * _Sj;
 	}
 	// -----------------------------------------------------------
-	if (!EQP(this->g, 0.0, 1e-9)) {
-		_changedVal			+=	f1(std::initializer_list<int>({ (int)_site }),
-								std::initializer_list<double>({ _Si })) * PARAM_W_DISORDER(g, _site) * Operators::_SPIN_RBM;
-	}
+	if (!EQP(this->g, 0.0, 1e-9))
+		_buf.add((int)_site, _Si, this->nn_.hx(_site) * Operators::_SPIN_RBM);
 	// -----------------------------------------------------------
-	return _changedVal + _locVal;
+	if (!_buf.offDiagOnly())
+		_buf.addDiag(_locVal);
 }
 
 //
@@ -277,12 +288,8 @@ void IsingModel<_T>::hamiltonian() {
 		LOGINFOG("Empty Hilbert, not building anything.", LOG_TYPES::INFO, 1);
 		return;
 	}
-	this->init();
-	for (u64 k = 0; k < this->Nh; k++) {
-		u64 kMap = this->hilbertSpace.getMapping(k);
-		for (uint site_ = 0; site_ <= this->Ns - 1; site_++)
-			this->locEnergy(k, kMap, site_);
-	}
+	// the base builder (serial or threaded)
+	Hamiltonian<_T>::hamiltonian();
 }
 
 
@@ -8,6 +8,7 @@
 #define POWER_LAW_RANDOM_BANDED_H
 
 #include "../defines/prlb_def.hpp"
+#include "../../algebra/band_solver.h"
 
 /*
 * @brief: This class is an instance of the Power Law Random Banded model.
@@ -17,8 +18,14 @@ class PowerLawRandomBanded : public QuadraticHamiltonian<_T>
 {
 	double a_ = 1.0;
 	double b_ = 1.0;
+
+	// band truncation
+	double bandCut_		= 0.0;			// the elements with the envelope 1/sqrt(1 + (|i-j|/b)^{2a}) below the cut are dropped (0 - full matrix)
+	u64 band_			= 0;			// number of the kept superdiagonals
+	arma::Mat<_T> AB_;					// upper band storage (band_ + 1) x Nh (LAPACK format)
 protected:
 	void checkQuadratic() override;
+	void hamiltonianBand();
 public:
 	~PowerLawRandomBanded()
 	{
@@ -87,15 +94,20 @@ public:
 
 	void set_a(double _a) { this->a_ = _a; this->updateInfo(); };
 	void set_b(double _b) { this->b_ = _b; this->updateInfo(); };
+	void setBandCut(double _cut) { this->bandCut_ = std::max(_cut, 0.0); this->updateInfo(); };
 
 	// ------------------------------------------- 				 Getters				  -------------------------------------------
 
 	double get_a() const { return this->a_; };
 	double get_b() const { return this->b_; };
+	u64 getBandWidth() const;
+	auto getBand() const -> const arma::Mat<_T>& { return this->AB_; };
 
 	// ### H A M I L T O N I A N ###
 
 	void hamiltonian() override;
+	using QuadraticHamiltonian<_T>::diagH;
+	void diagH(bool woEigVec = false) override;
 
 	// ------------------------------------------- 				 Info				  -------------------------------------------
 
@@ -104,6 +116,8 @@ public:
 		std::string name = sep + "plrb,Ns=" + STR(this->Ns);
 		name += ",a=" + STRP(a_, 3);
 		name += ",b=" + STRP(b_, 3);
+		if (this->bandCut_ > 0.0)
+			name += ",cut=" + STRP(bandCut_, 3);
 		return this->QuadraticHamiltonian<_T>::info(name, skip, sep);
 	}
 	void updateInfo()									override final { this->info_ = this->info(); };
@@ -147,6 +161,12 @@ inline void PowerLawRandomBanded<_T>::hamiltonian()
 		LOGINFOG("Empty Hilbert, not building anything.", LOG_TYPES::INFO, 1);
 		return;
 	}
+	this->AB_.reset();
+	if (this->bandCut_ > 0.0)
+	{
+		this->hamiltonianBand();
+		return;
+	}
 	this->init();
 
 	const double _power = 2.0 * this->a_; 
@@ -158,19 +178,25 @@ inline void PowerLawRandomBanded<_T>::hamiltonian()
 	// when the distance between the particles is calculated in many body Hilbert space.
 	// (according to this, the Ns = log2(Nh) and the distance is calculated as the difference
 	// between the indices of the particles in this big Hilbert space)
-	for (size_t i = 0; i < this->Nh_; i++)
+	// the element (i, j) is the (i * Nh + j)-th number of the counter-based stream, so the rows are filled in parallel
+	const auto _stream	= this->ranStream();
+	const u64 _Nh		= this->Nh_;
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threadNum_) schedule(dynamic, 16)
+#endif
+	for (long long i = 0; i < (long long)_Nh; i++)
 	{
-		for (size_t j = i; j < this->Nh_; j++)
+		for (u64 j = i; j < _Nh; j++)
 		{
 			double _distance	= 0.0;
 			if (i != j)
 			{
-				_distance = (long double)std::abs(int(i - j)) * _binv;
+				_distance = (long double)(j - i) * _binv;
 				_distance = std::pow(_distance, _power);
 			}
 
 			// set Hamiltonian element
-			auto _val = this->ran_.random(-1.0, 1.0) / std::sqrt(1.0 + _distance);
+			auto _val = (2.0 * _stream.uniform(i * _Nh + j) - 1.0) / std::sqrt(1.0 + _distance);
 			this->H_.set(i, j, _val);
 			// do I need to set the other side of the matrix?
 			this->H_.set(j, i, _val);
@@ -178,5 +204,87 @@ inline void PowerLawRandomBanded<_T>::hamiltonian()
 	}
 }
 
+// ##########################################################################################################################################
+
+/*
+* @brief Number of the superdiagonals kept with the cut - the largest distance d for which 1/sqrt(1 + (d/b)^{2a}) >= cut
+*/
+template<typename _T>
+inline u64 PowerLawRandomBanded<_T>::getBandWidth() const
+{
+	if (this->bandCut_ <= 0.0 || this->Nh_ == 0)
+		return this->Nh_ > 0 ? this->Nh_ - 1 : 0;
+	if (this->bandCut_ >= 1.0)
+		return 0;
+	const double _d = this->b_ * std::pow(1.0 / (this->bandCut_ * this->bandCut_) - 1.0, 1.0 / (2.0 * this->a_));
+	return (u64)std::min<double>(std::floor(_d), (double)(this->Nh_ - 1));
+}
+
+/*
+* @brief Builds the truncated Hamiltonian in the band format. The kept elements are the same as in the full matrix (the element (i, j)
+* is the (i * Nh + j)-th number of the stream), the dropped ones are bounded by the cut and their expected Frobenius norm is reported.
+* The band (LAPACK format) is used by the band eigensolver, while H_ is set as the sparse matrix for the rest of the library.
+*/
+template<typename _T>
+inline void PowerLawRandomBanded<_T>::hamiltonianBand()
+{
+	const double _power = 2.0 * this->a_; 
+	const double _binv  = 1.0 / this->b_;
+	const u64 _Nh		= this->Nh_;
+	const u64 _w		= this->getBandWidth();
+	const auto _stream	= this->ranStream();
+	this->band_			= _w;
+
+	auto _envelope		= [&](u64 _d) -> double { return _d == 0 ? 1.0 : 1.0 / std::sqrt(1.0 + std::pow((double)_d * _binv, _power)); };
+
+	BEGIN_CATCH_HANDLER
+	{
+		this->AB_.zeros(_w + 1, _Nh);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threadNum_) schedule(static)
+#endif
+		for (long long j = 0; j < (long long)_Nh; ++j)
+			for (u64 i = (j > (long long)_w ? j - _w : 0); i <= (u64)j; ++i)
+				BandSolver::at(this->AB_, _w, i, j) = algebra::cast<_T>((2.0 * _stream.uniform(i * _Nh + j) - 1.0) * _envelope(j - i));
+
+		// sparse copy (both triangles) - the flag follows the storage, so that the rest of the library treats H_ as sparse
+		this->isSparse_	= true;
+		this->H_ = GeneralizedMatrix<_T>(_Nh, true);
+		this->H_.setSparse(Operators::Builder::sparse<_T>(_Nh, _Nh, [&](u64 c, std::vector<std::pair<u64, _T>>& _out)
+			{
+				for (u64 i = (c > _w ? c - _w : 0); i <= std::min<u64>(c + _w, _Nh - 1); ++i)
+					_out.emplace_back(i, i <= c ? this->AB_(_w + i - c, c) : algebra::conjugate(this->AB_(_w + c - i, i)));
+			}));
+	}
+	END_CATCH_HANDLER("Memory exceeded", std::runtime_error("Memory for the banded PRLB Hamiltonian exceeded"););
+
+	// expected squared Frobenius norm of the dropped part (E[u^2] = 1/3 for u in [-1, 1])
+	double _dropped		= 0.0;
+	for (u64 _d = _w + 1; _d < _Nh; ++_d)
+		_dropped		+= 2.0 * (double)(_Nh - _d) * _envelope(_d) * _envelope(_d) / 3.0;
+	LOGINFO("PRLB band: " + VEQ(_w) + ", " + VEQP(std::sqrt(_dropped), 3) + " (expected Frobenius norm of the dropped part)", LOG_TYPES::TRACE, 3);
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Diagonalizes the Hamiltonian. With the band truncation the band is reduced directly (dsbevd / zhbevd), otherwise the
+* general procedure is used.
+* @param woEigVec does not compute the eigenvectors
+*/
+template<typename _T>
+inline void PowerLawRandomBanded<_T>::diagH(bool woEigVec)
+{
+	if (this->AB_.empty())
+	{
+		QuadraticHamiltonian<_T>::diagH(woEigVec);
+		return;
+	}
+	arma::Mat<_T> _AB = this->AB_;
+	BandSolver::eig(_AB, this->band_, this->eigVal_, woEigVec ? nullptr : &this->eigVec_);
+	this->calcAvEn();
+	this->streamEigVec();
+}
+
 #endif // !POWER_LAW_RANDOM_BANDED_H
 
@@ -52,7 +52,7 @@ public:
 	void setRandomXi(double _around, double _strength)			{ this->xi_ = this->ran_.template rvector<v_1d<double>>(this->Nout_, _strength, _around); };
 	void setRandomAlpha(double _around, double _strength)		{ this->a_ = this->ran_.template rvector<v_1d<double>>(this->Nout_, _strength, _around); };
 	void setRandomMagnetic(double _around, double _strength)	{ this->h_ = this->ran_.template rvector<v_1d<double>>(this->Nout_, _strength, _around); };
-	void setRandomHDot()										{ this->Hdot_ = this->ran_.template GOE<_T>(this->dimIn_); this->Hdot_ = this->gamma_ / sqrt(this->dimIn_ + 1) * this->Hdot_; };
+	void setRandomHDot()										{ this->Hdot_ = RandomStreams::GOE<_T>(this->ranStream(), this->dimIn_, this->threadNum_); this->Hdot_ = this->gamma_ / sqrt(this->dimIn_ + 1) * this->Hdot_; };
 	void randomize(double _a, double _s, const strVec& _which)	override final;
 public:
 	~QSM() override;
@@ -418,7 +418,7 @@ inline void QSM<_T>::initializeParticles()
 
 	// generate the random Hamiltonian for the dot
 	if(typeid(_T) == typeid(double))
-		this->Hdot_ = this->ran_.template GOE<_T>(this->dimIn_);
+		this->Hdot_ = RandomStreams::GOE<_T>(this->ranStream(), this->dimIn_, this->threadNum_);
 	else
 		this->Hdot_ = this->ran_.template CUE<_T>(this->dimIn_);
 	// normalize
@@ -496,20 +496,15 @@ inline void QSM<_T>::hamiltonian()
 	for(int i = 0; i < this->Nout_; ++i)
 		LOGINFO("QSM: i=" + STR(i) + " -> h=" + STRP(this->h_[i], 5) + ", a^u=" + STRP(this->au_[i], 5), LOG_TYPES::INFO, 2);
 
-	// go through all the elements of the Hilbert space
-	for (u64 k = 0; k < this->Nh; ++k) 
-	{
-		u64 _elem	= this->hilbertSpace.getMapping(k);
-
-		// go through all the particles outside the dot
-		for (size_t _part = this->Nin_; _part <= (this->Ns_ - 1); ++_part)
-			this->locEnergy(k, _elem, _part);
-	}
+	// the local part - the magnetic fields and the spin-flips with the dot (go through all the elements of the Hilbert space)
+	auto _H = std::make_shared<Operators::Kron::KronOperator<_T>>(this->Nh);
+	_H->setSparse(this->hamiltonianLocal());
 
 	// add the random Hamiltonian of the dot. This is treated as an operator acting only on the left 
-	// side of the tensor product and the identity on the right side (A^A \otimes I^B)
+	// side of the tensor product and the identity on the right side (A^A \otimes I^B) - kept as the factor
 	// (THIRD TERM)
-	this->H_ += arma::kron(this->Hdot_, EYE(this->dimOut_));
+	_H->addKron(this->Hdot_, this->dimOut_);
+	this->setStructured(_H);
 
 //#ifdef _DEBUG
 //	std::cout << this->H_.getSparse() << std::endl;
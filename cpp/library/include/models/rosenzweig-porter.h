@@ -26,6 +26,11 @@ protected:
 	arma::Col<double> diag_;
 
 	void checkQuadratic() override;
+	// distributed diagonalization - the elements of the owned blocks are drawn directly from the stream
+	auto hasLocalBlocks()						const -> bool override	{ return true; };
+#ifdef HAMIL_USE_SCALAPACK
+	auto hamiltonianBlocks(DistEig::DistMatrix<_T>& _Hd) -> void override;
+#endif
 public:
 	void randomize(double _a, double _s, const strVec& _which)	override final;
 public:
@@ -243,11 +248,33 @@ inline void RosenzweigPorter<_T>::hamiltonian()
 	this->H_.diagD() = algebra::cast<_T>(this->diag_);
 
 	// build the Hamiltonian (offdiagonal)
-	this->H_ += this->gammaP_inv_ * this->ran_.template GUE<_T>(this->Nh_);
+	this->H_ += this->gammaP_inv_ * RandomStreams::GUE<_T>(this->ranStream(), this->Nh_, this->threadNum_);
 }
 
 // ##########################################################################################################################################
 
+#ifdef HAMIL_USE_SCALAPACK
+/*
+* @brief Local blocks of the RP Hamiltonian - the same matrix as hamiltonian(), as the (i, j) element of the random part
+* is a fixed number of the stream (see RandomStreams::gaussian). Each rank evaluates only its elements.
+* @param _Hd distributed matrix (resized to the Hilbert space)
+*/
+template<typename _T>
+inline void RosenzweigPorter<_T>::hamiltonianBlocks(DistEig::DistMatrix<_T>& _Hd)
+{
+	this->randomize(0.0, 1.0, {"g"});
+	const auto _s	= this->ranStream();
+	const u64 _n	= this->Nh_;
+	_Hd.fill((int)this->Nh, [&](u64 i, u64 j) -> _T
+		{
+			const _T _g	= this->gammaP_inv_ * RandomStreams::gaussian<_T>(_s, _n, i, j);
+			return i == j ? _g + algebra::cast<_T>(this->diag_(i)) : _g;
+		}, this->threadNum_);
+}
+#endif
+
+// ##########################################################################################################################################
+
 /*
 * @brief Calculates the local energy of the QSM model. The local energy is calculated for a specific particle at a specific site.
 * @param _elemId: the index of the element in the Hilbert space.
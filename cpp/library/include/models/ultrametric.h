@@ -37,7 +37,7 @@ protected:
 	void initializeParticles();
 
 public:
-	void setRandomHDot()										{ this->Hdot_ = this->ran_.template GOE<_T>(this->dimIn_); this->Hdot_ = 1.0 / sqrt(this->dimIn_ + 1) * this->Hdot_; };
+	void setRandomHDot()										{ this->Hdot_ = RandomStreams::GOE<_T>(this->ranStream(), this->dimIn_, this->threadNum_); this->Hdot_ = 1.0 / sqrt(this->dimIn_ + 1) * this->Hdot_; };
 	void randomize(double _a, double _s, const strVec& _which)	override final;
 public:
 	~Ultrametric() override;
@@ -266,7 +266,7 @@ inline void Ultrametric<_T>::initializeParticles()
 
 	// generate the random Hamiltonian for the dot
 	if(typeid(_T) == typeid(double))
-		this->Hdot_ = this->ran_.template GOE<_T>(this->dimIn_);
+		this->Hdot_ = RandomStreams::GOE<_T>(this->ranStream(), this->dimIn_, this->threadNum_);
 	else
 		this->Hdot_ = this->ran_.template CUE<_T>(this->dimIn_);
 	// normalize
@@ -321,6 +321,7 @@ inline void Ultrametric<_T>::hamiltonian()
 		return;
 	}
 	this->init();
+	auto _H = std::make_shared<Operators::Kron::KronOperator<_T>>(this->Nh);
 
 	// go through all the elements of the Hilbert space
 #ifdef ULTRAMETRIC_USE_DIFFERENT_BLOCKS
@@ -334,25 +335,27 @@ inline void Ultrametric<_T>::hamiltonian()
 		auto _mult		=	k == 0 ? 1.0 / std::sqrt(_dim + 1) : (this->g0_ * this->au_[k - 1]  / std::sqrt(_dim + 1));
 
 #ifdef ULTRAMETRIC_USE_DIFFERENT_BLOCKS
-		arma::Mat<_T> Hk(this->Nh, this->Nh, arma::fill::zeros);
-		// create various blocks of the Hamiltonian
-		for (int i = 0; i < _dimrest; ++i)
-		{
-			Hk.submat(i * _dim, i * _dim, (i + 1) * _dim - 1, (i + 1) * _dim - 1) += this->ran_.template GOE<_T>(_dim);
-			//this->H_.print("H=" + VEQ(k) + ":" + VEQ(i));
-		}
-		this->H_ += _mult * Hk;
+		// create various blocks of the Hamiltonian (independent diagonal blocks, each from its own substream - filled in parallel)
+		const auto _stream = this->ranStream();
+		v_1d<arma::Mat<_T>> _blocks(_dimrest);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(this->threadNum_) schedule(dynamic)
+#endif
+		for (long long i = 0; i < (long long)_dimrest; ++i)
+			_blocks[i] = RandomStreams::GOE<_T>(_stream.sub(i), _dim);
+		_H->addBlocks(std::move(_blocks), 1, _mult);
 #else
 		// repeat the blocks multiple times (sample the diagonal blocks independently)
-		this->H_ += _mult * arma::kron(this->ran_.template GOE<_T>(_dim), EYE(_dimrest));
+		_H->addKron(RandomStreams::GOE<_T>(this->ranStream(), _dim, this->threadNum_), _dimrest, _mult);
 #endif
 	}
 	// add the random Hamiltonian of the dot. This is treated as an operator acting only on the left 
 	// side of the tensor product and the identity on the right side (A^A \otimes I^B)
 	// (THIRD TERM)
 #ifndef ULTRAMETRIC_USE_DIFFERENT_BLOCKS
-	this->H_ += arma::kron(this->Hdot_, EYE(this->dimOut_));
+	_H->addKron(this->Hdot_, this->dimOut_);
 #endif
+	this->setStructured(_H);
 	//saveAlgebraic("C:/University/PHD/CODES/VQMC/QSolver/cpp/library/", "H.h5", arma::Mat<_T>(H_), "H", false);
 }
 
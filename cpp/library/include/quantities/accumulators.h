@@ -0,0 +1,195 @@
+#pragma once
+/***************************************
+* Defines the streaming accumulators of
+* the statistics - the moments (Welford),
+* the typical values and the histograms
+* with the fixed logarithmic bins. All of
+* them are mergeable, so that they can be
+* collected per thread and per realization
+* without keeping the raw samples.
+***************************************/
+
+#ifndef ACCUMULATORS_H
+#define ACCUMULATORS_H
+
+#include <cmath>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace Accumulators
+{
+	/*
+	* @brief Running mean and variance (Welford). Two accumulators merge exactly (Chan et al.), independent of the
+	* order of the samples, therefore, the thread-local ones can be combined at the end.
+	*/
+	struct Welford
+	{
+		double n_							= 0.0;										// number of the samples
+		double mean_						= 0.0;										// running mean
+		double m2_							= 0.0;										// sum of the squared deviations
+
+		void reset()														{ this->n_ = 0.0; this->mean_ = 0.0; this->m2_ = 0.0;	};
+		void add(double _x)
+		{
+			this->n_		+= 1.0;
+			const double _d	= _x - this->mean_;
+			this->mean_		+= _d / this->n_;
+			this->m2_		+= _d * (_x - this->mean_);
+		}
+		void merge(const Welford& _o)
+		{
+			if (_o.n_ == 0.0)
+				return;
+			const double _n	= this->n_ + _o.n_;
+			const double _d	= _o.mean_ - this->mean_;
+			this->mean_		+= _d * _o.n_ / _n;
+			this->m2_		+= _o.m2_ + _d * _d * this->n_ * _o.n_ / _n;
+			this->n_		= _n;
+		}
+
+		auto count()						const -> double						{ return this->n_;														};
+		auto mean()							const -> double						{ return this->mean_;													};
+		auto var()							const -> double						{ return this->n_ > 1.0 ? this->m2_ / (this->n_ - 1.0) : 0.0;			};
+		auto std()							const -> double						{ return std::sqrt(this->var());										};
+		auto meanSq()						const -> double						{ return this->n_ > 0.0 ? this->m2_ / this->n_ + this->mean_ * this->mean_ : 0.0; };
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Moments of the (off-diagonal) matrix elements as used by the ETH statistics - in the order
+	* [mean, log|x|, |x|^2, log|x|^2, |x|^4, |x|], all collected in a single pass without the raw elements. The exact zeros
+	* (e.g. forbidden by a symmetry) do not enter the logarithms - the typical values are those of the nonzero elements.
+	*/
+	struct ElementMoments
+	{
+		Welford re_, abs_, abs2_, log_;														// real part, modulus, squared modulus and log of the modulus
+
+		template <typename _T>
+		void add(const _T& _x)
+		{
+			const double _a		= std::abs(_x);
+			this->re_.add(std::real(_x));
+			this->abs_.add(_a);
+			this->abs2_.add(_a * _a);
+			if (_a > 0.0)
+				this->log_.add(std::log(_a));
+		}
+		void merge(const ElementMoments& _o)									{ this->re_.merge(_o.re_); this->abs_.merge(_o.abs_); this->abs2_.merge(_o.abs2_); this->log_.merge(_o.log_); };
+		void reset()															{ this->re_.reset(); this->abs_.reset(); this->abs2_.reset(); this->log_.reset(); };
+		auto count()						const -> double						{ return this->re_.count();												};
+
+		/*
+		* @brief Means in the layout of the ETH statistics (the typical ones as the means of the logarithms)
+		*/
+		auto means()						const -> std::array<double, 6>
+		{
+			return { this->re_.mean(), this->log_.mean(), this->abs2_.mean(), 2.0 * this->log_.mean(), this->abs2_.meanSq(), this->abs_.mean() };
+		}
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Histogram with the fixed, logarithmically uniform bins collecting the running mean of the values in each bin
+	* (e.g. |O_nm|^2 binned in omega). The bin is found by the arithmetic on the logarithm (no search), the values outside
+	* of [min, max) are dropped. For the typical values, the logarithms shall be appended and averages_av(true) returns
+	* their exponential.
+	*/
+	class LogHistogram
+	{
+	protected:
+		uint nBins_							= 1;
+		double logMin_						= 0.0;
+		double dLog_						= 1.0;
+		arma::Col<double> edges_;															// edges of the bins (nBins_ + 1)
+		std::vector<Welford> bins_;															// moments in each bin
+	public:
+		LogHistogram()						= default;
+		LogHistogram(uint _nBins)												{ this->reset(_nBins);													};
+		LogHistogram(uint _nBins, double _max, double _min)						{ this->reset(_nBins); this->uniformLog(_max, _min);						};
+
+		/*
+		* @brief Sets the number of the bins and clears the counts
+		*/
+		void reset(uint _nBins)
+		{
+			this->nBins_	= std::max(_nBins, 1u);
+			this->bins_.assign(this->nBins_, Welford());
+		}
+
+		/*
+		* @brief Clears the counts (keeps the bins)
+		*/
+		void clear()															{ this->bins_.assign(this->nBins_, Welford());							};
+
+		/*
+		* @brief Sets the logarithmically uniform bins between _min and _max (clears the counts)
+		*/
+		void uniformLog(double _max, double _min)
+		{
+			this->logMin_	= std::log(_min);
+			this->dLog_		= (std::log(_max) - this->logMin_) / this->nBins_;
+			this->edges_	= arma::exp(arma::linspace(this->logMin_, std::log(_max), this->nBins_ + 1));
+			this->bins_.assign(this->nBins_, Welford());
+		}
+
+		/*
+		* @brief Index of the bin of _x (nBins_ if outside)
+		*/
+		auto bin(double _x)					const -> uint
+		{
+			if (!(_x > 0.0))
+				return this->nBins_;
+			const double _b = (std::log(_x) - this->logMin_) / this->dLog_;
+			return (_b < 0.0 || _b >= this->nBins_) ? this->nBins_ : (uint)_b;
+		}
+
+		void append(double _x, double _v)
+		{
+			const uint _b = this->bin(_x);
+			if (_b < this->nBins_)
+				this->bins_[_b].add(_v);
+		}
+
+		/*
+		* @brief Merges the histogram with the same bins
+		*/
+		void merge(const LogHistogram& _o)
+		{
+			for (uint i = 0; i < this->nBins_ && i < _o.nBins_; ++i)
+				this->bins_[i].merge(_o.bins_[i]);
+		}
+
+		auto nBins()						const -> uint						{ return this->nBins_;													};
+		auto edgesCol()						const -> arma::Col<double>			{ return this->edges_;													};
+		auto countsCol()					const -> arma::Col<double>
+		{
+			arma::Col<double> _c(this->nBins_);
+			for (uint i = 0; i < this->nBins_; ++i)
+				_c(i) = this->bins_[i].count();
+			return _c;
+		}
+
+		/*
+		* @brief Means of the values in the bins (exponentiated for the typical values)
+		*/
+		auto averages_av(bool _typical = false) const -> arma::Col<double>
+		{
+			arma::Col<double> _a(this->nBins_);
+			for (uint i = 0; i < this->nBins_; ++i)
+				_a(i) = _typical ? std::exp(this->bins_[i].mean()) : this->bins_[i].mean();
+			return _a;
+		}
+		auto variances()					const -> arma::Col<double>
+		{
+			arma::Col<double> _v(this->nBins_);
+			for (uint i = 0; i < this->nBins_; ++i)
+				_v(i) = this->bins_[i].var();
+			return _v;
+		}
+	};
+};
+
+#endif // !ACCUMULATORS_H
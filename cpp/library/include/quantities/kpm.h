@@ -0,0 +1,223 @@
+#pragma once
+/***********************************
+* Defines the kernel polynomial method
+* (KPM). The Chebyshev moments of the
+* rescaled Hamiltonian are computed once
+* with the sparse products only (no
+* diagonalization) and the densities -
+* the local and the momentum resolved
+* spectral functions - are reconstructed
+* on any grid of omegas. The start
+* vectors go in blocks to the threads,
+* each block writes its own columns,
+* therefore, the result does not depend
+* on the number of the threads.
+* Ref: Weisse et al., RMP 78, 275 (2006)
+***********************************/
+
+#ifndef KPM_H
+#define KPM_H
+
+#include <cmath>
+#include <vector>
+#include <complex>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "armadillo"
+
+namespace KPM
+{
+	constexpr double KPM_EPS				= 0.01;											// relative padding of the spectral bounds
+	constexpr uint KPM_BLOCK				= 16;											// start vectors in a single block (one sparse-dense product per step)
+	constexpr double KPM_LORENTZ			= 4.0;											// default lambda of the Lorentz kernel
+
+	enum class Kernel { JACKSON, LORENTZ, DIRICHLET };
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Rescaling of the spectrum onto (-1, 1) - H~ = (H - b) / a
+	*/
+	struct Scale
+	{
+		double a_							= 1.0;
+		double b_							= 0.0;
+
+		auto x(double _w)					const -> double									{ return (_w - this->b_) / this->a_;		};
+
+		/*
+		* @brief From the known bounds of the spectrum
+		*/
+		static auto fromBounds(double _emin, double _emax, double _eps = KPM_EPS) -> Scale
+		{
+			Scale _s;
+			_s.a_							= std::max((_emax - _emin) / (2.0 - _eps), 1e-12);
+			_s.b_							= (_emax + _emin) / 2.0;
+			return _s;
+		}
+	};
+
+	/*
+	* @brief Gershgorin bounds of the Hermitian matrix (a single pass over the elements)
+	* @param _H sparse or dense Hermitian matrix
+	*/
+	template <typename _M>
+	inline auto bounds(const _M& _H, double _eps = KPM_EPS) -> Scale
+	{
+		arma::Col<double> _c(_H.n_cols, arma::fill::zeros), _r(_H.n_cols, arma::fill::zeros);
+		if constexpr (arma::is_arma_sparse_type<_M>::value)
+		{
+			for (auto _it = _H.begin(); _it != _H.end(); ++_it)
+				if (_it.row() == _it.col())
+					_c(_it.col()) = std::real(*_it);
+				else
+					_r(_it.col()) += std::abs(*_it);
+		}
+		else
+		{
+			for (arma::uword j = 0; j < _H.n_cols; ++j)
+				for (arma::uword i = 0; i < _H.n_rows; ++i)
+					if (i == j)
+						_c(j) = std::real(_H(i, j));
+					else
+						_r(j) += std::abs(_H(i, j));
+		}
+		return Scale::fromBounds((_c - _r).min(), (_c + _r).max(), _eps);
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Column-wise real part of <A_j|B_j>
+	*/
+	template <typename _T>
+	inline auto cdot(const arma::Mat<_T>& _A, const arma::Mat<_T>& _B) -> arma::Row<double>
+	{
+		if constexpr (std::is_same_v<_T, double>)
+			return arma::sum(_A % _B, 0);
+		else
+			return arma::real(arma::sum(arma::conj(_A) % _B, 0));
+	}
+
+	/*
+	* @brief Chebyshev moments of the block of the start vectors - two moments per product (mu_2n = 2<a_n|a_n> - mu_0,
+	* mu_2n+1 = 2<a_n+1|a_n> - mu_1). A single sparse-dense product per step for all the columns.
+	* @param _H Hermitian matrix (sparse or dense, the element type of V)
+	* @param _s rescaling of the spectrum
+	* @param _N number of the moments
+	* @param _V start vectors (columns)
+	* @returns moments (N x n_cols)
+	*/
+	template <typename _T, typename _M>
+	inline auto chebyshev(const _M& _H, const Scale& _s, uint _N, const arma::Mat<_T>& _V) -> arma::Mat<double>
+	{
+		arma::Mat<double> _mu(_N, _V.n_cols, arma::fill::zeros);
+		if (_N == 0)
+			return _mu;
+		arma::Mat<_T> _aPrev				= _V;
+		arma::Mat<_T> _aCur					= (_H * _V - _s.b_ * _V) / _s.a_;
+		arma::Mat<_T> _aNext;
+		_mu.row(0)							= cdot(_V, _V);
+		if (_N > 1)
+			_mu.row(1)						= cdot(_V, _aCur);
+		for (uint n = 1; 2 * n < _N; ++n)
+		{
+			_mu.row(2 * n)					= 2.0 * cdot(_aCur, _aCur) - _mu.row(0);
+			if (2 * n + 1 >= _N)
+				break;
+			_aNext							= (2.0 / _s.a_) * (_H * _aCur - _s.b_ * _aCur) - _aPrev;
+			_mu.row(2 * n + 1)				= 2.0 * cdot(_aNext, _aCur) - _mu.row(1);
+			_aPrev.swap(_aCur);
+			_aCur.swap(_aNext);
+		}
+		return _mu;
+	}
+
+	// ------------------------------------------------------------------------------------------------------------------------------------------
+
+	/*
+	* @brief Moments of all the columns of V, the blocks of KPM_BLOCK columns go to the threads
+	* (e.g. V = 1 - the LDOS of all the sites, V = DFT vectors - the momentum resolved spectral functions)
+	*/
+	template <typename _T, typename _M>
+	inline auto diagonal(const _M& _H, const Scale& _s, uint _N, const arma::Mat<_T>& _V, uint _threads = 1) -> arma::Mat<double>
+	{
+		arma::Mat<double> _mu(_N, _V.n_cols, arma::fill::zeros);
+		const long long _nB					= (long long)((_V.n_cols + KPM_BLOCK - 1) / KPM_BLOCK);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(_threads, 1u)) schedule(dynamic)
+#endif
+		for (long long b = 0; b < _nB; ++b)
+		{
+			const arma::uword _c0			= (arma::uword)b * KPM_BLOCK;
+			const arma::uword _c1			= std::min<arma::uword>(_c0 + KPM_BLOCK, _V.n_cols) - 1;
+			_mu.cols(_c0, _c1)				= chebyshev(_H, _s, _N, arma::Mat<_T>(_V.cols(_c0, _c1)));
+		}
+		return _mu;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Damping factors of the truncated Chebyshev series (Jackson - the Gaussian resolution ~ pi a / N)
+	*/
+	inline auto kernel(uint _N, Kernel _k = Kernel::JACKSON, double _lambda = KPM_LORENTZ) -> arma::Col<double>
+	{
+		arma::Col<double> _g(_N, arma::fill::ones);
+		const double _q						= PI / (_N + 1.0);
+		for (uint n = 0; n < _N; ++n)
+		{
+			switch (_k)
+			{
+			case Kernel::JACKSON:
+				_g(n)						= ((_N - n + 1) * std::cos(_q * n) + std::sin(_q * n) / std::tan(_q)) / (_N + 1.0);
+				break;
+			case Kernel::LORENTZ:
+				_g(n)						= std::sinh(_lambda * (1.0 - (double)n / _N)) / std::sinh(_lambda);
+				break;
+			default:
+				break;
+			}
+		}
+		return _g;
+	}
+
+	/*
+	* @brief Densities on the grid of omegas from the moments - rho_j(w) = [g_0 mu_0j + 2 sum_n g_n mu_nj T_n(x)] / (pi a sqrt(1 - x^2)),
+	* x = (w - b) / a (zero outside of the rescaled spectrum)
+	* @param _mu moments (N x n_cols)
+	* @returns densities (n_omegas x n_cols)
+	*/
+	inline auto reconstruct(const arma::Mat<double>& _mu, const arma::Col<double>& _omegas, const Scale& _s,
+							Kernel _k = Kernel::JACKSON, uint _threads = 1) -> arma::Mat<double>
+	{
+		const uint _N						= (uint)_mu.n_rows;
+		arma::Mat<double> _out(_omegas.n_elem, _mu.n_cols, arma::fill::zeros);
+		if (_N == 0)
+			return _out;
+		const arma::Mat<double> _gmu		= _mu.each_col() % kernel(_N, _k);
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(std::max(_threads, 1u))
+#endif
+		for (long long w = 0; w < (long long)_omegas.n_elem; ++w)
+		{
+			const double _x					= _s.x(_omegas(w));
+			if (std::abs(_x) >= 1.0)
+				continue;
+			// Chebyshev polynomials at x
+			arma::Col<double> _Tn(_N);
+			_Tn(0)							= 1.0;
+			if (_N > 1)
+				_Tn(1)						= _x;
+			for (uint n = 2; n < _N; ++n)
+				_Tn(n)						= 2.0 * _x * _Tn(n - 1) - _Tn(n - 2);
+			if (_N > 1)
+				_Tn.subvec(1, _N - 1)		*= 2.0;
+			_out.row(w)						= (_Tn.t() * _gmu) / (PI * _s.a_ * std::sqrt(1.0 - _x * _x));
+		}
+		return _out;
+	}
+};
+
+#endif // !KPM_H
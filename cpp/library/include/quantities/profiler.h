@@ -0,0 +1,235 @@
+#pragma once
+/***********************************
+* Defines the instrumentation of the
+* hot paths - scoped timers and the
+* counters kept per thread (no locks
+* on the hot path), the totals and the
+* per-iteration trace (CSV and HDF5).
+* Compiled out unless QES_PROFILE is
+* defined (CMake option QES_PROFILE).
+***********************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef QES_PROFILE
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+namespace Profiler
+{
+	// timed sections - the names form the hierarchy (stage/section)
+	enum class Slot : unsigned
+	{
+		SAMPLE,				// nqs/sample - Metropolis block sampling
+		LOCEN,				// nqs/locen - local energies
+		SR_SOLVE,			// nqs/sr - stochastic reconfiguration (gradient and solve)
+		WEIGHTS,			// nqs/weights - weight update
+		H5_WRITE,			// io/h5 - HDF5 writes
+		H_BUILD,			// ed/build - Hamiltonian build
+		DIAG,				// ed/diag - diagonalization
+		SLOTS
+	};
+	inline constexpr std::array<const char*, (size_t)Slot::SLOTS> SLOT_NAMES = { "nqs/sample", "nqs/locen", "nqs/sr", "nqs/weights", "io/h5", "ed/build", "ed/diag" };
+
+	enum class Counter : unsigned
+	{
+		PRATIO,				// probability ratio evaluations
+		PROPOSED,			// Metropolis proposals
+		ACCEPTED,			// accepted proposals
+		SR_ITERS,			// iterations of the SR solver
+		COUNTERS
+	};
+	inline constexpr std::array<const char*, (size_t)Counter::COUNTERS> COUNTER_NAMES = { "pratio", "proposed", "accepted", "sr_iters" };
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Totals of a single thread. Only the owner writes (relaxed load + store, no lock prefix), the snapshot reads them
+	* from any thread.
+	*/
+	struct Local
+	{
+		std::array<std::atomic<uint64_t>, (size_t)Slot::SLOTS> ns_		= {};
+		std::array<std::atomic<uint64_t>, (size_t)Slot::SLOTS> calls_	= {};
+		std::array<std::atomic<uint64_t>, (size_t)Counter::COUNTERS> cnt_ = {};
+
+		static void bump(std::atomic<uint64_t>& _a, uint64_t _v)		{ _a.store(_a.load(std::memory_order_relaxed) + _v, std::memory_order_relaxed); };
+	};
+
+	/*
+	* @brief Totals of all the threads and the per-iteration trace (differences of the totals between the iterations)
+	*/
+	class Registry
+	{
+	protected:
+		std::mutex mutex_;
+		std::vector<std::shared_ptr<Local>> locals_;									// kept after the thread exits
+		std::vector<double> last_;														// totals at the previous iteration
+		std::vector<std::vector<double>> trace_;
+
+	public:
+		static auto get() -> Registry&													{ static Registry _r; return _r; };
+
+		auto add() -> std::shared_ptr<Local>
+		{
+			auto _l							= std::make_shared<Local>();
+			std::lock_guard<std::mutex> _lock(this->mutex_);
+			this->locals_.push_back(_l);
+			return _l;
+		}
+
+		/*
+		* @brief Totals: time [s] and the calls of each slot, then the counters
+		*/
+		auto totals() -> std::vector<double>
+		{
+			std::vector<double> _t(2 * (size_t)Slot::SLOTS + (size_t)Counter::COUNTERS, 0.0);
+			std::lock_guard<std::mutex> _lock(this->mutex_);
+			for (const auto& _l : this->locals_)
+			{
+				for (size_t i = 0; i < (size_t)Slot::SLOTS; ++i)
+				{
+					_t[2 * i]				+= 1e-9 * (double)_l->ns_[i].load(std::memory_order_relaxed);
+					_t[2 * i + 1]			+= (double)_l->calls_[i].load(std::memory_order_relaxed);
+				}
+				for (size_t i = 0; i < (size_t)Counter::COUNTERS; ++i)
+					_t[2 * (size_t)Slot::SLOTS + i] += (double)_l->cnt_[i].load(std::memory_order_relaxed);
+			}
+			return _t;
+		}
+
+		/*
+		* @brief Closes the iteration - the row of the trace is the difference of the totals with the previous one
+		*/
+		void iteration(uint64_t _i)
+		{
+			auto _t							= this->totals();
+			if (this->last_.size() != _t.size())
+				this->last_.assign(_t.size(), 0.0);
+			std::vector<double> _row		= { (double)_i };
+			for (size_t i = 0; i < _t.size(); ++i)
+				_row.push_back(_t[i] - this->last_[i]);
+			const double _prop				= _row[1 + 2 * (size_t)Slot::SLOTS + (size_t)Counter::PROPOSED];
+			const double _acc				= _row[1 + 2 * (size_t)Slot::SLOTS + (size_t)Counter::ACCEPTED];
+			_row.push_back(_prop > 0 ? _acc / _prop : 0.0);
+			this->trace_.push_back(std::move(_row));
+			this->last_						= std::move(_t);
+		}
+
+		static auto header() -> std::vector<std::string>
+		{
+			std::vector<std::string> _h		= { "iter" };
+			for (auto _n : SLOT_NAMES)
+			{
+				_h.push_back(std::string(_n) + "/time");
+				_h.push_back(std::string(_n) + "/calls");
+			}
+			for (auto _n : COUNTER_NAMES)
+				_h.push_back(_n);
+			_h.push_back("acceptance");
+			return _h;
+		}
+
+		/*
+		* @brief Writes the trace to _dir/_name.csv and _dir/_name.h5 ("trace", the columns as in the CSV header) and clears it
+		*/
+		void save(const std::string& _dir, const std::string& _name)
+		{
+			if (this->trace_.empty())
+				return;
+			const auto _h					= header();
+			{
+				std::ofstream _f(_dir + _name + ".csv");
+				for (size_t j = 0; j < _h.size(); ++j)
+					_f << (j ? "," : "") << _h[j];
+				_f << "\n";
+				for (const auto& _row : this->trace_)
+				{
+					for (size_t j = 0; j < _row.size(); ++j)
+						_f << (j ? "," : "") << _row[j];
+					_f << "\n";
+				}
+			}
+			arma::mat _M(this->trace_.size(), _h.size());
+			for (size_t i = 0; i < this->trace_.size(); ++i)
+				_M.row(i)					= arma::rowvec(this->trace_[i]);
+			_M.save(arma::hdf5_name(_dir + _name + ".h5", "trace"));
+			this->trace_.clear();
+		}
+
+		/*
+		* @brief Drops the trace without writing it (the ranks that do not save)
+		*/
+		void clear()																	{ this->trace_.clear(); };
+
+		/*
+		* @brief Logs the totals of all the slots and the counters
+		*/
+		void report()
+		{
+			const auto _t					= this->totals();
+			for (size_t i = 0; i < (size_t)Slot::SLOTS; ++i)
+				if (_t[2 * i + 1] > 0)
+					LOGINFO(std::string(SLOT_NAMES[i]) + ": " + STRP(_t[2 * i], 6) + "s in " + STR((uint64_t)_t[2 * i + 1]) + " calls", LOG_TYPES::TRACE, 2);
+			for (size_t i = 0; i < (size_t)Counter::COUNTERS; ++i)
+				LOGINFO(std::string(COUNTER_NAMES[i]) + ": " + STR((uint64_t)_t[2 * (size_t)Slot::SLOTS + i]), LOG_TYPES::TRACE, 2);
+		}
+	};
+
+	/*
+	* @brief Totals of the calling thread (registered on the first use)
+	*/
+	inline auto local() -> Local&
+	{
+		thread_local std::shared_ptr<Local> _l = Registry::get().add();
+		return *_l;
+	}
+
+	inline void count(Counter _c, uint64_t _n)											{ Local::bump(local().cnt_[(size_t)_c], _n); };
+
+	/*
+	* @brief Scoped timer of the slot
+	*/
+	class Scope
+	{
+	protected:
+		Slot slot_;
+		std::chrono::steady_clock::time_point t0_;
+	public:
+		explicit Scope(Slot _s) : slot_(_s), t0_(std::chrono::steady_clock::now())		{};
+		~Scope()
+		{
+			auto& _l						= local();
+			Local::bump(_l.ns_[(size_t)this->slot_], (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->t0_).count());
+			Local::bump(_l.calls_[(size_t)this->slot_], 1);
+		}
+		Scope(const Scope&)					= delete;
+		Scope& operator=(const Scope&)		= delete;
+	};
+};
+
+#	define PROF_CAT_(a, b)					a##b
+#	define PROF_CAT(a, b)					PROF_CAT_(a, b)
+#	define PROF_SCOPE(slot)					Profiler::Scope PROF_CAT(_profScope, __LINE__)(Profiler::Slot::slot)
+#	define PROF_COUNT(cnt, n)				Profiler::count(Profiler::Counter::cnt, (uint64_t)(n))
+#	define PROF_ITERATION(i)				Profiler::Registry::get().iteration((uint64_t)(i))
+#	define PROF_SAVE(dir, name)				do { Profiler::Registry::get().report(); Profiler::Registry::get().save(dir, name); } while (0)
+#	define PROF_CLEAR()						Profiler::Registry::get().clear()
+#else
+#	define PROF_SCOPE(slot)
+#	define PROF_COUNT(cnt, n)				((void)0)
+#	define PROF_ITERATION(i)				((void)0)
+#	define PROF_SAVE(dir, name)				((void)0)
+#	define PROF_CLEAR()						((void)0)
+#endif // QES_PROFILE
+
+#endif // !PROFILER_H
@@ -18,6 +18,9 @@
 #	include "../algebra/operators.h"
 #endif // !OPERATORS_H
 
+// Gershgorin bounds of the spectrum
+#include "kpm.h"
+
 constexpr auto SYSTEM_PROPERTIES_MIN_SPACING = 1e-15;
 constexpr auto SYSTEM_PROPERTIES_THROW_DEGENERATE = 1;
 constexpr auto SYSTEM_PROPERTIES_COEFF_THRESHOLD = 1e-11;
@@ -67,6 +70,154 @@ namespace SystemProperties
 
 		// ---------------------------------------------------------------------------
 
+		/*
+		* @brief Calculates the coefficients of the time evolved state in the eigenbasis for a block of times.
+		* The column j contains a_n(t_j) = exp(-i E_n t_j) <n|psi(0)>.
+		* @param _eigvals - the eigenvalues of the system
+		* @param _overlaps - the overlaps of the state with the eigenstates
+		* @param _times - the block of times
+		* @returns the matrix of the coefficients (Nh x Nt)
+		*/
+		template <typename _S>
+		[[nodiscard]]
+		inline arma::Mat<std::complex<double>> time_evo_coeff(const arma::Col<double>& _eigvals,
+															  const _S& _overlaps,
+															  const arma::Col<double>& _times)
+		{
+			arma::Mat<std::complex<double>> _ret = arma::exp(-I * (_eigvals * _times.t()));
+			_ret.each_col() %= arma::conv_to<arma::Col<std::complex<double>>>::from(_overlaps);
+			return _ret;
+		}
+
+		/*
+		* @brief Multiplies the matrix by the complex block. For real matrices, the real and imaginary parts are
+		* multiplied separately, which keeps the real BLAS-3 (or sparse) kernel without the complex copy of the matrix.
+		* @param _M - the matrix (dense or sparse, real or complex)
+		* @param _A - the complex block
+		* @returns _M * _A
+		*/
+		template <typename _M>
+		[[nodiscard]]
+		inline arma::Mat<std::complex<double>> apply_block(const _M& _mat, const arma::Mat<std::complex<double>>& _A)
+		{
+			if constexpr (std::is_same_v<typename _M::elem_type, double>)
+				return arma::Mat<std::complex<double>>(_mat * arma::real(_A), _mat * arma::imag(_A));
+			else
+				return _mat * _A;
+		}
+
+		template <typename _T2>
+		[[nodiscard]]
+		inline arma::Mat<std::complex<double>> apply_block(const GeneralizedMatrix<_T2>& _mat, const arma::Mat<std::complex<double>>& _A)
+		{
+			if (_mat.isSparse())
+				return apply_block(_mat.getSparse(), _A);
+			return apply_block(_mat.getDense(), _A);
+		}
+
+		/*
+		* @brief Calculate the time evolution of the state for a block of times with a single matrix-matrix product
+		* |psi(t_j)> = V * a(t_j), instead of summing the eigenvectors one by one for each time separately.
+		* @param _eigenstates - the eigenstates of the system
+		* @param _coeff - the coefficients from time_evo_coeff
+		* @returns the time evolved states as columns (Nh x Nt)
+		*/
+		template <typename _T>
+		[[nodiscard]]
+		inline arma::Mat<std::complex<double>> time_evo_block(const arma::Mat<_T>& _eigenstates, const arma::Mat<std::complex<double>>& _coeff)
+		{
+			return apply_block(_eigenstates, _coeff);
+		}
+
+		/*
+		* @brief Expectation values <psi(t_j)|O|psi(t_j)> for a block of states
+		* @param _mat - the operator in the same basis as the states (for the eigenbasis V^+OV and the coefficients from time_evo_coeff)
+		* @param _states - the states as columns
+		* @returns the vector of the expectation values for each column
+		*/
+		template <typename _M>
+		[[nodiscard]]
+		inline arma::Col<std::complex<double>> time_evo_expectation(const _M& _mat, const arma::Mat<std::complex<double>>& _states)
+		{
+			return arma::sum(arma::conj(_states) % apply_block(_mat, _states), 0).st();
+		}
+
+		// ---------------------------------------------------------------------------
+
+		/*
+		* @brief Chebyshev expansion of the propagator exp(-iH dt) acting on the state without the diagonalization.
+		* The Hamiltonian is rescaled to H' = (H - b) / a with the spectrum inside [-1, 1] and
+		* exp(-iH dt)|psi> = exp(-i b dt) sum_k (2 - delta_k0) (-i)^k J_k(a dt) T_k(H')|psi>,
+		* where T_k are obtained from the three-term recurrence with the sparse matrix-vector products only.
+		* The expansion is truncated when the Bessel functions fall below the tolerance (order ~ a dt).
+		* The spectral bounds come from the Gershgorin estimate, which is a proven bound of the whole spectrum.
+		*/
+		template <typename _M>
+		class ChebyshevPropagator
+		{
+		protected:
+			const _M& H_;
+			double a_		= 1.0;															// half width of the spectrum
+			double b_		= 0.0;															// center of the spectrum
+			double tol_		= 1e-12;														// truncation of the expansion
+
+			auto apply(const arma::Col<std::complex<double>>& _v) const -> arma::Col<std::complex<double>> { return apply_block(this->H_, _v).as_col(); };
+
+		public:
+			/*
+			* @brief Takes the spectral bounds from the Gershgorin circles (see KPM::bounds) - they enclose the whole spectrum, so the
+			* rescaled H' never leaves [-1, 1] and T_k(H') stay bounded for any order of the expansion
+			* @param _H - the Hamiltonian matrix
+			* @param _tol - the tolerance of the expansion
+			*/
+			ChebyshevPropagator(const _M& _H, double _tol = 1e-12)
+				: H_(_H), tol_(_tol)
+			{
+				const auto _scale				= KPM::bounds(_H);
+				this->a_						= _scale.a_;
+				this->b_						= _scale.b_;
+			}
+
+			auto getA()							const -> double								{ return this->a_;					};
+			auto getB()							const -> double								{ return this->b_;					};
+
+			/*
+			* @brief Evolves the state by the time step
+			* @param _psi - the state at time t
+			* @param _dt - the time step
+			* @returns the state at time t + dt
+			*/
+			auto evolve(const arma::Col<std::complex<double>>& _psi, double _dt) const -> arma::Col<std::complex<double>>
+			{
+				if (_dt == 0.0)
+					return _psi;
+				const double _x					= this->a_ * _dt;
+				const uint _maxOrder			= (uint)(std::abs(_x) + 20.0 * std::cbrt(std::abs(_x)) + 30.0);
+
+				// T_0 and T_1
+				arma::Col<std::complex<double>> _t0	= _psi;
+				arma::Col<std::complex<double>> _t1	= (this->apply(_psi) - this->b_ * _psi) / this->a_;
+				arma::Col<std::complex<double>> _ret	= std::cyl_bessel_j(0.0, std::abs(_x)) * _t0;
+				std::complex<double> _ik		= -I * (_x < 0 ? -1.0 : 1.0);
+				_ret							+= 2.0 * _ik * std::cyl_bessel_j(1.0, std::abs(_x)) * _t1;
+
+				for (uint k = 2; k < _maxOrder; ++k)
+				{
+					const double _jk			= std::cyl_bessel_j((double)k, std::abs(_x));
+					arma::Col<std::complex<double>> _t2 = 2.0 * (this->apply(_t1) - this->b_ * _t1) / this->a_ - _t0;
+					_ik							*= -I * (_x < 0 ? -1.0 : 1.0);
+					_ret						+= 2.0 * _ik * _jk * _t2;
+					_t0							= std::move(_t1);
+					_t1							= std::move(_t2);
+					if (k > std::abs(_x) && std::abs(_jk) < this->tol_)
+						break;
+				}
+				return std::exp(-I * this->b_ * _dt) * _ret;
+			}
+		};
+
+		// ---------------------------------------------------------------------------
+
 		enum class QuenchTypes
 		{
 			// random
@@ -285,8 +436,8 @@ namespace SystemProperties
 			// energy at _idx
 			double _E 						= 	_energies(_idx);
 
-			// Precompute constants
-			const arma::Row<_T> _Velems 	= _V.row(_idx);
+			// Precompute constants (the operator is Hermitian - the column is contiguous, unlike the row)
+			const arma::Col<_T> _Velems 	= _V.unsafe_col(_idx);
 			const arma::Col<double> _omm 	= arma::square(_energies - _E);
 			const double _mu2 				= _mu * _mu;
 
@@ -0,0 +1,554 @@
+#pragma once
+/***********************************
+* Defines the pipelined writer of the
+* HDF5 outputs of the UI. The datasets
+* of a checkpoint are staged in memory
+* (grouped by the file), each file is
+* opened once per stage and the writes
+* run on a background thread while the
+* next realization is computed.
+* The extendible datasets form the
+* columnar container - one aligned (and
+* optionally compressed) chunk per
+* realization, appended in place, with
+* the consolidated index (_meta) that
+* the Python readers map lazily.
+***********************************/
+
+#ifndef UI_H5_WRITER_H
+#define UI_H5_WRITER_H
+
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <complex>
+#include <variant>
+#include <filesystem>
+#include <condition_variable>
+#include <hdf5.h>
+#include "../quantities/profiler.h"
+
+namespace UI_H5
+{
+	constexpr hsize_t UI_H5_ALIGN			= 4096;											// alignment of the chunks (page of the memory map)
+	constexpr auto UI_H5_META				= "_meta";										// consolidated index of the container
+	constexpr auto UI_H5_FORMAT				= "qes-columnar";
+	constexpr auto UI_H5_REAL_AXIS			= "realization_axis";							// attribute - the dimension along the realizations
+	constexpr auto UI_H5_COLUMNS			= "columns";									// attribute - names of the packed scalars (separated by the newlines)
+	constexpr hsize_t UI_H5_META_CHUNK		= 4096;											// chunk of the index (resized in place)
+
+	/*
+	* @brief Dataset of the stage - the copy of the data (double or complex, column-major as in Armadillo)
+	*/
+	struct Dataset
+	{
+		std::string key_;																	// name of the dataset (with the groups)
+		std::variant<arma::Mat<double>, arma::Mat<std::complex<double>>> data_;				// data
+		bool extend_						= false;										// append along the realizations instead of replacing
+		int compress_						= 0;											// deflate level of the extendible dataset (0 - none, mapped directly)
+		int axis_							= -1;											// dimension along the realizations (-1 - not per realization)
+		std::vector<std::string> columns_;													// names of the packed scalars (the rows of the data)
+	};
+
+	/*
+	* @brief Datasets of a single file within the stage
+	*/
+	struct FileStage
+	{
+		bool truncate_						= false;										// shall the file be created anew?
+		bool columnar_						= false;										// contains the extendible datasets - the index is rebuilt
+		std::vector<Dataset> sets_;
+	};
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Compound type of the complex numbers as written by Armadillo ("real", "imag")
+	*/
+	inline hid_t complexType()
+	{
+		hid_t _t = H5Tcreate(H5T_COMPOUND, sizeof(std::complex<double>));
+		H5Tinsert(_t, "real", 0, H5T_NATIVE_DOUBLE);
+		H5Tinsert(_t, "imag", sizeof(double), H5T_NATIVE_DOUBLE);
+		return _t;
+	}
+
+	/*
+	* @brief Marks the dimension of the dataset along the realizations (the attribute read by the merge of the shards)
+	*/
+	inline void setRealAxis(hid_t _ds, int _axis)
+	{
+		if (_axis < 0)
+			return;
+		hid_t _sp			= H5Screate(H5S_SCALAR);
+		hid_t _at			= H5Acreate2(_ds, UI_H5_REAL_AXIS, H5T_NATIVE_INT, _sp, H5P_DEFAULT, H5P_DEFAULT);
+		if (_at >= 0)
+		{
+			H5Awrite(_at, H5T_NATIVE_INT, &_axis);
+			H5Aclose(_at);
+		}
+		H5Sclose(_sp);
+	}
+
+	/*
+	* @brief Stores the names of the packed scalars of the dataset (a single string, the names separated by the newlines)
+	*/
+	inline void setColumns(hid_t _ds, const std::vector<std::string>& _names)
+	{
+		if (_names.empty() || H5Aexists(_ds, UI_H5_COLUMNS) > 0)
+			return;
+		std::string _s;
+		for (size_t i = 0; i < _names.size(); ++i)
+			_s				+= (i ? "\n" : "") + _names[i];
+		hid_t _str			= H5Tcopy(H5T_C_S1);
+		H5Tset_size(_str, _s.size() + 1);
+		hid_t _sp			= H5Screate(H5S_SCALAR);
+		hid_t _at			= H5Acreate2(_ds, UI_H5_COLUMNS, _str, _sp, H5P_DEFAULT, H5P_DEFAULT);
+		if (_at >= 0)
+		{
+			H5Awrite(_at, _str, _s.c_str());
+			H5Aclose(_at);
+		}
+		H5Sclose(_sp);
+		H5Tclose(_str);
+	}
+
+	/*
+	* @brief Names of the packed scalars of the dataset (empty when it is not packed)
+	*/
+	inline auto columns(hid_t _ds) -> std::vector<std::string>
+	{
+		std::vector<std::string> _out;
+		if (H5Aexists(_ds, UI_H5_COLUMNS) <= 0)
+			return _out;
+		hid_t _at			= H5Aopen(_ds, UI_H5_COLUMNS, H5P_DEFAULT);
+		hid_t _type			= H5Aget_type(_at);
+		std::string _s(H5Tget_size(_type), '\0');
+		H5Aread(_at, _type, _s.data());
+		H5Tclose(_type);
+		H5Aclose(_at);
+		_s.resize(std::strlen(_s.c_str()));
+		for (size_t _b = 0, _e; _b <= _s.size(); _b = _e + 1)
+		{
+			_e				= std::min(_s.find('\n', _b), _s.size());
+			_out.push_back(_s.substr(_b, _e - _b));
+		}
+		return _out;
+	}
+
+	/*
+	* @brief Escapes the string for the JSON index (the quotes, the backslashes and the control characters)
+	*/
+	inline auto jsonEscape(const std::string& _s) -> std::string
+	{
+		std::string _out;
+		_out.reserve(_s.size() + 2);
+		for (const unsigned char _c : _s)
+		{
+			switch (_c)
+			{
+			case '"':	_out += "\\\"";	break;
+			case '\\':	_out += "\\\\";	break;
+			case '\n':	_out += "\\n";	break;
+			case '\t':	_out += "\\t";	break;
+			default:
+				if (_c < 0x20)
+				{
+					char _u[8];
+					std::snprintf(_u, sizeof(_u), "\\u%04x", _c);
+					_out	+= _u;
+				}
+				else
+					_out	+= (char)_c;
+			}
+		}
+		return _out;
+	}
+
+	/*
+	* @brief Dimension of the dataset along the realizations (-1 when it is not marked)
+	*/
+	inline int realAxis(hid_t _ds)
+	{
+		int _axis			= -1;
+		if (H5Aexists(_ds, UI_H5_REAL_AXIS) <= 0)
+			return _axis;
+		hid_t _at			= H5Aopen(_ds, UI_H5_REAL_AXIS, H5P_DEFAULT);
+		if (_at >= 0)
+		{
+			H5Aread(_at, H5T_NATIVE_INT, &_axis);
+			H5Aclose(_at);
+		}
+		return _axis;
+	}
+
+	/*
+	* @brief Writes the dataset into the opened file. The dimensions are stored as Armadillo does (n_cols, n_rows). The
+	* replaced dataset is unlinked first. The extendible one is chunked by the column (a single realization) and grows
+	* along the first dimension, the new columns are appended at its end. Its chunks are compressed only on request, the
+	* uncompressed ones are read by the memory map.
+	* @returns whether the write succeeded
+	*/
+	inline bool writeDataset(hid_t _file, const Dataset& _set)
+	{
+		return std::visit([&](const auto& _M) -> bool
+			{
+				using _T			= typename std::decay_t<decltype(_M)>::elem_type;
+				const bool _cpx		= !std::is_same_v<_T, double>;
+				hid_t _type			= _cpx ? complexType() : H5Tcopy(H5T_NATIVE_DOUBLE);
+				hid_t _lcpl			= H5Pcreate(H5P_LINK_CREATE);
+				H5Pset_create_intermediate_group(_lcpl, 1);
+				const bool _exists	= H5Lexists(_file, _set.key_.c_str(), H5P_DEFAULT) > 0;
+				herr_t _err			= 0;
+
+				if (!_set.extend_)
+				{
+					if (_exists)
+						H5Ldelete(_file, _set.key_.c_str(), H5P_DEFAULT);
+					hsize_t _dims[2]	= { _M.n_cols, _M.n_rows };
+					hid_t _space		= H5Screate_simple(2, _dims, nullptr);
+					hid_t _ds			= H5Dcreate2(_file, _set.key_.c_str(), _type, _space, _lcpl, H5P_DEFAULT, H5P_DEFAULT);
+					_err				= _ds < 0 ? -1 : H5Dwrite(_ds, _type, H5S_ALL, H5S_ALL, H5P_DEFAULT, _M.memptr());
+					if (_ds >= 0)
+					{
+						setRealAxis(_ds, _set.axis_);
+						setColumns(_ds, _set.columns_);
+						H5Dclose(_ds);
+					}
+					H5Sclose(_space);
+				}
+				else
+				{
+					hid_t _ds			= -1;
+					hsize_t _old[2]		= { 0, _M.n_rows };
+					if (_exists)
+					{
+						_ds				= H5Dopen2(_file, _set.key_.c_str(), H5P_DEFAULT);
+						hid_t _sp		= H5Dget_space(_ds);
+						H5Sget_simple_extent_dims(_sp, _old, nullptr);
+						H5Sclose(_sp);
+					}
+					else
+					{
+						hsize_t _dims[2]	= { 0, _M.n_rows };
+						hsize_t _max[2]		= { H5S_UNLIMITED, _M.n_rows };
+						hsize_t _chunk[2]	= { 1, std::max<hsize_t>(_M.n_rows, 1) };
+						hid_t _space		= H5Screate_simple(2, _dims, _max);
+						hid_t _dcpl			= H5Pcreate(H5P_DATASET_CREATE);
+						H5Pset_chunk(_dcpl, 2, _chunk);
+						if (_set.compress_ > 0)
+						{
+							H5Pset_shuffle(_dcpl);
+							H5Pset_deflate(_dcpl, (unsigned)std::min(_set.compress_, 9));
+						}
+						_ds					= H5Dcreate2(_file, _set.key_.c_str(), _type, _space, _lcpl, _dcpl, H5P_DEFAULT);
+						if (_ds >= 0)
+							setColumns(_ds, _set.columns_);
+						H5Pclose(_dcpl);
+						H5Sclose(_space);
+					}
+					if (_ds < 0 || _old[1] != _M.n_rows)
+						_err			= -1;
+					else
+					{
+						hsize_t _new[2]		= { _old[0] + _M.n_cols, _M.n_rows };
+						hsize_t _start[2]	= { _old[0], 0 };
+						hsize_t _count[2]	= { _M.n_cols, _M.n_rows };
+						H5Dset_extent(_ds, _new);
+						hid_t _fsp			= H5Dget_space(_ds);
+						H5Sselect_hyperslab(_fsp, H5S_SELECT_SET, _start, nullptr, _count, nullptr);
+						hid_t _msp			= H5Screate_simple(2, _count, nullptr);
+						_err				= H5Dwrite(_ds, _type, _msp, _fsp, H5P_DEFAULT, _M.memptr());
+						H5Sclose(_msp);
+						H5Sclose(_fsp);
+					}
+					if (_ds >= 0)
+						H5Dclose(_ds);
+				}
+				H5Pclose(_lcpl);
+				H5Tclose(_type);
+				return _err >= 0;
+			}, _set.data_);
+	}
+
+	/*
+	* @brief Rebuilds the consolidated index of the container - a JSON string with the shape, type, chunk and the compression of
+	* each dataset (and the names of the packed scalars). The readers take the layout from it without visiting the file. The index
+	* is a resizable 1D dataset of the bytes of the string, rewritten in place on each stage, so that no space of the file is lost.
+	*/
+	inline void writeIndex(hid_t _file)
+	{
+		std::vector<std::string> _names;
+		H5Ovisit(_file, H5_INDEX_NAME, H5_ITER_INC, [](hid_t, const char* _n, const H5O_info2_t* _i, void* _d) -> herr_t
+			{
+				if (_i->type == H5O_TYPE_DATASET && std::string(_n) != UI_H5_META)
+					static_cast<std::vector<std::string>*>(_d)->push_back(_n);
+				return 0;
+			}, &_names, H5O_INFO_BASIC);
+
+		std::string _json	= std::string("{\"format\":\"") + UI_H5_FORMAT + "\",\"version\":1,\"align\":" + std::to_string(UI_H5_ALIGN) + ",\"datasets\":{";
+		for (size_t i = 0; i < _names.size(); ++i)
+		{
+			hid_t _ds		= H5Dopen2(_file, _names[i].c_str(), H5P_DEFAULT);
+			hid_t _space	= H5Dget_space(_ds);
+			hid_t _type		= H5Dget_type(_ds);
+			hid_t _dcpl		= H5Dget_create_plist(_ds);
+			hsize_t _dims[2]= { 1, 1 }, _max[2] = { 1, 1 }, _chunk[2] = { 0, 0 };
+			const int _rank	= std::min(H5Sget_simple_extent_ndims(_space), 2);
+			H5Sget_simple_extent_dims(_space, _dims, _max);
+			const bool _ext	= H5Pget_layout(_dcpl) == H5D_CHUNKED;
+			if (_ext)
+				H5Pget_chunk(_dcpl, 2, _chunk);
+			const bool _cmp	= H5Pget_nfilters(_dcpl) > 0;
+
+			_json			+= (i ? ",\"" : "\"") + jsonEscape(_names[i]) + "\":{\"shape\":[";
+			for (int d = 0; d < _rank; ++d)
+				_json		+= (d ? "," : "") + std::to_string(_dims[d]);
+			_json			+= std::string("],\"dtype\":\"") + (H5Tget_class(_type) == H5T_COMPOUND ? "c16" : "f8") + "\"";
+			_json			+= std::string(",\"columnar\":") + (_ext ? "true" : "false");
+			if (_ext)
+				_json		+= ",\"chunk\":[" + std::to_string(_chunk[0]) + "," + std::to_string(_chunk[1]) + "]";
+			_json			+= std::string(",\"compression\":") + (_cmp ? "\"gzip\"" : "null");
+			if (const auto _cols = columns(_ds); !_cols.empty())
+			{
+				_json		+= ",\"columns\":[";
+				for (size_t c = 0; c < _cols.size(); ++c)
+					_json	+= (c ? ",\"" : "\"") + jsonEscape(_cols[c]) + "\"";
+				_json		+= "]";
+			}
+			_json			+= "}";
+
+			H5Pclose(_dcpl);
+			H5Tclose(_type);
+			H5Sclose(_space);
+			H5Dclose(_ds);
+		}
+		_json				+= "}}";
+
+		hsize_t _size		= _json.size();
+		hid_t _ds			= -1;
+		if (H5Lexists(_file, UI_H5_META, H5P_DEFAULT) > 0)
+		{
+			_ds				= H5Dopen2(_file, UI_H5_META, H5P_DEFAULT);
+			if (_ds >= 0 && H5Dset_extent(_ds, &_size) < 0)
+			{
+				// the index of the older files is the fixed size string - replaced by the resizable one once
+				H5Dclose(_ds);
+				H5Ldelete(_file, UI_H5_META, H5P_DEFAULT);
+				_ds			= -1;
+			}
+		}
+		if (_ds < 0)
+		{
+			hsize_t _max	= H5S_UNLIMITED;
+			hsize_t _chunk	= UI_H5_META_CHUNK;
+			hid_t _space	= H5Screate_simple(1, &_size, &_max);
+			hid_t _dcpl		= H5Pcreate(H5P_DATASET_CREATE);
+			H5Pset_chunk(_dcpl, 1, &_chunk);
+			_ds				= H5Dcreate2(_file, UI_H5_META, H5T_NATIVE_UCHAR, _space, H5P_DEFAULT, _dcpl, H5P_DEFAULT);
+			H5Pclose(_dcpl);
+			H5Sclose(_space);
+		}
+		if (_ds >= 0)
+		{
+			H5Dwrite(_ds, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, _json.data());
+			H5Dclose(_ds);
+		}
+	}
+
+	/*
+	* @brief Writes all the datasets of the file with a single open. The chunks of the containers are aligned to the pages.
+	*/
+	inline bool writeFile(const std::string& _path, const FileStage& _stage)
+	{
+		PROF_SCOPE(H5_WRITE);
+		H5E_auto2_t _func	= nullptr;
+		void* _data			= nullptr;
+		H5Eget_auto2(H5E_DEFAULT, &_func, &_data);
+		H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+		hid_t _fapl			= H5Pcreate(H5P_FILE_ACCESS);
+		if (_stage.columnar_)
+			H5Pset_alignment(_fapl, UI_H5_ALIGN, UI_H5_ALIGN);
+		hid_t _file			= -1;
+		if (!_stage.truncate_ && std::filesystem::exists(_path))
+			_file			= H5Fopen(_path.c_str(), H5F_ACC_RDWR, _fapl);
+		if (_file < 0)
+			_file			= H5Fcreate(_path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, _fapl);
+		H5Pclose(_fapl);
+
+		bool _ok			= _file >= 0;
+		if (_ok)
+		{
+			for (const auto& _set : _stage.sets_)
+				_ok			= writeDataset(_file, _set) && _ok;
+			if (_stage.columnar_)
+				writeIndex(_file);
+			H5Fclose(_file);
+		}
+		H5Eset_auto2(H5E_DEFAULT, _func, _data);
+		return _ok;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief The writer of the stages. The datasets are staged with the same arguments as saveAlgebraic, commit() passes the
+	* stage to the I/O thread and returns immediately. The commit waits only for the previous stage (double buffering), so that
+	* the HDF5 library is used by a single thread at a time and at most one stage is held in memory in addition to the current one.
+	* The files with the extension other than .h5 are written directly by saveAlgebraic.
+	*/
+	class Writer
+	{
+	protected:
+		std::map<std::string, FileStage> stage_;											// current stage (by the path of the file)
+		std::thread io_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::deque<std::map<std::string, FileStage>> jobs_;
+		bool busy_							= false;
+		bool stop_							= false;
+		size_t failures_					= 0;
+		int compress_						= 0;											// deflate level of the new extendible datasets
+
+		void loop()
+		{
+			std::unique_lock<std::mutex> _lock(this->mutex_);
+			while (true)
+			{
+				this->cv_.wait(_lock, [this]() { return this->stop_ || !this->jobs_.empty(); });
+				if (this->jobs_.empty())
+					return;
+				auto _job		= std::move(this->jobs_.front());
+				this->jobs_.pop_front();
+				this->busy_		= true;
+				_lock.unlock();
+				size_t _failed	= 0;
+				for (const auto& [_path, _file] : _job)
+					if (!writeFile(_path, _file))
+						++_failed;
+				_lock.lock();
+				this->failures_	+= _failed;
+				this->busy_		= false;
+				this->cv_.notify_all();
+			}
+		}
+
+	public:
+		Writer()															= default;
+		Writer(const Writer&)												= delete;
+		Writer& operator=(const Writer&)									= delete;
+		~Writer()
+		{
+			this->flush();
+			{
+				std::lock_guard<std::mutex> _lock(this->mutex_);
+				this->stop_		= true;
+			}
+			this->cv_.notify_all();
+			if (this->io_.joinable())
+				this->io_.join();
+		}
+
+		auto failures()														-> size_t					{ std::lock_guard<std::mutex> _lock(this->mutex_); return this->failures_; };
+		auto setCompression(int _level)										-> void						{ this->compress_ = _level; };
+
+		/*
+		* @brief Stages the dataset (copies the data)
+		* @param _dir directory
+		* @param _file name of the file (with the extension)
+		* @param _M data (any Armadillo object convertible to the matrix)
+		* @param _key name of the dataset
+		* @param _append false - the file is created anew (as in saveAlgebraic)
+		* @param _extend append the columns (realizations) to the extendible dataset instead of replacing it - the file becomes
+		* the columnar container (see writeIndex)
+		*/
+		template <typename _MT>
+		void save(const std::string& _dir, const std::string& _file, const _MT& _M, const std::string& _key, bool _append, bool _extend = false)
+		{
+			using _T			= typename _MT::elem_type;
+			if (!_file.ends_with(".h5"))
+			{
+				saveAlgebraic(_dir, _file, _M, _key, _append);
+				return;
+			}
+			auto& _stage		= this->stage_[_dir + _file];
+			if (!_append)
+			{
+				_stage.truncate_	= true;
+				_stage.sets_.clear();
+			}
+			Dataset _set;
+			_set.key_			= _key;
+			_set.extend_		= _extend;
+			_set.compress_		= _extend ? this->compress_ : 0;
+			_stage.columnar_	= _stage.columnar_ || _extend;
+			if constexpr (std::is_same_v<_T, std::complex<double>>)
+				_set.data_		= arma::Mat<std::complex<double>>(_M);
+			else if constexpr (std::is_same_v<_T, double>)
+				_set.data_		= arma::Mat<double>(_M);
+			else
+				_set.data_		= arma::conv_to<arma::Mat<double>>::from(arma::Mat<_T>(_M));
+			_stage.sets_.push_back(std::move(_set));
+		}
+
+		/*
+		* @brief Stages the scalars of the realizations packed into a single extendible dataset - the rows of _M are the scalars
+		* (named by _columns), the columns are the realizations, so that each realization is a single chunk of all of them
+		*/
+		void savePacked(const std::string& _dir, const std::string& _file, const arma::Mat<double>& _M, const std::string& _key, const std::vector<std::string>& _columns)
+		{
+			this->save(_dir, _file, _M, _key, true, true);
+			this->stage_[_dir + _file].sets_.back().columns_ = _columns;
+		}
+
+		/*
+		* @brief Stages the dataset of the outputs per realization - the realizations are the columns of the matrix (the elements of
+		* the column vector). The dimension is marked in the file, so that the shards are merged along it (see UI_REAL::Scheduler).
+		*/
+		template <typename _MT>
+		void saveReal(const std::string& _dir, const std::string& _file, const _MT& _M, const std::string& _key, bool _append)
+		{
+			this->save(_dir, _file, _M, _key, _append);
+			auto _it			= this->stage_.find(_dir + _file);
+			if (_it != this->stage_.end() && !_it->second.sets_.empty())
+				_it->second.sets_.back().axis_ = _M.n_cols == 1 ? 1 : 0;
+		}
+
+		/*
+		* @brief Passes the stage to the I/O thread (waits for the previous stage only)
+		*/
+		void commit()
+		{
+			if (this->stage_.empty())
+				return;
+			{
+				std::unique_lock<std::mutex> _lock(this->mutex_);
+				this->cv_.wait(_lock, [this]() { return this->jobs_.empty() && !this->busy_; });
+				if (!this->io_.joinable())
+					this->io_	= std::thread([this]() { this->loop(); });
+				this->jobs_.push_back(std::move(this->stage_));
+			}
+			this->stage_.clear();
+			this->cv_.notify_all();
+		}
+
+		/*
+		* @brief Commits the stage and waits until everything is written
+		*/
+		void flush()
+		{
+			this->commit();
+			std::unique_lock<std::mutex> _lock(this->mutex_);
+			this->cv_.wait(_lock, [this]() { return this->jobs_.empty() && !this->busy_; });
+		}
+	};
+};
+
+#endif // !UI_H5_WRITER_H
@@ -0,0 +1,345 @@
+#pragma once
+/***********************************
+* Defines the scheduler of the random
+* realizations of the UI simulations.
+* The realizations of a parameter point
+* are split into the shards, which are
+* claimed by the processes (job arrays,
+* MPI ranks) with the exclusive claim
+* files. Each shard is written to its
+* own set of files and marked complete,
+* so that a restarted job skips the
+* completed shards. The last process
+* merges the shards into the files of a
+* single run.
+***********************************/
+
+#ifndef UI_REALIZATIONS_H
+#define UI_REALIZATIONS_H
+
+#include <string>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <filesystem>
+#include <hdf5.h>
+#include "ui_h5_writer.h"
+
+namespace UI_REAL
+{
+	constexpr const char* UI_REAL_DIR		= "shards";										// subdirectory of the claims and the markers
+	constexpr const char* UI_REAL_SFX		= "_shard_";									// suffix of the files of a shard
+
+	/*
+	* @brief Range of the realizations [begin_, end_) of the shard id_
+	*/
+	struct Shard
+	{
+		uint id_							= 0;
+		uint begin_							= 0;
+		uint end_							= 0;
+	};
+
+	/*
+	* @brief Index of the process within the job array (SLURM, PBS) or 0 - only rotates the first shard tried
+	*/
+	inline auto workerIndex() -> uint
+	{
+		for (const char* _v : { "SLURM_ARRAY_TASK_ID", "PBS_ARRAYID", "SGE_TASK_ID", "OMPI_COMM_WORLD_RANK", "PMI_RANK" })
+			if (const char* _s = std::getenv(_v); _s != nullptr && *_s != '\0')
+				return (uint)std::strtoul(_s, nullptr, 10);
+		return 0;
+	}
+
+	// ##########################################################################################################################################
+
+	/*
+	* @brief Scheduler of the realizations. Without the shards (size 0) it goes through all the realizations as the plain loop.
+	* With the shards, the processes claim the shards by creating the claim file exclusively (a claim older than the lease
+	* belongs to a killed job and is taken over), the claim is refreshed with each realization and replaced by the complete
+	* marker once the files of the shard are written.
+	*
+	*	for (int _r = _real.start(_sfx); _r >= 0; _r = _real.next(_r, _sfx, _onShard))
+	*/
+	class Scheduler
+	{
+	protected:
+		std::string dir_;
+		std::string tag_;															// identifies the parameter point (the random string of the files)
+		uint nReal_							= 0;
+		uint size_							= 0;									// realizations of a shard (0 - no sharding)
+		uint lease_							= 0;									// seconds after which a claim is stale
+		uint worker_						= 0;
+		Shard cur_;
+		bool active_						= false;
+
+		auto path(const std::string& _name)	const -> std::string					{ return this->dir_ + UI_REAL_DIR + kPS + this->tag_ + _name;		};
+		auto claimPath(uint _k)				const -> std::string					{ return this->path("_" + std::to_string(_k) + ".claim");				};
+		auto donePath(uint _k)				const -> std::string					{ return this->path("_" + std::to_string(_k) + ".done");				};
+
+		/*
+		* @brief Creates the file exclusively (O_EXCL) with the index of the worker
+		*/
+		bool createFile(const std::string& _path) const
+		{
+			std::FILE* _f = std::fopen(_path.c_str(), "wx");
+			if (_f == nullptr)
+				return false;
+			std::fprintf(_f, "%u\n", this->worker_);
+			std::fclose(_f);
+			return true;
+		}
+
+		/*
+		* @brief Is the file older than the lease (false when it does not exist)?
+		*/
+		bool isStale(const std::string& _path) const
+		{
+			std::error_code _ec;
+			const auto _t	= std::filesystem::last_write_time(_path, _ec);
+			return !_ec && std::filesystem::file_time_type::clock::now() - _t >= std::chrono::seconds(this->lease_);
+		}
+
+		/*
+		* @brief Creates the claim file exclusively. The stale claim is taken over under the exclusive takeover lock, so that only
+		* a single process removes and recreates it (the lock left by a job killed within the takeover expires with the lease).
+		*/
+		bool claimFile(const std::string& _path) const
+		{
+			if (this->createFile(_path))
+				return true;
+			if (!this->isStale(_path))
+				return false;
+
+			std::error_code _ec;
+			const std::string _lock = _path + ".takeover";
+			if (this->isStale(_lock))
+				std::filesystem::remove(_lock, _ec);
+			if (!this->createFile(_lock))
+				return false;
+			bool _ok		= false;
+			if (this->isStale(_path))
+			{
+				std::filesystem::remove(_path, _ec);
+				_ok			= this->createFile(_path);
+			}
+			std::filesystem::remove(_lock, _ec);
+			return _ok;
+		}
+
+		/*
+		* @brief Claims the next shard that is neither complete nor claimed (starting from the shard of the worker)
+		*/
+		bool claim()
+		{
+			const uint _n = this->shards();
+			for (uint i = 0; i < _n; ++i)
+			{
+				const uint _k = (this->worker_ + i) % _n;
+				if (this->isDone(_k) || !this->claimFile(this->claimPath(_k)))
+					continue;
+				this->cur_		= { _k, _k * this->size_, std::min((_k + 1) * this->size_, this->nReal_) };
+				this->active_	= true;
+				return true;
+			}
+			this->active_		= false;
+			return false;
+		}
+
+	public:
+		Scheduler(const std::string& _dir, const std::string& _tag, uint _nReal, uint _size, uint _lease)
+			: dir_(_dir), tag_(_tag), nReal_(_nReal), size_(_size >= _nReal ? 0 : _size), lease_(_lease), worker_(workerIndex())
+		{
+			if (this->size_ != 0)
+				std::filesystem::create_directories(this->dir_ + UI_REAL_DIR);
+		};
+
+		// --------------------- G E T T E R S ---------------------
+		auto sharded()						const -> bool							{ return this->size_ != 0;												};
+		auto shards()						const -> uint							{ return this->size_ == 0 ? 1 : (this->nReal_ + this->size_ - 1) / this->size_;	};
+		auto begin()						const -> uint							{ return this->sharded() ? this->cur_.begin_ : 0;						};	// first realization of the current shard
+		auto current()						const -> const Shard&					{ return this->cur_;													};
+		auto isDone(uint _k)				const -> bool							{ return std::filesystem::exists(this->donePath(_k));					};
+		auto suffix(uint _k)				const -> std::string					{ char _b[16]; std::snprintf(_b, sizeof(_b), "%s%04u", UI_REAL_SFX, _k); return _b;	};
+		auto allDone()						const -> bool
+		{
+			for (uint k = 0; k < this->shards(); ++k)
+				if (!this->isDone(k))
+					return false;
+			return true;
+		}
+
+		/*
+		* @brief First realization to compute (-1 when there is nothing left)
+		* @param _sfx suffix of the files of the claimed shard (empty without the shards)
+		*/
+		auto start(std::string& _sfx) -> int
+		{
+			_sfx				= "";
+			if (!this->sharded())
+				return this->nReal_ > 0 ? 0 : -1;
+			if (!this->claim())
+				return -1;
+			_sfx				= this->suffix(this->cur_.id_);
+			return (int)this->cur_.begin_;
+		}
+
+		/*
+		* @brief Next realization after _r. When the shard is finished, _onShard(end) writes its files, the shard is marked
+		* complete and the next one is claimed.
+		*/
+		auto next(int _r, std::string& _sfx, const std::function<void(uint)>& _onShard) -> int
+		{
+			if (!this->sharded())
+				return (uint)(_r + 1) < this->nReal_ ? _r + 1 : -1;
+
+			std::error_code _ec;
+			if ((uint)(_r + 1) < this->cur_.end_)
+			{
+				std::filesystem::last_write_time(this->claimPath(this->cur_.id_), std::filesystem::file_time_type::clock::now(), _ec);
+				return _r + 1;
+			}
+			_onShard(this->cur_.end_);
+			std::FILE* _f		= std::fopen(this->donePath(this->cur_.id_).c_str(), "w");
+			if (_f != nullptr)
+				std::fclose(_f);
+			std::filesystem::remove(this->claimPath(this->cur_.id_), _ec);
+			LOGINFO("Completed the shard " + STR(this->cur_.id_) + " [" + STR(this->cur_.begin_) + ", " + STR(this->cur_.end_) + ")", LOG_TYPES::TRACE, 1);
+
+			if (!this->claim())
+				return -1;
+			_sfx				= this->suffix(this->cur_.id_);
+			return (int)this->cur_.begin_;
+		}
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Merges the files of the shards once all of them are complete (a single process does it - the merge is claimed
+		* as well). The datasets along the realizations (marked by the writer) take the realizations of each shard from its own file, the remaining
+		* datasets (bins, histograms) are copied as shards/<k>/<name> of the merged file.
+		* @param _bases names of the files without the extension (e.g. "stat" + randomStr)
+		* @returns whether the merge was made by this process
+		*/
+		bool merge(const std::vector<std::string>& _bases, const std::string& _ext = ".h5")
+		{
+			if (!this->sharded() || !this->allDone() || std::filesystem::exists(this->path(".merged")) || !this->claimFile(this->path(".merge")))
+				return false;
+
+			for (const auto& _base : _bases)
+				this->mergeFile(_base, _ext);
+			std::FILE* _f		= std::fopen(this->path(".merged").c_str(), "w");
+			if (_f != nullptr)
+				std::fclose(_f);
+			std::error_code _ec;
+			std::filesystem::remove(this->path(".merge"), _ec);
+			LOGINFO("Merged " + STR(this->shards()) + " shards of " + this->tag_, LOG_TYPES::TRACE, 1);
+			return true;
+		}
+
+	protected:
+		/*
+		* @brief Merges the shard files of a single output
+		*/
+		void mergeFile(const std::string& _base, const std::string& _ext) const
+		{
+			const std::string _first	= this->dir_ + _base + this->suffix(0) + _ext;
+			if (!std::filesystem::exists(_first))
+				return;
+
+			H5E_auto2_t _func	= nullptr;
+			void* _data			= nullptr;
+			H5Eget_auto2(H5E_DEFAULT, &_func, &_data);
+			H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+
+			std::vector<hid_t> _in(this->shards(), -1);
+			for (uint k = 0; k < this->shards(); ++k)
+				_in[k]			= H5Fopen((this->dir_ + _base + this->suffix(k) + _ext).c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+			hid_t _out			= H5Fcreate((this->dir_ + _base + _ext).c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+			// names of the datasets of the first shard
+			std::vector<std::string> _names;
+			H5Ovisit(_in[0], H5_INDEX_NAME, H5_ITER_NATIVE, [](hid_t, const char* _n, const H5O_info2_t* _i, void* _d) -> herr_t
+				{
+					if (_i->type == H5O_TYPE_DATASET)
+						static_cast<std::vector<std::string>*>(_d)->push_back(_n);
+					return 0;
+				}, &_names, H5O_INFO_BASIC);
+
+			hid_t _lcpl			= H5Pcreate(H5P_LINK_CREATE);
+			H5Pset_create_intermediate_group(_lcpl, 1);
+			for (const auto& _name : _names)
+			{
+				hid_t _ds		= H5Dopen2(_in[0], _name.c_str(), H5P_DEFAULT);
+				hid_t _type		= H5Dget_type(_ds);
+				hid_t _space	= H5Dget_space(_ds);
+				hsize_t _dims[2]= { 1, 1 };
+				const int _rank	= H5Sget_simple_extent_ndims(_space);
+				H5Sget_simple_extent_dims(_space, _dims, nullptr);
+				H5Sclose(_space);
+
+				// the dimension along the realizations is stored with the dataset (see UI_H5::Writer::saveReal)
+				int _axis		= UI_H5::realAxis(_ds);
+				if (_rank != 2 || _axis < 0 || _axis > 1 || _dims[_axis] != this->nReal_)
+					_axis		= -1;
+				H5Dclose(_ds);
+
+				if (_axis < 0)
+				{
+					for (uint k = 0; k < this->shards(); ++k)
+						if (_in[k] >= 0)
+							H5Ocopy(_in[k], _name.c_str(), _out, (std::string(UI_REAL_DIR) + "/" + STR(k) + "/" + _name).c_str(), H5P_DEFAULT, _lcpl);
+					H5Tclose(_type);
+					continue;
+				}
+
+				hid_t _full		= H5Screate_simple(2, _dims, nullptr);
+				hid_t _dout		= H5Dcreate2(_out, _name.c_str(), _type, _full, _lcpl, H5P_DEFAULT, H5P_DEFAULT);
+				if (_dout >= 0)
+					UI_H5::setRealAxis(_dout, _axis);
+				std::vector<char> _buf;
+				for (uint k = 0; k < this->shards() && _dout >= 0; ++k)
+				{
+					if (_in[k] < 0)
+						continue;
+					const hsize_t _b	= k * this->size_;
+					const hsize_t _e	= std::min<hsize_t>((k + 1) * this->size_, this->nReal_);
+					hsize_t _start[2]	= { 0, 0 };
+					hsize_t _count[2]	= { _dims[0], _dims[1] };
+					_start[_axis]		= _b;
+					_count[_axis]		= _e - _b;
+					_buf.resize(H5Tget_size(_type) * _count[0] * _count[1]);
+
+					hid_t _din			= H5Dopen2(_in[k], _name.c_str(), H5P_DEFAULT);
+					hid_t _fin			= H5Dget_space(_din);
+					hid_t _mem			= H5Screate_simple(2, _count, nullptr);
+					H5Sselect_hyperslab(_fin, H5S_SELECT_SET, _start, nullptr, _count, nullptr);
+					H5Dread(_din, _type, _mem, _fin, H5P_DEFAULT, _buf.data());
+					hid_t _fout			= H5Dget_space(_dout);
+					H5Sselect_hyperslab(_fout, H5S_SELECT_SET, _start, nullptr, _count, nullptr);
+					H5Dwrite(_dout, _type, _mem, _fout, H5P_DEFAULT, _buf.data());
+					H5Sclose(_fout);
+					H5Sclose(_mem);
+					H5Sclose(_fin);
+					H5Dclose(_din);
+				}
+				if (_dout >= 0)
+					H5Dclose(_dout);
+				H5Sclose(_full);
+				H5Tclose(_type);
+			}
+			H5Pclose(_lcpl);
+
+			if (_out >= 0)
+				H5Fclose(_out);
+			for (auto _f : _in)
+				if (_f >= 0)
+					H5Fclose(_f);
+			H5Eset_auto2(H5E_DEFAULT, _func, _data);
+		}
+	};
+};
+
+#endif // !UI_REALIZATIONS_H
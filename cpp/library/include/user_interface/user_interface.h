@@ -25,6 +25,7 @@
 #ifndef RBM_H											 // #
 #	include "../NQS/rbm_final.hpp"						 // #
 #endif													 // #
+#include "../NQS/nqs_pair.hpp"						 // #
 // ##########################################################
 
 
@@ -83,6 +84,11 @@
 // ##################### STATISTICAL ########################
 #if 1													 // #
 #include "../algebra/quantities/measure.h"				 // #
+#include "../algebra/quantities/typicality.h"			 // #
+#include "../quantities/accumulators.h"					 // #
+#include "../quantities/kpm.h"							 // #
+#include "ui_h5_writer.h"							 // #
+#include "ui_realizations.h"						 // #
 #endif													 // #
 // ##########################################################
 
@@ -98,6 +104,19 @@ constexpr int UI_LIMITS_NQS_LANCZOS_STATENUM					= 100;
 constexpr int UI_LIMITS_QUADRATIC_COMBINATIONS					= 20;
 constexpr int UI_LIMITS_QUADRATIC_STATEFULL						= 32;
 
+// --- TIME EVOLUTION
+constexpr u64 UI_LIMITS_TIME_EVO_BLOCK							= 256;				// maximal number of times evolved together
+constexpr u64 UI_LIMITS_TIME_EVO_MEM							= ULLPOW(30);		// memory of the block of evolved states [bytes]
+constexpr u64 UI_LIMITS_TIME_EVO_EIG_MEM						= ULLPOW(32);		// memory of the operators kept in the eigenbasis [bytes]
+constexpr double UI_LIMITS_TIME_EVO_PROP_TMAX					= 1e3;				// maximal time reached with the Chebyshev propagator
+
+// --- ETH
+constexpr u64 UI_LIMITS_ETH_TILE								= 128;				// side of the tile of the matrix elements processed together (cache block)
+
+// --- SYMMETRY SECTORS
+constexpr u64 UI_LIMITS_SECTOR_NH_THREAD						= 0x200;			// Hilbert space dimension per thread of the single sector
+constexpr double UI_LIMITS_SECTOR_DEG_TOL						= 1e-9;				// energies closer than that are counted as degenerate
+
 // ##########################################################
 
 #define UI_CHECK_SYM(val, gen)									if(this->val##_ != -INT_MAX) syms.push_back(std::make_pair(Operators::SymGenerators::gen, this->val##_));
@@ -130,11 +149,27 @@ namespace UI_PARAMS
 		UI_PARAM_CREATE_DEFAULT(eth_susc, bool, true);
 		UI_PARAM_CREATE_DEFAULT(eth_ipr, bool, true);
 		UI_PARAM_CREATE_DEFAULT(eth_offd, bool, false);
+		UI_PARAM_CREATE_DEFAULT(eth_prop, bool, false);		// time evolution with the Chebyshev propagator (no diagonalization)
+		UI_PARAM_CREATE_DEFAULT(eth_shard, uint, 0);		// realizations of a shard claimed by a process (0 - all the realizations in one run)
+		UI_PARAM_CREATE_DEFAULT(eth_lease, uint, 21600);	// seconds after which the claim of an unfinished shard is taken over
+		UI_PARAM_CREATE_DEFAULT(eth_mid, uint, 0);			// eigenpairs around the infinite temperature energy of the ETH statistics (0 - full diagonalization)
+		UI_PARAM_CREATE_DEFAULT(eth_dist, bool, false);	// full diagonalization and eigenvectors distributed over the ranks (HAMIL_USE_SCALAPACK)
+		UI_PARAM_CREATE_DEFAULT(eth_col, bool, false);		// per realization outputs appended to the columnar container (eth*.h5) instead of the rewritten files
+		UI_PARAM_CREATE_DEFAULT(eth_comp, int, 0);			// deflate level of the container chunks (0 - none, the chunks are memory mapped by the readers)
 		UI_PARAM_CREATE_DEFAULTV(eth_end, double);
 
+		// thermal (typicality)
+		UI_PARAM_CREATE_DEFAULT(th_R, uint, 32);			// random vectors of the thermal typicality
+		UI_PARAM_CREATE_DEFAULTD(th_bmax, double, 10.0);	// largest inverse temperature
+		UI_PARAM_CREATE_DEFAULT(th_nbeta, uint, 101);		// points of the grid of beta
+		UI_PARAM_CREATE_DEFAULT(th_lazy, bool, false);		// operator averages of the typicality without their matrices (see Measurement::setLazy)
+
 		UI_PARAM_CREATE_DEFAULTD(modMidStates, double, 1.0);// states in the middle of the spectrum
 		UI_PARAM_CREATE_DEFAULTD(modEnDiff, double, 1.0);	// tolerance for the energy difference of the states in offdiagonal
 		std::vector<std::string> operators;					// operators to be calculated for the model
+		// directory for the out-of-core eigenvectors (empty - kept in memory)
+		inline static const std::string _estream	= "";
+		std::string estream_						= "";
 
 		// ##########################################################################
 		
@@ -256,6 +291,7 @@ namespace UI_PARAMS
 		UI_PARAM_CREATE_DEFAULT(q_realizationNum, uint, 100);		// number of realizations for the average
 		UI_PARAM_CREATE_DEFAULT(q_shuffle, bool, true);				// shuffle the states?
 		UI_PARAM_CREATE_DEFAULTD(q_broad, double, 0.1);				// broadening for spectral function
+		UI_PARAM_CREATE_DEFAULT(q_kpm, uint, 0);					// Chebyshev moments of the KPM spectral functions (0 - exact from the diagonalization)
 
 		// ########### AUBRY_ANDRE ############
 		
@@ -275,6 +311,7 @@ namespace UI_PARAMS
 			// UI_PARAM_CREATE_DEFAULTD(plrb_a, double, 1.0);
 			UI_PARAM_CREATE_DEFAULTD(plrb_b, double, 1.0);
 			UI_PARAM_CREATE_DEFAULTD(plrb_mb, bool, false);
+			UI_PARAM_CREATE_DEFAULTD(plrb_cut, double, 0.0);		// band cut of the envelope (0 - full matrix)
 
 		} power_law_random_bandwidth;
 
@@ -289,6 +326,7 @@ namespace UI_PARAMS
 		void setDefault() 
 		{
 			UI_PARAM_SET_DEFAULT(modTyp);
+			UI_PARAM_SET_DEFAULT(estream);
 
 			// -------------------------------------
 			// default operators
@@ -407,6 +445,9 @@ namespace UI_PARAMS
 		UI_PARAM_CREATE_DEFAULT(pz, int, -INT_MAX);
 		UI_PARAM_CREATE_DEFAULT(x, int, -INT_MAX);
 		UI_PARAM_CREATE_DEFAULT(U1, int, -INT_MAX);
+		// directory for caching the mappings of the sectors
+		inline static const std::string _hcache	= "";
+		std::string hcache_							= "";
 
 		void setDefault() {
 			UI_PARAM_SET_DEFAULT(S);
@@ -416,6 +457,7 @@ namespace UI_PARAMS
 			UI_PARAM_SET_DEFAULT(pz);
 			UI_PARAM_SET_DEFAULT(x);
 			UI_PARAM_SET_DEFAULT(U1);
+			UI_PARAM_SET_DEFAULT(hcache);
 		}
 
 
@@ -460,6 +502,8 @@ namespace UI_PARAMS
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_th, uint, 50);		// thermalize when training
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_mc, uint, 500);		// number of inner blocks for training - this is rather crucial - is Monte Carlo steps
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_epo, uint, 1000);	// number of samples - outer loop for training
+		UI_PARAM_CREATE_DEFAULT(nqs_ch, uint, 1);			// number of Markov chains sampled together (each gives a single sample of the block)
+		UI_PARAM_CREATE_DEFAULT(nqs_prop, int, 0);			// proposal kernel - 0 - flips, 1 - nearest neighbour exchange, 2 - pair exchange, 3 - cluster
 		// regularization
 		UI_PARAM_CREATE_DEFAULTD(nqs_tr_reg, double, 1e-7); // regularization for the NQS SR method
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_regs, int, 0);		// regularization for the NQS SR method - scheduler
@@ -469,6 +513,12 @@ namespace UI_PARAMS
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_prec, int, 0);		// preconditioner for the NQS SR method - 0 - identity, 1 - Jacobi, 2 - Incomplete Cholesky, 3 - SSOR
 		// solver type
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_sol, int, 1);		// solver for the NQS SR method
+		UI_PARAM_CREATE_DEFAULT(nqs_sr, int, 0);			// matrix-free SR - 0 - solver, 1 - lazy CG, 2 - MinSR, 3 - automatic
+		UI_PARAM_CREATE_DEFAULT(nqs_sr_sp, bool, false);	// matrix-free SR - store the derivatives in the single precision
+		UI_PARAM_CREATE_DEFAULT(nqs_mpi, bool, false);		// distribute the training over the MPI ranks (NQS_USE_MPI)
+		UI_PARAM_CREATE_DEFAULT(nqs_gpu, bool, false);		// chains and SR on the device (NQS_USE_GPU)
+		UI_PARAM_CREATE_DEFAULT(nqs_ck_async, bool, false);	// write the training checkpoints in the background
+		UI_PARAM_CREATE_DEFAULT(nqs_resume, bool, false);	// resume the training from the last checkpoint
 		UI_PARAM_CREATE_DEFAULTD(nqs_tr_tol, double, 1e-7); // solver for the NQS SR method - tolerance
 		UI_PARAM_CREATE_DEFAULT(nqs_tr_iter, int, 5000);	// solver for the NQS SR method - maximum number of iterations
 		// for collecting - excited states
@@ -482,6 +532,8 @@ namespace UI_PARAMS
 		UI_PARAM_CREATE_DEFAULT(nqs_col_th, uint, 0);		// thermalize when collecting
 		UI_PARAM_CREATE_DEFAULT(nqs_col_bn, uint, 100);		// number of inner blocks for collecting
 		UI_PARAM_CREATE_DEFAULT(nqs_col_bs, uint, 4);		// block size for collecting
+		UI_PARAM_CREATE_DEFAULT(nqs_col_reuse, uint, 0);	// collect with the samples of the last training iterations (0 - new sampling)
+		UI_PARAM_CREATE_DEFAULT(nqs_corr, bool, false);	// measure the sigma_z sigma_z and sigma_x sigma_x correlation matrices as the Pauli strings
 		// learning rate
 		UI_PARAM_CREATE_DEFAULT(nqs_sch, int, 0);			// learning rate scheduler - 0 - constant, 1 - exponential decay (default), 2 - step decay, 3 - cosine decay, 4 - adaptive
 		UI_PARAM_CREATE_DEFAULTD(nqs_lr, double, 1e-3);		// learning rate (initial)
@@ -506,6 +558,14 @@ namespace UI_PARAMS
 			UI_PARAM_SET_DEFAULT(nqs_tr_mc);
 			UI_PARAM_SET_DEFAULT(nqs_tr_bs);
 			UI_PARAM_SET_DEFAULT(nqs_tr_th);
+			UI_PARAM_SET_DEFAULT(nqs_ch);
+			UI_PARAM_SET_DEFAULT(nqs_prop);
+			UI_PARAM_SET_DEFAULT(nqs_sr);
+			UI_PARAM_SET_DEFAULT(nqs_sr_sp);
+			UI_PARAM_SET_DEFAULT(nqs_mpi);
+			UI_PARAM_SET_DEFAULT(nqs_gpu);
+			UI_PARAM_SET_DEFAULT(nqs_ck_async);
+			UI_PARAM_SET_DEFAULT(nqs_resume);
 			UI_PARAM_SET_DEFAULT(nqs_lr);
 			UI_PARAM_SET_DEFAULT(loadNQS);
 			// collection
@@ -513,6 +573,7 @@ namespace UI_PARAMS
 			UI_PARAM_SET_DEFAULT(nqs_col_th);
 			UI_PARAM_SET_DEFAULT(nqs_col_bn);
 			UI_PARAM_SET_DEFAULT(nqs_col_bs);
+			UI_PARAM_SET_DEFAULT(nqs_col_reuse);
 		}
 	};
 };
@@ -548,6 +609,7 @@ protected:
 	// ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^^
 	bool isComplex_		= false;						// checks the complex sector
 	bool useComplex_	= false;						// forces complex sector choice
+	bool pinThreads_	= false;						// pins the shared workers to the cores (NUMA aware)
 
 	// ^^^^^^^^^ FOR DOUBLE ^^^^^^^^^					
 	Hilbert::HilbertSpace<double>						hilDouble;
@@ -590,6 +652,21 @@ private:
 	void symmetriesTest();
 	std::pair<v_1d<GlobalSyms::GlobalSym>, v_1d<std::pair<Operators::SymGenerators, int>>> createSymmetries();
 
+	// sweep over the independent sectors - each of them is a separate task with its own number of threads
+	struct SymSector
+	{
+		SymP sym;																		// symmetry parameters of the sector
+		u64 Nh								= 0;										// Hilbert space dimension
+		u64 states							= 0;										// number of the eigenvalues it contributes
+		uint threads						= 1;										// threads of the task
+		std::shared_ptr<Hamiltonian<double>> hamD;
+		std::shared_ptr<Hamiltonian<cpx>> hamC;
+	};
+	v_1d<SymSector> symmetriesSectors();
+	void symmetriesSweep(v_1d<SymSector>& _sectors, bool _states = false);
+	template<typename _T>
+	arma::vec symmetriesSector(std::shared_ptr<Hamiltonian<_T>> _H, uint _threads, bool _states);
+
 	// ####################### N Q S #######################
 
 	template<typename _T, uint _spinModes>
@@ -611,7 +688,7 @@ private:
 	std::pair<v_1d<std::shared_ptr<Operators::Operator<double>>>, strVec>
 		ui_eth_getoperators(const size_t _Nh, bool _isquadratic = true, bool _ismanybody = true);
 	template<typename _T>
-	void ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r = 0, uint _spinChanged = 0);
+	void ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r = 0, uint _spinChanged = 0, bool _diagonalize = true, uint _mid = 0);
 	template<typename _T>
 	void checkETH(std::shared_ptr<Hamiltonian<_T>> _H);
 	
@@ -619,22 +696,25 @@ private:
 	void checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H);
 
 	template<typename _T>
-	std::array<double, 6> checkETH_statistics_mat_elems(
+	Accumulators::ElementMoments checkETH_statistics_mat_elems(
 		u64 _start, u64 _end,
 		std::atomic<size_t>& _statiter,
 		int _th,
 		u64 _Nh,
 		Hamiltonian<_T>* _H,
 		const arma::Mat<_T>& _overlaps,
-		HistogramAverage<double>& _histAv,
-		HistogramAverage<double>& _histAvTypical,
+		Accumulators::LogHistogram& _histAv,
+		Accumulators::LogHistogram& _histAvTypical,
 		arma::Mat<double>* _offdiagElemsOmega,
 		arma::Mat<double>* _offdiagElemsOmegaLow,
 		VMAT<_T>* _offdiagElems,
 		VMAT<_T>* _offdiagElemsLow,
 		VMAT<double>* _offdiagElemesStat,
+		arma::Col<double>* _fidelity,
+		arma::Col<double>* _fidelityZ,
 		const double _bandwidth = 2.0,
 		const double _energyAt	= 0.0,
+		const double _fidMu		= 0.0,
 		int _opi 				= 0,
 		int _r 					= 0
 	);
@@ -642,6 +722,9 @@ private:
 	template<typename _T>
 	void checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H);
 
+	template<typename _T>
+	void checkThermalTypicality(std::shared_ptr<Hamiltonian<_T>> _H);
+
 	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% D E F I N I T I O N S %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 	bool defineLattice();
 	bool defineLattice(std::shared_ptr<Lattice>& _lat, LatticeTypes _typ = LatticeTypes::SQ);
@@ -665,6 +748,11 @@ private:
 	template<typename _T, uint _spinModes = 2>
 	void defineNQS(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_ptr<NQS<_spinModes, _T>>& _NQS, 
 		const v_1d<std::shared_ptr<NQS<_spinModes, _T>>>& _NQSl = {}, const v_1d<double>& _beta = {});
+	template<typename _T>
+	bool defineNQSPair(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_ptr<NQS<2, _T>>& _NQS, 
+		const v_1d<std::shared_ptr<NQS<2, _T>>>& _NQSl, const v_1d<double>& _beta);
+	template<typename _T, uint _spinModes = 2>
+	void defineNQSParams(std::shared_ptr<NQS<_spinModes, _T>>& _NQS);
 
 	// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 	
@@ -813,6 +901,7 @@ inline bool UI::defineHilbert(Hilbert::HilbertSpace<_T>& _Hil)
 	bool _isGood				= true;
 	// get the symmetries
 	auto [_glbSyms, _locSyms]	= this->createSymmetries();
+	Hilbert::HilbertSpace<_T>::setCacheDir(this->symP.hcache_);
 	_Hil						= Hilbert::HilbertSpace<_T>(this->latP.lat, _locSyms, _glbSyms);
 	if (_Hil.getHilbertSize() == 0)
 	{
@@ -890,6 +979,7 @@ inline bool UI::defineModel(Hilbert::HilbertSpace<_T>& _Hil, std::shared_ptr<Ham
 	case MY_MODELS::POWER_LAW_RANDOM_BANDED_M:
 		_H = std::make_shared<PowerLawRandomBanded<_T>>(std::move(_Hil), this->modP.power_law_random_bandwidth.plrb_a_[0],
 			this->modP.power_law_random_bandwidth.plrb_b_, this->modP.power_law_random_bandwidth.plrb_mb_);
+		std::static_pointer_cast<PowerLawRandomBanded<_T>>(_H)->setBandCut(this->modP.power_law_random_bandwidth.plrb_cut_);
 		break;
 	default:
 		_H = std::make_shared<XYZ<_T>>(std::move(_Hil),
@@ -901,6 +991,8 @@ inline bool UI::defineModel(Hilbert::HilbertSpace<_T>& _Hil, std::shared_ptr<Ham
 		break;
 	}
 	if (this->modP.modRanSeed_ != 0) _H->setSeed(this->modP.modRanSeed_);
+	_H->setThreadNum(this->threadNum);
+	if (!this->modP.estream_.empty()) _H->setEigVecStream(this->modP.estream_);
 
 	return true;
 }
@@ -965,6 +1057,7 @@ inline bool UI::defineModel(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_pt
 	case MY_MODELS::POWER_LAW_RANDOM_BANDED_M:
 		_H = std::make_shared<PowerLawRandomBanded<_T>>(_lat, this->modP.power_law_random_bandwidth.plrb_a_[0],
 			this->modP.power_law_random_bandwidth.plrb_b_, this->modP.power_law_random_bandwidth.plrb_mb_);
+		std::static_pointer_cast<PowerLawRandomBanded<_T>>(_H)->setBandCut(this->modP.power_law_random_bandwidth.plrb_cut_);
 		break;
 	default:
 		_H = std::make_shared<XYZ<_T>>(std::move(_Hil),
@@ -976,6 +1069,8 @@ inline bool UI::defineModel(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_pt
 		break;
 	}
 	if (this->modP.modRanSeed_ != 0) _H->setSeed(this->modP.modRanSeed_);
+	_H->setThreadNum(this->threadNum);
+	if (!this->modP.estream_.empty()) _H->setEigVecStream(this->modP.estream_);
 
 	return true;
 }
@@ -1037,6 +1132,7 @@ inline bool UI::defineModel(std::shared_ptr<Hamiltonian<_T>>& _H, uint _Ns)
 	case MY_MODELS::POWER_LAW_RANDOM_BANDED_M:
 		_H = std::make_shared<PowerLawRandomBanded<_T>>(_Ns, this->modP.power_law_random_bandwidth.plrb_a_[0],
 			this->modP.power_law_random_bandwidth.plrb_b_, this->modP.power_law_random_bandwidth.plrb_mb_);
+		std::static_pointer_cast<PowerLawRandomBanded<_T>>(_H)->setBandCut(this->modP.power_law_random_bandwidth.plrb_cut_);
 		break;
 	default:
 		_H = std::make_shared<XYZ<_T>>(std::move(_Hil),
@@ -1048,6 +1144,8 @@ inline bool UI::defineModel(std::shared_ptr<Hamiltonian<_T>>& _H, uint _Ns)
 		break;
 	}
 	if (this->modP.modRanSeed_ != 0) _H->setSeed(this->modP.modRanSeed_);
+	_H->setThreadNum(this->threadNum);
+	if (!this->modP.estream_.empty()) _H->setEigVecStream(this->modP.estream_);
 
 	return true;
 }
@@ -24,6 +24,9 @@ int main(const int argc, char* argv[])
 
 	SET_LOG_TIME();
 
+	// distributed NQS training (no-op without NQS_USE_MPI)
+	NQS_MPI::init();
+
 	auto ui = std::make_unique<UI>(argc, argv);
 	ui->funChoice();
 
@@ -124,5 +127,7 @@ int main(const int argc, char* argv[])
 	//}
 	//LOGINFO(VEQ(Sz_0), LOG_TYPES::INFO, 0);
 
+	ui.reset();
+	NQS_MPI::finalize();
 	return 0;
 }
\ No newline at end of file
@@ -65,20 +65,8 @@ namespace Operators
 		template <typename _T>
 		Operators::Operator<_T> sig_x(size_t _Ns, size_t _part)
 		{
-			// create the function
-			_GLB<_T> fun_		= [_Ns, _part](u64 state) { return sig_x<_T>(state, _Ns, { (uint)_part }); };
-			_GLB_V<_T> funV_	= [_Ns, _part](_OP_V_T_CR state) { return sig_x<_T>(state, _Ns, { (uint)_part }); };
-
-			// save on which elements the operator acts (for the sake of the correctness)
-			u64 _acts = 0;
-			// |set the bitmask on the state, remember that this is counted from the left|
-			// the first position is leftwise 0, the last is leftwise Ns - 1
-			_acts |= 1 << (_Ns - 1 - _part);
-
-			// set the operator
-			Operator<_T> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SX);
-			_op.setActOn(_acts);
-			return _op;
+			// the string is fused into the bitmasks (see Fused::PauliMask) - a single XOR and popcount per state
+			return Fused::make<_T>(_Ns, Fused::mask(_Ns, "x", { (uint)_part }), SymGenerators::SX);
 		}
 
 		/*
@@ -90,21 +78,7 @@ namespace Operators
 		template <typename _T>
 		Operators::Operator<_T> sig_x(size_t _Ns, const v_1d<uint>& sites)
 		{
-			// create the function
-			_GLB<_T> fun_		= [_Ns, sites](u64 state) { return sig_x<_T>(state, _Ns, sites); };
-			_GLB_V<_T> funV_	= [_Ns, sites](_OP_V_T_CR state) { return sig_x<_T>(state, _Ns, sites); };
-
-			// save on which elements the operator acts (for the sake of the correctness)
-			u64 _acts = 0;
-			// |set the bitmask on the state, remember that this is counted from the left|
-			// the first position is leftwise 0, the last is leftwise Ns - 1
-			for(auto _part : sites)
-				_acts |= 1 << (_Ns - 1 - _part);
-
-			// set the operator
-			Operator<_T> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SX);
-			_op.setActOn(_acts);
-			return _op;
+			return Fused::make<_T>(_Ns, Fused::mask(_Ns, "x", sites), SymGenerators::SX);
 		}
 
 		/*
@@ -115,34 +89,14 @@ namespace Operators
 		template <typename _T>
 		Operators::Operator<_T> sig_x(size_t _Ns)
 		{
-			// set the vector of sites
-			v_1d<uint> _sites		= Vectors::vecAtoB<uint>(_Ns);
-			// create the function
-			_GLB<_T> fun_			= [_Ns, _sites](u64 state) { return sig_x<_T>(state, _Ns, _sites); };
-			_GLB_V<_T> funV_ 		= [_Ns, _sites](_OP_V_T_CR state) { return sig_x<_T>(state, _Ns, _sites); };
-
-			// save on which elements the operator acts (for the sake of the correctness)
-			// |set the bitmask on the state, remember that this is counted from the left|
-			// the first position is leftwise 0, the last is leftwise Ns - 1
-
 			// take all of them!
-			u64 _acts				= (ULLPOW(_Ns)) - 1;
-
-			// set the operator
-			Operator<_T> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SX);
-			_op.setActOn(_acts);
-			return _op;
+			return Fused::make<_T>(_Ns, Fused::mask(_Ns, "x", Vectors::vecAtoB<uint>(_Ns)), SymGenerators::SX);
 		}
 
 		template <typename _T>
 		Operators::Operator<_T, uint> sig_x_l(size_t _Ns)
 		{
-			_LOC<_T> fun_ 	= [_Ns](u64 state, uint _part) { return sig_x<_T>(state, _Ns, { _part }); };
-			_LOC_V<_T> funV_ 	= [_Ns](_OP_V_T_CR state, uint _part) { return sig_x<_T>(state, _Ns, { _part }); };
-
-			// set the operator
-			Operator<_T, uint> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SX);
-			return _op;
+			return Fused::local<_T, 'x'>(_Ns, SymGenerators::SX);
 		}
 
 
@@ -187,20 +141,8 @@ namespace Operators
 		template <typename _T>
 		Operators::Operator<_T> sig_z(size_t _Ns, size_t _part)
 		{
-			// create the function
-			_GLB<_T> fun_		= [_Ns, _part](u64 state) { return sig_z<_T>(state, _Ns, { (uint)_part }); };
-			_GLB_V<_T> funV_ 	= [_Ns, _part](_OP_V_T_CR state) { return sig_z<_T>(state, _Ns, { (uint)_part }); };
-
-			// save on which elements the operator acts (for the sake of the correctness)
-			u64 _acts = 0;
-			// |set the bitmask on the state, remember that this is counted from the left|
-			// the first position is leftwise 0, the last is leftwise Ns - 1
-			_acts |= 1 << (_Ns - 1 - _part);
-
-			// set the operator
-			Operator<_T> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SZ);
-			_op.setActOn(_acts);
-			return _op;
+			// the string is fused into the bitmasks (see Fused::PauliMask) - a single XOR and popcount per state
+			return Fused::make<_T>(_Ns, Fused::mask(_Ns, "z", { (uint)_part }), SymGenerators::SZ);
 		}
 
 		/*
@@ -212,21 +154,7 @@ namespace Operators
 		template <typename _T>
 		Operators::Operator<_T> sig_z(size_t _Ns, const v_1d<uint>& sites)
 		{
-			// create the function
-			_GLB<_T> fun_		= [_Ns, sites](u64 state) { return sig_z<_T>(state, _Ns, sites); };
-			_GLB_V<_T> funV_	= [_Ns, sites](_OP_V_T_CR state) { return sig_z<_T>(state, _Ns, sites); };
-
-			// save on which elements the operator acts (for the sake of the correctness)
-			u64 _acts = 0;
-			// |set the bitmask on the state, remember that this is counted from the left|
-			// the first position is leftwise 0, the last is leftwise Ns - 1
-			for(auto _part : sites)
-				_acts |= 1 << (_Ns - 1 - _part);
-
-			// set the operator
-			Operator<_T> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SZ);
-			_op.setActOn(_acts);
-			return _op;
+			return Fused::make<_T>(_Ns, Fused::mask(_Ns, "z", sites), SymGenerators::SZ);
 		}
 
 		/*
@@ -238,34 +166,14 @@ namespace Operators
 		template <typename _T>
 		Operators::Operator<_T> sig_z(size_t _Ns)
 		{
-			// set the vector of sites
-			v_1d<uint> _sites		= Vectors::vecAtoB<uint>(_Ns);
-			// create the function
-			_GLB<_T> fun_		= [_Ns, _sites](u64 state) { return sig_z<_T>(state, _Ns, _sites); };
-			_GLB_V<_T> funV_ 	= [_Ns, _sites](_OP_V_T_CR state) { return sig_z<_T>(state, _Ns, _sites); };
-
-			// save on which elements the operator acts (for the sake of the correctness)
-			// |set the bitmask on the state, remember that this is counted from the left|
-			// the first position is leftwise 0, the last is leftwise Ns - 1
-
 			// take all of them!
-			u64 _acts				= (ULLPOW(_Ns)) - 1;
-
-			// set the operator
-			Operator<_T> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SZ);
-			_op.setActOn(_acts);
-			return _op;
+			return Fused::make<_T>(_Ns, Fused::mask(_Ns, "z", Vectors::vecAtoB<uint>(_Ns)), SymGenerators::SZ);
 		}
 
 		template <typename _T>
 		Operators::Operator<_T, uint> sig_z_l(size_t _Ns)
 		{
-			_LOC<_T> fun_ 		= [_Ns](u64 state, uint _part) { return sig_z<_T>(state, _Ns, { _part }); };
-			_LOC_V<_T> funV_ 	= [_Ns](_OP_V_T_CR state, uint _part) { return sig_z<_T>(state, _Ns, { _part }); };
-
-			// set the operator
-			Operator<_T, uint> _op(_Ns, 1.0, fun_, funV_, SymGenerators::SZ);
-			return _op;
+			return Fused::local<_T, 'z'>(_Ns, SymGenerators::SZ);
 		}
 
 		// ############################################################################################# 
@@ -0,0 +1,524 @@
+/***********************************
+* Implements the device backend of the
+* NQS (see nqs_gpu.h) - the kernels of
+* the chains and of the connections of
+* the RBM and the SR solvers built on
+* cuBLAS and cuSOLVER. Instantiated for
+* double and std::complex<double>.
+***********************************/
+
+#include "../include/NQS/NQS_base/nqs_gpu.h"
+
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <cuda_runtime.h>
+#include <cublas_v2.h>
+#include <cusolverDn.h>
+#include <thrust/complex.h>
+
+#define NQS_GPU_CHECK(_call)																			\
+	do {																								\
+		const cudaError_t _e = (_call);																	\
+		if (_e != cudaSuccess)																			\
+			throw std::runtime_error(std::string("CUDA: ") + cudaGetErrorString(_e) + " in " #_call);	\
+	} while (0)
+#define NQS_GPU_CHECK_LIB(_call)																		\
+	do {																								\
+		if ((int)(_call) != 0)																			\
+			throw std::runtime_error(std::string("CUDA library call failed: " #_call));				\
+	} while (0)
+
+namespace NQS_GPU
+{
+	// ##########################################################################################################################################
+
+	auto devices() -> int
+	{
+		int _n = 0;
+		if (cudaGetDeviceCount(&_n) != cudaSuccess)
+			return 0;
+		return _n;
+	}
+
+	void select(int _dev)
+	{
+		NQS_GPU_CHECK(cudaSetDevice(_dev));
+	}
+
+	Buffer::~Buffer()
+	{
+		if (this->ptr_ != nullptr)
+			cudaFree(this->ptr_);
+	}
+
+	void Buffer::reserve(size_t _bytes)
+	{
+		if (_bytes <= this->bytes_)
+			return;
+		if (this->ptr_ != nullptr)
+			NQS_GPU_CHECK(cudaFree(this->ptr_));
+		this->ptr_		= nullptr;
+		NQS_GPU_CHECK(cudaMalloc(&this->ptr_, _bytes));
+		this->bytes_	= _bytes;
+	}
+
+	void Buffer::upload(const void* _h, size_t _bytes)
+	{
+		this->reserve(_bytes);
+		NQS_GPU_CHECK(cudaMemcpy(this->ptr_, _h, _bytes, cudaMemcpyHostToDevice));
+	}
+
+	void Buffer::download(void* _h, size_t _bytes) const
+	{
+		NQS_GPU_CHECK(cudaMemcpy(_h, this->ptr_, _bytes, cudaMemcpyDeviceToHost));
+	}
+
+	// ##########################################################################################################################################
+
+	namespace
+	{
+		// device counterpart of the host type (the layouts are the same)
+		template <typename _T>
+		struct Dev											{ using type = _T;						};
+		template <>
+		struct Dev<std::complex<double>>					{ using type = thrust::complex<double>;	};
+
+		template <typename _D>
+		__device__ inline double re(const _D& _x)			{ return _x;							};
+		template <>
+		__device__ inline double re(const thrust::complex<double>& _x) { return _x.real();			};
+
+		/*
+		* @brief log(cosh(x)) without the overflow - cosh is even, the argument is taken with the non-negative real part
+		*/
+		__device__ inline double logcosh(double _x)
+		{
+			const double _a			= fabs(_x);
+			return _a + log1p(exp(-2.0 * _a)) - 0.6931471805599453;
+		}
+		__device__ inline thrust::complex<double> logcosh(thrust::complex<double> _z)
+		{
+			if (_z.real() < 0)
+				_z					= -_z;
+			return _z + thrust::log(1.0 + thrust::exp(-2.0 * _z)) - 0.6931471805599453;
+		}
+
+		/*
+		* @brief Sum of the block (shared memory of NQS_GPU_THREADS elements), the result is in _red[0]
+		*/
+		template <typename _D>
+		__device__ inline void reduce(_D* _red)
+		{
+			for (unsigned _s = blockDim.x / 2; _s > 0; _s >>= 1)
+			{
+				if (threadIdx.x < _s)
+					_red[threadIdx.x] += _red[threadIdx.x + _s];
+				__syncthreads();
+			}
+		}
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief Metropolis steps of all the chains - the block c advances the chain c, the threads split the hidden units
+		*/
+		template <typename _D>
+		__global__ void sampleKernel(const _D* __restrict__ _W, const _D* __restrict__ _bV, double* _S, _D* _theta,
+									 const unsigned* __restrict__ _sites, const float* __restrict__ _rnd,
+									 unsigned _nV, unsigned _nH, unsigned _nC, unsigned _bSize, bool _spin)
+		{
+			__shared__ _D _red[NQS_GPU_THREADS];
+			__shared__ bool _accept;
+			const unsigned c		= blockIdx.x;
+			double* _s				= _S + (size_t)c * _nV;
+			_D* _th					= _theta + (size_t)c * _nH;
+
+			for (unsigned _step = 0; _step < _bSize; ++_step)
+			{
+				const unsigned _site= _sites[(size_t)_step * _nC + c];
+				const double _v		= _s[_site];
+				const double _d		= _spin ? -2.0 * _v : 1.0 - 2.0 * _v;
+				const _D* _w		= _W + (size_t)_site * _nH;
+
+				_D _acc				= 0.0;
+				for (unsigned h = threadIdx.x; h < _nH; h += blockDim.x)
+					_acc			+= logcosh(_th[h] + _d * _w[h]) - logcosh(_th[h]);
+				_red[threadIdx.x]	= _acc;
+				__syncthreads();
+				reduce(_red);
+
+				if (threadIdx.x == 0)
+				{
+					const _D _logr	= _red[0] + _d * _bV[_site];
+					_accept			= (double)_rnd[(size_t)_step * _nC + c] < exp(2.0 * re(_logr));
+					if (_accept)
+						_s[_site]	+= _d;
+				}
+				__syncthreads();
+				if (_accept)
+					for (unsigned h = threadIdx.x; h < _nH; h += blockDim.x)
+						_th[h]		+= _d * _w[h];
+				__syncthreads();
+			}
+		}
+
+		/*
+		* @brief Ratios of the connections - the block k evaluates the connection k of the chain _chain[k]
+		*/
+		template <typename _D>
+		__global__ void ratiosKernel(const _D* __restrict__ _W, const _D* __restrict__ _bV, const _D* __restrict__ _theta,
+									 const int* __restrict__ _chain, const int* __restrict__ _fP, const double* __restrict__ _dv,
+									 unsigned _nH, unsigned _maxFlips, _D* _out)
+		{
+			__shared__ _D _red[NQS_GPU_THREADS];
+			const size_t k			= blockIdx.x;
+			const _D* _th			= _theta + (size_t)_chain[k] * _nH;
+			const int* _f			= _fP + k * _maxFlips;
+			const double* _d		= _dv + k * _maxFlips;
+
+			_D _acc					= 0.0;
+			for (unsigned h = threadIdx.x; h < _nH; h += blockDim.x)
+			{
+				_D _new				= _th[h];
+				for (unsigned f = 0; f < _maxFlips && _f[f] >= 0; ++f)
+					_new			+= _d[f] * _W[(size_t)_f[f] * _nH + h];
+				_acc				+= logcosh(_new) - logcosh(_th[h]);
+			}
+			_red[threadIdx.x]		= _acc;
+			__syncthreads();
+			reduce(_red);
+			if (threadIdx.x == 0)
+			{
+				_D _logr			= _red[0];
+				for (unsigned f = 0; f < _maxFlips && _f[f] >= 0; ++f)
+					_logr			+= _d[f] * _bV[_f[f]];
+				_out[k]				= exp(_logr);
+			}
+		}
+
+		// ##########################################################################################################################################
+
+		template <typename _D>
+		__global__ void mulKernel(const _D* _a, const _D* _b, _D* _c, unsigned _n)
+		{
+			const unsigned i		= blockIdx.x * blockDim.x + threadIdx.x;
+			if (i < _n)
+				_c[i]				= _a[i] * _b[i];
+		}
+
+		template <typename _D>
+		__global__ void invDiagKernel(const _D* _diag, double _reg, _D* _M, unsigned _n)
+		{
+			const unsigned i		= blockIdx.x * blockDim.x + threadIdx.x;
+			if (i < _n)
+				_M[i]				= 1.0 / (_diag[i] + _reg);
+		}
+
+		template <typename _D>
+		__global__ void addDiagKernel(_D* _K, double _reg, unsigned _n)
+		{
+			const unsigned i		= blockIdx.x * blockDim.x + threadIdx.x;
+			if (i < _n)
+				_K[(size_t)i * _n + i] += _reg;
+		}
+
+		inline unsigned grid(size_t _n)						{ return (unsigned)((_n + NQS_GPU_THREADS - 1) / NQS_GPU_THREADS); };
+
+		// ##########################################################################################################################################
+
+		/*
+		* @brief cuBLAS and cuSOLVER calls of the type (the conjugate transpose of the real matrix is the transpose)
+		*/
+		template <typename _T>
+		struct Lib;
+
+		template <>
+		struct Lib<double>
+		{
+			static constexpr cublasOperation_t H = CUBLAS_OP_T;
+			static void gemv(cublasHandle_t _h, cublasOperation_t _op, int _m, int _n, double _a, const double* _A, const double* _x, double _b, double* _y)
+			{ NQS_GPU_CHECK_LIB(cublasDgemv(_h, _op, _m, _n, &_a, _A, _m, _x, 1, &_b, _y, 1)); }
+			static auto dot(cublasHandle_t _h, int _n, const double* _x, const double* _y) -> double
+			{ double _r = 0; NQS_GPU_CHECK_LIB(cublasDdot(_h, _n, _x, 1, _y, 1, &_r)); return _r; }
+			static auto nrm2(cublasHandle_t _h, int _n, const double* _x) -> double
+			{ double _r = 0; NQS_GPU_CHECK_LIB(cublasDnrm2(_h, _n, _x, 1, &_r)); return _r; }
+			static void axpy(cublasHandle_t _h, int _n, double _a, const double* _x, double* _y)
+			{ NQS_GPU_CHECK_LIB(cublasDaxpy(_h, _n, &_a, _x, 1, _y, 1)); }
+			static void scal(cublasHandle_t _h, int _n, double _a, double* _x)
+			{ NQS_GPU_CHECK_LIB(cublasDscal(_h, _n, &_a, _x, 1)); }
+			static void kernel(cublasHandle_t _h, int _N, int _P, double _a, const double* _O, double* _K)
+			{ const double _b = 0; NQS_GPU_CHECK_LIB(cublasDsyrk(_h, CUBLAS_FILL_MODE_LOWER, CUBLAS_OP_N, _N, _P, &_a, _O, _N, &_b, _K, _N)); }
+			static auto potrfSize(cusolverDnHandle_t _s, int _n, double* _K) -> int
+			{ int _l = 0; NQS_GPU_CHECK_LIB(cusolverDnDpotrf_bufferSize(_s, CUBLAS_FILL_MODE_LOWER, _n, _K, _n, &_l)); return _l; }
+			static void potrf(cusolverDnHandle_t _s, int _n, double* _K, double* _w, int _l, int* _info)
+			{ NQS_GPU_CHECK_LIB(cusolverDnDpotrf(_s, CUBLAS_FILL_MODE_LOWER, _n, _K, _n, _w, _l, _info)); }
+			static void potrs(cusolverDnHandle_t _s, int _n, const double* _K, double* _b, int* _info)
+			{ NQS_GPU_CHECK_LIB(cusolverDnDpotrs(_s, CUBLAS_FILL_MODE_LOWER, _n, 1, _K, _n, _b, _n, _info)); }
+		};
+
+		template <>
+		struct Lib<std::complex<double>>
+		{
+			using C = cuDoubleComplex;
+			static constexpr cublasOperation_t H = CUBLAS_OP_C;
+			static auto c(const std::complex<double>* _x) -> const C*	{ return reinterpret_cast<const C*>(_x); };
+			static auto c(std::complex<double>* _x) -> C*				{ return reinterpret_cast<C*>(_x);		};
+			static auto c(std::complex<double> _x) -> C					{ return make_cuDoubleComplex(_x.real(), _x.imag()); };
+
+			static void gemv(cublasHandle_t _h, cublasOperation_t _op, int _m, int _n, std::complex<double> _a, const std::complex<double>* _A,
+							 const std::complex<double>* _x, std::complex<double> _b, std::complex<double>* _y)
+			{ const C _ca = c(_a), _cb = c(_b); NQS_GPU_CHECK_LIB(cublasZgemv(_h, _op, _m, _n, &_ca, c(_A), _m, c(_x), 1, &_cb, c(_y), 1)); }
+			static auto dot(cublasHandle_t _h, int _n, const std::complex<double>* _x, const std::complex<double>* _y) -> std::complex<double>
+			{ C _r; NQS_GPU_CHECK_LIB(cublasZdotc(_h, _n, c(_x), 1, c(_y), 1, &_r)); return { cuCreal(_r), cuCimag(_r) }; }
+			static auto nrm2(cublasHandle_t _h, int _n, const std::complex<double>* _x) -> double
+			{ double _r = 0; NQS_GPU_CHECK_LIB(cublasDznrm2(_h, _n, c(_x), 1, &_r)); return _r; }
+			static void axpy(cublasHandle_t _h, int _n, std::complex<double> _a, const std::complex<double>* _x, std::complex<double>* _y)
+			{ const C _ca = c(_a); NQS_GPU_CHECK_LIB(cublasZaxpy(_h, _n, &_ca, c(_x), 1, c(_y), 1)); }
+			static void scal(cublasHandle_t _h, int _n, std::complex<double> _a, std::complex<double>* _x)
+			{ const C _ca = c(_a); NQS_GPU_CHECK_LIB(cublasZscal(_h, _n, &_ca, c(_x), 1)); }
+			static void kernel(cublasHandle_t _h, int _N, int _P, double _a, const std::complex<double>* _O, std::complex<double>* _K)
+			{ const double _b = 0; NQS_GPU_CHECK_LIB(cublasZherk(_h, CUBLAS_FILL_MODE_LOWER, CUBLAS_OP_N, _N, _P, &_a, c(_O), _N, &_b, c(_K), _N)); }
+			static auto potrfSize(cusolverDnHandle_t _s, int _n, std::complex<double>* _K) -> int
+			{ int _l = 0; NQS_GPU_CHECK_LIB(cusolverDnZpotrf_bufferSize(_s, CUBLAS_FILL_MODE_LOWER, _n, c(_K), _n, &_l)); return _l; }
+			static void potrf(cusolverDnHandle_t _s, int _n, std::complex<double>* _K, std::complex<double>* _w, int _l, int* _info)
+			{ NQS_GPU_CHECK_LIB(cusolverDnZpotrf(_s, CUBLAS_FILL_MODE_LOWER, _n, c(_K), _n, c(_w), _l, _info)); }
+			static void potrs(cusolverDnHandle_t _s, int _n, const std::complex<double>* _K, std::complex<double>* _b, int* _info)
+			{ NQS_GPU_CHECK_LIB(cusolverDnZpotrs(_s, CUBLAS_FILL_MODE_LOWER, _n, 1, c(_K), _n, c(_b), _n, _info)); }
+		};
+
+		template <typename _T>
+		inline auto realPart(const _T& _x) -> double
+		{
+			if constexpr (std::is_same_v<_T, double>)
+				return _x;
+			else
+				return _x.real();
+		}
+	};
+
+	// ##########################################################################################################################################
+
+	// ########################################################## R B M   C H A I N S ###########################################################
+
+	// ##########################################################################################################################################
+
+	template <typename _T>
+	void RBMChains<_T>::setWeights(const _T* _W, const _T* _bV, const _T* _bH, unsigned _nV, unsigned _nH)
+	{
+		this->nV_	= _nV;
+		this->nH_	= _nH;
+		this->W_.upload(_W, sizeof(_T) * _nV * _nH);
+		this->bV_.upload(_bV, sizeof(_T) * _nV);
+		this->bH_.upload(_bH, sizeof(_T) * _nH);
+	}
+
+	template <typename _T>
+	void RBMChains<_T>::setChains(const double* _S, const _T* _theta, unsigned _nC)
+	{
+		this->nC_	= _nC;
+		this->S_.upload(_S, sizeof(double) * this->nV_ * _nC);
+		this->theta_.upload(_theta, sizeof(_T) * this->nH_ * _nC);
+	}
+
+	template <typename _T>
+	void RBMChains<_T>::getChains(double* _S, _T* _theta) const
+	{
+		this->S_.download(_S, sizeof(double) * this->nV_ * this->nC_);
+		this->theta_.download(_theta, sizeof(_T) * this->nH_ * this->nC_);
+	}
+
+	template <typename _T>
+	void RBMChains<_T>::sample(unsigned _bSize, const unsigned* _sites, const float* _rnd, bool _spin)
+	{
+		using _D = typename Dev<_T>::type;
+		if (_bSize == 0 || this->nC_ == 0)
+			return;
+		this->sites_.upload(_sites, sizeof(unsigned) * _bSize * this->nC_);
+		this->rnd_.upload(_rnd, sizeof(float) * _bSize * this->nC_);
+		sampleKernel<_D><<<this->nC_, NQS_GPU_THREADS>>>((const _D*)this->W_.get(), (const _D*)this->bV_.get(), (double*)this->S_.get(), (_D*)this->theta_.get(),
+														 (const unsigned*)this->sites_.get(), (const float*)this->rnd_.get(),
+														 this->nV_, this->nH_, this->nC_, _bSize, _spin);
+		NQS_GPU_CHECK(cudaGetLastError());
+	}
+
+	template <typename _T>
+	void RBMChains<_T>::ratios(const int* _chain, const int* _fP, const double* _d, size_t _nConn, unsigned _maxFlips, _T* _out)
+	{
+		using _D = typename Dev<_T>::type;
+		if (_nConn == 0)
+			return;
+		// single upload of the connections: chains, sites, changes
+		const size_t _bI	= sizeof(int) * _nConn;
+		const size_t _bF	= sizeof(int) * _nConn * _maxFlips;
+		const size_t _bD	= sizeof(double) * _nConn * _maxFlips;
+		this->conn_.reserve(_bI + _bF + _bD);
+		char* _p			= (char*)this->conn_.get();
+		NQS_GPU_CHECK(cudaMemcpy(_p, _chain, _bI, cudaMemcpyHostToDevice));
+		NQS_GPU_CHECK(cudaMemcpy(_p + _bI, _fP, _bF, cudaMemcpyHostToDevice));
+		NQS_GPU_CHECK(cudaMemcpy(_p + _bI + _bF, _d, _bD, cudaMemcpyHostToDevice));
+		this->ratios_.reserve(sizeof(_T) * _nConn);
+
+		ratiosKernel<_D><<<(unsigned)_nConn, NQS_GPU_THREADS>>>((const _D*)this->W_.get(), (const _D*)this->bV_.get(), (const _D*)this->theta_.get(),
+																(const int*)_p, (const int*)(_p + _bI), (const double*)(_p + _bI + _bF),
+																this->nH_, _maxFlips, (_D*)this->ratios_.get());
+		NQS_GPU_CHECK(cudaGetLastError());
+		this->ratios_.download(_out, sizeof(_T) * _nConn);
+	}
+
+	// ##########################################################################################################################################
+
+	// ################################################################# S R ####################################################################
+
+	// ##########################################################################################################################################
+
+	template <typename _T>
+	void SR<_T>::handles()
+	{
+		if (this->blas_ == nullptr)
+		{
+			cublasHandle_t _h;
+			NQS_GPU_CHECK_LIB(cublasCreate(&_h));
+			this->blas_		= (void*)_h;
+		}
+		if (this->solver_ == nullptr)
+		{
+			cusolverDnHandle_t _s;
+			NQS_GPU_CHECK_LIB(cusolverDnCreate(&_s));
+			this->solver_	= (void*)_s;
+		}
+	}
+
+	template <typename _T>
+	SR<_T>::~SR()
+	{
+		if (this->blas_ != nullptr)
+			cublasDestroy((cublasHandle_t)this->blas_);
+		if (this->solver_ != nullptr)
+			cusolverDnDestroy((cusolverDnHandle_t)this->solver_);
+	}
+
+	template <typename _T>
+	void SR<_T>::set(const _T* _Oc, unsigned _N, unsigned _P, double _nSamples)
+	{
+		this->handles();
+		this->N_		= _N;
+		this->P_		= _P;
+		this->nSamples_	= _nSamples;
+		this->O_.upload(_Oc, sizeof(_T) * _N * _P);
+		// x, r, z, p, Ap, M (P each) and u (N)
+		this->work_.reserve(sizeof(_T) * (6 * (size_t)_P + _N));
+	}
+
+	template <typename _T>
+	void SR<_T>::force(const _T* _v, _T* _y)
+	{
+		auto _h			= (cublasHandle_t)this->blas_;
+		_T* _w			= (_T*)this->work_.get();
+		_T* _u			= _w + 6 * (size_t)this->P_;
+		_T* _yD			= _w;
+		NQS_GPU_CHECK(cudaMemcpy(_u, _v, sizeof(_T) * this->N_, cudaMemcpyHostToDevice));
+		Lib<_T>::gemv(_h, Lib<_T>::H, this->N_, this->P_, 1.0, (const _T*)this->O_.get(), _u, 0.0, _yD);
+		NQS_GPU_CHECK(cudaMemcpy(_y, _yD, sizeof(_T) * this->P_, cudaMemcpyDeviceToHost));
+	}
+
+	template <typename _T>
+	auto SR<_T>::solveCG(const _T* _F, const _T* _diag, double _reg, double _tol, unsigned _maxIter, _T* _x, unsigned& _iters) -> bool
+	{
+		using _D		= typename Dev<_T>::type;
+		auto _h			= (cublasHandle_t)this->blas_;
+		const int _P	= (int)this->P_;
+		const _T* _O	= (const _T*)this->O_.get();
+		_T* _w			= (_T*)this->work_.get();
+		_T *_xD = _w, *_r = _w + _P, *_z = _w + 2 * _P, *_p = _w + 3 * _P, *_Ap = _w + 4 * _P, *_M = _w + 5 * _P, *_u = _w + 6 * _P;
+
+		// (S + reg) a = O^H (O a) / N + reg a
+		auto _apply		= [&](const _T* _a, _T* _out)
+			{
+				Lib<_T>::gemv(_h, CUBLAS_OP_N, this->N_, _P, 1.0, _O, _a, 0.0, _u);
+				Lib<_T>::gemv(_h, Lib<_T>::H, this->N_, _P, 1.0 / this->nSamples_, _O, _u, 0.0, _out);
+				Lib<_T>::axpy(_h, _P, _reg, _a, _out);
+			};
+
+		NQS_GPU_CHECK(cudaMemcpy(_xD, _x, sizeof(_T) * _P, cudaMemcpyHostToDevice));
+		NQS_GPU_CHECK(cudaMemcpy(_r, _F, sizeof(_T) * _P, cudaMemcpyHostToDevice));
+		NQS_GPU_CHECK(cudaMemcpy(_z, _diag, sizeof(_T) * _P, cudaMemcpyHostToDevice));
+		invDiagKernel<_D><<<grid(_P), NQS_GPU_THREADS>>>((const _D*)_z, _reg, (_D*)_M, _P);
+		const double _bNorm	= std::max(Lib<_T>::nrm2(_h, _P, _r), 1e-300);
+
+		// r = F - A x, z = M r, p = z
+		_apply(_xD, _Ap);
+		Lib<_T>::axpy(_h, _P, -1.0, _Ap, _r);
+		mulKernel<_D><<<grid(_P), NQS_GPU_THREADS>>>((const _D*)_M, (const _D*)_r, (_D*)_z, _P);
+		NQS_GPU_CHECK(cudaMemcpy(_p, _z, sizeof(_T) * _P, cudaMemcpyDeviceToDevice));
+		double _rz			= realPart(Lib<_T>::dot(_h, _P, _r, _z));
+		bool _converged		= Lib<_T>::nrm2(_h, _P, _r) <= _tol * _bNorm;
+
+		for (_iters = 0; !_converged && _iters < _maxIter; ++_iters)
+		{
+			_apply(_p, _Ap);
+			const _T _alpha	= _rz / realPart(Lib<_T>::dot(_h, _P, _p, _Ap));
+			Lib<_T>::axpy(_h, _P, _alpha, _p, _xD);
+			Lib<_T>::axpy(_h, _P, -_alpha, _Ap, _r);
+			if (Lib<_T>::nrm2(_h, _P, _r) <= _tol * _bNorm)
+			{
+				_converged	= true;
+				break;
+			}
+			mulKernel<_D><<<grid(_P), NQS_GPU_THREADS>>>((const _D*)_M, (const _D*)_r, (_D*)_z, _P);
+			const double _rzNew	= realPart(Lib<_T>::dot(_h, _P, _r, _z));
+			// p = z + (rz_new / rz) p
+			Lib<_T>::scal(_h, _P, _rzNew / _rz, _p);
+			Lib<_T>::axpy(_h, _P, 1.0, _z, _p);
+			_rz				= _rzNew;
+		}
+		NQS_GPU_CHECK(cudaGetLastError());
+		NQS_GPU_CHECK(cudaMemcpy(_x, _xD, sizeof(_T) * _P, cudaMemcpyDeviceToHost));
+		return _converged;
+	}
+
+	template <typename _T>
+	auto SR<_T>::solveMinSR(const _T* _v, double _reg, _T* _x) -> bool
+	{
+		using _D		= typename Dev<_T>::type;
+		auto _h			= (cublasHandle_t)this->blas_;
+		auto _s			= (cusolverDnHandle_t)this->solver_;
+		const int _N	= (int)this->N_;
+		const int _P	= (int)this->P_;
+		const _T* _O	= (const _T*)this->O_.get();
+
+		// K (N x N), a (N), info, then the workspace of the factorization
+		_T* _xD			= (_T*)this->work_.get();
+		const int _l	= Lib<_T>::potrfSize(_s, _N, nullptr);
+		this->lwork_.reserve(sizeof(_T) * ((size_t)_N * _N + _N + _l) + sizeof(int));
+		_T* _K			= (_T*)this->lwork_.get();
+		_T* _a			= _K + (size_t)_N * _N;
+		_T* _wk			= _a + _N;
+		int* _info		= (int*)(_wk + _l);
+
+		// K = O O^H / N + reg
+		Lib<_T>::kernel(_h, _N, _P, 1.0 / this->nSamples_, _O, _K);
+		addDiagKernel<_D><<<grid(_N), NQS_GPU_THREADS>>>((_D*)_K, _reg, _N);
+		NQS_GPU_CHECK(cudaMemcpy(_a, _v, sizeof(_T) * _N, cudaMemcpyHostToDevice));
+
+		int _hInfo		= 0;
+		Lib<_T>::potrf(_s, _N, _K, _wk, _l, _info);
+		NQS_GPU_CHECK(cudaMemcpy(&_hInfo, _info, sizeof(int), cudaMemcpyDeviceToHost));
+		if (_hInfo != 0)
+			return false;
+		Lib<_T>::potrs(_s, _N, _K, _a, _info);
+
+		// x = O^H a
+		Lib<_T>::gemv(_h, Lib<_T>::H, _N, _P, 1.0, _O, _a, 0.0, _xD);
+		NQS_GPU_CHECK(cudaMemcpy(_x, _xD, sizeof(_T) * _P, cudaMemcpyDeviceToHost));
+		return true;
+	}
+
+	// ##########################################################################################################################################
+
+	template class RBMChains<double>;
+	template class RBMChains<std::complex<double>>;
+	template class SR<double>;
+	template class SR<std::complex<double>>;
+};
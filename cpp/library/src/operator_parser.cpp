@@ -370,3 +370,82 @@ strVec Operators::OperatorNameParser::parseRangeOperators(const std::string &_in
 }
 
 // #############################################################################################################################
+
+// ------------------------------------------------------------------------------------------------------------------------------
+
+// ##############################################################################################################################
+
+// ------------------------------------------------------------------------------------------------------------------------------
+
+/*
+* @brief Compiles the parsed operator string into the intermediate form - the type, the sites and (for the spin operators)
+* the Pauli string, so that the operator is built from a single fused kernel and its matrix can be cached.
+* @param _input the parsed input string (see parse)
+* @param _ir the compiled operator
+* @returns true if the operator is known
+*/
+bool Operators::OperatorNameParser::compile(const std::string& _input, CompiledOperator& _ir)
+{
+	// resolve the operator and the sites based on the input
+	auto [op, sites] 		= this->resolveOperatorSeparator(_input);
+
+	// check if the operator is known
+	if (!this->operator_map_.contains(op))
+		return false;
+
+	_ir						= CompiledOperator();
+	_ir.name_				= _input;
+	_ir.type_				= this->operator_map_[op];
+	_ir.usesHilbert_		= OperatorTypes::needsHilbertSpaceDim(_ir.type_);
+
+	// check if the sites contain the correlation or random operator
+	if (_ir.random_ = sites.find(OPERATOR_SEP_RANDOM) != std::string::npos; !_ir.random_)
+		_ir.sites_			= this->resolveSites(splitStr(sites, OPERATOR_SEP_CORR), _ir.usesHilbert_);
+
+	// the spin operators on the given sites are the Pauli strings
+	switch (_ir.type_)
+	{
+	case OperatorTypes::OperatorsAvailable::Sx:
+		_ir.isPauli_		= true;
+		_ir.pauli_			= Fused::mask(this->L_, "x", Vectors::convert<uint>(_ir.sites_));
+		break;
+	case OperatorTypes::OperatorsAvailable::Sy:
+		_ir.isPauli_		= true;
+		_ir.pauli_			= Fused::mask(this->L_, "y", Vectors::convert<uint>(_ir.sites_));
+		break;
+	case OperatorTypes::OperatorsAvailable::Sz:
+		_ir.isPauli_		= true;
+		_ir.pauli_			= Fused::mask(this->L_, "z", Vectors::convert<uint>(_ir.sites_));
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+
+/*
+* @brief Signature of the operator matrix - the parsed string together with the sizes of the lattice and the Hilbert space.
+* The matrices of the operators are the same for all the realizations, so the signature keys them in Cache::MatrixCache.
+* @param _input the parsed input string (see parse)
+* @returns the signature or the empty string if the operator is unknown or random
+*/
+std::string Operators::OperatorNameParser::signature(const std::string& _input)
+{
+	CompiledOperator _ir;
+	if (!this->compile(_input, _ir) || !_ir.cacheable())
+		return "";
+	return _ir.name_ + ";Ns=" + this->Lstr_ + ";Nh=" + this->Nhstr_;
+}
+
+strVec Operators::OperatorNameParser::signatures(const strVec& _inputs)
+{
+	strVec _out;
+	_out.reserve(_inputs.size());
+	for (const auto& _in : _inputs)
+		_out.push_back(this->signature(_in));
+	return _out;
+}
+
+// #############################################################################################################################
@@ -39,6 +39,10 @@ void UI::makeSimETH()
 			RUN_CPX_REAL(_takeComplex, this->checkETH_time_evo, this->hamDouble, this->hamComplex);
 			break;
 
+		case 47:
+			RUN_CPX_REAL(_takeComplex, this->checkThermalTypicality, this->hamDouble, this->hamComplex);
+			break;
+
 		default:
 			// Handle unexpected values of chosenFun, if necessary
 			break;
@@ -101,6 +105,12 @@ void UI::makeSimETHSweep()
 			this->makeSimETH();
 			this->modP.modRanNIdx_++;
 		}
+
+		// the operator matrices are shared by the parameters of a given size only
+		auto& _cache = Operators::Cache::matrices<double>();
+		LOGINFO("Operator matrices cache: " + VEQ(_cache.size()) + "," + VEQ(_cache.hits()) + "," + VEQ(_cache.misses()) + "," + VEQ(_cache.memory()), LOG_TYPES::TRACE, 2);
+		_cache.clear();
+		Operators::Cache::matrices<cpx>().clear();
 	}
 }
 
@@ -147,9 +157,11 @@ std::pair<v_1d<std::shared_ptr<Operators::Operator<double>>>, strVec> UI::ui_eth
 * @param _H: Hamiltonian to randomize
 * @param _r: realization number
 * @param _spinchanged: which spin to change (if applicable)
+* @param _diagonalize: diagonalize the Hamiltonian after the build
+* @param _mid: number of the eigenpairs around Tr(H)/Nh from the shift-invert solver (0 - full diagonalization)
 */
 template<typename _T>
-void UI::ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r, uint _spinchanged)
+void UI::ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r, uint _spinchanged, bool _diagonalize, uint _mid)
 {
 	bool isQuadratic [[maybe_unused]]	= _H->getIsQuadratic(),
 		 isManyBody	 [[maybe_unused]]	= _H->getIsManyBody();
@@ -157,6 +169,9 @@ void UI::ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r, uint _spi
 	// clear the Hamiltonian
 	_H->clearH();
 
+	// the random matrices of the realization depend on (seed, _r, stream) only
+	_H->setRealization(_r);
+
 	// randomize the Hamiltonian
 	if (isManyBody)
 	{
@@ -191,7 +206,10 @@ void UI::ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r, uint _spi
 
 	// set the Hamiltonian
 	_H->buildHamiltonian();
-	_H->diagH(false);
+	if (_diagonalize && _mid > 0)
+		_H->diagH(false, _mid, 0, 1000, 0.0, "sg");
+	else if (_diagonalize)
+		_H->diagH(false);
 }
 
 // ###############################################################################################
@@ -211,28 +229,34 @@ void UI::ui_eth_randomize(std::shared_ptr<Hamiltonian<_T>> _H, int _r, uint _spi
 * @param _offdiagElems: off-diagonal elements
 * @param _offdiagElemsLow: off-diagonal elements low
 * @param _offdiagElemesStat: off-diagonal elements statistics
+* @param _fidelity: fidelity susceptibility with the regularization _fidMu (accumulated, may be nullptr)
+* @param _fidelityZ: fidelity susceptibility without the regularization (accumulated, may be nullptr)
 * @param _bandwidth: bandwidth
 * @param _avEn: average energy
+* @param _fidMu: regularization of the fidelity susceptibility
 * @param _opi: operator index
 * @param _r: realization index
 * @param _th: thread number
 */
 template<typename _T>
-std::array<double, 6> UI::checkETH_statistics_mat_elems(
+Accumulators::ElementMoments UI::checkETH_statistics_mat_elems(
 	u64 _startElem, u64 _stopElem, std::atomic<size_t>& _statiter,  int _th,
 	u64 _Nh,
 	Hamiltonian<_T>* _H,
 	const arma::Mat<_T>& _overlaps, 
-	HistogramAverage<double>& _histAv, HistogramAverage<double>& _histAvTypical,
+	Accumulators::LogHistogram& _histAv, Accumulators::LogHistogram& _histAvTypical,
 	arma::Mat<double>* _offdiagElemsOmega, arma::Mat<double>* _offdiagElemsOmegaLow,
 	VMAT<_T>* _offdiagElems, VMAT<_T>* _offdiagElemsLow,
 	VMAT<double>* _offdiagElemesStat,
+	arma::Col<double>* _fidelity,
+	arma::Col<double>* _fidelityZ,
 	const double _bandwidth,
 	const double _energyAt,
+	const double _fidMu,
 	int _opi, int _r)
 {
-	// diagonal
-	std::array<double, 6> _offdiagElemesStat_local = {0.0};
+	// moments of the elements (thread-local)
+	Accumulators::ElementMoments _offdiagElemesStat_local;
 
 	// iterators
 	size_t _totalIterator_off			= 0;
@@ -241,8 +265,10 @@ std::array<double, 6> UI::checkETH_statistics_mat_elems(
 	const size_t _elemThreadedLowSize	= _stopElem - _startElem;
 
 	// local Histograms		
-	HistogramAverage<double> _histAvLocal(_histAv.edges());
-	HistogramAverage<double> _histAvTypicalLocal(_histAvTypical.edges());
+	Accumulators::LogHistogram _histAvLocal			= _histAv;
+	Accumulators::LogHistogram _histAvTypicalLocal	= _histAvTypical;
+	_histAvLocal.clear();
+	_histAvTypicalLocal.clear();
 
 	// bandwidth limits
 	double omega_upper_cut		= 2.0;
@@ -252,13 +278,47 @@ std::array<double, 6> UI::checkETH_statistics_mat_elems(
 	u64 _iter					= _th >= 0 ? this->threadNum : 1;
 	u64 _statiter_local			= 0;
 
-	for (u64 i = _start; i < _stop; i += _iter)
+	// fidelity susceptibilities - each element contributes to both of its states (thread-local, merged at the end)
+	const auto& _energies		= _H->getEigVal();
+	const double _mu2			= _fidMu * _fidMu;
+	arma::Col<double> _fidLocal, _fidZLocal;
+	if (_fidelity)
+		_fidLocal.zeros(_Nh);
+	if (_fidelityZ)
+		_fidZLocal.zeros(_Nh);
+
+	// the upper triangle is swept in tiles - the thread takes every _iter-th column of tiles, and within the tile the rows
+	// run contiguously in memory, so each element of the overlaps is read once for all the quantities
+	const u64 _nTiles			= (_stop + UI_LIMITS_ETH_TILE - 1) / UI_LIMITS_ETH_TILE;
+	for (u64 _tj = _start; _tj < _nTiles; _tj += _iter)
+	for (u64 _ti = 0; _ti <= _tj; ++_ti)
+	for (u64 j = _tj * UI_LIMITS_ETH_TILE; j < std::min(_stop, (_tj + 1) * UI_LIMITS_ETH_TILE); ++j)
 	{
-		const double _en_l = _H->getEigVal(i);
+		const double _en_r = _energies(j);
 
-		for (u64 j = i + 1; j < _Nh; ++j)
+		for (u64 i = _ti * UI_LIMITS_ETH_TILE; i < std::min(j, (_ti + 1) * UI_LIMITS_ETH_TILE); ++i)
 		{
-			const double _en_r = _H->getEigVal(j);
+			const double _en_l = _energies(i);
+
+			// fidelity susceptibility (all the pairs)
+			if (_fidelity || _fidelityZ)
+			{
+				const double _v2	= std::norm(_overlaps(i, j));
+				const double _omm	= (_en_l - _en_r) * (_en_l - _en_r);
+				if (_fidelity)
+				{
+					const double _den	= _omm + _mu2;
+					const double _chi	= _v2 * _omm / (_den * _den);
+					_fidLocal(i)		+= _chi;
+					_fidLocal(j)		+= _chi;
+				}
+				if (_fidelityZ)
+				{
+					const double _chi	= _v2 / _omm;
+					_fidZLocal(i)		+= _chi;
+					_fidZLocal(j)		+= _chi;
+				}
+			}
 
 			// check the energy difference
 			if (!SystemProperties::hs_fraction_close_mean(_en_l, _en_r, _energyAt, this->modP.modEnDiff_ * _bandwidth))
@@ -279,30 +339,17 @@ std::array<double, 6> UI::checkETH_statistics_mat_elems(
 				auto _elemabs		= std::abs(_elem);
 				auto _elemreal		= algebra::cast<double>(_elem);
 				auto _elem2			= _elemabs * _elemabs;
-				auto _logElem		= std::log(_elemabs);
 				auto _logElem2		= std::log(_elemabs * _elemabs);
 
+				// accumulate the statistics in the thread-local storage
 				if (_offdiagElemesStat)
-				{
-					// Accumulate statistics in thread-local storage
-					// mean
-					_offdiagElemesStat_local[0] += _elemreal;
-					// typical
-					_offdiagElemesStat_local[1] += _logElem;
-					// mean2
-					_offdiagElemesStat_local[2] += _elem2;
-					// typical2
-					_offdiagElemesStat_local[3] += _logElem2;
-					// mean4
-					_offdiagElemesStat_local[4] += _elem2 * _elem2;
-					// meanabs
-					_offdiagElemesStat_local[5] += _elemabs;
-				}
+					_offdiagElemesStat_local.add(_elem);
 
 				// add to the histograms
 				_histAvLocal.append(w, _elem2);
 				// _histAvLocal.append(w, _elem2);
-				_histAvTypicalLocal.append(w, _logElem2);
+				if (_elem2 > 0.0)
+					_histAvTypicalLocal.append(w, _logElem2);
 				// _histAvTypicalLocal.append(w, _logElem2);
 
 				if (_offdiagElems)
@@ -344,6 +391,12 @@ std::array<double, 6> UI::checkETH_statistics_mat_elems(
 		_histAv.merge(_histAvLocal);
 		_histAvTypical.merge(_histAvTypicalLocal);
 
+		// merge the susceptibilities
+		if (_fidelity)
+			*_fidelity	+= _fidLocal;
+		if (_fidelityZ)
+			*_fidelityZ	+= _fidZLocal;
+
 		// statistics
 		_statiter += _statiter_local;
 	}
@@ -374,48 +427,61 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 	isQuadratic				= true;
 	isManyBody				= true;
 
+	// distributed eigenvectors over the ranks (all the ranks go through the same realizations, the root saves)
+	const bool _distEig		= this->modP.eth_dist_ && DistEig::enabled && DistEig::size() > 1;
+	// the window of the eigenpairs around Tr(H)/Nh (the shift-invert solver) - the per state quantities are sized by _Nst
+	const uint _mid			= (_distEig || this->modP.eth_mid_ >= _Nh) ? 0 : this->modP.eth_mid_;
+	const u64 _Nst			= _mid > 0 ? _mid : _Nh;
+	if (_distEig && this->modP.eth_mid_ > 0)
+		LOGINFO("The window of the eigenpairs (eth_mid) is not available with the distributed diagonalization (eth_dist), using the full spectrum!", LOG_TYPES::WARNING, 1);
+	if (_mid > 0 && _mid < 4)
+	{
+		LOGINFO("The window of the eigenpairs (eth_mid) needs at least 4 of them for the gap ratios!", LOG_TYPES::ERROR, 1);
+		return;
+	}
+
 	// get the operators
 	v_1d<std::shared_ptr<Operators::Operator<double>>> _ops;
 	strVec _opsN;
 	std::tie(_ops, _opsN)			= this->ui_eth_getoperators(_Nh, isQuadratic, isManyBody);
 
 	// get info about the model
-	std::string modelInfo, dir 		= "ETH_MAT_STAT", randomStr, extension;
+	std::string modelInfo, dir 		= _mid > 0 ? "ETH_MAT_STAT_MID=" + STR(_mid) : "ETH_MAT_STAT", randomStr, extension;
 	this->get_inf_dir_ext_r(_H, dir, modelInfo, randomStr, extension);
 
 	// set the placeholder for the values to save (will save only the diagonal elements and other measures)
 	arma::Mat<double> _en, _entroHalf, _entroRHalf, _entroFirst, _entroRFirst, _entroLast, _entroRLast, _schmidFirst, _schmidLast;
 	if (this->modP.eth_entro_) {
-		_en				= UI_DEF_MAT_D(_Nh, this->modP.getRanReal());								// energies
-		_entroHalf		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=1
-		_entroRHalf		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=2
-		_entroFirst		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=1
-		_entroRFirst 	= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=2
-		_entroLast		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=1
-		_entroRLast		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=2
-		_schmidFirst	= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// schmid gap
-		_schmidLast		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);	// schmid gap
+		_en				= UI_DEF_MAT_D(_Nst, this->modP.getRanReal());								// energies
+		_entroHalf		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=1
+		_entroRHalf		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=2
+		_entroFirst		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=1
+		_entroRFirst 	= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=2
+		_entroLast		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=1
+		_entroRLast		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// Renyi entropy q=2
+		_schmidFirst	= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// schmid gap
+		_schmidLast		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);	// schmid gap
 	}
 
 	// information entropy and ipr
 	v_1d<double> _qs 	= { 0.1, 0.5, 1.0, 1.5, 2.0, 3.0 };
 	arma::Mat<double> _e_ipr01, _e_ipr05, _e_ipr1, _e_ipr15, _e_ipr2, _e_ipr3;
 	if (this->modP.eth_entro_) {
-		_e_ipr01		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);
-		_e_ipr05		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);
-		_e_ipr1 		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);
-		_e_ipr15 		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);
-		_e_ipr2 		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);
-		_e_ipr3 		= UI_DEF_MAT_D_COND(_Nh, this->modP.getRanReal(), this->modP.eth_entro_);
+		_e_ipr01		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);
+		_e_ipr05		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);
+		_e_ipr1 		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);
+		_e_ipr15 		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);
+		_e_ipr2 		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);
+		_e_ipr3 		= UI_DEF_MAT_D_COND(_Nst, this->modP.getRanReal(), this->modP.eth_entro_);
 	}
 
 	// gap ratios
-	v_1d<double> _gapsin(_Nh - 2, 0.0);
+	v_1d<double> _gapsin(_Nst - 2, 0.0);
 	arma::Col<double> _gaps, _meanEn, _meanEnIdx, _meanlvl, _bandwidth, _H2;
 	arma::Mat<double> _gapsall;
 	{
 		_gaps		= UI_DEF_COL_D(this->modP.getRanReal());
-		_gapsall	= UI_DEF_MAT_D(_Nh - 2, this->modP.getRanReal());
+		_gapsall	= UI_DEF_MAT_D(_Nst - 2, this->modP.getRanReal());
 		_meanEn		= UI_DEF_COL_D(this->modP.getRanReal());
 		_meanEnIdx	= UI_DEF_COL_D(this->modP.getRanReal());
 		_meanlvl	= UI_DEF_COL_D(this->modP.getRanReal());
@@ -424,16 +490,17 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 	}
 
 	// create the measurem_bandwidthent class
-	Measurement<double> _measure(this->latP.Ntot_, dir, _ops, _opsN, 1, _Nh);	
+	Measurement<double> _measure(this->latP.Ntot_, dir, _ops, _opsN, 1, 0);
+	_measure.setCacheKeys(Operators::OperatorNameParser(this->latP.Ntot_, _Nh).signatures(_opsN), _H->getHilbertSpace().getCacheKey(), _Nh);
 
 	// to save the operators (those elements will be stored for each operator separately)
 	// a given matrix element <n|O|n> will be stored in i'th column of the i'th operator
 	// the n'th row in the column will be the state index
 	// the columns corresponds to realizations of disorder
-	VMAT<_T> _diagElems 			= UI_DEF_VMAT(_T, _ops.size(), _Nh, this->modP.getRanReal());
+	VMAT<_T> _diagElems 			= UI_DEF_VMAT(_T, _ops.size(), _Nst, this->modP.getRanReal());
 	
-	// constraint the offdiagonals also to _Nh elements only
-	size_t _offdiagElemsSize 		= this->threadNum * _Nh;
+	// constraint the offdiagonals also to _Nst elements only
+	size_t _offdiagElemsSize 		= this->threadNum * _Nst;
 	VMAT<_T> _offdiagElems, _offdiagElemsLow;
 	arma::Mat<double> _offdiagElemsOmega, _offdiagElemsOmegaLow;
 	if (this->modP.eth_offd_)
@@ -445,20 +512,20 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 	}
 
 	// due to mobility edges, for the statistics we'll save two sets of data
-	u64 _hs_fractions_diag_stat 	= SystemProperties::hs_fraction_diagonal_cut(0.1, _Nh);
+	u64 _hs_fractions_diag_stat 	= SystemProperties::hs_fraction_diagonal_cut(0.1, _Nst);
 
 	// (mean, typical, mean2, typical2, mean4, meanabs, gaussianity, binder cumulant)
 	VMAT<double> _offdiagElemesStat	= UI_DEF_VMAT(double, _ops.size(), 8, this->modP.getRanReal());
 
 	// saves the histograms of the second moments for the offdiagonal elements -- those are the f-functions for the omega dependence
-	v_1d<HistogramAverage<double>> _histAv(_ops.size(), HistogramAverage<double>(1));
-	v_1d<HistogramAverage<double>> _histAvTypical(_ops.size(), HistogramAverage<double>(1));
+	v_1d<Accumulators::LogHistogram> _histAv(_ops.size(), Accumulators::LogHistogram(1));
+	v_1d<Accumulators::LogHistogram> _histAvTypical(_ops.size(), Accumulators::LogHistogram(1));
 
 	// histograms for other epsilons
-	v_2d<HistogramAverage<double>> _histAvEps(this->modP.eth_end_.size(), v_1d<HistogramAverage<double>>(_ops.size(), HistogramAverage<double>(1)));
-	v_2d<HistogramAverage<double>> _histAvTypicalEps(this->modP.eth_end_.size(), v_1d<HistogramAverage<double>>(_ops.size(), HistogramAverage<double>(1)));
-	auto _fidelitySusceptibility 	= UI_DEF_MAT_D_CONDT(_Nh, this->modP.getRanReal(), this->modP.eth_susc_, _T);
-	auto _fidelitySusceptibilityZ 	= UI_DEF_MAT_D_CONDT(_Nh, this->modP.getRanReal(), this->modP.eth_susc_, _T);
+	v_2d<Accumulators::LogHistogram> _histAvEps(this->modP.eth_end_.size(), v_1d<Accumulators::LogHistogram>(_ops.size(), Accumulators::LogHistogram(1)));
+	v_2d<Accumulators::LogHistogram> _histAvTypicalEps(this->modP.eth_end_.size(), v_1d<Accumulators::LogHistogram>(_ops.size(), Accumulators::LogHistogram(1)));
+	auto _fidelitySusceptibility 	= UI_DEF_MAT_D_CONDT(_Nst, this->modP.getRanReal(), this->modP.eth_susc_, _T);
+	auto _fidelitySusceptibilityZ 	= UI_DEF_MAT_D_CONDT(_Nst, this->modP.getRanReal(), this->modP.eth_susc_, _T);
 	
 	// ----------------------- nbins operators -----------------------
 	const size_t _nbinOperators = (size_t)(20 * std::log2(_Nh));
@@ -466,54 +533,131 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 	v_1d<Histogram> _histOperatorsOffdiag(_ops.size(), Histogram(_nbinOperators));
 
 	// create the saving function
+	// pipelined writer of the outputs (one open of each file per checkpoint)
+	UI_H5::Writer _writer;
+	// shards of the realizations (job arrays) - the files of each shard get its suffix. All the processes must build the same
+	// disorder and name the files alike, so the shards require the explicit seed and the tag follows from the model and the seed
+	const uint _shardSize	= _distEig ? 0 : this->modP.eth_shard_;
+	if (_shardSize > 0 && _shardSize < this->modP.getRanReal())
+	{
+		if (this->modP.modRanSeed_ == 0)
+		{
+			LOGINFO("The shards of the realizations (eth_shard) require the explicit seed (modRanSeed)!", LOG_TYPES::ERROR, 1);
+			return;
+		}
+		randomStr			= "_seed=" + STR(this->modP.modRanSeed_);
+	}
+	UI_REAL::Scheduler _real(dir, modelInfo + randomStr, this->modP.getRanReal(), _shardSize, this->modP.eth_lease_);
+	std::string _shardSfx;
+	// columnar container of the realizations (appended in place, see UI_H5::writeIndex) instead of the rewritten files
+	const bool _columnar	= this->modP.eth_col_;
+	const std::string _container = "eth" + randomStr;
+	v_1d<arma::uword> _colPending;
+	arma::uvec _colIdx;
+	bool _colAppend			= false;
+	std::string _colSfx		= "";
+	_writer.setCompression(this->modP.eth_comp_);
+
+	// the real scalars of the realizations, packed per file into a single (realizations x scalars) dataset of the container
+	std::map<std::string, std::pair<strVec, v_1d<arma::Row<double>>>> _colScalars;
+
+	// per realization outputs - the columns (realizations) done since the last checkpoint go to the container
+	auto _perReal = [&]<typename _MT>(const std::string& _file, const _MT& _M, const std::string& _key, bool _append)
+		{
+			if (!_columnar)
+			{
+				_writer.saveReal(dir, _file + randomStr + _shardSfx + extension, _M, _key, _append);
+				return;
+			}
+			if (_colIdx.n_elem == 0)
+				return;
+			using _E				= typename _MT::elem_type;
+			const arma::Mat<_E> _A(_M);
+			// the scalars of the realizations are the elements of the vectors
+			const bool _scalar		= _A.n_elem == this->modP.getRanReal() && (_A.n_cols == 1 || _A.n_rows == 1);
+			if constexpr (std::is_same_v<_E, double>)
+				if (_scalar)
+				{
+					auto& [_names, _rows] = _colScalars[_file];
+					_names.push_back(_key);
+					_rows.push_back(arma::Row<double>(arma::Col<double>(_A.elem(_colIdx)).t()));
+					return;
+				}
+			_writer.save(dir, _container + _shardSfx + ".h5", _scalar ? arma::Mat<_E>(arma::Col<_E>(_A.elem(_colIdx)).t()) : arma::Mat<_E>(_A.cols(_colIdx)), _file + "/" + _key, true, true);
+		};
+	auto _perRealScalars = [&]()
+		{
+			for (const auto& [_file, _set] : _colScalars)
+			{
+				arma::Mat<double> _P(_set.second.size(), _colIdx.n_elem);
+				for (size_t i = 0; i < _set.second.size(); ++i)
+					_P.row(i)		= _set.second[i];
+				_writer.savePacked(dir, _container + _shardSfx + ".h5", _P, _file + "/scalars", _set.first);
+			}
+			_colScalars.clear();
+		};
+
 	std::function<void(uint)> _saver = [&](uint _r)
 		{
-			saveAlgebraic(dir, "stat" + randomStr + extension, _gaps, "gap_ratio", false);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _gapsall, "gap_ratios", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _meanEn, "mean_energy", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _meanEnIdx, "mean_energy_index", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _meanlvl, "mean_level_spacing", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _bandwidth, "bandwidth", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _H2, "H2", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _en, "energy", true);
+			if (_distEig && !DistEig::root())
+				return;
+			_colIdx					= arma::uvec(_colPending);
+			_colPending.clear();
+			if (_columnar && _colIdx.n_elem > 0)
+			{
+				// each shard has its own container, created anew when the shard (re)starts
+				if (_colSfx != _shardSfx)
+					_colAppend		= false;
+				_colSfx				= _shardSfx;
+				_writer.save(dir, _container + _shardSfx + ".h5", arma::Mat<double>(arma::conv_to<arma::rowvec>::from(_colIdx)), "realizations", _colAppend, true);
+				_colAppend			= true;
+			}
+			_perReal("stat", _gaps, "gap_ratio", false);
+			_perReal("stat", _gapsall, "gap_ratios", true);
+			_perReal("stat", _meanEn, "mean_energy", true);
+			_perReal("stat", _meanEnIdx, "mean_energy_index", true);
+			_perReal("stat", _meanlvl, "mean_level_spacing", true);
+			_perReal("stat", _bandwidth, "bandwidth", true);
+			_perReal("stat", _H2, "H2", true);
+			_perReal("stat", _en, "energy", true);
 
 			// entanglement entropies
 			if (this->modP.eth_entro_)
 			{	
-				saveAlgebraic(dir, "entro" + randomStr + extension, _entroHalf, "vN/half", false);
-				saveAlgebraic(dir, "entro" + randomStr + extension, _entroFirst, "vN/first", true);
-				saveAlgebraic(dir, "entro" + randomStr + extension, _entroLast, "vN/last", true);
+				_perReal("entro", _entroHalf, "vN/half", false);
+				_perReal("entro", _entroFirst, "vN/first", true);
+				_perReal("entro", _entroLast, "vN/last", true);
 				// save the Renyi entropies
-				saveAlgebraic(dir, "entro" + randomStr + extension, _entroRFirst, "renyi/2.0/first", true);
-				saveAlgebraic(dir, "entro" + randomStr + extension, _entroRHalf, "renyi/2.0/half", true);
-				saveAlgebraic(dir, "entro" + randomStr + extension, _entroRLast, "renyi/2.0/last", true);
+				_perReal("entro", _entroRFirst, "renyi/2.0/first", true);
+				_perReal("entro", _entroRHalf, "renyi/2.0/half", true);
+				_perReal("entro", _entroRLast, "renyi/2.0/last", true);
 
 				// schmid gaps
-				saveAlgebraic(dir, "entro" + randomStr + extension, _schmidFirst, "schmid/first", true);
-				saveAlgebraic(dir, "entro" + randomStr + extension, _schmidLast, "schmid/last", true);
+				_perReal("entro", _schmidFirst, "schmid/first", true);
+				_perReal("entro", _schmidLast, "schmid/last", true);
 			}
 
 			// fidelity susceptibility
 			if (this->modP.eth_susc_)
 			{
-				saveAlgebraic(dir, "stat" + randomStr + extension, _fidelitySusceptibility, "fidelity_susceptibility", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _fidelitySusceptibilityZ, "fidelity_susceptibility_0", true);
+				_perReal("stat", _fidelitySusceptibility, "fidelity_susceptibility", true);
+				_perReal("stat", _fidelitySusceptibilityZ, "fidelity_susceptibility_0", true);
 			}			
 
 			// iprs
 			if (this->modP.eth_ipr_) {
-				saveAlgebraic(dir, "ipr" + randomStr + extension, _e_ipr01, "info/0.1", false);
-				saveAlgebraic(dir, "ipr" + randomStr + extension, _e_ipr05, "info/0.5", true);
-				saveAlgebraic(dir, "ipr" + randomStr + extension, _e_ipr1,  "info/1.0", true);
-				saveAlgebraic(dir, "ipr" + randomStr + extension, _e_ipr15, "info/1.5", true);
-				saveAlgebraic(dir, "ipr" + randomStr + extension, _e_ipr2,  "info/2.0", true);
-				saveAlgebraic(dir, "ipr" + randomStr + extension, _e_ipr3,  "info/3.0", true);
+				_perReal("ipr", _e_ipr01, "info/0.1", false);
+				_perReal("ipr", _e_ipr05, "info/0.5", true);
+				_perReal("ipr", _e_ipr1,  "info/1.0", true);
+				_perReal("ipr", _e_ipr15, "info/1.5", true);
+				_perReal("ipr", _e_ipr2,  "info/2.0", true);
+				_perReal("ipr", _e_ipr3,  "info/3.0", true);
 			}
 
 			// diagonal operators saved (only append when _opi > 0)
 			for (uint _opi = 0; _opi < _ops.size(); ++_opi) {
 				auto _name = _measure.getOpGN(_opi);
-				saveAlgebraic(dir, "diag" + randomStr + extension, algebra::cast<double>(_diagElems[_opi]), _name, _opi > 0);
+				_perReal("diag", algebra::cast<double>(_diagElems[_opi]), _name, _opi > 0);
 			}
 
 			// offdiagonal operators saved (only append when _opi > 0)
@@ -521,48 +665,49 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 				for (uint _opi = 0; _opi < _ops.size(); ++_opi)
 				{
 					auto _name = _measure.getOpGN(_opi);
-					saveAlgebraic(dir, "offdiag" + randomStr + extension, algebra::cast<double>(_offdiagElems[_opi]), _name, _opi > 0);
-					saveAlgebraic(dir, "offdiag_low" + randomStr + extension, algebra::cast<double>(_offdiagElemsLow[_opi]), _name, _opi > 0);
+					_perReal("offdiag", algebra::cast<double>(_offdiagElems[_opi]), _name, _opi > 0);
+					_perReal("offdiag_low", algebra::cast<double>(_offdiagElemsLow[_opi]), _name, _opi > 0);
 				}
-				saveAlgebraic(dir, "offdiag" + randomStr + extension, _offdiagElemsOmega, "omega", true);
-				saveAlgebraic(dir, "offdiag_low" + randomStr + extension, _offdiagElemsOmegaLow, "omega", true);
+				_perReal("offdiag", _offdiagElemsOmega, "omega", true);
+				_perReal("offdiag_low", _offdiagElemsOmegaLow, "omega", true);
 			}
 
 			// save the statistics
 			for (uint _opi = 0; _opi < _ops.size(); ++_opi) {
 				auto _name = _measure.getOpGN(_opi);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(0), "operators/" + _measure.getOpGN(_opi) + "/mean", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(1), "operators/" + _measure.getOpGN(_opi) + "/typical", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(2), "operators/" + _measure.getOpGN(_opi) + "/mean2", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(3), "operators/" + _measure.getOpGN(_opi) + "/typical2", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(4), "operators/" + _measure.getOpGN(_opi) + "/mean4", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(5), "operators/" + _measure.getOpGN(_opi) + "/meanabs", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(6), "operators/" + _measure.getOpGN(_opi) + "/gaussianity", true);
-				saveAlgebraic(dir, "stat" + randomStr + extension, _offdiagElemesStat[_opi].row(7), "operators/" + _measure.getOpGN(_opi) + "/binder_cumulant", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(0), "operators/" + _measure.getOpGN(_opi) + "/mean", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(1), "operators/" + _measure.getOpGN(_opi) + "/typical", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(2), "operators/" + _measure.getOpGN(_opi) + "/mean2", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(3), "operators/" + _measure.getOpGN(_opi) + "/typical2", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(4), "operators/" + _measure.getOpGN(_opi) + "/mean4", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(5), "operators/" + _measure.getOpGN(_opi) + "/meanabs", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(6), "operators/" + _measure.getOpGN(_opi) + "/gaussianity", true);
+				_perReal("stat", _offdiagElemesStat[_opi].row(7), "operators/" + _measure.getOpGN(_opi) + "/binder_cumulant", true);
 			}
+			_perRealScalars();
 
 			// save the histograms of the operators for the f functions
-			saveAlgebraic(dir, "hist" + randomStr + extension, _histAv[0].edgesCol(), "omegas", false);
+			_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAv[0].edgesCol(), "omegas", false);
 			if (this->modP.eth_susc_) {
 				for (uint _epi = 0; _epi < _histAvEps.size(); ++_epi)
 				{
 					auto e = this->modP.eth_end_[_epi];
-					saveAlgebraic(dir, "hist" + randomStr + extension, _histAvEps[_epi][0].edgesCol(), VEQP(e, 3) + "/omegas", true);
+					_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAvEps[_epi][0].edgesCol(), VEQP(e, 3) + "/omegas", true);
 				}
 			}
 
 			for (uint _opi = 0; _opi < _ops.size(); ++_opi) {
 				auto _name = _measure.getOpGN(_opi);
-				saveAlgebraic(dir, "hist" + randomStr + extension, _histAv[_opi].averages_av(), _name + "_mean", true);
-				saveAlgebraic(dir, "hist" + randomStr + extension, _histAvTypical[_opi].averages_av(true), _name + "_typical", true);
+				_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAv[_opi].averages_av(), _name + "_mean", true);
+				_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAvTypical[_opi].averages_av(true), _name + "_typical", true);
 
 				if (_histAvEps.size() > 0)
 				{
 					for (uint _epi = 0; _epi < _histAvEps.size(); ++_epi)
 					{
 						auto e = this->modP.eth_end_[_epi];
-						saveAlgebraic(dir, "hist" + randomStr + extension, _histAvEps[_epi][_opi].averages_av(), VEQP(e, 3) + "/" + _name + "_mean", true);
-						saveAlgebraic(dir, "hist" + randomStr + extension, _histAvTypicalEps[_epi][_opi].averages_av(true), VEQP(e, 3) + "/" + _name + "_typ", true);
+						_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAvEps[_epi][_opi].averages_av(), VEQP(e, 3) + "/" + _name + "_mean", true);
+						_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAvTypicalEps[_epi][_opi].averages_av(true), VEQP(e, 3) + "/" + _name + "_typ", true);
 					}
 				}
 			}
@@ -571,26 +716,42 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 				for (uint _epi = 0; _epi < _histAvEps.size(); ++_epi)
 				{
 					auto e = this->modP.eth_end_[_epi];
-					saveAlgebraic(dir, "hist" + randomStr + extension, _histAvEps[_epi][0].edgesCol(), VEQP(e, 3) + "/_counts", true);
+					_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAvEps[_epi][0].edgesCol(), VEQP(e, 3) + "/_counts", true);
 				}
 			}
-			saveAlgebraic(dir, "hist" + randomStr + extension, _histAv[0].countsCol(), "_counts", true);
+			_writer.save(dir, "hist" + randomStr + _shardSfx + extension, _histAv[0].countsCol(), "_counts", true);
 
 			// save the distributions of the operators - histograms for the values
 			for (uint _opi = 0; _opi < _ops.size(); ++_opi) {
 				const auto _name = _measure.getOpGN(_opi);
-				saveAlgebraic(dir, "dist" + randomStr + extension, _histOperatorsDiag[_opi].edgesCol(), _name + "_diag_edges", _opi > 0);
-				saveAlgebraic(dir, "dist" + randomStr + extension, _histOperatorsOffdiag[_opi].edgesCol(), _name + "_offdiag_edges", true);
-				saveAlgebraic(dir, "dist" + randomStr + extension, _histOperatorsDiag[_opi].countsCol(), _name + "_diag_counts", true);
-				saveAlgebraic(dir, "dist" + randomStr + extension, _histOperatorsOffdiag[_opi].countsCol(), _name + "_offdiag_counts", true);
+				_writer.save(dir, "dist" + randomStr + _shardSfx + extension, _histOperatorsDiag[_opi].edgesCol(), _name + "_diag_edges", _opi > 0);
+				_writer.save(dir, "dist" + randomStr + _shardSfx + extension, _histOperatorsOffdiag[_opi].edgesCol(), _name + "_offdiag_edges", true);
+				_writer.save(dir, "dist" + randomStr + _shardSfx + extension, _histOperatorsDiag[_opi].countsCol(), _name + "_diag_counts", true);
+				_writer.save(dir, "dist" + randomStr + _shardSfx + extension, _histOperatorsOffdiag[_opi].countsCol(), _name + "_offdiag_counts", true);
 			}
 
 			LOGINFO("Checkpoint:" + STR(_r), LOG_TYPES::TRACE, 4);
+
+			// pass the stage to the I/O thread (the next realization runs meanwhile)
+			_writer.commit();
 		};
 
 	// ---------------------------------------------------------------
+
+	// the disorder only changes the values - the nonzero pattern of the first realization is reused (verified on each build)
+	_H->setReuseStructure(true);
+	_H->setDistributedDiag(_distEig);
+	if (_distEig)
+	{
+		// all the ranks must build the same disorder - the seed of the root (explicit or drawn) is shared
+		u64 _seed			= _H->ranStream().seed();
+		DistEig::bcast(&_seed, 1);
+		_H->setSeed(_seed);
+		LOGINFO("Distributed eigenvectors over " + STR(DistEig::size()) + " ranks, the off-diagonal statistics are skipped", LOG_TYPES::INFO, 2);
+	}
+
 	// go through realizations
-	for (int _r = 0; _r < this->modP.getRanReal(); ++_r)
+	for (int _r = _real.start(_shardSfx); _r >= 0; _r = _real.next(_r, _shardSfx, [&](uint _rEnd) { _saver(_rEnd); _writer.flush(); }))
 	{
 		// ----------------------------------------------------------------------------
 		
@@ -602,7 +763,10 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 				_timer.checkpoint(STR(_r));
 			}
 
-			this->ui_eth_randomize(_H);
+			// the shards start anywhere - the engine of the disorder depends on the seed and the realization only
+			if (_real.sharded())
+				_H->ran_.newSeed(this->modP.modRanSeed_ ^ (0x9E3779B97F4A7C15ULL * (u64)(_r + 1)));
+			this->ui_eth_randomize(_H, _r, 0, true, _mid);
 			LOGINFO(_timer.point(STR(_r)), "Diagonalization", 1);
 
 			// check the image of the Hamiltonian
@@ -640,7 +804,7 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 
 				// get the average energy index and the points around it on the diagonal
 				u64 _minIdxDiag_cut			= 0;
-				u64 _maxIdxDiag_cut			= _Nh;
+				u64 _maxIdxDiag_cut			= _Nst;
 
 				// set
 				std::tie(_minIdxDiag_cut, _maxIdxDiag_cut) = _H->getEnArndAvIdx(_hs_fractions_diag_stat / 2, _hs_fractions_diag_stat / 2);
@@ -672,9 +836,35 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 				// -----------------------------------------------------------------------------
 				
 				// ipr etc.
+#ifdef HAMIL_USE_SCALAPACK
+				if (_H->isEigVecDistributed())
+				{
+					// sums over the local blocks of the eigenvectors, reduced over the ranks (collective)
+					const auto& _V		= *_H->getEigVecDist();
+					auto _pe			= [&](double _q) -> arma::Col<double>
+						{
+							return arma::log(_V.colReduce([_q](const _T& _c)
+								{
+									const double _p = std::abs(algebra::conjugate(_c) * _c);
+									return _p > SYSTEM_PROPERTIES_COEFF_THRESHOLD ? std::pow(_p, _q) : 0.0;
+								})) / (1.0 - _q);
+						};
+					_e_ipr01.col(_r)	= _pe(0.1);
+					_e_ipr05.col(_r)	= _pe(0.5);
+					_e_ipr1.col(_r)		= _V.colReduce([](const _T& _c)
+						{
+							const double _p = std::abs(algebra::conjugate(_c) * _c);
+							return _p > SYSTEM_PROPERTIES_COEFF_THRESHOLD ? -_p * std::log(_p) : 0.0;
+						});
+					_e_ipr15.col(_r)	= _pe(1.5);
+					_e_ipr2.col(_r)		= _pe(2.0);
+					_e_ipr3.col(_r)		= _pe(3.0);
+				}
+				else
+#endif
 				{
 					#pragma omp parallel for num_threads(this->threadNum)
-					for(size_t _idx = 0; _idx < _Nh; ++_idx)
+					for(size_t _idx = 0; _idx < _Nst; ++_idx)
 					{
 						// get the entanglement
 						const arma::Col<_T> _st = _H->getEigVec(_idx);
@@ -716,9 +906,9 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 		// -----------------------------------------------------------------------------
 
 		// set the uniform distribution of frequencies in logspace for the f-functions!!!
-		if (_r == 0)
+		if (_r == (int)_real.begin())
 		{
-			double _bwIn 		= _bandwidth(0);
+			double _bwIn 		= _bandwidth(_r);
 			if (modP.modTyp_ == MY_MODELS::ULTRAMETRIC_M)
 				_bwIn			= Ultrametric_types::UM_default::getBandwidth(std::reinterpret_pointer_cast<Ultrametric<_T>>(_H)->get_alpha(), (int)std::log2(_Nh));
 			else if (modP.modTyp_ == MY_MODELS::QSM_M)
@@ -769,88 +959,113 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 		if (this->modP.eth_entro_ && _Ns < 20) {
 			v_1d<int> _sites   = { 0 };
 			uint _lastSiteMask = Binary::prepareMask<int, v_1d<int>, false>(_sites, _Ns - 1);
-#ifndef _DEBUG
-#pragma omp parallel for num_threads(this->threadNum)
-#endif				
-			for(size_t _idx = 0; _idx < _Nh; ++_idx) {
-				// get the entanglement
-				const auto _state		= _H->getEigVecCol(_idx);
 
-				// half of the system
+			// half of the system, first site and last site - all eigenstates in a single pass
+			Entropy::Entanglement::Bipartite::Batched::Result _ent;
+			if (_H->isEigVecDistributed() || _H->isEigVecStreamed())
+			{
+				// the blocks of the states gathered from the ranks or paged in from the store (the full matrix is never held)
+				for (u64 _j0 = 0; _j0 < _Nst; _j0 += EIGVEC_STORE_BLOCK)
 				{
-					auto _rho_v = DensityMatrix::Values::redDensMat_v(_state, uint(_Ns / 2), uint(_Ns));
-					// calculate the von Neumann entropy
-					_entroHalf(_idx, _r) 	= Entropy::Entanglement::Bipartite::vonNeuman(_rho_v);
-					_entroRHalf(_idx, _r) 	= Entropy::Entanglement::Bipartite::Renyi::renyi(_rho_v, 2.0);
+					const u64 _n	= std::min<u64>(EIGVEC_STORE_BLOCK, _Nst - _j0);
+					const u64 _j1	= _j0 + _n - 1;
+					Entropy::Entanglement::Bipartite::Batched::entropies(_H->getEigVecBlock(_j0, _n), uint(_Ns), { ULLPOW(_Ns / 2) - 1, 1ULL, (u64)_lastSiteMask }, { 2.0 }, _ent, this->threadNum);
+					_entroHalf.col(_r).subvec(_j0, _j1)		= _ent.vn_.col(0);
+					_entroRHalf.col(_r).subvec(_j0, _j1)	= _ent.renyi_[0].col(0);
+					_entroLast.col(_r).subvec(_j0, _j1)		= _ent.vn_.col(1);
+					_entroRLast.col(_r).subvec(_j0, _j1)	= _ent.renyi_[0].col(1);
+					_schmidLast.col(_r).subvec(_j0, _j1)	= _ent.gap_.col(1);
+					_entroFirst.col(_r).subvec(_j0, _j1)	= _ent.vn_.col(2);
+					_entroRFirst.col(_r).subvec(_j0, _j1)	= _ent.renyi_[0].col(2);
+					_schmidFirst.col(_r).subvec(_j0, _j1)	= _ent.gap_.col(2);
 				}
+			}
+			else
+			{
+				Entropy::Entanglement::Bipartite::Batched::entropies(_H->getEigVec(), uint(_Ns), { ULLPOW(_Ns / 2) - 1, 1ULL, (u64)_lastSiteMask }, { 2.0 }, _ent, this->threadNum);
+				_entroHalf.col(_r)		= _ent.vn_.col(0);
+				_entroRHalf.col(_r)		= _ent.renyi_[0].col(0);
+				_entroLast.col(_r)		= _ent.vn_.col(1);
+				_entroRLast.col(_r)		= _ent.renyi_[0].col(1);
+				_schmidLast.col(_r)		= _ent.gap_.col(1);
+				_entroFirst.col(_r)		= _ent.vn_.col(2);
+				_entroRFirst.col(_r)	= _ent.renyi_[0].col(2);
+				_schmidFirst.col(_r)	= _ent.gap_.col(2);
+			}
+		}
 
-				// first site
-				{
-					auto _rho_v 			= DensityMatrix::Values::redDensMat_v(_state, 1, uint(_Ns));
-					// calculate the von Neumann entropy
-					_entroLast(_idx, _r) 	= Entropy::Entanglement::Bipartite::vonNeuman(_rho_v);
-					_entroRLast(_idx, _r) 	= Entropy::Entanglement::Bipartite::Renyi::renyi(_rho_v, 2.0);
-
-					// schmid gap
-					_schmidLast(_idx, _r)	= _rho_v(0) - _rho_v(1);
-				}
+		// -----------------------------------------------------------------------------
 
-				// last site 
+#ifdef HAMIL_USE_SCALAPACK
+		// diagonal elements in the distributed eigenbasis (the off-diagonal statistics need the dense overlaps of a single node)
+		if (_H->isEigVecDistributed())
+		{
+			BEGIN_CATCH_HANDLER
+			{
+				const auto& _matrices	= _measure.getOpG_mat();
+				const auto& _V			= *_H->getEigVecDist();
+				for (int _opi = 0; _opi < _matrices.size(); _opi++)
 				{
-					auto _rho_v 			= DensityMatrix::Values::redDensMat_v(_state, 
-																				1, 
-																				uint(_Ns),
-																				_lastSiteMask,
-																				Entropy::Entanglement::Bipartite::RHO_METHODS::SCHMIDT,
-																				2);
-					// calculate the von Neumann entropy
-					_entroFirst(_idx, _r) 	= Entropy::Entanglement::Bipartite::vonNeuman(_rho_v);
-					_entroRFirst(_idx, _r) 	= Entropy::Entanglement::Bipartite::Renyi::renyi(_rho_v, 2.0);
-
-					// schmid gap
-					_schmidFirst(_idx, _r)	= _rho_v(0) - _rho_v(1);
+					LOGINFO("Doing operator (distributed): " + _opsN[_opi], LOG_TYPES::TRACE, 2);
+					_diagElems[_opi].col(_r) = _matrices[_opi]->isSparse() ? _V.transformDiag(_matrices[_opi]->getSparse()) : _V.transformDiag(_matrices[_opi]->getDense());
+					_histOperatorsDiag[_opi].setHistogramCounts(_diagElems[_opi].col(_r), _r == (int)_real.begin());
 				}
 			}
+			END_CATCH_HANDLER("Operators (distributed) failed:", break;)
 		}
+#endif
 
-		// -----------------------------------------------------------------------------
-
-		// calculator of the properties
+		// calculator of the properties (the dense overlaps on a single node)
+		if (!_H->isEigVecDistributed())
 		{
 			// all elements together
 			BEGIN_CATCH_HANDLER
 			{
 				// get matrices
 				const auto& _matrices	= _measure.getOpG_mat();
-				const auto& _eigVec		= _H->getEigVec();
+				// the dense overlaps of all the states need the full eigenbasis (as large as each of the overlap matrices)
+				const auto& _eigVec		= _H->loadEigVec();
 				const auto& _eigVal 	= _H->getEigVal();
 				const double _avEn		= _H->getEnAv();
 				const double _bw		= _bandwidth(_r);
 
 				// go through the operators
 #ifndef _DEBUG
-#pragma omp parallel for num_threads(check_multithread_operator(_Nh) ? this->threadNum : 1)
+#pragma omp parallel for num_threads(check_multithread_operator(_Nst) ? this->threadNum : 1)
 #endif
 				for (int _opi = 0; _opi < _matrices.size(); _opi++)
 				{
 					LOGINFO("Doing operator: " + _opsN[_opi], LOG_TYPES::TRACE, 2);
-					arma::Mat<_T> _overlaps = Operators::applyOverlapMat(_eigVec, _matrices[_opi]);
+					// each operator is read once per realization - the overlaps are freed at the end of the iteration
+					const arma::Mat<_T> _overlaps	= Operators::applyOverlapMat(_eigVec, *_matrices[_opi]);
 					std::atomic<size_t> _totalIteratorIn(0);
 
+					// fidelity susceptibilities - accumulated in the same pass over the elements
+					arma::Col<double> _fidelityIn, _fidelityZIn;
+					if (this->modP.eth_susc_)
+					{
+						_fidelityIn.zeros(_Nst);
+						_fidelityZIn.zeros(_Nst);
+					}
+
 					// get histograms
 					{
-						v_1d<std::array<double, 6>> _out = Threading::createFutures<UI, std::array<double, 6>>(this, _totalIteratorIn, this->threadNum, 
-																	!check_multithread_operator(_Nh) && this->threadNum != 1, 
+						v_1d<Accumulators::ElementMoments> _out = Threading::createFutures<UI, Accumulators::ElementMoments>(this, _totalIteratorIn, this->threadNum, 
+																	!check_multithread_operator(_Nst) && this->threadNum != 1, 
 																	_offdiagElemsSize, &UI::checkETH_statistics_mat_elems<_T>, 
-																	_Nh, _H.get(),
+																	_Nst, _H.get(),
 																	std::ref(_overlaps), std::ref(_histAv[_opi]), std::ref(_histAvTypical[_opi]),
 																	&_offdiagElemsOmega, &_offdiagElemsOmegaLow,
 																	&_offdiagElems, &_offdiagElemsLow,
 																	&_offdiagElemesStat,
-																	_bw, _avEn, _opi, _r);
-						for (auto& _o : _out)
-							for (int i = 0; i < 6; ++i)
-								_offdiagElemesStat.add(_opi, i, _r, _o[i]);
+																	this->modP.eth_susc_ ? &_fidelityIn : nullptr, this->modP.eth_susc_ ? &_fidelityZIn : nullptr,
+																	_bw, _avEn, std::log2(_Nh) / _Nh, _opi, _r);
+						Accumulators::ElementMoments _moments;
+						for (const auto& _o : _out)
+							_moments.merge(_o);
+						const auto _means = _moments.means();
+						for (int i = 0; i < 6; ++i)
+							_offdiagElemesStat.set(_opi, i, _r, _means[i]);
 					}
 
 					// get histograms for the epsilons
@@ -862,15 +1077,16 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 							auto _energyIn = _eigVal(0) + this->modP.eth_end_[_epi] * _bw;
 							LOGINFO("Doing epsilon = " + STR(this->modP.eth_end_[_epi]) + " at " + VEQP(_energyIn, 3), LOG_TYPES::TRACE, 3);
 
-							v_1d<std::array<double, 6>> _out = Threading::createFutures<UI, std::array<double, 6>>(this, _totalIteratorIn2, this->threadNum, 
-																	(!check_multithread_operator(_Nh) && this->threadNum != 1), 
+							v_1d<Accumulators::ElementMoments> _out = Threading::createFutures<UI, Accumulators::ElementMoments>(this, _totalIteratorIn2, this->threadNum, 
+																	(!check_multithread_operator(_Nst) && this->threadNum != 1), 
 																	_offdiagElemsSize, &UI::checkETH_statistics_mat_elems<_T>, 
-																	_Nh, _H.get(),
+																	_Nst, _H.get(),
 																	std::ref(_overlaps), std::ref(_histAvEps[_epi][_opi]), std::ref(_histAvTypicalEps[_epi][_opi]),
 																	nullptr, nullptr,
 																	nullptr, nullptr,
 																	nullptr,
-																	_bw, _energyIn, _opi, _r);
+																	nullptr, nullptr,
+																	_bw, _energyIn, 0.0, _opi, _r);
 						}
 					}
 
@@ -880,10 +1096,8 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 					// fidelity susceptability
 					if (this->modP.eth_susc_)
 					{
-						auto _fidelitySusceptibilityIn = _fidelitySusceptibility.col(_r);
-						SystemProperties::AGP::fidelity_susceptability_tot(_eigVal, _overlaps, std::log2(_Nh) / _Nh, _fidelitySusceptibilityIn);
-						auto _fidelitySusceptibilityZIn = _fidelitySusceptibilityZ.col(_r);
-						SystemProperties::AGP::fidelity_susceptability_tot(_eigVal, _overlaps, 0.0, _fidelitySusceptibilityZIn);
+						_fidelitySusceptibility.col(_r)		= arma::conv_to<arma::Col<_T>>::from(_fidelityIn);
+						_fidelitySusceptibilityZ.col(_r)	= arma::conv_to<arma::Col<_T>>::from(_fidelityZIn);
 					}
 
 					// ############## finalize statistics ##############
@@ -893,9 +1107,6 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 					{
 
 						{
-							for (uint ii = 0; ii < 6; ii++)
-								_offdiagElemesStat.divide(_opi, ii, _r, (long double)_totalIteratorIn);
-
 							// statistics
 							_offdiagElemesStat.set(_opi, 6, _r, StatisticalMeasures::gaussianity(_offdiagElemesStat.get(_opi, 5, _r), _offdiagElemesStat.get(_opi, 2, _r)));
 							_offdiagElemesStat.set(_opi, 7, _r, StatisticalMeasures::binder_cumulant(_offdiagElemesStat.get(_opi, 2, _r), _offdiagElemesStat.get(_opi, 4, _r)));
@@ -914,15 +1125,15 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 					_diagElems[_opi].col(_r) = _overlaps.diag().as_col();
 
 					// save the histograms of the diagonals and offdiagonals!
-					_histOperatorsDiag[_opi].setHistogramCounts(_diagElems[_opi].col(_r), _r == 0);
-					_histOperatorsOffdiag[_opi].setHistogramCounts(_offdiagElems[_opi].col(_r), _r == 0);
-
+					_histOperatorsDiag[_opi].setHistogramCounts(_diagElems[_opi].col(_r), _r == (int)_real.begin());
+					_histOperatorsOffdiag[_opi].setHistogramCounts(_offdiagElems[_opi].col(_r), _r == (int)_real.begin());
 				}
 			}
 			END_CATCH_HANDLER("Operators failed:", break;)
 		}
 
 		// save the checkpoints
+		_colPending.push_back(_r);
 		if (check_saving_size(_Nh, _r))
 			_saver(_r);
 
@@ -931,8 +1142,14 @@ void UI::checkETH_statistics(std::shared_ptr<Hamiltonian<_T>> _H)
 		// -----------------------------------------------------------------------------
 	}
 
-	// save the diagonals
-	_saver(this->modP.getRanReal());
+	// save the diagonals (the shards are written on completion and merged by the last process)
+	if (!_real.sharded())
+		_saver(this->modP.getRanReal());
+	_writer.flush();
+	if (const size_t _failed = _writer.failures(); _failed > 0)
+		LOGINFO("Failed to write " + STR(_failed) + " files in " + dir + " - the results are incomplete.", LOG_TYPES::ERROR, 0);
+	if (_real.sharded())
+		_real.merge({ "stat" + randomStr, "entro" + randomStr, "ipr" + randomStr, "diag" + randomStr, "offdiag" + randomStr, "offdiag_low" + randomStr, "hist" + randomStr, "dist" + randomStr }, extension);
 
 	// bye
 	LOGINFO(_timer.start(), "ETH CALCULATOR", 0);
@@ -966,15 +1183,20 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 	this->get_inf_dir_ext_r(_H, dir, modelInfo, randomStr, extension);
 
 	// create the measurement class
-	Measurement<double> _measure(this->latP.Ntot_, dir, _ops, _opsN, 1, _Nh);
+	Measurement<double> _measure(this->latP.Ntot_, dir, _ops, _opsN, 1, 0);
+	_measure.setCacheKeys(Operators::OperatorNameParser(this->latP.Ntot_, _Nh).signatures(_opsN), _H->getHilbertSpace().getCacheKey(), _Nh);
 
 	// set the placeholder for the values to save (will save only the diagonal elements and other measures)
 	arma::Mat<double> _meanlvl 			= UI_DEF_MAT_D(4, this->modP.getRanReal());
 	u64 _hs_fractions_diag				= SystemProperties::hs_fraction_diagonal_cut(0.5, _Nh);
 
+	// evolve with the sparse Chebyshev propagator instead of the full diagonalization (no spectral quantities then)
+	const bool _usePropagator			= this->modP.eth_prop_ || _Nh > UI_LIMITS_MAXFULLED;
+
 	// time evolution saved here
 	long double _heisenberg_time_est	= _Nh;
-	arma::Col<double> _timespace		= arma::logspace(-2, std::log10(_heisenberg_time_est * 1000), 5000);
+	const double _tmax					= _usePropagator ? std::min<double>(_heisenberg_time_est * 1000, UI_LIMITS_TIME_EVO_PROP_TMAX) : _heisenberg_time_est * 1000;
+	arma::Col<double> _timespace		= arma::logspace(-2, std::log10(_tmax), 5000);
 	// create initial states for the quench
 	arma::Col<_T> _initial_state_me		= arma::Col<_T>(_Nh, arma::fill::zeros);
 
@@ -1047,6 +1269,36 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 			}
 		};
 
+	// ----------------------------- STATE MEASURES -----------------------------
+
+	// masks of the subsystems for the batched entropies (single sites and the half of the system)
+	v_1d<u64> _entropiesMasks;
+	for (const auto i: _entropiesSites)
+		_entropiesMasks.push_back(1ULL << (i - 1));
+	if (_Nh <= UI_LIMITS_MAXFULLED / 4)
+		_entropiesMasks.push_back(ULLPOW((int(_Ns / 2))) - 1);
+
+	auto _stateMeasures = [&](uint _r, int _ti, const arma::Col<std::complex<double>>& _st)
+		{
+			// calculate the entanglement entropy for each site
+			{
+				//for (int i = 1; i <= _Ns; i++)
+				auto _iter = 0;
+				for (const auto i: _entropiesSites)
+				{
+					// calculate the entanglement entropy
+					uint _maskA							= 1 << (i - 1);
+					_timeEntropyME[_iter++](_ti, _r)	= Entropy::Entanglement::Bipartite::vonNeuman<cpx>(_st, 1, _Ns, _maskA, DensityMatrix::RHO_METHODS::SCHMIDT, 2);
+				}
+				if(_Nh <= UI_LIMITS_MAXFULLED / 4)
+					_timeEntropyBipartiteME(_ti, _r)	= Entropy::Entanglement::Bipartite::vonNeuman<cpx>(_st, int(_Ns / 2), _Ns, (ULLPOW((int(_Ns / 2)))) - 1);
+			}
+			// calculate the participation entropy
+			{
+				_timePEntro(_ti, _r)					= SystemProperties::information_entropy(_st);
+			}
+		};
+
 	// ----------------------------- EVOLVE STATE -------------------------------
 
 	auto _evolveState = [&](uint _r, 
@@ -1058,11 +1310,12 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 							arma::Mat<double>& _diagvals,
 							VMAT<_T>& _timeEvolution,
 							v_1d<arma::Col<_T>>& _timeZero,
-							const v_1d<GeneralizedMatrix<double>>& _matrices)
+							const v_1d<std::shared_ptr<const GeneralizedMatrix<double>>>& _matrices,
+							Operators::OverlapCache<_T>& _eigMatrices)
 		{
 			// calculate the overlaps of the initial state with the eigenvectors 
 			// (states are columns and vector is column as well, so we need to have the transpose)
-			const auto& _eigvecs				= _H->getEigVec();
+			const auto& _eigvecs				= _H->loadEigVec();
 			const auto& _eigvals				= _H->getEigVal();
 			const arma::Col<_T> _overlaps		= _eigvecs.t() * _initial_state;
 			const arma::Col<double> _soverlaps	= arma::square(arma::abs(_overlaps));
@@ -1102,81 +1355,161 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 			
 			// save zero time value
 			{
+				Sched::BlasStage _blas(1);
 #pragma omp parallel for num_threads(this->threadNum)
 				for (uint _opi = 0; _opi < _ops.size(); ++_opi)
-					_timeZero[_opi](_r) = arma::as_scalar(arma::cdot(_initial_state, (_matrices[_opi] * _initial_state)));
+					_timeZero[_opi](_r) = arma::as_scalar(arma::cdot(_initial_state, (*_matrices[_opi] * _initial_state)));
 			}
 
-			// evolution
-#pragma omp parallel for num_threads(this->threadNum)
-			for (int _ti = 0; _ti < _timespace.size(); _ti++)
+			// evolution - the states for the block of times come from a single matrix-matrix product
+			const u64 _tBlock = std::max<u64>(1, std::min<u64>(UI_LIMITS_TIME_EVO_BLOCK, UI_LIMITS_TIME_EVO_MEM / (_Nh * sizeof(cpx))));
+			for (u64 _t0 = 0; _t0 < _timespace.size(); _t0 += _tBlock)
 			{
-				const auto _time							= _timespace(_ti);
-				const arma::Col<std::complex<double>> _st	= SystemProperties::TimeEvolution::time_evo(_eigvecs, _eigvals, _overlaps, _time);
+				const u64 _t1										= std::min<u64>(_t0 + _tBlock, _timespace.size());
+				const arma::Col<double> _times						= _timespace.subvec(_t0, _t1 - 1);
+				const arma::Mat<std::complex<double>> _coeff		= SystemProperties::TimeEvolution::time_evo_coeff(_eigvals, _overlaps, _times);
+				const arma::Mat<std::complex<double>> _states		= SystemProperties::TimeEvolution::time_evo_block(_eigvecs, _coeff);
 
-				// for each operator we can now apply the expectation value		
-				for (uint _opi = 0; _opi < _ops.size(); ++_opi)
+				// for each operator we can now apply the expectation value (in the eigenbasis if the V^+OV is known)
 				{
-					const cpx _rt					= arma::as_scalar(arma::cdot(_st, (_matrices[_opi] * _st)));
-					_timeEvolution[_opi](_ti, _r)	= algebra::cast<_T>(_rt);
+					Sched::BlasStage _blas(1);
+#pragma omp parallel for num_threads(this->threadNum)
+					for (int _opi = 0; _opi < _ops.size(); ++_opi)
+					{
+						const bool _inEig							= _eigMatrices.has(_opi) && !_matrices[_opi]->isSparse();
+						const arma::Col<cpx> _rt					= !_inEig	? SystemProperties::TimeEvolution::time_evo_expectation(*_matrices[_opi], _states)
+																				: SystemProperties::TimeEvolution::time_evo_expectation(_eigMatrices.get(_opi, _eigvecs, *_matrices[_opi]), _coeff);
+						for (u64 _ti = _t0; _ti < _t1; ++_ti)
+							_timeEvolution[_opi](_ti, _r)			= algebra::cast<_T>(_rt(_ti - _t0));
+					}
 				}
 
 				// say the time
-				if (_ti % 100 == 0)
-					LOGINFO(VEQ(_ti) + "/" + STR(_timespace.size()), LOG_TYPES::TRACE, 3);
+				LOGINFO(VEQ(_t1) + "/" + STR(_timespace.size()), LOG_TYPES::TRACE, 3);
 
-				// calculate the entanglement entropy for each site
-				{
-					//for (int i = 1; i <= _Ns; i++)
-					auto _iter = 0;
-					for (const auto i: _entropiesSites)
-					{
-						// calculate the entanglement entropy
-						uint _maskA							= 1 << (i - 1);
-						_timeEntropyME[_iter++](_ti, _r)	= Entropy::Entanglement::Bipartite::vonNeuman<cpx>(_st, 1, _Ns, _maskA, DensityMatrix::RHO_METHODS::SCHMIDT, 2);
-					}
-					if(_Nh <= UI_LIMITS_MAXFULLED / 4)
-						_timeEntropyBipartiteME(_ti, _r)	= Entropy::Entanglement::Bipartite::vonNeuman<cpx>(_st, int(_Ns / 2), _Ns, (ULLPOW((int(_Ns / 2)))) - 1);
-				}
-				// calculate the participation entropy
+				// entanglement of the whole block of the time points in a single pass
+				Entropy::Entanglement::Bipartite::Batched::Result _ent;
+				Entropy::Entanglement::Bipartite::Batched::entropies(_states, uint(_Ns), _entropiesMasks, {}, _ent, this->threadNum);
+#pragma omp parallel for num_threads(this->threadNum)
+				for (int _ti = (int)_t0; _ti < (int)_t1; _ti++)
 				{
-					_timePEntro(_ti, _r)					= SystemProperties::information_entropy(_st);
+					for (int i = 0; i < _entropiesSites.size(); ++i)
+						_timeEntropyME[i](_ti, _r)			= _ent.vn_(_ti - _t0, i);
+					if (_entropiesMasks.size() > _entropiesSites.size())
+						_timeEntropyBipartiteME(_ti, _r)	= _ent.vn_(_ti - _t0, _entropiesSites.size());
+					_timePEntro(_ti, _r)					= SystemProperties::information_entropy(arma::Col<std::complex<double>>(_states.col(_ti - _t0)));
 				}
 			}
 
 		};
 
 
+	// --------------------------- PROPAGATE STATE ------------------------------
+
+	auto _propagateState = [&](uint _r, 
+							   const arma::Col<_T>& _initial_state,
+							   arma::Mat<_T>& _energydensities,
+							   VMAT<_T>& _timeEvolution,
+							   v_1d<arma::Col<_T>>& _timeZero,
+							   const v_1d<std::shared_ptr<const GeneralizedMatrix<double>>>& _matrices)
+		{
+			// energies of the initial state
+			const arma::Col<_T> _init_stat_H	= _H->getHamiltonian() * _initial_state;
+			_energydensities(0, _r)				= _H->getEnInf();
+			_energydensities(1, _r)				= arma::cdot(_initial_state, _init_stat_H);
+			_energydensities(2, _r)				= arma::cdot(_init_stat_H, _init_stat_H);
+
+			// save zero time value
+			{
+				Sched::BlasStage _blas(1);
+#pragma omp parallel for num_threads(this->threadNum)
+				for (int _opi = 0; _opi < _ops.size(); ++_opi)
+					_timeZero[_opi](_r) = arma::as_scalar(arma::cdot(_initial_state, (*_matrices[_opi] * _initial_state)));
+			}
+
+			// step through the times
+			auto _run = [&](const auto& _prop)
+				{
+					LOGINFO("Chebyshev propagator: " + VEQP(_prop.getA(), 4) + "," + VEQP(_prop.getB(), 4), LOG_TYPES::TRACE, 3);
+					arma::Col<std::complex<double>> _st	= arma::conv_to<arma::Col<std::complex<double>>>::from(_initial_state);
+					double _tprev						= 0.0;
+					for (int _ti = 0; _ti < _timespace.size(); _ti++)
+					{
+						_st								= _prop.evolve(_st, _timespace(_ti) - _tprev);
+						_tprev							= _timespace(_ti);
+
+						{
+							Sched::BlasStage _blas(1);
+#pragma omp parallel for num_threads(this->threadNum)
+							for (int _opi = 0; _opi < _ops.size(); ++_opi)
+								_timeEvolution[_opi](_ti, _r) = algebra::cast<_T>(arma::as_scalar(arma::cdot(_st, (*_matrices[_opi] * _st))));
+						}
+
+						_stateMeasures(_r, _ti, _st);
+
+						// say the time
+						if (_ti % 100 == 0)
+							LOGINFO(VEQ(_ti) + "/" + STR(_timespace.size()), LOG_TYPES::TRACE, 3);
+					}
+				};
+
+			const auto& _Hm = _H->getHamiltonian();
+			if (_Hm.isSparse())
+			{
+				const auto& _Hs = _Hm.getSparse();
+				_run(SystemProperties::TimeEvolution::ChebyshevPropagator<arma::SpMat<_T>>(_Hs));
+			}
+			else
+			{
+				const auto& _Hd = _Hm.getDense();
+				_run(SystemProperties::TimeEvolution::ChebyshevPropagator<arma::Mat<_T>>(_Hd));
+			}
+		};
+
 	// -------------------------------- SAVER ------------------------------------
 
 	// create the saving function
+	// pipelined writer of the outputs (one open of each file per checkpoint)
+	UI_H5::Writer _writer;
+	// shards of the realizations (job arrays) - the files of each shard get its suffix, the tag follows from the model and the seed
+	if (this->modP.eth_shard_ > 0 && this->modP.eth_shard_ < this->modP.getRanReal())
+	{
+		if (this->modP.modRanSeed_ == 0)
+		{
+			LOGINFO("The shards of the realizations (eth_shard) require the explicit seed (modRanSeed)!", LOG_TYPES::ERROR, 1);
+			return;
+		}
+		randomStr			= "_seed=" + STR(this->modP.modRanSeed_);
+	}
+	UI_REAL::Scheduler _real(dir, modelInfo + randomStr, this->modP.getRanReal(), this->modP.eth_shard_, this->modP.eth_lease_);
+	std::string _shardSfx;
 	std::function<void(uint)> _saver = [&](uint _r)
 		{
 			// variance in th Hamiltonian
-			saveAlgebraic(dir, "stat" + randomStr + extension, arma::vec(_meanlvl.row(0).as_col()), "mean_lvl_spacing", false);
-			saveAlgebraic(dir, "stat" + randomStr + extension, arma::vec(_meanlvl.row(1).as_col()), "heis_time_gamma", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, arma::vec(_meanlvl.row(2).as_col()), "heis_time_around_mean", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, arma::vec(_meanlvl.row(3).as_col()), "heis_time_around_mean_typ", true);
-			saveAlgebraic(dir, "stat" + randomStr + extension, _energies, "energies", true);
+			_writer.saveReal(dir, "stat" + randomStr + _shardSfx + extension, arma::vec(_meanlvl.row(0).as_col()), "mean_lvl_spacing", false);
+			_writer.saveReal(dir, "stat" + randomStr + _shardSfx + extension, arma::vec(_meanlvl.row(1).as_col()), "heis_time_gamma", true);
+			_writer.saveReal(dir, "stat" + randomStr + _shardSfx + extension, arma::vec(_meanlvl.row(2).as_col()), "heis_time_around_mean", true);
+			_writer.saveReal(dir, "stat" + randomStr + _shardSfx + extension, arma::vec(_meanlvl.row(3).as_col()), "heis_time_around_mean_typ", true);
+			_writer.saveReal(dir, "stat" + randomStr + _shardSfx + extension, _energies, "energies", true);
 
 			// save the ldos's
-			saveAlgebraic(dir, "ldos" + randomStr + extension, _ldos_me, "ME", false);
+			_writer.saveReal(dir, "ldos" + randomStr + _shardSfx + extension, _ldos_me, "ME", false);
 
 			// save the energy densities
-			saveAlgebraic(dir, "energydens" + randomStr + extension, arma::Col<_T>(_energydensitiesME.row(0).as_col()), "mean", false);
-			saveAlgebraic(dir, "energydens" + randomStr + extension, arma::Col<_T>(_energydensitiesME.row(1).as_col()), "mean_state", true);
-			saveAlgebraic(dir, "energydens" + randomStr + extension, arma::Col<_T>(_energydensitiesME.row(2).as_col()), "mean_state2", true);
+			_writer.saveReal(dir, "energydens" + randomStr + _shardSfx + extension, arma::Col<_T>(_energydensitiesME.row(0).as_col()), "mean", false);
+			_writer.saveReal(dir, "energydens" + randomStr + _shardSfx + extension, arma::Col<_T>(_energydensitiesME.row(1).as_col()), "mean_state", true);
+			_writer.saveReal(dir, "energydens" + randomStr + _shardSfx + extension, arma::Col<_T>(_energydensitiesME.row(2).as_col()), "mean_state2", true);
 			
 			// save the matrices for time evolution
-			saveAlgebraic(dir, "evo" + randomStr + extension, _timespace, "time", false);
+			_writer.save(dir, "evo" + randomStr + _shardSfx + extension, _timespace, "time", false);
 			//for(int i = 0; i < _Ns; i++)
 			for(int i = 0; i < _entropiesSites.size(); ++i)
-				saveAlgebraic(dir, "evo" + randomStr + extension, _timeEntropyME[i], "entanglement_entropy/ME/" + STR((_entropiesSites[i])), true);
-			saveAlgebraic(dir, "evo" + randomStr + extension, _timeEntropyBipartiteME, "entanglement_entropy/ME/bipartite", true);
-			saveAlgebraic(dir, "evo" + randomStr + extension, _timePEntro, "participation_entropy/ME", true);
+				_writer.saveReal(dir, "evo" + randomStr + _shardSfx + extension, _timeEntropyME[i], "entanglement_entropy/ME/" + STR((_entropiesSites[i])), true);
+			_writer.saveReal(dir, "evo" + randomStr + _shardSfx + extension, _timeEntropyBipartiteME, "entanglement_entropy/ME/bipartite", true);
+			_writer.saveReal(dir, "evo" + randomStr + _shardSfx + extension, _timePEntro, "participation_entropy/ME", true);
 
 			// save the averages epsilon
-			saveAlgebraic(dir, "avs" + randomStr + extension, arma::vec(_toCheckEps), "eps", false);
+			_writer.save(dir, "avs" + randomStr + _shardSfx + extension, arma::vec(_toCheckEps), "eps", false);
 			
 			// go through the operators
 			for (uint _opi = 0; _opi < _ops.size(); ++_opi)
@@ -1184,27 +1517,36 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 				auto _name = _measure.getOpGN(_opi);
 
 				// diagonal
-				saveAlgebraic(dir, "diag" + randomStr + extension, _diagonals[_opi], _name, _opi > 0);
+				_writer.saveReal(dir, "diag" + randomStr + _shardSfx + extension, _diagonals[_opi], _name, _opi > 0);
 
 				// evolution
-				saveAlgebraic(dir, "evo" + randomStr + extension, _timeEvolutionME[_opi], _name + "/ME", true);
+				_writer.saveReal(dir, "evo" + randomStr + _shardSfx + extension, _timeEvolutionME[_opi], _name + "/ME", true);
 
 				// at zero
-				saveAlgebraic(dir, "evo" + randomStr + extension, _timeZeroME[_opi], _name + "/zero/ME", true);
+				_writer.saveReal(dir, "evo" + randomStr + _shardSfx + extension, _timeZeroME[_opi], _name + "/zero/ME", true);
 
 				// diagonal ensemble
-				saveAlgebraic(dir, "avs" + randomStr + extension, _microcanonicalME[_opi], _name + "/micro/ME", true);
-				saveAlgebraic(dir, "avs" + randomStr + extension, _microcanonical2ME[_opi], _name + "/micro2/ME", true);
+				_writer.saveReal(dir, "avs" + randomStr + _shardSfx + extension, _microcanonicalME[_opi], _name + "/micro/ME", true);
+				_writer.saveReal(dir, "avs" + randomStr + _shardSfx + extension, _microcanonical2ME[_opi], _name + "/micro2/ME", true);
 
 				// long time average
-				saveAlgebraic(dir, "avs" + randomStr + extension, arma::vec(_diagonalME.row(_opi).as_col()), _name + "/diagonal/ME", true);
+				_writer.saveReal(dir, "avs" + randomStr + _shardSfx + extension, arma::vec(_diagonalME.row(_opi).as_col()), _name + "/diagonal/ME", true);
 			}
 
 			LOGINFO("Checkpoint:" + STR(_r), LOG_TYPES::TRACE, 4);
+
+			// pass the stage to the I/O thread (the next realization runs meanwhile)
+			_writer.commit();
 		};
 
+	// operators in the eigenbasis, shared by the measurements of a single realization
+	Operators::OverlapCache<_T> _overlapCache;
+
+	// the disorder only changes the values - the nonzero pattern of the first realization is reused (verified on each build)
+	_H->setReuseStructure(true);
+
 	// go through realizations
-	for (int _r = 0; _r < this->modP.getRanReal(); ++_r)
+	for (int _r = _real.start(_shardSfx); _r >= 0; _r = _real.next(_r, _shardSfx, [&](uint _rEnd) { _saver(_rEnd); _writer.flush(); }))
 	{
 		// ----------------------------------------------------------------------------
 		
@@ -1215,12 +1557,31 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 			LOGINFO("Doing: " + STR(_r), LOG_TYPES::TRACE, 0);
 			_timer.checkpoint(STR(_r));
 
-			this->ui_eth_randomize(_H, _r);
-			LOGINFO(_timer.point(STR(_r)), "Diagonalization", 1);
+			// the shards start anywhere - the engine of the disorder depends on the seed and the realization only
+			if (_real.sharded())
+				_H->ran_.newSeed(this->modP.modRanSeed_ ^ (0x9E3779B97F4A7C15ULL * (u64)(_r + 1)));
+			this->ui_eth_randomize(_H, _r, 0, !_usePropagator);
+			LOGINFO(_timer.point(STR(_r)), _usePropagator ? "Build" : "Diagonalization", 1);
 
 			// create the initial state
 			const arma::Col<_T> _diagonal = _H->getDiag();
-			_initial_state_me = SystemProperties::TimeEvolution::create_initial_quench_state<_T>(SystemProperties::TimeEvolution::QuenchTypes::SEEK, _Nh, _Ns, _H->getEnAv(), _diagonal);
+			_initial_state_me = SystemProperties::TimeEvolution::create_initial_quench_state<_T>(SystemProperties::TimeEvolution::QuenchTypes::SEEK, _Nh, _Ns, 
+																										_usePropagator ? _H->getEnInf() : _H->getEnAv(), _diagonal);
+		}
+
+		// -----------------------------------------------------------------------------
+
+		// only the dynamics without the spectrum
+		if (_usePropagator)
+		{
+			_timer.checkpoint(STR(_r) + ": time evolution");
+			_propagateState(_r, _initial_state_me, _energydensitiesME, _timeEvolutionME, _timeZeroME, _measure.getOpG_mat());
+			LOGINFO(_timer.point(STR(_r) + ": time evolution"), "Time evolution (Chebyshev): " + STR(_r), 3);
+
+			if (check_saving_size(_Nh, _r))
+				_saver(_r);
+			LOGINFO(VEQ(_r), LOG_TYPES::TRACE, 30, '#', 1);
+			continue;
 		}
 
 		// -----------------------------------------------------------------------------
@@ -1255,21 +1616,26 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 
 			// other measures
 			{
-				// calculate the diagonals
+				// calculate the diagonals (the dense operators are kept in the eigenbasis for the time evolution if they fit)
 				const auto& _matrices				= _measure.getOpG_mat();
-				const auto& _eigvec					= _H->getEigVec();
+				// the time evolution combines all the states - the full eigenbasis is brought into the memory once
+				const auto& _eigvec					= _H->loadEigVec();
+				_overlapCache.reset(_ops.size(), _Nh, _r, UI_LIMITS_TIME_EVO_EIG_MEM);
 
 #pragma omp parallel for num_threads(_Nh < ULLPOW(14) ? this->threadNum : 2)
 				for (int _opi = 0; _opi < _ops.size(); ++_opi)
 				{
-					_diagonals[_opi].col(_r) = Operators::applyOverlapMat(_eigvec, _matrices[_opi]).diag();
+					_diagonals[_opi].col(_r)		= _overlapCache.get(_opi, _eigvec, *_matrices[_opi]).diag();
+					_overlapCache.release(_opi);
 				}
 
 				_timer.checkpoint(STR(_r) + ": time evolution");
 
 				// evolve the states
 				_evolveState(_r, _initial_state_me, _ldos_me, _energydensitiesME,  
-					_microcanonicalME, _microcanonical2ME, _diagonalME, _timeEvolutionME, _timeZeroME, _matrices);
+					_microcanonicalME, _microcanonical2ME, _diagonalME, _timeEvolutionME, _timeZeroME, _matrices, _overlapCache);
+				// the kept matrices are not read after the time evolution
+				_overlapCache.clear();
 
 				LOGINFO(_timer.point(STR(_r) + ": time evolution"), "Time evolution: " + STR(_r), 3);
 			}
@@ -1282,13 +1648,130 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 		// -----------------------------------------------------------------------------
 	}
 
-	// save the diagonals
-	_saver(this->modP.getRanReal());
+	// save the diagonals (the shards are written on completion and merged by the last process)
+	if (!_real.sharded())
+		_saver(this->modP.getRanReal());
+	_writer.flush();
+	if (const size_t _failed = _writer.failures(); _failed > 0)
+		LOGINFO("Failed to write " + STR(_failed) + " files in " + dir + " - the results are incomplete.", LOG_TYPES::ERROR, 0);
+	if (_real.sharded())
+		_real.merge({ "stat" + randomStr, "ldos" + randomStr, "energydens" + randomStr, "evo" + randomStr, "avs" + randomStr, "diag" + randomStr }, extension);
 
 	// bye
 	LOGINFO(_timer.start(), "ETH CALCULATOR", 0);
 }
 
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+/*
+* @brief Thermal curves from the quantum typicality - the random vectors evolved in the imaginary time (Chebyshev) give
+* Z(beta), <H>, C_V and the averages of the ETH operators on the grid of beta without the diagonalization, therefore, the
+* sizes beyond UI_LIMITS_MAXFULLED are available. The errors are the jackknife over the random vectors.
+*/
+template<typename _T>
+void UI::checkThermalTypicality(std::shared_ptr<Hamiltonian<_T>> _H)
+{
+	_timer.reset();
+	LOGINFO("", LOG_TYPES::TRACE, 40, '#', 0);
+
+	u64 _Nh						= _H->getHilbertSize();
+	v_1d<std::shared_ptr<Operators::Operator<double>>> _ops;
+	strVec _opsN;
+	std::tie(_ops, _opsN)		= this->ui_eth_getoperators(_Nh, true, true);
+
+	std::string modelInfo, dir	= "THERMAL_TYP", randomStr, extension;
+	this->get_inf_dir_ext_r(_H, dir, modelInfo, randomStr, extension);
+	Measurement<double> _measure(this->latP.Ntot_, dir, _ops, _opsN, 1, 0);
+	_measure.setCacheKeys(Operators::OperatorNameParser(this->latP.Ntot_, _Nh).signatures(_opsN), _H->getHilbertSpace().getCacheKey());
+	// without the matrices the operators act on the basis states of the random vectors (full Hilbert space only)
+	_measure.setLazy(this->modP.th_lazy_, _Nh, _H->getHilbertSpace().getFullHilbertSize());
+
+	// grid of the inverse temperatures
+	const uint _nBeta			= std::max(this->modP.th_nbeta_, 2u);
+	const arma::Col<double> _betas = arma::linspace(0.0, this->modP.th_bmax_, _nBeta);
+	const uint _R				= std::max(this->modP.th_R_, 1u);
+	const uint _nReal			= this->modP.getRanReal();
+
+	arma::Mat<double> _logZ(_nBeta, _nReal, arma::fill::zeros), _E(_nBeta, _nReal, arma::fill::zeros), _EErr(_nBeta, _nReal, arma::fill::zeros);
+	arma::Mat<double> _C(_nBeta, _nReal, arma::fill::zeros), _CErr(_nBeta, _nReal, arma::fill::zeros);
+	VMAT<double> _O				= UI_DEF_VMAT(double, _ops.size(), _nBeta, _nReal);
+	VMAT<double> _OErr			= UI_DEF_VMAT(double, _ops.size(), _nBeta, _nReal);
+
+	auto _saver = [&](uint _r)
+		{
+			saveAlgebraic(dir, "thermal" + randomStr + extension, _betas, "beta", false);
+			saveAlgebraic(dir, "thermal" + randomStr + extension, _logZ, "logZ", true);
+			saveAlgebraic(dir, "thermal" + randomStr + extension, _E, "energy", true);
+			saveAlgebraic(dir, "thermal" + randomStr + extension, _EErr, "energy_err", true);
+			saveAlgebraic(dir, "thermal" + randomStr + extension, _C, "heat_capacity", true);
+			saveAlgebraic(dir, "thermal" + randomStr + extension, _CErr, "heat_capacity_err", true);
+			for (uint _opi = 0; _opi < _ops.size(); ++_opi)
+			{
+				saveAlgebraic(dir, "thermal" + randomStr + extension, _O[_opi], "operators/" + _opsN[_opi], true);
+				saveAlgebraic(dir, "thermal" + randomStr + extension, _OErr[_opi], "operators_err/" + _opsN[_opi], true);
+			}
+			LOGINFO("Checkpoint:" + STR(_r), LOG_TYPES::TRACE, 4);
+		};
+
+	for (uint _r = 0; _r < _nReal; ++_r)
+	{
+		LOGINFO(VEQ(_r), LOG_TYPES::TRACE, 30, '#', 1);
+		this->ui_eth_randomize(_H, _r, 0, false);
+		LOGINFO(_timer.point(STR(_r)), "Build", 1);
+
+		BEGIN_CATCH_HANDLER
+		{
+			const auto& _matrices	= _measure.getOpG_mat();
+			const auto _stream		= _H->ranStream();
+			// the threads go over the blocks of the vectors, each product is single threaded
+			Sched::BlasStage _blas(1);
+			auto _run = [&](const auto& _Hm)
+				{
+					// the Gershgorin bound - e0 = b - a is below the whole spectrum (the norms never grow)
+					const auto _bounds		= KPM::bounds(_Hm);
+					// the matrix-free averages - single pass over the basis per vector for all the operators
+					auto _lazy				= [&](const Typicality::cpxMat& _V) -> arma::Mat<double>
+						{
+							arma::Mat<double> _out(_ops.size(), _V.n_cols);
+							for (uint c = 0; c < _V.n_cols; ++c)
+							{
+								const auto _vals	= _measure.measureG(arma::Col<cpx>(_V.col(c)));
+								for (uint _opi = 0; _opi < _ops.size(); ++_opi)
+									_out(_opi, c)	= _vals[_opi];
+							}
+							return _out;
+						};
+					const auto _res			= _measure.isLazy()	? Typicality::thermalWith(_Hm, _bounds.a_, _bounds.b_, _betas, _R, _stream, (uint)_ops.size(), _lazy, this->threadNum)
+																: Typicality::thermal(_Hm, _bounds.a_, _bounds.b_, _betas, _R, _stream, _matrices, this->threadNum);
+					_logZ.col(_r)			= _res.logZ_;
+					_E.col(_r)				= _res.E_;
+					_EErr.col(_r)			= _res.EErr_;
+					_C.col(_r)				= _res.C_;
+					_CErr.col(_r)			= _res.CErr_;
+					for (uint _opi = 0; _opi < _ops.size(); ++_opi)
+					{
+						_O[_opi].col(_r)	= _res.O_.col(_opi);
+						_OErr[_opi].col(_r)	= _res.OErr_.col(_opi);
+					}
+				};
+			const auto& _Hm			= _H->getHamiltonian();
+			if (_Hm.isSparse())
+				_run(_Hm.getSparse());
+			else
+				_run(_Hm.getDense());
+		}
+		END_CATCH_HANDLER("Typicality failed:", break;)
+		LOGINFO(_timer.point(STR(_r)), "Typicality: " + VEQ(_R) + ", " + VEQ(_nBeta), 1);
+
+		if (check_saving_size(_Nh, _r))
+			_saver(_r);
+	}
+	_saver(_nReal);
+
+	// bye
+	LOGINFO(_timer.start(), "THERMAL TYPICALITY", 0);
+}
+
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
@@ -1297,36 +1780,44 @@ void UI::checkETH_time_evo(std::shared_ptr<Hamiltonian<_T>> _H)
 template void UI::checkETH_statistics<double>(std::shared_ptr<Hamiltonian<double>> _H);
 template void UI::checkETH_statistics<cpx>(std::shared_ptr<Hamiltonian<cpx>> _H);
 
-template std::array<double, 6> UI::checkETH_statistics_mat_elems<double>(u64 _start, u64 _end,	std::atomic<size_t>& _statiter, int _th, u64 _Nh,
+template Accumulators::ElementMoments UI::checkETH_statistics_mat_elems<double>(u64 _start, u64 _end,	std::atomic<size_t>& _statiter, int _th, u64 _Nh,
 	Hamiltonian<double>* _H,
 	const arma::Mat<double>& _overlaps,
-	HistogramAverage<double>& _histAv,
-	HistogramAverage<double>& _histAvTypical,
+	Accumulators::LogHistogram& _histAv,
+	Accumulators::LogHistogram& _histAvTypical,
 	arma::Mat<double>* _offdiagElemsOmega,
 	arma::Mat<double>* _offdiagElemsOmegaLow,
 	VMAT<double>* _offdiagElems,
 	VMAT<double>* _offdiagElemsLow,
 	VMAT<double>* _offdiagElemesStat,
+	arma::Col<double>* _fidelity,
+	arma::Col<double>* _fidelityZ,
 	const double _bandwidth,
 	const double _avEn,
+	const double _fidMu,
 	int _opi,
 	int _r
 	);
-template std::array<double, 6> UI::checkETH_statistics_mat_elems<cpx>(u64 _start, u64 _end, std::atomic<size_t>& _statiter, int _th, u64 _Nh,
+template Accumulators::ElementMoments UI::checkETH_statistics_mat_elems<cpx>(u64 _start, u64 _end, std::atomic<size_t>& _statiter, int _th, u64 _Nh,
 	Hamiltonian<cpx>* _H,
 	const arma::Mat<cpx>& _overlaps,
-	HistogramAverage<double>& _histAv,
-	HistogramAverage<double>& _histAvTypical,
+	Accumulators::LogHistogram& _histAv,
+	Accumulators::LogHistogram& _histAvTypical,
 	arma::Mat<double>* _offdiagElemsOmega,
 	arma::Mat<double>* _offdiagElemsOmegaLow,
 	VMAT<cpx>* _offdiagElems,
 	VMAT<cpx>* _offdiagElemsLow,
 	VMAT<double>* _offdiagElemesStat,
+	arma::Col<double>* _fidelity,
+	arma::Col<double>* _fidelityZ,
 	const double _bandwidth,
 	const double _avEn,
+	const double _fidMu,
 	int _opi,
 	int _r
 	);
 
 template void UI::checkETH_time_evo<double>(std::shared_ptr<Hamiltonian<double>> _H);
-template void UI::checkETH_time_evo<cpx>(std::shared_ptr<Hamiltonian<cpx>> _H);
\ No newline at end of file
+template void UI::checkETH_time_evo<cpx>(std::shared_ptr<Hamiltonian<cpx>> _H);
+template void UI::checkThermalTypicality<double>(std::shared_ptr<Hamiltonian<double>> _H);
+template void UI::checkThermalTypicality<cpx>(std::shared_ptr<Hamiltonian<cpx>> _H);
\ No newline at end of file
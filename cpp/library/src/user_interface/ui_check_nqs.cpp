@@ -30,6 +30,19 @@ void UI::makeSimNQSExcited()
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+/*
+* @brief Correlation matrices sigma_z(i) sigma_z(j) and sigma_x(i) sigma_x(j) as the Pauli strings (see -nqs_corr), Ns x Ns each,
+* column-wise one after the other - the diagonal ones are estimated without the probability ratio.
+* @param _Ns number of the sites
+*/
+static auto nqsCorrelations(size_t _Ns) -> v_1d<Operators::Fused::PauliMask>
+{
+	auto _strings		= Operators::Fused::correlationStrings(_Ns, 'z', 'z');
+	const auto _xx		= Operators::Fused::correlationStrings(_Ns, 'x', 'x');
+	_strings.insert(_strings.end(), _xx.begin(), _xx.end());
+	return _strings;
+}
+
 /*
 * @brief Based on a given type, it creates a NQS. Uses the model provided by the user to get the Hamiltonian.
 * @param _H Specific Hamiltonian
@@ -41,6 +54,13 @@ template<typename _T, uint _spinModes>
 inline void UI::defineNQS(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_ptr<NQS<_spinModes, _T>>& _NQS, 
 		const v_1d<std::shared_ptr<NQS<_spinModes, _T>>>& _NQSl, const v_1d<double>& _beta)
 {
+	// the models emitting the connections get the statically dispatched pair (no virtual calls within the local energy)
+	if constexpr (_spinModes == 2)
+	{
+		if (this->defineNQSPair<_T>(_H, _NQS, _NQSl, _beta))
+			return this->defineNQSParams(_NQS);
+	}
+
 	// check what type of NQS to use and create it
 	switch (this->nqsP.type_)
 	{
@@ -66,7 +86,65 @@ inline void UI::defineNQS(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_ptr<
 		throw std::invalid_argument("I don't know any other NQS types :<");
 		break;
 	}
+	this->defineNQSParams(_NQS);
+}
+
+// ##########################################################################################################################################
+
+/*
+* @brief Creates the NQS with the type of the model fixed at compile time (NQS_Pair) for the models emitting the connections
+* of the local energy. The ratios of the ansatz and the connections of the model are inlined into a single loop.
+* @param _H Specific Hamiltonian
+* @param _NQS Neural Network Quantum State frameweork
+* @param _NQSl List of NQS to be used for the state estimation
+* @param _beta List of beta values to be used for the state estimation
+* @returns whether the pair exists for the model and the ansatz
+*/
+template<typename _T>
+inline bool UI::defineNQSPair(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_ptr<NQS<2, _T>>& _NQS, 
+		const v_1d<std::shared_ptr<NQS<2, _T>>>& _NQSl, const v_1d<double>& _beta)
+{
+	if (!_H->hasLocEnergyConn())
+		return false;
+
+	std::shared_ptr<NQS<2, _T>> _pair;
+	switch (this->modP.modTyp_)
+	{
+	case MY_MODELS::XYZ_M:
+		if (this->nqsP.type_ == NQSTYPES::RBM_T)
+			_pair = std::make_shared<NQS_Pair<RBM_S, XYZ, 2, _T>>(_H, this->nqsP.nqs_nh_, this->nqsP.nqs_lr_, this->threadNum, 1, _NQSl, _beta);
+		else if (this->nqsP.type_ == NQSTYPES::RBMPP_T)
+			_pair = std::make_shared<NQS_Pair<RBM_PP_S, XYZ, 2, _T>>(_H, this->nqsP.nqs_nh_, this->nqsP.nqs_lr_, this->threadNum, 1, _NQSl, _beta);
+		break;
+	case MY_MODELS::ISING_M:
+		if (this->nqsP.type_ == NQSTYPES::RBM_T)
+			_pair = std::make_shared<NQS_Pair<RBM_S, IsingModel, 2, _T>>(_H, this->nqsP.nqs_nh_, this->nqsP.nqs_lr_, this->threadNum, 1, _NQSl, _beta);
+		break;
+	case MY_MODELS::HEI_KIT_M:
+		if (this->nqsP.type_ == NQSTYPES::RBM_T)
+			_pair = std::make_shared<NQS_Pair<RBM_S, HeisenbergKitaev, 2, _T>>(_H, this->nqsP.nqs_nh_, this->nqsP.nqs_lr_, this->threadNum, 1, _NQSl, _beta);
+		else if (this->nqsP.type_ == NQSTYPES::RBMPP_T)
+			_pair = std::make_shared<NQS_Pair<RBM_PP_S, HeisenbergKitaev, 2, _T>>(_H, this->nqsP.nqs_nh_, this->nqsP.nqs_lr_, this->threadNum, 1, _NQSl, _beta);
+		break;
+	default:
+		return false;
+	}
+	if (!_pair)
+		return false;
+	LOGINFO("Using the statically dispatched pair of the model and the NQS.", LOG_TYPES::CHOICE, 3);
+	_NQS = _pair;
+	return true;
+}
 
+// ##########################################################################################################################################
+
+/*
+* @brief Sets the hyperparameters of the NQS from the user input (the solver, the schedulers, the sampler)
+* @param _NQS Neural Network Quantum State frameweork
+*/
+template<typename _T, uint _spinModes>
+inline void UI::defineNQSParams(std::shared_ptr<NQS<_spinModes, _T>>& _NQS)
+{
 	// set the hyperparameters
 #ifdef NQS_USESR_MAT_USED
 	_NQS->setPinv(this->nqsP.nqs_tr_pinv_);
@@ -74,11 +152,22 @@ inline void UI::defineNQS(std::shared_ptr<Hamiltonian<_T>>& _H, std::shared_ptr<
 	// regarding the solver
 	_NQS->setSolver(this->nqsP.nqs_tr_sol_, this->nqsP.nqs_tr_tol_, this->nqsP.nqs_tr_iter_, this->nqsP.nqs_tr_reg_);
 	_NQS->setPreconditioner(this->nqsP.nqs_tr_prec_);
+#ifdef NQS_USESR_NOMAT_USED
+	_NQS->setSRMode(this->nqsP.nqs_sr_, this->nqsP.nqs_sr_sp_);
+#endif
+	if (this->nqsP.nqs_mpi_)
+		_NQS->setDistributed(true);
+	if (this->nqsP.nqs_gpu_)
+		_NQS->setDevice(true, NQS_MPI::rank());
+	_NQS->setCheckpoint(this->nqsP.nqs_ck_async_, this->nqsP.nqs_resume_);
 #ifdef NQS_USESR
 	_NQS->setSregScheduler(this->nqsP.nqs_tr_regs_, this->nqsP.nqs_tr_reg_, this->nqsP.nqs_tr_regd_, this->nqsP.nqs_tr_epo_, this->nqsP.nqs_tr_regp_);
 #endif
 	_NQS->setScheduler(this->nqsP.nqs_sch_, this->nqsP.nqs_lr_, this->nqsP.nqs_lrd_, this->nqsP.nqs_tr_epo_, this->nqsP.nqs_lr_pat_);
 	_NQS->setEarlyStopping(this->nqsP.nqs_es_pat_, this->nqsP.nqs_es_del_);
+	_NQS->setProposal(this->nqsP.nqs_prop_);
+	_NQS->setChains(this->nqsP.nqs_ch_, this->threadNum);
+	_NQS->setSampleBuffer(this->nqsP.nqs_col_reuse_);
 }
 
 // ##########################################################################################################################################
@@ -147,6 +236,8 @@ void UI::nqsSingle(std::shared_ptr<NQS<_spinModes, _T>> _NQS)
 									_opsG, 
 									_opsL, 
 									_opsC, this->threadNum);
+	if (this->nqsP.nqs_corr_)
+		_meas.setOP_P(nqsCorrelations(this->latP.lat->get_Ns()));
 
 	// start the simulation
 	NQS_train_t _parT(this->nqsP.nqs_tr_epo_, this->nqsP.nqs_tr_th_, 
@@ -156,10 +247,17 @@ void UI::nqsSingle(std::shared_ptr<NQS<_spinModes, _T>> _NQS)
 					 this->nqsP.nqs_col_bn_, this->nqsP.nqs_col_bs_, 
 					 this->nqsP.nFlips_, dir);
 					 
-	arma::Col<_T> _EN(_parT.MC_sam_ + _parC.MC_sam_, arma::fill::zeros);
+	// the history has as many entries as were actually computed (the training may stop early, the buffer may hold fewer samples)
 	auto _out = _NQS->train(_parT, this->quiet, _timer.start(), 10);
-	_EN.subvec(0, _parT.MC_sam_ - 1) = std::get<0>(_out);
-	_EN.subvec(_parT.MC_sam_, _EN.size() - 1) = _NQS->collect(_parC, this->quiet, _timer.start(), _meas);
+	arma::Col<_T> _EN = std::get<0>(_out);
+	if (this->nqsP.nqs_col_reuse_ > 0)
+	{
+		// measure with the samples of the last training iterations
+		const arma::Col<_T> _ENC = _NQS->collectBuffered(_parC, _meas, this->quiet, _timer.start());
+		_EN = arma::join_cols(_EN, _ENC);
+	}
+	else
+		_EN = arma::join_cols(_EN, _NQS->collect(_parC, this->quiet, _timer.start(), _meas));
 
 	// save the energies
 	arma::Mat<double> _ENSM(_EN.size(), 2, arma::fill::zeros);
@@ -167,16 +265,18 @@ void UI::nqsSingle(std::shared_ptr<NQS<_spinModes, _T>> _NQS)
 	_ENSM.col(1)	= arma::imag(_EN);
 
 	// save energy
-	auto perc		= int(_parT.MC_sam_ / 20);
-	perc			= perc == 0 ? 1 : perc;
-	auto ENQS_0		= arma::mean(_ENSM.col(0).tail(perc));
+	auto perc		= std::min<arma::uword>(std::max<arma::uword>(_parT.MC_sam_ / 20, 1), _ENSM.n_rows);
+	auto ENQS_0		= perc > 0 ? arma::mean(_ENSM.col(0).tail(perc)) : 0.0;
 	LOGINFOG("Found the NQS groundstate to be ENQS_0 = " + STRP(ENQS_0, 7), LOG_TYPES::TRACE, 2);
-	_ENSM.save(dir + "history.dat", arma::raw_ascii);
 
 	// many body
 	if (_mbs.size() != 0)
 		_meas.measure(_mbs, _NQS->getHilbertSpace());
-	// save the measured quantities
+
+	// the estimators are reduced over the ranks (see collect) - the root saves them
+	if (!NQS_MPI::isRoot())
+		return;
+	_ENSM.save(dir + "history.dat", arma::raw_ascii);
 	_meas.save();
 }
 
@@ -234,6 +334,11 @@ void UI::nqsExcited()
 									{}, 
 									{}, 
 									{}, this->threadNum);
+	if (this->nqsP.nqs_corr_)
+	{
+		_measGS.setOP_P(nqsCorrelations(Nvis));
+		_meas.setOP_P(nqsCorrelations(Nvis));
+	}
 
 	if (this->nqsP.nqs_ed_) {
 		_H->buildHamiltonian();
@@ -319,7 +424,8 @@ void UI::nqsExcited()
 			LOGINFO(4);
 		}
 
-		// saver
+		// saver (the estimators are reduced over the ranks - the root saves them)
+		if (NQS_MPI::isRoot())
 		{
 			auto _EN_r 		= algebra::cast<double>(_EN_TRAIN);
 			auto _EN_rt 	= algebra::cast<double>(_EN_TESTS);
@@ -68,7 +68,7 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 
 	// many body orbitals (constructed of vectors of indices of single particle states)
 	v_1d<double> energies;
-	v_2d<uint> orbs;
+	Orbitals::Combinations orbs;
 
 	// single particle orbital indices (all posibilities to choose from in the combination)
 	v_1d<uint> _SPOrbitals  = Vectors::vecAtoB<uint>(Ns);
@@ -84,10 +84,14 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 
 	// shuffle the orbitals before taking the energies
 	if(this->modP.q_shuffle_)
-		std::shuffle(orbs.begin(), orbs.end(), this->ran_.eng());
+		orbs.shuffle(this->ran_.eng());
 
-	// obtain the energies
-	_H->getManyBodyEnergies(energies, orbs, this->threadNum);
+	// obtain the energies (a single product of the occupations with the single particle spectrum)
+	{
+		arma::vec _energies;
+		_H->getManyBodyEnergies(_energies, orbs);
+		energies			= arma::conv_to<v_1d<double>>::from(_energies);
+	}
 
 		// obtain the single particle energies
 	arma::Mat<_T> W			= _H->getTransMat();
@@ -103,6 +107,12 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 	// -------------------------------- CORRELATION --------------------------------
 	auto _appendEntroSP = [&](u64 _idx, const std::vector<std::vector<uint>>& _orbitals, arma::Col<cpx>& _coeff)
 		{
+			// single Slater determinant - the Gram matrix of the restricted orbitals suffices
+			if (_orbitals.size() == 1)
+			{
+				ENTROPIES_SP(_idx)	= Entropy::Entanglement::Bipartite::SingleParticle::vonNeumanSlater(Ws, _orbitals[0]);
+				return;
+			}
 			// iterate through the state
 			auto J				= SingleParticle::CorrelationMatrix::corrMatrix(Ns, Ws, WsC, _orbitals, _coeff, this->ran_);
 			ENTROPIES_SP(_idx)	= Entropy::Entanglement::Bipartite::SingleParticle::vonNeuman<cpx>(J);
@@ -115,7 +125,13 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 			arma::Mat<_T> _slater(Ns / 2, Ns / 2, arma::fill::zeros);
 			arma::Col<cpx> _state(_hilbertSize, arma::fill::zeros);
 			for (int i = 0; i < _orbitals.size(); ++i)
-				_state += _coeff(i) * _H->getManyBodyState(_orbitals[i], _hilbertSize, _slater);
+			{
+				// stream the amplitudes into the superposition (no temporary vector per orbital combination)
+				if (_hilbertSize == ULLPOW(Ns))
+					_H->forManyBodyAmplitudes(_orbitals[i], [&](u64 _s, _T _amp) { _state(_s) += _coeff(i) * _amp; });
+				else
+					_state += _coeff(i) * _H->getManyBodyState(_orbitals[i], _hilbertSize, _slater);
+			}
 
 			//_state /= arma::norm(_state);
 
@@ -159,8 +175,10 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 	// check if one wants to create a combinations at degenerate manifolds
 	if (_manifold && _gamma != 1)
 	{
-		// zip the energies and orbitals together
-		auto _zippedEnergies	= Containers::zip(energies, orbs);
+		// zip the energies and the indices of the orbitals together
+		v_1d<u64> _orbIdx(orbs.size());
+		std::iota(_orbIdx.begin(), _orbIdx.end(), 0);
+		auto _zippedEnergies	= Containers::zip(energies, _orbIdx);
 
 		// get map with frequencies of specific energies
 		auto _frequencies		= Vectors::freq<10>(energies, _gamma - 1);
@@ -206,7 +224,7 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 			std::vector<std::vector<uint>> orbitals;
 			for (uint i = idxState; i < idxState + _gamma; ++i)
 			{
-				orbitals.push_back(std::get<1>(_zippedEnergies[i]));
+				orbitals.push_back(orbs.get(std::get<1>(_zippedEnergies[i])));
 				ENERGIES(idx, i - idxState) = std::get<0>(_zippedEnergies[i]);
 			}
 
@@ -219,6 +237,19 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 			PROGRESS_UPD_DO(idx, pbar, "PROGRESS", _saveEntro(idx % pbar.percentageSteps == 0));
 		}
 	}
+	else if (_gamma == 1 && !this->modP.q_manybody_)
+	{
+		// ---------- GAUSSIAN STATES ---------
+		// product states only - draw the combinations and compute the entropies of all of them at once
+		v_2d<uint> _chosen(_realizations);
+		for (long long idx = 0; idx < _realizations; idx++)
+		{
+			auto idxState		= this->ran_.randomInt<uint>(0, energies.size() - _gamma);
+			_chosen[idx]		= orbs.get(idxState);
+			ENERGIES(idx, 0)	= energies[idxState];
+		}
+		ENTROPIES_SP			= Entropy::Entanglement::Bipartite::SingleParticle::vonNeumanBatch(Ws, _chosen, this->threadNum);
+	}
 	else
 	{
 		// go through the realizations
@@ -237,7 +268,7 @@ void UI::quadraticStatesManifold(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 			std::vector<std::vector<uint>> orbitals;
 			for (uint i = idxState; i < idxState + _gamma; ++i)
 			{
-				orbitals.push_back(orbs[i]);
+				orbitals.push_back(orbs.get(i));
 				ENERGIES(idx, i - idxState) = energies[i];
 			}
 
@@ -280,14 +311,18 @@ void UI::quadraticSpectralFunction(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 
 	// check the model (if necessery to build hamilonian, do it)
 	
+	const bool _kpm			= this->modP.q_kpm_ > 0;
 	{
 		_H->buildHamiltonian();
-		_H->diagH(false);
-		LOGINFO(_timer.start(), "Diagonalization", 3);
+		if (!_kpm)
+		{
+			_H->diagH(false);
+			LOGINFO(_timer.start(), "Diagonalization", 3);
+		}
 	}
 
 	// save single particle energies
-	if (!fs::exists(filename + ".h5"))
+	if (!_kpm && !fs::exists(filename + ".h5"))
 		_H->getEigVal(dir, HAM_SAVE_EXT::h5, false);
 
 	arma::Col<double> _D	= _H->getEigVal();
@@ -315,7 +350,24 @@ void UI::quadraticSpectralFunction(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 	arma::Col<double> _Dos_k(_omegas.n_elem, arma::fill::zeros);
 
 
+	// Chebyshev moments of the single particle matrix - computed once, the ω grid only enters the reconstruction
+	if (_kpm)
+	{
+		auto _tstart				= NOW;
+		const arma::SpMat<cpx> _Hs	= arma::SpMat<cpx>(algebra::cast<cpx>(_Hmat));
+		const auto _scale			= KPM::bounds(_Hs);
+		const uint _nMoments		= this->modP.q_kpm_;
+		const arma::Mat<double> _muR= KPM::diagonal(_Hs, _scale, _nMoments, arma::Mat<cpx>(Ns, Ns, arma::fill::eye), this->threadNum);
+		const arma::Mat<double> _muK= KPM::diagonal(_Hs, _scale, _nMoments, arma::Mat<cpx>(_expst), this->threadNum);
+		_outspectrals_r				= KPM::reconstruct(_muR, _omegas, _scale, KPM::Kernel::JACKSON, this->threadNum);
+		_outspectrals				= KPM::reconstruct(_muK, _omegas, _scale, KPM::Kernel::JACKSON, this->threadNum);
+		_Dos_r						= arma::sum(_outspectrals_r, 1);
+		_Dos_k						= arma::sum(_outspectrals, 1);
+		LOGINFO(_tstart, "KPM spectral functions: " + VEQ(_nMoments), 2);
+	}
 	// go through omegas
+	else
+	{
 #pragma omp parallel for num_threads(this->threadNum)
 	for(int _omega = 0; _omega < _omegas.size(); ++_omega)
 	{
@@ -347,6 +399,7 @@ void UI::quadraticSpectralFunction(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 		if (_omega % 10 == 0)
 			LOGINFO(_tstart, "Time for omega: " + STR(_omega) + "/" + STR(_omegas.size()), 2);
 	}
+	}
 
 	// save me!
 	{
@@ -373,7 +426,7 @@ void UI::quadraticSpectralFunction(std::shared_ptr<Hamiltonian<_T>>& _Ham)
 
 		// eDOS from the energies
 		{
-			auto _Dos			= SystemProperties::Spectral::Noninteracting::dos_gauss(_omegas, _D, 1e-1);
+			arma::Col<double> _Dos	= _kpm ? _Dos_r : arma::Col<double>(SystemProperties::Spectral::Noninteracting::dos_gauss(_omegas, _D, 1e-1));
 			double _integral	= arma::as_scalar(arma::trapz(_omegas, _Dos));
 			_Dos				/= _integral;
 			saveAlgebraic(dir, filename + "_spectral.h5", _Dos, "edos", true);
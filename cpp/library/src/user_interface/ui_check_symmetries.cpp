@@ -101,10 +101,6 @@ void UI::symmetries(std::shared_ptr<Hamiltonian<_T>> _H, bool _diag, bool _state
 	const uint maxBondNum	=	Ns / 2;
 	arma::mat ENTROPIES(maxBondNum, stateNum, arma::fill::zeros);
 
-	// get the symmetry rotation matrix
-	auto _symRot			=	_H->getSymRot();
-	bool usesSym			=	_H->hilbertSpace.checkSym();
-
 	// set which bonds we want to cut in bipartite
 	v_1d<uint> _bonds		=	{};
 	for (int i = 1; i <= maxBondNum; i++)
@@ -121,12 +117,10 @@ void UI::symmetries(std::shared_ptr<Hamiltonian<_T>> _H, bool _diag, bool _state
 	for (auto idx = 0LL; idx < stateNum; idx++) {
 		// get the eigenstate
 		arma::Col<_T> state = _H->getEigVec(idx);
-		if (usesSym)
-			state			= _symRot * state;
 		// go through bonds
 		for (auto i : _bonds) {
-			// iterate through the state
-			auto entro		= Entropy::Entanglement::Bipartite::vonNeuman<_T>(state, i, _H->hilbertSpace);
+			// iterate through the state (resolved in the symmetry sector, no rotation to the full space)
+			auto entro		= Entropy::Entanglement::Bipartite::vonNeumanSym<_T>(state, i, _H->hilbertSpace);
 			// save the entropy
 			ENTROPIES(i - 1, idx) = entro;
 		}
@@ -509,9 +503,6 @@ void UI::symmetriesDeg()
 	// iterate through bond cut
 	const uint maxBondNum	= Ns / 2;
 
-	// get the symmetry rotation matrix
-	auto _symRot			= this->hamComplex->getSymRot();
-	bool usesSym			= this->hamComplex->hilbertSpace.checkSym();
 	_timer.checkpoint("entro");
 	this->hamComplex->generateFullMap();
 
@@ -602,13 +593,9 @@ void UI::symmetriesDeg()
 			// normalize state
 			_state			=	_state / std::sqrt(arma::cdot(_state, _state));
 
-			// rotate!
-			if (usesSym)
-				_state			=	_symRot * _state;
-
 			// save the values
 			_entropies(_r, 0)	=	this->hamComplex->getEigVal(idxState);
-			_entropies(_r, 1)	=	Entropy::Entanglement::Bipartite::vonNeuman<cpx>(_state, maxBondNum, this->hamComplex->hilbertSpace);
+			_entropies(_r, 1)	=	Entropy::Entanglement::Bipartite::vonNeumanSym<cpx>(_state, maxBondNum, this->hamComplex->hilbertSpace);
 
 			// update progress
 			PROGRESS_UPD(_r, pbar, VEQ(_gamma) + " Entropy was : S=" + VEQ(_entropies(_r, 1) / (log(2.0) * maxBondNum)));
@@ -668,9 +655,6 @@ void UI::symmetriesCreateDeg()
 	// iterate through bond cut
 	const uint maxBondNum	=			Ns / 2;
 	
-	// get the symmetry rotation matrix
-	auto _symRot			=			this->hamComplex->getSymRot();
-	bool usesSym			=			this->hamComplex->hilbertSpace.checkSym();
 	this->_timer.checkpoint("entropy");
 	this->hamComplex->generateFullMap();
 	
@@ -715,14 +699,10 @@ void UI::symmetriesCreateDeg()
 			for (int id = 1; id < gamma; id++)
 				_state					+=	_HM[_ig][_r](id) * this->hamComplex->getEigVec(idx + id);
 
-			// rotate!
-			if (usesSym)
-				_state					=	_symRot * _state;
-
 			// normalize state
 			_state						=	_state / std::sqrt(arma::cdot(_state, _state));
 			_entropies(_r, 0)			=	this->hamComplex->getEigVal(idx);
-			_entropies(_r, 1)			=	Entropy::Entanglement::Bipartite::vonNeuman<cpx>(_state, maxBondNum, this->hamComplex->hilbertSpace);
+			_entropies(_r, 1)			=	Entropy::Entanglement::Bipartite::vonNeumanSym<cpx>(_state, maxBondNum, this->hamComplex->hilbertSpace);
 	
 			PROGRESS_UPD(_r, pbar, VEQ(gamma) + " Entropy was : S=" + VEQ(_entropies(_r, 1) / (log(2.0) * maxBondNum)));
 		}
@@ -734,6 +714,276 @@ void UI::symmetriesCreateDeg()
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
+// ##########################################################################################################################################
+
+// ###################################################### S E C T O R   S W E E P ##########################################################
+
+// ##########################################################################################################################################
+
+/*
+* @brief Enumerates all the independent symmetry sectors of the model and creates their Hamiltonians (without the matrices).
+* The lattice is shared and the compiled bond tables of the first sector are reused by all the others (same disorder).
+* @returns sectors with their Hilbert space dimensions
+*/
+v_1d<UI::SymSector> UI::symmetriesSectors()
+{
+	uint Ns					= this->latP.lat->get_Ns();
+	auto BC					= this->latP.lat->get_BC();
+
+	// parameters
+	v_1d<int> kS			= {};
+	v_1d<int> Rs			= {};
+	v_1d<int> U1s			= {};
+	v_1d<int> Sxs			= {};
+
+	bool useU1				= (this->modP.modTyp_ == MY_MODELS::XYZ_M) && this->modP.eta1_ == 0 && this->modP.eta2_ == 0;
+	if (useU1)			for (uint i = 0; i <= Ns; i++) U1s.push_back(i); else U1s.push_back(-INT_MAX);
+	if (BC == PBC)		for (uint i = 0; i <= int(Ns / 2) + 1; i++) kS.push_back(i); else kS.push_back(-INT_MAX);
+
+	v_1d<SymSector> _sectors;
+	std::shared_ptr<Hamiltonian<double>> _refD;
+	std::shared_ptr<Hamiltonian<cpx>> _refC;
+	for (auto k : kS)
+	{
+		this->symP.k_ = k;
+		// check Reflection
+		if (k == 0 || (k == int(Ns / 2) && (Ns % 2) == 0))
+			Rs = { -1, 1 };
+		else
+			Rs = { -INT_MAX };
+		for (auto r : Rs) {
+			this->symP.x_ = r;
+			for (auto u1 : U1s) {
+				this->symP.U1_ = u1;
+				// check Parity X
+				if ((!useU1 && (this->modP.hz_ == 0.0)) || (useU1 && (Ns % 2 == 0) && (this->symP.U1_ == Ns / 2) && (this->modP.hz_ == 0.0) && (this->modP.hx_ == 0.0)))
+					Sxs = { -1, 1 };
+				else
+					Sxs = { -INT_MAX };
+				for (auto px : Sxs) {
+					this->symP.px_ = px;
+					this->createSymmetries();
+					this->resetEd();
+					if (!this->defineModels(true))
+						continue;
+
+					SymSector _s;
+					_s.sym			= this->symP;
+					if (this->hamComplex)
+					{
+						_s.hamC		= std::move(this->hamComplex);
+						_s.Nh		= _s.hamC->getHilbertSize();
+						if (!_refC)	_refC = _s.hamC; else _s.hamC->shareBonds(*_refC);
+					}
+					else if (this->hamDouble)
+					{
+						_s.hamD		= std::move(this->hamDouble);
+						_s.Nh		= _s.hamD->getHilbertSize();
+						if (!_refD)	_refD = _s.hamD; else _s.hamD->shareBonds(*_refD);
+					}
+					if (_s.Nh == 0)
+						continue;
+					_s.states		= (_s.Nh < UI_LIMITS_MAXFULLED) ? _s.Nh : std::min(_s.Nh, UI_LIMITS_SI_STATENUM);
+					_sectors.push_back(std::move(_s));
+				}
+			}
+		}
+	}
+	LOGINFO("Sectors: " + STR(_sectors.size()), LOG_TYPES::INFO, 1);
+	return _sectors;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+/*
+* @brief Diagonalizes a single sector as an independent task - the same outputs as symmetries(), the files are written
+* one task at a time. The sizes of the sectors (logHilbert.dat) are logged by the sweep on the root rank.
+* @param _H Hamiltonian of the sector
+* @param _threads threads of the task (build, diagonalization and entropies)
+* @param _states save the eigenvectors
+* @returns eigenvalues of the sector
+*/
+template<typename _T>
+arma::vec UI::symmetriesSector(std::shared_ptr<Hamiltonian<_T>> _H, uint _threads, bool _states)
+{
+	auto _t					=	NOW;
+	const u64 Nh			=	_H->getHilbertSize();
+	const std::string modelInfo = _H->getInfo();
+	std::string dir			=	"";
+#pragma omp critical(UI_SECTOR_IO)
+	dir						=	makeDirsC(this->mainDir, _H->getType(), this->latP.lat->get_info());
+	const std::string filename = dir + modelInfo;
+
+	// build and diagonalize
+	_H->setThreadNum(_threads);
+	_H->buildHamiltonian();
+	u64 stateNum			=	Nh;
+	const bool useShiftAndInvert = Nh >= UI_LIMITS_MAXFULLED;
+	if (!useShiftAndInvert)
+		_H->diagH(false);
+	else
+	{
+		stateNum			=	std::min(Nh, UI_LIMITS_SI_STATENUM);
+		_H->diagH(false, (int)stateNum, 0, 1000, 1e-5, "sa");
+	}
+	LOGINFO(_t, "Sector diagonalization: " + modelInfo + "," + VEQ(Nh) + "," + VEQ(_threads), 2);
+	arma::vec _E			=	_H->getEigVal();
+	_H->clearH();
+
+	// entropies of the half-system cut (resolved in the symmetry sector)
+	const uint maxBondNum	=	_H->getNs() / 2;
+	arma::mat ENTROPIES(std::max(maxBondNum, 1u), stateNum, arma::fill::zeros);
+	if (maxBondNum > 0)
+	{
+		_H->generateFullMap();
+#ifndef _DEBUG
+#	pragma omp parallel for num_threads(_threads)
+#endif
+		for (long long idx = 0; idx < (long long)stateNum; idx++)
+		{
+			arma::Col<_T> state = _H->getEigVec(idx);
+			ENTROPIES(maxBondNum - 1, idx) = Entropy::Entanglement::Bipartite::vonNeumanSym<_T>(state, maxBondNum, _H->hilbertSpace);
+		}
+	}
+
+#pragma omp critical(UI_SECTOR_IO)
+	{
+		_H->getEigVal(dir, HAM_SAVE_EXT::h5, false);
+		ENTROPIES.save(arma::hdf5_name(filename + ".h5", "entropy", arma::hdf5_opts::append));
+		if (_states && !useShiftAndInvert)
+			_H->getEigVec(dir, stateNum, HAM_SAVE_EXT::h5, true);
+	}
+	return _E;
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+/*
+* @brief Runs the sectors as independent tasks. Each sector gets threadNum / 2^n threads according to its Hilbert space
+* dimension (UI_LIMITS_SECTOR_NH_THREAD per thread), the sectors with the same number of threads run concurrently in
+* threadNum / threads groups, the largest first. With the distributed build the sectors are dealt over the MPI ranks
+* (round robin). The eigenvalues of all the sectors are collected into a single file with the sector labels and the
+* degeneracies of the full spectrum.
+* @param _sectors sectors (see symmetriesSectors), the Hamiltonians are released once done
+* @param _states save the eigenvectors
+*/
+void UI::symmetriesSweep(v_1d<SymSector>& _sectors, bool _states)
+{
+	if (_sectors.empty())
+		return;
+	auto _t					=	NOW;
+	const uint _thr			=	std::max(1u, (uint)this->threadNum);
+	const int _rank			=	NQS_MPI::rank();
+	const int _ranks		=	NQS_MPI::size();
+	const std::string dir	=	makeDirsC(this->mainDir, _sectors[0].hamC ? _sectors[0].hamC->getType() : _sectors[0].hamD->getType(), this->latP.lat->get_info());
+
+	// threads of the sectors - the groups of the same size tile the threads
+	for (auto& _s : _sectors)
+	{
+		const u64 _want		=	std::clamp<u64>((_s.Nh + UI_LIMITS_SECTOR_NH_THREAD - 1) / UI_LIMITS_SECTOR_NH_THREAD, 1, _thr);
+		_s.threads			=	_thr;
+		while (_s.threads > 1 && _s.threads > _want)
+			_s.threads		/=	2;
+	}
+	std::stable_sort(_sectors.begin(), _sectors.end(), [](const SymSector& a, const SymSector& b)
+		{ return a.threads != b.threads ? a.threads > b.threads : a.Nh > b.Nh; });
+
+	// the sizes of all the sectors are logged once - the other ranks would append to the same file concurrently
+	if (NQS_MPI::isRoot())
+	{
+		std::ofstream ofs(dir + "logHilbert.dat", std::ios_base::out | std::ios_base::app);
+		for (const auto& _s : _sectors)
+		{
+			std::string logMe	=	"";
+			if (_s.hamC)
+				strSeparatedS(logMe, ',', _s.hamC->getInfo(), _s.Nh, STRP(_s.hamC->getHamiltonianSizeH(), 5));
+			else if (_s.hamD)
+				strSeparatedS(logMe, ',', _s.hamD->getInfo(), _s.Nh, STRP(_s.hamD->getHamiltonianSizeH(), 5));
+			ofs << logMe << EL;
+		}
+	}
+
+	// the sectors of the other ranks are released
+	for (size_t i = 0; i < _sectors.size(); ++i)
+		if ((int)(i % _ranks) != _rank)
+		{
+			_sectors[i].hamC.reset();
+			_sectors[i].hamD.reset();
+		}
+
+	v_1d<arma::vec> _E(_sectors.size());
+	omp_set_max_active_levels(2);
+	for (size_t a = 0; a < _sectors.size();)
+	{
+		size_t b			=	a;
+		while (b < _sectors.size() && _sectors[b].threads == _sectors[a].threads)
+			++b;
+		const int _groups	=	(int)std::max(1u, _thr / _sectors[a].threads);
+		LOGINFO("Sectors: " + STR(b - a) + " with " + VEQ(_sectors[a].threads) + " in " + VEQ(_groups), LOG_TYPES::TRACE, 1);
+#pragma omp parallel for num_threads(_groups) schedule(dynamic, 1)
+		for (long long i = (long long)a; i < (long long)b; ++i)
+		{
+			auto& _s		=	_sectors[i];
+			// the nested regions (and LAPACK) of this task take its own threads
+			omp_set_num_threads((int)_s.threads);
+			if (_s.hamC)
+				_E[i]		=	this->symmetriesSector<cpx>(_s.hamC, _s.threads, _states);
+			else if (_s.hamD)
+				_E[i]		=	this->symmetriesSector<double>(_s.hamD, _s.threads, _states);
+			_s.hamC.reset();
+			_s.hamD.reset();
+		}
+		a					=	b;
+	}
+	LOGINFO(_t, "All sectors", 1);
+
+	// collect the eigenvalues - the offsets follow from the dimensions known to all the ranks
+	u64 _n					=	0;
+	for (const auto& _s : _sectors)
+		_n					+=	_s.states;
+	arma::vec _all(_n, arma::fill::zeros);
+	arma::uvec _sec(_n);
+	arma::mat _params(_sectors.size(), 8);
+	for (u64 i = 0, _off = 0; i < _sectors.size(); _off += _sectors[i].states, ++i)
+	{
+		const auto& _s		=	_sectors[i];
+		_sec.subvec(_off, _off + _s.states - 1).fill(i);
+		if (!_E[i].is_empty())
+			_all.subvec(_off, _off + std::min<u64>(_E[i].n_elem, _s.states) - 1) = _E[i].head(std::min<u64>(_E[i].n_elem, _s.states));
+		_params.row(i)		=	arma::rowvec({ (double)_s.sym.k_, (double)_s.sym.x_, (double)_s.sym.px_, (double)_s.sym.py_,
+											   (double)_s.sym.pz_, (double)_s.sym.U1_, (double)_s.Nh, (double)_s.threads });
+	}
+	NQS_MPI::sumInPlace(_all);
+	if (!NQS_MPI::isRoot())
+		return;
+
+	// full spectrum and its degeneracies
+	const arma::uvec _order	=	arma::sort_index(_all);
+	_all					=	_all(_order);
+	_sec					=	_sec(_order);
+	v_1d<double> _levels;
+	v_1d<arma::uword> _deg;
+	for (u64 i = 0; i < _n; ++i)
+	{
+		if (i == 0 || std::abs(_all(i) - _levels.back()) > UI_LIMITS_SECTOR_DEG_TOL * std::max(1.0, std::abs(_levels.back())))
+		{
+			_levels.push_back(_all(i));
+			_deg.push_back(0);
+		}
+		++_deg.back();
+	}
+
+	const std::string _file	=	dir + "sectors" + ".h5";
+	_all.save(arma::hdf5_name(_file, "energy"));
+	_sec.save(arma::hdf5_name(_file, "sector", arma::hdf5_opts::append));
+	_params.save(arma::hdf5_name(_file, "sectors", arma::hdf5_opts::append));
+	arma::vec(_levels).save(arma::hdf5_name(_file, "levels", arma::hdf5_opts::append));
+	arma::uvec(_deg).save(arma::hdf5_name(_file, "degeneracy", arma::hdf5_opts::append));
+	LOGINFO("Sweep: " + VEQ(_n) + " energies, " + STR(_levels.size()) + " levels - " + _file, LOG_TYPES::FINISH, 1);
+}
+
+// %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
 // %%%%%%%%%%%%%%%%%%%%% DEFINE THE TEMPLATES %%%%%%%%%%%%%%%%%%%%%
 template void UI::symmetries<double>(std::shared_ptr<Hamiltonian<double>> _H, bool _diag, bool _states);
 template void UI::symmetries<cpx>(std::shared_ptr<Hamiltonian<cpx>> _H, bool _diag, bool _states);
\ No newline at end of file
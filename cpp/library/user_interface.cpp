@@ -17,6 +17,32 @@ void UI::exitWithHelp()
 		"	3 -- 3D \n"
 		"-l lattice type		: (default square) -> CHANGE NOT IMPLEMENTED YET \n"
 		"   square \n"
+		"-pin flag				: pins the shared workers of the process to the cores spread over the NUMA nodes (default 0) \n"
+		"-hcache directory		: directory for caching the symmetry sector mappings (default none) \n"
+		"-eth_shard size		: split the ETH realizations into the shards of size claimed by the processes of a job array, completed shards are skipped on restart and merged at the end, requires -modRanSeed (default 0 - no shards) \n"
+		"-eth_lease seconds		: age of the claim of an unfinished shard after which another process takes it over (default 21600) \n"
+		"-eth_mid k				: the ETH statistics use only the k eigenpairs around Tr(H)/Nh from the shift-invert (filter) solver instead of the full diagonalization (default 0 - full) \n"
+		"-eth_dist 0/1			: diagonalize over all the MPI ranks (ScaLAPACK/ELPA), the eigenvectors stay distributed and only the diagonal elements of the operators are computed (default 0) \n"
+		"-eth_col 0/1			: append the per realization outputs of the ETH statistics as the columns of a single container eth*.h5 (one aligned chunk per realization, consolidated index _meta) instead of rewriting the stat/entro/ipr/diag files (default 0) \n"
+		"-eth_comp level		: deflate level 0-9 of the container chunks, 0 keeps them uncompressed for the memory mapped readers (default 0) \n"
+		"-q_kpm moments			: spectral functions of the quadratic models from the given number of the KPM Chebyshev moments, without the diagonalization (default 0 - exact) \n"
+		"-th_R vectors			: random vectors of the thermal typicality (-fun 47), Z(beta), <H>, C_V and the operator averages without the diagonalization (default 32) \n"
+		"-th_bmax beta			: largest inverse temperature of the typicality grid (default 10) \n"
+		"-th_nbeta points		: points of the uniform grid of beta from 0 to th_bmax (default 101) \n"
+		"-th_lazy 0/1			: the operator averages of the typicality are applied on the fly instead of storing their matrices, full Hilbert space only (default 0) \n"
+		"-estream directory		: directory for the out-of-core eigenvectors paged in on demand (default none - in memory) \n"
+		// NEURAL QUANTUM STATES
+		"\n"
+		"-nqs_ch chains			: number of Markov chains advanced together in the NQS training (default 1) \n"
+		"-nqs_sr mode			: matrix-free SR (default 0) - 0 - solver (nqs_tr_sol), 1 - lazy CG, 2 - MinSR, 3 - MinSR when samples < parameters \n"
+		"-nqs_sr_sp flag		: store the SR derivatives in the single precision (default 0) \n"
+		"-nqs_mpi flag			: distribute the NQS training over the MPI ranks - requires the NQS_USE_MPI build (default 0) \n"
+		"-nqs_gpu flag			: NQS chains (RBM) and SR on the device - requires the NQS_USE_GPU build (default 0) \n"
+		"-nqs_ck_async flag		: write the NQS checkpoints with a background thread (default 0) \n"
+		"-nqs_resume flag		: resume the NQS training from the last checkpoint in the weights directory (default 0) \n"
+		"-nqs_col_reuse iters	: measure the NQS observables with the samples of the last iters training iterations instead of a new sampling (default 0 - new sampling) \n"
+		"-nqs_corr flag			: measure the correlation matrices sigma_z(i) sigma_z(j) and sigma_x(i) sigma_x(j) with the fused Pauli strings (default 0) \n"
+		"-nqs_prop kernel		: proposal of the NQS sampler (default 0) - 0 - flips, 1 - nearest neighbour exchange, 2 - pair exchange, 3 - cluster of nf sites \n"
 		// SIMULATIONS STEPS
 		"\n"
 		"-fun					: function to be used in the calculations. There are predefined functions in the model that allow that:\n"
@@ -85,6 +111,8 @@ void UI::parseModel(int argc, cmdArg& argv)
 		SETOPTION(nqsP,	nqs_tr_mc);
 		SETOPTION(nqsP,	nqs_tr_bs);
 		SETOPTION(nqsP,	nqs_tr_th);
+		SETOPTION(nqsP,	nqs_ch);
+		SETOPTION(nqsP,	nqs_prop);
 		SETOPTION(nqsP,	nqs_tr_pinv);
 		SETOPTION(nqsP,	nqs_tr_pc);
 		// scheduler for the regularization
@@ -96,6 +124,12 @@ void UI::parseModel(int argc, cmdArg& argv)
 		SETOPTION(nqsP,	nqs_tr_prec);
 		// solver type
 		SETOPTION(nqsP,	nqs_tr_sol);
+		SETOPTION(nqsP,	nqs_sr);
+		SETOPTION(nqsP,	nqs_sr_sp);
+		SETOPTION(nqsP,	nqs_mpi);
+		SETOPTION(nqsP,	nqs_gpu);
+		SETOPTION(nqsP,	nqs_ck_async);
+		SETOPTION(nqsP,	nqs_resume);
 		SETOPTION(nqsP, nqs_tr_tol); 
 		SETOPTION(nqsP, nqs_tr_iter);
 
@@ -111,6 +145,8 @@ void UI::parseModel(int argc, cmdArg& argv)
 		SETOPTION(nqsP,	nqs_col_bn);
 		SETOPTION(nqsP,	nqs_col_th);	
 		SETOPTION(nqsP,	nqs_col_bs);	
+		SETOPTION(nqsP,	nqs_col_reuse);
+		SETOPTION(nqsP,	nqs_corr);
 
 		// learming rate
 		SETOPTION(nqsP,  nqs_sch);
@@ -157,6 +193,7 @@ void UI::parseModel(int argc, cmdArg& argv)
 		SETOPTIONVECTORRESIZET(modP, modRanN, 10, uint);
 		SETOPTION(modP, modRanSeed);
 		SETOPTION(modP, modMidStates);
+		SETOPTIONV(modP, estream, "estream");
 		SETOPTION(modP, modEnDiff);
 
 		// eth
@@ -164,6 +201,17 @@ void UI::parseModel(int argc, cmdArg& argv)
 		SETOPTION(modP, eth_susc);
 		SETOPTION(modP, eth_ipr);
 		SETOPTION(modP, eth_offd);
+		SETOPTION(modP, eth_prop);
+		SETOPTION(modP, eth_shard);
+		SETOPTION(modP, eth_lease);
+		SETOPTION(modP, eth_mid);
+		SETOPTION(modP, eth_dist);
+		SETOPTION(modP, eth_col);
+		SETOPTION(modP, eth_comp);
+		SETOPTION(modP, th_R);
+		SETOPTION(modP, th_bmax);
+		SETOPTION(modP, th_nbeta);
+		SETOPTION(modP, th_lazy);
 		SETOPTIONVECTORRESIZET(modP, eth_end, 10, double);
 
 		// set operators vector
@@ -178,6 +226,7 @@ void UI::parseModel(int argc, cmdArg& argv)
 			SETOPTIONV(modP, q_randomCombNum,	"q_CN");
 			SETOPTIONV(modP, q_shuffle,			"q_S");
 			SETOPTIONV(modP, q_broad,			"q_broad");
+			SETOPTIONV(modP, q_kpm,				"q_kpm");
 			
 			// -- aubry-andre ---
 			{
@@ -193,6 +242,7 @@ void UI::parseModel(int argc, cmdArg& argv)
 				// SETOPTION(modP.power_law_random_bandwidth, plrb_a);
 				SETOPTION(modP.power_law_random_bandwidth, plrb_b);
 				SETOPTION(modP.power_law_random_bandwidth, plrb_mb);
+				SETOPTION(modP.power_law_random_bandwidth, plrb_cut);
 			}
 		}
 		
@@ -277,9 +327,12 @@ void UI::parseModel(int argc, cmdArg& argv)
 		SETOPTION(symP, x);
 		SETOPTION(symP, U1);
 		SETOPTION(symP, S);
+		SETOPTIONV(symP, hcache, "hcache");
 	}
 	// ----------------- OTHERS ------------------
 	this->parseOthers(argv);
+	if (std::string option = this->getCmdOption(argv, "-pin"); option != "")
+		this->pinThreads_ = std::stoi(option) != 0;
 	// ---------------- DIRECTORY ----------------
 	this->parseMainDir(argv);
 }
@@ -293,6 +346,10 @@ void UI::funChoice()
 {
 	LOGINFO_CH_LVL(0);
 	LOGINFO("USING #THREADS=" + STR(this->threadNum), LOG_TYPES::CHOICE, 1);
+	// a single pool of the workers for all the stages (Hilbert space, NQS, measurements)
+	Sched::Scheduler::get().configure(this->threadNum, this->pinThreads_);
+	if (Sched::Scheduler::get().pinned())
+		LOGINFO("Pinned the workers to the cores of the NUMA nodes.", LOG_TYPES::CHOICE, 1);
 	this->_timer.reset();
 	LOGINFO("", LOG_TYPES::TRACE, 40, '#', 1);
 	
@@ -398,6 +455,11 @@ void UI::funChoice()
 			LOGINFO("SIMULATION: HAMILTONIAN - ETH - statistics time evolution sweep", LOG_TYPES::CHOICE, 1);
 			this->makeSimETH();
 			break;
+		case 47:
+			// this option utilizes the random vectors in the imaginary time for the thermal curves
+			LOGINFO("SIMULATION: HAMILTONIAN - THERMAL TYPICALITY", LOG_TYPES::CHOICE, 1);
+			this->makeSimETH();
+			break;
 		default:
 			// default case of showing the help
 			this->exitWithHelp();
@@ -569,64 +631,19 @@ void UI::makeSimSymmetriesCreateDeg()
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 /*
-* @brief A placeholder for making the simulation with symmetries, sweeping them all
+* @brief A placeholder for making the simulation with symmetries, sweeping them all. The sectors are independent tasks
+* scheduled over the threads (and the MPI ranks) by their Hilbert space dimensions - see symmetriesSweep.
 */
 void UI::makeSimSymmetriesSweep()
 {
 	LOGINFO_CH_LVL(3);
 	this->defineModels(true);
-	uint Ns = this->latP.lat->get_Ns();
-	auto BC = this->latP.lat->get_BC();
-	u64 Nh [[maybe_unused]] = 1;
-
-	// parameters
-	v_1d<int> kS = {};
-	v_1d<int> Rs = {};
-	v_1d<int> Szs = {};
-	v_1d<int> Sys = {};
-	v_1d<int> U1s = {};
-	v_1d<int> Sxs = {};
-
-	bool useU1 = (this->modP.modTyp_ == MY_MODELS::XYZ_M) && this->modP.eta1_ == 0 && this->modP.eta2_ == 0;
-	bool useSzParity = false;//(this->modP.modTyp_ == MY_MODELS::XYZ_M);// && (Ns % 2 == 0);
-	bool useSyParity = false; //(this->modP.modTyp_ == MY_MODELS::XYZ_M) && (Ns % 2 == 0);
-
-	if (useSzParity)	Szs = { -1, 1 }; else Szs = { -INT_MAX };
-	if (useSyParity)	Sys = { -1, 1 }; else Sys = { -INT_MAX };
-	if (useU1)			for (uint i = 0; i <= Ns; i++) U1s.push_back(i); else U1s.push_back(-INT_MAX);
-	if (BC == PBC)		for (uint i = 0; i <= int(Ns / 2) + 1; i++) kS.push_back(i); else kS.push_back(-INT_MAX);
+	this->resetEd();
 
 	// go through all
 	LOGINFO("STARTING ALL SECTORS", LOG_TYPES::INFO, 1);
-	for (auto k : kS)
-	{
-		this->symP.k_ = k;
-		// check Reflection
-		if (k == 0 || (k == int(Ns / 2) && (Ns % 2) == 0))
-			Rs = { -1, 1 };
-		else
-			Rs = { -INT_MAX };
-		for (auto r : Rs) {
-			this->symP.x_ = r;
-			for (auto pz : Szs) {
-				this->symP.pz_ = pz;
-				for (auto u1 : U1s) {
-					this->symP.U1_ = u1;
-					// check Parity X
-					if ((!useU1 && (this->modP.hz_ == 0.0)) || (useU1 && (Ns % 2 == 0) && (this->symP.U1_ == Ns / 2) && (this->modP.hz_ == 0.0) && (this->modP.hx_ == 0.0)))
-						Sxs = { -1, 1 };
-					else
-						Sxs = { -INT_MAX };
-					for (auto px : Sxs) {
-						this->symP.px_ = px;
-						this->createSymmetries();
-						this->makeSimSymmetries();
-						LOGINFO("-----------------------------------", LOG_TYPES::TRACE, 0);
-					}
-				}
-			}
-		}
-	}
+	auto _sectors = this->symmetriesSectors();
+	this->symmetriesSweep(_sectors);
 }
 
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%